@@ -0,0 +1,41 @@
+
+// Vertex Shader
+struct VS_INPUT
+{
+	float3 vPosition : POSITION;
+	float3 vColor: COLOR0;
+};
+
+struct PS_INPUT
+{
+	float4 vPosition : SV_POSITION;
+	float4 vColor : TEXCOORD0;
+};
+
+cbuffer SceneConstantBuffer : register(b0)
+{
+	float4x4 g_MVPMatrix;
+};
+
+// Both eyes are drawn in one pass; the right eye's matrix comes from its own buffer
+cbuffer SceneConstantBufferRight : register(b3)
+{
+	float4x4 g_MVPMatrixRight;
+};
+
+PS_INPUT VSMain( VS_INPUT i, uint nViewID : SV_ViewID )
+{
+	PS_INPUT o;
+	float4x4 matMVP = ( nViewID == 0 ) ? g_MVPMatrix : g_MVPMatrixRight;
+	o.vPosition = mul( matMVP, float4( i.vPosition, 1.0 ) );
+#ifdef VULKAN
+	o.vPosition.y = -o.vPosition.y;
+#endif
+	o.vColor = float4( i.vColor.rgb, 1.0 );
+	return o;
+}
+
+float4 PSMain( PS_INPUT i ) : SV_TARGET
+{
+	return i.vColor;
+}
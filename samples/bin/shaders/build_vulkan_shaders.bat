@@ -1,4 +1,6 @@
 @ECHO OFF
+REM The *_multiview.hlsl shaders read SV_ViewID, which needs a glslangValidator
+REM with SPV_KHR_multiview support (Vulkan SDK 1.0.61 or later).
 for /r %%i in ("*.hlsl") Do (
 	%VULKAN_SDK%\bin\glslangvalidator.exe -S vert -e VSMain -o %%~ni_vs.spv -V --hlsl-iomap --auto-map-bindings --shift-cbuffer-binding 0 --shift-texture-binding 1 --shift-sampler-binding 2 -D %%i
 	%VULKAN_SDK%\bin\glslangvalidator.exe -S frag -e PSMain -o %%~ni_ps.spv -V --hlsl-iomap --auto-map-bindings --shift-cbuffer-binding 0 --shift-texture-binding 1 --shift-sampler-binding 2 -D %%i
@@ -0,0 +1,509 @@
+//========= Copyright Valve Corporation ============//
+
+#include "cameracomponent.h"
+
+#include <math.h>
+#include <string.h>
+
+// how long the capture thread blocks on the source before checking for shutdown
+static const uint32_t k_unCaptureTimeoutMs = 50;
+
+
+bool CCameraComponentSample::CIndexRing::Push( uint32_t unIndex )
+{
+	uint32_t unHead = m_unHead.load( std::memory_order_relaxed );
+	if ( unHead - m_unTail.load( std::memory_order_acquire ) >= k_unSize )
+		return false;
+
+	m_rgIndices[ unHead % k_unSize ] = unIndex;
+	m_unHead.store( unHead + 1, std::memory_order_release );
+	return true;
+}
+
+
+bool CCameraComponentSample::CIndexRing::Pop( uint32_t *punIndex )
+{
+	uint32_t unTail = m_unTail.load( std::memory_order_relaxed );
+	if ( unTail == m_unHead.load( std::memory_order_acquire ) )
+		return false;
+
+	*punIndex = m_rgIndices[ unTail % k_unSize ];
+	m_unTail.store( unTail + 1, std::memory_order_release );
+	return true;
+}
+
+
+CCameraComponentSample::CCameraComponentSample( ICameraFrameSource *pSource )
+	: m_pSource( pSource )
+	, m_bInitialized( false )
+	, m_eStreamFormat( vr::CVS_FORMAT_RGB24 )
+	, m_eCompatibilityMode( vr::CAMERA_COMPAT_MODE_BULK_DEFAULT )
+	, m_unBufferSize( 0 )
+	, m_unFreeMask( 0 )
+	, m_pSinkCallback( nullptr )
+	, m_pCaptureThread( nullptr )
+	, m_bStreaming( false )
+	, m_bPaused( false )
+	, m_unFrameSequence( 0 )
+	, m_flLastFrameTime( 0.0 )
+	, m_ulFramesCaptured( 0 )
+	, m_ulFramesDelivered( 0 )
+	, m_ulFramesDropped( 0 )
+	, m_ulFramesSkipped( 0 )
+{
+	memset( &m_config, 0, sizeof( m_config ) );
+	memset( m_rgFrames, 0, sizeof( m_rgFrames ) );
+}
+
+
+CCameraComponentSample::~CCameraComponentSample()
+{
+	Shutdown();
+}
+
+
+bool CCameraComponentSample::Init( const Config_t &config )
+{
+	StopVideoStream();
+
+	m_config = config;
+	m_bInitialized = m_pSource && m_pSource->Open( config.unWidth, config.unHeight, config.unFrameRate );
+	if ( !m_bInitialized )
+		return false;
+
+	m_config.unWidth = m_pSource->GetWidth();
+	m_config.unHeight = m_pSource->GetHeight();
+
+	// buffers sized for the old dimensions are no use any more
+	if ( m_unBufferSize < FrameDataSize( m_eStreamFormat ) )
+	{
+		m_vecBuffers.clear();
+		m_vecOwnedStorage.clear();
+		m_unBufferSize = 0;
+	}
+	return true;
+}
+
+
+void CCameraComponentSample::Shutdown()
+{
+	StopVideoStream();
+	if ( m_bInitialized )
+	{
+		m_pSource->Close();
+		m_bInitialized = false;
+	}
+}
+
+
+CameraComponentStats_t CCameraComponentSample::GetStats() const
+{
+	CameraComponentStats_t stats;
+	stats.ulFramesCaptured = m_ulFramesCaptured;
+	stats.ulFramesDelivered = m_ulFramesDelivered;
+	stats.ulFramesDropped = m_ulFramesDropped;
+	stats.ulFramesSkipped = m_ulFramesSkipped;
+	return stats;
+}
+
+
+uint32_t CCameraComponentSample::BytesPerPixel( vr::ECameraVideoStreamFormat eFormat ) const
+{
+	switch ( eFormat )
+	{
+	case vr::CVS_FORMAT_RGB24:
+		return 3;
+	case vr::CVS_FORMAT_YUYV16:
+		return 2;
+	default:
+		return 0;
+	}
+}
+
+
+uint32_t CCameraComponentSample::FrameDataSize( vr::ECameraVideoStreamFormat eFormat ) const
+{
+	return m_config.unWidth * m_config.unHeight * BytesPerPixel( eFormat );
+}
+
+
+bool CCameraComponentSample::AcquireFreeBuffer( uint32_t *punIndex )
+{
+	uint32_t unMask = m_unFreeMask.load( std::memory_order_acquire );
+	while ( unMask != 0 )
+	{
+		uint32_t unIndex = 0;
+		while ( !( unMask & ( 1u << unIndex ) ) )
+		{
+			unIndex++;
+		}
+
+		if ( m_unFreeMask.compare_exchange_weak( unMask, unMask & ~( 1u << unIndex ), std::memory_order_acq_rel ) )
+		{
+			*punIndex = unIndex;
+			return true;
+		}
+	}
+	return false;
+}
+
+
+void CCameraComponentSample::ReturnBuffer( uint32_t unIndex )
+{
+	m_unFreeMask.fetch_or( 1u << unIndex, std::memory_order_release );
+}
+
+
+double CCameraComponentSample::ElapsedSeconds() const
+{
+	return std::chrono::duration<double>( std::chrono::steady_clock::now() - m_streamStart ).count();
+}
+
+
+bool CCameraComponentSample::GetCameraFrameDimensions( vr::ECameraVideoStreamFormat nVideoStreamFormat, uint32_t *pWidth, uint32_t *pHeight )
+{
+	if ( !m_bInitialized || BytesPerPixel( nVideoStreamFormat ) == 0 )
+		return false;
+
+	*pWidth = m_config.unWidth;
+	*pHeight = m_config.unHeight;
+	return true;
+}
+
+
+bool CCameraComponentSample::GetCameraFrameBufferingRequirements( int *pDefaultFrameQueueSize, uint32_t *pFrameBufferDataSize )
+{
+	if ( !m_bInitialized )
+		return false;
+
+	*pDefaultFrameQueueSize = k_nDefaultFrameQueueSize;
+	*pFrameBufferDataSize = FrameDataSize( m_eStreamFormat );
+	return true;
+}
+
+
+bool CCameraComponentSample::SetCameraFrameBuffering( int nFrameBufferCount, void **ppFrameBuffers, uint32_t nFrameBufferDataSize )
+{
+	if ( !m_bInitialized || m_bStreaming )
+		return false;
+
+	if ( nFrameBufferCount <= 0 || nFrameBufferCount > (int)k_unMaxFrameBuffers || !ppFrameBuffers )
+		return false;
+
+	if ( nFrameBufferDataSize < FrameDataSize( m_eStreamFormat ) )
+		return false;
+
+	for ( int i = 0; i < nFrameBufferCount; i++ )
+	{
+		if ( !ppFrameBuffers[ i ] )
+			return false;
+	}
+
+	m_vecOwnedStorage.clear();
+	m_vecBuffers.assign( (uint8_t **)ppFrameBuffers, (uint8_t **)ppFrameBuffers + nFrameBufferCount );
+	m_unBufferSize = nFrameBufferDataSize;
+	return true;
+}
+
+
+bool CCameraComponentSample::SetCameraVideoStreamFormat( vr::ECameraVideoStreamFormat nVideoStreamFormat )
+{
+	if ( m_bStreaming || BytesPerPixel( nVideoStreamFormat ) == 0 )
+		return false;
+
+	// existing buffers have to be big enough for the new format
+	if ( !m_vecBuffers.empty() && m_unBufferSize < FrameDataSize( nVideoStreamFormat ) )
+		return false;
+
+	m_eStreamFormat = nVideoStreamFormat;
+	return true;
+}
+
+
+vr::ECameraVideoStreamFormat CCameraComponentSample::GetCameraVideoStreamFormat()
+{
+	return m_eStreamFormat;
+}
+
+
+bool CCameraComponentSample::StartVideoStream()
+{
+	if ( !m_bInitialized )
+		return false;
+
+	if ( m_bStreaming )
+		return true;
+
+	if ( m_vecBuffers.empty() )
+	{
+		m_unBufferSize = FrameDataSize( m_eStreamFormat );
+		m_vecOwnedStorage.resize( (size_t)m_unBufferSize * k_nDefaultFrameQueueSize );
+		for ( int i = 0; i < k_nDefaultFrameQueueSize; i++ )
+		{
+			m_vecBuffers.push_back( &m_vecOwnedStorage[ (size_t)m_unBufferSize * i ] );
+		}
+	}
+
+	m_filledRing.Reset();
+	m_unFreeMask = m_vecBuffers.size() >= 32 ? 0xffffffffu : ( 1u << m_vecBuffers.size() ) - 1;
+	m_unFrameSequence = 0;
+	m_flLastFrameTime = 0.0;
+	m_bPaused = false;
+	m_streamStart = std::chrono::steady_clock::now();
+
+	m_bStreaming = true;
+	m_pCaptureThread = new std::thread( &CCameraComponentSample::CaptureThread, this );
+	return true;
+}
+
+
+void CCameraComponentSample::StopVideoStream()
+{
+	if ( !m_pCaptureThread )
+		return;
+
+	m_bStreaming = false;
+	m_pCaptureThread->join();
+	delete m_pCaptureThread;
+	m_pCaptureThread = nullptr;
+}
+
+
+bool CCameraComponentSample::IsVideoStreamActive( bool *pbPaused, float *pflElapsedTime )
+{
+	bool bStreaming = m_bStreaming;
+	if ( pbPaused )
+		*pbPaused = bStreaming && m_bPaused;
+	if ( pflElapsedTime )
+		*pflElapsedTime = bStreaming ? (float)ElapsedSeconds() : 0.f;
+	return bStreaming;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Hands out the newest filled frame. Anything older that vrserver
+//			never picked up goes straight back to the free list. Must only be
+//			called from one thread at a time.
+//-----------------------------------------------------------------------------
+const vr::CameraVideoStreamFrame_t *CCameraComponentSample::GetVideoStreamFrame()
+{
+	uint32_t unNewest = 0;
+	bool bHaveFrame = false;
+
+	uint32_t unIndex;
+	while ( m_filledRing.Pop( &unIndex ) )
+	{
+		if ( bHaveFrame )
+		{
+			ReturnBuffer( unNewest );
+			m_ulFramesSkipped++;
+		}
+		unNewest = unIndex;
+		bHaveFrame = true;
+	}
+
+	if ( !bHaveFrame )
+		return nullptr;
+
+	m_ulFramesDelivered++;
+	return &m_rgFrames[ unNewest ];
+}
+
+
+void CCameraComponentSample::ReleaseVideoStreamFrame( const vr::CameraVideoStreamFrame_t *pFrameImage )
+{
+	if ( !pFrameImage || pFrameImage->m_nBufferIndex >= k_unMaxFrameBuffers || pFrameImage != &m_rgFrames[ pFrameImage->m_nBufferIndex ] )
+		return;
+
+	ReturnBuffer( pFrameImage->m_nBufferIndex );
+}
+
+
+bool CCameraComponentSample::SetAutoExposure( bool )
+{
+	// neither source exposes exposure control
+	return false;
+}
+
+
+bool CCameraComponentSample::PauseVideoStream()
+{
+	if ( !m_bStreaming )
+		return false;
+	m_bPaused = true;
+	return true;
+}
+
+
+bool CCameraComponentSample::ResumeVideoStream()
+{
+	if ( !m_bStreaming )
+		return false;
+	m_bPaused = false;
+	return true;
+}
+
+
+bool CCameraComponentSample::GetCameraDistortion( uint32_t nCameraIndex, float flInputU, float flInputV, float *pflOutputU, float *pflOutputV )
+{
+	if ( nCameraIndex != 0 )
+		return false;
+
+	// the sample camera is an ideal pinhole
+	*pflOutputU = flInputU;
+	*pflOutputV = flInputV;
+	return true;
+}
+
+
+bool CCameraComponentSample::GetCameraProjection( uint32_t nCameraIndex, vr::EVRTrackedCameraFrameType, float flZNear, float flZFar, vr::HmdMatrix44_t *pProjection )
+{
+	if ( nCameraIndex != 0 || !m_bInitialized || flZNear == flZFar )
+		return false;
+
+	float flTanX = tanf( m_config.flHorizontalFOV * 0.5f * 3.14159265f / 180.f );
+	float flTanY = flTanX * m_config.unHeight / m_config.unWidth;
+
+	memset( pProjection, 0, sizeof( *pProjection ) );
+	pProjection->m[ 0 ][ 0 ] = 1.f / flTanX;
+	pProjection->m[ 1 ][ 1 ] = 1.f / flTanY;
+	pProjection->m[ 2 ][ 2 ] = flZFar / ( flZNear - flZFar );
+	pProjection->m[ 2 ][ 3 ] = flZFar * flZNear / ( flZNear - flZFar );
+	pProjection->m[ 3 ][ 2 ] = -1.f;
+	return true;
+}
+
+
+bool CCameraComponentSample::SetFrameRate( int, int nSensorFrameRate )
+{
+	if ( m_bStreaming || nSensorFrameRate <= 0 )
+		return false;
+
+	// the source picks the rate up when it is reopened
+	Config_t config = m_config;
+	config.unFrameRate = (uint32_t)nSensorFrameRate;
+	return Init( config );
+}
+
+
+bool CCameraComponentSample::SetCameraVideoSinkCallback( vr::ICameraVideoSinkCallback *pCameraVideoSinkCallback )
+{
+	m_pSinkCallback = pCameraVideoSinkCallback;
+	return true;
+}
+
+
+bool CCameraComponentSample::GetCameraCompatibilityMode( vr::ECameraCompatibilityMode *pCameraCompatibilityMode )
+{
+	*pCameraCompatibilityMode = m_eCompatibilityMode;
+	return true;
+}
+
+
+bool CCameraComponentSample::SetCameraCompatibilityMode( vr::ECameraCompatibilityMode nCameraCompatibilityMode )
+{
+	// there is no USB transport to reconfigure, so just remember it
+	m_eCompatibilityMode = nCameraCompatibilityMode;
+	return true;
+}
+
+
+bool CCameraComponentSample::GetCameraFrameBounds( vr::EVRTrackedCameraFrameType, uint32_t *pLeft, uint32_t *pTop, uint32_t *pWidth, uint32_t *pHeight )
+{
+	if ( !m_bInitialized )
+		return false;
+
+	*pLeft = 0;
+	*pTop = 0;
+	*pWidth = m_config.unWidth;
+	*pHeight = m_config.unHeight;
+	return true;
+}
+
+
+bool CCameraComponentSample::GetCameraIntrinsics( uint32_t nCameraIndex, vr::EVRTrackedCameraFrameType, vr::HmdVector2_t *pFocalLength, vr::HmdVector2_t *pCenter, vr::EVRDistortionFunctionType *peDistortionType, double rCoefficients[ vr::k_unMaxDistortionFunctionParameters ] )
+{
+	if ( nCameraIndex != 0 || !m_bInitialized )
+		return false;
+
+	float flFocal = ( m_config.unWidth * 0.5f ) / tanf( m_config.flHorizontalFOV * 0.5f * 3.14159265f / 180.f );
+	pFocalLength->v[ 0 ] = flFocal;
+	pFocalLength->v[ 1 ] = flFocal;
+	pCenter->v[ 0 ] = m_config.unWidth * 0.5f;
+	pCenter->v[ 1 ] = m_config.unHeight * 0.5f;
+	*peDistortionType = vr::VRDistortionFunctionType_None;
+	for ( uint32_t i = 0; i < vr::k_unMaxDistortionFunctionParameters; i++ )
+	{
+		rCoefficients[ i ] = 0.0;
+	}
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Pulls frames from the source and converts each one directly into
+//			a free frame buffer. With no free buffer the frame is dropped
+//			rather than making the device wait.
+//-----------------------------------------------------------------------------
+void CCameraComponentSample::CaptureThread()
+{
+	const uint32_t unSourceSize = m_config.unWidth * m_config.unHeight * 2;
+	const uint32_t unFrameSize = FrameDataSize( m_eStreamFormat );
+
+	// sources stamp frames in absolute steady clock seconds; vrserver wants them on the stream's timeline
+	const double flStreamStart = std::chrono::duration<double>( m_streamStart.time_since_epoch() ).count();
+
+	while ( m_bStreaming )
+	{
+		CameraSourceFrame_t sourceFrame;
+		if ( !m_pSource->WaitFrame( k_unCaptureTimeoutMs, &sourceFrame ) )
+			continue;
+
+		m_ulFramesCaptured++;
+
+		uint32_t unIndex;
+		if ( m_bPaused || sourceFrame.unDataSize < unSourceSize || !AcquireFreeBuffer( &unIndex ) )
+		{
+			if ( !m_bPaused )
+				m_ulFramesDropped++;
+			m_pSource->ReleaseFrame( sourceFrame );
+			continue;
+		}
+
+		uint8_t *pBuffer = m_vecBuffers[ unIndex ];
+		if ( m_eStreamFormat == vr::CVS_FORMAT_RGB24 )
+			ConvertYUYVToRGB24( sourceFrame.pData, pBuffer, m_config.unWidth, m_config.unHeight );
+		else
+			memcpy( pBuffer, sourceFrame.pData, unSourceSize );
+		m_pSource->ReleaseFrame( sourceFrame );
+
+		double flNow = ElapsedSeconds();
+		vr::CameraVideoStreamFrame_t &frame = m_rgFrames[ unIndex ];
+		memset( &frame, 0, sizeof( frame ) );
+		frame.m_nStreamFormat = m_eStreamFormat;
+		frame.m_nWidth = m_config.unWidth;
+		frame.m_nHeight = m_config.unHeight;
+		frame.m_nImageDataSize = unFrameSize;
+		frame.m_nFrameSequence = m_unFrameSequence++;
+		frame.m_nBufferIndex = unIndex;
+		frame.m_nBufferCount = (uint32_t)m_vecBuffers.size();
+		frame.m_flFrameElapsedTime = flNow;
+		frame.m_flFrameDeliveryRate = m_flLastFrameTime > 0.0 && flNow > m_flLastFrameTime ? 1.0 / ( flNow - m_flLastFrameTime ) : 0.0;
+		frame.m_flFrameCaptureTime_DriverAbsolute = sourceFrame.flCaptureTime;
+		frame.m_flFrameCaptureTime_ServerRelative = sourceFrame.flCaptureTime - flStreamStart;
+		frame.m_nFrameCaptureTicks_ServerAbsolute = (uint64_t)( sourceFrame.flCaptureTime * 1e9 );
+		frame.m_pImageData = (uint64_t)(uintptr_t)pBuffer;
+		m_flLastFrameTime = flNow;
+
+		// the ring holds every buffer index, so this only fails if a buffer was released twice
+		if ( !m_filledRing.Push( unIndex ) )
+		{
+			ReturnBuffer( unIndex );
+			continue;
+		}
+
+		vr::ICameraVideoSinkCallback *pCallback = m_pSinkCallback;
+		if ( pCallback )
+			pCallback->OnCameraVideoSinkCallback();
+	}
+}
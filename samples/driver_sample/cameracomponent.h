@@ -0,0 +1,138 @@
+//========= Copyright Valve Corporation ============//
+
+#ifndef CAMERACOMPONENT_H
+#define CAMERACOMPONENT_H
+
+#pragma once
+
+#include <openvr_driver.h>
+
+#include "camerasource.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+struct CameraComponentStats_t
+{
+	uint64_t ulFramesCaptured;		// frames read from the source while streaming
+	uint64_t ulFramesDelivered;		// frames returned from GetVideoStreamFrame
+	uint64_t ulFramesDropped;		// every buffer was filled or held by vrserver when the frame arrived
+	uint64_t ulFramesSkipped;		// filled but replaced by a newer frame before anyone asked for it
+};
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Reference IVRCameraComponent. A capture thread pulls YUYV frames
+//			from an ICameraFrameSource and converts them straight into the
+//			frame buffers vrserver handed over in SetCameraFrameBuffering, so a
+//			frame is touched once between the device and the consumer.
+//
+//			Buffer ownership moves through two lock-free structures: a bitmask
+//			of free buffers, which any thread may return buffers to, and a
+//			single producer / single consumer ring of filled buffers that
+//			GetVideoStreamFrame drains to the newest entry. The video sink
+//			callback is signalled after every filled frame.
+//-----------------------------------------------------------------------------
+class CCameraComponentSample : public vr::IVRCameraComponent
+{
+public:
+	struct Config_t
+	{
+		uint32_t unWidth;
+		uint32_t unHeight;
+		uint32_t unFrameRate;
+		float flHorizontalFOV;		// degrees, used for the pinhole intrinsics
+	};
+
+	/** pSource must outlive the component */
+	explicit CCameraComponentSample( ICameraFrameSource *pSource );
+	virtual ~CCameraComponentSample();
+
+	/** opens the source. The source may pick different dimensions than the config asks for. */
+	bool Init( const Config_t &config );
+	void Shutdown();
+
+	CameraComponentStats_t GetStats() const;
+
+	// IVRCameraComponent
+	virtual bool GetCameraFrameDimensions( vr::ECameraVideoStreamFormat nVideoStreamFormat, uint32_t *pWidth, uint32_t *pHeight );
+	virtual bool GetCameraFrameBufferingRequirements( int *pDefaultFrameQueueSize, uint32_t *pFrameBufferDataSize );
+	virtual bool SetCameraFrameBuffering( int nFrameBufferCount, void **ppFrameBuffers, uint32_t nFrameBufferDataSize );
+	virtual bool SetCameraVideoStreamFormat( vr::ECameraVideoStreamFormat nVideoStreamFormat );
+	virtual vr::ECameraVideoStreamFormat GetCameraVideoStreamFormat();
+	virtual bool StartVideoStream();
+	virtual void StopVideoStream();
+	virtual bool IsVideoStreamActive( bool *pbPaused, float *pflElapsedTime );
+	virtual const vr::CameraVideoStreamFrame_t *GetVideoStreamFrame();
+	virtual void ReleaseVideoStreamFrame( const vr::CameraVideoStreamFrame_t *pFrameImage );
+	virtual bool SetAutoExposure( bool bEnable );
+	virtual bool PauseVideoStream();
+	virtual bool ResumeVideoStream();
+	virtual bool GetCameraDistortion( uint32_t nCameraIndex, float flInputU, float flInputV, float *pflOutputU, float *pflOutputV );
+	virtual bool GetCameraProjection( uint32_t nCameraIndex, vr::EVRTrackedCameraFrameType eFrameType, float flZNear, float flZFar, vr::HmdMatrix44_t *pProjection );
+	virtual bool SetFrameRate( int nISPFrameRate, int nSensorFrameRate );
+	virtual bool SetCameraVideoSinkCallback( vr::ICameraVideoSinkCallback *pCameraVideoSinkCallback );
+	virtual bool GetCameraCompatibilityMode( vr::ECameraCompatibilityMode *pCameraCompatibilityMode );
+	virtual bool SetCameraCompatibilityMode( vr::ECameraCompatibilityMode nCameraCompatibilityMode );
+	virtual bool GetCameraFrameBounds( vr::EVRTrackedCameraFrameType eFrameType, uint32_t *pLeft, uint32_t *pTop, uint32_t *pWidth, uint32_t *pHeight );
+	virtual bool GetCameraIntrinsics( uint32_t nCameraIndex, vr::EVRTrackedCameraFrameType eFrameType, vr::HmdVector2_t *pFocalLength, vr::HmdVector2_t *pCenter, vr::EVRDistortionFunctionType *peDistortionType, double rCoefficients[ vr::k_unMaxDistortionFunctionParameters ] );
+
+	static const uint32_t k_unMaxFrameBuffers = 16;
+	static const int k_nDefaultFrameQueueSize = 4;
+
+private:
+	// single producer / single consumer ring of buffer indices
+	class CIndexRing
+	{
+	public:
+		CIndexRing() : m_unHead( 0 ), m_unTail( 0 ) {}
+		bool Push( uint32_t unIndex );
+		bool Pop( uint32_t *punIndex );
+		void Reset() { m_unHead = 0; m_unTail = 0; }
+	private:
+		static const uint32_t k_unSize = k_unMaxFrameBuffers;	// holds every buffer, so Push never fails
+		uint32_t m_rgIndices[ k_unSize ];
+		std::atomic<uint32_t> m_unHead;
+		std::atomic<uint32_t> m_unTail;
+	};
+
+	uint32_t BytesPerPixel( vr::ECameraVideoStreamFormat eFormat ) const;
+	uint32_t FrameDataSize( vr::ECameraVideoStreamFormat eFormat ) const;
+	bool AcquireFreeBuffer( uint32_t *punIndex );
+	void ReturnBuffer( uint32_t unIndex );
+	double ElapsedSeconds() const;
+	void CaptureThread();
+
+	ICameraFrameSource *m_pSource;
+	Config_t m_config;
+	bool m_bInitialized;
+	vr::ECameraVideoStreamFormat m_eStreamFormat;
+	vr::ECameraCompatibilityMode m_eCompatibilityMode;
+
+	// frame buffers are either vrserver's or, if it never set any, our own
+	std::vector<uint8_t *> m_vecBuffers;
+	std::vector<uint8_t> m_vecOwnedStorage;
+	uint32_t m_unBufferSize;
+	vr::CameraVideoStreamFrame_t m_rgFrames[ k_unMaxFrameBuffers ];
+
+	std::atomic<uint32_t> m_unFreeMask;
+	CIndexRing m_filledRing;
+	std::atomic<vr::ICameraVideoSinkCallback *> m_pSinkCallback;
+
+	std::thread *m_pCaptureThread;
+	std::atomic<bool> m_bStreaming;
+	std::atomic<bool> m_bPaused;
+	std::chrono::steady_clock::time_point m_streamStart;
+	uint32_t m_unFrameSequence;
+	double m_flLastFrameTime;
+
+	std::atomic<uint64_t> m_ulFramesCaptured;
+	std::atomic<uint64_t> m_ulFramesDelivered;
+	std::atomic<uint64_t> m_ulFramesDropped;
+	std::atomic<uint64_t> m_ulFramesSkipped;
+};
+
+
+#endif // CAMERACOMPONENT_H
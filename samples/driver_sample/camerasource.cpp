@@ -0,0 +1,456 @@
+//========= Copyright Valve Corporation ============//
+
+#include "camerasource.h"
+
+#include <string.h>
+
+#include <thread>
+
+#if defined( __linux__ )
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/videodev2.h>
+#endif
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#include <emmintrin.h>
+#define CAMERASOURCE_SSE2 1
+#endif
+
+static double SteadySeconds( std::chrono::steady_clock::time_point time )
+{
+	return std::chrono::duration<double>( time.time_since_epoch() ).count();
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Full-range BT.601 in 6 bit fixed point. The SSE2 path uses the
+//			same arithmetic so both produce identical output.
+//-----------------------------------------------------------------------------
+static inline uint8_t ClampToByte( int n )
+{
+	return (uint8_t)( n < 0 ? 0 : ( n > 255 ? 255 : n ) );
+}
+
+static inline void ConvertYUVPixel( int y, int u, int v, uint8_t *pRGB )
+{
+	pRGB[ 0 ] = ClampToByte( y + ( ( v * 90 + 32 ) >> 6 ) );
+	pRGB[ 1 ] = ClampToByte( y - ( ( u * 22 + v * 46 + 32 ) >> 6 ) );
+	pRGB[ 2 ] = ClampToByte( y + ( ( u * 113 + 32 ) >> 6 ) );
+}
+
+#if defined( CAMERASOURCE_SSE2 )
+// converts 8 pixels (16 bytes of YUYV) to R, G and B as 16 bit lanes
+static inline void ConvertYUYV8( __m128i yuyv, __m128i *pR, __m128i *pG, __m128i *pB )
+{
+	const __m128i offset = _mm_set1_epi16( 128 );
+	const __m128i round = _mm_set1_epi16( 32 );
+
+	__m128i y = _mm_and_si128( yuyv, _mm_set1_epi16( 0x00ff ) );
+	__m128i uv = _mm_sub_epi16( _mm_srli_epi16( yuyv, 8 ), offset );
+
+	// uv is U0 V0 U1 V1 ..., spread each chroma sample over its two pixels
+	__m128i u = _mm_shufflehi_epi16( _mm_shufflelo_epi16( uv, _MM_SHUFFLE( 2, 2, 0, 0 ) ), _MM_SHUFFLE( 2, 2, 0, 0 ) );
+	__m128i v = _mm_shufflehi_epi16( _mm_shufflelo_epi16( uv, _MM_SHUFFLE( 3, 3, 1, 1 ) ), _MM_SHUFFLE( 3, 3, 1, 1 ) );
+
+	__m128i rv = _mm_srai_epi16( _mm_add_epi16( _mm_mullo_epi16( v, _mm_set1_epi16( 90 ) ), round ), 6 );
+	__m128i guv = _mm_srai_epi16( _mm_add_epi16( _mm_add_epi16( _mm_mullo_epi16( u, _mm_set1_epi16( 22 ) ), _mm_mullo_epi16( v, _mm_set1_epi16( 46 ) ) ), round ), 6 );
+	__m128i bu = _mm_srai_epi16( _mm_add_epi16( _mm_mullo_epi16( u, _mm_set1_epi16( 113 ) ), round ), 6 );
+
+	*pR = _mm_add_epi16( y, rv );
+	*pG = _mm_sub_epi16( y, guv );
+	*pB = _mm_add_epi16( y, bu );
+}
+
+// writes 4 RGBX pixels as 12 bytes of RGB. Each store is 4 bytes wide, so one byte past the end is touched.
+static inline void StoreRGBX4( __m128i rgbx, uint8_t *pRGB )
+{
+	for ( int i = 0; i < 4; i++ )
+	{
+		uint32_t unPixel = (uint32_t)_mm_cvtsi128_si32( rgbx );
+		memcpy( pRGB + i * 3, &unPixel, sizeof( unPixel ) );
+		rgbx = _mm_srli_si128( rgbx, 4 );
+	}
+}
+#endif
+
+
+void ConvertYUYVToRGB24( const uint8_t *pYUYV, uint8_t *pRGB, uint32_t unWidth, uint32_t unHeight )
+{
+	// YUYV has no padding between rows, so the image is one run of pixel pairs
+	size_t unPixels = (size_t)unWidth * unHeight;
+	size_t i = 0;
+
+#if defined( CAMERASOURCE_SSE2 )
+	// the stores overrun by one byte, which the next block overwrites, so stop a pixel early
+	const __m128i zero = _mm_setzero_si128();
+	for ( ; i + 16 < unPixels; i += 16 )
+	{
+		__m128i r0, g0, b0, r1, g1, b1;
+		ConvertYUYV8( _mm_loadu_si128( (const __m128i *)( pYUYV + i * 2 ) ), &r0, &g0, &b0 );
+		ConvertYUYV8( _mm_loadu_si128( (const __m128i *)( pYUYV + i * 2 + 16 ) ), &r1, &g1, &b1 );
+
+		__m128i r = _mm_packus_epi16( r0, r1 );
+		__m128i g = _mm_packus_epi16( g0, g1 );
+		__m128i b = _mm_packus_epi16( b0, b1 );
+
+		__m128i rgLo = _mm_unpacklo_epi8( r, g );
+		__m128i rgHi = _mm_unpackhi_epi8( r, g );
+		__m128i bxLo = _mm_unpacklo_epi8( b, zero );
+		__m128i bxHi = _mm_unpackhi_epi8( b, zero );
+
+		uint8_t *pOut = pRGB + i * 3;
+		StoreRGBX4( _mm_unpacklo_epi16( rgLo, bxLo ), pOut );
+		StoreRGBX4( _mm_unpackhi_epi16( rgLo, bxLo ), pOut + 12 );
+		StoreRGBX4( _mm_unpacklo_epi16( rgHi, bxHi ), pOut + 24 );
+		StoreRGBX4( _mm_unpackhi_epi16( rgHi, bxHi ), pOut + 36 );
+	}
+#endif
+
+	for ( ; i + 1 < unPixels; i += 2 )
+	{
+		const uint8_t *pIn = pYUYV + i * 2;
+		int u = pIn[ 1 ] - 128;
+		int v = pIn[ 3 ] - 128;
+		ConvertYUVPixel( pIn[ 0 ], u, v, pRGB + i * 3 );
+		ConvertYUVPixel( pIn[ 2 ], u, v, pRGB + i * 3 + 3 );
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Synthetic / replay source
+//-----------------------------------------------------------------------------
+CSyntheticCameraSource::CSyntheticCameraSource( const char *pchReplayFile )
+	: m_sReplayFile( pchReplayFile ? pchReplayFile : "" )
+	, m_pReplayFile( nullptr )
+	, m_unWidth( 0 )
+	, m_unHeight( 0 )
+	, m_unFrameCount( 0 )
+{
+}
+
+
+CSyntheticCameraSource::~CSyntheticCameraSource()
+{
+	Close();
+}
+
+
+bool CSyntheticCameraSource::Open( uint32_t unWidth, uint32_t unHeight, uint32_t unFrameRate )
+{
+	Close();
+
+	if ( unWidth == 0 || unHeight == 0 || ( unWidth & 1 ) || unFrameRate == 0 )
+		return false;
+
+	if ( !m_sReplayFile.empty() )
+	{
+		m_pReplayFile = fopen( m_sReplayFile.c_str(), "rb" );
+		if ( !m_pReplayFile )
+			return false;
+	}
+
+	m_unWidth = unWidth;
+	m_unHeight = unHeight;
+	m_framePeriod = std::chrono::duration_cast<std::chrono::steady_clock::duration>( std::chrono::duration<double>( 1.0 / unFrameRate ) );
+	m_nextFrame = std::chrono::steady_clock::now();
+	m_unFrameCount = 0;
+	m_vecFrame.resize( (size_t)unWidth * unHeight * 2 );
+	return true;
+}
+
+
+void CSyntheticCameraSource::Close()
+{
+	if ( m_pReplayFile )
+	{
+		fclose( m_pReplayFile );
+		m_pReplayFile = nullptr;
+	}
+	m_unWidth = 0;
+	m_unHeight = 0;
+}
+
+
+bool CSyntheticCameraSource::WaitFrame( uint32_t unTimeoutMs, CameraSourceFrame_t *pFrame )
+{
+	if ( m_vecFrame.empty() || m_unWidth == 0 )
+		return false;
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if ( m_nextFrame > now + std::chrono::milliseconds( unTimeoutMs ) )
+	{
+		std::this_thread::sleep_for( std::chrono::milliseconds( unTimeoutMs ) );
+		return false;
+	}
+	std::this_thread::sleep_until( m_nextFrame );
+
+	std::chrono::steady_clock::time_point captureTime = m_nextFrame;
+	m_nextFrame += m_framePeriod;
+
+	// don't try to catch up after a stall, just start pacing again from here
+	now = std::chrono::steady_clock::now();
+	if ( m_nextFrame < now )
+		m_nextFrame = now + m_framePeriod;
+
+	if ( m_pReplayFile )
+	{
+		if ( fread( &m_vecFrame[ 0 ], m_vecFrame.size(), 1, m_pReplayFile ) != 1 )
+		{
+			// loop back to the start, and give up if the file doesn't hold a single frame
+			rewind( m_pReplayFile );
+			if ( fread( &m_vecFrame[ 0 ], m_vecFrame.size(), 1, m_pReplayFile ) != 1 )
+				return false;
+		}
+	}
+	else
+	{
+		GeneratePattern();
+	}
+
+	pFrame->pData = &m_vecFrame[ 0 ];
+	pFrame->unDataSize = (uint32_t)m_vecFrame.size();
+	pFrame->unIndex = 0;
+	pFrame->flCaptureTime = SteadySeconds( captureTime );
+	m_unFrameCount++;
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Vertical color bars scrolling sideways over a luma ramp
+//-----------------------------------------------------------------------------
+void CSyntheticCameraSource::GeneratePattern()
+{
+	static const uint8_t k_rgBarU[ 8 ] = { 128, 16, 166, 54, 202, 90, 240, 128 };
+	static const uint8_t k_rgBarV[ 8 ] = { 128, 146, 16, 34, 222, 240, 110, 128 };
+
+	uint32_t unBarWidth = m_unWidth / 8 > 0 ? m_unWidth / 8 : 1;
+	uint32_t unScroll = m_unFrameCount * 4;
+
+	for ( uint32_t y = 0; y < m_unHeight; y++ )
+	{
+		uint8_t *pRow = &m_vecFrame[ (size_t)y * m_unWidth * 2 ];
+		uint8_t unLuma = (uint8_t)( 16 + ( y * 219 ) / m_unHeight );
+		for ( uint32_t x = 0; x < m_unWidth; x += 2 )
+		{
+			uint32_t unBar = ( ( x + unScroll ) / unBarWidth ) % 8;
+			pRow[ x * 2 + 0 ] = unLuma;
+			pRow[ x * 2 + 1 ] = k_rgBarU[ unBar ];
+			pRow[ x * 2 + 2 ] = unLuma;
+			pRow[ x * 2 + 3 ] = k_rgBarV[ unBar ];
+		}
+	}
+}
+
+
+#if defined( __linux__ )
+//-----------------------------------------------------------------------------
+// Purpose: V4L2 source
+//-----------------------------------------------------------------------------
+static const uint32_t k_unV4L2BufferCount = 4;
+
+static int xioctl( int nFd, unsigned long ulRequest, void *pArg )
+{
+	int nResult;
+	do
+	{
+		nResult = ioctl( nFd, ulRequest, pArg );
+	} while ( nResult == -1 && errno == EINTR );
+	return nResult;
+}
+
+
+CV4L2CameraSource::CV4L2CameraSource( const char *pchDevice )
+	: m_sDevice( pchDevice ? pchDevice : "" )
+	, m_nFd( -1 )
+	, m_unWidth( 0 )
+	, m_unHeight( 0 )
+	, m_bStreaming( false )
+{
+}
+
+
+CV4L2CameraSource::~CV4L2CameraSource()
+{
+	Close();
+}
+
+
+bool CV4L2CameraSource::Open( uint32_t unWidth, uint32_t unHeight, uint32_t unFrameRate )
+{
+	Close();
+
+	m_nFd = open( m_sDevice.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC );
+	if ( m_nFd < 0 )
+		return false;
+
+	v4l2_capability caps;
+	memset( &caps, 0, sizeof( caps ) );
+	if ( xioctl( m_nFd, VIDIOC_QUERYCAP, &caps ) != 0
+		|| !( caps.capabilities & V4L2_CAP_VIDEO_CAPTURE )
+		|| !( caps.capabilities & V4L2_CAP_STREAMING ) )
+	{
+		Close();
+		return false;
+	}
+
+	v4l2_format format;
+	memset( &format, 0, sizeof( format ) );
+	format.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	format.fmt.pix.width = unWidth;
+	format.fmt.pix.height = unHeight;
+	format.fmt.pix.pixelformat = V4L2_PIX_FMT_YUYV;
+	format.fmt.pix.field = V4L2_FIELD_NONE;
+	if ( xioctl( m_nFd, VIDIOC_S_FMT, &format ) != 0
+		|| format.fmt.pix.pixelformat != V4L2_PIX_FMT_YUYV
+		|| format.fmt.pix.bytesperline != format.fmt.pix.width * 2 )
+	{
+		// the converters expect tightly packed rows
+		Close();
+		return false;
+	}
+	m_unWidth = format.fmt.pix.width;
+	m_unHeight = format.fmt.pix.height;
+
+	// not every device lets the rate be set, so this one is best effort
+	v4l2_streamparm parm;
+	memset( &parm, 0, sizeof( parm ) );
+	parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	parm.parm.capture.timeperframe.numerator = 1;
+	parm.parm.capture.timeperframe.denominator = unFrameRate;
+	xioctl( m_nFd, VIDIOC_S_PARM, &parm );
+
+	v4l2_requestbuffers request;
+	memset( &request, 0, sizeof( request ) );
+	request.count = k_unV4L2BufferCount;
+	request.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	request.memory = V4L2_MEMORY_MMAP;
+	if ( xioctl( m_nFd, VIDIOC_REQBUFS, &request ) != 0 || request.count == 0 )
+	{
+		Close();
+		return false;
+	}
+
+	for ( uint32_t i = 0; i < request.count; i++ )
+	{
+		v4l2_buffer buffer;
+		memset( &buffer, 0, sizeof( buffer ) );
+		buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		buffer.memory = V4L2_MEMORY_MMAP;
+		buffer.index = i;
+		if ( xioctl( m_nFd, VIDIOC_QUERYBUF, &buffer ) != 0 )
+		{
+			Close();
+			return false;
+		}
+
+		MappedBuffer_t mapped;
+		mapped.unLength = buffer.length;
+		mapped.pData = mmap( nullptr, buffer.length, PROT_READ | PROT_WRITE, MAP_SHARED, m_nFd, buffer.m.offset );
+		if ( mapped.pData == MAP_FAILED )
+		{
+			Close();
+			return false;
+		}
+		m_vecBuffers.push_back( mapped );
+
+		if ( xioctl( m_nFd, VIDIOC_QBUF, &buffer ) != 0 )
+		{
+			Close();
+			return false;
+		}
+	}
+
+	int nType = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	if ( xioctl( m_nFd, VIDIOC_STREAMON, &nType ) != 0 )
+	{
+		Close();
+		return false;
+	}
+	m_bStreaming = true;
+	return true;
+}
+
+
+void CV4L2CameraSource::Close()
+{
+	if ( m_nFd >= 0 && m_bStreaming )
+	{
+		int nType = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		xioctl( m_nFd, VIDIOC_STREAMOFF, &nType );
+	}
+	m_bStreaming = false;
+
+	for ( size_t i = 0; i < m_vecBuffers.size(); i++ )
+	{
+		munmap( m_vecBuffers[ i ].pData, m_vecBuffers[ i ].unLength );
+	}
+	m_vecBuffers.clear();
+
+	if ( m_nFd >= 0 )
+	{
+		close( m_nFd );
+		m_nFd = -1;
+	}
+	m_unWidth = 0;
+	m_unHeight = 0;
+}
+
+
+bool CV4L2CameraSource::WaitFrame( uint32_t unTimeoutMs, CameraSourceFrame_t *pFrame )
+{
+	if ( !m_bStreaming )
+		return false;
+
+	pollfd pfd;
+	pfd.fd = m_nFd;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	if ( poll( &pfd, 1, (int)unTimeoutMs ) <= 0 )
+		return false;
+
+	v4l2_buffer buffer;
+	memset( &buffer, 0, sizeof( buffer ) );
+	buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	buffer.memory = V4L2_MEMORY_MMAP;
+	if ( xioctl( m_nFd, VIDIOC_DQBUF, &buffer ) != 0 )
+		return false;
+
+	if ( buffer.index >= m_vecBuffers.size() || ( buffer.flags & V4L2_BUF_FLAG_ERROR ) )
+	{
+		xioctl( m_nFd, VIDIOC_QBUF, &buffer );
+		return false;
+	}
+
+	pFrame->pData = (const uint8_t *)m_vecBuffers[ buffer.index ].pData;
+	pFrame->unDataSize = buffer.bytesused;
+	pFrame->unIndex = buffer.index;
+
+	// steady_clock is CLOCK_MONOTONIC here, which is what V4L2 stamps frames with
+	if ( ( buffer.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK ) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC )
+		pFrame->flCaptureTime = buffer.timestamp.tv_sec + buffer.timestamp.tv_usec * 1e-6;
+	else
+		pFrame->flCaptureTime = SteadySeconds( std::chrono::steady_clock::now() );
+	return true;
+}
+
+
+void CV4L2CameraSource::ReleaseFrame( const CameraSourceFrame_t &frame )
+{
+	if ( !m_bStreaming )
+		return;
+
+	v4l2_buffer buffer;
+	memset( &buffer, 0, sizeof( buffer ) );
+	buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	buffer.memory = V4L2_MEMORY_MMAP;
+	buffer.index = frame.unIndex;
+	xioctl( m_nFd, VIDIOC_QBUF, &buffer );
+}
+#endif
@@ -0,0 +1,118 @@
+//========= Copyright Valve Corporation ============//
+
+#ifndef CAMERASOURCE_H
+#define CAMERASOURCE_H
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+/** One YUYV frame owned by a source, valid until it is handed back with ReleaseFrame */
+struct CameraSourceFrame_t
+{
+	const uint8_t *pData;
+	uint32_t unDataSize;
+	uint32_t unIndex;			// source specific buffer index
+	double flCaptureTime;		// seconds, steady clock
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Where camera frames come from. All sources deliver packed YUYV
+//			(4:2:2, 16 bits per pixel).
+//-----------------------------------------------------------------------------
+class ICameraFrameSource
+{
+public:
+	virtual ~ICameraFrameSource() {}
+
+	virtual bool Open( uint32_t unWidth, uint32_t unHeight, uint32_t unFrameRate ) = 0;
+	virtual void Close() = 0;
+
+	/** actual dimensions, which may differ from what Open asked for */
+	virtual uint32_t GetWidth() const = 0;
+	virtual uint32_t GetHeight() const = 0;
+
+	/** blocks up to unTimeoutMs for the next frame */
+	virtual bool WaitFrame( uint32_t unTimeoutMs, CameraSourceFrame_t *pFrame ) = 0;
+	virtual void ReleaseFrame( const CameraSourceFrame_t &frame ) = 0;
+};
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Generates a moving test pattern, or replays raw YUYV frames from a
+//			file when one is given. Paced to the requested frame rate.
+//-----------------------------------------------------------------------------
+class CSyntheticCameraSource : public ICameraFrameSource
+{
+public:
+	/** pchReplayFile, if set, is a headerless file of back-to-back YUYV frames at the opened size */
+	explicit CSyntheticCameraSource( const char *pchReplayFile = nullptr );
+	virtual ~CSyntheticCameraSource();
+
+	virtual bool Open( uint32_t unWidth, uint32_t unHeight, uint32_t unFrameRate );
+	virtual void Close();
+	virtual uint32_t GetWidth() const { return m_unWidth; }
+	virtual uint32_t GetHeight() const { return m_unHeight; }
+	virtual bool WaitFrame( uint32_t unTimeoutMs, CameraSourceFrame_t *pFrame );
+	virtual void ReleaseFrame( const CameraSourceFrame_t & ) {}
+
+private:
+	void GeneratePattern();
+
+	std::string m_sReplayFile;
+	FILE *m_pReplayFile;
+	uint32_t m_unWidth;
+	uint32_t m_unHeight;
+	std::chrono::steady_clock::duration m_framePeriod;
+	std::chrono::steady_clock::time_point m_nextFrame;
+	uint32_t m_unFrameCount;
+	std::vector<uint8_t> m_vecFrame;
+};
+
+
+#if defined( __linux__ )
+//-----------------------------------------------------------------------------
+// Purpose: Video4Linux2 capture device using memory-mapped driver buffers.
+//			Frames are read straight out of the mapped buffers and requeued on
+//			ReleaseFrame.
+//-----------------------------------------------------------------------------
+class CV4L2CameraSource : public ICameraFrameSource
+{
+public:
+	explicit CV4L2CameraSource( const char *pchDevice );
+	virtual ~CV4L2CameraSource();
+
+	virtual bool Open( uint32_t unWidth, uint32_t unHeight, uint32_t unFrameRate );
+	virtual void Close();
+	virtual uint32_t GetWidth() const { return m_unWidth; }
+	virtual uint32_t GetHeight() const { return m_unHeight; }
+	virtual bool WaitFrame( uint32_t unTimeoutMs, CameraSourceFrame_t *pFrame );
+	virtual void ReleaseFrame( const CameraSourceFrame_t &frame );
+
+private:
+	struct MappedBuffer_t
+	{
+		void *pData;
+		size_t unLength;
+	};
+
+	std::string m_sDevice;
+	int m_nFd;
+	uint32_t m_unWidth;
+	uint32_t m_unHeight;
+	bool m_bStreaming;
+	std::vector<MappedBuffer_t> m_vecBuffers;
+};
+#endif
+
+
+/** Converts full-range YUYV to packed RGB24. Uses SSE2 where available. */
+void ConvertYUYVToRGB24( const uint8_t *pYUYV, uint8_t *pRGB, uint32_t unWidth, uint32_t unHeight );
+
+
+#endif // CAMERASOURCE_H
@@ -0,0 +1,266 @@
+//========= Copyright Valve Corporation ============//
+
+#include "distortionmodel.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#include <emmintrin.h>
+#define DISTORTIONMODEL_SSE2 1
+#endif
+
+
+CDistortionModel::CDistortionModel()
+{
+	memset( &m_params, 0, sizeof( m_params ) );
+	m_params.flCenterU = 0.5f;
+	m_params.flCenterV = 0.5f;
+	for ( int c = 0; c < 3; c++ )
+	{
+		m_params.rgflChannelScale[ c ] = 1.f;
+	}
+}
+
+
+CDistortionModel::CDistortionModel( const DistortionModelParams_t &params )
+	: m_params( params )
+{
+}
+
+
+bool CDistortionModel::IsIdentity() const
+{
+	return m_params.rgflK[ 0 ] == 0.f && m_params.rgflK[ 1 ] == 0.f && m_params.rgflK[ 2 ] == 0.f
+		&& m_params.rgflChannelScale[ 0 ] == 1.f && m_params.rgflChannelScale[ 1 ] == 1.f && m_params.rgflChannelScale[ 2 ] == 1.f;
+}
+
+
+vr::DistortionCoordinates_t CDistortionModel::Evaluate( float flU, float flV ) const
+{
+	float flDU = flU - m_params.flCenterU;
+	float flDV = flV - m_params.flCenterV;
+	float flR2 = flDU * flDU + flDV * flDV;
+	float flRadial = 1.f + flR2 * ( m_params.rgflK[ 0 ] + flR2 * ( m_params.rgflK[ 1 ] + flR2 * m_params.rgflK[ 2 ] ) );
+
+	float *rgpOut[ 3 ];
+	vr::DistortionCoordinates_t coordinates;
+	rgpOut[ 0 ] = coordinates.rfRed;
+	rgpOut[ 1 ] = coordinates.rfGreen;
+	rgpOut[ 2 ] = coordinates.rfBlue;
+	for ( int c = 0; c < 3; c++ )
+	{
+		float flScale = flRadial * m_params.rgflChannelScale[ c ];
+		rgpOut[ c ][ 0 ] = m_params.flCenterU + flDU * flScale;
+		rgpOut[ c ][ 1 ] = m_params.flCenterV + flDV * flScale;
+	}
+	return coordinates;
+}
+
+
+void CDistortionModel::EvaluateBatch( const float *pU, const float *pV, uint32_t unCount, const DistortionBatchOutput_t &output ) const
+{
+	float *rgpOutU[ 3 ] = { output.pRedU, output.pGreenU, output.pBlueU };
+	float *rgpOutV[ 3 ] = { output.pRedV, output.pGreenV, output.pBlueV };
+	uint32_t i = 0;
+
+#if defined( DISTORTIONMODEL_SSE2 )
+	const __m128 centerU = _mm_set1_ps( m_params.flCenterU );
+	const __m128 centerV = _mm_set1_ps( m_params.flCenterV );
+	const __m128 k1 = _mm_set1_ps( m_params.rgflK[ 0 ] );
+	const __m128 k2 = _mm_set1_ps( m_params.rgflK[ 1 ] );
+	const __m128 k3 = _mm_set1_ps( m_params.rgflK[ 2 ] );
+	const __m128 one = _mm_set1_ps( 1.f );
+	__m128 rgScale[ 3 ];
+	for ( int c = 0; c < 3; c++ )
+	{
+		rgScale[ c ] = _mm_set1_ps( m_params.rgflChannelScale[ c ] );
+	}
+
+	for ( ; i + 4 <= unCount; i += 4 )
+	{
+		__m128 du = _mm_sub_ps( _mm_loadu_ps( pU + i ), centerU );
+		__m128 dv = _mm_sub_ps( _mm_loadu_ps( pV + i ), centerV );
+		__m128 r2 = _mm_add_ps( _mm_mul_ps( du, du ), _mm_mul_ps( dv, dv ) );
+
+		// same Horner order as the scalar path
+		__m128 radial = _mm_add_ps( one, _mm_mul_ps( r2, _mm_add_ps( k1, _mm_mul_ps( r2, _mm_add_ps( k2, _mm_mul_ps( r2, k3 ) ) ) ) ) );
+
+		for ( int c = 0; c < 3; c++ )
+		{
+			__m128 scale = _mm_mul_ps( radial, rgScale[ c ] );
+			_mm_storeu_ps( rgpOutU[ c ] + i, _mm_add_ps( centerU, _mm_mul_ps( du, scale ) ) );
+			_mm_storeu_ps( rgpOutV[ c ] + i, _mm_add_ps( centerV, _mm_mul_ps( dv, scale ) ) );
+		}
+	}
+#endif
+
+	for ( ; i < unCount; i++ )
+	{
+		vr::DistortionCoordinates_t coordinates = Evaluate( pU[ i ], pV[ i ] );
+		rgpOutU[ 0 ][ i ] = coordinates.rfRed[ 0 ];
+		rgpOutV[ 0 ][ i ] = coordinates.rfRed[ 1 ];
+		rgpOutU[ 1 ][ i ] = coordinates.rfGreen[ 0 ];
+		rgpOutV[ 1 ][ i ] = coordinates.rfGreen[ 1 ];
+		rgpOutU[ 2 ][ i ] = coordinates.rfBlue[ 0 ];
+		rgpOutV[ 2 ][ i ] = coordinates.rfBlue[ 1 ];
+	}
+}
+
+
+CDistortionGrid::CDistortionGrid()
+	: m_unResolution( 0 )
+{
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Evaluates one row of nodes per batch call and interleaves the
+//			results into the node array
+//-----------------------------------------------------------------------------
+void CDistortionGrid::Build( const CDistortionModel &model, uint32_t unResolution )
+{
+	if ( unResolution == 0 )
+		unResolution = 1;
+
+	m_unResolution = unResolution;
+	uint32_t unNodesPerRow = unResolution + 1;
+	m_vecNodes.resize( (size_t)unNodesPerRow * unNodesPerRow * k_unNodeFloats );
+
+	std::vector<float> vecRow( unNodesPerRow * 8 );
+	float *pU = &vecRow[ 0 ];
+	float *pV = pU + unNodesPerRow;
+	DistortionBatchOutput_t output;
+	output.pRedU = pV + unNodesPerRow;
+	output.pRedV = output.pRedU + unNodesPerRow;
+	output.pGreenU = output.pRedV + unNodesPerRow;
+	output.pGreenV = output.pGreenU + unNodesPerRow;
+	output.pBlueU = output.pGreenV + unNodesPerRow;
+	output.pBlueV = output.pBlueU + unNodesPerRow;
+
+	for ( uint32_t x = 0; x < unNodesPerRow; x++ )
+	{
+		pU[ x ] = (float)x / unResolution;
+	}
+
+	for ( uint32_t y = 0; y < unNodesPerRow; y++ )
+	{
+		float flV = (float)y / unResolution;
+		for ( uint32_t x = 0; x < unNodesPerRow; x++ )
+		{
+			pV[ x ] = flV;
+		}
+
+		model.EvaluateBatch( pU, pV, unNodesPerRow, output );
+
+		float *pNode = &m_vecNodes[ (size_t)y * unNodesPerRow * k_unNodeFloats ];
+		for ( uint32_t x = 0; x < unNodesPerRow; x++, pNode += k_unNodeFloats )
+		{
+			pNode[ 0 ] = output.pRedU[ x ];
+			pNode[ 1 ] = output.pRedV[ x ];
+			pNode[ 2 ] = output.pGreenU[ x ];
+			pNode[ 3 ] = output.pGreenV[ x ];
+			pNode[ 4 ] = output.pBlueU[ x ];
+			pNode[ 5 ] = output.pBlueV[ x ];
+		}
+	}
+}
+
+
+vr::DistortionCoordinates_t CDistortionGrid::Sample( float flU, float flV ) const
+{
+	vr::DistortionCoordinates_t coordinates;
+	if ( m_vecNodes.empty() )
+	{
+		coordinates.rfRed[ 0 ] = coordinates.rfGreen[ 0 ] = coordinates.rfBlue[ 0 ] = flU;
+		coordinates.rfRed[ 1 ] = coordinates.rfGreen[ 1 ] = coordinates.rfBlue[ 1 ] = flV;
+		return coordinates;
+	}
+
+	float flX = ( flU < 0.f ? 0.f : ( flU > 1.f ? 1.f : flU ) ) * m_unResolution;
+	float flY = ( flV < 0.f ? 0.f : ( flV > 1.f ? 1.f : flV ) ) * m_unResolution;
+	uint32_t unX = (uint32_t)flX;
+	uint32_t unY = (uint32_t)flY;
+	if ( unX >= m_unResolution )
+		unX = m_unResolution - 1;
+	if ( unY >= m_unResolution )
+		unY = m_unResolution - 1;
+	float flTX = flX - unX;
+	float flTY = flY - unY;
+
+	size_t unRowFloats = (size_t)( m_unResolution + 1 ) * k_unNodeFloats;
+	const float *p00 = &m_vecNodes[ unY * unRowFloats + unX * k_unNodeFloats ];
+	const float *p10 = p00 + k_unNodeFloats;
+	const float *p01 = p00 + unRowFloats;
+	const float *p11 = p01 + k_unNodeFloats;
+
+	float rgflResult[ 8 ];
+#if defined( DISTORTIONMODEL_SSE2 )
+	// red and green in one register, blue in the low half of another
+	const __m128 tx = _mm_set1_ps( flTX );
+	const __m128 ty = _mm_set1_ps( flTY );
+	for ( uint32_t i = 0; i < 8; i += 4 )
+	{
+		__m128 n00, n10, n01, n11;
+		if ( i == 0 )
+		{
+			n00 = _mm_loadu_ps( p00 );
+			n10 = _mm_loadu_ps( p10 );
+			n01 = _mm_loadu_ps( p01 );
+			n11 = _mm_loadu_ps( p11 );
+		}
+		else
+		{
+			n00 = _mm_loadl_pi( _mm_setzero_ps(), (const __m64 *)( p00 + 4 ) );
+			n10 = _mm_loadl_pi( _mm_setzero_ps(), (const __m64 *)( p10 + 4 ) );
+			n01 = _mm_loadl_pi( _mm_setzero_ps(), (const __m64 *)( p01 + 4 ) );
+			n11 = _mm_loadl_pi( _mm_setzero_ps(), (const __m64 *)( p11 + 4 ) );
+		}
+		__m128 top = _mm_add_ps( n00, _mm_mul_ps( _mm_sub_ps( n10, n00 ), tx ) );
+		__m128 bottom = _mm_add_ps( n01, _mm_mul_ps( _mm_sub_ps( n11, n01 ), tx ) );
+		_mm_storeu_ps( rgflResult + i, _mm_add_ps( top, _mm_mul_ps( _mm_sub_ps( bottom, top ), ty ) ) );
+	}
+#else
+	for ( uint32_t i = 0; i < k_unNodeFloats; i++ )
+	{
+		float flTop = p00[ i ] + ( p10[ i ] - p00[ i ] ) * flTX;
+		float flBottom = p01[ i ] + ( p11[ i ] - p01[ i ] ) * flTX;
+		rgflResult[ i ] = flTop + ( flBottom - flTop ) * flTY;
+	}
+#endif
+
+	coordinates.rfRed[ 0 ] = rgflResult[ 0 ];
+	coordinates.rfRed[ 1 ] = rgflResult[ 1 ];
+	coordinates.rfGreen[ 0 ] = rgflResult[ 2 ];
+	coordinates.rfGreen[ 1 ] = rgflResult[ 3 ];
+	coordinates.rfBlue[ 0 ] = rgflResult[ 4 ];
+	coordinates.rfBlue[ 1 ] = rgflResult[ 5 ];
+	return coordinates;
+}
+
+
+float CDistortionGrid::MeasureMaxError( const CDistortionModel &model, uint32_t unSamples ) const
+{
+	if ( unSamples < 2 )
+		unSamples = 2;
+
+	float flMaxError = 0.f;
+	for ( uint32_t y = 0; y < unSamples; y++ )
+	{
+		float flV = (float)y / ( unSamples - 1 );
+		for ( uint32_t x = 0; x < unSamples; x++ )
+		{
+			float flU = (float)x / ( unSamples - 1 );
+			vr::DistortionCoordinates_t exact = model.Evaluate( flU, flV );
+			vr::DistortionCoordinates_t approx = Sample( flU, flV );
+
+			for ( int i = 0; i < 2; i++ )
+			{
+				flMaxError = fmaxf( flMaxError, fabsf( exact.rfRed[ i ] - approx.rfRed[ i ] ) );
+				flMaxError = fmaxf( flMaxError, fabsf( exact.rfGreen[ i ] - approx.rfGreen[ i ] ) );
+				flMaxError = fmaxf( flMaxError, fabsf( exact.rfBlue[ i ] - approx.rfBlue[ i ] ) );
+			}
+		}
+	}
+	return flMaxError;
+}
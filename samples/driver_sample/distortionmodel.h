@@ -0,0 +1,90 @@
+//========= Copyright Valve Corporation ============//
+
+#ifndef DISTORTIONMODEL_H
+#define DISTORTIONMODEL_H
+
+#pragma once
+
+#include <openvr_driver.h>
+
+#include <vector>
+
+/** Radial lens model for one eye. UVs are in the eye's [0,1] viewport. */
+struct DistortionModelParams_t
+{
+	float flCenterU;
+	float flCenterV;
+	float rgflK[ 3 ];				// r^2, r^4 and r^6 coefficients
+	float rgflChannelScale[ 3 ];	// red, green, blue magnification for lateral chromatic aberration
+};
+
+/** Structure-of-arrays output for batch evaluation. Each array holds unCount floats. */
+struct DistortionBatchOutput_t
+{
+	float *pRedU;
+	float *pRedV;
+	float *pGreenU;
+	float *pGreenV;
+	float *pBlueU;
+	float *pBlueV;
+};
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Brown style radial polynomial with a per channel scale.
+//			For each channel c, with d = uv - center and r2 = |d|^2:
+//				out_c = center + d * scale_c * ( 1 + k1 r2 + k2 r2^2 + k3 r2^3 )
+//-----------------------------------------------------------------------------
+class CDistortionModel
+{
+public:
+	CDistortionModel();
+	explicit CDistortionModel( const DistortionModelParams_t &params );
+
+	void SetParams( const DistortionModelParams_t &params ) { m_params = params; }
+	const DistortionModelParams_t &GetParams() const { return m_params; }
+
+	/** true if the model leaves every UV where it is */
+	bool IsIdentity() const;
+
+	/** single sample, the reference the batch and grid paths are measured against */
+	vr::DistortionCoordinates_t Evaluate( float flU, float flV ) const;
+
+	/** evaluates unCount samples, four at a time with SSE2 where available */
+	void EvaluateBatch( const float *pU, const float *pV, uint32_t unCount, const DistortionBatchOutput_t &output ) const;
+
+private:
+	DistortionModelParams_t m_params;
+};
+
+
+//-----------------------------------------------------------------------------
+// Purpose: The model tabulated on a ( N + 1 ) x ( N + 1 ) grid over [0,1]^2
+//			and read back with bilinear filtering. Each node stores all six
+//			outputs next to each other so a lookup touches four short runs of
+//			memory.
+//-----------------------------------------------------------------------------
+class CDistortionGrid
+{
+public:
+	CDistortionGrid();
+
+	void Build( const CDistortionModel &model, uint32_t unResolution );
+	bool IsBuilt() const { return !m_vecNodes.empty(); }
+	uint32_t GetResolution() const { return m_unResolution; }
+
+	/** UVs outside [0,1] are clamped to the edge of the grid */
+	vr::DistortionCoordinates_t Sample( float flU, float flV ) const;
+
+	/** largest absolute difference from the model over an unSamples x unSamples sweep */
+	float MeasureMaxError( const CDistortionModel &model, uint32_t unSamples ) const;
+
+private:
+	static const uint32_t k_unNodeFloats = 6;
+
+	uint32_t m_unResolution;
+	std::vector<float> m_vecNodes;
+};
+
+
+#endif // DISTORTIONMODEL_H
@@ -1,7 +1,16 @@
 //============ Copyright (c) Valve Corporation, All rights reserved. ============
 
 #include <openvr_driver.h>
+#include "cameracomponent.h"
+#include "distortionmodel.h"
 #include "driverlog.h"
+#include "handskeleton.h"
+#include "inputstatemirror.h"
+#include "iobufferstream.h"
+#include "memoryiobuffer.h"
+#include "spatialanchorstore.h"
+#include "virtualdisplay.h"
+#include "watchdogmonitor.h"
 
 #include <vector>
 #include <thread>
@@ -63,6 +72,21 @@ static const char * const k_pch_Sample_RenderWidth_Int32 = "renderWidth";
 static const char * const k_pch_Sample_RenderHeight_Int32 = "renderHeight";
 static const char * const k_pch_Sample_SecondsFromVsyncToPhotons_Float = "secondsFromVsyncToPhotons";
 static const char * const k_pch_Sample_DisplayFrequency_Float = "displayFrequency";
+static const char * const k_pch_Sample_VirtualDisplay_Bool = "virtualDisplay";
+static const char * const k_pch_Sample_Camera_Bool = "camera";
+static const char * const k_pch_Sample_DistortionK1_Float = "distortionK1";
+static const char * const k_pch_Sample_DistortionK2_Float = "distortionK2";
+static const char * const k_pch_Sample_CameraSource_String = "cameraSource";
+static const char * const k_pch_Sample_ImuLoopback_Bool = "imuLoopback";
+static const char * const k_pch_Sample_WatchdogUsbProduct_String = "watchdogUsbProduct";
+static const char * const k_pch_Sample_UniverseId_Int32 = "universeId";
+
+// universe the sample devices and anchors live in. 0 is invalid and 1 is reserved for Oculus.
+static uint64_t GetSampleUniverseId()
+{
+	int32_t nUniverseId = vr::VRSettings()->GetInt32( k_pch_Sample_Section, k_pch_Sample_UniverseId_Int32 );
+	return nUniverseId > 1 ? (uint64_t)nUniverseId : 2;
+}
 
 //-----------------------------------------------------------------------------
 // Purpose:
@@ -81,6 +105,7 @@ public:
 
 private:
 	std::thread *m_pWatchdogThread;
+	CWatchdogMonitor m_monitor;
 };
 
 CWatchdogDriver_Sample g_watchdogDriverNull;
@@ -88,11 +113,11 @@ CWatchdogDriver_Sample g_watchdogDriverNull;
 
 bool g_bExiting = false;
 
+#if defined( _WINDOWS )
 void WatchdogThreadFunction(  )
 {
 	while ( !g_bExiting )
 	{
-#if defined( _WINDOWS )
 		// on windows send the event when the Y key is pressed.
 		if ( (0x01 & GetAsyncKeyState( 'Y' )) != 0 )
 		{
@@ -100,19 +125,17 @@ void WatchdogThreadFunction(  )
 			vr::VRWatchdogHost()->WatchdogWakeUp( vr::TrackedDeviceClass_HMD );
 		}
 		std::this_thread::sleep_for( std::chrono::microseconds( 500 ) );
-#else
-		// for the other platforms, just send one every five seconds
-		std::this_thread::sleep_for( std::chrono::seconds( 5 ) );
-		vr::VRWatchdogHost()->WatchdogWakeUp( vr::TrackedDeviceClass_HMD );
-#endif
 	}
 }
+#endif
 
 EVRInitError CWatchdogDriver_Sample::Init( vr::IVRDriverContext *pDriverContext )
 {
 	VR_INIT_WATCHDOG_DRIVER_CONTEXT( pDriverContext );
 	InitDriverLog( vr::VRDriverLog() );
+	LoadDriverLogSettings( vr::VRSettings(), k_pch_Sample_Section );
 
+#if defined( _WINDOWS )
 	// Watchdog mode on Windows starts a thread that listens for the 'Y' key on the keyboard to 
 	// be pressed. A real driver should wait for a system button event or something else from the 
 	// the hardware that signals that the VR system should start up.
@@ -123,6 +146,31 @@ EVRInitError CWatchdogDriver_Sample::Init( vr::IVRDriverContext *pDriverContext
 		DriverLog( "Unable to create watchdog thread\n");
 		return VRInitError_Driver_Failed;
 	}
+#else
+	// Everywhere else the monitor sleeps until the hardware does something. On Linux that is the
+	// device set in watchdogUsbProduct being plugged in, matched on the "vendor/product/" prefix of
+	// the uevent PRODUCT key so other USB devices don't start SteamVR. The sample has no hardware,
+	// so it ships with that empty. A real driver would also add the hidraw node of its dongle so a
+	// button press wakes the system. With nothing to wait on, or no hotplug support, the monitor
+	// falls back to waking every five seconds.
+	char rchUsbProduct[ 64 ] = { 0 };
+	vr::VRSettings()->GetString( k_pch_Sample_Section, k_pch_Sample_WatchdogUsbProduct_String, rchUsbProduct, sizeof( rchUsbProduct ) );
+	if ( rchUsbProduct[ 0 ] )
+		m_monitor.AddHotplugMatch( "usb", rchUsbProduct );
+	else
+		DriverLog( "Watchdog: no %s set, hotplug wake up is disabled\n", k_pch_Sample_WatchdogUsbProduct_String );
+	m_monitor.SetFallbackInterval( std::chrono::seconds( 5 ) );
+	bool bStarted = m_monitor.Start( []( const char *pchReason )
+	{
+		DriverLog( "Watchdog wake up: %s\n", pchReason );
+		vr::VRWatchdogHost()->WatchdogWakeUp( vr::TrackedDeviceClass_HMD );
+	} );
+	if ( !bStarted )
+	{
+		DriverLog( "Unable to start watchdog monitor\n");
+		return VRInitError_Driver_Failed;
+	}
+#endif
 
 	return VRInitError_None;
 }
@@ -137,6 +185,7 @@ void CWatchdogDriver_Sample::Cleanup()
 		delete m_pWatchdogThread;
 		m_pWatchdogThread = nullptr;
 	}
+	m_monitor.Stop();
 
 	CleanupDriverLog();
 }
@@ -171,6 +220,21 @@ public:
 		m_nRenderHeight = vr::VRSettings()->GetInt32( k_pch_Sample_Section, k_pch_Sample_RenderHeight_Int32 );
 		m_flSecondsFromVsyncToPhotons = vr::VRSettings()->GetFloat( k_pch_Sample_Section, k_pch_Sample_SecondsFromVsyncToPhotons_Float );
 		m_flDisplayFrequency = vr::VRSettings()->GetFloat( k_pch_Sample_Section, k_pch_Sample_DisplayFrequency_Float );
+		m_bVirtualDisplay = vr::VRSettings()->GetBool( k_pch_Sample_Section, k_pch_Sample_VirtualDisplay_Bool );
+		m_bCamera = vr::VRSettings()->GetBool( k_pch_Sample_Section, k_pch_Sample_Camera_Bool );
+		m_bImuLoopback = vr::VRSettings()->GetBool( k_pch_Sample_Section, k_pch_Sample_ImuLoopback_Bool );
+
+		vr::VRSettings()->GetString( k_pch_Sample_Section, k_pch_Sample_CameraSource_String, buf, sizeof( buf ) );
+		m_sCameraSource = buf;
+		m_pCameraSource = nullptr;
+		m_pCamera = nullptr;
+
+		// The compositor calls ComputeDistortion once per mesh vertex, so the lens model is tabulated up front
+		DistortionModelParams_t distortionParams = CDistortionModel().GetParams();
+		distortionParams.rgflK[ 0 ] = vr::VRSettings()->GetFloat( k_pch_Sample_Section, k_pch_Sample_DistortionK1_Float );
+		distortionParams.rgflK[ 1 ] = vr::VRSettings()->GetFloat( k_pch_Sample_Section, k_pch_Sample_DistortionK2_Float );
+		m_distortionModel.SetParams( distortionParams );
+		m_distortionGrid.Build( m_distortionModel, k_unDistortionGridResolution );
 
 		DriverLog( "driver_null: Serial Number: %s\n", m_sSerialNumber.c_str() );
 		DriverLog( "driver_null: Model Number: %s\n", m_sModelNumber.c_str() );
@@ -179,6 +243,10 @@ public:
 		DriverLog( "driver_null: Seconds from Vsync to Photons: %f\n", m_flSecondsFromVsyncToPhotons );
 		DriverLog( "driver_null: Display Frequency: %f\n", m_flDisplayFrequency );
 		DriverLog( "driver_null: IPD: %f\n", m_flIPD );
+		DriverLog( "driver_null: Virtual Display: %d\n", m_bVirtualDisplay );
+		DriverLog( "driver_null: Camera: %d %s\n", m_bCamera, m_sCameraSource.c_str() );
+		DriverLog( "driver_null: Distortion: k1 %f k2 %f, grid error %g\n", distortionParams.rgflK[ 0 ], distortionParams.rgflK[ 1 ],
+			m_distortionGrid.MeasureMaxError( m_distortionModel, 257 ) );
 	}
 
 	virtual ~CSampleDeviceDriver()
@@ -199,12 +267,68 @@ public:
 		vr::VRProperties()->SetFloatProperty( m_ulPropertyContainer, Prop_DisplayFrequency_Float, m_flDisplayFrequency );
 		vr::VRProperties()->SetFloatProperty( m_ulPropertyContainer, Prop_SecondsFromVsyncToPhotons_Float, m_flSecondsFromVsyncToPhotons );
 
-		// return a constant that's not 0 (invalid) or 1 (reserved for Oculus)
-		vr::VRProperties()->SetUint64Property( m_ulPropertyContainer, Prop_CurrentUniverseId_Uint64, 2 );
+		vr::VRProperties()->SetUint64Property( m_ulPropertyContainer, Prop_CurrentUniverseId_Uint64, GetSampleUniverseId() );
 
 		// avoid "not fullscreen" warnings from vrmonitor
 		vr::VRProperties()->SetBoolProperty( m_ulPropertyContainer, Prop_IsOnDesktop_Bool, false );
 
+		// In virtual display mode frames are streamed over the loopback pipeline instead of going to a desktop window
+		if ( m_bVirtualDisplay )
+		{
+			CVirtualDisplaySample::Config_t config;
+			config.unWidth = m_nRenderWidth;
+			config.unHeight = m_nRenderHeight;
+			config.flDisplayFrequency = m_flDisplayFrequency;
+			config.usPort = 0;
+			if ( !m_virtualDisplay.Start( config ) )
+			{
+				DriverLog( "driver_null: Unable to start virtual display\n" );
+				m_bVirtualDisplay = false;
+			}
+		}
+
+		// Pass-through camera. "cameraSource" names a V4L2 device, a raw YUYV file to replay, or is empty for a test pattern.
+		if ( m_bCamera )
+		{
+#if defined( __linux__ )
+			if ( m_sCameraSource.compare( 0, 10, "/dev/video" ) == 0 )
+				m_pCameraSource = new CV4L2CameraSource( m_sCameraSource.c_str() );
+			else
+#endif
+				m_pCameraSource = new CSyntheticCameraSource( m_sCameraSource.empty() ? nullptr : m_sCameraSource.c_str() );
+
+			CCameraComponentSample::Config_t config;
+			config.unWidth = k_unCameraWidth;
+			config.unHeight = k_unCameraHeight;
+			config.unFrameRate = k_unCameraFrameRate;
+			config.flHorizontalFOV = 90.f;
+			m_pCamera = new CCameraComponentSample( m_pCameraSource );
+			if ( m_pCamera->Init( config ) )
+			{
+				vr::VRProperties()->SetBoolProperty( m_ulPropertyContainer, Prop_HasCamera_Bool, true );
+				vr::VRProperties()->SetInt32Property( m_ulPropertyContainer, Prop_NumCameras_Int32, 1 );
+			}
+			else
+			{
+				DriverLog( "driver_null: Unable to open camera source %s\n", m_sCameraSource.c_str() );
+				ShutdownCamera();
+			}
+		}
+
+		// Publish raw IMU samples for tools that want them. Nothing is produced unless a reader has the buffer open.
+		// In loopback mode the stream goes through an in-process IOBuffer that the driver reads back itself,
+		// which exercises both ends of the stream without an external reader.
+		vr::IVRIOBuffer *pIOBuffer = m_bImuLoopback ? &m_loopbackIOBuffer : vr::VRIOBuffer();
+		std::string sImuPath = "/devices/sample/" + m_sSerialNumber + "/imu";
+		if ( m_imuStream.Open( pIOBuffer, sImuPath.c_str(), k_unImuStreamElements, k_unImuSamplesPerFrame ) != vr::IOBuffer_Success )
+		{
+			DriverLog( "driver_null: Unable to create IMU stream %s\n", sImuPath.c_str() );
+		}
+		else if ( m_bImuLoopback && m_imuLoopbackReader.Open( pIOBuffer, sImuPath.c_str(), k_unImuSamplesPerFrame ) != vr::IOBuffer_Success )
+		{
+			DriverLog( "driver_null: Unable to read back IMU stream %s\n", sImuPath.c_str() );
+		}
+
 		// Icons can be configured in code or automatically configured by an external file "drivername\resources\driver.vrresources".
 		// Icon properties NOT configured in code (post Activate) are then auto-configured by the optional presence of a driver's "drivername\resources\driver.vrresources".
 		// In this manner a driver can configure their icons in a flexible data driven fashion by using an external file.
@@ -248,6 +372,10 @@ public:
 
 	virtual void Deactivate() 
 	{
+		m_virtualDisplay.Stop();
+		ShutdownCamera();
+		m_imuLoopbackReader.Close();
+		m_imuStream.Close();
 		m_unObjectId = vr::k_unTrackedDeviceIndexInvalid;
 	}
 
@@ -262,6 +390,16 @@ public:
 			return (vr::IVRDisplayComponent*)this;
 		}
 
+		if ( m_bVirtualDisplay && !_stricmp( pchComponentNameAndVersion, vr::IVRVirtualDisplay_Version ) )
+		{
+			return (vr::IVRVirtualDisplay*)&m_virtualDisplay;
+		}
+
+		if ( m_pCamera && !_stricmp( pchComponentNameAndVersion, vr::IVRCameraComponent_Version ) )
+		{
+			return (vr::IVRCameraComponent*)m_pCamera;
+		}
+
 		// override this to add a component to a driver
 		return NULL;
 	}
@@ -327,14 +465,8 @@ public:
 
 	virtual DistortionCoordinates_t ComputeDistortion( EVREye eEye, float fU, float fV ) 
 	{
-		DistortionCoordinates_t coordinates;
-		coordinates.rfBlue[0] = fU;
-		coordinates.rfBlue[1] = fV;
-		coordinates.rfGreen[0] = fU;
-		coordinates.rfGreen[1] = fV;
-		coordinates.rfRed[0] = fU;
-		coordinates.rfRed[1] = fV;
-		return coordinates;
+		// both eyes share a lens model centered in their own viewport
+		return m_distortionGrid.Sample( fU, fV );
 	}
 
 	virtual DriverPose_t GetPose() 
@@ -360,12 +492,53 @@ public:
 		if ( m_unObjectId != vr::k_unTrackedDeviceIndexInvalid )
 		{
 			vr::VRServerDriverHost()->TrackedDevicePoseUpdated( m_unObjectId, GetPose(), sizeof( DriverPose_t ) );
+			PublishImuSamples();
+			if ( m_imuLoopbackReader.IsOpen() )
+				CheckImuLoopback();
 		}
 	}
 
+	void PublishImuSamples()
+	{
+		// A real driver would forward the samples it received from the hardware since the last frame.
+		// This one reports a device at rest.
+		m_imuStream.ProduceBatch( 1, []( vr::ImuSample_t *pSamples, uint32_t ) -> uint32_t
+		{
+			memset( pSamples, 0, sizeof( *pSamples ) );
+			pSamples->fSampleTime = std::chrono::duration<double>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+			pSamples->vAccel.v[1] = 9.80665;
+			return 1;
+		} );
+	}
+
+	void CheckImuLoopback()
+	{
+		m_imuLoopbackReader.Drain( []( const vr::ImuSample_t &, uint64_t ) {} );
+
+		const IOStreamReaderStats_t &stats = m_imuLoopbackReader.Stats();
+		DRIVER_LOG_RATE_LIMITED( DriverLogLevel_Debug, 1, "driver_null: IMU loopback read %llu samples, lost %llu in %llu overruns\n",
+			(unsigned long long)stats.ulRecordsRead, (unsigned long long)stats.ulRecordsLost, (unsigned long long)stats.ulOverruns );
+	}
+
 	std::string GetSerialNumber() const { return m_sSerialNumber; }
 
 private:
+	void ShutdownCamera()
+	{
+		if ( m_pCamera )
+		{
+			m_pCamera->Shutdown();
+			CameraComponentStats_t stats = m_pCamera->GetStats();
+			DriverLog( "driver_null: Camera frames captured %llu delivered %llu dropped %llu skipped %llu\n",
+				(unsigned long long)stats.ulFramesCaptured, (unsigned long long)stats.ulFramesDelivered,
+				(unsigned long long)stats.ulFramesDropped, (unsigned long long)stats.ulFramesSkipped );
+			delete m_pCamera;
+			m_pCamera = nullptr;
+		}
+		delete m_pCameraSource;
+		m_pCameraSource = nullptr;
+	}
+
 	vr::TrackedDeviceIndex_t m_unObjectId;
 	vr::PropertyContainerHandle_t m_ulPropertyContainer;
 
@@ -381,6 +554,28 @@ private:
 	float m_flSecondsFromVsyncToPhotons;
 	float m_flDisplayFrequency;
 	float m_flIPD;
+	bool m_bVirtualDisplay;
+
+	CVirtualDisplaySample m_virtualDisplay;
+
+	static const uint32_t k_unDistortionGridResolution = 64;
+	CDistortionModel m_distortionModel;
+	CDistortionGrid m_distortionGrid;
+
+	static const uint32_t k_unCameraWidth = 640;
+	static const uint32_t k_unCameraHeight = 480;
+	static const uint32_t k_unCameraFrameRate = 60;
+	bool m_bCamera;
+	std::string m_sCameraSource;
+	ICameraFrameSource *m_pCameraSource;
+	CCameraComponentSample *m_pCamera;
+
+	static const uint32_t k_unImuStreamElements = 1024;
+	static const uint32_t k_unImuSamplesPerFrame = 16;
+	CImuStreamWriter m_imuStream;
+	bool m_bImuLoopback;
+	CMemoryIOBuffer m_loopbackIOBuffer;
+	CImuStreamReader m_imuLoopbackReader;
 };
 
 //-----------------------------------------------------------------------------
@@ -390,6 +585,7 @@ class CSampleControllerDriver : public vr::ITrackedDeviceServerDriver
 {
 public:
 	CSampleControllerDriver()
+		: m_handSkeleton( &m_handModel )
 	{
 		m_unObjectId = vr::k_unTrackedDeviceIndexInvalid;
 		m_ulPropertyContainer = vr::k_ulInvalidPropertyContainer;
@@ -397,6 +593,10 @@ public:
 		m_sSerialNumber = "CTRL_1234";
 
 		m_sModelNumber = "MyController";
+
+		m_compSkeleton = vr::k_ulInvalidInputComponentHandle;
+		m_handModel.SetSampleHandPoses( true );
+		memset( &m_handCurls, 0, sizeof( m_handCurls ) );
 	}
 
 	virtual ~CSampleControllerDriver()
@@ -412,8 +612,7 @@ public:
 		vr::VRProperties()->SetStringProperty( m_ulPropertyContainer, Prop_ModelNumber_String, m_sModelNumber.c_str() );
 		vr::VRProperties()->SetStringProperty( m_ulPropertyContainer, Prop_RenderModelName_String, m_sModelNumber.c_str() );
 
-		// return a constant that's not 0 (invalid) or 1 (reserved for Oculus)
-		vr::VRProperties()->SetUint64Property( m_ulPropertyContainer, Prop_CurrentUniverseId_Uint64, 2 );
+		vr::VRProperties()->SetUint64Property( m_ulPropertyContainer, Prop_CurrentUniverseId_Uint64, GetSampleUniverseId() );
 
 		// avoid "not fullscreen" warnings from vrmonitor
 		vr::VRProperties()->SetBoolProperty( m_ulPropertyContainer, Prop_IsOnDesktop_Bool, false );
@@ -428,19 +627,34 @@ public:
 		// be for legacy or other apps
 		vr::VRProperties()->SetStringProperty( m_ulPropertyContainer, Prop_InputProfilePath_String, "{sample}/input/mycontroller_profile.json" );
 
-		// create all the input components
-		vr::VRDriverInput()->CreateBooleanComponent( m_ulPropertyContainer, "/input/a/click", &m_compA );
-		vr::VRDriverInput()->CreateBooleanComponent( m_ulPropertyContainer, "/input/b/click", &m_compB );
-		vr::VRDriverInput()->CreateBooleanComponent( m_ulPropertyContainer, "/input/c/click", &m_compC );
+		// create all the input components. They go through the mirror so that only changes are sent to vrserver.
+		m_inputMirror.SetDriverInput( vr::VRDriverInput() );
+		m_inputMirror.CreateBooleanComponent( m_ulPropertyContainer, "/input/a/click", &m_compA );
+		m_inputMirror.CreateBooleanComponent( m_ulPropertyContainer, "/input/b/click", &m_compB );
+		m_inputMirror.CreateBooleanComponent( m_ulPropertyContainer, "/input/c/click", &m_compC );
 
 		// create our haptic component
 		vr::VRDriverInput()->CreateHapticComponent( m_ulPropertyContainer, "/output/haptic", &m_compHaptic );
 
+		// The hand skeleton is synthesized from finger curls, which a real controller would get from its capacitive sensors
+		if ( vr::VRDriverInput()->CreateSkeletonComponent( m_ulPropertyContainer, "/input/skeleton/right", "/skeleton/hand/right", "/pose/raw",
+			vr::VRSkeletalTracking_Partial, NULL, 0, &m_compSkeleton ) != vr::VRInputError_None )
+		{
+			m_compSkeleton = vr::k_ulInvalidInputComponentHandle;
+		}
+
 		return VRInitError_None;
 	}
 
 	virtual void Deactivate()
 	{
+		InputComponentStats_t stats = m_inputMirror.GetTotalStats();
+		DriverLog( "driver_null: forwarded %llu of %llu input updates\n", (unsigned long long)stats.ulUpdatesForwarded, (unsigned long long)stats.ulUpdatesRequested );
+
+		const HandSkeletonCacheStats_t &skeletonStats = m_handSkeleton.Stats();
+		DriverLog( "driver_null: hand skeleton cache hits %llu misses %llu\n", (unsigned long long)skeletonStats.ulHits, (unsigned long long)skeletonStats.ulMisses );
+		m_compSkeleton = vr::k_ulInvalidInputComponentHandle;
+
 		m_unObjectId = vr::k_unTrackedDeviceIndexInvalid;
 	}
 
@@ -481,15 +695,48 @@ public:
 
 	void RunFrame()
 	{
+		HandCurls_t targetCurls;
+		memset( &targetCurls, 0, sizeof( targetCurls ) );
+
 #if defined( _WINDOWS )
 		// Your driver would read whatever hardware state is associated with its input components and pass that
 		// in to UpdateBooleanComponent. This could happen in RunFrame or on a thread of your own that's reading USB
-		// state. There's no need to update input state unless it changes, but it doesn't do any harm to do so.
-
-		vr::VRDriverInput()->UpdateBooleanComponent( m_compA, (0x8000 & GetAsyncKeyState( 'A' )) != 0, 0 );
-		vr::VRDriverInput()->UpdateBooleanComponent( m_compB, (0x8000 & GetAsyncKeyState( 'B' )) != 0, 0 );
-		vr::VRDriverInput()->UpdateBooleanComponent( m_compC, (0x8000 & GetAsyncKeyState( 'C' )) != 0, 0 );
+		// state. There's no need to update input state unless it changes, so the mirror drops repeated values and
+		// only forwards what changed once the whole report has been applied.
+		bool bA = (0x8000 & GetAsyncKeyState( 'A' )) != 0;
+		bool bB = (0x8000 & GetAsyncKeyState( 'B' )) != 0;
+		bool bC = (0x8000 & GetAsyncKeyState( 'C' )) != 0;
+
+		m_inputMirror.BeginReport();
+		m_inputMirror.SetBoolean( m_compA, bA, 0 );
+		m_inputMirror.SetBoolean( m_compB, bB, 0 );
+		m_inputMirror.SetBoolean( m_compC, bC, 0 );
+		m_inputMirror.EndReport();
+
+		// stand-ins for finger sensors: A curls the index finger, B the other three and C the thumb
+		targetCurls.rflCurl[ HandFinger_Index ] = bA ? 1.f : 0.f;
+		targetCurls.rflCurl[ HandFinger_Middle ] = targetCurls.rflCurl[ HandFinger_Ring ] = targetCurls.rflCurl[ HandFinger_Pinky ] = bB ? 1.f : 0.f;
+		targetCurls.rflCurl[ HandFinger_Thumb ] = bC ? 1.f : 0.f;
 #endif
+
+		UpdateHandSkeleton( targetCurls );
+	}
+
+	void UpdateHandSkeleton( const HandCurls_t &targetCurls )
+	{
+		if ( m_compSkeleton == vr::k_ulInvalidInputComponentHandle )
+			return;
+
+		// ease toward the target so the fingers don't snap
+		const float k_flMaxCurlPerFrame = 0.1f;
+		for ( uint32_t f = 0; f < HandFinger_Count; f++ )
+		{
+			float flDelta = targetCurls.rflCurl[ f ] - m_handCurls.rflCurl[ f ];
+			flDelta = flDelta > k_flMaxCurlPerFrame ? k_flMaxCurlPerFrame : ( flDelta < -k_flMaxCurlPerFrame ? -k_flMaxCurlPerFrame : flDelta );
+			m_handCurls.rflCurl[ f ] += flDelta;
+		}
+
+		m_handSkeleton.UpdateSkeletonComponent( vr::VRDriverInput(), m_compSkeleton, m_handCurls );
 	}
 
 	void ProcessEvent( const vr::VREvent_t & vrEvent )
@@ -500,8 +747,9 @@ public:
 		{
 			if ( vrEvent.data.hapticVibration.componentHandle == m_compHaptic )
 			{
-				// This is where you would send a signal to your hardware to trigger actual haptic feedback
-				DriverLog( "BUZZ!\n" );
+				// This is where you would send a signal to your hardware to trigger actual haptic feedback.
+				// Haptic events can arrive at a high rate, so keep the log cheap and throttled.
+				DRIVER_LOG_RATE_LIMITED( DriverLogLevel_Info, 10, "BUZZ! duration %f\n", vrEvent.data.hapticVibration.fDurationSeconds );
 			}
 		}
 		break;
@@ -519,6 +767,13 @@ private:
 	vr::VRInputComponentHandle_t m_compB;
 	vr::VRInputComponentHandle_t m_compC;
 	vr::VRInputComponentHandle_t m_compHaptic;
+	vr::VRInputComponentHandle_t m_compSkeleton;
+
+	CInputStateMirror m_inputMirror;
+
+	CHandSkeletonModel m_handModel;
+	CHandSkeletonSynthesizer m_handSkeleton;
+	HandCurls_t m_handCurls;
 
 	std::string m_sSerialNumber;
 	std::string m_sModelNumber;
@@ -543,15 +798,56 @@ public:
 private:
 	CSampleDeviceDriver *m_pNullHmdLatest = nullptr;
 	CSampleControllerDriver *m_pController = nullptr;
+	CSpatialAnchorStore m_anchorStore;
 };
 
 CServerDriver_Sample g_serverDriverNull;
 
 
+//-----------------------------------------------------------------------------
+// Purpose: The sample has no map of the room, so its anchor descriptors just
+//			carry the pose: "sample <universe> x y z qw qx qy qz"
+//-----------------------------------------------------------------------------
+static const double k_flSampleAnchorValidSeconds = 30.0;
+
+static vr::EVRSpatialAnchorError ResolveSampleAnchor( const std::string &sDescriptor, uint64_t ulUniverseId, vr::SpatialAnchorDriverPose_t *pPose )
+{
+	unsigned long long ulAnchorUniverse;
+	double rgdPose[ 7 ];
+	if ( sscanf( sDescriptor.c_str(), "sample %llu %lf %lf %lf %lf %lf %lf %lf", &ulAnchorUniverse,
+		&rgdPose[ 0 ], &rgdPose[ 1 ], &rgdPose[ 2 ], &rgdPose[ 3 ], &rgdPose[ 4 ], &rgdPose[ 5 ], &rgdPose[ 6 ] ) != 8 )
+	{
+		return vr::VRSpatialAnchorError_PermanentlyUnavailable;
+	}
+
+	if ( ulAnchorUniverse != 0 && ulAnchorUniverse != ulUniverseId )
+		return vr::VRSpatialAnchorError_NotAvailableInThisUniverse;
+
+	pPose->vWorldTranslation.v[ 0 ] = rgdPose[ 0 ];
+	pPose->vWorldTranslation.v[ 1 ] = rgdPose[ 1 ];
+	pPose->vWorldTranslation.v[ 2 ] = rgdPose[ 2 ];
+	pPose->qWorldRotation = HmdQuaternion_Init( rgdPose[ 3 ], rgdPose[ 4 ], rgdPose[ 5 ], rgdPose[ 6 ] );
+	pPose->ulRequiredUniverseId = ulAnchorUniverse;
+	pPose->fValidDuration = k_flSampleAnchorValidSeconds;
+	return vr::VRSpatialAnchorError_Success;
+}
+
+static bool BuildSampleAnchorDescriptor( const vr::SpatialAnchorDriverPose_t &pose, std::string *psDescriptor )
+{
+	char rchDescriptor[ 256 ];
+	snprintf( rchDescriptor, sizeof( rchDescriptor ), "sample %llu %.6f %.6f %.6f %.6f %.6f %.6f %.6f", (unsigned long long)pose.ulRequiredUniverseId,
+		pose.vWorldTranslation.v[ 0 ], pose.vWorldTranslation.v[ 1 ], pose.vWorldTranslation.v[ 2 ],
+		pose.qWorldRotation.w, pose.qWorldRotation.x, pose.qWorldRotation.y, pose.qWorldRotation.z );
+	*psDescriptor = rchDescriptor;
+	return true;
+}
+
+
 EVRInitError CServerDriver_Sample::Init( vr::IVRDriverContext *pDriverContext )
 {
 	VR_INIT_SERVER_DRIVER_CONTEXT( pDriverContext );
 	InitDriverLog( vr::VRDriverLog() );
+	LoadDriverLogSettings( vr::VRSettings(), k_pch_Sample_Section );
 
 	m_pNullHmdLatest = new CSampleDeviceDriver();
 	vr::VRServerDriverHost()->TrackedDeviceAdded( m_pNullHmdLatest->GetSerialNumber().c_str(), vr::TrackedDeviceClass_HMD, m_pNullHmdLatest );
@@ -559,11 +855,19 @@ EVRInitError CServerDriver_Sample::Init( vr::IVRDriverContext *pDriverContext )
 	m_pController = new CSampleControllerDriver();
 	vr::VRServerDriverHost()->TrackedDeviceAdded( m_pController->GetSerialNumber().c_str(), vr::TrackedDeviceClass_Controller, m_pController );
 
+	// Anchor events only arrive if the manifest declares "spatialAnchorsSupport"
+	if ( vr::VRDriverSpatialAnchors() )
+	{
+		m_anchorStore.Start( vr::VRDriverSpatialAnchors(), ResolveSampleAnchor, BuildSampleAnchorDescriptor, 2 );
+		m_anchorStore.SetCurrentUniverse( GetSampleUniverseId() );
+	}
+
 	return VRInitError_None;
 }
 
 void CServerDriver_Sample::Cleanup() 
 {
+	m_anchorStore.Stop();
 	CleanupDriverLog();
 	delete m_pNullHmdLatest;
 	m_pNullHmdLatest = NULL;
@@ -586,11 +890,16 @@ void CServerDriver_Sample::RunFrame()
 	vr::VREvent_t vrEvent;
 	while ( vr::VRServerDriverHost()->PollNextEvent( &vrEvent, sizeof( vrEvent ) ) )
 	{
+		if ( m_anchorStore.ProcessEvent( vrEvent ) )
+			continue;
+
 		if ( m_pController )
 		{
 			m_pController->ProcessEvent( vrEvent );
 		}
 	}
+
+	m_anchorStore.Tick();
 }
 
 //-----------------------------------------------------------------------------
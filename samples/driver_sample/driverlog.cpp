@@ -4,33 +4,510 @@
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdlib.h>
+#if defined( _WIN32 )
+#include <malloc.h>
+#endif
 
-static vr::IVRDriverLog * s_pLogFile = NULL;
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
 
 #if !defined( WIN32)
 #define vsnprintf_s vsnprintf
 #endif
 
+using namespace driverlog;
+
+// records per thread ring. Must be a power of two.
+static const uint32_t k_unRingRecords = 256;
+
+// set in DriverLogRecord_t::unLevel when the text continues in the next record
+static const uint32_t k_unRecordFlag_Continued = 0x80000000;
+
+// how long the flusher sleeps when every ring is empty
+static const std::chrono::milliseconds k_FlushInterval( 5 );
+
+//-----------------------------------------------------------------------------
+// Purpose: Single producer (the owning thread), single consumer (whoever holds
+//			s_drainMutex) ring of log records. The owning thread and s_vecRings
+//			each hold a reference, so a ring outlives whichever lets go first.
+//-----------------------------------------------------------------------------
+struct DriverLogRing_t
+{
+	DriverLogRing_t()
+		: m_unHead( 0 ), m_unTail( 0 ), m_ulQueued( 0 ), m_ulDropped( 0 ), m_unRefCount( 2 ), m_bOwnerExited( false ), m_ulDroppedReported( 0 )
+	{
+	}
+
+	DriverLogRecord_t m_rgRecords[ k_unRingRecords ];
+
+	// keep the producer and consumer indices on separate cache lines
+	alignas( 64 ) std::atomic<uint32_t> m_unHead;
+	alignas( 64 ) std::atomic<uint32_t> m_unTail;
+
+	// only written by the owning thread
+	std::atomic<uint64_t> m_ulQueued;
+	std::atomic<uint64_t> m_ulDropped;
+
+	std::atomic<uint32_t> m_unRefCount;
+
+	// set once the owning thread has exited and will queue nothing more
+	std::atomic<bool> m_bOwnerExited;
+
+	// only touched by the consumer
+	uint64_t m_ulDroppedReported;
+};
+
+struct ThreadRing_t
+{
+	~ThreadRing_t();
+
+	DriverLogRing_t *m_pRing;
+	uint32_t m_unGeneration;
+	uint32_t m_unPendingHead;
+};
+
+namespace driverlog
+{
+	std::atomic<int> g_nMinLevel( DriverLogLevel_Debug );
+}
+
+static vr::IVRDriverLog * s_pLogFile = NULL;
+static std::atomic<bool> s_bRunning( false );
+
+// bumped on every Init/Cleanup so threads notice that their cached ring is gone
+static std::atomic<uint32_t> s_unGeneration( 1 );
+
+static std::mutex s_ringsMutex;
+static std::vector<DriverLogRing_t *> s_vecRings;
+
+static std::mutex s_drainMutex;
+
+static std::mutex s_flusherMutex;
+static std::condition_variable s_flusherCondition;
+static std::thread *s_pFlusherThread = NULL;
+static bool s_bFlusherExiting = false;
+
+static std::atomic<uint64_t> s_ulWritten( 0 );
+static std::atomic<uint64_t> s_ulRateLimited( 0 );
+static std::atomic<uint64_t> s_ulQueuedRetired( 0 );
+static std::atomic<uint64_t> s_ulDroppedRetired( 0 );
+
+static thread_local ThreadRing_t t_threadRing = { NULL, 0, 0 };
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Rings are cache line aligned, which plain new doesn't guarantee
+//			before C++17
+//-----------------------------------------------------------------------------
+static DriverLogRing_t *AllocRing()
+{
+	void *pMemory = NULL;
+#if defined( _WIN32 )
+	pMemory = _aligned_malloc( sizeof( DriverLogRing_t ), alignof( DriverLogRing_t ) );
+#else
+	if ( posix_memalign( &pMemory, alignof( DriverLogRing_t ), sizeof( DriverLogRing_t ) ) != 0 )
+		pMemory = NULL;
+#endif
+	return pMemory ? new ( pMemory ) DriverLogRing_t() : NULL;
+}
+
+
+static void ReleaseRing( DriverLogRing_t *pRing )
+{
+	if ( pRing->m_unRefCount.fetch_sub( 1, std::memory_order_acq_rel ) != 1 )
+		return;
+
+	pRing->~DriverLogRing_t();
+#if defined( _WIN32 )
+	_aligned_free( pRing );
+#else
+	free( pRing );
+#endif
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Drops s_vecRings' reference. Caller holds s_ringsMutex.
+//-----------------------------------------------------------------------------
+static void RetireRing( DriverLogRing_t *pRing )
+{
+	s_ulQueuedRetired.fetch_add( pRing->m_ulQueued.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+	s_ulDroppedRetired.fetch_add( pRing->m_ulDropped.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+	ReleaseRing( pRing );
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Runs as each thread exits. The flusher retires the ring once it has
+//			drained what the thread left in it.
+//-----------------------------------------------------------------------------
+ThreadRing_t::~ThreadRing_t()
+{
+	if ( !m_pRing )
+		return;
+
+	m_pRing->m_bOwnerExited.store( true, std::memory_order_release );
+	ReleaseRing( m_pRing );
+	m_pRing = NULL;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns the calling thread's ring, creating it on first use
+//-----------------------------------------------------------------------------
+static DriverLogRing_t *GetThreadRing()
+{
+	uint32_t unGeneration = s_unGeneration.load( std::memory_order_acquire );
+	if ( t_threadRing.m_pRing && t_threadRing.m_unGeneration == unGeneration )
+		return t_threadRing.m_pRing;
+
+	// the cached ring was retired by CleanupDriverLog, and only this thread still refers to it
+	if ( t_threadRing.m_pRing )
+	{
+		ReleaseRing( t_threadRing.m_pRing );
+		t_threadRing.m_pRing = NULL;
+	}
+
+	std::lock_guard<std::mutex> lock( s_ringsMutex );
+	if ( !s_bRunning.load( std::memory_order_relaxed ) )
+		return NULL;
+
+	DriverLogRing_t *pRing = AllocRing();
+	if ( !pRing )
+		return NULL;
+	s_vecRings.push_back( pRing );
+
+	t_threadRing.m_pRing = pRing;
+	t_threadRing.m_unGeneration = s_unGeneration.load( std::memory_order_relaxed );
+	return pRing;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Reserves unCount consecutive records in the calling thread's ring
+//-----------------------------------------------------------------------------
+static DriverLogRing_t *ReserveRecords( uint32_t unCount, uint32_t *punHead )
+{
+	if ( !s_bRunning.load( std::memory_order_relaxed ) )
+		return NULL;
+
+	DriverLogRing_t *pRing = GetThreadRing();
+	if ( !pRing )
+		return NULL;
+
+	uint32_t unHead = pRing->m_unHead.load( std::memory_order_relaxed );
+	uint32_t unTail = pRing->m_unTail.load( std::memory_order_acquire );
+	if ( unHead - unTail + unCount > k_unRingRecords )
+	{
+		pRing->m_ulDropped.store( pRing->m_ulDropped.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+		return NULL;
+	}
+
+	*punHead = unHead;
+	return pRing;
+}
+
+
+static void PublishRecords( DriverLogRing_t *pRing, uint32_t unNewHead )
+{
+	pRing->m_ulQueued.store( pRing->m_ulQueued.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+	pRing->m_unHead.store( unNewHead, std::memory_order_release );
+}
+
+
+DriverLogRecord_t *driverlog::AcquireRecord( EDriverLogLevel eLevel )
+{
+	uint32_t unHead;
+	DriverLogRing_t *pRing = ReserveRecords( 1, &unHead );
+	if ( !pRing )
+		return NULL;
+
+	t_threadRing.m_unPendingHead = unHead;
+
+	DriverLogRecord_t *pRecord = &pRing->m_rgRecords[ unHead & ( k_unRingRecords - 1 ) ];
+	pRecord->unLevel = (uint32_t)eLevel;
+	return pRecord;
+}
+
+
+void driverlog::CommitRecord()
+{
+	PublishRecords( t_threadRing.m_pRing, t_threadRing.m_unPendingHead + 1 );
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Queues already formatted text, spread over as many records as needed
+//-----------------------------------------------------------------------------
+static void QueueText( EDriverLogLevel eLevel, const char *pchText, uint32_t unLength )
+{
+	uint32_t unCount = unLength == 0 ? 1 : ( unLength + k_unPayloadSize - 1 ) / k_unPayloadSize;
+
+	uint32_t unHead;
+	DriverLogRing_t *pRing = ReserveRecords( unCount, &unHead );
+	if ( !pRing )
+		return;
+
+	for ( uint32_t i = 0; i < unCount; i++ )
+	{
+		DriverLogRecord_t *pRecord = &pRing->m_rgRecords[ ( unHead + i ) & ( k_unRingRecords - 1 ) ];
+		uint32_t unChunk = unLength > k_unPayloadSize ? k_unPayloadSize : unLength;
+
+		pRecord->pfnFormat = NULL;
+		pRecord->pchFormat = NULL;
+		pRecord->unLevel = (uint32_t)eLevel | ( i + 1 < unCount ? k_unRecordFlag_Continued : 0 );
+		pRecord->unPayloadSize = unChunk;
+		memcpy( pRecord->rchPayload, pchText, unChunk );
+
+		pchText += unChunk;
+		unLength -= unChunk;
+	}
+
+	PublishRecords( pRing, unHead + unCount );
+}
+
+
+bool driverlog::CallsiteAllows( DriverLogCallsite_t *pCallsite, uint32_t unMaxPerSecond )
+{
+	uint64_t ulNow = (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+	uint64_t ulWindowStart = pCallsite->m_ulWindowStart.load( std::memory_order_relaxed );
+	if ( ulNow - ulWindowStart >= 1000 )
+	{
+		// only the thread that wins the exchange resets the count
+		if ( pCallsite->m_ulWindowStart.compare_exchange_strong( ulWindowStart, ulNow, std::memory_order_relaxed ) )
+			pCallsite->m_unCountInWindow.store( 0, std::memory_order_relaxed );
+	}
+
+	if ( pCallsite->m_unCountInWindow.fetch_add( 1, std::memory_order_relaxed ) < unMaxPerSecond )
+		return true;
+
+	s_ulRateLimited.fetch_add( 1, std::memory_order_relaxed );
+	return false;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Forwards everything currently queued in every ring to IVRDriverLog
+//-----------------------------------------------------------------------------
+static void DrainRings()
+{
+	std::lock_guard<std::mutex> drainLock( s_drainMutex );
+
+	std::vector<DriverLogRing_t *> vecRings;
+	{
+		std::lock_guard<std::mutex> lock( s_ringsMutex );
+		vecRings = s_vecRings;
+	}
+
+	char rchFormatted[ 1024 ];
+	std::string sPending;
+	bool bHaveExitedOwners = false;
+
+	for ( DriverLogRing_t *pRing : vecRings )
+	{
+		// read before the head, so a ring seen as orphaned has also been seen fully drained
+		bool bOwnerExited = pRing->m_bOwnerExited.load( std::memory_order_acquire );
+		bHaveExitedOwners = bHaveExitedOwners || bOwnerExited;
+
+		uint32_t unTail = pRing->m_unTail.load( std::memory_order_relaxed );
+		uint32_t unHead = pRing->m_unHead.load( std::memory_order_acquire );
+
+		while ( unTail != unHead )
+		{
+			const DriverLogRecord_t *pRecord = &pRing->m_rgRecords[ unTail & ( k_unRingRecords - 1 ) ];
+			unTail++;
+
+			if ( pRecord->pfnFormat )
+			{
+				pRecord->pfnFormat( pRecord->pchFormat, pRecord->rchPayload, rchFormatted, sizeof( rchFormatted ) );
+				sPending.append( rchFormatted );
+			}
+			else
+			{
+				sPending.append( pRecord->rchPayload, pRecord->unPayloadSize );
+			}
+
+			if ( pRecord->unLevel & k_unRecordFlag_Continued )
+				continue;
+
+			if ( s_pLogFile )
+				s_pLogFile->Log( sPending.c_str() );
+			s_ulWritten.fetch_add( 1, std::memory_order_relaxed );
+			sPending.clear();
+		}
+
+		pRing->m_unTail.store( unTail, std::memory_order_release );
+
+		uint64_t ulDropped = pRing->m_ulDropped.load( std::memory_order_relaxed );
+		if ( ulDropped != pRing->m_ulDroppedReported )
+		{
+			snprintf( rchFormatted, sizeof( rchFormatted ), "DriverLog: dropped %llu messages because the log buffer was full\n",
+				(unsigned long long)( ulDropped - pRing->m_ulDroppedReported ) );
+			if ( s_pLogFile )
+				s_pLogFile->Log( rchFormatted );
+			pRing->m_ulDroppedReported = ulDropped;
+		}
+	}
+
+	if ( !bHaveExitedOwners )
+		return;
+
+	// reclaim the rings of threads that have exited. Cleanup may have retired them already.
+	std::lock_guard<std::mutex> lock( s_ringsMutex );
+	for ( size_t i = 0; i < s_vecRings.size(); )
+	{
+		DriverLogRing_t *pRing = s_vecRings[ i ];
+		if ( pRing->m_bOwnerExited.load( std::memory_order_acquire )
+			&& pRing->m_unTail.load( std::memory_order_relaxed ) == pRing->m_unHead.load( std::memory_order_acquire ) )
+		{
+			s_vecRings[ i ] = s_vecRings.back();
+			s_vecRings.pop_back();
+			RetireRing( pRing );
+		}
+		else
+		{
+			i++;
+		}
+	}
+}
+
+
+static void FlusherThreadFunction()
+{
+	std::unique_lock<std::mutex> lock( s_flusherMutex );
+	while ( !s_bFlusherExiting )
+	{
+		lock.unlock();
+		DrainRings();
+		lock.lock();
+
+		s_flusherCondition.wait_for( lock, k_FlushInterval );
+	}
+}
+
+
 bool InitDriverLog( vr::IVRDriverLog *pDriverLog )
 {
 	if( s_pLogFile )
 		return false;
 	s_pLogFile = pDriverLog;
-	return s_pLogFile != NULL;
+	if ( !s_pLogFile )
+		return false;
+
+	{
+		std::lock_guard<std::mutex> lock( s_ringsMutex );
+		s_unGeneration.fetch_add( 1, std::memory_order_release );
+		s_bRunning.store( true, std::memory_order_release );
+	}
+
+	s_bFlusherExiting = false;
+	s_pFlusherThread = new std::thread( FlusherThreadFunction );
+	return true;
 }
 
 void CleanupDriverLog()
 {
+	if ( s_pFlusherThread )
+	{
+		{
+			std::lock_guard<std::mutex> lock( s_flusherMutex );
+			s_bFlusherExiting = true;
+		}
+		s_flusherCondition.notify_all();
+		s_pFlusherThread->join();
+		delete s_pFlusherThread;
+		s_pFlusherThread = NULL;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( s_ringsMutex );
+		s_bRunning.store( false, std::memory_order_release );
+		s_unGeneration.fetch_add( 1, std::memory_order_release );
+	}
+
+	// pick up anything queued before the rings were retired
+	DrainRings();
+
+	// Threads that are still running keep their rings alive until they notice the new
+	// generation on their next log call, or exit
+	{
+		std::lock_guard<std::mutex> drainLock( s_drainMutex );
+		std::lock_guard<std::mutex> lock( s_ringsMutex );
+		for ( DriverLogRing_t *pRing : s_vecRings )
+			RetireRing( pRing );
+		s_vecRings.clear();
+	}
+
+	if ( t_threadRing.m_pRing )
+	{
+		ReleaseRing( t_threadRing.m_pRing );
+		t_threadRing.m_pRing = NULL;
+	}
+
 	s_pLogFile = NULL;
 }
 
-static void DriverLogVarArgs( const char *pMsgFormat, va_list args )
+void FlushDriverLog()
 {
+	DrainRings();
+}
+
+void SetDriverLogLevel( EDriverLogLevel eLevel )
+{
+	g_nMinLevel.store( (int)eLevel, std::memory_order_relaxed );
+}
+
+void LoadDriverLogSettings( vr::IVRSettings *pSettings, const char *pchSection )
+{
+	if ( !pSettings )
+		return;
+
+	vr::EVRSettingsError eError = vr::VRSettingsError_None;
+	int32_t nLevel = pSettings->GetInt32( pchSection, k_pch_DriverLog_Level_Int32, &eError );
+	if ( eError != vr::VRSettingsError_None )
+		return;
+
+	if ( nLevel < DriverLogLevel_Debug )
+		nLevel = DriverLogLevel_Debug;
+	else if ( nLevel > DriverLogLevel_None )
+		nLevel = DriverLogLevel_None;
+	SetDriverLogLevel( (EDriverLogLevel)nLevel );
+}
+
+void GetDriverLogStats( DriverLogStats_t *pStats )
+{
+	memset( pStats, 0, sizeof( *pStats ) );
+	pStats->ulQueued = s_ulQueuedRetired.load( std::memory_order_relaxed );
+	pStats->ulDropped = s_ulDroppedRetired.load( std::memory_order_relaxed );
+
+	std::lock_guard<std::mutex> lock( s_ringsMutex );
+	for ( DriverLogRing_t *pRing : s_vecRings )
+	{
+		pStats->ulQueued += pRing->m_ulQueued.load( std::memory_order_relaxed );
+		pStats->ulDropped += pRing->m_ulDropped.load( std::memory_order_relaxed );
+	}
+	pStats->ulWritten = s_ulWritten.load( std::memory_order_relaxed );
+	pStats->ulRateLimited = s_ulRateLimited.load( std::memory_order_relaxed );
+}
+
+static void DriverLogVarArgs( EDriverLogLevel eLevel, const char *pMsgFormat, va_list args )
+{
+	if ( !IsLevelEnabled( eLevel ) )
+		return;
+
 	char buf[1024];
-	vsnprintf_s( buf, sizeof(buf), pMsgFormat, args );
+	int nLength = vsnprintf_s( buf, sizeof(buf), pMsgFormat, args );
+	if ( nLength < 0 )
+		return;
+	if ( nLength >= (int)sizeof( buf ) )
+		nLength = sizeof( buf ) - 1;
 
-	if( s_pLogFile )
-		s_pLogFile->Log( buf );
+	QueueText( eLevel, buf, (uint32_t)nLength );
 }
 
 
@@ -39,7 +516,18 @@ void DriverLog( const char *pMsgFormat, ... )
 	va_list args;
 	va_start( args, pMsgFormat );
 
-	DriverLogVarArgs( pMsgFormat, args );
+	DriverLogVarArgs( DriverLogLevel_Info, pMsgFormat, args );
+
+	va_end(args);
+}
+
+
+void DriverLogWithLevel( EDriverLogLevel eLevel, const char *pMsgFormat, ... )
+{
+	va_list args;
+	va_start( args, pMsgFormat );
+
+	DriverLogVarArgs( eLevel, pMsgFormat, args );
 
 	va_end(args);
 }
@@ -51,9 +539,11 @@ void DebugDriverLog( const char *pMsgFormat, ... )
 	va_list args;
 	va_start( args, pMsgFormat );
 
-	DriverLogVarArgs( pMsgFormat, args );
+	DriverLogVarArgs( DriverLogLevel_Debug, pMsgFormat, args );
 
 	va_end(args);
+#else
+	(void)pMsgFormat;
 #endif
 }
 
@@ -6,8 +6,31 @@
 #pragma once
 
 #include <string>
+#include <string.h>
+#include <stdint.h>
+#include <atomic>
+#include <tuple>
+#include <type_traits>
 #include <openvr_driver.h>
 
+// --------------------------------------------------------------------------
+// Log messages are queued into a lock-free ring buffer owned by the calling
+// thread and forwarded to IVRDriverLog by a background flusher thread, so
+// pose and input threads never block on the log sink.
+// --------------------------------------------------------------------------
+
+enum EDriverLogLevel
+{
+	DriverLogLevel_Debug = 0,
+	DriverLogLevel_Info = 1,
+	DriverLogLevel_Warning = 2,
+	DriverLogLevel_Error = 3,
+	DriverLogLevel_None = 4,
+};
+
+// keys for use with the settings API
+static const char * const k_pch_DriverLog_Level_Int32 = "logLevel";
+
 extern void DriverLog( const char *pchFormat, ... );
 
 
@@ -17,9 +40,222 @@ extern void DriverLog( const char *pchFormat, ... );
 extern void DebugDriverLog( const char *pchFormat, ... );
 
 
+// --------------------------------------------------------------------------
+// Purpose: Formats on the calling thread, then queues the message with the
+//			given severity
+// --------------------------------------------------------------------------
+extern void DriverLogWithLevel( EDriverLogLevel eLevel, const char *pchFormat, ... );
+
+
 extern bool InitDriverLog( vr::IVRDriverLog *pDriverLog );
 extern void CleanupDriverLog();
 
+// --------------------------------------------------------------------------
+// Purpose: Reads the minimum severity from the given settings section. Messages
+//			below it are rejected before they are queued.
+// --------------------------------------------------------------------------
+extern void LoadDriverLogSettings( vr::IVRSettings *pSettings, const char *pchSection );
+extern void SetDriverLogLevel( EDriverLogLevel eLevel );
+
+// --------------------------------------------------------------------------
+// Purpose: Blocks until everything queued so far has been handed to IVRDriverLog
+// --------------------------------------------------------------------------
+extern void FlushDriverLog();
+
+struct DriverLogStats_t
+{
+	uint64_t ulQueued;			// messages accepted into a ring buffer
+	uint64_t ulWritten;			// messages forwarded to IVRDriverLog
+	uint64_t ulDropped;			// messages lost because a ring buffer was full
+	uint64_t ulRateLimited;		// messages suppressed by a callsite rate limit
+	uint64_t ulFiltered;		// messages below the configured severity
+};
+
+extern void GetDriverLogStats( DriverLogStats_t *pStats );
+
+
+// --------------------------------------------------------------------------
+// Deferred formatting. Arguments are copied into the ring slot as raw values
+// (strings by content) and the printf-style formatting runs on the flusher
+// thread. Only arithmetic, enum, pointer and C string arguments are allowed.
+// --------------------------------------------------------------------------
+namespace driverlog
+{
+	static const uint32_t k_unRecordSize = 256;
+	static const uint32_t k_unPayloadSize = k_unRecordSize - 2 * sizeof( void * ) - 2 * sizeof( uint32_t );
+
+	typedef void ( *DriverLogFormatFn_t )( const char *pchFormat, const char *pPayload, char *pchOut, uint32_t unOutSize );
+
+	struct DriverLogRecord_t
+	{
+		DriverLogFormatFn_t pfnFormat;	// NULL if pPayload already holds the formatted text
+		const char *pchFormat;
+		uint32_t unLevel;
+		uint32_t unPayloadSize;
+		char rchPayload[ k_unPayloadSize ];
+	};
+
+	// Returns a slot in the calling thread's ring, or NULL if the message is
+	// filtered or the ring is full. Must be followed by CommitRecord.
+	extern DriverLogRecord_t *AcquireRecord( EDriverLogLevel eLevel );
+	extern void CommitRecord();
+
+	extern std::atomic<int> g_nMinLevel;
+
+	inline bool IsLevelEnabled( EDriverLogLevel eLevel )
+	{
+		return (int)eLevel >= g_nMinLevel.load( std::memory_order_relaxed );
+	}
+
+	// Per-callsite token bucket. Declared as a function-local static by
+	// DRIVER_LOG_RATE_LIMITED so each call site throttles independently.
+	struct DriverLogCallsite_t
+	{
+		std::atomic<uint64_t> m_ulWindowStart;
+		std::atomic<uint32_t> m_unCountInWindow;
+	};
+
+	extern bool CallsiteAllows( DriverLogCallsite_t *pCallsite, uint32_t unMaxPerSecond );
+
+	// how each argument type is stored in the payload
+	template < typename T, bool bEnum = std::is_enum<T>::value >
+	struct ArgTraits
+	{
+		static_assert( std::is_arithmetic<T>::value || std::is_pointer<T>::value, "DriverLogDeferred only accepts arithmetic, enum, pointer and C string arguments" );
+		// apply the default argument promotions now so the formatter sees what printf expects
+		typedef typename std::conditional< std::is_floating_point<T>::value, double,
+			typename std::conditional< std::is_integral<T>::value && sizeof( T ) < sizeof( int ), int, T >::type >::type StoredType;
+
+		static uint32_t Size( T ) { return sizeof( StoredType ); }
+		static char *Pack( char *pDst, T value )
+		{
+			StoredType stored = (StoredType)value;
+			memcpy( pDst, &stored, sizeof( stored ) );
+			return pDst + sizeof( stored );
+		}
+		static StoredType Unpack( const char *&pSrc )
+		{
+			StoredType stored;
+			memcpy( &stored, pSrc, sizeof( stored ) );
+			pSrc += sizeof( stored );
+			return stored;
+		}
+	};
+
+	template < typename T >
+	struct ArgTraits< T, true >
+	{
+		typedef int StoredType;
+		static uint32_t Size( T ) { return sizeof( int ); }
+		static char *Pack( char *pDst, T value ) { return ArgTraits<int>::Pack( pDst, (int)value ); }
+		static int Unpack( const char *&pSrc ) { return ArgTraits<int>::Unpack( pSrc ); }
+	};
+
+	struct StringArgTraits
+	{
+		typedef const char *StoredType;
+		static uint32_t Size( const char *pch ) { return (uint32_t)( sizeof( uint16_t ) + ( pch ? strlen( pch ) : 6 ) + 1 ); }
+		static char *Pack( char *pDst, const char *pch )
+		{
+			if ( !pch )
+				pch = "(null)";
+			uint16_t unLen = (uint16_t)strlen( pch );
+			memcpy( pDst, &unLen, sizeof( unLen ) );
+			memcpy( pDst + sizeof( unLen ), pch, unLen + 1 );
+			return pDst + sizeof( unLen ) + unLen + 1;
+		}
+		static const char *Unpack( const char *&pSrc )
+		{
+			uint16_t unLen;
+			memcpy( &unLen, pSrc, sizeof( unLen ) );
+			const char *pch = pSrc + sizeof( unLen );
+			pSrc += sizeof( unLen ) + unLen + 1;
+			return pch;
+		}
+	};
+
+	template <> struct ArgTraits< const char *, false > : public StringArgTraits {};
+	template <> struct ArgTraits< char *, false > : public StringArgTraits {};
+
+	template < typename T >
+	struct ArgTraitsFor : public ArgTraits< typename std::decay<T>::type > {};
+
+	inline uint32_t PayloadSize() { return 0; }
+	template < typename T, typename... Rest >
+	uint32_t PayloadSize( T first, Rest... rest ) { return ArgTraitsFor<T>::Size( first ) + PayloadSize( rest... ); }
+
+	inline void PackArgs( char * ) {}
+	template < typename T, typename... Rest >
+	void PackArgs( char *pDst, T first, Rest... rest ) { PackArgs( ArgTraitsFor<T>::Pack( pDst, first ), rest... ); }
+
+	template < uint32_t... N > struct IndexList_t {};
+	template < uint32_t N, uint32_t... S > struct MakeIndexList : MakeIndexList< N - 1, N - 1, S... > {};
+	template < uint32_t... S > struct MakeIndexList< 0, S... > { typedef IndexList_t< S... > type; };
+
+	template < typename Tuple, uint32_t... N >
+	void FormatTuple( const char *pchFormat, const Tuple &args, char *pchOut, uint32_t unOutSize, IndexList_t< N... > )
+	{
+#if defined( __GNUC__ )
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#pragma GCC diagnostic ignored "-Wformat-security"
+#endif
+		snprintf( pchOut, unOutSize, pchFormat, std::get< N >( args )... );
+#if defined( __GNUC__ )
+#pragma GCC diagnostic pop
+#endif
+	}
+
+	template < typename... Args >
+	void FormatPayload( const char *pchFormat, const char *pPayload, char *pchOut, uint32_t unOutSize )
+	{
+		// braced initialization guarantees left-to-right unpacking
+		std::tuple< typename ArgTraitsFor<Args>::StoredType... > args{ ArgTraitsFor<Args>::Unpack( pPayload )... };
+		FormatTuple( pchFormat, args, pchOut, unOutSize, typename MakeIndexList< sizeof...( Args ) >::type() );
+	}
+}
+
+
+// --------------------------------------------------------------------------
+// Purpose: Queues the format string and a copy of the arguments. pchFormat
+//			must be a string literal since it is read later by the flusher.
+//			Messages whose arguments don't fit in a ring slot are formatted
+//			immediately instead.
+// --------------------------------------------------------------------------
+template < typename... Args >
+void DriverLogDeferred( EDriverLogLevel eLevel, const char *pchFormat, Args... args )
+{
+	if ( !driverlog::IsLevelEnabled( eLevel ) )
+		return;
+
+	uint32_t unSize = driverlog::PayloadSize( args... );
+	if ( unSize > driverlog::k_unPayloadSize )
+	{
+		DriverLogWithLevel( eLevel, pchFormat, args... );
+		return;
+	}
+
+	driverlog::DriverLogRecord_t *pRecord = driverlog::AcquireRecord( eLevel );
+	if ( !pRecord )
+		return;
+
+	pRecord->pfnFormat = &driverlog::FormatPayload< Args... >;
+	pRecord->pchFormat = pchFormat;
+	pRecord->unPayloadSize = unSize;
+	driverlog::PackArgs( pRecord->rchPayload, args... );
+	driverlog::CommitRecord();
+}
+
+// --------------------------------------------------------------------------
+// Purpose: Deferred log limited to unMaxPerSecond messages from this call site
+// --------------------------------------------------------------------------
+#define DRIVER_LOG_RATE_LIMITED( eLevel, unMaxPerSecond, pchFormat, ... ) \
+	do \
+	{ \
+		static driverlog::DriverLogCallsite_t s_callsite; \
+		if ( driverlog::IsLevelEnabled( eLevel ) && driverlog::CallsiteAllows( &s_callsite, unMaxPerSecond ) ) \
+			DriverLogDeferred( eLevel, pchFormat, ##__VA_ARGS__ ); \
+	} while ( 0 )
 
 
 #endif // DRIVERLOG_H
@@ -0,0 +1,417 @@
+//========= Copyright Valve Corporation ============//
+
+#include "handskeleton.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#include <emmintrin.h>
+#define HANDSKELETON_SSE2 1
+#endif
+
+// below this angle slerp degenerates and a plain lerp is just as accurate
+static const float k_flMinSlerpAngle = 1e-4f;
+
+static const uint8_t k_rgBoneFinger[ HandSkeletonBone_Count ] =
+{
+	HandFinger_Count, HandFinger_Count,										// root, wrist
+	HandFinger_Thumb, HandFinger_Thumb, HandFinger_Thumb, HandFinger_Thumb,
+	HandFinger_Index, HandFinger_Index, HandFinger_Index, HandFinger_Index, HandFinger_Index,
+	HandFinger_Middle, HandFinger_Middle, HandFinger_Middle, HandFinger_Middle, HandFinger_Middle,
+	HandFinger_Ring, HandFinger_Ring, HandFinger_Ring, HandFinger_Ring, HandFinger_Ring,
+	HandFinger_Pinky, HandFinger_Pinky, HandFinger_Pinky, HandFinger_Pinky, HandFinger_Pinky,
+	HandFinger_Thumb, HandFinger_Index, HandFinger_Middle, HandFinger_Ring, HandFinger_Pinky,	// aux bones
+};
+
+
+//-----------------------------------------------------------------------------
+// Purpose: sin(x) for x in [0, pi/2], which is all slerp needs once the two
+//			rotations are in the same hemisphere. Max error is about 4e-6.
+//-----------------------------------------------------------------------------
+static inline float SinHalfPi( float x )
+{
+	float x2 = x * x;
+	return x * ( 1.f + x2 * ( -1.f / 6.f + x2 * ( 1.f / 120.f + x2 * ( -1.f / 5040.f + x2 * ( 1.f / 362880.f ) ) ) ) );
+}
+
+#if defined( HANDSKELETON_SSE2 )
+static inline __m128 SinHalfPi( __m128 x )
+{
+	__m128 x2 = _mm_mul_ps( x, x );
+	__m128 r = _mm_set1_ps( 1.f / 362880.f );
+	r = _mm_add_ps( _mm_mul_ps( r, x2 ), _mm_set1_ps( -1.f / 5040.f ) );
+	r = _mm_add_ps( _mm_mul_ps( r, x2 ), _mm_set1_ps( 1.f / 120.f ) );
+	r = _mm_add_ps( _mm_mul_ps( r, x2 ), _mm_set1_ps( -1.f / 6.f ) );
+	r = _mm_add_ps( _mm_mul_ps( r, x2 ), _mm_set1_ps( 1.f ) );
+	return _mm_mul_ps( r, x );
+}
+#endif
+
+
+//-----------------------------------------------------------------------------
+// Sample hand. Lengths are in meters, flex angles in degrees toward the palm.
+//-----------------------------------------------------------------------------
+struct SampleFinger_t
+{
+	float rflBase[ 3 ];			// first bone in wrist space
+	float flSplay;				// rotation of the first bone about the wrist's Y axis
+	float rflLength[ 4 ];		// metacarpal to distal; the thumb has no fourth bone
+	float rflOpenFlex[ 4 ];		// flat hand
+	float rflGripFlex[ 4 ];		// resting on a controller grip
+	float rflFistFlex[ 4 ];
+};
+
+static const SampleFinger_t k_rgSampleFingers[ HandFinger_Count ] =
+{
+	// thumb
+	{ { 0.017f, 0.025f, 0.020f }, 40.f, { 0.045f, 0.033f, 0.028f, 0.f }, { 5.f, 5.f, 5.f, 0.f }, { 20.f, 25.f, 20.f, 0.f }, { 35.f, 45.f, 50.f, 0.f } },
+	// index
+	{ { 0.000f, 0.022f, 0.000f }, 8.f, { 0.070f, 0.042f, 0.025f, 0.020f }, { 2.f, 5.f, 5.f, 2.f }, { 5.f, 45.f, 40.f, 20.f }, { 10.f, 80.f, 95.f, 60.f } },
+	// middle
+	{ { 0.000f, 0.007f, 0.000f }, 2.f, { 0.068f, 0.046f, 0.028f, 0.021f }, { 2.f, 5.f, 5.f, 2.f }, { 5.f, 55.f, 50.f, 25.f }, { 10.f, 85.f, 100.f, 60.f } },
+	// ring
+	{ { 0.000f, -0.008f, 0.000f }, -4.f, { 0.064f, 0.042f, 0.027f, 0.020f }, { 2.f, 5.f, 5.f, 2.f }, { 5.f, 60.f, 55.f, 25.f }, { 12.f, 90.f, 100.f, 60.f } },
+	// pinky
+	{ { 0.000f, -0.022f, 0.000f }, -10.f, { 0.058f, 0.033f, 0.021f, 0.018f }, { 2.f, 5.f, 5.f, 2.f }, { 8.f, 65.f, 55.f, 25.f }, { 15.f, 95.f, 95.f, 60.f } },
+};
+
+static const uint32_t k_rgFirstFingerBone[ HandFinger_Count ] =
+{
+	HandSkeletonBone_Thumb0, HandSkeletonBone_IndexFinger0, HandSkeletonBone_MiddleFinger0, HandSkeletonBone_RingFinger0, HandSkeletonBone_PinkyFinger0,
+};
+
+// where the wrist sits relative to the tracked controller origin, for the left hand
+static const float k_rgflSampleWristPosition[ 3 ] = { -0.034f, 0.036f, 0.165f };
+
+static const float k_flDegreesToRadians = 3.14159265f / 180.f;
+
+static vr::HmdQuaternionf_t QuatFromAxisAngle( float x, float y, float z, float flDegrees )
+{
+	float flHalf = 0.5f * flDegrees * k_flDegreesToRadians;
+	float flSin = sinf( flHalf );
+	vr::HmdQuaternionf_t q;
+	q.w = cosf( flHalf );
+	q.x = x * flSin;
+	q.y = y * flSin;
+	q.z = z * flSin;
+	return q;
+}
+
+static vr::HmdQuaternionf_t QuatMultiply( const vr::HmdQuaternionf_t &a, const vr::HmdQuaternionf_t &b )
+{
+	vr::HmdQuaternionf_t q;
+	q.w = a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z;
+	q.x = a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y;
+	q.y = a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x;
+	q.z = a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w;
+	return q;
+}
+
+static void QuatRotate( const vr::HmdQuaternionf_t &q, const float *pflIn, float *pflOut )
+{
+	// v + 2w(u x v) + 2u x (u x v)
+	float tx = 2.f * ( q.y * pflIn[ 2 ] - q.z * pflIn[ 1 ] );
+	float ty = 2.f * ( q.z * pflIn[ 0 ] - q.x * pflIn[ 2 ] );
+	float tz = 2.f * ( q.x * pflIn[ 1 ] - q.y * pflIn[ 0 ] );
+	pflOut[ 0 ] = pflIn[ 0 ] + q.w * tx + ( q.y * tz - q.z * ty );
+	pflOut[ 1 ] = pflIn[ 1 ] + q.w * ty + ( q.z * tx - q.x * tz );
+	pflOut[ 2 ] = pflIn[ 2 ] + q.w * tz + ( q.x * ty - q.y * tx );
+}
+
+static void SetBone( vr::VRBoneTransform_t *pBone, const float *pflPosition, const vr::HmdQuaternionf_t &orientation )
+{
+	pBone->position.v[ 0 ] = pflPosition[ 0 ];
+	pBone->position.v[ 1 ] = pflPosition[ 1 ];
+	pBone->position.v[ 2 ] = pflPosition[ 2 ];
+	pBone->position.v[ 3 ] = 1.f;
+	pBone->orientation = orientation;
+}
+
+
+void BuildSampleHandPose( bool bRightHand, vr::EVRSkeletalMotionRange eRange, bool bCurled, vr::VRBoneTransform_t *pBones )
+{
+	static const float k_rgflZero[ 3 ] = { 0.f, 0.f, 0.f };
+	const vr::HmdQuaternionf_t identity = { 1.f, 0.f, 0.f, 0.f };
+
+	SetBone( &pBones[ HandSkeletonBone_Root ], k_rgflZero, identity );
+	SetBone( &pBones[ HandSkeletonBone_Wrist ], k_rgflSampleWristPosition, identity );
+
+	for ( uint32_t f = 0; f < HandFinger_Count; f++ )
+	{
+		const SampleFinger_t &finger = k_rgSampleFingers[ f ];
+		const float *pflFlex = bCurled ? finger.rflFistFlex
+			: ( eRange == vr::VRSkeletalMotionRange_WithController ? finger.rflGripFlex : finger.rflOpenFlex );
+		uint32_t unJoints = f == HandFinger_Thumb ? 3 : 4;
+		uint32_t unFirst = k_rgFirstFingerBone[ f ];
+
+		// walk the chain in root space as well, for the aux bone
+		vr::HmdQuaternionf_t rootOrientation = identity;
+		float rgflRootPosition[ 3 ] = { k_rgflSampleWristPosition[ 0 ], k_rgflSampleWristPosition[ 1 ], k_rgflSampleWristPosition[ 2 ] };
+
+		for ( uint32_t j = 0; j <= unJoints; j++ )
+		{
+			float rgflPosition[ 3 ] = { finger.rflBase[ 0 ], finger.rflBase[ 1 ], finger.rflBase[ 2 ] };
+			if ( j > 0 )
+			{
+				rgflPosition[ 0 ] = finger.rflLength[ j - 1 ];
+				rgflPosition[ 1 ] = rgflPosition[ 2 ] = 0.f;
+			}
+
+			// the tip bone only marks the end of the chain
+			vr::HmdQuaternionf_t orientation = j < unJoints ? QuatFromAxisAngle( 0.f, 0.f, 1.f, -pflFlex[ j ] ) : identity;
+			if ( j == 0 )
+				orientation = QuatMultiply( QuatFromAxisAngle( 0.f, 1.f, 0.f, finger.flSplay ), orientation );
+			SetBone( &pBones[ unFirst + j ], rgflPosition, orientation );
+
+			float rgflOffset[ 3 ];
+			QuatRotate( rootOrientation, rgflPosition, rgflOffset );
+			for ( uint32_t c = 0; c < 3; c++ )
+				rgflRootPosition[ c ] += rgflOffset[ c ];
+			rootOrientation = QuatMultiply( rootOrientation, orientation );
+
+			if ( j + 1 == unJoints )
+				SetBone( &pBones[ HandSkeletonBone_Aux_Thumb + f ], rgflRootPosition, rootOrientation );
+		}
+	}
+
+	if ( !bRightHand )
+		return;
+
+	// mirror across the YZ plane
+	for ( uint32_t i = 0; i < HandSkeletonBone_Count; i++ )
+	{
+		pBones[ i ].position.v[ 0 ] = -pBones[ i ].position.v[ 0 ];
+		pBones[ i ].orientation.y = -pBones[ i ].orientation.y;
+		pBones[ i ].orientation.z = -pBones[ i ].orientation.z;
+	}
+}
+
+
+CHandSkeletonModel::CHandSkeletonModel()
+{
+	memset( m_rgRanges, 0, sizeof( m_rgRanges ) );
+
+	for ( uint32_t i = 0; i < k_unPaddedBones; i++ )
+	{
+		m_rgBoneFinger[ i ] = i < HandSkeletonBone_Count ? k_rgBoneFinger[ i ] : (uint8_t)HandFinger_Count;
+		for ( uint32_t r = 0; r < k_unHandSkeletonMotionRangeCount; r++ )
+		{
+			m_rgRanges[ r ].rflOpenRot[ 0 ][ i ] = 1.f;
+			m_rgRanges[ r ].rflCurledRot[ 0 ][ i ] = 1.f;
+		}
+	}
+}
+
+
+void CHandSkeletonModel::SetReferencePoses( vr::EVRSkeletalMotionRange eRange, const vr::VRBoneTransform_t *pOpen, const vr::VRBoneTransform_t *pCurled )
+{
+	if ( (uint32_t)eRange >= k_unHandSkeletonMotionRangeCount )
+		return;
+
+	RangeData_t &range = m_rgRanges[ eRange ];
+	for ( uint32_t i = 0; i < HandSkeletonBone_Count; i++ )
+	{
+		const vr::VRBoneTransform_t &open = pOpen[ i ];
+		const vr::VRBoneTransform_t &curled = pCurled[ i ];
+
+		for ( uint32_t c = 0; c < 3; c++ )
+		{
+			range.rflOpenPos[ c ][ i ] = open.position.v[ c ];
+			range.rflCurledPos[ c ][ i ] = curled.position.v[ c ];
+		}
+
+		float rflOpen[ 4 ] = { open.orientation.w, open.orientation.x, open.orientation.y, open.orientation.z };
+		float rflCurled[ 4 ] = { curled.orientation.w, curled.orientation.x, curled.orientation.y, curled.orientation.z };
+
+		// take the short way around
+		float flDot = rflOpen[ 0 ] * rflCurled[ 0 ] + rflOpen[ 1 ] * rflCurled[ 1 ] + rflOpen[ 2 ] * rflCurled[ 2 ] + rflOpen[ 3 ] * rflCurled[ 3 ];
+		if ( flDot < 0.f )
+		{
+			flDot = -flDot;
+			for ( uint32_t c = 0; c < 4; c++ )
+				rflCurled[ c ] = -rflCurled[ c ];
+		}
+		if ( flDot > 1.f )
+			flDot = 1.f;
+
+		float flAngle = acosf( flDot );
+		for ( uint32_t c = 0; c < 4; c++ )
+		{
+			range.rflOpenRot[ c ][ i ] = rflOpen[ c ];
+			range.rflCurledRot[ c ][ i ] = rflCurled[ c ];
+		}
+		range.rflAngle[ i ] = flAngle;
+		range.rflInvSinAngle[ i ] = flAngle > k_flMinSlerpAngle ? 1.f / sinf( flAngle ) : 0.f;
+	}
+}
+
+
+void CHandSkeletonModel::SetSampleHandPoses( bool bRightHand )
+{
+	for ( uint32_t r = 0; r < k_unHandSkeletonMotionRangeCount; r++ )
+	{
+		vr::VRBoneTransform_t rgOpen[ HandSkeletonBone_Count ];
+		vr::VRBoneTransform_t rgCurled[ HandSkeletonBone_Count ];
+		BuildSampleHandPose( bRightHand, (vr::EVRSkeletalMotionRange)r, false, rgOpen );
+		BuildSampleHandPose( bRightHand, (vr::EVRSkeletalMotionRange)r, true, rgCurled );
+		SetReferencePoses( (vr::EVRSkeletalMotionRange)r, rgOpen, rgCurled );
+	}
+}
+
+
+void CHandSkeletonModel::Synthesize( const HandCurls_t &curls, vr::VRBoneTransform_t *ppOutput[ k_unHandSkeletonMotionRangeCount ] ) const
+{
+	float rflT[ k_unPaddedBones ];
+	for ( uint32_t i = 0; i < k_unPaddedBones; i++ )
+	{
+		uint8_t unFinger = m_rgBoneFinger[ i ];
+		float flCurl = unFinger < HandFinger_Count ? curls.rflCurl[ unFinger ] : 0.f;
+		rflT[ i ] = flCurl < 0.f ? 0.f : ( flCurl > 1.f ? 1.f : flCurl );
+	}
+
+	for ( uint32_t r = 0; r < k_unHandSkeletonMotionRangeCount; r++ )
+	{
+		const RangeData_t &range = m_rgRanges[ r ];
+		float rflPos[ 3 ][ k_unPaddedBones ];
+		float rflRot[ 4 ][ k_unPaddedBones ];
+
+#if defined( HANDSKELETON_SSE2 )
+		const __m128 vOne = _mm_set1_ps( 1.f );
+		const __m128 vZero = _mm_setzero_ps();
+		for ( uint32_t i = 0; i < k_unPaddedBones; i += 4 )
+		{
+			__m128 vT = _mm_loadu_ps( &rflT[ i ] );
+			__m128 vOneMinusT = _mm_sub_ps( vOne, vT );
+
+			for ( uint32_t c = 0; c < 3; c++ )
+			{
+				__m128 vOpen = _mm_loadu_ps( &range.rflOpenPos[ c ][ i ] );
+				__m128 vCurled = _mm_loadu_ps( &range.rflCurledPos[ c ][ i ] );
+				_mm_storeu_ps( &rflPos[ c ][ i ], _mm_add_ps( vOpen, _mm_mul_ps( vT, _mm_sub_ps( vCurled, vOpen ) ) ) );
+			}
+
+			__m128 vAngle = _mm_loadu_ps( &range.rflAngle[ i ] );
+			__m128 vInvSin = _mm_loadu_ps( &range.rflInvSinAngle[ i ] );
+			__m128 vW0 = _mm_mul_ps( SinHalfPi( _mm_mul_ps( vOneMinusT, vAngle ) ), vInvSin );
+			__m128 vW1 = _mm_mul_ps( SinHalfPi( _mm_mul_ps( vT, vAngle ) ), vInvSin );
+
+			// lanes with a tiny angle fall back to lerp weights
+			__m128 vLerp = _mm_cmpeq_ps( vInvSin, vZero );
+			vW0 = _mm_or_ps( _mm_and_ps( vLerp, vOneMinusT ), _mm_andnot_ps( vLerp, vW0 ) );
+			vW1 = _mm_or_ps( _mm_and_ps( vLerp, vT ), _mm_andnot_ps( vLerp, vW1 ) );
+
+			for ( uint32_t c = 0; c < 4; c++ )
+			{
+				__m128 vOpen = _mm_loadu_ps( &range.rflOpenRot[ c ][ i ] );
+				__m128 vCurled = _mm_loadu_ps( &range.rflCurledRot[ c ][ i ] );
+				_mm_storeu_ps( &rflRot[ c ][ i ], _mm_add_ps( _mm_mul_ps( vW0, vOpen ), _mm_mul_ps( vW1, vCurled ) ) );
+			}
+		}
+#else
+		for ( uint32_t i = 0; i < k_unPaddedBones; i++ )
+		{
+			float flT = rflT[ i ];
+			for ( uint32_t c = 0; c < 3; c++ )
+				rflPos[ c ][ i ] = range.rflOpenPos[ c ][ i ] + flT * ( range.rflCurledPos[ c ][ i ] - range.rflOpenPos[ c ][ i ] );
+
+			float flW0 = 1.f - flT;
+			float flW1 = flT;
+			if ( range.rflInvSinAngle[ i ] != 0.f )
+			{
+				flW0 = SinHalfPi( ( 1.f - flT ) * range.rflAngle[ i ] ) * range.rflInvSinAngle[ i ];
+				flW1 = SinHalfPi( flT * range.rflAngle[ i ] ) * range.rflInvSinAngle[ i ];
+			}
+			for ( uint32_t c = 0; c < 4; c++ )
+				rflRot[ c ][ i ] = flW0 * range.rflOpenRot[ c ][ i ] + flW1 * range.rflCurledRot[ c ][ i ];
+		}
+#endif
+
+		vr::VRBoneTransform_t *pOut = ppOutput[ r ];
+		for ( uint32_t i = 0; i < HandSkeletonBone_Count; i++ )
+		{
+			pOut[ i ].position.v[ 0 ] = rflPos[ 0 ][ i ];
+			pOut[ i ].position.v[ 1 ] = rflPos[ 1 ][ i ];
+			pOut[ i ].position.v[ 2 ] = rflPos[ 2 ][ i ];
+			pOut[ i ].position.v[ 3 ] = 1.f;
+			pOut[ i ].orientation.w = rflRot[ 0 ][ i ];
+			pOut[ i ].orientation.x = rflRot[ 1 ][ i ];
+			pOut[ i ].orientation.y = rflRot[ 2 ][ i ];
+			pOut[ i ].orientation.z = rflRot[ 3 ][ i ];
+		}
+	}
+}
+
+
+CHandSkeletonSynthesizer::CHandSkeletonSynthesizer( const CHandSkeletonModel *pModel, uint32_t unBitsPerCurl, uint32_t unCacheEntries )
+	: m_pModel( pModel )
+{
+	// five curls have to fit in the 63 key bits
+	if ( unBitsPerCurl < 1 )
+		unBitsPerCurl = 1;
+	else if ( unBitsPerCurl > 12 )
+		unBitsPerCurl = 12;
+	m_unBitsPerCurl = unBitsPerCurl;
+
+	uint32_t unEntries = 1;
+	while ( unEntries < unCacheEntries )
+		unEntries <<= 1;
+	m_unCacheMask = unEntries - 1;
+
+	CacheEntry_t empty;
+	memset( &empty, 0, sizeof( empty ) );
+	m_vecCache.resize( unEntries, empty );
+	memset( &m_stats, 0, sizeof( m_stats ) );
+}
+
+
+void CHandSkeletonSynthesizer::GetBones( const HandCurls_t &curls, const vr::VRBoneTransform_t **ppWithController, const vr::VRBoneTransform_t **ppWithoutController )
+{
+	const uint32_t unMaxStep = ( 1u << m_unBitsPerCurl ) - 1;
+
+	// the key is the quantized curls; synthesizing from the quantized values keeps cached and fresh results identical
+	uint64_t ulKey = 1ull << 63;
+	HandCurls_t quantized;
+	for ( uint32_t f = 0; f < HandFinger_Count; f++ )
+	{
+		float flCurl = curls.rflCurl[ f ];
+		flCurl = flCurl < 0.f ? 0.f : ( flCurl > 1.f ? 1.f : flCurl );
+		uint32_t unStep = (uint32_t)( flCurl * unMaxStep + 0.5f );
+		ulKey |= (uint64_t)unStep << ( f * m_unBitsPerCurl );
+		quantized.rflCurl[ f ] = (float)unStep / (float)unMaxStep;
+	}
+
+	uint32_t unSlot = (uint32_t)( ( ulKey * 0x9E3779B97F4A7C15ull ) >> 32 ) & m_unCacheMask;
+	CacheEntry_t &entry = m_vecCache[ unSlot ];
+	if ( entry.m_ulKey == ulKey )
+	{
+		m_stats.ulHits++;
+	}
+	else
+	{
+		m_stats.ulMisses++;
+		vr::VRBoneTransform_t *rgOutput[ k_unHandSkeletonMotionRangeCount ] =
+		{
+			entry.m_rgBones[ vr::VRSkeletalMotionRange_WithController ],
+			entry.m_rgBones[ vr::VRSkeletalMotionRange_WithoutController ],
+		};
+		m_pModel->Synthesize( quantized, rgOutput );
+		entry.m_ulKey = ulKey;
+	}
+
+	*ppWithController = entry.m_rgBones[ vr::VRSkeletalMotionRange_WithController ];
+	*ppWithoutController = entry.m_rgBones[ vr::VRSkeletalMotionRange_WithoutController ];
+}
+
+
+vr::EVRInputError CHandSkeletonSynthesizer::UpdateSkeletonComponent( vr::IVRDriverInput *pDriverInput, vr::VRInputComponentHandle_t ulComponent, const HandCurls_t &curls )
+{
+	const vr::VRBoneTransform_t *pWithController;
+	const vr::VRBoneTransform_t *pWithoutController;
+	GetBones( curls, &pWithController, &pWithoutController );
+
+	vr::EVRInputError eError = pDriverInput->UpdateSkeletonComponent( ulComponent, vr::VRSkeletalMotionRange_WithController, pWithController, HandSkeletonBone_Count );
+	if ( eError != vr::VRInputError_None )
+		return eError;
+	return pDriverInput->UpdateSkeletonComponent( ulComponent, vr::VRSkeletalMotionRange_WithoutController, pWithoutController, HandSkeletonBone_Count );
+}
@@ -0,0 +1,155 @@
+//========= Copyright Valve Corporation ============//
+
+#ifndef HANDSKELETON_H
+#define HANDSKELETON_H
+
+#pragma once
+
+#include <openvr_driver.h>
+
+#include <vector>
+
+// --------------------------------------------------------------------------
+// Bone layout of the SteamVR hand skeleton (/skeleton/hand/left and right)
+// --------------------------------------------------------------------------
+enum EHandSkeletonBone
+{
+	HandSkeletonBone_Root = 0,
+	HandSkeletonBone_Wrist,
+	HandSkeletonBone_Thumb0,
+	HandSkeletonBone_Thumb1,
+	HandSkeletonBone_Thumb2,
+	HandSkeletonBone_Thumb3,
+	HandSkeletonBone_IndexFinger0,
+	HandSkeletonBone_IndexFinger1,
+	HandSkeletonBone_IndexFinger2,
+	HandSkeletonBone_IndexFinger3,
+	HandSkeletonBone_IndexFinger4,
+	HandSkeletonBone_MiddleFinger0,
+	HandSkeletonBone_MiddleFinger1,
+	HandSkeletonBone_MiddleFinger2,
+	HandSkeletonBone_MiddleFinger3,
+	HandSkeletonBone_MiddleFinger4,
+	HandSkeletonBone_RingFinger0,
+	HandSkeletonBone_RingFinger1,
+	HandSkeletonBone_RingFinger2,
+	HandSkeletonBone_RingFinger3,
+	HandSkeletonBone_RingFinger4,
+	HandSkeletonBone_PinkyFinger0,
+	HandSkeletonBone_PinkyFinger1,
+	HandSkeletonBone_PinkyFinger2,
+	HandSkeletonBone_PinkyFinger3,
+	HandSkeletonBone_PinkyFinger4,
+	HandSkeletonBone_Aux_Thumb,
+	HandSkeletonBone_Aux_IndexFinger,
+	HandSkeletonBone_Aux_MiddleFinger,
+	HandSkeletonBone_Aux_RingFinger,
+	HandSkeletonBone_Aux_PinkyFinger,
+	HandSkeletonBone_Count
+};
+
+enum EHandFinger
+{
+	HandFinger_Thumb = 0,
+	HandFinger_Index,
+	HandFinger_Middle,
+	HandFinger_Ring,
+	HandFinger_Pinky,
+	HandFinger_Count
+};
+
+static const uint32_t k_unHandSkeletonMotionRangeCount = 2;
+
+/** 0 is the open reference pose, 1 the curled reference pose */
+struct HandCurls_t
+{
+	float rflCurl[ HandFinger_Count ];
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Reference poses for both motion ranges, precomputed for blending.
+//			Immutable once built so any number of synthesizers can share one.
+//-----------------------------------------------------------------------------
+class CHandSkeletonModel
+{
+public:
+	CHandSkeletonModel();
+
+	/** pOpen and pCurled are HandSkeletonBone_Count parent-relative transforms */
+	void SetReferencePoses( vr::EVRSkeletalMotionRange eRange, const vr::VRBoneTransform_t *pOpen, const vr::VRBoneTransform_t *pCurled );
+
+	/** Loads the reference poses of the sample hand below for both motion ranges */
+	void SetSampleHandPoses( bool bRightHand );
+
+	/** Writes the blended pose for every motion range. ppOutput[ eRange ] receives HandSkeletonBone_Count bones. */
+	void Synthesize( const HandCurls_t &curls, vr::VRBoneTransform_t *ppOutput[ k_unHandSkeletonMotionRangeCount ] ) const;
+
+	// bones are padded up to a multiple of the SIMD width
+	static const uint32_t k_unPaddedBones = ( HandSkeletonBone_Count + 3 ) & ~3u;
+
+private:
+	// structure of arrays so four bones blend per instruction
+	struct RangeData_t
+	{
+		float rflOpenPos[ 3 ][ k_unPaddedBones ];
+		float rflCurledPos[ 3 ][ k_unPaddedBones ];
+		float rflOpenRot[ 4 ][ k_unPaddedBones ];	// w, x, y, z
+		float rflCurledRot[ 4 ][ k_unPaddedBones ];	// sign-aligned with the open rotation
+		float rflAngle[ k_unPaddedBones ];			// angle between the two rotations
+		float rflInvSinAngle[ k_unPaddedBones ];	// 0 when the rotations are close enough to lerp
+	};
+
+	RangeData_t m_rgRanges[ k_unHandSkeletonMotionRangeCount ];
+
+	// which finger curl drives each bone, or HandFinger_Count for bones that never move
+	uint8_t m_rgBoneFinger[ k_unPaddedBones ];
+};
+
+
+/** Reference poses of a generic adult hand, laid out like the SteamVR skeleton: each bone is parent
+* relative with the bone pointing along +X for the left hand and -X for the right, and the aux
+* bones are the distal joints in root space. Proportions are approximate; drivers for real hardware
+* should use poses captured from their own hand model. */
+void BuildSampleHandPose( bool bRightHand, vr::EVRSkeletalMotionRange eRange, bool bCurled, vr::VRBoneTransform_t *pBones );
+
+
+struct HandSkeletonCacheStats_t
+{
+	uint64_t ulHits;
+	uint64_t ulMisses;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Quantizes finger curls and caches the synthesized bones for both
+//			motion ranges. One instance per hand; not thread safe.
+//-----------------------------------------------------------------------------
+class CHandSkeletonSynthesizer
+{
+public:
+	/** unBitsPerCurl controls the quantization step (1 / 2^bits). unCacheEntries is rounded up to a power of two. */
+	CHandSkeletonSynthesizer( const CHandSkeletonModel *pModel, uint32_t unBitsPerCurl = 7, uint32_t unCacheEntries = 256 );
+
+	/** returns HandSkeletonBone_Count bones for eRange. The pointers stay valid until the next call. */
+	void GetBones( const HandCurls_t &curls, const vr::VRBoneTransform_t **ppWithController, const vr::VRBoneTransform_t **ppWithoutController );
+
+	/** pushes both motion ranges to vrserver */
+	vr::EVRInputError UpdateSkeletonComponent( vr::IVRDriverInput *pDriverInput, vr::VRInputComponentHandle_t ulComponent, const HandCurls_t &curls );
+
+	const HandSkeletonCacheStats_t &Stats() const { return m_stats; }
+
+private:
+	struct CacheEntry_t
+	{
+		uint64_t m_ulKey;	// 0 marks an empty slot; valid keys have bit 63 set
+		vr::VRBoneTransform_t m_rgBones[ k_unHandSkeletonMotionRangeCount ][ HandSkeletonBone_Count ];
+	};
+
+	const CHandSkeletonModel *m_pModel;
+	uint32_t m_unBitsPerCurl;
+	uint32_t m_unCacheMask;
+	std::vector<CacheEntry_t> m_vecCache;
+	HandSkeletonCacheStats_t m_stats;
+};
+
+
+#endif // HANDSKELETON_H
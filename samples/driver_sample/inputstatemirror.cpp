@@ -0,0 +1,232 @@
+//========= Copyright Valve Corporation ============//
+
+#include "inputstatemirror.h"
+
+#include <math.h>
+
+CInputStateMirror::CInputStateMirror( vr::IVRDriverInput *pDriverInput )
+	: m_pDriverInput( pDriverInput ), m_bInReport( false )
+{
+}
+
+
+vr::EVRInputError CInputStateMirror::CreateBooleanComponent( vr::PropertyContainerHandle_t ulContainer, const char *pchName, vr::VRInputComponentHandle_t *pHandle )
+{
+	vr::EVRInputError eError = m_pDriverInput->CreateBooleanComponent( ulContainer, pchName, pHandle );
+	if ( eError == vr::VRInputError_None )
+		TrackBooleanComponent( *pHandle );
+	return eError;
+}
+
+
+vr::EVRInputError CInputStateMirror::CreateScalarComponent( vr::PropertyContainerHandle_t ulContainer, const char *pchName, vr::VRInputComponentHandle_t *pHandle,
+	vr::EVRScalarType eType, vr::EVRScalarUnits eUnits, float flDeadband )
+{
+	vr::EVRInputError eError = m_pDriverInput->CreateScalarComponent( ulContainer, pchName, pHandle, eType, eUnits );
+	if ( eError == vr::VRInputError_None )
+		TrackScalarComponent( *pHandle, eType, flDeadband );
+	return eError;
+}
+
+
+void CInputStateMirror::TrackBooleanComponent( vr::VRInputComponentHandle_t ulComponent )
+{
+	AddComponent( ulComponent, ComponentKind_Boolean, 0.f );
+}
+
+
+void CInputStateMirror::TrackScalarComponent( vr::VRInputComponentHandle_t ulComponent, vr::EVRScalarType eType, float flDeadband )
+{
+	AddComponent( ulComponent, eType == vr::VRScalarType_Relative ? ComponentKind_ScalarRelative : ComponentKind_ScalarAbsolute, flDeadband );
+}
+
+
+void CInputStateMirror::AddComponent( vr::VRInputComponentHandle_t ulComponent, EComponentKind eKind, float flDeadband )
+{
+	if ( ulComponent == vr::k_ulInvalidInputComponentHandle || FindComponent( ulComponent ) )
+		return;
+
+	ComponentState_t state = ComponentState_t();
+	state.m_ulHandle = ulComponent;
+	state.m_eKind = eKind;
+	state.m_flDeadband = flDeadband;
+
+	m_mapHandleToIndex[ ulComponent ] = (uint32_t)m_vecComponents.size();
+	m_vecComponents.push_back( state );
+}
+
+
+void CInputStateMirror::SetScalarDeadband( vr::VRInputComponentHandle_t ulComponent, float flDeadband )
+{
+	ComponentState_t *pState = FindComponent( ulComponent );
+	if ( pState )
+		pState->m_flDeadband = flDeadband;
+}
+
+
+void CInputStateMirror::Invalidate()
+{
+	for ( ComponentState_t &state : m_vecComponents )
+		state.m_bHasSent = false;
+}
+
+
+CInputStateMirror::ComponentState_t *CInputStateMirror::FindComponent( vr::VRInputComponentHandle_t ulComponent )
+{
+	std::unordered_map<vr::VRInputComponentHandle_t, uint32_t>::const_iterator iter = m_mapHandleToIndex.find( ulComponent );
+	if ( iter == m_mapHandleToIndex.end() )
+		return nullptr;
+	return &m_vecComponents[ iter->second ];
+}
+
+
+const CInputStateMirror::ComponentState_t *CInputStateMirror::FindComponent( vr::VRInputComponentHandle_t ulComponent ) const
+{
+	return const_cast<CInputStateMirror *>( this )->FindComponent( ulComponent );
+}
+
+
+void CInputStateMirror::BeginReport()
+{
+	m_bInReport = true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Forwards the coalesced value of every component touched in this report
+//-----------------------------------------------------------------------------
+void CInputStateMirror::EndReport()
+{
+	m_bInReport = false;
+	if ( m_vecDirty.empty() )
+		return;
+
+	Clock_t::time_point now = Clock_t::now();
+	for ( uint32_t unIndex : m_vecDirty )
+	{
+		ComponentState_t *pState = &m_vecComponents[ unIndex ];
+		pState->m_bPending = false;
+		if ( !ShouldForward( pState, pState->m_fPending ) )
+			continue;
+
+		// the offset was relative to when Set* was called; we're later than that now
+		double fDelay = std::chrono::duration<double>( now - pState->m_pendingTime ).count();
+		Forward( pState, pState->m_fPending, pState->m_fPendingTimeOffset - fDelay );
+	}
+	m_vecDirty.clear();
+}
+
+
+void CInputStateMirror::SetBoolean( vr::VRInputComponentHandle_t ulComponent, bool bValue, double fTimeOffset )
+{
+	ComponentState_t *pState = FindComponent( ulComponent );
+	if ( !pState )
+	{
+		// not mirrored; behave like a direct call
+		m_pDriverInput->UpdateBooleanComponent( ulComponent, bValue, fTimeOffset );
+		return;
+	}
+
+	Stage( pState, bValue ? 1.f : 0.f, fTimeOffset );
+}
+
+
+void CInputStateMirror::SetScalar( vr::VRInputComponentHandle_t ulComponent, float fValue, double fTimeOffset )
+{
+	ComponentState_t *pState = FindComponent( ulComponent );
+	if ( !pState )
+	{
+		m_pDriverInput->UpdateScalarComponent( ulComponent, fValue, fTimeOffset );
+		return;
+	}
+
+	Stage( pState, fValue, fTimeOffset );
+}
+
+
+void CInputStateMirror::Stage( ComponentState_t *pState, float fValue, double fTimeOffset )
+{
+	pState->m_stats.ulUpdatesRequested++;
+
+	if ( !m_bInReport )
+	{
+		if ( ShouldForward( pState, fValue ) )
+			Forward( pState, fValue, fTimeOffset );
+		return;
+	}
+
+	if ( !pState->m_bPending )
+	{
+		pState->m_bPending = true;
+		pState->m_fPending = 0.f;
+		m_vecDirty.push_back( (uint32_t)( pState - m_vecComponents.data() ) );
+	}
+
+	if ( pState->m_eKind == ComponentKind_ScalarRelative )
+		pState->m_fPending += fValue;
+	else
+		pState->m_fPending = fValue;
+
+	// the last update in the report wins, so its timestamp does too
+	pState->m_fPendingTimeOffset = fTimeOffset;
+	pState->m_pendingTime = Clock_t::now();
+}
+
+
+bool CInputStateMirror::ShouldForward( const ComponentState_t *pState, float fValue ) const
+{
+	switch ( pState->m_eKind )
+	{
+	case ComponentKind_ScalarRelative:
+		// relative values are deltas; sending zero is a no-op
+		return fValue != 0.f;
+
+	case ComponentKind_Boolean:
+		return !pState->m_bHasSent || fValue != pState->m_fSent;
+
+	case ComponentKind_ScalarAbsolute:
+	default:
+		if ( !pState->m_bHasSent )
+			return true;
+		if ( fValue == pState->m_fSent )
+			return false;
+		if ( fValue == 0.f || fValue == 1.f || fValue == -1.f )
+			return true;
+		return fabsf( fValue - pState->m_fSent ) > pState->m_flDeadband;
+	}
+}
+
+
+void CInputStateMirror::Forward( ComponentState_t *pState, float fValue, double fTimeOffset )
+{
+	if ( pState->m_eKind == ComponentKind_Boolean )
+		m_pDriverInput->UpdateBooleanComponent( pState->m_ulHandle, fValue != 0.f, fTimeOffset );
+	else
+		m_pDriverInput->UpdateScalarComponent( pState->m_ulHandle, fValue, fTimeOffset );
+
+	pState->m_bHasSent = true;
+	pState->m_fSent = fValue;
+	pState->m_stats.ulUpdatesForwarded++;
+}
+
+
+bool CInputStateMirror::GetComponentStats( vr::VRInputComponentHandle_t ulComponent, InputComponentStats_t *pStats ) const
+{
+	const ComponentState_t *pState = FindComponent( ulComponent );
+	if ( !pState )
+		return false;
+	*pStats = pState->m_stats;
+	return true;
+}
+
+
+InputComponentStats_t CInputStateMirror::GetTotalStats() const
+{
+	InputComponentStats_t total = { 0, 0 };
+	for ( const ComponentState_t &state : m_vecComponents )
+	{
+		total.ulUpdatesRequested += state.m_stats.ulUpdatesRequested;
+		total.ulUpdatesForwarded += state.m_stats.ulUpdatesForwarded;
+	}
+	return total;
+}
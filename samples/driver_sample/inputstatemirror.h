@@ -0,0 +1,107 @@
+//========= Copyright Valve Corporation ============//
+
+#ifndef INPUTSTATEMIRROR_H
+#define INPUTSTATEMIRROR_H
+
+#pragma once
+
+#include <openvr_driver.h>
+
+#include <chrono>
+#include <unordered_map>
+#include <vector>
+
+struct InputComponentStats_t
+{
+	uint64_t ulUpdatesRequested;	// Set* calls made by the driver
+	uint64_t ulUpdatesForwarded;	// Update*Component calls made to vrserver
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Driver-side copy of the last value sent for each boolean and scalar
+//			component. Drivers can report every component on every hardware
+//			report; only values that actually changed reach IVRDriverInput.
+//
+//			Between BeginReport and EndReport updates are coalesced, so a
+//			component touched several times in one report is forwarded once
+//			(relative scalars are summed). Outside of a report, Set* forwards
+//			immediately.
+//-----------------------------------------------------------------------------
+class CInputStateMirror
+{
+public:
+	explicit CInputStateMirror( vr::IVRDriverInput *pDriverInput = nullptr );
+
+	void SetDriverInput( vr::IVRDriverInput *pDriverInput ) { m_pDriverInput = pDriverInput; }
+
+	/** create the component through IVRDriverInput and start mirroring it */
+	vr::EVRInputError CreateBooleanComponent( vr::PropertyContainerHandle_t ulContainer, const char *pchName, vr::VRInputComponentHandle_t *pHandle );
+
+	/** Absolute scalars are only forwarded when they move by more than flDeadband from the last
+	* forwarded value, or land exactly on 0 or +/-1 so that releases and full presses are never lost. */
+	vr::EVRInputError CreateScalarComponent( vr::PropertyContainerHandle_t ulContainer, const char *pchName, vr::VRInputComponentHandle_t *pHandle,
+		vr::EVRScalarType eType, vr::EVRScalarUnits eUnits, float flDeadband = 0.f );
+
+	/** start mirroring a component that was created elsewhere */
+	void TrackBooleanComponent( vr::VRInputComponentHandle_t ulComponent );
+	void TrackScalarComponent( vr::VRInputComponentHandle_t ulComponent, vr::EVRScalarType eType, float flDeadband = 0.f );
+
+	void SetScalarDeadband( vr::VRInputComponentHandle_t ulComponent, float flDeadband );
+
+	/** Forget the last sent values so the next update of every component is forwarded,
+	* e.g. after the device was reactivated. */
+	void Invalidate();
+
+	void BeginReport();
+	void EndReport();
+
+	/** fTimeOffset has the same meaning as in IVRDriverInput and is corrected for any delay until the value is forwarded */
+	void SetBoolean( vr::VRInputComponentHandle_t ulComponent, bool bValue, double fTimeOffset = 0.0 );
+	void SetScalar( vr::VRInputComponentHandle_t ulComponent, float fValue, double fTimeOffset = 0.0 );
+
+	bool GetComponentStats( vr::VRInputComponentHandle_t ulComponent, InputComponentStats_t *pStats ) const;
+	InputComponentStats_t GetTotalStats() const;
+
+private:
+	typedef std::chrono::steady_clock Clock_t;
+
+	enum EComponentKind
+	{
+		ComponentKind_Boolean,
+		ComponentKind_ScalarAbsolute,
+		ComponentKind_ScalarRelative,
+	};
+
+	struct ComponentState_t
+	{
+		vr::VRInputComponentHandle_t m_ulHandle;
+		EComponentKind m_eKind;
+		float m_flDeadband;
+
+		bool m_bHasSent;
+		float m_fSent;			// booleans are stored as 0/1
+
+		bool m_bPending;
+		float m_fPending;
+		double m_fPendingTimeOffset;
+		Clock_t::time_point m_pendingTime;
+
+		InputComponentStats_t m_stats;
+	};
+
+	ComponentState_t *FindComponent( vr::VRInputComponentHandle_t ulComponent );
+	const ComponentState_t *FindComponent( vr::VRInputComponentHandle_t ulComponent ) const;
+	void AddComponent( vr::VRInputComponentHandle_t ulComponent, EComponentKind eKind, float flDeadband );
+	void Stage( ComponentState_t *pState, float fValue, double fTimeOffset );
+	bool ShouldForward( const ComponentState_t *pState, float fValue ) const;
+	void Forward( ComponentState_t *pState, float fValue, double fTimeOffset );
+
+	vr::IVRDriverInput *m_pDriverInput;
+	std::vector<ComponentState_t> m_vecComponents;
+	std::unordered_map<vr::VRInputComponentHandle_t, uint32_t> m_mapHandleToIndex;
+	std::vector<uint32_t> m_vecDirty;
+	bool m_bInReport;
+};
+
+
+#endif // INPUTSTATEMIRROR_H
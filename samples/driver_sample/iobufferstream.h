@@ -0,0 +1,353 @@
+//========= Copyright Valve Corporation ============//
+
+#ifndef IOBUFFERSTREAM_H
+#define IOBUFFERSTREAM_H
+
+#pragma once
+
+#include <openvr_driver.h>
+
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+#include <vector>
+
+// --------------------------------------------------------------------------
+// Typed record streams on top of IVRIOBuffer.
+//
+// Every IOBuffer element is an IOStreamElement_t<T>: a sequence number
+// followed by one fixed-size record. Writers stamp consecutive sequence
+// numbers, so readers can tell when the buffer wrapped before they got to it.
+// --------------------------------------------------------------------------
+
+#pragma pack( push, 8 )
+template < typename T >
+struct IOStreamElement_t
+{
+	uint64_t ulSequence;
+	T record;
+};
+#pragma pack( pop )
+
+
+struct IOStreamWriterStats_t
+{
+	uint64_t ulRecordsWritten;
+	uint64_t ulBatchesWritten;
+	uint64_t ulRecordsSkipped;		// not produced because nobody was reading
+	uint64_t ulWriteErrors;
+};
+
+struct IOStreamReaderStats_t
+{
+	uint64_t ulRecordsRead;
+	uint64_t ulRecordsLost;			// sequence numbers the writer produced but we never saw
+	uint64_t ulOverruns;			// number of times a gap was detected
+	uint64_t ulReadErrors;
+};
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Producer side of a typed stream. Records are staged locally and
+//			handed to IVRIOBuffer::Write in one call per batch.
+//-----------------------------------------------------------------------------
+template < typename T >
+class CIOBufferStreamWriter
+{
+	static_assert( std::is_trivially_copyable<T>::value, "IOBuffer stream records must be trivially copyable" );
+
+public:
+	typedef IOStreamElement_t<T> Element_t;
+
+	CIOBufferStreamWriter()
+		: m_pIOBuffer( nullptr ), m_ulBuffer( vr::k_ulInvalidIOBufferHandle ), m_ulNextSequence( 0 ), m_unMaxBatch( 0 )
+	{
+		memset( &m_stats, 0, sizeof( m_stats ) );
+	}
+
+	~CIOBufferStreamWriter()
+	{
+		Close();
+	}
+
+	/** creates (or opens) the buffer at pchPath with room for unElements records. unMaxBatch bounds BeginBatch. */
+	vr::EIOBufferError Open( vr::IVRIOBuffer *pIOBuffer, const char *pchPath, uint32_t unElements, uint32_t unMaxBatch )
+	{
+		Close();
+		if ( !pIOBuffer || unMaxBatch == 0 )
+			return vr::IOBuffer_InvalidArgument;
+
+		vr::EIOBufferError eError = pIOBuffer->Open( pchPath, (vr::EIOBufferMode)( vr::IOBufferMode_Write | vr::IOBufferMode_Create ),
+			sizeof( Element_t ), unElements, &m_ulBuffer );
+		if ( eError != vr::IOBuffer_Success )
+		{
+			m_ulBuffer = vr::k_ulInvalidIOBufferHandle;
+			return eError;
+		}
+
+		m_pIOBuffer = pIOBuffer;
+		m_unMaxBatch = unMaxBatch;
+		m_vecStaging.reserve( unMaxBatch );
+		return vr::IOBuffer_Success;
+	}
+
+	void Close()
+	{
+		if ( m_pIOBuffer && m_ulBuffer != vr::k_ulInvalidIOBufferHandle )
+			m_pIOBuffer->Close( m_ulBuffer );
+		m_pIOBuffer = nullptr;
+		m_ulBuffer = vr::k_ulInvalidIOBufferHandle;
+		m_vecStaging.clear();
+	}
+
+	bool IsOpen() const { return m_ulBuffer != vr::k_ulInvalidIOBufferHandle; }
+
+	/** cheap check producers should make before doing any work to build records */
+	bool HasReaders() const
+	{
+		return IsOpen() && m_pIOBuffer->HasReaders( m_ulBuffer );
+	}
+
+	/** returns a pointer to the next staged record, or nullptr if the batch is full */
+	T *AddRecord()
+	{
+		if ( m_vecStaging.size() >= m_unMaxBatch )
+			return nullptr;
+		m_vecStaging.push_back( Element_t() );
+		Element_t &element = m_vecStaging.back();
+		element.ulSequence = m_ulNextSequence + m_vecStaging.size() - 1;
+		return &element.record;
+	}
+
+	/** stages a copy of record. Returns false if the batch is full. */
+	bool AddRecord( const T &record )
+	{
+		T *pRecord = AddRecord();
+		if ( !pRecord )
+			return false;
+		*pRecord = record;
+		return true;
+	}
+
+	uint32_t StagedCount() const { return (uint32_t)m_vecStaging.size(); }
+
+	/** writes every staged record with a single IVRIOBuffer::Write call */
+	vr::EIOBufferError Flush()
+	{
+		if ( m_vecStaging.empty() )
+			return vr::IOBuffer_Success;
+		if ( !IsOpen() )
+			return vr::IOBuffer_InvalidHandle;
+
+		uint32_t unCount = (uint32_t)m_vecStaging.size();
+		vr::EIOBufferError eError = m_pIOBuffer->Write( m_ulBuffer, m_vecStaging.data(), unCount * (uint32_t)sizeof( Element_t ) );
+		if ( eError == vr::IOBuffer_Success )
+		{
+			m_stats.ulRecordsWritten += unCount;
+			m_stats.ulBatchesWritten++;
+		}
+		else
+		{
+			m_stats.ulWriteErrors++;
+		}
+
+		// sequence numbers advance even on failure so readers see the gap
+		m_ulNextSequence += unCount;
+		m_vecStaging.clear();
+		return eError;
+	}
+
+	/** Calls fnProduce( T *pRecords, uint32_t unMax ) -> uint32_t unProduced only if somebody is
+	* listening, then writes the produced records as one batch. */
+	template < typename Producer >
+	vr::EIOBufferError ProduceBatch( uint32_t unMax, Producer fnProduce )
+	{
+		if ( !HasReaders() )
+		{
+			m_stats.ulRecordsSkipped += unMax;
+			return vr::IOBuffer_Success;
+		}
+
+		if ( unMax > m_unMaxBatch - StagedCount() )
+			unMax = m_unMaxBatch - StagedCount();
+
+		size_t unFirst = m_vecStaging.size();
+		m_vecStaging.resize( unFirst + unMax );
+
+		// records are interleaved with sequence numbers, so produce into a contiguous scratch array
+		m_vecScratch.resize( unMax );
+		uint32_t unProduced = fnProduce( m_vecScratch.data(), unMax );
+		if ( unProduced > unMax )
+			unProduced = unMax;
+
+		for ( uint32_t i = 0; i < unProduced; i++ )
+		{
+			m_vecStaging[ unFirst + i ].ulSequence = m_ulNextSequence + unFirst + i;
+			m_vecStaging[ unFirst + i ].record = m_vecScratch[ i ];
+		}
+		m_vecStaging.resize( unFirst + unProduced );
+
+		return Flush();
+	}
+
+	uint64_t NextSequence() const { return m_ulNextSequence + m_vecStaging.size(); }
+	const IOStreamWriterStats_t &Stats() const { return m_stats; }
+
+private:
+	vr::IVRIOBuffer *m_pIOBuffer;
+	vr::IOBufferHandle_t m_ulBuffer;
+	uint64_t m_ulNextSequence;
+	uint32_t m_unMaxBatch;
+	std::vector<Element_t> m_vecStaging;
+	std::vector<T> m_vecScratch;
+	IOStreamWriterStats_t m_stats;
+
+	CIOBufferStreamWriter( const CIOBufferStreamWriter & ) = delete;
+	CIOBufferStreamWriter &operator=( const CIOBufferStreamWriter & ) = delete;
+};
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Consumer side of a typed stream. Poll() pulls whatever is available
+//			into one reusable block and the cursor walks the records in place.
+//-----------------------------------------------------------------------------
+template < typename T >
+class CIOBufferStreamReader
+{
+	static_assert( std::is_trivially_copyable<T>::value, "IOBuffer stream records must be trivially copyable" );
+
+public:
+	typedef IOStreamElement_t<T> Element_t;
+
+	class CCursor
+	{
+	public:
+		CCursor() : m_pCur( nullptr ), m_pEnd( nullptr ) {}
+		CCursor( const Element_t *pBegin, const Element_t *pEnd ) : m_pCur( pBegin ), m_pEnd( pEnd ) {}
+
+		bool IsValid() const { return m_pCur != m_pEnd; }
+		void Next() { ++m_pCur; }
+		const T &Record() const { return m_pCur->record; }
+		uint64_t Sequence() const { return m_pCur->ulSequence; }
+		uint32_t Remaining() const { return (uint32_t)( m_pEnd - m_pCur ); }
+
+	private:
+		const Element_t *m_pCur;
+		const Element_t *m_pEnd;
+	};
+
+	CIOBufferStreamReader()
+		: m_pIOBuffer( nullptr ), m_ulBuffer( vr::k_ulInvalidIOBufferHandle ), m_ulExpectedSequence( 0 ), m_bHaveSequence( false ), m_unValid( 0 )
+	{
+		memset( &m_stats, 0, sizeof( m_stats ) );
+	}
+
+	~CIOBufferStreamReader()
+	{
+		Close();
+	}
+
+	/** opens an existing stream. unMaxBatch is the most records a single Poll will return. */
+	vr::EIOBufferError Open( vr::IVRIOBuffer *pIOBuffer, const char *pchPath, uint32_t unMaxBatch )
+	{
+		Close();
+		if ( !pIOBuffer || unMaxBatch == 0 )
+			return vr::IOBuffer_InvalidArgument;
+
+		vr::EIOBufferError eError = pIOBuffer->Open( pchPath, vr::IOBufferMode_Read, sizeof( Element_t ), 0, &m_ulBuffer );
+		if ( eError != vr::IOBuffer_Success )
+		{
+			m_ulBuffer = vr::k_ulInvalidIOBufferHandle;
+			return eError;
+		}
+
+		m_pIOBuffer = pIOBuffer;
+		m_vecBlock.resize( unMaxBatch );
+		m_bHaveSequence = false;
+		m_unValid = 0;
+		return vr::IOBuffer_Success;
+	}
+
+	void Close()
+	{
+		if ( m_pIOBuffer && m_ulBuffer != vr::k_ulInvalidIOBufferHandle )
+			m_pIOBuffer->Close( m_ulBuffer );
+		m_pIOBuffer = nullptr;
+		m_ulBuffer = vr::k_ulInvalidIOBufferHandle;
+		m_unValid = 0;
+	}
+
+	bool IsOpen() const { return m_ulBuffer != vr::k_ulInvalidIOBufferHandle; }
+
+	/** Reads the next block of records. The returned cursor stays valid until the next Poll or Close. */
+	CCursor Poll()
+	{
+		m_unValid = 0;
+		if ( !IsOpen() )
+			return CCursor();
+
+		uint32_t unRead = 0;
+		vr::EIOBufferError eError = m_pIOBuffer->Read( m_ulBuffer, m_vecBlock.data(), (uint32_t)( m_vecBlock.size() * sizeof( Element_t ) ), &unRead );
+		if ( eError != vr::IOBuffer_Success )
+		{
+			m_stats.ulReadErrors++;
+			return CCursor();
+		}
+
+		m_unValid = unRead / (uint32_t)sizeof( Element_t );
+		for ( uint32_t i = 0; i < m_unValid; i++ )
+		{
+			uint64_t ulSequence = m_vecBlock[ i ].ulSequence;
+			if ( m_bHaveSequence && ulSequence != m_ulExpectedSequence )
+			{
+				m_stats.ulOverruns++;
+				if ( ulSequence > m_ulExpectedSequence )
+					m_stats.ulRecordsLost += ulSequence - m_ulExpectedSequence;
+			}
+			m_ulExpectedSequence = ulSequence + 1;
+			m_bHaveSequence = true;
+		}
+		m_stats.ulRecordsRead += m_unValid;
+
+		return CCursor( m_vecBlock.data(), m_vecBlock.data() + m_unValid );
+	}
+
+	/** polls until the buffer is drained, calling fnVisit( const T &record, uint64_t ulSequence ) for each record */
+	template < typename Visitor >
+	uint32_t Drain( Visitor fnVisit )
+	{
+		uint32_t unTotal = 0;
+		for ( ;; )
+		{
+			CCursor cursor = Poll();
+			if ( !cursor.IsValid() )
+				break;
+			for ( ; cursor.IsValid(); cursor.Next() )
+			{
+				fnVisit( cursor.Record(), cursor.Sequence() );
+				unTotal++;
+			}
+		}
+		return unTotal;
+	}
+
+	const IOStreamReaderStats_t &Stats() const { return m_stats; }
+
+private:
+	vr::IVRIOBuffer *m_pIOBuffer;
+	vr::IOBufferHandle_t m_ulBuffer;
+	uint64_t m_ulExpectedSequence;
+	bool m_bHaveSequence;
+	uint32_t m_unValid;
+	std::vector<Element_t> m_vecBlock;
+	IOStreamReaderStats_t m_stats;
+
+	CIOBufferStreamReader( const CIOBufferStreamReader & ) = delete;
+	CIOBufferStreamReader &operator=( const CIOBufferStreamReader & ) = delete;
+};
+
+typedef CIOBufferStreamWriter<vr::ImuSample_t> CImuStreamWriter;
+typedef CIOBufferStreamReader<vr::ImuSample_t> CImuStreamReader;
+
+
+#endif // IOBUFFERSTREAM_H
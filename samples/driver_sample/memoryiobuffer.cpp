@@ -0,0 +1,178 @@
+//========= Copyright Valve Corporation ============//
+
+#include "memoryiobuffer.h"
+
+#include <string.h>
+
+CMemoryIOBuffer::CMemoryIOBuffer()
+	: m_ulNextHandle( 1 )
+{
+}
+
+CMemoryIOBuffer::~CMemoryIOBuffer()
+{
+}
+
+CMemoryIOBuffer::Handle_t *CMemoryIOBuffer::FindHandle( vr::IOBufferHandle_t ulBuffer )
+{
+	std::map<vr::IOBufferHandle_t, Handle_t>::iterator iter = m_mapHandles.find( ulBuffer );
+	if ( iter == m_mapHandles.end() )
+		return nullptr;
+	return &iter->second;
+}
+
+vr::EIOBufferError CMemoryIOBuffer::Open( const char *pchPath, vr::EIOBufferMode mode, uint32_t unElementSize, uint32_t unElements, vr::IOBufferHandle_t *pulBuffer )
+{
+	if ( !pchPath || !pulBuffer )
+		return vr::IOBuffer_InvalidArgument;
+	if ( !( mode & ( vr::IOBufferMode_Read | vr::IOBufferMode_Write ) ) )
+		return vr::IOBuffer_InvalidArgument;
+
+	std::lock_guard<std::mutex> lock( m_mutex );
+
+	std::shared_ptr<Buffer_t> pBuffer;
+	std::map<std::string, std::shared_ptr<Buffer_t> >::iterator iter = m_mapBuffers.find( pchPath );
+	if ( iter != m_mapBuffers.end() )
+	{
+		pBuffer = iter->second;
+		if ( unElementSize != 0 && unElementSize != pBuffer->m_unElementSize )
+			return vr::IOBuffer_InvalidArgument;
+	}
+	else
+	{
+		if ( !( mode & vr::IOBufferMode_Create ) )
+			return vr::IOBuffer_PathDoesNotExist;
+		if ( unElementSize == 0 || unElements == 0 )
+			return vr::IOBuffer_InvalidArgument;
+
+		pBuffer = std::make_shared<Buffer_t>();
+		pBuffer->m_sPath = pchPath;
+		pBuffer->m_unElementSize = unElementSize;
+		pBuffer->m_unElements = unElements;
+		pBuffer->m_vecData.resize( (size_t)unElementSize * unElements );
+		pBuffer->m_ulWritten = 0;
+		pBuffer->m_unReaders = 0;
+		pBuffer->m_unHandles = 0;
+		m_mapBuffers[ pchPath ] = pBuffer;
+	}
+
+	Handle_t handle;
+	handle.m_pBuffer = pBuffer;
+	handle.m_eMode = mode;
+	// new readers only see data written after they opened
+	handle.m_ulReadPosition = pBuffer->m_ulWritten;
+
+	pBuffer->m_unHandles++;
+	if ( mode & vr::IOBufferMode_Read )
+		pBuffer->m_unReaders++;
+
+	*pulBuffer = m_ulNextHandle++;
+	m_mapHandles[ *pulBuffer ] = handle;
+	return vr::IOBuffer_Success;
+}
+
+vr::EIOBufferError CMemoryIOBuffer::Close( vr::IOBufferHandle_t ulBuffer )
+{
+	std::lock_guard<std::mutex> lock( m_mutex );
+
+	Handle_t *pHandle = FindHandle( ulBuffer );
+	if ( !pHandle )
+		return vr::IOBuffer_InvalidHandle;
+
+	Buffer_t *pBuffer = pHandle->m_pBuffer.get();
+	if ( pHandle->m_eMode & vr::IOBufferMode_Read )
+		pBuffer->m_unReaders--;
+	if ( --pBuffer->m_unHandles == 0 )
+		m_mapBuffers.erase( pBuffer->m_sPath );
+
+	m_mapHandles.erase( ulBuffer );
+	return vr::IOBuffer_Success;
+}
+
+vr::EIOBufferError CMemoryIOBuffer::Read( vr::IOBufferHandle_t ulBuffer, void *pDst, uint32_t unBytes, uint32_t *punRead )
+{
+	if ( !pDst || !punRead )
+		return vr::IOBuffer_InvalidArgument;
+	*punRead = 0;
+
+	std::lock_guard<std::mutex> lock( m_mutex );
+
+	Handle_t *pHandle = FindHandle( ulBuffer );
+	if ( !pHandle )
+		return vr::IOBuffer_InvalidHandle;
+	if ( !( pHandle->m_eMode & vr::IOBufferMode_Read ) )
+		return vr::IOBuffer_Permission;
+
+	Buffer_t *pBuffer = pHandle->m_pBuffer.get();
+
+	// the writer lapped us; whatever was overwritten is gone
+	if ( pBuffer->m_ulWritten - pHandle->m_ulReadPosition > pBuffer->m_unElements )
+		pHandle->m_ulReadPosition = pBuffer->m_ulWritten - pBuffer->m_unElements;
+
+	uint64_t ulAvailable = pBuffer->m_ulWritten - pHandle->m_ulReadPosition;
+	uint64_t ulWanted = unBytes / pBuffer->m_unElementSize;
+	uint32_t unCount = (uint32_t)( ulAvailable < ulWanted ? ulAvailable : ulWanted );
+
+	// copy in at most two runs around the end of the ring
+	uint8_t *pOut = (uint8_t *)pDst;
+	uint32_t unFirst = (uint32_t)( pHandle->m_ulReadPosition % pBuffer->m_unElements );
+	uint32_t unRun = pBuffer->m_unElements - unFirst < unCount ? pBuffer->m_unElements - unFirst : unCount;
+	memcpy( pOut, &pBuffer->m_vecData[ (size_t)unFirst * pBuffer->m_unElementSize ], (size_t)unRun * pBuffer->m_unElementSize );
+	if ( unCount > unRun )
+		memcpy( pOut + (size_t)unRun * pBuffer->m_unElementSize, &pBuffer->m_vecData[ 0 ], (size_t)( unCount - unRun ) * pBuffer->m_unElementSize );
+
+	pHandle->m_ulReadPosition += unCount;
+	*punRead = unCount * pBuffer->m_unElementSize;
+	return vr::IOBuffer_Success;
+}
+
+vr::EIOBufferError CMemoryIOBuffer::Write( vr::IOBufferHandle_t ulBuffer, void *pSrc, uint32_t unBytes )
+{
+	if ( !pSrc && unBytes )
+		return vr::IOBuffer_InvalidArgument;
+
+	std::lock_guard<std::mutex> lock( m_mutex );
+
+	Handle_t *pHandle = FindHandle( ulBuffer );
+	if ( !pHandle )
+		return vr::IOBuffer_InvalidHandle;
+	if ( !( pHandle->m_eMode & vr::IOBufferMode_Write ) )
+		return vr::IOBuffer_Permission;
+
+	Buffer_t *pBuffer = pHandle->m_pBuffer.get();
+	if ( unBytes % pBuffer->m_unElementSize != 0 )
+		return vr::IOBuffer_InvalidArgument;
+
+	uint32_t unCount = unBytes / pBuffer->m_unElementSize;
+	const uint8_t *pIn = (const uint8_t *)pSrc;
+
+	// only the newest m_unElements survive a write larger than the ring
+	if ( unCount > pBuffer->m_unElements )
+	{
+		pIn += (size_t)( unCount - pBuffer->m_unElements ) * pBuffer->m_unElementSize;
+		pBuffer->m_ulWritten += unCount - pBuffer->m_unElements;
+		unCount = pBuffer->m_unElements;
+	}
+
+	uint32_t unFirst = (uint32_t)( pBuffer->m_ulWritten % pBuffer->m_unElements );
+	uint32_t unRun = pBuffer->m_unElements - unFirst < unCount ? pBuffer->m_unElements - unFirst : unCount;
+	memcpy( &pBuffer->m_vecData[ (size_t)unFirst * pBuffer->m_unElementSize ], pIn, (size_t)unRun * pBuffer->m_unElementSize );
+	if ( unCount > unRun )
+		memcpy( &pBuffer->m_vecData[ 0 ], pIn + (size_t)unRun * pBuffer->m_unElementSize, (size_t)( unCount - unRun ) * pBuffer->m_unElementSize );
+
+	pBuffer->m_ulWritten += unCount;
+	return vr::IOBuffer_Success;
+}
+
+vr::PropertyContainerHandle_t CMemoryIOBuffer::PropertyContainer( vr::IOBufferHandle_t )
+{
+	return vr::k_ulInvalidPropertyContainer;
+}
+
+bool CMemoryIOBuffer::HasReaders( vr::IOBufferHandle_t ulBuffer )
+{
+	std::lock_guard<std::mutex> lock( m_mutex );
+
+	Handle_t *pHandle = FindHandle( ulBuffer );
+	return pHandle && pHandle->m_pBuffer->m_unReaders > 0;
+}
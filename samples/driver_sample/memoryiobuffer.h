@@ -0,0 +1,64 @@
+//========= Copyright Valve Corporation ============//
+
+#ifndef MEMORYIOBUFFER_H
+#define MEMORYIOBUFFER_H
+
+#pragma once
+
+#include <openvr_driver.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// Purpose: In-process IVRIOBuffer. Each path is a ring of fixed-size elements
+//			with any number of writers and independent readers; a reader that
+//			falls more than a full ring behind skips ahead to the oldest element
+//			still available. Lets IOBuffer producers and consumers run without
+//			SteamVR.
+//-----------------------------------------------------------------------------
+class CMemoryIOBuffer : public vr::IVRIOBuffer
+{
+public:
+	CMemoryIOBuffer();
+	virtual ~CMemoryIOBuffer();
+
+	virtual vr::EIOBufferError Open( const char *pchPath, vr::EIOBufferMode mode, uint32_t unElementSize, uint32_t unElements, vr::IOBufferHandle_t *pulBuffer );
+	virtual vr::EIOBufferError Close( vr::IOBufferHandle_t ulBuffer );
+	virtual vr::EIOBufferError Read( vr::IOBufferHandle_t ulBuffer, void *pDst, uint32_t unBytes, uint32_t *punRead );
+	virtual vr::EIOBufferError Write( vr::IOBufferHandle_t ulBuffer, void *pSrc, uint32_t unBytes );
+	virtual vr::PropertyContainerHandle_t PropertyContainer( vr::IOBufferHandle_t ulBuffer );
+	virtual bool HasReaders( vr::IOBufferHandle_t ulBuffer );
+
+private:
+	struct Buffer_t
+	{
+		std::string m_sPath;
+		uint32_t m_unElementSize;
+		uint32_t m_unElements;
+		std::vector<uint8_t> m_vecData;
+		uint64_t m_ulWritten;		// total elements ever written
+		uint32_t m_unReaders;
+		uint32_t m_unHandles;
+	};
+
+	struct Handle_t
+	{
+		std::shared_ptr<Buffer_t> m_pBuffer;
+		vr::EIOBufferMode m_eMode;
+		uint64_t m_ulReadPosition;
+	};
+
+	Handle_t *FindHandle( vr::IOBufferHandle_t ulBuffer );
+
+	std::mutex m_mutex;
+	std::map<std::string, std::shared_ptr<Buffer_t> > m_mapBuffers;
+	std::map<vr::IOBufferHandle_t, Handle_t> m_mapHandles;
+	vr::IOBufferHandle_t m_ulNextHandle;
+};
+
+
+#endif // MEMORYIOBUFFER_H
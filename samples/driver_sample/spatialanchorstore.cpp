@@ -0,0 +1,555 @@
+//========= Copyright Valve Corporation ============//
+
+#include "spatialanchorstore.h"
+
+#include <string.h>
+
+#include <chrono>
+
+// how long to wait before trying again when a pose is not available yet
+static const double k_flRetrySeconds = 1.0;
+
+// starting buffer for descriptors; grown if the runtime says it is too small
+static const uint32_t k_unInitialDescriptorSize = 1024;
+
+
+CSpatialAnchorStore::CSpatialAnchorStore()
+	: m_pAnchors( nullptr )
+	, m_ulCurrentUniverse( 0 )
+	, m_unBusyWorkers( 0 )
+	, m_bExiting( false )
+	, m_ulResolves( 0 )
+	, m_ulResolveFailures( 0 )
+	, m_ulStaleResults( 0 )
+	, m_ulDescriptorsBuilt( 0 )
+{
+}
+
+
+CSpatialAnchorStore::~CSpatialAnchorStore()
+{
+	Stop();
+}
+
+
+double CSpatialAnchorStore::Now()
+{
+	return std::chrono::duration<double>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+
+bool CSpatialAnchorStore::Start( vr::IVRDriverSpatialAnchors *pAnchors, PoseResolver_t fnResolve, DescriptorBuilder_t fnBuildDescriptor, uint32_t unWorkerThreads )
+{
+	if ( !pAnchors || !fnResolve || !m_vecWorkers.empty() )
+		return false;
+
+	m_fnResolve = fnResolve;
+	m_fnBuildDescriptor = fnBuildDescriptor;
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		m_pAnchors = pAnchors;
+		m_bExiting = false;
+	}
+
+	if ( unWorkerThreads == 0 )
+		unWorkerThreads = 1;
+	for ( uint32_t i = 0; i < unWorkerThreads; i++ )
+	{
+		m_vecWorkers.push_back( new std::thread( &CSpatialAnchorStore::WorkerThread, this ) );
+	}
+	return true;
+}
+
+
+void CSpatialAnchorStore::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		m_bExiting = true;
+	}
+	m_workCondition.notify_all();
+
+	for ( size_t i = 0; i < m_vecWorkers.size(); i++ )
+	{
+		m_vecWorkers[ i ]->join();
+		delete m_vecWorkers[ i ];
+	}
+	m_vecWorkers.clear();
+
+	std::lock_guard<std::mutex> lock( m_mutex );
+	m_pAnchors = nullptr;
+	m_queueBatches.clear();
+	m_vecHeap.clear();
+	m_mapUniverses.clear();
+	m_mapAnchors.clear();
+	m_idleCondition.notify_all();
+}
+
+
+bool CSpatialAnchorStore::ProcessEvent( const vr::VREvent_t &vrEvent )
+{
+	// without Start there is no runtime interface to answer through. Stop clears it under
+	// the lock, so take a copy for the fetch and check again once the lock is held.
+	vr::IVRDriverSpatialAnchors *pAnchors;
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		pAnchors = m_pAnchors;
+	}
+	if ( !pAnchors )
+		return false;
+
+	vr::SpatialAnchorHandle_t unHandle = vrEvent.data.spatialAnchor.unHandle;
+
+	switch ( vrEvent.eventType )
+	{
+	case vr::VREvent_SpatialAnchors_RequestPoseUpdate:
+	{
+		// the descriptor comes from the runtime, so fetch it before taking the lock
+		std::string sDescriptor;
+		bool bHaveDescriptor = FetchDescriptor( pAnchors, unHandle, &sDescriptor );
+
+		std::vector<Job_t> batch;
+		std::lock_guard<std::mutex> lock( m_mutex );
+		if ( !m_pAnchors )
+			return false;
+		Anchor_t *pAnchor = FindOrAddAnchor( unHandle );
+		if ( bHaveDescriptor && sDescriptor != pAnchor->sDescriptor )
+		{
+			// the runtime's descriptor replaces any we were still building
+			pAnchor->sDescriptor = sDescriptor;
+			pAnchor->unGeneration++;
+			pAnchor->bQueued = false;
+			pAnchor->bNeedsDescriptor = false;
+		}
+		if ( !pAnchor->sDescriptor.empty() )
+		{
+			QueueLocked( pAnchor, &batch );
+			FlushBatchLocked( &batch );
+		}
+		return true;
+	}
+
+	case vr::VREvent_SpatialAnchors_RequestDescriptorUpdate:
+	{
+		std::vector<Job_t> batch;
+		std::lock_guard<std::mutex> lock( m_mutex );
+		if ( !m_pAnchors )
+			return false;
+		Anchor_t *pAnchor = FindOrAddAnchor( unHandle );
+		if ( m_fnBuildDescriptor )
+		{
+			pAnchor->bNeedsDescriptor = true;
+			pAnchor->bQueued = false;
+			QueueLocked( pAnchor, &batch );
+			FlushBatchLocked( &batch );
+		}
+		return true;
+	}
+
+	case vr::VREvent_SpatialAnchors_PoseUpdated:
+	case vr::VREvent_SpatialAnchors_DescriptorUpdated:
+		// broadcasts, usually caused by our own updates
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+
+void CSpatialAnchorStore::Tick( double flNow )
+{
+	std::vector<Job_t> batch;
+	std::lock_guard<std::mutex> lock( m_mutex );
+	while ( !m_vecHeap.empty() && m_vecHeap[ 0 ]->flDeadline <= flNow )
+	{
+		Anchor_t *pAnchor = m_vecHeap[ 0 ];
+		HeapRemove( pAnchor );
+		QueueLocked( pAnchor, &batch );
+	}
+	FlushBatchLocked( &batch );
+}
+
+
+void CSpatialAnchorStore::SetCurrentUniverse( uint64_t ulUniverseId )
+{
+	std::vector<Job_t> batch;
+	std::lock_guard<std::mutex> lock( m_mutex );
+	if ( ulUniverseId == m_ulCurrentUniverse )
+		return;
+	m_ulCurrentUniverse = ulUniverseId;
+
+	uint64_t rgulPartitions[ 2 ] = { ulUniverseId, 0 };
+	for ( int i = 0; i < 2; i++ )
+	{
+		auto iterPartition = m_mapUniverses.find( rgulPartitions[ i ] );
+		if ( iterPartition == m_mapUniverses.end() )
+			continue;
+
+		for ( vr::SpatialAnchorHandle_t unHandle : iterPartition->second )
+		{
+			auto iterAnchor = m_mapAnchors.find( unHandle );
+			if ( iterAnchor != m_mapAnchors.end() && !iterAnchor->second.sDescriptor.empty() )
+			{
+				HeapRemove( &iterAnchor->second );
+				QueueLocked( &iterAnchor->second, &batch );
+			}
+		}
+	}
+	FlushBatchLocked( &batch );
+}
+
+
+void CSpatialAnchorStore::RemoveAnchor( vr::SpatialAnchorHandle_t unHandle )
+{
+	std::lock_guard<std::mutex> lock( m_mutex );
+	auto iter = m_mapAnchors.find( unHandle );
+	if ( iter == m_mapAnchors.end() )
+		return;
+
+	// in-flight jobs notice the anchor is gone when they finish
+	HeapRemove( &iter->second );
+	RemoveFromUniverseLocked( &iter->second );
+	m_mapAnchors.erase( iter );
+}
+
+
+void CSpatialAnchorStore::WaitForIdle()
+{
+	std::unique_lock<std::mutex> lock( m_mutex );
+	m_idleCondition.wait( lock, [ this ] { return m_bExiting || ( m_queueBatches.empty() && m_unBusyWorkers == 0 ); } );
+}
+
+
+bool CSpatialAnchorStore::HasAnchor( vr::SpatialAnchorHandle_t unHandle ) const
+{
+	std::lock_guard<std::mutex> lock( m_mutex );
+	return m_mapAnchors.find( unHandle ) != m_mapAnchors.end();
+}
+
+
+SpatialAnchorStoreStats_t CSpatialAnchorStore::GetStats() const
+{
+	std::lock_guard<std::mutex> lock( m_mutex );
+	SpatialAnchorStoreStats_t stats;
+	stats.unAnchors = (uint32_t)m_mapAnchors.size();
+	stats.unScheduled = (uint32_t)m_vecHeap.size();
+	stats.ulResolves = m_ulResolves;
+	stats.ulResolveFailures = m_ulResolveFailures;
+	stats.ulStaleResults = m_ulStaleResults;
+	stats.ulDescriptorsBuilt = m_ulDescriptorsBuilt;
+	return stats;
+}
+
+
+CSpatialAnchorStore::Anchor_t *CSpatialAnchorStore::FindOrAddAnchor( vr::SpatialAnchorHandle_t unHandle )
+{
+	auto iter = m_mapAnchors.find( unHandle );
+	if ( iter != m_mapAnchors.end() )
+		return &iter->second;
+
+	Anchor_t &anchor = m_mapAnchors[ unHandle ];
+	anchor.unHandle = unHandle;
+	anchor.ulUniverseId = 0;
+	anchor.unGeneration = 0;
+	anchor.flDeadline = 0.0;
+	anchor.nHeapIndex = -1;
+	anchor.bQueued = false;
+	anchor.bNeedsDescriptor = false;
+	m_mapUniverses[ 0 ].insert( unHandle );
+	return &anchor;
+}
+
+
+void CSpatialAnchorStore::QueueLocked( Anchor_t *pAnchor, std::vector<Job_t> *pBatch )
+{
+	if ( pAnchor->bQueued )
+		return;
+	pAnchor->bQueued = true;
+
+	Job_t job;
+	job.unHandle = pAnchor->unHandle;
+	job.unGeneration = pAnchor->unGeneration;
+	job.sDescriptor = pAnchor->sDescriptor;
+	job.bBuildDescriptor = pAnchor->bNeedsDescriptor;
+	pBatch->push_back( job );
+
+	if ( pBatch->size() >= k_unBatchSize )
+		FlushBatchLocked( pBatch );
+}
+
+
+void CSpatialAnchorStore::FlushBatchLocked( std::vector<Job_t> *pBatch )
+{
+	if ( pBatch->empty() || m_bExiting )
+		return;
+
+	m_queueBatches.push_back( std::vector<Job_t>() );
+	m_queueBatches.back().swap( *pBatch );
+	m_workCondition.notify_one();
+}
+
+
+void CSpatialAnchorStore::SetUniverseLocked( Anchor_t *pAnchor, uint64_t ulUniverseId )
+{
+	if ( pAnchor->ulUniverseId == ulUniverseId )
+		return;
+
+	RemoveFromUniverseLocked( pAnchor );
+	pAnchor->ulUniverseId = ulUniverseId;
+	m_mapUniverses[ ulUniverseId ].insert( pAnchor->unHandle );
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Takes the anchor out of its universe's set, dropping the set once
+//			it is empty
+//-----------------------------------------------------------------------------
+void CSpatialAnchorStore::RemoveFromUniverseLocked( const Anchor_t *pAnchor )
+{
+	auto iter = m_mapUniverses.find( pAnchor->ulUniverseId );
+	if ( iter == m_mapUniverses.end() )
+		return;
+
+	iter->second.erase( pAnchor->unHandle );
+	if ( iter->second.empty() )
+		m_mapUniverses.erase( iter );
+}
+
+
+bool CSpatialAnchorStore::FetchDescriptor( vr::IVRDriverSpatialAnchors *pAnchors, vr::SpatialAnchorHandle_t unHandle, std::string *psDescriptor )
+{
+	std::vector<char> vecBuffer( k_unInitialDescriptorSize );
+	uint32_t unLength = (uint32_t)vecBuffer.size();
+	vr::EVRSpatialAnchorError eError = pAnchors->GetSpatialAnchorDescriptor( unHandle, &vecBuffer[ 0 ], &unLength, false );
+	if ( eError == vr::VRSpatialAnchorError_ArrayTooSmall && unLength > vecBuffer.size() )
+	{
+		vecBuffer.resize( unLength );
+		eError = pAnchors->GetSpatialAnchorDescriptor( unHandle, &vecBuffer[ 0 ], &unLength, false );
+	}
+	if ( eError != vr::VRSpatialAnchorError_Success )
+		return false;
+
+	vecBuffer.back() = '\0';
+	*psDescriptor = &vecBuffer[ 0 ];
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Indexed binary min-heap. Each anchor remembers its slot so it can
+//			be rescheduled or removed without a search.
+//-----------------------------------------------------------------------------
+void CSpatialAnchorStore::HeapSchedule( Anchor_t *pAnchor, double flDeadline )
+{
+	if ( pAnchor->nHeapIndex < 0 )
+	{
+		pAnchor->flDeadline = flDeadline;
+		pAnchor->nHeapIndex = (int32_t)m_vecHeap.size();
+		m_vecHeap.push_back( pAnchor );
+		HeapUp( pAnchor->nHeapIndex );
+		return;
+	}
+
+	double flOld = pAnchor->flDeadline;
+	pAnchor->flDeadline = flDeadline;
+	if ( flDeadline < flOld )
+		HeapUp( pAnchor->nHeapIndex );
+	else
+		HeapDown( pAnchor->nHeapIndex );
+}
+
+
+void CSpatialAnchorStore::HeapRemove( Anchor_t *pAnchor )
+{
+	int32_t nIndex = pAnchor->nHeapIndex;
+	if ( nIndex < 0 )
+		return;
+
+	int32_t nLast = (int32_t)m_vecHeap.size() - 1;
+	if ( nIndex != nLast )
+		HeapSwap( nIndex, nLast );
+	m_vecHeap.pop_back();
+	pAnchor->nHeapIndex = -1;
+
+	if ( nIndex < nLast )
+	{
+		HeapUp( nIndex );
+		HeapDown( nIndex );
+	}
+}
+
+
+void CSpatialAnchorStore::HeapSwap( int32_t nA, int32_t nB )
+{
+	Anchor_t *pA = m_vecHeap[ nA ];
+	m_vecHeap[ nA ] = m_vecHeap[ nB ];
+	m_vecHeap[ nB ] = pA;
+	m_vecHeap[ nA ]->nHeapIndex = nA;
+	m_vecHeap[ nB ]->nHeapIndex = nB;
+}
+
+
+void CSpatialAnchorStore::HeapUp( int32_t nIndex )
+{
+	while ( nIndex > 0 )
+	{
+		int32_t nParent = ( nIndex - 1 ) / 2;
+		if ( m_vecHeap[ nParent ]->flDeadline <= m_vecHeap[ nIndex ]->flDeadline )
+			break;
+		HeapSwap( nParent, nIndex );
+		nIndex = nParent;
+	}
+}
+
+
+void CSpatialAnchorStore::HeapDown( int32_t nIndex )
+{
+	int32_t nCount = (int32_t)m_vecHeap.size();
+	for ( ;; )
+	{
+		int32_t nSmallest = nIndex;
+		int32_t nLeft = nIndex * 2 + 1;
+		int32_t nRight = nLeft + 1;
+		if ( nLeft < nCount && m_vecHeap[ nLeft ]->flDeadline < m_vecHeap[ nSmallest ]->flDeadline )
+			nSmallest = nLeft;
+		if ( nRight < nCount && m_vecHeap[ nRight ]->flDeadline < m_vecHeap[ nSmallest ]->flDeadline )
+			nSmallest = nRight;
+		if ( nSmallest == nIndex )
+			break;
+		HeapSwap( nIndex, nSmallest );
+		nIndex = nSmallest;
+	}
+}
+
+
+void CSpatialAnchorStore::WorkerThread()
+{
+	std::unique_lock<std::mutex> lock( m_mutex );
+	for ( ;; )
+	{
+		m_workCondition.wait( lock, [ this ] { return m_bExiting || !m_queueBatches.empty(); } );
+		if ( m_bExiting )
+			break;
+
+		std::vector<Job_t> batch;
+		batch.swap( m_queueBatches.front() );
+		m_queueBatches.pop_front();
+		m_unBusyWorkers++;
+
+		lock.unlock();
+		for ( size_t i = 0; i < batch.size(); i++ )
+		{
+			ProcessJob( batch[ i ] );
+		}
+		lock.lock();
+
+		m_unBusyWorkers--;
+		if ( m_queueBatches.empty() && m_unBusyWorkers == 0 )
+			m_idleCondition.notify_all();
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Resolves one anchor without holding the lock, then reschedules it
+//			and reports the result. A job whose anchor was removed or given a
+//			new descriptor in the meantime is dropped.
+//-----------------------------------------------------------------------------
+void CSpatialAnchorStore::ProcessJob( const Job_t &job )
+{
+	if ( job.bBuildDescriptor )
+	{
+		vr::SpatialAnchorDriverPose_t pose;
+		std::string sDescriptor;
+		bool bBuilt = m_pAnchors->GetSpatialAnchorPose( job.unHandle, &pose ) == vr::VRSpatialAnchorError_Success
+			&& m_fnBuildDescriptor( pose, &sDescriptor );
+
+		{
+			std::lock_guard<std::mutex> lock( m_mutex );
+			auto iter = m_mapAnchors.find( job.unHandle );
+			if ( iter == m_mapAnchors.end() )
+			{
+				m_ulStaleResults++;
+				return;
+			}
+
+			Anchor_t &anchor = iter->second;
+			if ( anchor.unGeneration != job.unGeneration )
+			{
+				// if the descriptor is still wanted and nothing else picked it up, build it again
+				m_ulStaleResults++;
+				if ( anchor.bNeedsDescriptor && !anchor.bQueued )
+				{
+					std::vector<Job_t> batch;
+					QueueLocked( &anchor, &batch );
+					FlushBatchLocked( &batch );
+				}
+				return;
+			}
+
+			anchor.bQueued = false;
+			anchor.bNeedsDescriptor = false;
+			if ( !bBuilt )
+			{
+				m_ulResolveFailures++;
+				return;
+			}
+
+			// the pose came from the application, so it stays until something asks for an update
+			anchor.sDescriptor = sDescriptor;
+			anchor.unGeneration++;
+			SetUniverseLocked( &anchor, pose.ulRequiredUniverseId );
+			m_ulDescriptorsBuilt++;
+		}
+
+		m_pAnchors->UpdateSpatialAnchorDescriptor( job.unHandle, sDescriptor.c_str() );
+		return;
+	}
+
+	uint64_t ulUniverseId;
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		ulUniverseId = m_ulCurrentUniverse;
+	}
+
+	vr::SpatialAnchorDriverPose_t pose;
+	memset( &pose, 0, sizeof( pose ) );
+	vr::EVRSpatialAnchorError eError = m_fnResolve( job.sDescriptor, ulUniverseId, &pose );
+
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		auto iter = m_mapAnchors.find( job.unHandle );
+		if ( iter == m_mapAnchors.end() || iter->second.unGeneration != job.unGeneration )
+		{
+			m_ulStaleResults++;
+			return;
+		}
+
+		Anchor_t &anchor = iter->second;
+		anchor.bQueued = false;
+		double flNow = Now();
+		if ( eError == vr::VRSpatialAnchorError_Success )
+		{
+			m_ulResolves++;
+			SetUniverseLocked( &anchor, pose.ulRequiredUniverseId );
+			if ( pose.fValidDuration > 0.0 )
+				HeapSchedule( &anchor, flNow + pose.fValidDuration );
+			else
+				HeapRemove( &anchor );
+		}
+		else
+		{
+			m_ulResolveFailures++;
+			if ( eError == vr::VRSpatialAnchorError_NotYetAvailable )
+				HeapSchedule( &anchor, flNow + k_flRetrySeconds );
+			else
+				HeapRemove( &anchor );
+		}
+	}
+
+	if ( eError == vr::VRSpatialAnchorError_Success )
+		m_pAnchors->UpdateSpatialAnchorPose( job.unHandle, &pose );
+	else
+		m_pAnchors->SetSpatialAnchorPoseError( job.unHandle, eError, eError == vr::VRSpatialAnchorError_NotYetAvailable ? k_flRetrySeconds : -1.0 );
+}
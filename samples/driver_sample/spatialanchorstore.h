@@ -0,0 +1,148 @@
+//========= Copyright Valve Corporation ============//
+
+#ifndef SPATIALANCHORSTORE_H
+#define SPATIALANCHORSTORE_H
+
+#pragma once
+
+#include <openvr_driver.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+struct SpatialAnchorStoreStats_t
+{
+	uint32_t unAnchors;
+	uint32_t unScheduled;			// anchors with a refresh deadline
+	uint64_t ulResolves;			// poses computed by the workers
+	uint64_t ulResolveFailures;
+	uint64_t ulStaleResults;		// results thrown away because the anchor changed while it was resolving
+	uint64_t ulDescriptorsBuilt;
+};
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Keeps track of every spatial anchor the driver has been asked
+//			about and refreshes poses when their fValidDuration runs out.
+//
+//			Anchors are indexed by handle, and anchors with a finite
+//			fValidDuration sit in a min-heap keyed on their refresh deadline.
+//			Events and Tick() only touch the anchors they concern, so upkeep
+//			is O(log n) per anchor instead of a scan over the whole set.
+//			Anchors are also grouped by the universe their pose requires so a
+//			universe change only re-resolves the anchors it affects.
+//
+//			Resolving a descriptor into a pose is done in batches on a pool of
+//			worker threads. Results are reported to IVRDriverSpatialAnchors
+//			from those threads, outside the store lock.
+//-----------------------------------------------------------------------------
+class CSpatialAnchorStore
+{
+public:
+	/** turns a descriptor into a pose for the given universe. Fill in fValidDuration; return an error to report instead. */
+	typedef std::function< vr::EVRSpatialAnchorError( const std::string &sDescriptor, uint64_t ulUniverseId, vr::SpatialAnchorDriverPose_t *pPose ) > PoseResolver_t;
+
+	/** builds the driver descriptor for a pose an application registered */
+	typedef std::function< bool( const vr::SpatialAnchorDriverPose_t &pose, std::string *psDescriptor ) > DescriptorBuilder_t;
+
+	CSpatialAnchorStore();
+	~CSpatialAnchorStore();
+
+	/** pAnchors is normally vr::VRDriverSpatialAnchors() */
+	bool Start( vr::IVRDriverSpatialAnchors *pAnchors, PoseResolver_t fnResolve, DescriptorBuilder_t fnBuildDescriptor, uint32_t unWorkerThreads );
+	void Stop();
+
+	/** handles VREvent_SpatialAnchors_*. Returns false for any other event. */
+	bool ProcessEvent( const vr::VREvent_t &vrEvent );
+
+	/** queues anchors whose refresh deadline has passed. flNow is in the same clock as Now(). */
+	void Tick( double flNow );
+	void Tick() { Tick( Now() ); }
+
+	/** re-resolves the anchors of the new universe, plus those that work in any universe */
+	void SetCurrentUniverse( uint64_t ulUniverseId );
+
+	/** forgets an anchor entirely */
+	void RemoveAnchor( vr::SpatialAnchorHandle_t unHandle );
+
+	/** blocks until no batches are queued or running */
+	void WaitForIdle();
+
+	bool HasAnchor( vr::SpatialAnchorHandle_t unHandle ) const;
+	SpatialAnchorStoreStats_t GetStats() const;
+
+	/** seconds on the steady clock */
+	static double Now();
+
+	static const uint32_t k_unBatchSize = 32;
+
+private:
+	struct Anchor_t
+	{
+		vr::SpatialAnchorHandle_t unHandle;
+		std::string sDescriptor;
+		uint64_t ulUniverseId;			// universe the last pose required, 0 if any
+		uint32_t unGeneration;			// bumped whenever the descriptor changes
+		double flDeadline;
+		int32_t nHeapIndex;				// -1 when not scheduled
+		bool bQueued;					// waiting for or being resolved by a worker
+		bool bNeedsDescriptor;
+	};
+
+	struct Job_t
+	{
+		vr::SpatialAnchorHandle_t unHandle;
+		uint32_t unGeneration;
+		std::string sDescriptor;
+		bool bBuildDescriptor;
+	};
+
+	Anchor_t *FindOrAddAnchor( vr::SpatialAnchorHandle_t unHandle );
+	void QueueLocked( Anchor_t *pAnchor, std::vector<Job_t> *pBatch );
+	void FlushBatchLocked( std::vector<Job_t> *pBatch );
+	void SetUniverseLocked( Anchor_t *pAnchor, uint64_t ulUniverseId );
+	void RemoveFromUniverseLocked( const Anchor_t *pAnchor );
+	bool FetchDescriptor( vr::IVRDriverSpatialAnchors *pAnchors, vr::SpatialAnchorHandle_t unHandle, std::string *psDescriptor );
+
+	// deadline heap, ordered on Anchor_t::flDeadline
+	void HeapSchedule( Anchor_t *pAnchor, double flDeadline );
+	void HeapRemove( Anchor_t *pAnchor );
+	void HeapSwap( int32_t nA, int32_t nB );
+	void HeapUp( int32_t nIndex );
+	void HeapDown( int32_t nIndex );
+
+	void WorkerThread();
+	void ProcessJob( const Job_t &job );
+
+	vr::IVRDriverSpatialAnchors *m_pAnchors;
+	PoseResolver_t m_fnResolve;
+	DescriptorBuilder_t m_fnBuildDescriptor;
+
+	mutable std::mutex m_mutex;
+	std::unordered_map< vr::SpatialAnchorHandle_t, Anchor_t > m_mapAnchors;
+	std::unordered_map< uint64_t, std::unordered_set< vr::SpatialAnchorHandle_t > > m_mapUniverses;
+	std::vector< Anchor_t * > m_vecHeap;
+	uint64_t m_ulCurrentUniverse;
+
+	std::condition_variable m_workCondition;
+	std::condition_variable m_idleCondition;
+	std::deque< std::vector<Job_t> > m_queueBatches;
+	uint32_t m_unBusyWorkers;
+	std::vector< std::thread * > m_vecWorkers;
+	bool m_bExiting;
+
+	uint64_t m_ulResolves;
+	uint64_t m_ulResolveFailures;
+	uint64_t m_ulStaleResults;
+	uint64_t m_ulDescriptorsBuilt;
+};
+
+
+#endif // SPATIALANCHORSTORE_H
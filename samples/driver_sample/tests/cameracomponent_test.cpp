@@ -0,0 +1,138 @@
+//========= Copyright Valve Corporation ============//
+// Streams CCameraComponentSample from the synthetic source, without vrserver
+// or a camera, and checks the frames and buffer accounting it hands out.
+
+#include "cameracomponent.h"
+#include "testharness.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+class CCountingSink : public vr::ICameraVideoSinkCallback
+{
+public:
+	CCountingSink() : m_unCalls( 0 ) {}
+	virtual void OnCameraVideoSinkCallback() { m_unCalls++; }
+	std::atomic<uint32_t> m_unCalls;
+};
+
+static const vr::CameraVideoStreamFrame_t *WaitForFrame( CCameraComponentSample &camera )
+{
+	for ( int i = 0; i < 200; i++ )
+	{
+		if ( const vr::CameraVideoStreamFrame_t *pFrame = camera.GetVideoStreamFrame() )
+			return pFrame;
+		std::this_thread::sleep_for( std::chrono::milliseconds( 5 ) );
+	}
+	return nullptr;
+}
+
+static CCameraComponentSample::Config_t MakeConfig()
+{
+	CCameraComponentSample::Config_t config;
+	config.unWidth = 64;
+	config.unHeight = 32;
+	config.unFrameRate = 120;
+	config.flHorizontalFOV = 90.f;
+	return config;
+}
+
+static void TestOwnedBuffers()
+{
+	CSyntheticCameraSource source;
+	CCameraComponentSample camera( &source );
+	CHECK( camera.Init( MakeConfig() ) );
+
+	uint32_t unWidth = 0, unHeight = 0;
+	CHECK( camera.GetCameraFrameDimensions( vr::CVS_FORMAT_RGB24, &unWidth, &unHeight ) );
+	CHECK( unWidth == 64 && unHeight == 32 );
+
+	CCountingSink sink;
+	camera.SetCameraVideoSinkCallback( &sink );
+	CHECK( camera.StartVideoStream() );
+
+	const vr::CameraVideoStreamFrame_t *pFrame = WaitForFrame( camera );
+	CHECK( pFrame != nullptr );
+	if ( pFrame )
+	{
+		bool bPaused = true;
+		float flElapsed = 0.f;
+		CHECK( camera.IsVideoStreamActive( &bPaused, &flElapsed ) );
+		CHECK( !bPaused );
+
+		CHECK( pFrame->m_nStreamFormat == vr::CVS_FORMAT_RGB24 );
+		CHECK( pFrame->m_nWidth == 64 && pFrame->m_nHeight == 32 );
+		CHECK( pFrame->m_nImageDataSize == 64 * 32 * 3 );
+		CHECK( pFrame->m_pImageData != 0 );
+
+		// on the stream's timeline, not the steady clock's epoch. The first frame may have been
+		// captured a little before the stream started.
+		CHECK( pFrame->m_flFrameCaptureTime_ServerRelative > -1.0 );
+		CHECK( pFrame->m_flFrameCaptureTime_ServerRelative <= flElapsed + 0.001 );
+		CHECK( pFrame->m_flFrameCaptureTime_ServerRelative <= pFrame->m_flFrameElapsedTime + 0.001 );
+
+		camera.ReleaseVideoStreamFrame( pFrame );
+	}
+	CHECK( sink.m_unCalls > 0 );
+
+	camera.StopVideoStream();
+	CHECK( !camera.IsVideoStreamActive( nullptr, nullptr ) );
+
+	CameraComponentStats_t stats = camera.GetStats();
+	CHECK( stats.ulFramesDelivered == 1 );
+	CHECK( stats.ulFramesCaptured >= 1 );
+	camera.Shutdown();
+}
+
+static void TestHeldBuffersDrop()
+{
+	CSyntheticCameraSource source;
+	CCameraComponentSample camera( &source );
+	CHECK( camera.Init( MakeConfig() ) );
+
+	// two buffers supplied the way vrserver would, in YUYV
+	CHECK( camera.SetCameraVideoStreamFormat( vr::CVS_FORMAT_YUYV16 ) );
+	int nQueueSize = 0;
+	uint32_t unBufferSize = 0;
+	CHECK( camera.GetCameraFrameBufferingRequirements( &nQueueSize, &unBufferSize ) );
+	CHECK( unBufferSize == 64 * 32 * 2 );
+
+	std::vector<uint8_t> vecStorage( unBufferSize * 2 );
+	void *rgBuffers[] = { &vecStorage[ 0 ], &vecStorage[ unBufferSize ] };
+	CHECK( camera.SetCameraFrameBuffering( 2, rgBuffers, unBufferSize ) );
+	CHECK( camera.StartVideoStream() );
+
+	// hold both buffers, after which the capture thread has nowhere to put frames
+	const vr::CameraVideoStreamFrame_t *pFirst = WaitForFrame( camera );
+	const vr::CameraVideoStreamFrame_t *pSecond = WaitForFrame( camera );
+	CHECK( pFirst && pSecond && pFirst != pSecond );
+
+	std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+	CHECK( camera.GetVideoStreamFrame() == nullptr );
+	CHECK( camera.GetStats().ulFramesDropped > 0 );
+
+	if ( pFirst && pSecond )
+	{
+		CHECK( pFirst->m_nBufferCount == 2 );
+		CHECK( (uint8_t *)(uintptr_t)pFirst->m_pImageData == rgBuffers[ pFirst->m_nBufferIndex ] );
+
+		// handing one back lets capture resume
+		camera.ReleaseVideoStreamFrame( pFirst );
+		CHECK( WaitForFrame( camera ) != nullptr );
+	}
+
+	camera.Shutdown();
+}
+
+int main( int argc, char *argv[] )
+{
+	ParseTestArgs( argc, argv );
+
+	TestOwnedBuffers();
+	TestHeldBuffersDrop();
+
+	return FinishTest( "cameracomponent_test" );
+}
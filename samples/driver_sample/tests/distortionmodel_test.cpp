@@ -0,0 +1,209 @@
+//========= Copyright Valve Corporation ============//
+// Checks the batch path and the tabulated grid against
+// CDistortionModel::Evaluate, then times all three per sample.
+
+#include "distortionmodel.h"
+#include "testharness.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+
+static DistortionModelParams_t MakeLensParams()
+{
+	DistortionModelParams_t params = CDistortionModel().GetParams();
+	params.flCenterU = 0.48f;
+	params.flCenterV = 0.51f;
+	params.rgflK[ 0 ] = 0.22f;
+	params.rgflK[ 1 ] = 0.24f;
+	params.rgflK[ 2 ] = -0.05f;
+	params.rgflChannelScale[ 0 ] = 1.008f;
+	params.rgflChannelScale[ 1 ] = 1.f;
+	params.rgflChannelScale[ 2 ] = 0.991f;
+	return params;
+}
+
+static float MaxDifference( const vr::DistortionCoordinates_t &a, const vr::DistortionCoordinates_t &b )
+{
+	float flMax = 0.f;
+	for ( int i = 0; i < 2; i++ )
+	{
+		flMax = fmaxf( flMax, fabsf( a.rfRed[ i ] - b.rfRed[ i ] ) );
+		flMax = fmaxf( flMax, fabsf( a.rfGreen[ i ] - b.rfGreen[ i ] ) );
+		flMax = fmaxf( flMax, fabsf( a.rfBlue[ i ] - b.rfBlue[ i ] ) );
+	}
+	return flMax;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Six output arrays with a guard value after each, so writes past
+//			unCount show up
+//-----------------------------------------------------------------------------
+struct BatchBuffers_t
+{
+	static const uint32_t k_unGuard = 4;
+
+	explicit BatchBuffers_t( uint32_t unCount )
+		: m_unStride( unCount + k_unGuard ), m_vecData( 6 * ( unCount + k_unGuard ), -123.f )
+	{
+		float *pBase = m_vecData.data();
+		m_output.pRedU = pBase;
+		m_output.pRedV = pBase + m_unStride;
+		m_output.pGreenU = pBase + 2 * m_unStride;
+		m_output.pGreenV = pBase + 3 * m_unStride;
+		m_output.pBlueU = pBase + 4 * m_unStride;
+		m_output.pBlueV = pBase + 5 * m_unStride;
+	}
+
+	vr::DistortionCoordinates_t Get( uint32_t i ) const
+	{
+		vr::DistortionCoordinates_t coordinates;
+		coordinates.rfRed[ 0 ] = m_output.pRedU[ i ];
+		coordinates.rfRed[ 1 ] = m_output.pRedV[ i ];
+		coordinates.rfGreen[ 0 ] = m_output.pGreenU[ i ];
+		coordinates.rfGreen[ 1 ] = m_output.pGreenV[ i ];
+		coordinates.rfBlue[ 0 ] = m_output.pBlueU[ i ];
+		coordinates.rfBlue[ 1 ] = m_output.pBlueV[ i ];
+		return coordinates;
+	}
+
+	bool GuardsIntact( uint32_t unCount ) const
+	{
+		for ( uint32_t unArray = 0; unArray < 6; unArray++ )
+		{
+			for ( uint32_t i = unCount; i < m_unStride; i++ )
+			{
+				if ( m_vecData[ unArray * m_unStride + i ] != -123.f )
+					return false;
+			}
+		}
+		return true;
+	}
+
+	uint32_t m_unStride;
+	std::vector<float> m_vecData;
+	DistortionBatchOutput_t m_output;
+};
+
+// samples spread over the viewport and a little past its edges
+static void MakeSamples( uint32_t unCount, std::vector<float> *pvecU, std::vector<float> *pvecV )
+{
+	pvecU->resize( unCount );
+	pvecV->resize( unCount );
+	for ( uint32_t i = 0; i < unCount; i++ )
+	{
+		( *pvecU )[ i ] = -0.05f + 1.1f * ( ( i * 37 ) % 101 ) / 100.f;
+		( *pvecV )[ i ] = -0.05f + 1.1f * ( ( i * 53 ) % 97 ) / 96.f;
+	}
+}
+
+static void TestModel()
+{
+	CDistortionModel identity;
+	CHECK( identity.IsIdentity() );
+	vr::DistortionCoordinates_t unchanged = identity.Evaluate( 0.3f, 0.7f );
+	CHECK( unchanged.rfRed[ 0 ] == 0.3f && unchanged.rfGreen[ 1 ] == 0.7f && unchanged.rfBlue[ 0 ] == 0.3f );
+
+	CDistortionModel model( MakeLensParams() );
+	CHECK( !model.IsIdentity() );
+
+	// the center stays put and every channel moves outwards, red most
+	vr::DistortionCoordinates_t center = model.Evaluate( 0.48f, 0.51f );
+	CHECK( fabsf( center.rfGreen[ 0 ] - 0.48f ) < 1e-6f && fabsf( center.rfGreen[ 1 ] - 0.51f ) < 1e-6f );
+	vr::DistortionCoordinates_t corner = model.Evaluate( 1.f, 1.f );
+	CHECK( corner.rfRed[ 0 ] > corner.rfGreen[ 0 ] && corner.rfGreen[ 0 ] > corner.rfBlue[ 0 ] && corner.rfBlue[ 0 ] > 1.f );
+
+	// every count around the four-wide steps, plus one bigger odd one
+	const uint32_t rgunCounts[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 13, 1027 };
+	for ( uint32_t unCount : rgunCounts )
+	{
+		std::vector<float> vecU, vecV;
+		MakeSamples( unCount, &vecU, &vecV );
+		BatchBuffers_t buffers( unCount );
+		model.EvaluateBatch( vecU.data(), vecV.data(), unCount, buffers.m_output );
+
+		float flMaxDifference = 0.f;
+		for ( uint32_t i = 0; i < unCount; i++ )
+			flMaxDifference = fmaxf( flMaxDifference, MaxDifference( buffers.Get( i ), model.Evaluate( vecU[ i ], vecV[ i ] ) ) );
+		CHECK( flMaxDifference < 1e-6f );
+		CHECK( buffers.GuardsIntact( unCount ) );
+	}
+}
+
+static void TestGrid()
+{
+	CDistortionModel model( MakeLensParams() );
+
+	// nothing built yet: UVs pass through
+	CDistortionGrid grid;
+	CHECK( !grid.IsBuilt() );
+	vr::DistortionCoordinates_t passThrough = grid.Sample( 0.25f, 0.75f );
+	CHECK( passThrough.rfRed[ 0 ] == 0.25f && passThrough.rfBlue[ 1 ] == 0.75f );
+
+	// bilinear reproduces the identity exactly and the nodes themselves exactly
+	CDistortionModel identity;
+	grid.Build( identity, 8 );
+	CHECK( grid.MeasureMaxError( identity, 33 ) < 1e-6f );
+
+	grid.Build( model, 16 );
+	CHECK( grid.IsBuilt() && grid.GetResolution() == 16 );
+	CHECK( MaxDifference( grid.Sample( 0.25f, 0.5f ), model.Evaluate( 0.25f, 0.5f ) ) < 1e-6f );
+	float flCoarseError = grid.MeasureMaxError( model, 257 );
+
+	// the sample's own resolution. Error falls with the square of the node spacing.
+	grid.Build( model, 64 );
+	float flFineError = grid.MeasureMaxError( model, 257 );
+	CHECK( flFineError < 1e-3f );
+	CHECK( flFineError < flCoarseError / 8.f );
+
+	// outside the viewport the edge of the grid is used
+	CHECK( MaxDifference( grid.Sample( -0.5f, 1.5f ), grid.Sample( 0.f, 1.f ) ) == 0.f );
+	CHECK( MaxDifference( grid.Sample( 2.f, 0.5f ), grid.Sample( 1.f, 0.5f ) ) == 0.f );
+
+	printf( "Grid max error over 257x257 samples: 16x16 %g, 64x64 %g\n", flCoarseError, flFineError );
+}
+
+static void BenchmarkEvaluate()
+{
+	// not a multiple of four, so the batch's scalar tail is in the timing too
+	const uint32_t k_unSamples = 1027;
+	std::vector<float> vecU, vecV;
+	MakeSamples( k_unSamples, &vecU, &vecV );
+	BatchBuffers_t buffers( k_unSamples );
+	CDistortionModel model( MakeLensParams() );
+	CDistortionGrid grid;
+	grid.Build( model, 64 );
+
+	double flScalar = MeasureNsPerCall( [&]
+	{
+		float flSum = 0.f;
+		for ( uint32_t i = 0; i < k_unSamples; i++ )
+			flSum += model.Evaluate( vecU[ i ], vecV[ i ] ).rfGreen[ 0 ];
+		return flSum > 0.f;
+	} ) / k_unSamples;
+	double flBatch = MeasureNsPerCall( [&]
+	{
+		model.EvaluateBatch( vecU.data(), vecV.data(), k_unSamples, buffers.m_output );
+		return buffers.m_output.pGreenU[ k_unSamples - 1 ] > 0.f;
+	} ) / k_unSamples;
+	double flGrid = MeasureNsPerCall( [&]
+	{
+		float flSum = 0.f;
+		for ( uint32_t i = 0; i < k_unSamples; i++ )
+			flSum += grid.Sample( vecU[ i ], vecV[ i ] ).rfGreen[ 0 ];
+		return flSum > 0.f;
+	} ) / k_unSamples;
+
+	printf( "Per sample over %u samples: Evaluate %5.2f ns, EvaluateBatch %5.2f ns, grid Sample %5.2f ns\n", k_unSamples, flScalar, flBatch, flGrid );
+}
+
+int main( int argc, char *argv[] )
+{
+	ParseTestArgs( argc, argv );
+
+	TestModel();
+	TestGrid();
+	BenchmarkEvaluate();
+
+	return FinishTest( "distortionmodel_test" );
+}
@@ -0,0 +1,198 @@
+//========= Copyright Valve Corporation ============//
+// Runs the driver log against an IVRDriverLog that keeps what it is given,
+// then times a log call on the calling thread, which is what pose and input
+// threads pay. That is meant to stay in the tens of nanoseconds.
+
+#include "driverlog.h"
+#include "testharness.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum ETestColor
+{
+	TestColor_Red = 7,
+};
+
+// the flusher thread calls Log, so everything here is under the mutex
+class CTestDriverLog : public vr::IVRDriverLog
+{
+public:
+	CTestDriverLog() : m_bKeep( true ) {}
+
+	virtual void Log( const char *pchLogMessage ) override
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		if ( m_bKeep )
+			m_vecMessages.push_back( pchLogMessage );
+	}
+
+	std::vector<std::string> TakeMessages()
+	{
+		FlushDriverLog();
+		std::lock_guard<std::mutex> lock( m_mutex );
+		std::vector<std::string> vecMessages;
+		vecMessages.swap( m_vecMessages );
+		return vecMessages;
+	}
+
+	void SetKeep( bool bKeep )
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		m_bKeep = bKeep;
+	}
+
+private:
+	std::mutex m_mutex;
+	bool m_bKeep;
+	std::vector<std::string> m_vecMessages;
+};
+
+static bool HasOnly( const std::vector<std::string> &vecMessages, const std::string &sMessage )
+{
+	return vecMessages.size() == 1 && vecMessages[ 0 ] == sMessage;
+}
+
+static void TestLogging( CTestDriverLog &log )
+{
+	DriverLog( "plain %d\n", 1 );
+	CHECK( HasOnly( log.TakeMessages(), "plain 1\n" ) );
+
+	// deferred arguments are formatted on the flusher, from copies
+	char rchName[ 16 ];
+	strcpy( rchName, "left" );
+	short nShort = -3;
+	float flValue = 1.5f;
+	DriverLogDeferred( DriverLogLevel_Info, "%s %d %.2f %d %llu %p\n", rchName, nShort, flValue, TestColor_Red, 12345678901ull, (void *)nullptr );
+	strcpy( rchName, "right" );
+	char rchExpected[ 128 ];
+	snprintf( rchExpected, sizeof( rchExpected ), "left -3 1.50 7 12345678901 %p\n", (void *)nullptr );
+	CHECK( HasOnly( log.TakeMessages(), rchExpected ) );
+
+	const char *pchNull = nullptr;
+	DriverLogDeferred( DriverLogLevel_Info, "%s\n", pchNull );
+	CHECK( HasOnly( log.TakeMessages(), "(null)\n" ) );
+
+	// arguments that don't fit in a record are formatted right away, still in full
+	std::string sLong( 400, 'x' );
+	DriverLogDeferred( DriverLogLevel_Warning, "long %s end\n", sLong.c_str() );
+	CHECK( HasOnly( log.TakeMessages(), "long " + sLong + " end\n" ) );
+
+	// formatted text longer than a record spans several and arrives whole
+	std::string sSpanning( 3 * driverlog::k_unPayloadSize + 17, 'y' );
+	DriverLog( "%s\n", sSpanning.c_str() );
+	CHECK( HasOnly( log.TakeMessages(), sSpanning + "\n" ) );
+
+	// severity filter
+	SetDriverLogLevel( DriverLogLevel_Warning );
+	DriverLog( "filtered\n" );
+	DriverLogDeferred( DriverLogLevel_Info, "filtered %d\n", 2 );
+	DriverLogWithLevel( DriverLogLevel_Error, "kept\n" );
+	CHECK( HasOnly( log.TakeMessages(), "kept\n" ) );
+	SetDriverLogLevel( DriverLogLevel_Debug );
+
+	// a rate limited call site lets its budget through and counts the rest
+	DriverLogStats_t statsBefore, statsAfter;
+	GetDriverLogStats( &statsBefore );
+	for ( int i = 0; i < 20; i++ )
+		DRIVER_LOG_RATE_LIMITED( DriverLogLevel_Info, 5, "limited %d\n", i );
+	CHECK( log.TakeMessages().size() == 5 );
+	GetDriverLogStats( &statsAfter );
+	CHECK( statsAfter.ulRateLimited - statsBefore.ulRateLimited == 15 );
+	CHECK( statsAfter.ulQueued - statsBefore.ulQueued == 5 );
+	CHECK( statsAfter.ulWritten - statsBefore.ulWritten == 5 );
+
+	// what a thread queues before it exits is still written
+	std::thread thread( []
+	{
+		for ( int i = 0; i < 10; i++ )
+			DriverLogDeferred( DriverLogLevel_Info, "thread %d\n", i );
+	} );
+	thread.join();
+	std::vector<std::string> vecMessages = log.TakeMessages();
+	CHECK( vecMessages.size() == 10 && vecMessages.back() == "thread 9\n" );
+}
+
+static void TestRestart( CTestDriverLog &log )
+{
+	CleanupDriverLog();
+	DriverLog( "while shut down\n" );
+
+	CHECK( InitDriverLog( &log ) );
+	CHECK( !InitDriverLog( &log ) );
+	DriverLog( "after restart\n" );
+	CHECK( HasOnly( log.TakeMessages(), "after restart\n" ) );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Times unBurst calls at a time, draining between bursts outside the
+//			timing so the ring never fills and the calls measured are the ones
+//			that queue
+//-----------------------------------------------------------------------------
+template< class Fn >
+static double MeasureNsPerLogCall( Fn fn )
+{
+	const uint32_t unBurst = 128;
+	std::chrono::duration< double, std::nano > logging( 0 );
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	uint64_t ulCalls = 0;
+	do
+	{
+		std::chrono::steady_clock::time_point burstStart = std::chrono::steady_clock::now();
+		for ( uint32_t i = 0; i < unBurst; i++ )
+			fn( i );
+		logging += std::chrono::steady_clock::now() - burstStart;
+		ulCalls += unBurst;
+		FlushDriverLog();
+	} while ( std::chrono::steady_clock::now() - start < std::chrono::duration< double >( s_flBenchSeconds ) );
+
+	return logging.count() / ulCalls;
+}
+
+static void BenchmarkLogging( CTestDriverLog &log )
+{
+	log.SetKeep( false );
+	DriverLogStats_t statsBefore, statsAfter;
+	GetDriverLogStats( &statsBefore );
+
+	double flDeferred = MeasureNsPerLogCall( []( uint32_t i )
+	{
+		DriverLogDeferred( DriverLogLevel_Info, "pose %u: %f %f %f\n", i, 0.25, 1.5, -3.0 );
+	} );
+	double flFormatted = MeasureNsPerLogCall( []( uint32_t i )
+	{
+		DriverLogWithLevel( DriverLogLevel_Info, "pose %u: %f %f %f\n", i, 0.25, 1.5, -3.0 );
+	} );
+
+	GetDriverLogStats( &statsAfter );
+	CHECK( statsAfter.ulDropped == statsBefore.ulDropped );
+
+	SetDriverLogLevel( DriverLogLevel_Warning );
+	double flFiltered = MeasureNsPerLogCall( []( uint32_t i )
+	{
+		DriverLogDeferred( DriverLogLevel_Info, "pose %u: %f %f %f\n", i, 0.25, 1.5, -3.0 );
+	} );
+	SetDriverLogLevel( DriverLogLevel_Debug );
+	log.SetKeep( true );
+
+	printf( "Per call on the logging thread: deferred %6.1f ns, formatted %6.1f ns, filtered %6.1f ns\n", flDeferred, flFormatted, flFiltered );
+}
+
+int main( int argc, char *argv[] )
+{
+	ParseTestArgs( argc, argv );
+
+	CTestDriverLog log;
+	CHECK( InitDriverLog( &log ) );
+	TestLogging( log );
+	TestRestart( log );
+	BenchmarkLogging( log );
+	CleanupDriverLog();
+
+	return FinishTest( "driverlog_test" );
+}
@@ -0,0 +1,180 @@
+//========= Copyright Valve Corporation ============//
+// Runs typed IOBuffer streams over CMemoryIOBuffer: batches and sequence
+// numbers, a writer lapping its reader, writes larger than the ring and
+// producers skipped while nobody listens. Then times batched writes against
+// one Write per record.
+
+#include "iobufferstream.h"
+#include "memoryiobuffer.h"
+#include "testharness.h"
+
+#include <stdio.h>
+#include <vector>
+
+struct TestRecord_t
+{
+	uint32_t unValue;
+	float flValue;
+};
+
+typedef CIOBufferStreamWriter<TestRecord_t> CTestWriter;
+typedef CIOBufferStreamReader<TestRecord_t> CTestReader;
+
+// fills records with values following on from *punNext
+static uint32_t ProduceRecords( TestRecord_t *pRecords, uint32_t unCount, uint32_t *punNext )
+{
+	for ( uint32_t i = 0; i < unCount; i++ )
+	{
+		pRecords[ i ].unValue = *punNext;
+		pRecords[ i ].flValue = *punNext * 0.5f;
+		( *punNext )++;
+	}
+	return unCount;
+}
+
+// drains the reader, checking that sequence numbers run on from ulFirst and values track them
+static uint32_t DrainInOrder( CTestReader &reader, uint64_t ulFirst )
+{
+	uint64_t ulExpected = ulFirst;
+	bool bInOrder = true;
+	uint32_t unRead = reader.Drain( [&]( const TestRecord_t &record, uint64_t ulSequence )
+	{
+		bInOrder = bInOrder && ulSequence == ulExpected && record.unValue == ( uint32_t )ulSequence && record.flValue == record.unValue * 0.5f;
+		ulExpected++;
+	} );
+	CHECK( bInOrder );
+	return unRead;
+}
+
+static void TestBatches()
+{
+	CMemoryIOBuffer ioBuffer;
+	CTestWriter writer;
+	CHECK( writer.Open( &ioBuffer, "/test/batches", 16, 8 ) == vr::IOBuffer_Success );
+
+	// nobody is reading yet, so the producer never runs
+	uint32_t unNext = 0;
+	bool bProducerCalled = false;
+	CHECK( writer.ProduceBatch( 8, [&]( TestRecord_t *, uint32_t ) { bProducerCalled = true; return 0u; } ) == vr::IOBuffer_Success );
+	CHECK( !bProducerCalled );
+	CHECK( writer.Stats().ulRecordsSkipped == 8 && writer.NextSequence() == 0 );
+
+	CTestReader reader;
+	CHECK( reader.Open( &ioBuffer, "/test/batches", 8 ) == vr::IOBuffer_Success );
+	CHECK( writer.HasReaders() );
+	CHECK( !reader.Poll().IsValid() );
+
+	// records added one at a time and produced in bulk share one sequence
+	for ( int i = 0; i < 3; i++ )
+	{
+		TestRecord_t record = { unNext, unNext * 0.5f };
+		unNext++;
+		CHECK( writer.AddRecord( record ) );
+	}
+	CHECK( writer.StagedCount() == 3 );
+	CHECK( writer.Flush() == vr::IOBuffer_Success );
+	CHECK( writer.ProduceBatch( 5, [&]( TestRecord_t *pRecords, uint32_t unMax ) { return ProduceRecords( pRecords, unMax - 1, &unNext ); } ) == vr::IOBuffer_Success );
+	CHECK( writer.Stats().ulRecordsWritten == 7 && writer.Stats().ulBatchesWritten == 2 );
+	CHECK( writer.NextSequence() == 7 );
+
+	CHECK( DrainInOrder( reader, 0 ) == 7 );
+	CHECK( reader.Stats().ulRecordsRead == 7 && reader.Stats().ulRecordsLost == 0 && reader.Stats().ulOverruns == 0 );
+
+	// a batch holds at most unMaxBatch records
+	for ( int i = 0; i < 8; i++ )
+		CHECK( writer.AddRecord() != nullptr );
+	CHECK( writer.AddRecord() == nullptr );
+	CHECK( writer.Flush() == vr::IOBuffer_Success );
+	reader.Drain( []( const TestRecord_t &, uint64_t ) {} );
+
+	// once the last reader goes, producing stops again
+	reader.Close();
+	CHECK( !writer.HasReaders() );
+	uint64_t ulSkipped = writer.Stats().ulRecordsSkipped;
+	CHECK( writer.ProduceBatch( 4, [&]( TestRecord_t *, uint32_t ) { bProducerCalled = true; return 0u; } ) == vr::IOBuffer_Success );
+	CHECK( !bProducerCalled && writer.Stats().ulRecordsSkipped == ulSkipped + 4 );
+}
+
+static void TestOverruns()
+{
+	CMemoryIOBuffer ioBuffer;
+	CTestWriter writer;
+	CTestReader reader;
+	CHECK( writer.Open( &ioBuffer, "/test/lapped", 16, 8 ) == vr::IOBuffer_Success );
+	CHECK( reader.Open( &ioBuffer, "/test/lapped", 8 ) == vr::IOBuffer_Success );
+
+	uint32_t unNext = 0;
+	auto fnProduce = [&unNext]( TestRecord_t *pRecords, uint32_t unMax ) { return ProduceRecords( pRecords, unMax, &unNext ); };
+	CHECK( writer.ProduceBatch( 7, fnProduce ) == vr::IOBuffer_Success );
+	CHECK( DrainInOrder( reader, 0 ) == 7 );
+
+	// 24 records into a ring of 16 before the reader looks: it resumes at the oldest one left
+	for ( int i = 0; i < 3; i++ )
+		CHECK( writer.ProduceBatch( 8, fnProduce ) == vr::IOBuffer_Success );
+	CHECK( DrainInOrder( reader, 15 ) == 16 );
+	CHECK( reader.Stats().ulRecordsLost == 8 && reader.Stats().ulOverruns == 1 );
+
+	// keeping up again costs nothing more
+	CHECK( writer.ProduceBatch( 8, fnProduce ) == vr::IOBuffer_Success );
+	CHECK( DrainInOrder( reader, 31 ) == 8 );
+	CHECK( reader.Stats().ulRecordsLost == 8 && reader.Stats().ulOverruns == 1 );
+	CHECK( reader.Stats().ulRecordsRead == 31 );
+
+	// a single write larger than the whole ring keeps only its newest records
+	CTestWriter smallWriter;
+	CTestReader smallReader;
+	CHECK( smallWriter.Open( &ioBuffer, "/test/small", 4, 8 ) == vr::IOBuffer_Success );
+	CHECK( smallReader.Open( &ioBuffer, "/test/small", 8 ) == vr::IOBuffer_Success );
+	unNext = 0;
+	CHECK( smallWriter.ProduceBatch( 1, fnProduce ) == vr::IOBuffer_Success );
+	CHECK( DrainInOrder( smallReader, 0 ) == 1 );
+	CHECK( smallWriter.ProduceBatch( 8, fnProduce ) == vr::IOBuffer_Success );
+	CHECK( smallWriter.Stats().ulRecordsWritten == 9 );
+	CHECK( DrainInOrder( smallReader, 5 ) == 4 );
+	CHECK( smallReader.Stats().ulRecordsLost == 4 && smallReader.Stats().ulOverruns == 1 );
+
+	// a stream can't be reopened with another record size, and readers don't create streams
+	vr::IOBufferHandle_t ulOther = vr::k_ulInvalidIOBufferHandle;
+	CHECK( ioBuffer.Open( "/test/small", vr::IOBufferMode_Read, sizeof( uint32_t ), 0, &ulOther ) == vr::IOBuffer_InvalidArgument );
+	CTestReader missingReader;
+	CHECK( missingReader.Open( &ioBuffer, "/test/missing", 8 ) == vr::IOBuffer_PathDoesNotExist );
+}
+
+static void BenchmarkWrites()
+{
+	const uint32_t k_unBatch = 32;
+	CMemoryIOBuffer ioBuffer;
+	CTestWriter batchedWriter, singleWriter;
+	CTestReader batchedReader, singleReader;
+	batchedWriter.Open( &ioBuffer, "/bench/batched", 1024, k_unBatch );
+	singleWriter.Open( &ioBuffer, "/bench/single", 1024, k_unBatch );
+	batchedReader.Open( &ioBuffer, "/bench/batched", k_unBatch );
+	singleReader.Open( &ioBuffer, "/bench/single", k_unBatch );
+
+	uint32_t unNext = 0;
+	double flBatched = MeasureNsPerCall( [&]
+	{
+		return batchedWriter.ProduceBatch( k_unBatch, [&unNext]( TestRecord_t *pRecords, uint32_t unMax ) { return ProduceRecords( pRecords, unMax, &unNext ); } );
+	} ) / k_unBatch;
+	double flSingle = MeasureNsPerCall( [&]
+	{
+		uint32_t unErrors = 0;
+		for ( uint32_t i = 0; i < k_unBatch; i++ )
+			unErrors += singleWriter.ProduceBatch( 1, [&unNext]( TestRecord_t *pRecords, uint32_t unMax ) { return ProduceRecords( pRecords, unMax, &unNext ); } ) != vr::IOBuffer_Success;
+		return unErrors;
+	} ) / k_unBatch;
+	CHECK( batchedWriter.Stats().ulWriteErrors == 0 && singleWriter.Stats().ulWriteErrors == 0 );
+
+	printf( "Per record written: batches of %u %6.1f ns, one Write per record %6.1f ns\n", k_unBatch, flBatched, flSingle );
+}
+
+int main( int argc, char *argv[] )
+{
+	ParseTestArgs( argc, argv );
+
+	TestBatches();
+	TestOverruns();
+	BenchmarkWrites();
+
+	return FinishTest( "iobufferstream_test" );
+}
@@ -0,0 +1,128 @@
+//========= Copyright Valve Corporation ============//
+// Sends hand-built datagrams at the CVirtualDisplaySample receiver and checks
+// that malformed, resized and duplicate packets can't corrupt a frame.
+
+#include "virtualdisplay.h"
+#include "testharness.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// must match the wire format in virtualdisplay.cpp
+#pragma pack( push, 1 )
+struct PacketHeader_t
+{
+	uint64_t nFrameId;
+	uint32_t unPacketIndex;
+	uint32_t unPacketCount;
+	uint32_t unFrameBytes;
+	uint32_t unPayloadBytes;
+};
+#pragma pack( pop )
+
+static const uint32_t k_unMaxPayload = 1400 - sizeof( PacketHeader_t );
+
+static uint16_t PickFreePort()
+{
+	int nSocket = socket( AF_INET, SOCK_DGRAM, IPPROTO_UDP );
+	sockaddr_in addr;
+	memset( &addr, 0, sizeof( addr ) );
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+	socklen_t nAddrLen = sizeof( addr );
+	bind( nSocket, (sockaddr *)&addr, sizeof( addr ) );
+	getsockname( nSocket, (sockaddr *)&addr, &nAddrLen );
+	close( nSocket );
+	return ntohs( addr.sin_port );
+}
+
+static void SendPacket( int nSocket, uint16_t usPort, uint64_t nFrameId, uint32_t unIndex, uint32_t unCount, uint32_t unFrameBytes, const std::vector<uint8_t> &vecPayload )
+{
+	PacketHeader_t header;
+	header.nFrameId = nFrameId;
+	header.unPacketIndex = unIndex;
+	header.unPacketCount = unCount;
+	header.unFrameBytes = unFrameBytes;
+	header.unPayloadBytes = (uint32_t)vecPayload.size();
+
+	std::vector<uint8_t> vecDatagram( sizeof( header ) + vecPayload.size() );
+	memcpy( vecDatagram.data(), &header, sizeof( header ) );
+	if ( !vecPayload.empty() )
+		memcpy( vecDatagram.data() + sizeof( header ), vecPayload.data(), vecPayload.size() );
+
+	sockaddr_in addr;
+	memset( &addr, 0, sizeof( addr ) );
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+	addr.sin_port = htons( usPort );
+	sendto( nSocket, vecDatagram.data(), vecDatagram.size(), 0, (sockaddr *)&addr, sizeof( addr ) );
+}
+
+static VirtualDisplayStats_t WaitForReceived( CVirtualDisplaySample &display, uint64_t ulFrames )
+{
+	VirtualDisplayStats_t stats = display.GetStats();
+	for ( int i = 0; i < 200 && stats.ulFramesReceived < ulFrames; i++ )
+	{
+		std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+		stats = display.GetStats();
+	}
+	return stats;
+}
+
+int main( int argc, char *argv[] )
+{
+	ParseTestArgs( argc, argv );
+
+	// 32x32 lets the RLE codec emit up to 5120 bytes, i.e. four packets
+	CVirtualDisplaySample::Config_t config;
+	config.unWidth = 32;
+	config.unHeight = 32;
+	config.flDisplayFrequency = 90.f;
+	config.usPort = PickFreePort();
+
+	CVirtualDisplaySample display;
+	CHECK( display.Start( config ) );
+
+	int nSocket = socket( AF_INET, SOCK_DGRAM, IPPROTO_UDP );
+	CHECK( nSocket >= 0 );
+
+	std::vector<uint8_t> vecFull( k_unMaxPayload, 0xab );
+
+	// frame 7 starts as a two packet, 1400 byte frame
+	SendPacket( nSocket, config.usPort, 7, 0, 2, 1400, vecFull );
+	// same frame id claiming to be bigger: used to write past the 1400 byte buffer
+	SendPacket( nSocket, config.usPort, 7, 3, 4, 5000, std::vector<uint8_t>( 5000 - 3 * k_unMaxPayload, 0xcd ) );
+	// a duplicate must not count as the second packet
+	SendPacket( nSocket, config.usPort, 7, 0, 2, 1400, vecFull );
+	// index out of range and a count that disagrees with the size
+	SendPacket( nSocket, config.usPort, 7, 2, 2, 1400, std::vector<uint8_t>() );
+	SendPacket( nSocket, config.usPort, 7, 1, 3, 1400, std::vector<uint8_t>( 1400 - k_unMaxPayload, 0xab ) );
+	// more than the codec can produce for 32x32
+	SendPacket( nSocket, config.usPort, 8, 0, 3121951, 0xfffffff0u, vecFull );
+
+	// a real frame: 1024 identical pixels are four 256 pixel runs
+	std::vector<uint8_t> vecEncoded;
+	for ( int i = 0; i < 4; i++ )
+	{
+		uint8_t rgRun[] = { 255, 1, 2, 3, 4 };
+		vecEncoded.insert( vecEncoded.end(), rgRun, rgRun + sizeof( rgRun ) );
+	}
+	SendPacket( nSocket, config.usPort, 9, 0, 1, (uint32_t)vecEncoded.size(), vecEncoded );
+
+	VirtualDisplayStats_t stats = WaitForReceived( display, 1 );
+	CHECK( stats.ulFramesReceived == 1 );
+	// only frame 7, which never got its second packet
+	CHECK( stats.ulFramesIncomplete == 1 );
+
+	close( nSocket );
+	display.Stop();
+
+	return FinishTest( "virtualdisplay_test" );
+}
@@ -0,0 +1,145 @@
+//========= Copyright Valve Corporation ============//
+// Feeds CWatchdogMonitor fake uevents through a socketpair in place of the
+// kernel netlink socket.
+
+#include "watchdogmonitor.h"
+#include "testharness.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// builds "action@devpath\0KEY=VALUE\0..." the way the kernel sends it
+static std::string MakeUevent( const char *pchAction, const char *pchSubsystem, const char *pchProduct )
+{
+	std::string sMessage = std::string( pchAction ) + "@/devices/pci0000:00/usb1/1-2";
+	sMessage.push_back( '\0' );
+	sMessage += std::string( "ACTION=" ) + pchAction;
+	sMessage.push_back( '\0' );
+	sMessage += "DEVPATH=/devices/pci0000:00/usb1/1-2";
+	sMessage.push_back( '\0' );
+	sMessage += std::string( "SUBSYSTEM=" ) + pchSubsystem;
+	sMessage.push_back( '\0' );
+	if ( pchProduct )
+	{
+		sMessage += std::string( "PRODUCT=" ) + pchProduct;
+		sMessage.push_back( '\0' );
+	}
+	return sMessage;
+}
+
+static void TestUeventMatches()
+{
+	CWatchdogMonitor monitor;
+	monitor.AddHotplugMatch( "usb", "28de/2000/" );
+
+	std::string sMatch = MakeUevent( "add", "usb", "28de/2000/100" );
+	CHECK( monitor.UeventMatches( sMatch.data(), sMatch.size() ) );
+
+	std::string sRemove = MakeUevent( "remove", "usb", "28de/2000/100" );
+	CHECK( !monitor.UeventMatches( sRemove.data(), sRemove.size() ) );
+
+	// a mouse and a different device from the same vendor
+	std::string sMouse = MakeUevent( "add", "usb", "46d/c077/7200" );
+	CHECK( !monitor.UeventMatches( sMouse.data(), sMouse.size() ) );
+	std::string sOtherProduct = MakeUevent( "add", "usb", "28de/20000/100" );
+	CHECK( !monitor.UeventMatches( sOtherProduct.data(), sOtherProduct.size() ) );
+
+	std::string sWrongSubsystem = MakeUevent( "add", "hidraw", "28de/2000/100" );
+	CHECK( !monitor.UeventMatches( sWrongSubsystem.data(), sWrongSubsystem.size() ) );
+
+	std::string sNoProduct = MakeUevent( "add", "usb", nullptr );
+	CHECK( !monitor.UeventMatches( sNoProduct.data(), sNoProduct.size() ) );
+
+	// cut off in the middle of the PRODUCT value, with no terminator
+	CHECK( !monitor.UeventMatches( sMatch.data(), sMatch.size() - 8 ) );
+	CHECK( !monitor.UeventMatches( sMatch.data(), 0 ) );
+}
+
+static void TestSocketWake()
+{
+	int rgnFds[ 2 ];
+	CHECK( socketpair( AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, rgnFds ) == 0 );
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::vector<std::string> vecReasons;
+
+	CWatchdogMonitor monitor;
+	monitor.AddHotplugMatch( "usb", "28de/2000/" );
+	monitor.SetMinWakeInterval( std::chrono::milliseconds( 0 ) );
+	CHECK( monitor.Start( [&]( const char *pchReason )
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		vecReasons.push_back( pchReason );
+		condition.notify_all();
+	}, rgnFds[ 0 ] ) );
+
+	// nothing that doesn't match may wake it. The matching event is sent last so the
+	// wait below also covers everything sent before it.
+	const std::string rgsEvents[] =
+	{
+		MakeUevent( "add", "usb", "46d/c077/7200" ),
+		MakeUevent( "remove", "usb", "28de/2000/100" ),
+		MakeUevent( "add", "input", nullptr ),
+		MakeUevent( "add", "usb", "28de/2000/100" ),
+	};
+	for ( const std::string &sEvent : rgsEvents )
+		CHECK( send( rgnFds[ 1 ], sEvent.data(), sEvent.size(), 0 ) == (ssize_t)sEvent.size() );
+
+	{
+		std::unique_lock<std::mutex> lock( mutex );
+		condition.wait_for( lock, std::chrono::seconds( 5 ), [&] { return !vecReasons.empty(); } );
+		CHECK( vecReasons.size() == 1 );
+		CHECK( !vecReasons.empty() && vecReasons[ 0 ] == "hotplug" );
+	}
+	CHECK( monitor.GetWakeCount() == 1 );
+
+	std::chrono::steady_clock::time_point stopStart = std::chrono::steady_clock::now();
+	monitor.Stop();
+	CHECK( std::chrono::steady_clock::now() - stopStart < std::chrono::seconds( 1 ) );
+
+	close( rgnFds[ 1 ] );
+}
+
+static void TestFallbackInterval()
+{
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::vector<std::string> vecReasons;
+
+	// no hotplug rule and no hidraw node, so there is nothing to wait on but the interval
+	CWatchdogMonitor monitor;
+	monitor.SetMinWakeInterval( std::chrono::milliseconds( 0 ) );
+	monitor.SetFallbackInterval( std::chrono::milliseconds( 10 ) );
+	CHECK( monitor.Start( [&]( const char *pchReason )
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		vecReasons.push_back( pchReason );
+		condition.notify_all();
+	} ) );
+
+	{
+		std::unique_lock<std::mutex> lock( mutex );
+		condition.wait_for( lock, std::chrono::seconds( 5 ), [&] { return vecReasons.size() >= 2; } );
+		CHECK( vecReasons.size() >= 2 );
+		CHECK( !vecReasons.empty() && vecReasons[ 0 ] == "interval" );
+	}
+
+	std::chrono::steady_clock::time_point stopStart = std::chrono::steady_clock::now();
+	monitor.Stop();
+	CHECK( std::chrono::steady_clock::now() - stopStart < std::chrono::seconds( 1 ) );
+}
+
+int main( int argc, char *argv[] )
+{
+	ParseTestArgs( argc, argv );
+
+	TestUeventMatches();
+	TestSocketWake();
+	TestFallbackInterval();
+
+	return FinishTest( "watchdogmonitor_test" );
+}
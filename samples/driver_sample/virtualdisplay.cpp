@@ -0,0 +1,582 @@
+//========= Copyright Valve Corporation ============//
+
+#include "virtualdisplay.h"
+
+#include <string.h>
+#include <math.h>
+
+#if defined( _WIN32 )
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment( lib, "ws2_32.lib" )
+typedef int socklen_t;
+#define CloseSocket closesocket
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#define CloseSocket close
+#endif
+
+static const intptr_t k_nInvalidSocket = -1;
+
+// frames that can be somewhere in the pipeline at once
+static const uint32_t k_unFramesInFlight = 6;
+
+// keep datagrams under a typical MTU
+static const uint32_t k_unMaxDatagram = 1400;
+
+#pragma pack( push, 1 )
+struct VirtualDisplayPacketHeader_t
+{
+	uint64_t nFrameId;
+	uint32_t unPacketIndex;
+	uint32_t unPacketCount;
+	uint32_t unFrameBytes;
+	uint32_t unPayloadBytes;
+};
+#pragma pack( pop )
+
+static const uint32_t k_unMaxPayload = k_unMaxDatagram - sizeof( VirtualDisplayPacketHeader_t );
+
+
+bool CSyntheticDisplayCapture::Capture( const vr::PresentInfo_t &presentInfo, uint32_t unWidth, uint32_t unHeight, uint8_t *pPixels )
+{
+	// vertical bars that scroll one pixel per frame
+	uint32_t unOffset = (uint32_t)( presentInfo.nFrameId % unWidth );
+	for ( uint32_t y = 0; y < unHeight; y++ )
+	{
+		uint8_t *pRow = pPixels + (size_t)y * unWidth * 4;
+		for ( uint32_t x = 0; x < unWidth; x++ )
+		{
+			uint8_t unShade = ( ( ( x + unOffset ) / 32 ) & 1 ) ? 0xff : 0x20;
+			pRow[ x * 4 + 0 ] = unShade;
+			pRow[ x * 4 + 1 ] = (uint8_t)( y * 255 / ( unHeight ? unHeight : 1 ) );
+			pRow[ x * 4 + 2 ] = 0x80;
+			pRow[ x * 4 + 3 ] = 0xff;
+		}
+	}
+	return true;
+}
+
+
+void CRunLengthDisplayCodec::Encode( const uint8_t *pPixels, uint32_t unWidth, uint32_t unHeight, std::vector<uint8_t> *pEncoded )
+{
+	// each run is one count byte (length - 1) followed by the RGBA pixel
+	pEncoded->clear();
+	size_t unPixels = (size_t)unWidth * unHeight;
+	size_t i = 0;
+	while ( i < unPixels )
+	{
+		uint32_t unPixel;
+		memcpy( &unPixel, pPixels + i * 4, 4 );
+
+		size_t unRun = 1;
+		while ( i + unRun < unPixels && unRun < 256 && !memcmp( pPixels + ( i + unRun ) * 4, &unPixel, 4 ) )
+			unRun++;
+
+		size_t unOut = pEncoded->size();
+		pEncoded->resize( unOut + 5 );
+		( *pEncoded )[ unOut ] = (uint8_t)( unRun - 1 );
+		memcpy( &( *pEncoded )[ unOut + 1 ], &unPixel, 4 );
+		i += unRun;
+	}
+}
+
+
+bool CRunLengthDisplayCodec::Decode( const uint8_t *pEncoded, size_t unSize, uint32_t unWidth, uint32_t unHeight, std::vector<uint8_t> *pPixels )
+{
+	size_t unPixels = (size_t)unWidth * unHeight;
+	pPixels->resize( unPixels * 4 );
+
+	size_t unOut = 0;
+	for ( size_t i = 0; i + 5 <= unSize; i += 5 )
+	{
+		size_t unRun = (size_t)pEncoded[ i ] + 1;
+		if ( unOut + unRun > unPixels )
+			return false;
+		for ( size_t r = 0; r < unRun; r++ )
+			memcpy( &( *pPixels )[ ( unOut + r ) * 4 ], &pEncoded[ i + 1 ], 4 );
+		unOut += unRun;
+	}
+	return unOut == unPixels;
+}
+
+
+size_t CRunLengthDisplayCodec::GetMaxEncodedSize( uint32_t unWidth, uint32_t unHeight )
+{
+	// no runs at all: one count byte per RGBA pixel
+	return (size_t)unWidth * unHeight * 5;
+}
+
+
+void CVirtualDisplaySample::CStageQueue::Push( Frame_t *pFrame )
+{
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		m_queue.push_back( pFrame );
+	}
+	m_condition.notify_one();
+}
+
+
+bool CVirtualDisplaySample::CStageQueue::Pop( Frame_t **ppFrame )
+{
+	std::unique_lock<std::mutex> lock( m_mutex );
+	m_condition.wait( lock, [this] { return m_bClosed || !m_queue.empty(); } );
+	if ( m_queue.empty() )
+		return false;
+	*ppFrame = m_queue.front();
+	m_queue.pop_front();
+	return true;
+}
+
+
+bool CVirtualDisplaySample::CStageQueue::TryPop( Frame_t **ppFrame )
+{
+	std::lock_guard<std::mutex> lock( m_mutex );
+	if ( m_queue.empty() )
+		return false;
+	*ppFrame = m_queue.front();
+	m_queue.pop_front();
+	return true;
+}
+
+
+void CVirtualDisplaySample::CStageQueue::Close()
+{
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		m_bClosed = true;
+	}
+	m_condition.notify_all();
+}
+
+
+void CVirtualDisplaySample::CStageQueue::Reset()
+{
+	std::lock_guard<std::mutex> lock( m_mutex );
+	m_queue.clear();
+	m_bClosed = false;
+}
+
+
+CVirtualDisplaySample::CVirtualDisplaySample( IVirtualDisplayCapture *pCapture, IVirtualDisplayCodec *pCodec )
+	: m_pCapture( pCapture ? pCapture : &m_defaultCapture )
+	, m_pCodec( pCodec ? pCodec : &m_defaultCodec )
+	, m_flFramePeriod( 1.0 / 90.0 )
+	, m_pCaptureThread( nullptr )
+	, m_pEncodeThread( nullptr )
+	, m_pSendThread( nullptr )
+	, m_pReceiveThread( nullptr )
+	, m_bExiting( false )
+	, m_nSendSocket( k_nInvalidSocket )
+	, m_nReceiveSocket( k_nInvalidSocket )
+	, m_usReceivePort( 0 )
+	, m_nLastPresentedFrameId( 0 )
+	, m_nLastSentFrameId( 0 )
+	, m_bPresentPending( false )
+{
+	memset( &m_config, 0, sizeof( m_config ) );
+	memset( m_rgLatency, 0, sizeof( m_rgLatency ) );
+	memset( &m_stats, 0, sizeof( m_stats ) );
+}
+
+
+CVirtualDisplaySample::~CVirtualDisplaySample()
+{
+	Stop();
+}
+
+
+double CVirtualDisplaySample::Now() const
+{
+	return std::chrono::duration<double>( std::chrono::steady_clock::now() - m_startTime ).count();
+}
+
+
+bool CVirtualDisplaySample::Start( const Config_t &config )
+{
+	if ( m_pCaptureThread || config.unWidth == 0 || config.unHeight == 0 )
+		return false;
+
+#if defined( _WIN32 )
+	WSADATA wsaData;
+	if ( WSAStartup( MAKEWORD( 2, 2 ), &wsaData ) != 0 )
+		return false;
+#endif
+
+	m_config = config;
+	m_flFramePeriod = config.flDisplayFrequency > 0.f ? 1.0 / config.flDisplayFrequency : 1.0 / 90.0;
+	m_startTime = std::chrono::steady_clock::now();
+
+	// receiver first so we know where to send
+	m_nReceiveSocket = (intptr_t)socket( AF_INET, SOCK_DGRAM, IPPROTO_UDP );
+	m_nSendSocket = (intptr_t)socket( AF_INET, SOCK_DGRAM, IPPROTO_UDP );
+	if ( m_nReceiveSocket == k_nInvalidSocket || m_nSendSocket == k_nInvalidSocket )
+	{
+		Stop();
+		return false;
+	}
+
+	sockaddr_in addr;
+	memset( &addr, 0, sizeof( addr ) );
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+	addr.sin_port = htons( config.usPort );
+	socklen_t nAddrLen = sizeof( addr );
+	if ( bind( m_nReceiveSocket, (sockaddr *)&addr, sizeof( addr ) ) != 0 || getsockname( m_nReceiveSocket, (sockaddr *)&addr, &nAddrLen ) != 0 )
+	{
+		Stop();
+		return false;
+	}
+	m_usReceivePort = ntohs( addr.sin_port );
+
+	// a whole frame can be in the socket buffer at once; the short timeout lets the receiver notice Stop
+	int nBufferSize = 8 * 1024 * 1024;
+	setsockopt( m_nReceiveSocket, SOL_SOCKET, SO_RCVBUF, (const char *)&nBufferSize, sizeof( nBufferSize ) );
+#if defined( _WIN32 )
+	DWORD unTimeoutMs = 100;
+	setsockopt( m_nReceiveSocket, SOL_SOCKET, SO_RCVTIMEO, (const char *)&unTimeoutMs, sizeof( unTimeoutMs ) );
+#else
+	timeval timeout = { 0, 100 * 1000 };
+	setsockopt( m_nReceiveSocket, SOL_SOCKET, SO_RCVTIMEO, (const char *)&timeout, sizeof( timeout ) );
+#endif
+
+	size_t unFrameBytes = (size_t)config.unWidth * config.unHeight * 4;
+	m_vecFrames.clear();
+	m_vecFrames.resize( k_unFramesInFlight );
+	m_freeFrames.Reset();
+	m_captureQueue.Reset();
+	m_encodeQueue.Reset();
+	m_sendQueue.Reset();
+	for ( Frame_t &frame : m_vecFrames )
+	{
+		frame.vecPixels.resize( unFrameBytes );
+		frame.vecEncoded.reserve( unFrameBytes / 4 );
+		m_freeFrames.Push( &frame );
+	}
+
+	m_bExiting = false;
+	m_bPresentPending = false;
+	m_pReceiveThread = new std::thread( &CVirtualDisplaySample::ReceiveThread, this );
+	m_pSendThread = new std::thread( &CVirtualDisplaySample::SendThread, this );
+	m_pEncodeThread = new std::thread( &CVirtualDisplaySample::EncodeThread, this );
+	m_pCaptureThread = new std::thread( &CVirtualDisplaySample::CaptureThread, this );
+	return true;
+}
+
+
+void CVirtualDisplaySample::Stop()
+{
+	m_bExiting = true;
+	m_captureQueue.Close();
+	m_encodeQueue.Close();
+	m_sendQueue.Close();
+	m_presentCondition.notify_all();
+
+	std::thread **rgThreads[] = { &m_pCaptureThread, &m_pEncodeThread, &m_pSendThread, &m_pReceiveThread };
+	for ( std::thread **ppThread : rgThreads )
+	{
+		if ( *ppThread )
+		{
+			( *ppThread )->join();
+			delete *ppThread;
+			*ppThread = nullptr;
+		}
+	}
+
+	bool bHadSockets = m_nSendSocket != k_nInvalidSocket || m_nReceiveSocket != k_nInvalidSocket;
+	if ( m_nSendSocket != k_nInvalidSocket )
+		CloseSocket( m_nSendSocket );
+	if ( m_nReceiveSocket != k_nInvalidSocket )
+		CloseSocket( m_nReceiveSocket );
+	m_nSendSocket = m_nReceiveSocket = k_nInvalidSocket;
+
+#if defined( _WIN32 )
+	if ( bHadSockets )
+		WSACleanup();
+#else
+	(void)bHadSockets;
+#endif
+}
+
+
+VirtualDisplayFrameLatency_t *CVirtualDisplaySample::LatencyEntry( uint64_t nFrameId )
+{
+	VirtualDisplayFrameLatency_t *pEntry = &m_rgLatency[ nFrameId % k_unLatencyHistory ];
+	return pEntry->nFrameId == nFrameId ? pEntry : nullptr;
+}
+
+
+void CVirtualDisplaySample::ReleaseFrame( Frame_t *pFrame )
+{
+	m_freeFrames.Push( pFrame );
+}
+
+
+void CVirtualDisplaySample::Present( const vr::PresentInfo_t *pPresentInfo, uint32_t unPresentInfoSize )
+{
+	if ( !pPresentInfo || unPresentInfoSize < sizeof( vr::PresentInfo_t ) || !m_pCaptureThread )
+		return;
+
+	double flNow = Now();
+	Frame_t *pFrame;
+	bool bHaveFrame = m_freeFrames.TryPop( &pFrame );
+
+	{
+		std::lock_guard<std::mutex> lock( m_statsMutex );
+		m_stats.ulFramesPresented++;
+		if ( !bHaveFrame )
+		{
+			// every stage is busy; dropping beats stalling the compositor
+			m_stats.ulFramesDropped++;
+			return;
+		}
+
+		VirtualDisplayFrameLatency_t *pEntry = &m_rgLatency[ pPresentInfo->nFrameId % k_unLatencyHistory ];
+		memset( pEntry, 0, sizeof( *pEntry ) );
+		pEntry->nFrameId = pPresentInfo->nFrameId;
+		pEntry->flPresent = flNow;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( m_presentMutex );
+		m_nLastPresentedFrameId = pPresentInfo->nFrameId;
+		m_bPresentPending = true;
+	}
+
+	pFrame->presentInfo = *pPresentInfo;
+	m_captureQueue.Push( pFrame );
+}
+
+
+void CVirtualDisplaySample::WaitForPresent()
+{
+	// don't hold the compositor for more than a couple of frames if the pipeline is backed up
+	std::chrono::duration<double> timeout( 2.0 * m_flFramePeriod );
+
+	std::unique_lock<std::mutex> lock( m_presentMutex );
+	m_presentCondition.wait_for( lock, timeout, [this]
+	{
+		return m_bExiting || !m_bPresentPending || m_nLastSentFrameId >= m_nLastPresentedFrameId;
+	} );
+}
+
+
+bool CVirtualDisplaySample::GetTimeSinceLastVsync( float *pfSecondsSinceLastVsync, uint64_t *pulFrameCounter )
+{
+	if ( !m_pCaptureThread )
+		return false;
+
+	// simulated display: vsync ticks at the configured frequency from Start
+	double flElapsed = Now();
+	double flFrames = floor( flElapsed / m_flFramePeriod );
+	if ( pfSecondsSinceLastVsync )
+		*pfSecondsSinceLastVsync = (float)( flElapsed - flFrames * m_flFramePeriod );
+	if ( pulFrameCounter )
+		*pulFrameCounter = (uint64_t)flFrames;
+	return true;
+}
+
+
+bool CVirtualDisplaySample::GetFrameLatency( uint64_t nFrameId, VirtualDisplayFrameLatency_t *pLatency )
+{
+	std::lock_guard<std::mutex> lock( m_statsMutex );
+	VirtualDisplayFrameLatency_t *pEntry = LatencyEntry( nFrameId );
+	if ( !pEntry )
+		return false;
+	*pLatency = *pEntry;
+	return true;
+}
+
+
+VirtualDisplayStats_t CVirtualDisplaySample::GetStats()
+{
+	std::lock_guard<std::mutex> lock( m_statsMutex );
+	return m_stats;
+}
+
+
+void CVirtualDisplaySample::CaptureThread()
+{
+	Frame_t *pFrame;
+	while ( m_captureQueue.Pop( &pFrame ) )
+	{
+		m_pCapture->Capture( pFrame->presentInfo, m_config.unWidth, m_config.unHeight, pFrame->vecPixels.data() );
+
+		{
+			std::lock_guard<std::mutex> lock( m_statsMutex );
+			if ( VirtualDisplayFrameLatency_t *pEntry = LatencyEntry( pFrame->presentInfo.nFrameId ) )
+				pEntry->flCaptured = Now();
+		}
+
+		m_encodeQueue.Push( pFrame );
+	}
+}
+
+
+void CVirtualDisplaySample::EncodeThread()
+{
+	Frame_t *pFrame;
+	while ( m_encodeQueue.Pop( &pFrame ) )
+	{
+		m_pCodec->Encode( pFrame->vecPixels.data(), m_config.unWidth, m_config.unHeight, &pFrame->vecEncoded );
+
+		{
+			std::lock_guard<std::mutex> lock( m_statsMutex );
+			if ( VirtualDisplayFrameLatency_t *pEntry = LatencyEntry( pFrame->presentInfo.nFrameId ) )
+			{
+				pEntry->flEncoded = Now();
+				pEntry->unEncodedBytes = (uint32_t)pFrame->vecEncoded.size();
+			}
+		}
+
+		m_sendQueue.Push( pFrame );
+	}
+}
+
+
+void CVirtualDisplaySample::SendThread()
+{
+	sockaddr_in addr;
+	memset( &addr, 0, sizeof( addr ) );
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+	addr.sin_port = htons( m_usReceivePort );
+
+	uint8_t rgDatagram[ k_unMaxDatagram ];
+	Frame_t *pFrame;
+	while ( m_sendQueue.Pop( &pFrame ) )
+	{
+		uint32_t unFrameBytes = (uint32_t)pFrame->vecEncoded.size();
+		uint32_t unPackets = unFrameBytes == 0 ? 1 : ( unFrameBytes + k_unMaxPayload - 1 ) / k_unMaxPayload;
+		uint64_t ulBytesSent = 0;
+
+		for ( uint32_t i = 0; i < unPackets; i++ )
+		{
+			VirtualDisplayPacketHeader_t header;
+			header.nFrameId = pFrame->presentInfo.nFrameId;
+			header.unPacketIndex = i;
+			header.unPacketCount = unPackets;
+			header.unFrameBytes = unFrameBytes;
+			header.unPayloadBytes = unFrameBytes - i * k_unMaxPayload < k_unMaxPayload ? unFrameBytes - i * k_unMaxPayload : k_unMaxPayload;
+
+			memcpy( rgDatagram, &header, sizeof( header ) );
+			if ( header.unPayloadBytes )
+				memcpy( rgDatagram + sizeof( header ), pFrame->vecEncoded.data() + (size_t)i * k_unMaxPayload, header.unPayloadBytes );
+
+			int nSent = (int)sendto( m_nSendSocket, (const char *)rgDatagram, (int)( sizeof( header ) + header.unPayloadBytes ), 0, (sockaddr *)&addr, sizeof( addr ) );
+			if ( nSent > 0 )
+				ulBytesSent += (uint64_t)nSent;
+		}
+
+		uint64_t nFrameId = pFrame->presentInfo.nFrameId;
+		{
+			std::lock_guard<std::mutex> lock( m_statsMutex );
+			m_stats.ulFramesSent++;
+			m_stats.ulBytesSent += ulBytesSent;
+			if ( VirtualDisplayFrameLatency_t *pEntry = LatencyEntry( nFrameId ) )
+			{
+				pEntry->flSent = Now();
+				pEntry->unPackets = unPackets;
+			}
+		}
+
+		ReleaseFrame( pFrame );
+
+		{
+			std::lock_guard<std::mutex> lock( m_presentMutex );
+			m_nLastSentFrameId = nFrameId;
+			if ( nFrameId == m_nLastPresentedFrameId )
+				m_bPresentPending = false;
+		}
+		m_presentCondition.notify_all();
+	}
+}
+
+
+void CVirtualDisplaySample::ReceiveThread()
+{
+	std::vector<uint8_t> vecDatagram( k_unMaxDatagram );
+	std::vector<uint8_t> vecEncoded;
+	std::vector<uint8_t> vecPixels;
+	std::vector<uint64_t> vecReceivedMask;	// one bit per packet of the current frame
+	uint64_t nCurrentFrameId = 0;
+	uint32_t unFrameBytes = 0;
+	uint32_t unReceivedPackets = 0;
+	uint32_t unExpectedPackets = 0;
+
+	// anything bigger than the codec can produce is not one of our frames
+	size_t unMaxEncoded = m_pCodec->GetMaxEncodedSize( m_config.unWidth, m_config.unHeight );
+	uint32_t unMaxFrameBytes = unMaxEncoded < UINT32_MAX ? (uint32_t)unMaxEncoded : UINT32_MAX;
+
+	while ( !m_bExiting )
+	{
+		int nReceived = (int)recv( m_nReceiveSocket, (char *)vecDatagram.data(), (int)vecDatagram.size(), 0 );
+		if ( nReceived < (int)sizeof( VirtualDisplayPacketHeader_t ) )
+			continue;
+
+		VirtualDisplayPacketHeader_t header;
+		memcpy( &header, vecDatagram.data(), sizeof( header ) );
+		if ( sizeof( header ) + header.unPayloadBytes > (uint32_t)nReceived
+			|| header.unFrameBytes > unMaxFrameBytes )
+			continue;
+
+		// the packet count is implied by the frame size, so a header that disagrees is malformed
+		uint32_t unPacketCount = header.unFrameBytes == 0 ? 1 : ( header.unFrameBytes + k_unMaxPayload - 1 ) / k_unMaxPayload;
+		if ( header.unPacketCount != unPacketCount
+			|| header.unPacketIndex >= unPacketCount
+			|| (uint64_t)header.unPacketIndex * k_unMaxPayload + header.unPayloadBytes > header.unFrameBytes )
+			continue;
+
+		if ( header.nFrameId != nCurrentFrameId || unExpectedPackets == 0 )
+		{
+			if ( unExpectedPackets != 0 && unReceivedPackets < unExpectedPackets )
+			{
+				std::lock_guard<std::mutex> lock( m_statsMutex );
+				m_stats.ulFramesIncomplete++;
+			}
+			nCurrentFrameId = header.nFrameId;
+			unFrameBytes = header.unFrameBytes;
+			unReceivedPackets = 0;
+			unExpectedPackets = unPacketCount;
+			vecEncoded.resize( unFrameBytes );
+			vecReceivedMask.assign( ( unPacketCount + 63 ) / 64, 0 );
+		}
+		else if ( header.unFrameBytes != unFrameBytes )
+		{
+			// same frame id but a different shape than the packet that started it
+			continue;
+		}
+
+		uint64_t &ulMaskWord = vecReceivedMask[ header.unPacketIndex / 64 ];
+		uint64_t ulBit = 1ull << ( header.unPacketIndex % 64 );
+		if ( ulMaskWord & ulBit )
+			continue;
+		ulMaskWord |= ulBit;
+
+		if ( header.unPayloadBytes )
+			memcpy( vecEncoded.data() + (size_t)header.unPacketIndex * k_unMaxPayload, vecDatagram.data() + sizeof( header ), header.unPayloadBytes );
+
+		if ( ++unReceivedPackets < unExpectedPackets )
+			continue;
+
+		bool bDecoded = m_pCodec->Decode( vecEncoded.data(), vecEncoded.size(), m_config.unWidth, m_config.unHeight, &vecPixels );
+		unExpectedPackets = 0;
+
+		std::lock_guard<std::mutex> lock( m_statsMutex );
+		if ( bDecoded )
+		{
+			m_stats.ulFramesReceived++;
+			if ( VirtualDisplayFrameLatency_t *pEntry = LatencyEntry( nCurrentFrameId ) )
+				pEntry->flReceived = Now();
+		}
+		else
+		{
+			m_stats.ulFramesIncomplete++;
+		}
+	}
+}
@@ -0,0 +1,195 @@
+//========= Copyright Valve Corporation ============//
+
+#ifndef VIRTUALDISPLAY_H
+#define VIRTUALDISPLAY_H
+
+#pragma once
+
+#include <openvr_driver.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// Purpose: Reads the presented backbuffer into CPU memory. A real wireless
+//			driver copies the shared texture with its graphics API here.
+//-----------------------------------------------------------------------------
+class IVirtualDisplayCapture
+{
+public:
+	virtual ~IVirtualDisplayCapture() {}
+
+	/** fill pPixels (unWidth * unHeight RGBA8) with the contents of the presented frame */
+	virtual bool Capture( const vr::PresentInfo_t &presentInfo, uint32_t unWidth, uint32_t unHeight, uint8_t *pPixels ) = 0;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: CPU codec used between the encode stage and the receiver
+//-----------------------------------------------------------------------------
+class IVirtualDisplayCodec
+{
+public:
+	virtual ~IVirtualDisplayCodec() {}
+
+	virtual void Encode( const uint8_t *pPixels, uint32_t unWidth, uint32_t unHeight, std::vector<uint8_t> *pEncoded ) = 0;
+	virtual bool Decode( const uint8_t *pEncoded, size_t unSize, uint32_t unWidth, uint32_t unHeight, std::vector<uint8_t> *pPixels ) = 0;
+
+	/** upper bound on what Encode can produce for a frame of this size. The receiver rejects larger frames. */
+	virtual size_t GetMaxEncodedSize( uint32_t unWidth, uint32_t unHeight ) = 0;
+};
+
+/** Fills frames with moving bars. Used when no capture is supplied. */
+class CSyntheticDisplayCapture : public IVirtualDisplayCapture
+{
+public:
+	virtual bool Capture( const vr::PresentInfo_t &presentInfo, uint32_t unWidth, uint32_t unHeight, uint8_t *pPixels );
+};
+
+/** Run-length encodes RGBA pixels. Used when no codec is supplied. */
+class CRunLengthDisplayCodec : public IVirtualDisplayCodec
+{
+public:
+	virtual void Encode( const uint8_t *pPixels, uint32_t unWidth, uint32_t unHeight, std::vector<uint8_t> *pEncoded );
+	virtual bool Decode( const uint8_t *pEncoded, size_t unSize, uint32_t unWidth, uint32_t unHeight, std::vector<uint8_t> *pPixels );
+	virtual size_t GetMaxEncodedSize( uint32_t unWidth, uint32_t unHeight );
+};
+
+
+/** Per-frame timestamps, in seconds since the display was started */
+struct VirtualDisplayFrameLatency_t
+{
+	uint64_t nFrameId;
+	double flPresent;
+	double flCaptured;
+	double flEncoded;
+	double flSent;
+	double flReceived;		// last packet arrived and the frame decoded at the receiver
+	uint32_t unEncodedBytes;
+	uint32_t unPackets;
+};
+
+struct VirtualDisplayStats_t
+{
+	uint64_t ulFramesPresented;
+	uint64_t ulFramesDropped;	// no free frame buffer when Present was called
+	uint64_t ulFramesSent;
+	uint64_t ulFramesReceived;
+	uint64_t ulFramesIncomplete;	// receiver moved on before every packet arrived
+	uint64_t ulBytesSent;
+};
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Reference IVRVirtualDisplay. Presented frames flow through a
+//			capture -> encode -> packetize/send pipeline, one thread per stage,
+//			with two frames in flight between stages. The packets go over a
+//			loopback UDP socket to a receiver thread that reassembles and decodes
+//			them the way the headset would.
+//-----------------------------------------------------------------------------
+class CVirtualDisplaySample : public vr::IVRVirtualDisplay
+{
+public:
+	struct Config_t
+	{
+		uint32_t unWidth;
+		uint32_t unHeight;
+		float flDisplayFrequency;
+		uint16_t usPort;			// 0 picks any free port
+	};
+
+	/** pCapture and pCodec may be null to use the synthetic capture and RLE codec; otherwise they must outlive the display */
+	CVirtualDisplaySample( IVirtualDisplayCapture *pCapture = nullptr, IVirtualDisplayCodec *pCodec = nullptr );
+	virtual ~CVirtualDisplaySample();
+
+	bool Start( const Config_t &config );
+	void Stop();
+
+	// IVRVirtualDisplay
+	virtual void Present( const vr::PresentInfo_t *pPresentInfo, uint32_t unPresentInfoSize );
+	virtual void WaitForPresent();
+	virtual bool GetTimeSinceLastVsync( float *pfSecondsSinceLastVsync, uint64_t *pulFrameCounter );
+
+	/** latency for one of the last k_unLatencyHistory frames */
+	bool GetFrameLatency( uint64_t nFrameId, VirtualDisplayFrameLatency_t *pLatency );
+	VirtualDisplayStats_t GetStats();
+
+	static const uint32_t k_unLatencyHistory = 256;
+
+private:
+	struct Frame_t
+	{
+		vr::PresentInfo_t presentInfo;
+		std::vector<uint8_t> vecPixels;
+		std::vector<uint8_t> vecEncoded;
+	};
+
+	// bounded FIFO handing frames from one stage to the next
+	class CStageQueue
+	{
+	public:
+		CStageQueue() : m_bClosed( false ) {}
+		void Push( Frame_t *pFrame );
+		bool Pop( Frame_t **ppFrame );
+		bool TryPop( Frame_t **ppFrame );
+		void Close();
+		void Reset();
+	private:
+		std::mutex m_mutex;
+		std::condition_variable m_condition;
+		std::deque<Frame_t *> m_queue;
+		bool m_bClosed;
+	};
+
+	double Now() const;
+	VirtualDisplayFrameLatency_t *LatencyEntry( uint64_t nFrameId );
+	void ReleaseFrame( Frame_t *pFrame );
+
+	void CaptureThread();
+	void EncodeThread();
+	void SendThread();
+	void ReceiveThread();
+
+	IVirtualDisplayCapture *m_pCapture;
+	IVirtualDisplayCodec *m_pCodec;
+	CSyntheticDisplayCapture m_defaultCapture;
+	CRunLengthDisplayCodec m_defaultCodec;
+
+	Config_t m_config;
+	std::chrono::steady_clock::time_point m_startTime;
+	double m_flFramePeriod;
+
+	std::vector<Frame_t> m_vecFrames;
+	CStageQueue m_freeFrames;
+	CStageQueue m_captureQueue;
+	CStageQueue m_encodeQueue;
+	CStageQueue m_sendQueue;
+
+	std::thread *m_pCaptureThread;
+	std::thread *m_pEncodeThread;
+	std::thread *m_pSendThread;
+	std::thread *m_pReceiveThread;
+	std::atomic<bool> m_bExiting;
+
+	intptr_t m_nSendSocket;
+	intptr_t m_nReceiveSocket;
+	uint16_t m_usReceivePort;
+
+	// WaitForPresent blocks until the last presented frame has left the send stage
+	std::mutex m_presentMutex;
+	std::condition_variable m_presentCondition;
+	uint64_t m_nLastPresentedFrameId;
+	uint64_t m_nLastSentFrameId;
+	bool m_bPresentPending;
+
+	std::mutex m_statsMutex;
+	VirtualDisplayFrameLatency_t m_rgLatency[ k_unLatencyHistory ];
+	VirtualDisplayStats_t m_stats;
+};
+
+
+#endif // VIRTUALDISPLAY_H
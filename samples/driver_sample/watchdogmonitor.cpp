@@ -0,0 +1,351 @@
+//========= Copyright Valve Corporation ============//
+
+#include "watchdogmonitor.h"
+
+#include <string.h>
+
+#if defined( __linux__ )
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#endif
+
+// the kernel never sends uevents larger than this
+static const size_t k_unMaxUeventSize = 8192;
+
+
+CWatchdogMonitor::CWatchdogMonitor()
+	: m_pThread( nullptr )
+	, m_minWakeInterval( 1000 )
+	, m_fallbackInterval( 5000 )
+	, m_bHaveWoken( false )
+	, m_ulWakeCount( 0 )
+{
+#if defined( __linux__ )
+	m_nEpollFd = -1;
+	m_nShutdownFd = -1;
+	m_nUeventFd = -1;
+#else
+	m_bExiting = false;
+#endif
+}
+
+
+CWatchdogMonitor::~CWatchdogMonitor()
+{
+	Stop();
+}
+
+
+void CWatchdogMonitor::AddHotplugMatch( const char *pchSubsystem, const char *pchProductPrefix )
+{
+	HotplugMatch_t match;
+	match.m_sSubsystem = pchSubsystem ? pchSubsystem : "";
+	match.m_sProductPrefix = pchProductPrefix ? pchProductPrefix : "";
+	m_vecHotplugMatches.push_back( match );
+}
+
+
+void CWatchdogMonitor::AddHidrawDevice( const char *pchDevNode )
+{
+	m_vecHidrawPaths.push_back( pchDevNode );
+}
+
+
+bool CWatchdogMonitor::UeventMatches( const char *pchMessage, size_t unLength ) const
+{
+	std::string sAction;
+	std::string sSubsystem;
+	std::string sProduct;
+	bool bHaveProduct = false;
+
+	// The first string is the "action@devpath" header; the rest are KEY=VALUE pairs.
+	// udevd rebroadcasts with a binary "libudev" header that we skip the same way.
+	// The last string may be missing its terminator, so nothing is read past pchEnd.
+	const char *pchEnd = pchMessage + unLength;
+	for ( const char *pch = pchMessage; pch < pchEnd; )
+	{
+		size_t unLen = strnlen( pch, pchEnd - pch );
+		if ( unLen >= 7 && !strncmp( pch, "ACTION=", 7 ) )
+			sAction.assign( pch + 7, unLen - 7 );
+		else if ( unLen >= 10 && !strncmp( pch, "SUBSYSTEM=", 10 ) )
+			sSubsystem.assign( pch + 10, unLen - 10 );
+		else if ( unLen >= 8 && !strncmp( pch, "PRODUCT=", 8 ) )
+		{
+			sProduct.assign( pch + 8, unLen - 8 );
+			bHaveProduct = true;
+		}
+		pch += unLen + 1;
+	}
+
+	if ( sAction != "add" || sSubsystem.empty() )
+		return false;
+
+	for ( const HotplugMatch_t &match : m_vecHotplugMatches )
+	{
+		if ( match.m_sSubsystem != sSubsystem )
+			continue;
+		if ( match.m_sProductPrefix.empty() )
+			return true;
+		if ( bHaveProduct && sProduct.compare( 0, match.m_sProductPrefix.size(), match.m_sProductPrefix ) == 0 )
+			return true;
+	}
+	return false;
+}
+
+
+void CWatchdogMonitor::Wake( const char *pchReason )
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if ( m_bHaveWoken && now - m_lastWake < m_minWakeInterval )
+		return;
+
+	m_bHaveWoken = true;
+	m_lastWake = now;
+	m_ulWakeCount++;
+	if ( m_fnWake )
+		m_fnWake( pchReason );
+}
+
+
+#if defined( __linux__ )
+
+bool CWatchdogMonitor::AddEpollFd( int nFd )
+{
+	struct epoll_event event;
+	memset( &event, 0, sizeof( event ) );
+	event.events = EPOLLIN;
+	event.data.fd = nFd;
+	return epoll_ctl( m_nEpollFd, EPOLL_CTL_ADD, nFd, &event ) == 0;
+}
+
+
+void CWatchdogMonitor::OpenHidrawDevices()
+{
+	for ( const std::string &sPath : m_vecHidrawPaths )
+	{
+		int nFd = open( sPath.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC );
+		if ( nFd < 0 )
+			continue;
+		if ( !AddEpollFd( nFd ) )
+		{
+			close( nFd );
+			continue;
+		}
+		m_vecHidrawFds.push_back( nFd );
+	}
+}
+
+
+bool CWatchdogMonitor::Start( WakeCallback_t fnWake, int nUeventFd )
+{
+	if ( m_pThread )
+		return false;
+
+	m_fnWake = fnWake;
+	m_bHaveWoken = false;
+
+	m_nEpollFd = epoll_create1( EPOLL_CLOEXEC );
+	m_nShutdownFd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+	if ( m_nEpollFd < 0 || m_nShutdownFd < 0 || !AddEpollFd( m_nShutdownFd ) )
+	{
+		if ( nUeventFd >= 0 )
+			close( nUeventFd );
+		CloseFds();
+		return false;
+	}
+
+	m_nUeventFd = nUeventFd;
+	if ( m_nUeventFd < 0 && !m_vecHotplugMatches.empty() )
+	{
+		m_nUeventFd = socket( AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT );
+		if ( m_nUeventFd >= 0 )
+		{
+			struct sockaddr_nl addr;
+			memset( &addr, 0, sizeof( addr ) );
+			addr.nl_family = AF_NETLINK;
+			addr.nl_groups = 1;	// kernel uevent multicast group
+			if ( bind( m_nUeventFd, (struct sockaddr *)&addr, sizeof( addr ) ) != 0 )
+			{
+				close( m_nUeventFd );
+				m_nUeventFd = -1;
+			}
+		}
+	}
+	if ( m_nUeventFd >= 0 && !AddEpollFd( m_nUeventFd ) )
+	{
+		close( m_nUeventFd );
+		m_nUeventFd = -1;
+	}
+
+	OpenHidrawDevices();
+
+	m_pThread = new std::thread( &CWatchdogMonitor::ThreadFunction, this );
+	return true;
+}
+
+
+void CWatchdogMonitor::Stop()
+{
+	if ( m_pThread )
+	{
+		uint64_t ulOne = 1;
+		ssize_t nWritten = write( m_nShutdownFd, &ulOne, sizeof( ulOne ) );
+		(void)nWritten;
+
+		m_pThread->join();
+		delete m_pThread;
+		m_pThread = nullptr;
+	}
+	CloseFds();
+}
+
+
+void CWatchdogMonitor::CloseFds()
+{
+	for ( int nFd : m_vecHidrawFds )
+		close( nFd );
+	m_vecHidrawFds.clear();
+
+	if ( m_nUeventFd >= 0 )
+		close( m_nUeventFd );
+	if ( m_nShutdownFd >= 0 )
+		close( m_nShutdownFd );
+	if ( m_nEpollFd >= 0 )
+		close( m_nEpollFd );
+	m_nUeventFd = m_nShutdownFd = m_nEpollFd = -1;
+}
+
+
+void CWatchdogMonitor::HandleUevent()
+{
+	char rchMessage[ k_unMaxUeventSize ];
+	for ( ;; )
+	{
+		ssize_t nRead = recv( m_nUeventFd, rchMessage, sizeof( rchMessage ), MSG_DONTWAIT );
+		if ( nRead <= 0 )
+			break;
+		if ( UeventMatches( rchMessage, (size_t)nRead ) )
+			Wake( "hotplug" );
+	}
+}
+
+
+void CWatchdogMonitor::HandleHidraw( int nFd )
+{
+	char rchReport[ 256 ];
+	bool bGotReport = false;
+	for ( ;; )
+	{
+		ssize_t nRead = read( nFd, rchReport, sizeof( rchReport ) );
+		if ( nRead > 0 )
+		{
+			bGotReport = true;
+			continue;
+		}
+
+		if ( nRead < 0 && ( errno == EAGAIN || errno == EINTR ) )
+			break;
+
+		// the device went away
+		epoll_ctl( m_nEpollFd, EPOLL_CTL_DEL, nFd, nullptr );
+		close( nFd );
+		for ( size_t i = 0; i < m_vecHidrawFds.size(); i++ )
+		{
+			if ( m_vecHidrawFds[ i ] == nFd )
+			{
+				m_vecHidrawFds.erase( m_vecHidrawFds.begin() + i );
+				break;
+			}
+		}
+		break;
+	}
+
+	if ( bGotReport )
+		Wake( "hidraw" );
+}
+
+
+void CWatchdogMonitor::ThreadFunction()
+{
+	struct epoll_event rgEvents[ 8 ];
+	for ( ;; )
+	{
+		// with no hotplug socket and no hidraw node left there is nothing to wait on,
+		// so wake on the fallback interval like the other platforms
+		bool bHaveEventSources = m_nUeventFd >= 0 || !m_vecHidrawFds.empty();
+		int nTimeout = bHaveEventSources ? -1 : (int)m_fallbackInterval.count();
+		int nEvents = epoll_wait( m_nEpollFd, rgEvents, 8, nTimeout );
+		if ( nEvents < 0 )
+		{
+			if ( errno == EINTR )
+				continue;
+			return;
+		}
+		if ( nEvents == 0 )
+		{
+			Wake( "interval" );
+			continue;
+		}
+
+		for ( int i = 0; i < nEvents; i++ )
+		{
+			int nFd = rgEvents[ i ].data.fd;
+			if ( nFd == m_nShutdownFd )
+				return;
+			else if ( nFd == m_nUeventFd )
+				HandleUevent();
+			else
+				HandleHidraw( nFd );
+		}
+	}
+}
+
+#else
+
+bool CWatchdogMonitor::Start( WakeCallback_t fnWake, int )
+{
+	if ( m_pThread )
+		return false;
+
+	m_fnWake = fnWake;
+	m_bHaveWoken = false;
+	m_bExiting = false;
+	m_pThread = new std::thread( &CWatchdogMonitor::ThreadFunction, this );
+	return true;
+}
+
+
+void CWatchdogMonitor::Stop()
+{
+	if ( !m_pThread )
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		m_bExiting = true;
+	}
+	m_condition.notify_all();
+
+	m_pThread->join();
+	delete m_pThread;
+	m_pThread = nullptr;
+}
+
+
+void CWatchdogMonitor::ThreadFunction()
+{
+	std::unique_lock<std::mutex> lock( m_mutex );
+	while ( !m_condition.wait_for( lock, m_fallbackInterval, [this] { return m_bExiting; } ) )
+	{
+		lock.unlock();
+		Wake( "interval" );
+		lock.lock();
+	}
+}
+
+#endif
@@ -0,0 +1,100 @@
+//========= Copyright Valve Corporation ============//
+
+#ifndef WATCHDOGMONITOR_H
+#define WATCHDOGMONITOR_H
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// Purpose: Blocks until hardware does something that should start the VR
+//			system, then calls the wake callback.
+//
+//			On Linux this is a single epoll wait over a kernel uevent netlink
+//			socket (USB/HID hotplug), any registered hidraw device nodes and an
+//			eventfd used for shutdown, so the thread uses no CPU while idle and
+//			Stop() returns immediately. Other platforms, and Linux when there is
+//			no hotplug rule and no hidraw node to wait on, fall back to waking
+//			on a fixed interval.
+//-----------------------------------------------------------------------------
+class CWatchdogMonitor
+{
+public:
+	typedef std::function< void( const char *pchReason ) > WakeCallback_t;
+
+	CWatchdogMonitor();
+	~CWatchdogMonitor();
+
+	/** wake when a uevent with this SUBSYSTEM is added. pchProductPrefix, if non-empty, must prefix the PRODUCT key (e.g. "28de/"). */
+	void AddHotplugMatch( const char *pchSubsystem, const char *pchProductPrefix );
+
+	/** wake whenever this hidraw node produces an input report, e.g. "/dev/hidraw3" */
+	void AddHidrawDevice( const char *pchDevNode );
+
+	/** wakes closer together than this are dropped */
+	void SetMinWakeInterval( std::chrono::milliseconds interval ) { m_minWakeInterval = interval; }
+
+	/** used on platforms without event support, and on Linux while there is nothing to wait on */
+	void SetFallbackInterval( std::chrono::milliseconds interval ) { m_fallbackInterval = interval; }
+
+	/** Starts the monitor thread. On Linux, nUeventFd lets the caller supply an already open
+	* datagram socket that delivers uevent messages instead of the kernel netlink socket. The
+	* monitor takes ownership of it. Other platforms ignore it. */
+	bool Start( WakeCallback_t fnWake, int nUeventFd = -1 );
+	void Stop();
+
+	/** Parses one kernel uevent datagram ("action@devpath\0KEY=VALUE\0...") and
+	* returns true if it is an add event that matches a hotplug rule. */
+	bool UeventMatches( const char *pchMessage, size_t unLength ) const;
+
+	uint64_t GetWakeCount() const { return m_ulWakeCount; }
+
+private:
+	struct HotplugMatch_t
+	{
+		std::string m_sSubsystem;
+		std::string m_sProductPrefix;
+	};
+
+	void ThreadFunction();
+	void Wake( const char *pchReason );
+
+#if defined( __linux__ )
+	bool AddEpollFd( int nFd );
+	void OpenHidrawDevices();
+	void HandleUevent();
+	void HandleHidraw( int nFd );
+	void CloseFds();
+
+	int m_nEpollFd;
+	int m_nShutdownFd;
+	int m_nUeventFd;
+	std::vector<int> m_vecHidrawFds;
+#else
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	bool m_bExiting;
+#endif
+
+	std::vector<HotplugMatch_t> m_vecHotplugMatches;
+	std::vector<std::string> m_vecHidrawPaths;
+
+	WakeCallback_t m_fnWake;
+	std::thread *m_pThread;
+	std::chrono::milliseconds m_minWakeInterval;
+	std::chrono::milliseconds m_fallbackInterval;
+	std::chrono::steady_clock::time_point m_lastWake;
+	bool m_bHaveWoken;
+	std::atomic<uint64_t> m_ulWakeCount;
+};
+
+
+#endif // WATCHDOGMONITOR_H
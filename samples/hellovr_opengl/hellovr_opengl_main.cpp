@@ -15,12 +15,17 @@
 #include <stdio.h>
 #include <string>
 #include <cstdlib>
+#include <chrono>
 
 #include <openvr.h>
 
 #include "shared/lodepng.h"
 #include "shared/Matrices.h"
 #include "shared/pathtools.h"
+#include "shared/frametiminganalytics.h"
+#include "shared/resolutiongovernor.h"
+#include "shared/latelatch.h"
+#include "shared/stereopassstats.h"
 
 #if defined(POSIX)
 #include "unistd.h"
@@ -34,6 +39,22 @@
 #define _countof(x) (sizeof(x)/sizeof((x)[0]))
 #endif
 
+// GL_OVR_multiview2 is newer than the bundled GLEW, so its entry point is looked up by hand
+#ifndef GL_OVR_multiview
+typedef void (APIENTRY *PFNGLFRAMEBUFFERTEXTUREMULTIVIEWOVRPROC)( GLenum target, GLenum attachment, GLuint texture, GLint level, GLint baseViewIndex, GLsizei numViews );
+#endif
+static PFNGLFRAMEBUFFERTEXTUREMULTIVIEWOVRPROC g_pglFramebufferTextureMultiviewOVR = NULL;
+
+// Timer queries in flight for -perf, so reading one back never waits on the GPU
+static const uint32_t k_unStereoTimerQueries = 4;
+
+// Instanced draws read their transform from this attribute location and the three after it
+static const GLuint k_unInstanceMatrixLocation = 3;
+
+// Controller transforms are rewritten every frame, so they cycle through as many slots as
+// there can be frames queued in the driver
+static const uint32_t k_unControllerInstanceSlots = 3;
+
 void ThreadSleep( unsigned long nMilliseconds )
 {
 #if defined(_WIN32)
@@ -43,6 +64,80 @@ void ThreadSleep( unsigned long nMilliseconds )
 #endif
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Late latch ring in a persistently mapped uniform buffer. Each eye
+//			of each slot is bound to the LateLatchView uniform block. A fence
+//			after the draws that read a slot keeps BeginFrame from rewriting
+//			it while the GPU may still be using it.
+//-----------------------------------------------------------------------------
+class CGLLateLatchRing : public CLateLatchPoseRing
+{
+public:
+	CGLLateLatchRing();
+	~CGLLateLatchRing();
+
+	bool BInit();
+	void Cleanup();
+
+	/** binds the current slot's matrix for eEye to uniform block binding unBinding */
+	void BindEye( vr::EVREye eEye, GLuint unBinding );
+
+	/** call after the last draw that reads the current slot */
+	void FenceCurrentSlot();
+
+protected:
+	virtual float *GetSlotMatrix( uint32_t unSlot, vr::EVREye eEye );
+	virtual void AcquireSlot( uint32_t unSlot );
+	virtual void FlushSlot( uint32_t unSlot );
+
+private:
+	GLuint m_glBuffer;
+	GLsync m_rgSlotFences[ k_unSlots ];
+	GLsizeiptr m_nEntryStride;
+	uint8_t *m_pMapped;
+	std::vector< uint8_t > m_vecShadow;		// without GL_ARB_buffer_storage slots are uploaded with glBufferSubData
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Per instance transforms in a vertex buffer, persistently mapped when
+//			GL_ARB_buffer_storage is available. The buffer is split into slots
+//			so a frame can fill one while the GPU may still read the others.
+//-----------------------------------------------------------------------------
+class CGLInstanceBuffer
+{
+public:
+	CGLInstanceBuffer();
+	~CGLInstanceBuffer();
+
+	/** room for unCapacity transforms in each of unSlots slots */
+	bool BInit( uint32_t unCapacity, uint32_t unSlots );
+	void Cleanup();
+
+	/** moves to the next slot and empties it */
+	void BeginSlot();
+	/** appends a transform to the current slot, false once the slot is full */
+	bool AddInstance( const Matrix4 &matInstance );
+	/** uploads the current slot when the buffer isn't persistently mapped */
+	void EndSlot();
+
+	/** points the mat4 attribute at unLocation of the bound VAO at the current slot, one column per location */
+	void BindAttributes( GLuint unLocation ) const;
+
+	uint32_t GetInstanceCount() const { return m_unCount; }
+	bool IsPersistentlyMapped() const { return m_pMapped != NULL; }
+
+private:
+	float *GetSlotBase() { return ( m_pMapped ? m_pMapped : &m_vecShadow[ 0 ] ) + m_unSlot * m_unCapacity * 16; }
+
+	GLuint m_glBuffer;
+	uint32_t m_unCapacity;
+	uint32_t m_unSlots;
+	uint32_t m_unSlot;
+	uint32_t m_unCount;
+	float *m_pMapped;
+	std::vector< float > m_vecShadow;		// without GL_ARB_buffer_storage slots are uploaded with glBufferSubData
+};
+
 class CGLRenderModel
 {
 public:
@@ -84,6 +179,7 @@ public:
 	bool HandleInput();
 	void ProcessVREvent( const vr::VREvent_t & event );
 	void RenderFrame();
+	void UpdateRenderResolution();
 
 	bool SetupTexturemaps();
 
@@ -93,11 +189,15 @@ public:
 
 	void RenderControllerAxes();
 
+	bool BInitMultiview();
 	bool SetupStereoRenderTargets();
 	void SetupCompanionWindow();
 	void SetupCameras();
 
 	void RenderStereoTargets();
+	void RenderMultiviewTarget();
+	void BeginStereoPassStats();
+	void EndStereoPassStats();
 	void RenderCompanionWindow();
 	void RenderScene( vr::Hmd_Eye nEye );
 
@@ -113,12 +213,20 @@ public:
 
 	CGLRenderModel *FindOrLoadRenderModel( const char *pchRenderModelName );
 
+	const std::string &GetGovernorSimTrace() const { return m_strGovernorSimTrace; }
+
 private: 
 	bool m_bDebugOpenGL;
 	bool m_bVerbose;
 	bool m_bPerf;
 	bool m_bVblank;
 	bool m_bGlFinishHack;
+	bool m_bAdaptiveResolution;
+	bool m_bLateLatch;
+	bool m_bMultiview;
+
+	std::string m_strGovernorSimTrace;
+	std::string m_strRecordTimingsPath;
 
 	vr::IVRSystem *m_pHMD;
 	std::string m_strDriver;
@@ -188,6 +296,10 @@ private: // OpenGL bookkeeping
 	GLuint m_unControllerVAO;
 	unsigned int m_uiControllerVertcount;
 
+	// the cubes and controller axes each have one mesh, drawn once per transform in these
+	CGLInstanceBuffer m_sceneInstances;
+	CGLInstanceBuffer m_controllerInstances;
+
 	Matrix4 m_mat4HMDPose;
 	Matrix4 m_mat4eyePosLeft;
 	Matrix4 m_mat4eyePosRight;
@@ -218,6 +330,7 @@ private: // OpenGL bookkeeping
 	GLint m_nSceneMatrixLocation;
 	GLint m_nControllerMatrixLocation;
 	GLint m_nRenderModelMatrixLocation;
+	GLint m_nCompanionWindowUVScaleLocation;
 
 	struct FramebufferDesc
 	{
@@ -230,11 +343,40 @@ private: // OpenGL bookkeeping
 	FramebufferDesc leftEyeDesc;
 	FramebufferDesc rightEyeDesc;
 
+	// -multiview renders both eyes into the layers of one array texture, then resolves
+	// each layer into the eye's resolve texture above
+	struct MultiviewFramebufferDesc
+	{
+		GLuint m_nDepthTextureId;
+		GLuint m_nRenderTextureId;
+		GLuint m_nRenderFramebufferId;
+		GLuint m_nViewFramebufferId[ 2 ];	// one layer each, to resolve from
+	};
+	MultiviewFramebufferDesc m_multiviewDesc;
+
 	bool CreateFrameBuffer( int nWidth, int nHeight, FramebufferDesc &framebufferDesc );
+	bool CreateMultiviewFrameBuffer( int nWidth, int nHeight, MultiviewFramebufferDesc &framebufferDesc );
 	
 	uint32_t m_nRenderWidth;
 	uint32_t m_nRenderHeight;
 
+	// the part of the render targets drawn this frame, chosen by the resolution governor
+	uint32_t m_nViewportWidth;
+	uint32_t m_nViewportHeight;
+	CResolutionGovernor m_resolutionGovernor;
+
+	CGLLateLatchRing m_lateLatchRing;
+
+	// -perf: draw calls, GPU and CPU time of RenderStereoTargets
+	CStereoPassStats m_stereoPassStats;
+	uint32_t m_unStereoDrawCalls;
+	uint64_t m_ulStereoPassStartNs;
+	GLuint m_rgunStereoTimerQueries[ k_unStereoTimerQueries ];
+	uint32_t m_unStereoTimerQueriesIssued;
+
+	CFrameTimingAnalytics m_frameTimingAnalytics;
+	CCompositorFrameTimingSource *m_pFrameTimingSource;
+
 	std::vector< CGLRenderModel * > m_vecRenderModels;
 
 	vr::VRActionHandle_t m_actionHideCubes = vr::k_ulInvalidActionHandle;
@@ -333,6 +475,14 @@ void dprintf( const char *fmt, ... )
 	OutputDebugStringA( buffer );
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Monotonic time for the -perf CPU timings
+//-----------------------------------------------------------------------------
+static uint64_t GetTicksNs()
+{
+	return (uint64_t)std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: Constructor
 //-----------------------------------------------------------------------------
@@ -351,6 +501,9 @@ CMainApplication::CMainApplication( int argc, char *argv[] )
 	, m_bPerf( false )
 	, m_bVblank( false )
 	, m_bGlFinishHack( true )
+	, m_bAdaptiveResolution( false )
+	, m_bLateLatch( false )
+	, m_bMultiview( false )
 	, m_glControllerVertBuffer( 0 )
 	, m_unControllerVAO( 0 )
 	, m_unSceneVAO( 0 )
@@ -364,7 +517,14 @@ CMainApplication::CMainApplication( int argc, char *argv[] )
 	, m_iSceneVolumeInit( 20 )
 	, m_strPoseClasses("")
 	, m_bShowCubes( true )
+	, m_nCompanionWindowUVScaleLocation( -1 )
+	, m_unStereoDrawCalls( 0 )
+	, m_ulStereoPassStartNs( 0 )
+	, m_unStereoTimerQueriesIssued( 0 )
+	, m_pFrameTimingSource( NULL )
 {
+	memset( &m_multiviewDesc, 0, sizeof( m_multiviewDesc ) );
+	memset( m_rgunStereoTimerQueries, 0, sizeof( m_rgunStereoTimerQueries ) );
 
 	for( int i = 1; i < argc; i++ )
 	{
@@ -393,6 +553,32 @@ CMainApplication::CMainApplication( int argc, char *argv[] )
 			m_iSceneVolumeInit = atoi( argv[ i + 1 ] );
 			i++;
 		}
+		else if( !stricmp( argv[i], "-adaptiveres" ) )
+		{
+			m_bAdaptiveResolution = true;
+		}
+		else if( !stricmp( argv[i], "-latelatch" ) )
+		{
+			m_bLateLatch = true;
+		}
+		else if( !stricmp( argv[i], "-multiview" ) )
+		{
+			m_bMultiview = true;
+		}
+		else if( !stricmp( argv[i], "-perf" ) )
+		{
+			m_bPerf = true;
+		}
+		else if ( !stricmp( argv[i], "-recordtimings" ) && ( argc > i + 1 ) && ( *argv[ i + 1 ] != '-' ) )
+		{
+			m_strRecordTimingsPath = argv[ i + 1 ];
+			i++;
+		}
+		else if ( !stricmp( argv[i], "-governorsim" ) && ( argc > i + 1 ) && ( *argv[ i + 1 ] != '-' ) )
+		{
+			m_strGovernorSimTrace = argv[ i + 1 ];
+			i++;
+		}
 	}
 	// other initialization tasks are done in BInit
 	memset(m_rDevClassChar, 0, sizeof(m_rDevClassChar));
@@ -581,19 +767,53 @@ bool CMainApplication::BInitGL()
 		glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
 	}
 
+	if ( m_bMultiview && !BInitMultiview() )
+	{
+		dprintf( "GL_OVR_multiview2 is not available, rendering each eye separately\n" );
+		m_bMultiview = false;
+	}
+
 	if( !CreateAllShaders() )
 		return false;
 
 	SetupTexturemaps();
 	SetupScene();
 	SetupCameras();
-	SetupStereoRenderTargets();
+	if ( !SetupStereoRenderTargets() )
+		return false;
 	SetupCompanionWindow();
 
+	if ( !m_lateLatchRing.BInit() )
+		return false;
+
 	return true;
 }
 
 
+//-----------------------------------------------------------------------------
+// Purpose: Returns true if the driver can render both eyes in a single pass
+//          with GL_OVR_multiview2. GLEW predates the extension, so its entry
+//          point is loaded by hand.
+//-----------------------------------------------------------------------------
+bool CMainApplication::BInitMultiview()
+{
+	bool bFound = false;
+	GLint nExtensions = 0;
+	glGetIntegerv( GL_NUM_EXTENSIONS, &nExtensions );
+	for ( GLint i = 0; i < nExtensions && !bFound; i++ )
+	{
+		const char *pchExtension = (const char *)glGetStringi( GL_EXTENSIONS, i );
+		bFound = pchExtension && strcmp( pchExtension, "GL_OVR_multiview2" ) == 0;
+	}
+
+	if ( !bFound )
+		return false;
+
+	g_pglFramebufferTextureMultiviewOVR = (PFNGLFRAMEBUFFERTEXTUREMULTIVIEWOVRPROC)SDL_GL_GetProcAddress( "glFramebufferTextureMultiviewOVR" );
+	return g_pglFramebufferTextureMultiviewOVR != NULL;
+}
+
+
 //-----------------------------------------------------------------------------
 // Purpose: Initialize Compositor. Returns true if the compositor was
 //          successfully initialized, false otherwise.
@@ -608,6 +828,13 @@ bool CMainApplication::BInitCompositor()
 		return false;
 	}
 
+	if ( !m_strRecordTimingsPath.empty() )
+	{
+		m_pFrameTimingSource = new CCompositorFrameTimingSource( vr::VRCompositor() );
+		if ( !m_frameTimingAnalytics.StartRecording( m_strRecordTimingsPath ) )
+			dprintf( "Unable to record frame timings to %s\n", m_strRecordTimingsPath.c_str() );
+	}
+
 	return true;
 }
 
@@ -617,6 +844,13 @@ bool CMainApplication::BInitCompositor()
 //-----------------------------------------------------------------------------
 void CMainApplication::Shutdown()
 {
+	if ( m_pFrameTimingSource )
+	{
+		m_frameTimingAnalytics.StopRecording();
+		delete m_pFrameTimingSource;
+		m_pFrameTimingSource = NULL;
+	}
+
 	if( m_pHMD )
 	{
 		vr::VR_Shutdown();
@@ -637,6 +871,10 @@ void CMainApplication::Shutdown()
 			glDebugMessageCallback(nullptr, nullptr);
 		}
 		glDeleteBuffers(1, &m_glSceneVertBuffer);
+		glDeleteBuffers(1, &m_glControllerVertBuffer);
+		m_sceneInstances.Cleanup();
+		m_controllerInstances.Cleanup();
+		m_lateLatchRing.Cleanup();
 
 		if ( m_unSceneProgramID )
 		{
@@ -667,6 +905,19 @@ void CMainApplication::Shutdown()
 		glDeleteTextures( 1, &rightEyeDesc.m_nResolveTextureId );
 		glDeleteFramebuffers( 1, &rightEyeDesc.m_nResolveFramebufferId );
 
+		if ( m_multiviewDesc.m_nRenderFramebufferId )
+		{
+			glDeleteTextures( 1, &m_multiviewDesc.m_nDepthTextureId );
+			glDeleteTextures( 1, &m_multiviewDesc.m_nRenderTextureId );
+			glDeleteFramebuffers( 1, &m_multiviewDesc.m_nRenderFramebufferId );
+			glDeleteFramebuffers( 2, &m_multiviewDesc.m_nViewFramebufferId[ 0 ] );
+		}
+
+		if ( m_rgunStereoTimerQueries[ 0 ] )
+		{
+			glDeleteQueries( k_unStereoTimerQueries, m_rgunStereoTimerQueries );
+		}
+
 		if( m_unCompanionWindowVAO != 0 )
 		{
 			glDeleteVertexArrays( 1, &m_unCompanionWindowVAO );
@@ -849,14 +1100,40 @@ void CMainApplication::RenderFrame()
 	// for now as fast as possible
 	if ( m_pHMD )
 	{
+		UpdateRenderResolution();
+		m_lateLatchRing.BeginFrame( m_pHMD, m_rTrackedDevicePose[ vr::k_unTrackedDeviceIndex_Hmd ] );
+
 		RenderControllerAxes();
+
+		// GL may start on draws as soon as they are issued, so the pose has to be
+		// refreshed before the eye renders rather than between them and Submit
+		bool bLatched = m_bLateLatch && m_lateLatchRing.Latch();
+
+		BeginStereoPassStats();
 		RenderStereoTargets();
+		EndStereoPassStats();
+		m_lateLatchRing.FenceCurrentSlot();
 		RenderCompanionWindow();
 
+		// only the viewport the governor picked holds this frame
+		vr::VRTextureBounds_t bounds = m_resolutionGovernor.GetTextureBounds( m_nRenderWidth, m_nRenderHeight );
+
 		vr::Texture_t leftEyeTexture = {(void*)(uintptr_t)leftEyeDesc.m_nResolveTextureId, vr::TextureType_OpenGL, vr::ColorSpace_Gamma };
-		vr::VRCompositor()->Submit(vr::Eye_Left, &leftEyeTexture );
 		vr::Texture_t rightEyeTexture = {(void*)(uintptr_t)rightEyeDesc.m_nResolveTextureId, vr::TextureType_OpenGL, vr::ColorSpace_Gamma };
-		vr::VRCompositor()->Submit(vr::Eye_Right, &rightEyeTexture );
+
+		if ( bLatched )
+		{
+			vr::VRTextureWithPose_t leftEyeTextureWithPose, rightEyeTextureWithPose;
+			m_lateLatchRing.FillTextureWithPose( leftEyeTexture, &leftEyeTextureWithPose );
+			m_lateLatchRing.FillTextureWithPose( rightEyeTexture, &rightEyeTextureWithPose );
+			vr::VRCompositor()->Submit(vr::Eye_Left, &leftEyeTextureWithPose, &bounds, vr::Submit_TextureWithPose );
+			vr::VRCompositor()->Submit(vr::Eye_Right, &rightEyeTextureWithPose, &bounds, vr::Submit_TextureWithPose );
+		}
+		else
+		{
+			vr::VRCompositor()->Submit(vr::Eye_Left, &leftEyeTexture, &bounds );
+			vr::VRCompositor()->Submit(vr::Eye_Right, &rightEyeTexture, &bounds );
+		}
 	}
 
 	if ( m_bVblank && m_bGlFinishHack )
@@ -901,6 +1178,87 @@ void CMainApplication::RenderFrame()
 }
 
 
+//-----------------------------------------------------------------------------
+// Purpose: Starts measuring the stereo pass for -perf. The GPU time is read
+//          from a query issued a few frames ago so this never waits on the GPU.
+//-----------------------------------------------------------------------------
+void CMainApplication::BeginStereoPassStats()
+{
+	if ( !m_bPerf )
+		return;
+
+	if ( !m_rgunStereoTimerQueries[ 0 ] )
+		glGenQueries( k_unStereoTimerQueries, m_rgunStereoTimerQueries );
+
+	GLuint unQuery = m_rgunStereoTimerQueries[ m_unStereoTimerQueriesIssued % k_unStereoTimerQueries ];
+	if ( m_unStereoTimerQueriesIssued >= k_unStereoTimerQueries )
+	{
+		GLuint64 ulElapsedNs = 0;
+		glGetQueryObjectui64v( unQuery, GL_QUERY_RESULT, &ulElapsedNs );
+		m_stereoPassStats.AddGpuTime( ulElapsedNs / 1000000.f );
+	}
+
+	glBeginQuery( GL_TIME_ELAPSED, unQuery );
+	m_unStereoDrawCalls = 0;
+	m_ulStereoPassStartNs = GetTicksNs();
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Finishes measuring the stereo pass and prints the averages every
+//          so often.
+//-----------------------------------------------------------------------------
+void CMainApplication::EndStereoPassStats()
+{
+	if ( !m_bPerf )
+		return;
+
+	glEndQuery( GL_TIME_ELAPSED );
+	m_unStereoTimerQueriesIssued++;
+	m_stereoPassStats.AddCpuTime( ( GetTicksNs() - m_ulStereoPassStartNs ) / 1000000.f );
+	m_stereoPassStats.AddDrawCalls( m_unStereoDrawCalls );
+
+	StereoPassReport_t report;
+	if ( m_stereoPassStats.BGetReport( &report ) )
+	{
+		dprintf( "%s: %.1f draw calls, %.3fms GPU, %.3fms CPU per frame\n", m_bMultiview ? "Multiview" : "Per eye",
+			report.flDrawCallsPerFrame, report.flGpuMsPerFrame, report.flCpuMsPerFrame );
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Feeds the newest frame timing to the resolution governor and
+//			picks the viewport to render this frame
+//-----------------------------------------------------------------------------
+void CMainApplication::UpdateRenderResolution()
+{
+	if ( m_pFrameTimingSource )
+		m_frameTimingAnalytics.Poll( m_pFrameTimingSource );
+
+	if ( m_bAdaptiveResolution )
+	{
+		// the newest entry is the frame in flight, which has no GPU time yet
+		vr::Compositor_FrameTiming timing;
+		timing.m_nSize = sizeof( vr::Compositor_FrameTiming );
+		if ( vr::VRCompositor()->GetFrameTiming( &timing, 1 ) )
+		{
+			if ( m_resolutionGovernor.Update( timing ) && m_bVerbose )
+			{
+				dprintf( "Render scale %.2f (%.2fms GPU of %.2fms)\n", m_resolutionGovernor.GetScale(),
+					timing.m_flTotalRenderGpuMs, m_resolutionGovernor.GetFrameBudgetMs() );
+			}
+
+			// so a -recordtimings trace can be replayed at the scale it was really drawn at
+			if ( m_pFrameTimingSource )
+				m_frameTimingAnalytics.SetRenderScale( timing.m_nFrameIndex + 1, m_resolutionGovernor.GetScale() );
+		}
+	}
+
+	m_resolutionGovernor.GetViewportSize( m_nRenderWidth, m_nRenderHeight, &m_nViewportWidth, &m_nViewportHeight );
+}
+
+
 //-----------------------------------------------------------------------------
 // Purpose: Compiles a GL shader program and returns the handle. Returns 0 if
 //			the shader couldn't be compiled for some reason.
@@ -965,21 +1323,42 @@ GLuint CMainApplication::CompileGLShader( const char *pchShaderName, const char
 //-----------------------------------------------------------------------------
 bool CMainApplication::CreateAllShaders()
 {
+	// The view-projection comes from the late latch ring. With multiview both eyes are
+	// bound and each view picks its own.
+	std::string strViewProjection;
+	if ( m_bMultiview )
+	{
+		strViewProjection =
+			"#version 410\n"
+			"#extension GL_OVR_multiview2 : require\n"
+			"layout(num_views = 2) in;\n"
+			"layout(std140) uniform LateLatchView { mat4 viewProjectionLeft; };\n"
+			"layout(std140) uniform LateLatchViewRight { mat4 viewProjectionRight; };\n"
+			"#define viewProjection ( gl_ViewID_OVR == 0u ? viewProjectionLeft : viewProjectionRight )\n";
+	}
+	else
+	{
+		strViewProjection =
+			"#version 410\n"
+			"layout(std140) uniform LateLatchView { mat4 viewProjection; };\n";
+	}
+
 	m_unSceneProgramID = CompileGLShader( 
 		"Scene",
 
 		// Vertex Shader
-		"#version 410\n"
+		( strViewProjection +
 		"uniform mat4 matrix;\n"
 		"layout(location = 0) in vec4 position;\n"
 		"layout(location = 1) in vec2 v2UVcoordsIn;\n"
 		"layout(location = 2) in vec3 v3NormalIn;\n"
+		"layout(location = 3) in mat4 instanceMatrix;\n"
 		"out vec2 v2UVcoords;\n"
 		"void main()\n"
 		"{\n"
 		"	v2UVcoords = v2UVcoordsIn;\n"
-		"	gl_Position = matrix * position;\n"
-		"}\n",
+		"	gl_Position = viewProjection * matrix * instanceMatrix * position;\n"
+		"}\n" ).c_str(),
 
 		// Fragment Shader
 		"#version 410 core\n"
@@ -1002,16 +1381,17 @@ bool CMainApplication::CreateAllShaders()
 		"Controller",
 
 		// vertex shader
-		"#version 410\n"
+		( strViewProjection +
 		"uniform mat4 matrix;\n"
 		"layout(location = 0) in vec4 position;\n"
 		"layout(location = 1) in vec3 v3ColorIn;\n"
+		"layout(location = 3) in mat4 instanceMatrix;\n"
 		"out vec4 v4Color;\n"
 		"void main()\n"
 		"{\n"
 		"	v4Color.xyz = v3ColorIn; v4Color.a = 1.0;\n"
-		"	gl_Position = matrix * position;\n"
-		"}\n",
+		"	gl_Position = viewProjection * matrix * instanceMatrix * position;\n"
+		"}\n" ).c_str(),
 
 		// fragment shader
 		"#version 410\n"
@@ -1033,7 +1413,7 @@ bool CMainApplication::CreateAllShaders()
 		"render model",
 
 		// vertex shader
-		"#version 410\n"
+		( strViewProjection +
 		"uniform mat4 matrix;\n"
 		"layout(location = 0) in vec4 position;\n"
 		"layout(location = 1) in vec3 v3NormalIn;\n"
@@ -1042,8 +1422,8 @@ bool CMainApplication::CreateAllShaders()
 		"void main()\n"
 		"{\n"
 		"	v2TexCoord = v2TexCoordsIn;\n"
-		"	gl_Position = matrix * vec4(position.xyz, 1);\n"
-		"}\n",
+		"	gl_Position = viewProjection * matrix * vec4(position.xyz, 1);\n"
+		"}\n" ).c_str(),
 
 		//fragment shader
 		"#version 410 core\n"
@@ -1069,11 +1449,12 @@ bool CMainApplication::CreateAllShaders()
 		// vertex shader
 		"#version 410 core\n"
 		"layout(location = 0) in vec4 position;\n"
+		"uniform vec2 uvScale;\n"
 		"layout(location = 1) in vec2 v2UVIn;\n"
 		"noperspective out vec2 v2UV;\n"
 		"void main()\n"
 		"{\n"
-		"	v2UV = v2UVIn;\n"
+		"	v2UV = v2UVIn * uvScale;\n"
 		"	gl_Position = position;\n"
 		"}\n",
 
@@ -1088,6 +1469,37 @@ bool CMainApplication::CreateAllShaders()
 		"}\n"
 		);
 
+	// the view-projection comes from the late latch ring at binding 0, and the right eye's at binding 1 for multiview
+	GLuint rgunViewPrograms[] = { m_unSceneProgramID, m_unControllerTransformProgramID, m_unRenderModelProgramID };
+	for ( uint32_t i = 0; i < _countof( rgunViewPrograms ); i++ )
+	{
+		GLuint unBlockIndex = glGetUniformBlockIndex( rgunViewPrograms[ i ], "LateLatchView" );
+		if ( unBlockIndex == GL_INVALID_INDEX )
+		{
+			dprintf( "Unable to find LateLatchView uniform block\n" );
+			return false;
+		}
+		glUniformBlockBinding( rgunViewPrograms[ i ], unBlockIndex, 0 );
+
+		if ( m_bMultiview )
+		{
+			unBlockIndex = glGetUniformBlockIndex( rgunViewPrograms[ i ], "LateLatchViewRight" );
+			if ( unBlockIndex == GL_INVALID_INDEX )
+			{
+				dprintf( "Unable to find LateLatchViewRight uniform block\n" );
+				return false;
+			}
+			glUniformBlockBinding( rgunViewPrograms[ i ], unBlockIndex, 1 );
+		}
+	}
+
+	m_nCompanionWindowUVScaleLocation = glGetUniformLocation( m_unCompanionWindowProgramID, "uvScale" );
+	if( m_nCompanionWindowUVScaleLocation == -1 )
+	{
+		dprintf( "Unable to find uvScale uniform in companion window shader\n" );
+		return false;
+	}
+
 	return m_unSceneProgramID != 0 
 		&& m_unControllerTransformProgramID != 0
 		&& m_unRenderModelProgramID != 0
@@ -1134,14 +1546,26 @@ bool CMainApplication::SetupTexturemaps()
 
 
 //-----------------------------------------------------------------------------
-// Purpose: create a sea of cubes
+// Purpose: create a sea of cubes. There is one cube mesh, and each cube is an
+//          instance of it with its own transform.
 //-----------------------------------------------------------------------------
 void CMainApplication::SetupScene()
 {
 	if ( !m_pHMD )
 		return;
 
+	uint64_t ulStartNs = GetTicksNs();
+
 	std::vector<float> vertdataarray;
+	AddCubeToScene( Matrix4(), vertdataarray );
+	m_uiVertcount = vertdataarray.size()/5;
+
+	uint32_t unCubeCount = m_iSceneVolumeWidth * m_iSceneVolumeHeight * m_iSceneVolumeDepth;
+	if ( !m_sceneInstances.BInit( unCubeCount, 1 ) )
+	{
+		dprintf( "Unable to create the buffer for %u cubes\n", unCubeCount );
+		m_sceneInstances.Cleanup();
+	}
 
 	Matrix4 matScale;
 	matScale.scale( m_fScale, m_fScale, m_fScale );
@@ -1153,20 +1577,21 @@ void CMainApplication::SetupScene()
 	
 	Matrix4 mat = matScale * matTransform;
 
+	m_sceneInstances.BeginSlot();
 	for( int z = 0; z< m_iSceneVolumeDepth; z++ )
 	{
 		for( int y = 0; y< m_iSceneVolumeHeight; y++ )
 		{
 			for( int x = 0; x< m_iSceneVolumeWidth; x++ )
 			{
-				AddCubeToScene( mat, vertdataarray );
+				m_sceneInstances.AddInstance( mat );
 				mat = mat * Matrix4().translate( m_fScaleSpacing, 0, 0 );
 			}
 			mat = mat * Matrix4().translate( -((float)m_iSceneVolumeWidth) * m_fScaleSpacing, m_fScaleSpacing, 0 );
 		}
 		mat = mat * Matrix4().translate( 0, -((float)m_iSceneVolumeHeight) * m_fScaleSpacing, m_fScaleSpacing );
 	}
-	m_uiVertcount = vertdataarray.size()/5;
+	m_sceneInstances.EndSlot();
 	
 	glGenVertexArrays( 1, &m_unSceneVAO );
 	glBindVertexArray( m_unSceneVAO );
@@ -1185,10 +1610,16 @@ void CMainApplication::SetupScene()
 	glEnableVertexAttribArray( 1 );
 	glVertexAttribPointer( 1, 2, GL_FLOAT, GL_FALSE, stride, (const void *)offset);
 
+	m_sceneInstances.BindAttributes( k_unInstanceMatrixLocation );
+
 	glBindVertexArray( 0 );
 	glDisableVertexAttribArray(0);
 	glDisableVertexAttribArray(1);
 
+	if ( m_bPerf )
+	{
+		dprintf( "Scene: %u cubes set up in %.3fms\n", m_sceneInstances.GetInstanceCount(), ( GetTicksNs() - ulStartNs ) / 1000000.0 );
+	}
 }
 
 
@@ -1267,7 +1698,8 @@ void CMainApplication::AddCubeToScene( Matrix4 mat, std::vector<float> &vertdata
 
 
 //-----------------------------------------------------------------------------
-// Purpose: Draw all of the controllers as X/Y/Z lines
+// Purpose: Draw all of the controllers as X/Y/Z lines. The lines are built
+//          once in controller space and drawn once per controller pose.
 //-----------------------------------------------------------------------------
 void CMainApplication::RenderControllerAxes()
 {
@@ -1275,66 +1707,47 @@ void CMainApplication::RenderControllerAxes()
 	if( !m_pHMD->IsInputAvailable() )
 		return;
 
-	std::vector<float> vertdataarray;
-
-	m_uiControllerVertcount = 0;
-	m_iTrackedControllerCount = 0;
-
-	for ( EHand eHand = Left; eHand <= Right; ((int&)eHand)++ )
+	// Setup the VAO the first time through.
+	if ( m_unControllerVAO == 0 )
 	{
-		if ( !m_rHand[eHand].m_bShowController )
-			continue;
-
-		const Matrix4 & mat = m_rHand[eHand].m_rmat4Pose;
-
-		Vector4 center = mat * Vector4( 0, 0, 0, 1 );
+		std::vector<float> vertdataarray;
 
 		for ( int i = 0; i < 3; ++i )
 		{
 			Vector3 color( 0, 0, 0 );
-			Vector4 point( 0, 0, 0, 1 );
+			Vector3 point( 0, 0, 0 );
 			point[i] += 0.05f;  // offset in X, Y, Z
 			color[i] = 1.0;  // R, G, B
-			point = mat * point;
-			vertdataarray.push_back( center.x );
-			vertdataarray.push_back( center.y );
-			vertdataarray.push_back( center.z );
-
-			vertdataarray.push_back( color.x );
-			vertdataarray.push_back( color.y );
-			vertdataarray.push_back( color.z );
-		
-			vertdataarray.push_back( point.x );
-			vertdataarray.push_back( point.y );
-			vertdataarray.push_back( point.z );
-		
-			vertdataarray.push_back( color.x );
-			vertdataarray.push_back( color.y );
-			vertdataarray.push_back( color.z );
-		
-			m_uiControllerVertcount += 2;
+
+			vertdataarray.push_back( 0 );vertdataarray.push_back( 0 );vertdataarray.push_back( 0 );
+			vertdataarray.push_back( color.x );vertdataarray.push_back( color.y );vertdataarray.push_back( color.z );
+
+			vertdataarray.push_back( point.x );vertdataarray.push_back( point.y );vertdataarray.push_back( point.z );
+			vertdataarray.push_back( color.x );vertdataarray.push_back( color.y );vertdataarray.push_back( color.z );
 		}
 
-		Vector4 start = mat * Vector4( 0, 0, -0.02f, 1 );
-		Vector4 end = mat * Vector4( 0, 0, -39.f, 1 );
 		Vector3 color( .92f, .92f, .71f );
 
-		vertdataarray.push_back( start.x );vertdataarray.push_back( start.y );vertdataarray.push_back( start.z );
+		vertdataarray.push_back( 0 );vertdataarray.push_back( 0 );vertdataarray.push_back( -0.02f );
 		vertdataarray.push_back( color.x );vertdataarray.push_back( color.y );vertdataarray.push_back( color.z );
 
-		vertdataarray.push_back( end.x );vertdataarray.push_back( end.y );vertdataarray.push_back( end.z );
+		vertdataarray.push_back( 0 );vertdataarray.push_back( 0 );vertdataarray.push_back( -39.f );
 		vertdataarray.push_back( color.x );vertdataarray.push_back( color.y );vertdataarray.push_back( color.z );
-		m_uiControllerVertcount += 2;
-	}
 
-	// Setup the VAO the first time through.
-	if ( m_unControllerVAO == 0 )
-	{
+		m_uiControllerVertcount = vertdataarray.size() / 6;
+
+		if ( !m_controllerInstances.BInit( Right + 1, k_unControllerInstanceSlots ) )
+		{
+			dprintf( "Unable to create the controller transform buffer\n" );
+			m_controllerInstances.Cleanup();
+		}
+
 		glGenVertexArrays( 1, &m_unControllerVAO );
 		glBindVertexArray( m_unControllerVAO );
 
 		glGenBuffers( 1, &m_glControllerVertBuffer );
 		glBindBuffer( GL_ARRAY_BUFFER, m_glControllerVertBuffer );
+		glBufferData( GL_ARRAY_BUFFER, sizeof(float) * vertdataarray.size(), &vertdataarray[0], GL_STATIC_DRAW );
 
 		GLuint stride = 2 * 3 * sizeof( float );
 		uintptr_t offset = 0;
@@ -1349,14 +1762,22 @@ void CMainApplication::RenderControllerAxes()
 		glBindVertexArray( 0 );
 	}
 
-	glBindBuffer( GL_ARRAY_BUFFER, m_glControllerVertBuffer );
+	m_iTrackedControllerCount = 0;
 
-	// set vertex data if we have some
-	if( vertdataarray.size() > 0 )
+	m_controllerInstances.BeginSlot();
+	for ( EHand eHand = Left; eHand <= Right; ((int&)eHand)++ )
 	{
-		//$ TODO: Use glBufferSubData for this...
-		glBufferData( GL_ARRAY_BUFFER, sizeof(float) * vertdataarray.size(), &vertdataarray[0], GL_STREAM_DRAW );
+		if ( !m_rHand[eHand].m_bShowController )
+			continue;
+
+		m_controllerInstances.AddInstance( m_rHand[eHand].m_rmat4Pose );
 	}
+	m_controllerInstances.EndSlot();
+
+	// the slot moved, so point the VAO at it
+	glBindVertexArray( m_unControllerVAO );
+	m_controllerInstances.BindAttributes( k_unInstanceMatrixLocation );
+	glBindVertexArray( 0 );
 }
 
 
@@ -1369,6 +1790,8 @@ void CMainApplication::SetupCameras()
 	m_mat4ProjectionRight = GetHMDMatrixProjectionEye( vr::Eye_Right );
 	m_mat4eyePosLeft = GetHMDMatrixPoseEye( vr::Eye_Left );
 	m_mat4eyePosRight = GetHMDMatrixPoseEye( vr::Eye_Right );
+
+	m_lateLatchRing.SetEyeTransforms( m_mat4ProjectionLeft * m_mat4eyePosLeft, m_mat4ProjectionRight * m_mat4eyePosRight );
 }
 
 
@@ -1414,6 +1837,55 @@ bool CMainApplication::CreateFrameBuffer( int nWidth, int nHeight, FramebufferDe
 }
 
 
+//-----------------------------------------------------------------------------
+// Purpose: Creates the two layer frame buffer both eyes are rendered into
+//          with a single pass. Each layer also gets a frame buffer of its own
+//          so it can be resolved into the eye's resolve texture, which is what
+//          gets submitted to the compositor.
+//-----------------------------------------------------------------------------
+bool CMainApplication::CreateMultiviewFrameBuffer( int nWidth, int nHeight, MultiviewFramebufferDesc &framebufferDesc )
+{
+	glGenTextures( 1, &framebufferDesc.m_nDepthTextureId );
+	glBindTexture( GL_TEXTURE_2D_MULTISAMPLE_ARRAY, framebufferDesc.m_nDepthTextureId );
+	glTexImage3DMultisample( GL_TEXTURE_2D_MULTISAMPLE_ARRAY, 4, GL_DEPTH_COMPONENT24, nWidth, nHeight, 2, true );
+
+	glGenTextures( 1, &framebufferDesc.m_nRenderTextureId );
+	glBindTexture( GL_TEXTURE_2D_MULTISAMPLE_ARRAY, framebufferDesc.m_nRenderTextureId );
+	glTexImage3DMultisample( GL_TEXTURE_2D_MULTISAMPLE_ARRAY, 4, GL_RGBA8, nWidth, nHeight, 2, true );
+	glBindTexture( GL_TEXTURE_2D_MULTISAMPLE_ARRAY, 0 );
+
+	glGenFramebuffers( 1, &framebufferDesc.m_nRenderFramebufferId );
+	glBindFramebuffer( GL_FRAMEBUFFER, framebufferDesc.m_nRenderFramebufferId );
+	g_pglFramebufferTextureMultiviewOVR( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, framebufferDesc.m_nDepthTextureId, 0, 0, 2 );
+	g_pglFramebufferTextureMultiviewOVR( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, framebufferDesc.m_nRenderTextureId, 0, 0, 2 );
+
+	GLenum status = glCheckFramebufferStatus( GL_FRAMEBUFFER );
+	if ( status != GL_FRAMEBUFFER_COMPLETE )
+	{
+		glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+		return false;
+	}
+
+	glGenFramebuffers( 2, framebufferDesc.m_nViewFramebufferId );
+	for ( int nView = 0; nView < 2; nView++ )
+	{
+		glBindFramebuffer( GL_FRAMEBUFFER, framebufferDesc.m_nViewFramebufferId[ nView ] );
+		glFramebufferTextureLayer( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, framebufferDesc.m_nRenderTextureId, 0, nView );
+
+		status = glCheckFramebufferStatus( GL_FRAMEBUFFER );
+		if ( status != GL_FRAMEBUFFER_COMPLETE )
+		{
+			glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+			return false;
+		}
+	}
+
+	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+
+	return true;
+}
+
+
 //-----------------------------------------------------------------------------
 // Purpose:
 //-----------------------------------------------------------------------------
@@ -1423,9 +1895,21 @@ bool CMainApplication::SetupStereoRenderTargets()
 		return false;
 
 	m_pHMD->GetRecommendedRenderTargetSize( &m_nRenderWidth, &m_nRenderHeight );
+	m_nViewportWidth = m_nRenderWidth;
+	m_nViewportHeight = m_nRenderHeight;
+
+	float flDisplayFrequency = m_pHMD->GetFloatTrackedDeviceProperty( vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_DisplayFrequency_Float );
+	if ( flDisplayFrequency > 0.f )
+		m_resolutionGovernor.SetFrameBudgetMs( 1000.f / flDisplayFrequency );
 
 	CreateFrameBuffer( m_nRenderWidth, m_nRenderHeight, leftEyeDesc );
 	CreateFrameBuffer( m_nRenderWidth, m_nRenderHeight, rightEyeDesc );
+
+	if ( m_bMultiview && !CreateMultiviewFrameBuffer( m_nRenderWidth, m_nRenderHeight, m_multiviewDesc ) )
+	{
+		dprintf( "Unable to create the multiview frame buffer\n" );
+		return false;
+	}
 	
 	return true;
 }
@@ -1491,9 +1975,15 @@ void CMainApplication::RenderStereoTargets()
 	glClearColor( 0.0f, 0.0f, 0.0f, 1.0f );
 	glEnable( GL_MULTISAMPLE );
 
+	if ( m_bMultiview )
+	{
+		RenderMultiviewTarget();
+		return;
+	}
+
 	// Left Eye
 	glBindFramebuffer( GL_FRAMEBUFFER, leftEyeDesc.m_nRenderFramebufferId );
- 	glViewport(0, 0, m_nRenderWidth, m_nRenderHeight );
+ 	glViewport(0, 0, m_nViewportWidth, m_nViewportHeight );
  	RenderScene( vr::Eye_Left );
  	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
 	
@@ -1502,7 +1992,7 @@ void CMainApplication::RenderStereoTargets()
  	glBindFramebuffer(GL_READ_FRAMEBUFFER, leftEyeDesc.m_nRenderFramebufferId);
     glBindFramebuffer(GL_DRAW_FRAMEBUFFER, leftEyeDesc.m_nResolveFramebufferId );
 
-    glBlitFramebuffer( 0, 0, m_nRenderWidth, m_nRenderHeight, 0, 0, m_nRenderWidth, m_nRenderHeight, 
+    glBlitFramebuffer( 0, 0, m_nViewportWidth, m_nViewportHeight, 0, 0, m_nViewportWidth, m_nViewportHeight, 
 		GL_COLOR_BUFFER_BIT,
  		GL_LINEAR );
 
@@ -1513,7 +2003,7 @@ void CMainApplication::RenderStereoTargets()
 
 	// Right Eye
 	glBindFramebuffer( GL_FRAMEBUFFER, rightEyeDesc.m_nRenderFramebufferId );
- 	glViewport(0, 0, m_nRenderWidth, m_nRenderHeight );
+ 	glViewport(0, 0, m_nViewportWidth, m_nViewportHeight );
  	RenderScene( vr::Eye_Right );
  	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
  	
@@ -1522,7 +2012,7 @@ void CMainApplication::RenderStereoTargets()
  	glBindFramebuffer(GL_READ_FRAMEBUFFER, rightEyeDesc.m_nRenderFramebufferId );
     glBindFramebuffer(GL_DRAW_FRAMEBUFFER, rightEyeDesc.m_nResolveFramebufferId );
 	
-    glBlitFramebuffer( 0, 0, m_nRenderWidth, m_nRenderHeight, 0, 0, m_nRenderWidth, m_nRenderHeight, 
+    glBlitFramebuffer( 0, 0, m_nViewportWidth, m_nViewportHeight, 0, 0, m_nViewportWidth, m_nViewportHeight, 
 		GL_COLOR_BUFFER_BIT,
  		GL_LINEAR  );
 
@@ -1531,6 +2021,35 @@ void CMainApplication::RenderStereoTargets()
 }
 
 
+//-----------------------------------------------------------------------------
+// Purpose: Renders both eyes with one pass over the scene, then resolves each
+//          view into its eye's resolve texture.
+//-----------------------------------------------------------------------------
+void CMainApplication::RenderMultiviewTarget()
+{
+	glBindFramebuffer( GL_FRAMEBUFFER, m_multiviewDesc.m_nRenderFramebufferId );
+	glViewport( 0, 0, m_nViewportWidth, m_nViewportHeight );
+	RenderScene( vr::Eye_Left );
+	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+
+	glDisable( GL_MULTISAMPLE );
+
+	const GLuint rgunResolveFramebufferId[] = { leftEyeDesc.m_nResolveFramebufferId, rightEyeDesc.m_nResolveFramebufferId };
+	for ( int nView = 0; nView < 2; nView++ )
+	{
+		glBindFramebuffer( GL_READ_FRAMEBUFFER, m_multiviewDesc.m_nViewFramebufferId[ nView ] );
+		glBindFramebuffer( GL_DRAW_FRAMEBUFFER, rgunResolveFramebufferId[ nView ] );
+
+		glBlitFramebuffer( 0, 0, m_nViewportWidth, m_nViewportHeight, 0, 0, m_nViewportWidth, m_nViewportHeight,
+			GL_COLOR_BUFFER_BIT,
+			GL_LINEAR );
+	}
+
+	glBindFramebuffer( GL_READ_FRAMEBUFFER, 0 );
+	glBindFramebuffer( GL_DRAW_FRAMEBUFFER, 0 );
+}
+
+
 //-----------------------------------------------------------------------------
 // Purpose: Renders a scene with respect to nEye.
 //-----------------------------------------------------------------------------
@@ -1539,14 +2058,27 @@ void CMainApplication::RenderScene( vr::Hmd_Eye nEye )
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	glEnable(GL_DEPTH_TEST);
 
+	// the view-projection is read from the ring when the GPU runs, so it can still be latched
+	if ( m_bMultiview )
+	{
+		m_lateLatchRing.BindEye( vr::Eye_Left, 0 );
+		m_lateLatchRing.BindEye( vr::Eye_Right, 1 );
+	}
+	else
+	{
+		m_lateLatchRing.BindEye( nEye, 0 );
+	}
+	Matrix4 matIdentity;
+
 	if( m_bShowCubes )
 	{
 		glUseProgram( m_unSceneProgramID );
-		glUniformMatrix4fv( m_nSceneMatrixLocation, 1, GL_FALSE, GetCurrentViewProjectionMatrix( nEye ).get() );
+		glUniformMatrix4fv( m_nSceneMatrixLocation, 1, GL_FALSE, matIdentity.get() );
 		glBindVertexArray( m_unSceneVAO );
 		glBindTexture( GL_TEXTURE_2D, m_iTexture );
-		glDrawArrays( GL_TRIANGLES, 0, m_uiVertcount );
+		glDrawArraysInstanced( GL_TRIANGLES, 0, m_uiVertcount, m_sceneInstances.GetInstanceCount() );
 		glBindVertexArray( 0 );
+		m_unStereoDrawCalls++;
 	}
 
 	bool bIsInputAvailable = m_pHMD->IsInputAvailable();
@@ -1555,10 +2087,11 @@ void CMainApplication::RenderScene( vr::Hmd_Eye nEye )
 	{
 		// draw the controller axis lines
 		glUseProgram( m_unControllerTransformProgramID );
-		glUniformMatrix4fv( m_nControllerMatrixLocation, 1, GL_FALSE, GetCurrentViewProjectionMatrix( nEye ).get() );
+		glUniformMatrix4fv( m_nControllerMatrixLocation, 1, GL_FALSE, matIdentity.get() );
 		glBindVertexArray( m_unControllerVAO );
-		glDrawArrays( GL_LINES, 0, m_uiControllerVertcount );
+		glDrawArraysInstanced( GL_LINES, 0, m_uiControllerVertcount, m_controllerInstances.GetInstanceCount() );
 		glBindVertexArray( 0 );
+		m_unStereoDrawCalls++;
 	}
 
 	// ----- Render Model rendering -----
@@ -1570,10 +2103,10 @@ void CMainApplication::RenderScene( vr::Hmd_Eye nEye )
 			continue;
 
 		const Matrix4 & matDeviceToTracking = m_rHand[eHand].m_rmat4Pose;
-		Matrix4 matMVP = GetCurrentViewProjectionMatrix( nEye ) * matDeviceToTracking;
-		glUniformMatrix4fv( m_nRenderModelMatrixLocation, 1, GL_FALSE, matMVP.get() );
+		glUniformMatrix4fv( m_nRenderModelMatrixLocation, 1, GL_FALSE, matDeviceToTracking.get() );
 
 		m_rHand[eHand].m_pRenderModel->Draw();
+		m_unStereoDrawCalls++;
 	}
 
 	glUseProgram( 0 );
@@ -1590,6 +2123,7 @@ void CMainApplication::RenderCompanionWindow()
 
 	glBindVertexArray( m_unCompanionWindowVAO );
 	glUseProgram( m_unCompanionWindowProgramID );
+	glUniform2f( m_nCompanionWindowUVScaleLocation, (float)m_nViewportWidth / m_nRenderWidth, (float)m_nViewportHeight / m_nRenderHeight );
 
 	// render left eye (first half of index array )
 	glBindTexture(GL_TEXTURE_2D, leftEyeDesc.m_nResolveTextureId );
@@ -1798,6 +2332,246 @@ Matrix4 CMainApplication::ConvertSteamVRMatrixToMatrix4( const vr::HmdMatrix34_t
 }
 
 
+//-----------------------------------------------------------------------------
+// Purpose: Create/destroy the GL late latch ring
+//-----------------------------------------------------------------------------
+CGLLateLatchRing::CGLLateLatchRing()
+	: m_glBuffer( 0 )
+	, m_nEntryStride( 0 )
+	, m_pMapped( NULL )
+{
+	memset( m_rgSlotFences, 0, sizeof( m_rgSlotFences ) );
+}
+
+
+CGLLateLatchRing::~CGLLateLatchRing()
+{
+	Cleanup();
+}
+
+
+bool CGLLateLatchRing::BInit()
+{
+	GLint nAlignment = 256;
+	glGetIntegerv( GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &nAlignment );
+	if ( nAlignment < 1 )
+		nAlignment = 256;
+	m_nEntryStride = ( ( sizeof( Matrix4 ) + nAlignment - 1 ) / nAlignment ) * nAlignment;
+	GLsizeiptr nSize = m_nEntryStride * k_unSlots * 2;
+
+	glGenBuffers( 1, &m_glBuffer );
+	glBindBuffer( GL_UNIFORM_BUFFER, m_glBuffer );
+	if ( GLEW_ARB_buffer_storage )
+	{
+		// coherent, so CPU writes reach commands that were issued before them
+		GLbitfield nFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage( GL_UNIFORM_BUFFER, nSize, NULL, nFlags );
+		m_pMapped = (uint8_t *)glMapBufferRange( GL_UNIFORM_BUFFER, 0, nSize, nFlags );
+	}
+	if ( !m_pMapped )
+	{
+		m_vecShadow.resize( nSize );
+		glBufferData( GL_UNIFORM_BUFFER, nSize, NULL, GL_STREAM_DRAW );
+	}
+	glBindBuffer( GL_UNIFORM_BUFFER, 0 );
+
+	return glGetError() == GL_NO_ERROR;
+}
+
+
+void CGLLateLatchRing::Cleanup()
+{
+	for ( uint32_t i = 0; i < k_unSlots; i++ )
+	{
+		if ( m_rgSlotFences[ i ] )
+		{
+			glDeleteSync( m_rgSlotFences[ i ] );
+			m_rgSlotFences[ i ] = NULL;
+		}
+	}
+
+	if ( m_glBuffer )
+	{
+		if ( m_pMapped )
+		{
+			glBindBuffer( GL_UNIFORM_BUFFER, m_glBuffer );
+			glUnmapBuffer( GL_UNIFORM_BUFFER );
+			glBindBuffer( GL_UNIFORM_BUFFER, 0 );
+			m_pMapped = NULL;
+		}
+		glDeleteBuffers( 1, &m_glBuffer );
+		m_glBuffer = 0;
+	}
+	m_vecShadow.clear();
+}
+
+
+void CGLLateLatchRing::BindEye( vr::EVREye eEye, GLuint unBinding )
+{
+	GLintptr nOffset = ( GetCurrentSlot() * 2 + eEye ) * m_nEntryStride;
+	glBindBufferRange( GL_UNIFORM_BUFFER, unBinding, m_glBuffer, nOffset, sizeof( Matrix4 ) );
+}
+
+
+void CGLLateLatchRing::FenceCurrentSlot()
+{
+	// glBufferSubData uploads are ordered with the draws already, only mapped writes need this
+	if ( !m_pMapped )
+		return;
+
+	uint32_t unSlot = GetCurrentSlot();
+	if ( m_rgSlotFences[ unSlot ] )
+		glDeleteSync( m_rgSlotFences[ unSlot ] );
+	m_rgSlotFences[ unSlot ] = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+}
+
+
+void CGLLateLatchRing::AcquireSlot( uint32_t unSlot )
+{
+	if ( !m_rgSlotFences[ unSlot ] )
+		return;
+
+	// normally long signalled, since the slot was last used k_unSlots frames ago
+	glClientWaitSync( m_rgSlotFences[ unSlot ], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000 );
+	glDeleteSync( m_rgSlotFences[ unSlot ] );
+	m_rgSlotFences[ unSlot ] = NULL;
+}
+
+
+float *CGLLateLatchRing::GetSlotMatrix( uint32_t unSlot, vr::EVREye eEye )
+{
+	uint8_t *pBase = m_pMapped ? m_pMapped : &m_vecShadow[ 0 ];
+	return (float *)( pBase + ( unSlot * 2 + eEye ) * m_nEntryStride );
+}
+
+
+void CGLLateLatchRing::FlushSlot( uint32_t unSlot )
+{
+	if ( m_pMapped )
+		return;
+
+	glBindBuffer( GL_UNIFORM_BUFFER, m_glBuffer );
+	glBufferSubData( GL_UNIFORM_BUFFER, unSlot * 2 * m_nEntryStride, 2 * m_nEntryStride, &m_vecShadow[ unSlot * 2 * m_nEntryStride ] );
+	glBindBuffer( GL_UNIFORM_BUFFER, 0 );
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Create/destroy the GL instance transform buffer
+//-----------------------------------------------------------------------------
+CGLInstanceBuffer::CGLInstanceBuffer()
+	: m_glBuffer( 0 )
+	, m_unCapacity( 0 )
+	, m_unSlots( 0 )
+	, m_unSlot( 0 )
+	, m_unCount( 0 )
+	, m_pMapped( NULL )
+{
+}
+
+
+CGLInstanceBuffer::~CGLInstanceBuffer()
+{
+	Cleanup();
+}
+
+
+bool CGLInstanceBuffer::BInit( uint32_t unCapacity, uint32_t unSlots )
+{
+	m_unCapacity = unCapacity ? unCapacity : 1;
+	m_unSlots = unSlots ? unSlots : 1;
+	m_unSlot = m_unSlots - 1;
+	m_unCount = 0;
+	GLsizeiptr nSize = (GLsizeiptr)m_unCapacity * m_unSlots * 16 * sizeof( float );
+
+	glGenBuffers( 1, &m_glBuffer );
+	glBindBuffer( GL_ARRAY_BUFFER, m_glBuffer );
+	if ( GLEW_ARB_buffer_storage )
+	{
+		// coherent, so the transforms need no flush before the draw that reads them
+		GLbitfield nFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage( GL_ARRAY_BUFFER, nSize, NULL, nFlags );
+		m_pMapped = (float *)glMapBufferRange( GL_ARRAY_BUFFER, 0, nSize, nFlags );
+	}
+	if ( !m_pMapped )
+	{
+		m_vecShadow.resize( m_unCapacity * m_unSlots * 16 );
+		glBufferData( GL_ARRAY_BUFFER, nSize, NULL, GL_DYNAMIC_DRAW );
+	}
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+	return glGetError() == GL_NO_ERROR;
+}
+
+
+void CGLInstanceBuffer::Cleanup()
+{
+	if ( m_glBuffer )
+	{
+		if ( m_pMapped )
+		{
+			glBindBuffer( GL_ARRAY_BUFFER, m_glBuffer );
+			glUnmapBuffer( GL_ARRAY_BUFFER );
+			glBindBuffer( GL_ARRAY_BUFFER, 0 );
+			m_pMapped = NULL;
+		}
+		glDeleteBuffers( 1, &m_glBuffer );
+		m_glBuffer = 0;
+	}
+	m_vecShadow.clear();
+	m_unCapacity = 0;
+	m_unCount = 0;
+}
+
+
+void CGLInstanceBuffer::BeginSlot()
+{
+	m_unSlot = m_unSlots ? ( m_unSlot + 1 ) % m_unSlots : 0;
+	m_unCount = 0;
+}
+
+
+bool CGLInstanceBuffer::AddInstance( const Matrix4 &matInstance )
+{
+	if ( m_unCount >= m_unCapacity )
+		return false;
+
+	memcpy( GetSlotBase() + m_unCount * 16, matInstance.get(), 16 * sizeof( float ) );
+	m_unCount++;
+	return true;
+}
+
+
+void CGLInstanceBuffer::EndSlot()
+{
+	if ( m_pMapped || !m_unCount )
+		return;
+
+	glBindBuffer( GL_ARRAY_BUFFER, m_glBuffer );
+	glBufferSubData( GL_ARRAY_BUFFER, (GLintptr)m_unSlot * m_unCapacity * 16 * sizeof( float ), m_unCount * 16 * sizeof( float ), GetSlotBase() );
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+}
+
+
+void CGLInstanceBuffer::BindAttributes( GLuint unLocation ) const
+{
+	if ( !m_glBuffer )
+		return;
+
+	GLsizei stride = 16 * sizeof( float );
+	uintptr_t offset = (uintptr_t)m_unSlot * m_unCapacity * stride;
+
+	glBindBuffer( GL_ARRAY_BUFFER, m_glBuffer );
+	for ( GLuint unColumn = 0; unColumn < 4; unColumn++ )
+	{
+		glEnableVertexAttribArray( unLocation + unColumn );
+		glVertexAttribPointer( unLocation + unColumn, 4, GL_FLOAT, GL_FALSE, stride, (const void *)( offset + unColumn * 4 * sizeof( float ) ) );
+		glVertexAttribDivisor( unLocation + unColumn, 1 );
+	}
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+}
+
+
 //-----------------------------------------------------------------------------
 // Purpose: Create/destroy GL Render Models
 //-----------------------------------------------------------------------------
@@ -1906,6 +2680,33 @@ void CGLRenderModel::Draw()
 }
 
 
+//-----------------------------------------------------------------------------
+// Purpose: Replays a trace recorded with -recordtimings through the
+//			resolution governor and prints how it would have behaved
+//-----------------------------------------------------------------------------
+bool RunGovernorSimulation( const char *pchTracePath )
+{
+	CFrameTimingReplaySource replay;
+	if ( !replay.Load( pchTracePath ) )
+	{
+		printf( "Unable to load frame timing trace %s\n", pchTracePath );
+		return false;
+	}
+
+	// the trace doesn't say what the display ran at, so assume it is the usual 90Hz
+	CResolutionGovernor governor;
+	ResolutionGovernorSimResult_t result;
+	if ( !SimulateResolutionGovernor( &replay, &governor, 0.15f, &result, NULL ) )
+		return false;
+
+	printf( "Simulated %u frames from %s\n", result.unFrames, pchTracePath );
+	printf( "  over budget: %u (%u in the recording)\n", result.unOverBudgetFrames, result.unOverBudgetFramesNative );
+	printf( "  scale: mean %.3f, min %.3f, %u changes\n", result.flMeanScale, result.flMinScale, result.unScaleChanges );
+	printf( "  mean GPU utilization: %.1f%%\n", result.flMeanUtilization * 100.f );
+	return true;
+}
+
+
 //-----------------------------------------------------------------------------
 // Purpose:
 //-----------------------------------------------------------------------------
@@ -1913,6 +2714,14 @@ int main(int argc, char *argv[])
 {
 	CMainApplication *pMainApplication = new CMainApplication( argc, argv );
 
+	if ( !pMainApplication->GetGovernorSimTrace().empty() )
+	{
+		// offline tuning: no headset or window needed
+		bool bOk = RunGovernorSimulation( pMainApplication->GetGovernorSimTrace().c_str() );
+		delete pMainApplication;
+		return bOk ? 0 : 1;
+	}
+
 	if (!pMainApplication->BInit())
 	{
 		pMainApplication->Shutdown();
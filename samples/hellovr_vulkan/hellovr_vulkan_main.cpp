@@ -15,10 +15,16 @@
 #include <inttypes.h>
 #include <openvr.h>
 #include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #include "shared/lodepng.h"
 #include "shared/Matrices.h"
 #include "shared/pathtools.h"
+#include "shared/latelatch.h"
+#include "shared/stereopassstats.h"
 
 #if defined(POSIX)
 #include "unistd.h"
@@ -37,6 +43,11 @@ void ThreadSleep( unsigned long nMilliseconds )
 #endif
 }
 
+// Frames that can be recorded or executing at once. Each one owns its command buffers and
+// per-frame constant buffers, and is reclaimed by waiting on its fence.
+static const uint32_t k_unFramesInFlight = 2;
+static_assert( k_unFramesInFlight <= CLateLatchPoseRing::k_unSlots, "a late latch slot must outlive the frame that reads it" );
+
 // Pipeline state objects
 enum PipelineStateObjectEnum_t
 {
@@ -50,26 +61,49 @@ enum PipelineStateObjectEnum_t
 // Indices of descriptor sets for rendering
 enum DescriptorSetIndex_t
 {
-	DESCRIPTOR_SET_LEFT_EYE_SCENE = 0,
-	DESCRIPTOR_SET_RIGHT_EYE_SCENE,
+	DESCRIPTOR_SET_SCENE0 = 0,		// one per late latch slot and eye, left eye first
+	DESCRIPTOR_SET_SCENE_MAX = DESCRIPTOR_SET_SCENE0 + CLateLatchPoseRing::k_unSlots * 2 - 1,
 	DESCRIPTOR_SET_COMPANION_LEFT_TEXTURE,
 	DESCRIPTOR_SET_COMPANION_RIGHT_TEXTURE,
-	DESCRIPTOR_SET_LEFT_EYE_RENDER_MODEL0,
-	DESCRIPTOR_SET_LEFT_EYE_RENDER_MODEL_MAX = DESCRIPTOR_SET_LEFT_EYE_RENDER_MODEL0 + vr::k_unMaxTrackedDeviceCount,
-	DESCRIPTOR_SET_RIGHT_EYE_RENDER_MODEL0,
-	DESCRIPTOR_SET_RIGHT_EYE_RENDER_MODEL_MAX = DESCRIPTOR_SET_RIGHT_EYE_RENDER_MODEL0 + vr::k_unMaxTrackedDeviceCount,
+	DESCRIPTOR_SET_RENDER_MODEL0,		// ( frame in flight * 2 + eye ) * k_unMaxTrackedDeviceCount + tracked device
+	DESCRIPTOR_SET_RENDER_MODEL_MAX = DESCRIPTOR_SET_RENDER_MODEL0 + k_unFramesInFlight * 2 * vr::k_unMaxTrackedDeviceCount - 1,
 	NUM_DESCRIPTOR_SETS
 };
 
+class CVulkanLateLatchRing : public CLateLatchPoseRing
+{
+public:
+	CVulkanLateLatchRing();
+	~CVulkanLateLatchRing();
+
+	bool BInit( VkDevice pDevice, const VkPhysicalDeviceMemoryProperties &memoryProperties, const VkPhysicalDeviceProperties &deviceProperties );
+	void Cleanup();
+
+	/** uniform buffer range holding the matrix for a slot and eye, for the scene descriptor sets */
+	VkDescriptorBufferInfo GetBufferInfo( uint32_t unSlot, vr::EVREye eEye ) const;
+
+protected:
+	virtual float *GetSlotMatrix( uint32_t unSlot, vr::EVREye eEye );
+
+private:
+	VkDevice m_pDevice;
+	VkBuffer m_pBuffer;
+	VkDeviceMemory m_pBufferMemory;
+	VkDeviceSize m_nEntryStride;
+	uint8_t *m_pMapped;
+};
+
 class VulkanRenderModel
 {
 public:
 	VulkanRenderModel( const std::string & sRenderModelName );
 	~VulkanRenderModel();
 
-	bool BInit( VkDevice pDevice, const VkPhysicalDeviceMemoryProperties &memoryProperties, VkCommandBuffer pCommandBuffer, vr::TrackedDeviceIndex_t unTrackedDeviceIndex, VkDescriptorSet pDescriptorSets[ 2 ], const vr::RenderModel_t & vrModel, const vr::RenderModel_TextureMap_t & vrDiffuseTexture );
+	bool BInit( VkDevice pDevice, const VkPhysicalDeviceMemoryProperties &memoryProperties, VkCommandBuffer pCommandBuffer, vr::TrackedDeviceIndex_t unTrackedDeviceIndex, VkDescriptorSet pDescriptorSets[ k_unFramesInFlight * 2 ], const vr::RenderModel_t & vrModel, const vr::RenderModel_TextureMap_t & vrDiffuseTexture );
 	void Cleanup();
-	void Draw( vr::EVREye nEye, VkCommandBuffer pCommandBuffer, VkPipelineLayout pPipelineLayout, const Matrix4 &matMVP );
+	void Draw( uint32_t unFrame, vr::EVREye nEye, VkCommandBuffer pCommandBuffer, VkPipelineLayout pPipelineLayout, const Matrix4 &matMVP );
+	void DrawMultiview( uint32_t unFrame, VkCommandBuffer pCommandBuffer, VkPipelineLayout pPipelineLayout, const Matrix4 &matLeftMVP, const Matrix4 &matRightMVP );
+	void UpdateTransform( uint32_t unFrame, vr::EVREye nEye, const Matrix4 &matMVP );
 	const std::string & GetName() const { return m_sModelName; }
 
 private:
@@ -84,10 +118,11 @@ private:
 	VkImageView m_pImageView;
 	VkBuffer m_pImageStagingBuffer;
 	VkDeviceMemory m_pImageStagingBufferMemory;
-	VkBuffer m_pConstantBuffer[ 2 ];
-	VkDeviceMemory m_pConstantBufferMemory[ 2 ];
-	void *m_pConstantBufferData[ 2 ];
-	VkDescriptorSet m_pDescriptorSets[ 2 ];
+	// One transform per frame in flight and eye, indexed by frame * 2 + eye
+	VkBuffer m_pConstantBuffer[ k_unFramesInFlight * 2 ];
+	VkDeviceMemory m_pConstantBufferMemory[ k_unFramesInFlight * 2 ];
+	void *m_pConstantBufferData[ k_unFramesInFlight * 2 ];
+	VkDescriptorSet m_pDescriptorSets[ k_unFramesInFlight * 2 ];
 	VkSampler m_pSampler;
 
 	size_t m_unVertexCount;
@@ -95,6 +130,50 @@ private:
 	std::string m_sModelName;
 };
 
+// Command buffers recorded each frame, in submission order
+enum FrameCommandBuffer_t
+{
+	FRAME_COMMAND_BUFFER_LEFT_EYE = 0,
+	FRAME_COMMAND_BUFFER_RIGHT_EYE,
+	FRAME_COMMAND_BUFFER_COMPANION,
+	FRAME_COMMAND_BUFFER_COUNT
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Everything one frame in flight owns. Each command buffer has its
+//          own pool so the threads recording them never share one, and all
+//          of it is reclaimed at once when the frame's fence signals.
+//-----------------------------------------------------------------------------
+struct FrameResources_t
+{
+	uint32_t m_unIndex;
+	VkCommandPool m_pCommandPools[ FRAME_COMMAND_BUFFER_COUNT ];
+	VkCommandBuffer m_pCommandBuffers[ FRAME_COMMAND_BUFFER_COUNT ];
+	VkFence m_pFence;
+
+	// Controller axes, rebuilt every frame
+	VkBuffer m_pControllerAxesVertexBuffer;
+	VkDeviceMemory m_pControllerAxesVertexBufferMemory;
+	unsigned int m_uiControllerVertcount;
+
+	// Companion window image, presented by the submit thread
+	VkSemaphore m_pSwapchainSemaphore;
+	uint32_t m_nSwapchainImage;
+	bool m_bSwapchainImageAcquired;
+
+	// Render models drawn for each eye, so a late latch can rewrite their transforms
+	struct DrawnRenderModel_t
+	{
+		VulkanRenderModel *m_pRenderModel;
+		Matrix4 m_matDeviceToTracking;
+	};
+	std::vector< DrawnRenderModel_t > m_vecDrawnRenderModels[ 2 ];
+
+	// -perf: draw calls recorded for each eye, waiting to be added with the frame's timestamps
+	uint32_t m_unDrawCalls[ 2 ];
+	bool m_bStatsPending;
+};
+
 static bool g_bPrintf = true;
 
 // Vulkan extension entrypoints
@@ -125,9 +204,18 @@ public:
 
 	void RunMainLoop();
 	bool HandleInput();
+	void HandleVRInput();
 	void ProcessVREvent( const vr::VREvent_t & event );
 	void RenderFrame();
 
+	bool BInitFrameResources();
+	void StartFrameThreads();
+	void StopFrameThreads();
+	void EyeWorkerThread( vr::EVREye nEye );
+	void SubmitThread();
+	void SubmitFrame( FrameResources_t *pFrame );
+	void UpdateStereoPassStats( FrameResources_t *pFrame );
+
 	bool SetupTexturemaps();
 	static void GenMipMapRGBA( const uint8_t *pSrc, uint8_t *ppDst, int nSrcWidth, int nSrcHeight, int *pDstWidthOut, int *pDstHeightOut );
 
@@ -135,15 +223,15 @@ public:
 	void AddCubeToScene( Matrix4 mat, std::vector<float> &vertdata );
 	void AddCubeVertex( float fl0, float fl1, float fl2, float fl3, float fl4, std::vector<float> &vertdata );
 
-	void UpdateControllerAxes();
+	void UpdateControllerAxes( FrameResources_t *pFrame );
 
 	bool SetupStereoRenderTargets();
 	void SetupCompanionWindow();
 	void SetupCameras();
 
-	void RenderStereoTargets();
-	void RenderCompanionWindow();
-	void RenderScene( vr::Hmd_Eye nEye );
+	void RenderEye( vr::EVREye nEye, FrameResources_t *pFrame );
+	void RenderCompanionWindow( FrameResources_t *pFrame );
+	void RenderScene( vr::Hmd_Eye nEye, FrameResources_t *pFrame );
 
 	Matrix4 GetHMDMatrixProjectionEye( vr::Hmd_Eye nEye );
 	Matrix4 GetHMDMatrixPoseEye( vr::Hmd_Eye nEye );
@@ -156,6 +244,7 @@ public:
 	void CreateAllDescriptorSets();
 
 	void SetupRenderModelForTrackedDevice( vr::TrackedDeviceIndex_t unTrackedDeviceIndex );
+	void LatchRenderModelTransforms( FrameResources_t *pFrame );
 	VulkanRenderModel *FindOrLoadRenderModel( vr::TrackedDeviceIndex_t unTrackedDeviceIndex, const char *pchRenderModelName );
 
 private: 
@@ -163,6 +252,8 @@ private:
 	bool m_bVerbose;
 	bool m_bPerf;
 	bool m_bVblank;
+	bool m_bLateLatch;
+	bool m_bMultiview;
 	int m_nMSAASampleCount;
 	// Optional scaling factor to render with supersampling (defaults off, use -scale)
 	float m_flSuperSampleScale;
@@ -214,10 +305,10 @@ private:
 	VkPhysicalDeviceMemoryProperties m_physicalDeviceMemoryProperties;
 	VkPhysicalDeviceFeatures m_physicalDeviceFeatures;
 	uint32_t m_nQueueFamilyIndex;
+	uint32_t m_unTimestampValidBits;
 	VkDebugReportCallbackEXT m_pDebugReportCallback;
 	uint32_t m_nSwapQueueImageCount;
 	uint32_t m_nFrameIndex;
-	uint32_t m_nCurrentSwapchainImage;
 	std::vector< VkImage > m_swapchainImages;
 	std::vector< VkImageView > m_pSwapchainImageViews;
 	std::vector< VkFramebuffer > m_pSwapchainFramebuffers;
@@ -234,18 +325,38 @@ private:
 		VkCommandBuffer m_pCommandBuffer;
 		VkFence m_pFence;
 	};
+	// Command buffers for resource loading; frames use m_frames
 	std::deque< VulkanCommandBuffer_t > m_commandBuffers;
 	VulkanCommandBuffer_t m_currentCommandBuffer;
 	
 	VulkanCommandBuffer_t GetCommandBuffer();
 
+	// Frames in flight, and the threads that record and submit them
+	FrameResources_t m_frames[ k_unFramesInFlight ];
+	uint64_t m_ulFrameNumber;
+	std::thread m_eyeWorkerThreads[ 2 ];
+	std::thread m_submitThread;
+
+	std::mutex m_frameMutex;					// guards the hand-off state below
+	std::condition_variable m_frameCondition;
+	bool m_bQuitFrameThreads;
+	FrameResources_t *m_pRecordFrame;			// frame the eye workers record
+	uint64_t m_ulRecordGeneration;				// bumped to start the eye workers
+	uint32_t m_unEyesRecorded;
+	FrameResources_t *m_pSubmitFrame;			// recorded frame waiting for the submit thread
+	uint64_t m_ulPosesReady;					// frames submitted and followed by WaitGetPoses
+
+	// -perf: a start and end timestamp around the eye command buffers of each frame in flight
+	VkQueryPool m_pTimestampQueryPool;
+	CStereoPassStats m_stereoPassStats;
+
+	std::mutex m_queueMutex;					// m_pQueue is shared by the submit thread, render model loading and the compositor
+
 	// Scene resources
 	VkBuffer m_pSceneVertexBuffer;
 	VkDeviceMemory m_pSceneVertexBufferMemory;
 	VkBufferView m_pSceneVertexBufferView;
-	VkBuffer m_pSceneConstantBuffer[ 2 ];
-	VkDeviceMemory m_pSceneConstantBufferMemory[ 2 ];
-	void *m_pSceneConstantBufferData[ 2 ];
+	CVulkanLateLatchRing m_lateLatchRing;
 	VkImage m_pSceneImage;
 	VkDeviceMemory m_pSceneImageMemory;
 	VkImageView m_pSceneImageView;
@@ -266,12 +377,6 @@ private:
 	VkBuffer m_pCompanionWindowIndexBuffer;
 	VkDeviceMemory m_pCompanionWindowIndexBufferMemory;
 
-	// Controller axes resources
-	VkBuffer m_pControllerAxesVertexBuffer;
-	VkDeviceMemory m_pControllerAxesVertexBufferMemory;
-
-	unsigned int m_uiControllerVertcount;
-
 	Matrix4 m_mat4HMDPose;
 	Matrix4 m_mat4eyePosLeft;
 	Matrix4 m_mat4eyePosRight;
@@ -306,11 +411,14 @@ private:
 		VkImageView m_pDepthStencilImageView;
 		VkRenderPass m_pRenderPass;
 		VkFramebuffer m_pFramebuffer;
+		uint32_t m_nViewCount;					// 2 when the image holds both eyes as layers
+		VkImageView m_pViewImageViews[ 2 ];		// single layer views of a multiview image
 	};
+	// With -multiview both eyes are rendered into m_leftEyeDesc and m_rightEyeDesc is unused
 	FramebufferDesc m_leftEyeDesc;
 	FramebufferDesc m_rightEyeDesc;
 
-	bool CreateFrameBuffer( int nWidth, int nHeight, FramebufferDesc &framebufferDesc );
+	bool CreateFrameBuffer( int nWidth, int nHeight, uint32_t nViewCount, FramebufferDesc &framebufferDesc );
 	
 	uint32_t m_nRenderWidth;
 	uint32_t m_nRenderHeight;
@@ -458,6 +566,19 @@ static bool CreateVulkanBuffer( VkDevice pDevice, const VkPhysicalDeviceMemoryPr
 }
 
 
+//-----------------------------------------------------------------------------
+// Purpose: Path of the SPIR-V built from a shader in bin/shaders for one stage
+//-----------------------------------------------------------------------------
+static std::string GetShaderPath( const char *pchShaderName, const char *pchStageName )
+{
+	std::string sExecutableDirectory = Path_StripFilename( Path_GetExecutablePath() );
+
+	char shaderFileName[ 1024 ];
+	sprintf( shaderFileName, "../shaders/%s_%s.spv", pchShaderName, pchStageName );
+	return Path_MakeAbsolute( shaderFileName, sExecutableDirectory );
+}
+
+
 //-----------------------------------------------------------------------------
 // Purpose: Constructor
 //-----------------------------------------------------------------------------
@@ -471,6 +592,8 @@ CMainApplication::CMainApplication( int argc, char *argv[] )
 	, m_bVerbose( false )
 	, m_bPerf( false )
 	, m_bVblank( false )
+	, m_bLateLatch( false )
+	, m_bMultiview( false )
 	, m_nMSAASampleCount( 4 )
 	, m_flSuperSampleScale( 1.0f )
 	, m_iTrackedControllerCount( 0 )
@@ -486,12 +609,20 @@ CMainApplication::CMainApplication( int argc, char *argv[] )
 	, m_pQueue( VK_NULL_HANDLE )
 	, m_pSurface( VK_NULL_HANDLE )
 	, m_pSwapchain( VK_NULL_HANDLE )
+	, m_unTimestampValidBits( 0 )
 	, m_pDebugReportCallback( VK_NULL_HANDLE )
 	, m_pCommandPool( VK_NULL_HANDLE )
 	, m_pDescriptorPool( VK_NULL_HANDLE )
 	, m_nSwapQueueImageCount( 0 )
 	, m_nFrameIndex( 0 )
-	, m_nCurrentSwapchainImage( 0 )
+	, m_ulFrameNumber( 0 )
+	, m_bQuitFrameThreads( false )
+	, m_pRecordFrame( NULL )
+	, m_ulRecordGeneration( 0 )
+	, m_unEyesRecorded( 0 )
+	, m_pSubmitFrame( NULL )
+	, m_ulPosesReady( 0 )
+	, m_pTimestampQueryPool( VK_NULL_HANDLE )
 	, m_pSceneVertexBuffer( VK_NULL_HANDLE )
 	, m_pSceneVertexBufferMemory( VK_NULL_HANDLE )
 	, m_pSceneVertexBufferView( VK_NULL_HANDLE )
@@ -508,15 +639,28 @@ CMainApplication::CMainApplication( int argc, char *argv[] )
 	, m_pCompanionWindowVertexBufferMemory( VK_NULL_HANDLE )
 	, m_pCompanionWindowIndexBuffer( VK_NULL_HANDLE )
 	, m_pCompanionWindowIndexBufferMemory( VK_NULL_HANDLE )
-	, m_pControllerAxesVertexBuffer( VK_NULL_HANDLE )
-	, m_pControllerAxesVertexBufferMemory( VK_NULL_HANDLE )
 {
 	memset( &m_leftEyeDesc, 0, sizeof( m_leftEyeDesc ) );
 	memset( &m_rightEyeDesc, 0, sizeof( m_rightEyeDesc ) );
 	memset( &m_pShaderModules[ 0 ], 0, sizeof( m_pShaderModules ) );
 	memset( &m_pPipelines[ 0 ], 0, sizeof( m_pPipelines ) );
-	memset( m_pSceneConstantBufferData, 0, sizeof( m_pSceneConstantBufferData ) );
 	memset( m_pDescriptorSets, 0, sizeof( m_pDescriptorSets ) );
+	for ( uint32_t nFrame = 0; nFrame < k_unFramesInFlight; nFrame++ )
+	{
+		FrameResources_t &frame = m_frames[ nFrame ];
+		frame.m_unIndex = nFrame;
+		memset( frame.m_pCommandPools, 0, sizeof( frame.m_pCommandPools ) );
+		memset( frame.m_pCommandBuffers, 0, sizeof( frame.m_pCommandBuffers ) );
+		frame.m_pFence = VK_NULL_HANDLE;
+		frame.m_pControllerAxesVertexBuffer = VK_NULL_HANDLE;
+		frame.m_pControllerAxesVertexBufferMemory = VK_NULL_HANDLE;
+		frame.m_uiControllerVertcount = 0;
+		frame.m_pSwapchainSemaphore = VK_NULL_HANDLE;
+		frame.m_nSwapchainImage = 0;
+		frame.m_bSwapchainImageAcquired = false;
+		memset( frame.m_unDrawCalls, 0, sizeof( frame.m_unDrawCalls ) );
+		frame.m_bStatsPending = false;
+	}
 
 	for( int i = 1; i < argc; i++ )
 	{
@@ -532,6 +676,18 @@ CMainApplication::CMainApplication( int argc, char *argv[] )
 		{
 			m_bVblank = false;
 		}
+		else if( !stricmp( argv[i], "-latelatch" ) )
+		{
+			m_bLateLatch = true;
+		}
+		else if( !stricmp( argv[i], "-multiview" ) )
+		{
+			m_bMultiview = true;
+		}
+		else if( !stricmp( argv[i], "-perf" ) )
+		{
+			m_bPerf = true;
+		}
 		else if ( !stricmp( argv[i], "-msaa" ) && ( argc > i + 1 ) && ( *argv[ i + 1 ] != '-' ) )
 		{
 			m_nMSAASampleCount = atoi( argv[ i + 1 ] );
@@ -981,6 +1137,25 @@ bool CMainApplication::BInitVulkanDevice()
 	// Add additional required extensions
 	requiredDeviceExtensions.push_back( VK_KHR_SWAPCHAIN_EXTENSION_NAME );
 
+	// -multiview also needs the multiview build of the shaders that draw into the eyes
+	if ( m_bMultiview )
+	{
+		const char *pMultiviewShaderNames[] = { "scene_multiview", "axes_multiview", "rendermodel_multiview" };
+		for ( uint32_t nShader = 0; nShader < _countof( pMultiviewShaderNames ); nShader++ )
+		{
+			if ( !Path_Exists( GetShaderPath( pMultiviewShaderNames[ nShader ], "vs" ) ) || !Path_Exists( GetShaderPath( pMultiviewShaderNames[ nShader ], "ps" ) ) )
+			{
+				dprintf( "%s SPIR-V is missing, rendering each eye separately\n", pMultiviewShaderNames[ nShader ] );
+				m_bMultiview = false;
+				break;
+			}
+		}
+	}
+	if ( m_bMultiview )
+	{
+		requiredDeviceExtensions.push_back( VK_KHX_MULTIVIEW_EXTENSION_NAME );
+	}
+
 	// Find the first graphics queue
 	uint32_t nQueueCount = 0;
 	vkGetPhysicalDeviceQueueFamilyProperties( m_pPhysicalDevice, &nQueueCount, 0 );
@@ -1005,6 +1180,7 @@ bool CMainApplication::BInitVulkanDevice()
 		return false;
 	}
 	m_nQueueFamilyIndex = nGraphicsQueueIndex;
+	m_unTimestampValidBits = pQueueFamilyProperties[ nGraphicsQueueIndex ].timestampValidBits;
 	delete [] pQueueFamilyProperties;
 
 	uint32_t nDeviceExtensionCount = 0;
@@ -1051,6 +1227,27 @@ bool CMainApplication::BInitVulkanDevice()
 		}
 	}
 
+	// Devices that expose VK_KHX_multiview always support the multiview feature itself
+	if ( m_bMultiview )
+	{
+		bool bMultiviewEnabled = false;
+		for ( uint32_t nEnabledExt = 0; nEnabledExt < nEnabledDeviceExtensionCount; nEnabledExt++ )
+		{
+			if ( stricmp( ppDeviceExtensionNames[ nEnabledExt ], VK_KHX_MULTIVIEW_EXTENSION_NAME ) == 0 )
+			{
+				bMultiviewEnabled = true;
+				break;
+			}
+		}
+		if ( !bMultiviewEnabled )
+		{
+			dprintf( "%s is not available, rendering each eye separately\n", VK_KHX_MULTIVIEW_EXTENSION_NAME );
+			m_bMultiview = false;
+		}
+	}
+	VkPhysicalDeviceMultiviewFeaturesKHX multiviewFeatures = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_FEATURES_KHX };
+	multiviewFeatures.multiview = VK_TRUE;
+
 	// Create the device
 	VkDeviceQueueCreateInfo deviceQueueCreateInfo = { VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO };
 	deviceQueueCreateInfo.queueFamilyIndex = m_nQueueFamilyIndex;
@@ -1064,6 +1261,10 @@ bool CMainApplication::BInitVulkanDevice()
 	deviceCreateInfo.enabledExtensionCount = nEnabledDeviceExtensionCount;
 	deviceCreateInfo.ppEnabledExtensionNames = ppDeviceExtensionNames;
 	deviceCreateInfo.pEnabledFeatures = &m_physicalDeviceFeatures;
+	if ( m_bMultiview )
+	{
+		deviceCreateInfo.pNext = &multiviewFeatures;
+	}
 
 	nResult = vkCreateDevice( m_pPhysicalDevice, &deviceCreateInfo, nullptr, &m_pDevice );
 	if ( nResult != VK_SUCCESS )
@@ -1432,6 +1633,9 @@ bool CMainApplication::BInitVulkan()
 		}
 	}
 
+	if ( !BInitFrameResources() )
+		return false;
+
 	// Command buffer used during resource loading
 	m_currentCommandBuffer = GetCommandBuffer();
 	VkCommandBufferBeginInfo commandBufferBeginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
@@ -1481,6 +1685,10 @@ bool CMainApplication::BInitCompositor()
 		return false;
 	}
 
+	// WaitGetPoses runs on the submit thread without holding m_queueMutex, so it must not touch
+	// the queue. In this mode SubmitFrame does the post present handoff itself instead.
+	vr::VRCompositor()->SetExplicitTimingMode( vr::VRCompositorTimingMode_Explicit_ApplicationPerformsPostPresentHandoff );
+
 	return true;
 }
 
@@ -1519,6 +1727,18 @@ void CMainApplication::Shutdown()
 		vkDestroyCommandPool( m_pDevice, m_pCommandPool, nullptr );
 		vkDestroyDescriptorPool( m_pDevice, m_pDescriptorPool, nullptr );
 
+		for ( uint32_t nFrame = 0; nFrame < k_unFramesInFlight; nFrame++ )
+		{
+			FrameResources_t &frame = m_frames[ nFrame ];
+			for ( uint32_t nCommandBuffer = 0; nCommandBuffer < FRAME_COMMAND_BUFFER_COUNT; nCommandBuffer++ )
+			{
+				vkDestroyCommandPool( m_pDevice, frame.m_pCommandPools[ nCommandBuffer ], nullptr );
+			}
+			vkDestroyFence( m_pDevice, frame.m_pFence, nullptr );
+			vkDestroyBuffer( m_pDevice, frame.m_pControllerAxesVertexBuffer, nullptr );
+			vkFreeMemory( m_pDevice, frame.m_pControllerAxesVertexBufferMemory, nullptr );
+		}
+
 		FramebufferDesc *pFramebufferDescs[2] = { &m_leftEyeDesc, &m_rightEyeDesc };
 		for ( int32_t nFramebuffer = 0; nFramebuffer < 2; nFramebuffer++ )
 		{
@@ -1532,9 +1752,15 @@ void CMainApplication::Shutdown()
 				vkFreeMemory( m_pDevice, pFramebufferDescs[ nFramebuffer ]->m_pDepthStencilDeviceMemory, nullptr );
 				vkDestroyRenderPass( m_pDevice, pFramebufferDescs[ nFramebuffer ]->m_pRenderPass, nullptr );
 				vkDestroyFramebuffer( m_pDevice, pFramebufferDescs[ nFramebuffer ]->m_pFramebuffer, nullptr );
+				for ( uint32_t nView = 0; nView < _countof( pFramebufferDescs[ nFramebuffer ]->m_pViewImageViews ); nView++ )
+				{
+					vkDestroyImageView( m_pDevice, pFramebufferDescs[ nFramebuffer ]->m_pViewImageViews[ nView ], nullptr );
+				}
 			}
 		}
 
+		vkDestroyQueryPool( m_pDevice, m_pTimestampQueryPool, nullptr );
+
 		vkDestroyImageView( m_pDevice, m_pSceneImageView, nullptr );
 		vkDestroyImage( m_pDevice, m_pSceneImage, nullptr );
 		vkFreeMemory( m_pDevice, m_pSceneImageMemory, nullptr );
@@ -1543,20 +1769,13 @@ void CMainApplication::Shutdown()
 		vkDestroySampler( m_pDevice, m_pSceneSampler, nullptr );
 		vkDestroyBuffer( m_pDevice, m_pSceneVertexBuffer, nullptr );
 		vkFreeMemory( m_pDevice, m_pSceneVertexBufferMemory, nullptr );
-		for ( uint32_t nEye = 0; nEye < _countof( m_pSceneConstantBuffer); nEye++ )
-		{
-			vkDestroyBuffer( m_pDevice, m_pSceneConstantBuffer[ nEye ], nullptr );
-			vkFreeMemory( m_pDevice, m_pSceneConstantBufferMemory[ nEye ], nullptr );
-		}
+		m_lateLatchRing.Cleanup();
 	
 		vkDestroyBuffer( m_pDevice, m_pCompanionWindowVertexBuffer, nullptr );
 		vkFreeMemory( m_pDevice, m_pCompanionWindowVertexBufferMemory, nullptr );
 		vkDestroyBuffer( m_pDevice, m_pCompanionWindowIndexBuffer, nullptr );
 		vkFreeMemory( m_pDevice, m_pCompanionWindowIndexBufferMemory, nullptr );
 
-		vkDestroyBuffer( m_pDevice, m_pControllerAxesVertexBuffer, nullptr );
-		vkFreeMemory( m_pDevice, m_pControllerAxesVertexBufferMemory, nullptr );
-
 		vkDestroyPipelineLayout( m_pDevice, m_pPipelineLayout, nullptr );
 		vkDestroyDescriptorSetLayout( m_pDevice, m_pDescriptorSetLayout, nullptr );
 		for ( uint32_t nPSO = 0; nPSO < PSO_COUNT; nPSO++ )
@@ -1623,6 +1842,15 @@ bool CMainApplication::HandleInput()
 		}
 	}
 
+	return bRet;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Processes SteamVR events and controller state. Only called while
+//          the submit thread is idle, so it never overlaps WaitGetPoses.
+//-----------------------------------------------------------------------------
+void CMainApplication::HandleVRInput()
+{
 	// Process SteamVR events
 	vr::VREvent_t event;
 	while( m_pHMD->PollNextEvent( &event, sizeof( event ) ) )
@@ -1639,8 +1867,6 @@ bool CMainApplication::HandleInput()
 			m_rbShowTrackedDevice[ unDevice ] = state.ulButtonPressed == 0;
 		}
 	}
-
-	return bRet;
 }
 
 //-----------------------------------------------------------------------------
@@ -1653,13 +1879,19 @@ void CMainApplication::RunMainLoop()
 	SDL_StartTextInput();
 	SDL_ShowCursor( SDL_DISABLE );
 
+	StartFrameThreads();
+
 	while ( !bQuit )
 	{
+		// Overlaps with the submit thread handing the previous frame to SteamVR.
+		// SteamVR input is handled in RenderFrame once the submit thread is idle.
 		bQuit = HandleInput();
 
 		RenderFrame();
 	}
 
+	StopFrameThreads();
+
 	SDL_StopTextInput();
 }
 
@@ -1690,98 +1922,387 @@ void CMainApplication::ProcessVREvent( const vr::VREvent_t & event )
 }
 
 //-----------------------------------------------------------------------------
-// Purpose:
+// Purpose: Records a frame. The companion window doesn't depend on the poses,
+//          so it is recorded while the submit thread is still in WaitGetPoses
+//          for the previous frame. The eyes are then recorded on their worker
+//          threads and the frame is handed to the submit thread.
 //-----------------------------------------------------------------------------
 void CMainApplication::RenderFrame()
 {
-	if ( m_pHMD )
-	{
-		m_currentCommandBuffer = GetCommandBuffer();
-
-		// Start the command buffer
-		VkCommandBufferBeginInfo commandBufferBeginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
-		commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-		vkBeginCommandBuffer( m_currentCommandBuffer.m_pCommandBuffer, &commandBufferBeginInfo );
-
-		UpdateControllerAxes();
-		RenderStereoTargets();
-		RenderCompanionWindow();
-
-		// End the command buffer
-		vkEndCommandBuffer( m_currentCommandBuffer.m_pCommandBuffer );
-
-		// Submit the command buffer
-		VkPipelineStageFlags nWaitDstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &m_currentCommandBuffer.m_pCommandBuffer;
-		submitInfo.waitSemaphoreCount = 1;
-		submitInfo.pWaitSemaphores = &m_pSwapchainSemaphores[ m_nFrameIndex ];
-		submitInfo.pWaitDstStageMask = &nWaitDstStageMask;
-		vkQueueSubmit( m_pQueue, 1, &submitInfo, m_currentCommandBuffer.m_pFence );
-
-		// Add the command buffer back for later recycling
-		m_commandBuffers.push_front( m_currentCommandBuffer );
-
-		m_currentCommandBuffer.m_pCommandBuffer = VK_NULL_HANDLE;
-		m_currentCommandBuffer.m_pFence = VK_NULL_HANDLE;
-
-		// Submit to SteamVR
-		vr::VRTextureBounds_t bounds;
-		bounds.uMin = 0.0f;
-		bounds.uMax = 1.0f;
-		bounds.vMin = 0.0f;
-		bounds.vMax = 1.0f;
-
-		vr::VRVulkanTextureData_t vulkanData;
-		vulkanData.m_nImage = ( uint64_t ) m_leftEyeDesc.m_pImage;
-		vulkanData.m_pDevice = ( VkDevice_T * ) m_pDevice;
-		vulkanData.m_pPhysicalDevice = ( VkPhysicalDevice_T * ) m_pPhysicalDevice;
-		vulkanData.m_pInstance = ( VkInstance_T *) m_pInstance;
-		vulkanData.m_pQueue = ( VkQueue_T * ) m_pQueue;
-		vulkanData.m_nQueueFamilyIndex = m_nQueueFamilyIndex;
-
-		vulkanData.m_nWidth = m_nRenderWidth;
-		vulkanData.m_nHeight = m_nRenderHeight;
-		vulkanData.m_nFormat = VK_FORMAT_R8G8B8A8_SRGB;
-		vulkanData.m_nSampleCount = m_nMSAASampleCount;
-
-		vr::Texture_t texture = { &vulkanData, vr::TextureType_Vulkan, vr::ColorSpace_Auto };
-		vr::VRCompositor()->Submit( vr::Eye_Left, &texture, &bounds );
-		
-		vulkanData.m_nImage = ( uint64_t ) m_rightEyeDesc.m_pImage;
-		vr::VRCompositor()->Submit( vr::Eye_Right, &texture, &bounds );
+	if ( !m_pHMD )
+		return;
+
+	// Reclaim the resources this frame slot last used
+	FrameResources_t *pFrame = &m_frames[ m_ulFrameNumber % k_unFramesInFlight ];
+	vkWaitForFences( m_pDevice, 1, &pFrame->m_pFence, VK_TRUE, UINT64_MAX );
+	vkResetFences( m_pDevice, 1, &pFrame->m_pFence );
+	UpdateStereoPassStats( pFrame );
+	for ( uint32_t nCommandBuffer = 0; nCommandBuffer < FRAME_COMMAND_BUFFER_COUNT; nCommandBuffer++ )
+	{
+		vkResetCommandPool( m_pDevice, pFrame->m_pCommandPools[ nCommandBuffer ], 0 );
 	}
+	pFrame->m_vecDrawnRenderModels[ vr::Eye_Left ].clear();
+	pFrame->m_vecDrawnRenderModels[ vr::Eye_Right ].clear();
+	memset( pFrame->m_unDrawCalls, 0, sizeof( pFrame->m_unDrawCalls ) );
+	pFrame->m_pSwapchainSemaphore = m_pSwapchainSemaphores[ m_nFrameIndex ];
 
-	VkPresentInfoKHR presentInfo = { VK_STRUCTURE_TYPE_PRESENT_INFO_KHR };
-	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-	presentInfo.pNext = NULL;
-	presentInfo.swapchainCount = 1;
-	presentInfo.pSwapchains = &m_pSwapchain;
-	presentInfo.pImageIndices = &m_nCurrentSwapchainImage;
-	vkQueuePresentKHR( m_pQueue, &presentInfo );
+	RenderCompanionWindow( pFrame );
+
+	// Wait for the submit thread to return from WaitGetPoses after the previous frame
+	{
+		std::unique_lock< std::mutex > lock( m_frameMutex );
+		while ( m_ulPosesReady < m_ulFrameNumber )
+		{
+			m_frameCondition.wait( lock );
+		}
+	}
+
+	// The submit thread now waits for this frame, so OpenVR can be called from here
+	HandleVRInput();
 
 	// Spew out the controller and pose count whenever they change.
 	if ( m_iTrackedControllerCount != m_iTrackedControllerCount_Last || m_iValidPoseCount != m_iValidPoseCount_Last )
 	{
 		m_iValidPoseCount_Last = m_iValidPoseCount;
 		m_iTrackedControllerCount_Last = m_iTrackedControllerCount;
-		
+
 		dprintf( "PoseCount:%d(%s) Controllers:%d\n", m_iValidPoseCount, m_strPoseClasses.c_str(), m_iTrackedControllerCount );
 	}
 
-	UpdateHMDMatrixPose();
+	m_lateLatchRing.BeginFrame( m_pHMD, m_rTrackedDevicePose[ vr::k_unTrackedDeviceIndex_Hmd ] );
+
+	UpdateControllerAxes( pFrame );
+
+	// Start the eye workers
+	{
+		std::lock_guard< std::mutex > lock( m_frameMutex );
+		m_pRecordFrame = pFrame;
+		m_unEyesRecorded = 0;
+		m_ulRecordGeneration++;
+	}
+	m_frameCondition.notify_all();
+
+	// Wait for the eyes and hand the frame to the submit thread
+	{
+		std::unique_lock< std::mutex > lock( m_frameMutex );
+		while ( m_unEyesRecorded < 2 )
+		{
+			m_frameCondition.wait( lock );
+		}
 
+		// The companion window command buffer leaves both eye images ready for SteamVR
+		m_leftEyeDesc.m_nImageLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		m_rightEyeDesc.m_nImageLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+		pFrame->m_bStatsPending = m_bPerf;
+		m_pSubmitFrame = pFrame;
+	}
+	m_frameCondition.notify_all();
+
+	m_ulFrameNumber++;
 	m_nFrameIndex = ( m_nFrameIndex + 1 ) % m_swapchainImages.size();
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Creates the command pools, command buffers and fence of each
+//          frame in flight
+//-----------------------------------------------------------------------------
+bool CMainApplication::BInitFrameResources()
+{
+	VkResult nResult;
+	for ( uint32_t nFrame = 0; nFrame < k_unFramesInFlight; nFrame++ )
+	{
+		FrameResources_t &frame = m_frames[ nFrame ];
+		for ( uint32_t nCommandBuffer = 0; nCommandBuffer < FRAME_COMMAND_BUFFER_COUNT; nCommandBuffer++ )
+		{
+			// The pool is reset as a whole once the frame's fence has signaled
+			VkCommandPoolCreateInfo commandPoolCreateInfo = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+			commandPoolCreateInfo.queueFamilyIndex = m_nQueueFamilyIndex;
+			commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+			nResult = vkCreateCommandPool( m_pDevice, &commandPoolCreateInfo, nullptr, &frame.m_pCommandPools[ nCommandBuffer ] );
+			if ( nResult != VK_SUCCESS )
+			{
+				dprintf( "vkCreateCommandPool returned error %d.", nResult );
+				return false;
+			}
+
+			VkCommandBufferAllocateInfo commandBufferAllocateInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+			commandBufferAllocateInfo.commandBufferCount = 1;
+			commandBufferAllocateInfo.commandPool = frame.m_pCommandPools[ nCommandBuffer ];
+			commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			nResult = vkAllocateCommandBuffers( m_pDevice, &commandBufferAllocateInfo, &frame.m_pCommandBuffers[ nCommandBuffer ] );
+			if ( nResult != VK_SUCCESS )
+			{
+				dprintf( "vkAllocateCommandBuffers returned error %d.", nResult );
+				return false;
+			}
+		}
+
+		// Created signaled so the first use of the frame doesn't wait
+		VkFenceCreateInfo fenceCreateInfo = { VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+		fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+		nResult = vkCreateFence( m_pDevice, &fenceCreateInfo, nullptr, &frame.m_pFence );
+		if ( nResult != VK_SUCCESS )
+		{
+			dprintf( "vkCreateFence returned error %d.", nResult );
+			return false;
+		}
+	}
+
+	if ( m_bPerf )
+	{
+		if ( m_unTimestampValidBits == 0 )
+		{
+			dprintf( "The graphics queue has no timestamps, -perf only counts draw calls\n" );
+			return true;
+		}
+
+		VkQueryPoolCreateInfo queryPoolCreateInfo = { VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+		queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryPoolCreateInfo.queryCount = k_unFramesInFlight * 2;
+		nResult = vkCreateQueryPool( m_pDevice, &queryPoolCreateInfo, nullptr, &m_pTimestampQueryPool );
+		if ( nResult != VK_SUCCESS )
+		{
+			dprintf( "vkCreateQueryPool returned error %d.", nResult );
+			return false;
+		}
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Starts the eye workers and the submit thread
+//-----------------------------------------------------------------------------
+void CMainApplication::StartFrameThreads()
+{
+	m_bQuitFrameThreads = false;
+	m_eyeWorkerThreads[ vr::Eye_Left ] = std::thread( &CMainApplication::EyeWorkerThread, this, vr::Eye_Left );
+	m_eyeWorkerThreads[ vr::Eye_Right ] = std::thread( &CMainApplication::EyeWorkerThread, this, vr::Eye_Right );
+	m_submitThread = std::thread( &CMainApplication::SubmitThread, this );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Stops the frame threads once the last frame has been submitted
+//-----------------------------------------------------------------------------
+void CMainApplication::StopFrameThreads()
+{
+	{
+		std::lock_guard< std::mutex > lock( m_frameMutex );
+		m_bQuitFrameThreads = true;
+	}
+	m_frameCondition.notify_all();
+
+	if ( m_submitThread.joinable() )
+		m_submitThread.join();
+
+	for ( uint32_t nEye = 0; nEye < 2; nEye++ )
+	{
+		if ( m_eyeWorkerThreads[ nEye ].joinable() )
+			m_eyeWorkerThreads[ nEye ].join();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Records nEye's command buffer each time RenderFrame asks for it
+//-----------------------------------------------------------------------------
+void CMainApplication::EyeWorkerThread( vr::EVREye nEye )
+{
+	uint64_t ulRecordedGeneration = 0;
+
+	std::unique_lock< std::mutex > lock( m_frameMutex );
+	for ( ;; )
+	{
+		while ( !m_bQuitFrameThreads && m_ulRecordGeneration == ulRecordedGeneration )
+		{
+			m_frameCondition.wait( lock );
+		}
+		if ( m_bQuitFrameThreads )
+			return;
+
+		ulRecordedGeneration = m_ulRecordGeneration;
+		FrameResources_t *pFrame = m_pRecordFrame;
+
+		lock.unlock();
+		RenderEye( nEye, pFrame );
+		lock.lock();
+
+		m_unEyesRecorded++;
+		m_frameCondition.notify_all();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Submits each frame RenderFrame hands over. It keeps going after
+//          StopFrameThreads until the frame it was given is out.
+//-----------------------------------------------------------------------------
+void CMainApplication::SubmitThread()
+{
+	std::unique_lock< std::mutex > lock( m_frameMutex );
+	for ( ;; )
+	{
+		while ( !m_bQuitFrameThreads && m_pSubmitFrame == NULL )
+		{
+			m_frameCondition.wait( lock );
+		}
+		if ( m_pSubmitFrame == NULL )
+			return;
+
+		FrameResources_t *pFrame = m_pSubmitFrame;
+
+		lock.unlock();
+		SubmitFrame( pFrame );
+		lock.lock();
+
+		m_pSubmitFrame = NULL;
+		m_ulPosesReady++;
+		m_frameCondition.notify_all();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Runs on the submit thread. Latches the head pose, submits the
+//          frame to the GPU, SteamVR and the companion window, then waits
+//          for the poses the next frame is rendered with. The queue is only
+//          locked for the submission, not for WaitGetPoses.
+//-----------------------------------------------------------------------------
+void CMainApplication::SubmitFrame( FrameResources_t *pFrame )
+{
+	// Host writes made before vkQueueSubmit are visible to the submitted work, so this
+	// is the last moment the recorded commands can pick up a fresher head pose
+	bool bLatched = m_bLateLatch && m_lateLatchRing.Latch();
+	if ( bLatched )
+	{
+		LatchRenderModelTransforms( pFrame );
+	}
+
+	// SteamVR uses the queue from Submit and PostPresentHandoff as well
+	std::unique_lock< std::mutex > queueLock( m_queueMutex );
+	vr::VRCompositor()->SubmitExplicitTimingData();
+
+	// The eyes don't need the companion window image, so only its command buffer waits for it.
+	// The fence signals once both batches are done.
+	VkPipelineStageFlags nWaitDstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	VkSubmitInfo submitInfos[ 2 ] = { { VK_STRUCTURE_TYPE_SUBMIT_INFO }, { VK_STRUCTURE_TYPE_SUBMIT_INFO } };
+	submitInfos[ 0 ].commandBufferCount = m_bMultiview ? 1 : FRAME_COMMAND_BUFFER_COMPANION;
+	submitInfos[ 0 ].pCommandBuffers = &pFrame->m_pCommandBuffers[ FRAME_COMMAND_BUFFER_LEFT_EYE ];
+	submitInfos[ 1 ].commandBufferCount = 1;
+	submitInfos[ 1 ].pCommandBuffers = &pFrame->m_pCommandBuffers[ FRAME_COMMAND_BUFFER_COMPANION ];
+	if ( pFrame->m_bSwapchainImageAcquired )
+	{
+		submitInfos[ 1 ].waitSemaphoreCount = 1;
+		submitInfos[ 1 ].pWaitSemaphores = &pFrame->m_pSwapchainSemaphore;
+		submitInfos[ 1 ].pWaitDstStageMask = &nWaitDstStageMask;
+	}
+	vkQueueSubmit( m_pQueue, _countof( submitInfos ), &submitInfos[ 0 ], pFrame->m_pFence );
+
+	// Submit to SteamVR
+	vr::VRTextureBounds_t bounds;
+	bounds.uMin = 0.0f;
+	bounds.uMax = 1.0f;
+	bounds.vMin = 0.0f;
+	bounds.vMax = 1.0f;
+
+	vr::VRVulkanTextureArrayData_t vulkanData;
+	vulkanData.m_nImage = ( uint64_t ) m_leftEyeDesc.m_pImage;
+	vulkanData.m_pDevice = ( VkDevice_T * ) m_pDevice;
+	vulkanData.m_pPhysicalDevice = ( VkPhysicalDevice_T * ) m_pPhysicalDevice;
+	vulkanData.m_pInstance = ( VkInstance_T *) m_pInstance;
+	vulkanData.m_pQueue = ( VkQueue_T * ) m_pQueue;
+	vulkanData.m_nQueueFamilyIndex = m_nQueueFamilyIndex;
+
+	vulkanData.m_nWidth = m_nRenderWidth;
+	vulkanData.m_nHeight = m_nRenderHeight;
+	vulkanData.m_nFormat = VK_FORMAT_R8G8B8A8_SRGB;
+	vulkanData.m_nSampleCount = m_nMSAASampleCount;
+
+	// With multiview each eye is a layer of the left eye's image
+	vulkanData.m_unArrayIndex = vr::Eye_Left;
+	vulkanData.m_unArraySize = m_leftEyeDesc.m_nViewCount;
+	vr::EVRSubmitFlags nSubmitFlags = m_bMultiview ? vr::Submit_VulkanTextureWithArrayData : vr::Submit_Default;
+
+	vr::Texture_t texture = { &vulkanData, vr::TextureType_Vulkan, vr::ColorSpace_Auto };
+	if ( bLatched )
+	{
+		// tell the compositor which pose the latched frame was rendered with
+		vr::VRTextureWithPose_t textureWithPose;
+		m_lateLatchRing.FillTextureWithPose( texture, &textureWithPose );
+		nSubmitFlags = ( vr::EVRSubmitFlags )( nSubmitFlags | vr::Submit_TextureWithPose );
+		vr::VRCompositor()->Submit( vr::Eye_Left, &textureWithPose, &bounds, nSubmitFlags );
+
+		if ( m_bMultiview )
+			vulkanData.m_unArrayIndex = vr::Eye_Right;
+		else
+			vulkanData.m_nImage = ( uint64_t ) m_rightEyeDesc.m_pImage;
+		vr::VRCompositor()->Submit( vr::Eye_Right, &textureWithPose, &bounds, nSubmitFlags );
+	}
+	else
+	{
+		vr::VRCompositor()->Submit( vr::Eye_Left, &texture, &bounds, nSubmitFlags );
+
+		if ( m_bMultiview )
+			vulkanData.m_unArrayIndex = vr::Eye_Right;
+		else
+			vulkanData.m_nImage = ( uint64_t ) m_rightEyeDesc.m_pImage;
+		vr::VRCompositor()->Submit( vr::Eye_Right, &texture, &bounds, nSubmitFlags );
+	}
+
+	if ( pFrame->m_bSwapchainImageAcquired )
+	{
+		VkPresentInfoKHR presentInfo = { VK_STRUCTURE_TYPE_PRESENT_INFO_KHR };
+		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+		presentInfo.pNext = NULL;
+		presentInfo.swapchainCount = 1;
+		presentInfo.pSwapchains = &m_pSwapchain;
+		presentInfo.pImageIndices = &pFrame->m_nSwapchainImage;
+		vkQueuePresentKHR( m_pQueue, &presentInfo );
+	}
+
+	vr::VRCompositor()->PostPresentHandoff();
+	queueLock.unlock();
+
+	UpdateHMDMatrixPose();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Adds the draw calls and GPU time of the last frame pFrame held to
+//          the -perf averages. Called once its fence has signaled, so reading
+//          the timestamps never waits.
+//-----------------------------------------------------------------------------
+void CMainApplication::UpdateStereoPassStats( FrameResources_t *pFrame )
+{
+	if ( !pFrame->m_bStatsPending )
+		return;
+	pFrame->m_bStatsPending = false;
+
+	m_stereoPassStats.AddDrawCalls( pFrame->m_unDrawCalls[ vr::Eye_Left ] + pFrame->m_unDrawCalls[ vr::Eye_Right ] );
+
+	if ( m_pTimestampQueryPool != VK_NULL_HANDLE )
+	{
+		uint64_t ulTimestamps[ 2 ] = { 0, 0 };
+		VkResult nResult = vkGetQueryPoolResults( m_pDevice, m_pTimestampQueryPool, pFrame->m_unIndex * 2, 2, sizeof( ulTimestamps ), ulTimestamps, sizeof( uint64_t ), VK_QUERY_RESULT_64_BIT );
+		if ( nResult == VK_SUCCESS )
+		{
+			uint64_t ulValidMask = ( m_unTimestampValidBits < 64 ) ? ( ( 1ull << m_unTimestampValidBits ) - 1 ) : ~0ull;
+			uint64_t ulTicks = ( ulTimestamps[ 1 ] - ulTimestamps[ 0 ] ) & ulValidMask;
+			m_stereoPassStats.AddGpuTime( ( float )( ulTicks * m_physicalDeviceProperties.limits.timestampPeriod / 1000000.0 ) );
+		}
+	}
+
+	StereoPassReport_t report;
+	if ( m_stereoPassStats.BGetReport( &report ) )
+	{
+		dprintf( "%s: %.1f draw calls, %.3fms GPU per frame\n", m_bMultiview ? "Multiview" : "Per eye",
+			report.flDrawCallsPerFrame, report.flGpuMsPerFrame );
+	}
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: Creates all the shaders used by HelloVR Vulkan
 //-----------------------------------------------------------------------------
 bool CMainApplication::CreateAllShaders()
 {
 	VkResult nResult;
-	std::string sExecutableDirectory = Path_StripFilename( Path_GetExecutablePath() );
 	
 	const char *pShaderNames[ PSO_COUNT ] =
 	{
@@ -1790,6 +2311,13 @@ bool CMainApplication::CreateAllShaders()
 		"rendermodel",
 		"companion"
 	};
+	if ( m_bMultiview )
+	{
+		// These draw both eyes in one pass, picking the transform by view index
+		pShaderNames[ PSO_SCENE ] = "scene_multiview";
+		pShaderNames[ PSO_AXES ] = "axes_multiview";
+		pShaderNames[ PSO_RENDERMODEL ] = "rendermodel_multiview";
+	}
 	const char *pStageNames[ 2 ] =
 	{
 		"vs",
@@ -1801,9 +2329,7 @@ bool CMainApplication::CreateAllShaders()
 	{
 		for ( int32_t nStage = 0; nStage <= 1; nStage++ )
 		{
-			char shaderFileName[ 1024 ];
-			sprintf( shaderFileName, "../shaders/%s_%s.spv", pShaderNames[ nShader ], pStageNames[ nStage ] );
-			std::string shaderPath =  Path_MakeAbsolute( shaderFileName, sExecutableDirectory );
+			std::string shaderPath = GetShaderPath( pShaderNames[ nShader ], pStageNames[ nStage ] );
 
 			FILE *fp = fopen( shaderPath.c_str(), "rb" );
 			if ( fp == NULL )
@@ -1840,7 +2366,7 @@ bool CMainApplication::CreateAllShaders()
 
 	// Create a descriptor set layout/pipeline layout compatible with all of our shaders.  See bin/shaders/build_vulkan_shaders.bat for
 	// how the HLSL is compiled with glslangValidator and binding numbers are generated
-	VkDescriptorSetLayoutBinding layoutBindings[3] = {};
+	VkDescriptorSetLayoutBinding layoutBindings[4] = {};
 	layoutBindings[0].binding = 0;
 	layoutBindings[0].descriptorCount = 1;
 	layoutBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
@@ -1856,8 +2382,14 @@ bool CMainApplication::CreateAllShaders()
 	layoutBindings[2].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
 	layoutBindings[2].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
+	// The right eye's transform, only read by the multiview shaders
+	layoutBindings[3].binding = 3;
+	layoutBindings[3].descriptorCount = 1;
+	layoutBindings[3].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	layoutBindings[3].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
 	VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
-	descriptorSetLayoutCreateInfo.bindingCount = 3;
+	descriptorSetLayoutCreateInfo.bindingCount = _countof( layoutBindings );
 	descriptorSetLayoutCreateInfo.pBindings = &layoutBindings[ 0 ];
 	nResult = vkCreateDescriptorSetLayout( m_pDevice, &descriptorSetLayoutCreateInfo, nullptr, &m_pDescriptorSetLayout );
 	if ( nResult != VK_SUCCESS )
@@ -2045,7 +2577,7 @@ bool CMainApplication::CreateAllShaders()
 void CMainApplication::CreateAllDescriptorSets()
 {
 	VkDescriptorPoolSize poolSizes[ 3 ];
-	poolSizes[ 0 ].descriptorCount = NUM_DESCRIPTOR_SETS;
+	poolSizes[ 0 ].descriptorCount = NUM_DESCRIPTOR_SETS * 2;
 	poolSizes[ 0 ].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
 	poolSizes[ 1 ].descriptorCount = NUM_DESCRIPTOR_SETS;
 	poolSizes[ 1 ].type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
@@ -2069,13 +2601,11 @@ void CMainApplication::CreateAllDescriptorSets()
 		vkAllocateDescriptorSets( m_pDevice, &allocInfo, &m_pDescriptorSets[ nDescriptorSet ] );
 	}
 
-	// Scene descriptor sets
-	for ( uint32_t nEye = 0; nEye < 2; nEye++ )
+	// Scene descriptor sets, each pointing at one late latch slot's matrix
+	for ( uint32_t nSceneSet = 0; nSceneSet <= DESCRIPTOR_SET_SCENE_MAX - DESCRIPTOR_SET_SCENE0; nSceneSet++ )
 	{
-		VkDescriptorBufferInfo bufferInfo = {};
-		bufferInfo.buffer = m_pSceneConstantBuffer[ nEye ];
-		bufferInfo.offset = 0;
-		bufferInfo.range = VK_WHOLE_SIZE;
+		VkDescriptorBufferInfo bufferInfo = m_lateLatchRing.GetBufferInfo( nSceneSet / 2, ( vr::EVREye )( nSceneSet % 2 ) );
+		VkDescriptorBufferInfo rightBufferInfo = m_lateLatchRing.GetBufferInfo( nSceneSet / 2, vr::Eye_Right );
 		
 		VkDescriptorImageInfo imageInfo = {};
 		imageInfo.imageView = m_pSceneImageView;
@@ -2084,33 +2614,39 @@ void CMainApplication::CreateAllDescriptorSets()
 		VkDescriptorImageInfo samplerInfo = {};
 		samplerInfo.sampler = m_pSceneSampler;
 
-		VkWriteDescriptorSet writeDescriptorSets[ 3 ] = { };
+		VkWriteDescriptorSet writeDescriptorSets[ 4 ] = { };
 		writeDescriptorSets[ 0 ].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		writeDescriptorSets[ 0 ].dstSet = m_pDescriptorSets[ DESCRIPTOR_SET_LEFT_EYE_SCENE + nEye ];
+		writeDescriptorSets[ 0 ].dstSet = m_pDescriptorSets[ DESCRIPTOR_SET_SCENE0 + nSceneSet ];
 		writeDescriptorSets[ 0 ].dstBinding = 0;
 		writeDescriptorSets[ 0 ].descriptorCount = 1;
 		writeDescriptorSets[ 0 ].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
 		writeDescriptorSets[ 0 ].pBufferInfo = &bufferInfo;
 		writeDescriptorSets[ 1 ].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		writeDescriptorSets[ 1 ].dstSet = m_pDescriptorSets[ DESCRIPTOR_SET_LEFT_EYE_SCENE + nEye ];
+		writeDescriptorSets[ 1 ].dstSet = m_pDescriptorSets[ DESCRIPTOR_SET_SCENE0 + nSceneSet ];
 		writeDescriptorSets[ 1 ].dstBinding = 1;
 		writeDescriptorSets[ 1 ].descriptorCount = 1;
 		writeDescriptorSets[ 1 ].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
 		writeDescriptorSets[ 1 ].pImageInfo = &imageInfo;
 		writeDescriptorSets[ 2 ].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		writeDescriptorSets[ 2 ].dstSet = m_pDescriptorSets[ DESCRIPTOR_SET_LEFT_EYE_SCENE + nEye ];
+		writeDescriptorSets[ 2 ].dstSet = m_pDescriptorSets[ DESCRIPTOR_SET_SCENE0 + nSceneSet ];
 		writeDescriptorSets[ 2 ].dstBinding = 2;
 		writeDescriptorSets[ 2 ].descriptorCount = 1;
 		writeDescriptorSets[ 2 ].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
 		writeDescriptorSets[ 2 ].pImageInfo = &samplerInfo;
+		writeDescriptorSets[ 3 ].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writeDescriptorSets[ 3 ].dstSet = m_pDescriptorSets[ DESCRIPTOR_SET_SCENE0 + nSceneSet ];
+		writeDescriptorSets[ 3 ].dstBinding = 3;
+		writeDescriptorSets[ 3 ].descriptorCount = 1;
+		writeDescriptorSets[ 3 ].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		writeDescriptorSets[ 3 ].pBufferInfo = &rightBufferInfo;
 		
 		vkUpdateDescriptorSets( m_pDevice, _countof( writeDescriptorSets ), writeDescriptorSets, 0, nullptr );
 	}
 
-	// Companion window descriptor sets
+	// Companion window descriptor sets, which read a single layer when both eyes share an image
 	{
 		VkDescriptorImageInfo imageInfo = {};
-		imageInfo.imageView = m_leftEyeDesc.m_pImageView;
+		imageInfo.imageView = m_bMultiview ? m_leftEyeDesc.m_pViewImageViews[ vr::Eye_Left ] : m_leftEyeDesc.m_pImageView;
 		imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
 		VkWriteDescriptorSet writeDescriptorSets[ 1 ] = { };
@@ -2122,7 +2658,7 @@ void CMainApplication::CreateAllDescriptorSets()
 		writeDescriptorSets[ 0 ].pImageInfo = &imageInfo;
 		vkUpdateDescriptorSets( m_pDevice, _countof( writeDescriptorSets ), writeDescriptorSets, 0, nullptr );
 
-		imageInfo.imageView = m_rightEyeDesc.m_pImageView;
+		imageInfo.imageView = m_bMultiview ? m_leftEyeDesc.m_pViewImageViews[ vr::Eye_Right ] : m_rightEyeDesc.m_pImageView;
 		writeDescriptorSets[ 0 ].dstSet = m_pDescriptorSets[ DESCRIPTOR_SET_COMPANION_RIGHT_TEXTURE ];
 		vkUpdateDescriptorSets( m_pDevice, _countof( writeDescriptorSets ), writeDescriptorSets, 0, nullptr );
 	}
@@ -2368,26 +2904,10 @@ void CMainApplication::SetupScene()
 		return;
 	}
 	
-	// Create constant buffer to hold the per-eye CB data
-	for ( uint32_t nEye = 0; nEye < 2; nEye++ )
+	// Create the ring of per-eye view projection matrices the scene descriptor sets point into
+	if ( !m_lateLatchRing.BInit( m_pDevice, m_physicalDeviceMemoryProperties, m_physicalDeviceProperties ) )
 	{
-		VkBufferCreateInfo bufferCreateInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
-		bufferCreateInfo.size = sizeof( Matrix4 );
-		bufferCreateInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-		vkCreateBuffer( m_pDevice, &bufferCreateInfo, nullptr, &m_pSceneConstantBuffer[ nEye ] );
-
-		VkMemoryRequirements memoryRequirements = { };
-		vkGetBufferMemoryRequirements( m_pDevice, m_pSceneConstantBuffer[ nEye ], &memoryRequirements );
-
-		VkMemoryAllocateInfo allocInfo = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
-		MemoryTypeFromProperties( m_physicalDeviceMemoryProperties, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT, &allocInfo.memoryTypeIndex );
-		allocInfo.allocationSize = memoryRequirements.size;
-
-		vkAllocateMemory( m_pDevice, &allocInfo, nullptr, &m_pSceneConstantBufferMemory[ nEye ] );
-		vkBindBufferMemory( m_pDevice, m_pSceneConstantBuffer[ nEye ], m_pSceneConstantBufferMemory[ nEye ], 0 );
-
-		// Map and keep mapped persistently
-		vkMapMemory( m_pDevice, m_pSceneConstantBufferMemory[ nEye ], 0, VK_WHOLE_SIZE, 0, &m_pSceneConstantBufferData[ nEye ] );
+		dprintf( "Unable to create the late latch uniform buffer\n" );
 	}
 }
 
@@ -2466,7 +2986,7 @@ void CMainApplication::AddCubeToScene( Matrix4 mat, std::vector<float> &vertdata
 //-----------------------------------------------------------------------------
 // Purpose: Update the vertex data for the controllers as X/Y/Z lines
 //-----------------------------------------------------------------------------
-void CMainApplication::UpdateControllerAxes()
+void CMainApplication::UpdateControllerAxes( FrameResources_t *pFrame )
 {
 	// Don't attempt to update controllers if input is not available
 	if( !m_pHMD->IsInputAvailable() )
@@ -2474,7 +2994,7 @@ void CMainApplication::UpdateControllerAxes()
 
 	std::vector<float> vertdataarray;
 
-	m_uiControllerVertcount = 0;
+	pFrame->m_uiControllerVertcount = 0;
 	m_iTrackedControllerCount = 0;
 
 	for ( vr::TrackedDeviceIndex_t unTrackedDevice = vr::k_unTrackedDeviceIndex_Hmd + 1; unTrackedDevice < vr::k_unMaxTrackedDeviceCount; ++unTrackedDevice )
@@ -2517,7 +3037,7 @@ void CMainApplication::UpdateControllerAxes()
 			vertdataarray.push_back( color.y );
 			vertdataarray.push_back( color.z );
 		
-			m_uiControllerVertcount += 2;
+			pFrame->m_uiControllerVertcount += 2;
 		}
 
 		Vector4 start = mat * Vector4( 0, 0, -0.02f, 1 );
@@ -2529,38 +3049,38 @@ void CMainApplication::UpdateControllerAxes()
 
 		vertdataarray.push_back( end.x );vertdataarray.push_back( end.y );vertdataarray.push_back( end.z );
 		vertdataarray.push_back( color.x );vertdataarray.push_back( color.y );vertdataarray.push_back( color.z );
-		m_uiControllerVertcount += 2;
+		pFrame->m_uiControllerVertcount += 2;
 	}
 
-	// Setup the VB the first time through.
-	if ( m_pControllerAxesVertexBuffer == VK_NULL_HANDLE && vertdataarray.size() > 0 )
+	// Setup the VB the first time through. Each frame in flight has its own.
+	if ( pFrame->m_pControllerAxesVertexBuffer == VK_NULL_HANDLE && vertdataarray.size() > 0 )
 	{
 		// Make big enough to hold up to the max number
 		VkDeviceSize nSize = sizeof( float ) * vertdataarray.size();
 		nSize *= vr::k_unMaxTrackedDeviceCount;
 
 		if ( !CreateVulkanBuffer( m_pDevice, m_physicalDeviceMemoryProperties, nullptr, nSize,
-								  VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &m_pControllerAxesVertexBuffer, &m_pControllerAxesVertexBufferMemory ) )
+								  VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &pFrame->m_pControllerAxesVertexBuffer, &pFrame->m_pControllerAxesVertexBufferMemory ) )
 		{
 			return;
 		}
 	}
 
 	// Update the VB data
-	if ( m_pControllerAxesVertexBuffer != VK_NULL_HANDLE && vertdataarray.size() > 0 )
+	if ( pFrame->m_pControllerAxesVertexBuffer != VK_NULL_HANDLE && vertdataarray.size() > 0 )
 	{
 		void *pData;
-		VkResult nResult = vkMapMemory( m_pDevice, m_pControllerAxesVertexBufferMemory, 0, VK_WHOLE_SIZE, 0, &pData );
+		VkResult nResult = vkMapMemory( m_pDevice, pFrame->m_pControllerAxesVertexBufferMemory, 0, VK_WHOLE_SIZE, 0, &pData );
 		if ( nResult != VK_SUCCESS )
 		{
 			dprintf( "vkMapMemory returned error %d\n", nResult );
 			return;
 		}
 		memcpy( pData, &vertdataarray[ 0 ], vertdataarray.size() * sizeof( float ) );
-		vkUnmapMemory( m_pDevice, m_pControllerAxesVertexBufferMemory );
+		vkUnmapMemory( m_pDevice, pFrame->m_pControllerAxesVertexBufferMemory );
 
 		VkMappedMemoryRange memoryRange = { VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE };
-		memoryRange.memory = m_pControllerAxesVertexBufferMemory;
+		memoryRange.memory = pFrame->m_pControllerAxesVertexBufferMemory;
 		memoryRange.size = VK_WHOLE_SIZE;
 		vkFlushMappedMemoryRanges( m_pDevice, 1, &memoryRange );
 	}
@@ -2575,13 +3095,16 @@ void CMainApplication::SetupCameras()
 	m_mat4ProjectionRight = GetHMDMatrixProjectionEye( vr::Eye_Right );
 	m_mat4eyePosLeft = GetHMDMatrixPoseEye( vr::Eye_Left );
 	m_mat4eyePosRight = GetHMDMatrixPoseEye( vr::Eye_Right );
+
+	m_lateLatchRing.SetEyeTransforms( m_mat4ProjectionLeft * m_mat4eyePosLeft, m_mat4ProjectionRight * m_mat4eyePosRight );
 }
 
 //-----------------------------------------------------------------------------
 // Purpose: Creates a frame buffer. Returns true if the buffer was set up.
-//          Returns false if the setup failed.
+//          Returns false if the setup failed. With nViewCount 2 the images
+//          have a layer per eye and the render pass draws both with multiview.
 //-----------------------------------------------------------------------------
-bool CMainApplication::CreateFrameBuffer( int nWidth, int nHeight, FramebufferDesc &framebufferDesc )
+bool CMainApplication::CreateFrameBuffer( int nWidth, int nHeight, uint32_t nViewCount, FramebufferDesc &framebufferDesc )
 {
 	//---------------------------//
 	//    Create color target    //
@@ -2592,7 +3115,7 @@ bool CMainApplication::CreateFrameBuffer( int nWidth, int nHeight, FramebufferDe
 	imageCreateInfo.extent.height = nHeight;
 	imageCreateInfo.extent.depth = 1;
 	imageCreateInfo.mipLevels = 1;
-	imageCreateInfo.arrayLayers = 1;
+	imageCreateInfo.arrayLayers = nViewCount;
 	imageCreateInfo.format = VK_FORMAT_R8G8B8A8_SRGB;
 	imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
 	imageCreateInfo.samples = ( VkSampleCountFlagBits ) m_nMSAASampleCount;
@@ -2634,14 +3157,14 @@ bool CMainApplication::CreateFrameBuffer( int nWidth, int nHeight, FramebufferDe
 	VkImageViewCreateInfo imageViewCreateInfo = { VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
 	imageViewCreateInfo.flags = 0;
 	imageViewCreateInfo.image = framebufferDesc.m_pImage;
-	imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	imageViewCreateInfo.viewType = ( nViewCount > 1 ) ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
 	imageViewCreateInfo.format = imageCreateInfo.format;
 	imageViewCreateInfo.components = { VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY };
 	imageViewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 	imageViewCreateInfo.subresourceRange.baseMipLevel = 0;
 	imageViewCreateInfo.subresourceRange.levelCount = 1;
 	imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
-	imageViewCreateInfo.subresourceRange.layerCount = 1;
+	imageViewCreateInfo.subresourceRange.layerCount = nViewCount;
 	nResult = vkCreateImageView( m_pDevice, &imageViewCreateInfo, nullptr, &framebufferDesc.m_pImageView );
 	if ( nResult != VK_SUCCESS )
 	{
@@ -2649,6 +3172,21 @@ bool CMainApplication::CreateFrameBuffer( int nWidth, int nHeight, FramebufferDe
 		return false;
 	}
 
+	// The companion window samples each eye's layer on its own
+	for ( uint32_t nView = 0; nView < nViewCount && nViewCount > 1; nView++ )
+	{
+		VkImageViewCreateInfo viewImageViewCreateInfo = imageViewCreateInfo;
+		viewImageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewImageViewCreateInfo.subresourceRange.baseArrayLayer = nView;
+		viewImageViewCreateInfo.subresourceRange.layerCount = 1;
+		nResult = vkCreateImageView( m_pDevice, &viewImageViewCreateInfo, nullptr, &framebufferDesc.m_pViewImageViews[ nView ] );
+		if ( nResult != VK_SUCCESS )
+		{
+			dprintf( "vkCreateImageView failed with error %d\n", nResult );
+			return false;
+		}
+	}
+
 	//-----------------------------------//
 	//    Create depth/stencil target    //
 	//-----------------------------------//
@@ -2745,6 +3283,18 @@ bool CMainApplication::CreateFrameBuffer( int nWidth, int nHeight, FramebufferDe
 	renderPassCreateInfo.dependencyCount = 0;
 	renderPassCreateInfo.pDependencies = NULL;
 
+	// Broadcast the subpass to every layer, which are close enough to share culling work
+	uint32_t nViewMask = ( 1u << nViewCount ) - 1;
+	VkRenderPassMultiviewCreateInfoKHX multiviewCreateInfo = { VK_STRUCTURE_TYPE_RENDER_PASS_MULTIVIEW_CREATE_INFO_KHX };
+	multiviewCreateInfo.subpassCount = 1;
+	multiviewCreateInfo.pViewMasks = &nViewMask;
+	multiviewCreateInfo.correlationMaskCount = 1;
+	multiviewCreateInfo.pCorrelationMasks = &nViewMask;
+	if ( nViewCount > 1 )
+	{
+		renderPassCreateInfo.pNext = &multiviewCreateInfo;
+	}
+
 	nResult = vkCreateRenderPass( m_pDevice, &renderPassCreateInfo, NULL, &framebufferDesc.m_pRenderPass );
 	if ( nResult != VK_SUCCESS )
 	{
@@ -2770,6 +3320,7 @@ bool CMainApplication::CreateFrameBuffer( int nWidth, int nHeight, FramebufferDe
 
 	framebufferDesc.m_nImageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 	framebufferDesc.m_nDepthStencilImageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	framebufferDesc.m_nViewCount = nViewCount;
 	return true;
 }
 
@@ -2820,8 +3371,13 @@ bool CMainApplication::SetupStereoRenderTargets()
 	m_nRenderWidth = ( uint32_t )( m_flSuperSampleScale * ( float ) m_nRenderWidth );
 	m_nRenderHeight = ( uint32_t )( m_flSuperSampleScale * ( float ) m_nRenderHeight );
 
-	CreateFrameBuffer( m_nRenderWidth, m_nRenderHeight, m_leftEyeDesc );
-	CreateFrameBuffer( m_nRenderWidth, m_nRenderHeight, m_rightEyeDesc );
+	if ( m_bMultiview )
+	{
+		return CreateFrameBuffer( m_nRenderWidth, m_nRenderHeight, 2, m_leftEyeDesc );
+	}
+
+	CreateFrameBuffer( m_nRenderWidth, m_nRenderHeight, 1, m_leftEyeDesc );
+	CreateFrameBuffer( m_nRenderWidth, m_nRenderHeight, 1, m_rightEyeDesc );
 	return true;
 }
 
@@ -2884,54 +3440,70 @@ void CMainApplication::SetupCompanionWindow()
 }
 
 //-----------------------------------------------------------------------------
-// Purpose:
+// Purpose: Records nEye's command buffer. Runs on the eye's worker thread and
+//          only touches that eye's framebuffer and constant buffers. With
+//          multiview the left eye's command buffer draws both eyes.
 //-----------------------------------------------------------------------------
-void CMainApplication::RenderStereoTargets()
+void CMainApplication::RenderEye( vr::EVREye nEye, FrameResources_t *pFrame )
 {
+	if ( m_bMultiview && nEye == vr::Eye_Right )
+		return;
+
+	VkCommandBuffer pCommandBuffer = pFrame->m_pCommandBuffers[ FRAME_COMMAND_BUFFER_LEFT_EYE + nEye ];
+	FramebufferDesc &eyeDesc = ( nEye == vr::Eye_Left ) ? m_leftEyeDesc : m_rightEyeDesc;
+
+	// Start the command buffer
+	VkCommandBufferBeginInfo commandBufferBeginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+	commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer( pCommandBuffer, &commandBufferBeginInfo );
+
+	// The left eye is submitted first, so it opens the frame's timestamp pair
+	if ( m_pTimestampQueryPool != VK_NULL_HANDLE && nEye == vr::Eye_Left )
+	{
+		vkCmdResetQueryPool( pCommandBuffer, m_pTimestampQueryPool, pFrame->m_unIndex * 2, 2 );
+		vkCmdWriteTimestamp( pCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_pTimestampQueryPool, pFrame->m_unIndex * 2 );
+	}
 
 	// Set viewport and scissor
 	VkViewport viewport = { 0.0f, 0.0f, (float ) m_nRenderWidth, ( float ) m_nRenderHeight, 0.0f, 1.0f };
-	vkCmdSetViewport( m_currentCommandBuffer.m_pCommandBuffer, 0, 1, &viewport );
+	vkCmdSetViewport( pCommandBuffer, 0, 1, &viewport );
 	VkRect2D scissor = { 0, 0, m_nRenderWidth, m_nRenderHeight };
-	vkCmdSetScissor( m_currentCommandBuffer.m_pCommandBuffer, 0, 1, &scissor );
+	vkCmdSetScissor( pCommandBuffer, 0, 1, &scissor );
 
-	//----------//
-	// Left Eye //
-	//----------//
 	// Transition eye image to VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
 	VkImageMemoryBarrier imageMemoryBarrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
 	imageMemoryBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
 	imageMemoryBarrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	imageMemoryBarrier.oldLayout = m_leftEyeDesc.m_nImageLayout;
+	imageMemoryBarrier.oldLayout = eyeDesc.m_nImageLayout;
 	imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-	imageMemoryBarrier.image = m_leftEyeDesc.m_pImage;
+	imageMemoryBarrier.image = eyeDesc.m_pImage;
 	imageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 	imageMemoryBarrier.subresourceRange.baseMipLevel = 0;
 	imageMemoryBarrier.subresourceRange.levelCount = 1;
 	imageMemoryBarrier.subresourceRange.baseArrayLayer = 0;
-	imageMemoryBarrier.subresourceRange.layerCount = 1;
+	imageMemoryBarrier.subresourceRange.layerCount = eyeDesc.m_nViewCount;
 	imageMemoryBarrier.srcQueueFamilyIndex = m_nQueueFamilyIndex;
 	imageMemoryBarrier.dstQueueFamilyIndex = m_nQueueFamilyIndex;
-	vkCmdPipelineBarrier( m_currentCommandBuffer.m_pCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, 0, NULL, 0, NULL, 1, &imageMemoryBarrier );
-	m_leftEyeDesc.m_nImageLayout = imageMemoryBarrier.newLayout;
+	vkCmdPipelineBarrier( pCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, 0, NULL, 0, NULL, 1, &imageMemoryBarrier );
+	eyeDesc.m_nImageLayout = imageMemoryBarrier.newLayout;
 
 	// Transition the depth buffer to VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL on first use
-	if ( m_leftEyeDesc.m_nDepthStencilImageLayout == VK_IMAGE_LAYOUT_UNDEFINED )
+	if ( eyeDesc.m_nDepthStencilImageLayout == VK_IMAGE_LAYOUT_UNDEFINED )
 	{
-		imageMemoryBarrier.image = m_leftEyeDesc.m_pDepthStencilImage;
+		imageMemoryBarrier.image = eyeDesc.m_pDepthStencilImage;
 		imageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
 		imageMemoryBarrier.srcAccessMask = 0;
 		imageMemoryBarrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-		imageMemoryBarrier.oldLayout = m_leftEyeDesc.m_nDepthStencilImageLayout;
+		imageMemoryBarrier.oldLayout = eyeDesc.m_nDepthStencilImageLayout;
 		imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-		vkCmdPipelineBarrier( m_currentCommandBuffer.m_pCommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT, 0, 0, NULL, 0, NULL, 1, &imageMemoryBarrier );
-		m_leftEyeDesc.m_nDepthStencilImageLayout = imageMemoryBarrier.newLayout;
+		vkCmdPipelineBarrier( pCommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT, 0, 0, NULL, 0, NULL, 1, &imageMemoryBarrier );
+		eyeDesc.m_nDepthStencilImageLayout = imageMemoryBarrier.newLayout;
 	}
 
 	// Start the renderpass
 	VkRenderPassBeginInfo renderPassBeginInfo = { VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO };
-	renderPassBeginInfo.renderPass = m_leftEyeDesc.m_pRenderPass;
-	renderPassBeginInfo.framebuffer = m_leftEyeDesc.m_pFramebuffer;
+	renderPassBeginInfo.renderPass = eyeDesc.m_pRenderPass;
+	renderPassBeginInfo.framebuffer = eyeDesc.m_pFramebuffer;
 	renderPassBeginInfo.renderArea.offset.x = 0;
 	renderPassBeginInfo.renderArea.offset.y = 0;
 	renderPassBeginInfo.renderArea.extent.width = m_nRenderWidth;
@@ -2945,102 +3517,68 @@ void CMainApplication::RenderStereoTargets()
 	clearValues[ 1 ].depthStencil.depth = 1.0f;
 	clearValues[ 1 ].depthStencil.stencil = 0;
 	renderPassBeginInfo.pClearValues = &clearValues[ 0 ];
-	vkCmdBeginRenderPass( m_currentCommandBuffer.m_pCommandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE );
+	vkCmdBeginRenderPass( pCommandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE );
 
-	RenderScene( vr::Eye_Left );
+	RenderScene( nEye, pFrame );
+
+	vkCmdEndRenderPass( pCommandBuffer );
 
-	vkCmdEndRenderPass( m_currentCommandBuffer.m_pCommandBuffer );
-	
 	// Transition eye image to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL for display on the companion window
-	imageMemoryBarrier.image = m_leftEyeDesc.m_pImage;
+	imageMemoryBarrier.image = eyeDesc.m_pImage;
 	imageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 	imageMemoryBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
 	imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-	imageMemoryBarrier.oldLayout = m_leftEyeDesc.m_nImageLayout;
+	imageMemoryBarrier.oldLayout = eyeDesc.m_nImageLayout;
 	imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-	vkCmdPipelineBarrier( m_currentCommandBuffer.m_pCommandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &imageMemoryBarrier );
-	m_leftEyeDesc.m_nImageLayout = imageMemoryBarrier.newLayout;
-
-	//-----------//
-	// Right Eye //
-	//-----------//
-	// Transition to VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
-	imageMemoryBarrier.image = m_rightEyeDesc.m_pImage;
-	imageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	imageMemoryBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
-	imageMemoryBarrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	imageMemoryBarrier.oldLayout = m_rightEyeDesc.m_nImageLayout;
-	imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-	vkCmdPipelineBarrier( m_currentCommandBuffer.m_pCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, 0, NULL, 0, NULL, 1, &imageMemoryBarrier );
-	m_rightEyeDesc.m_nImageLayout = imageMemoryBarrier.newLayout;
+	vkCmdPipelineBarrier( pCommandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &imageMemoryBarrier );
+	eyeDesc.m_nImageLayout = imageMemoryBarrier.newLayout;
 
-	// Transition the depth buffer to VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL on first use
-	if ( m_rightEyeDesc.m_nDepthStencilImageLayout == VK_IMAGE_LAYOUT_UNDEFINED )
+	// ...and the last eye command buffer closes it
+	if ( m_pTimestampQueryPool != VK_NULL_HANDLE && ( nEye == vr::Eye_Right || m_bMultiview ) )
 	{
-		imageMemoryBarrier.image = m_rightEyeDesc.m_pDepthStencilImage;
-		imageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-		imageMemoryBarrier.srcAccessMask = 0;
-		imageMemoryBarrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-		imageMemoryBarrier.oldLayout = m_rightEyeDesc.m_nDepthStencilImageLayout;
-		imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-		vkCmdPipelineBarrier( m_currentCommandBuffer.m_pCommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT, 0, 0, NULL, 0, NULL, 1, &imageMemoryBarrier );
-		m_rightEyeDesc.m_nDepthStencilImageLayout = imageMemoryBarrier.newLayout;
+		vkCmdWriteTimestamp( pCommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_pTimestampQueryPool, pFrame->m_unIndex * 2 + 1 );
 	}
 
-	// Start the renderpass
-	renderPassBeginInfo.renderPass = m_rightEyeDesc.m_pRenderPass;
-	renderPassBeginInfo.framebuffer = m_rightEyeDesc.m_pFramebuffer;
-	renderPassBeginInfo.pClearValues = &clearValues[ 0 ];
-	vkCmdBeginRenderPass( m_currentCommandBuffer.m_pCommandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE );
-
-	RenderScene( vr::Eye_Right );
-
-	vkCmdEndRenderPass( m_currentCommandBuffer.m_pCommandBuffer );
-	
-	// Transition eye image to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL for display on the companion window
-	imageMemoryBarrier.image = m_rightEyeDesc.m_pImage;
-	imageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	imageMemoryBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-	imageMemoryBarrier.oldLayout = m_rightEyeDesc.m_nImageLayout;
-	imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-	vkCmdPipelineBarrier( m_currentCommandBuffer.m_pCommandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &imageMemoryBarrier );
-	m_rightEyeDesc.m_nImageLayout = imageMemoryBarrier.newLayout;
+	// End the command buffer
+	vkEndCommandBuffer( pCommandBuffer );
 }
-
 //-----------------------------------------------------------------------------
-// Purpose: Renders a scene with respect to nEye.
+// Purpose: Renders a scene with respect to nEye. With multiview nEye is the
+//          left eye, whose descriptor sets carry the right eye's transform too.
 //-----------------------------------------------------------------------------
-void CMainApplication::RenderScene( vr::Hmd_Eye nEye )
+void CMainApplication::RenderScene( vr::Hmd_Eye nEye, FrameResources_t *pFrame )
 {
+	VkCommandBuffer pCommandBuffer = pFrame->m_pCommandBuffers[ FRAME_COMMAND_BUFFER_LEFT_EYE + nEye ];
+
 	if( m_bShowCubes )
 	{
-		vkCmdBindPipeline( m_currentCommandBuffer.m_pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pPipelines[ PSO_SCENE ] );
+		vkCmdBindPipeline( pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pPipelines[ PSO_SCENE ] );
 		
-		// Update the persistently mapped pointer to the CB data with the latest matrix
-		memcpy( m_pSceneConstantBufferData[ nEye ], GetCurrentViewProjectionMatrix( nEye ).get(), sizeof( Matrix4 ) );
-
-		vkCmdBindDescriptorSets( m_currentCommandBuffer.m_pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pPipelineLayout, 0, 1, &m_pDescriptorSets[ DESCRIPTOR_SET_LEFT_EYE_SCENE + nEye ], 0, nullptr );
+		// BeginFrame already wrote this slot's matrix, and Latch may still replace it before submit
+		uint32_t nSceneSet = DESCRIPTOR_SET_SCENE0 + m_lateLatchRing.GetCurrentSlot() * 2 + nEye;
+		vkCmdBindDescriptorSets( pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pPipelineLayout, 0, 1, &m_pDescriptorSets[ nSceneSet ], 0, nullptr );
 
 		// Draw
 		VkDeviceSize nOffsets[ 1 ] = { 0 };
-		vkCmdBindVertexBuffers( m_currentCommandBuffer.m_pCommandBuffer, 0, 1, &m_pSceneVertexBuffer, &nOffsets[ 0 ] );
-		vkCmdDraw( m_currentCommandBuffer.m_pCommandBuffer, m_uiVertcount, 1, 0, 0 );
+		vkCmdBindVertexBuffers( pCommandBuffer, 0, 1, &m_pSceneVertexBuffer, &nOffsets[ 0 ] );
+		vkCmdDraw( pCommandBuffer, m_uiVertcount, 1, 0, 0 );
+		pFrame->m_unDrawCalls[ nEye ]++;
 	}
 
 	bool bIsInputAvailable = m_pHMD->IsInputAvailable();
-	if( bIsInputAvailable && m_pControllerAxesVertexBuffer != VK_NULL_HANDLE )
+	if( bIsInputAvailable && pFrame->m_pControllerAxesVertexBuffer != VK_NULL_HANDLE )
 	{
 		// draw the controller axis lines
-		vkCmdBindPipeline( m_currentCommandBuffer.m_pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pPipelines[ PSO_AXES ] );
+		vkCmdBindPipeline( pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pPipelines[ PSO_AXES ] );
 
 		VkDeviceSize nOffsets[ 1 ] = { 0 };
-		vkCmdBindVertexBuffers( m_currentCommandBuffer.m_pCommandBuffer, 0, 1, &m_pControllerAxesVertexBuffer, &nOffsets[ 0 ] );
-		vkCmdDraw( m_currentCommandBuffer.m_pCommandBuffer, m_uiControllerVertcount, 1, 0, 0 );
+		vkCmdBindVertexBuffers( pCommandBuffer, 0, 1, &pFrame->m_pControllerAxesVertexBuffer, &nOffsets[ 0 ] );
+		vkCmdDraw( pCommandBuffer, pFrame->m_uiControllerVertcount, 1, 0, 0 );
+		pFrame->m_unDrawCalls[ nEye ]++;
 	}
 
 	// ----- Render Model rendering -----
-	vkCmdBindPipeline( m_currentCommandBuffer.m_pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pPipelines[ PSO_RENDERMODEL ] );
+	vkCmdBindPipeline( pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pPipelines[ PSO_RENDERMODEL ] );
 	for( uint32_t unTrackedDevice = 0; unTrackedDevice < vr::k_unMaxTrackedDeviceCount; unTrackedDevice++ )
 	{
 		if( !m_rTrackedDeviceToRenderModel[ unTrackedDevice ] || !m_rbShowTrackedDevice[ unTrackedDevice ] )
@@ -3056,30 +3594,55 @@ void CMainApplication::RenderScene( vr::Hmd_Eye nEye )
 		const Matrix4 & matDeviceToTracking = m_rmat4DevicePose[ unTrackedDevice ];
 		Matrix4 matMVP = GetCurrentViewProjectionMatrix( nEye ) * matDeviceToTracking;
 		
-		m_rTrackedDeviceToRenderModel[ unTrackedDevice ]->Draw( nEye, m_currentCommandBuffer.m_pCommandBuffer, m_pPipelineLayout, matMVP );
+		FrameResources_t::DrawnRenderModel_t drawnRenderModel = { m_rTrackedDeviceToRenderModel[ unTrackedDevice ], matDeviceToTracking };
+		if ( m_bMultiview )
+		{
+			Matrix4 matRightMVP = GetCurrentViewProjectionMatrix( vr::Eye_Right ) * matDeviceToTracking;
+			m_rTrackedDeviceToRenderModel[ unTrackedDevice ]->DrawMultiview( pFrame->m_unIndex, pCommandBuffer, m_pPipelineLayout, matMVP, matRightMVP );
+			pFrame->m_vecDrawnRenderModels[ vr::Eye_Right ].push_back( drawnRenderModel );
+		}
+		else
+		{
+			m_rTrackedDeviceToRenderModel[ unTrackedDevice ]->Draw( pFrame->m_unIndex, nEye, pCommandBuffer, m_pPipelineLayout, matMVP );
+		}
+		pFrame->m_unDrawCalls[ nEye ]++;
+
+		pFrame->m_vecDrawnRenderModels[ nEye ].push_back( drawnRenderModel );
 	}
 }
 
 //-----------------------------------------------------------------------------
-// Purpose:
+// Purpose: Render models bake the view projection into their own constant
+//          buffers, so after a latch rewrite the ones pFrame drew.
 //-----------------------------------------------------------------------------
-void CMainApplication::RenderCompanionWindow()
+void CMainApplication::LatchRenderModelTransforms( FrameResources_t *pFrame )
 {
-	// Get the next swapchain image
-	VkResult nResult = vkAcquireNextImageKHR( m_pDevice, m_pSwapchain, UINT64_MAX, m_pSwapchainSemaphores[ m_nFrameIndex ], VK_NULL_HANDLE, &m_nCurrentSwapchainImage );
-	if ( nResult != VK_SUCCESS )
+	for ( int nEye = vr::Eye_Left; nEye <= vr::Eye_Right; nEye++ )
 	{
-		dprintf( "Skipping companion window rendering, vkAcquireNextImageKHR returned %d\n", nResult );
-		return;
+		const Matrix4 &matViewProjection = m_lateLatchRing.GetViewProjection( ( vr::EVREye )nEye );
+		const std::vector< FrameResources_t::DrawnRenderModel_t > &vecDrawn = pFrame->m_vecDrawnRenderModels[ nEye ];
+		for ( size_t nDrawn = 0; nDrawn < vecDrawn.size(); nDrawn++ )
+		{
+			Matrix4 matMVP = matViewProjection * vecDrawn[ nDrawn ].m_matDeviceToTracking;
+			vecDrawn[ nDrawn ].m_pRenderModel->UpdateTransform( pFrame->m_unIndex, ( vr::EVREye )nEye, matMVP );
+		}
 	}
+}
+//-----------------------------------------------------------------------------
+// Purpose: Records the companion window command buffer, which is submitted
+//          after both eyes. Runs alongside the eye workers, so it leaves the
+//          eye image layouts in FramebufferDesc to RenderFrame.
+//-----------------------------------------------------------------------------
+void CMainApplication::RenderCompanionWindow( FrameResources_t *pFrame )
+{
+	VkCommandBuffer pCommandBuffer = pFrame->m_pCommandBuffers[ FRAME_COMMAND_BUFFER_COMPANION ];
+
+	// Start the command buffer
+	VkCommandBufferBeginInfo commandBufferBeginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+	commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer( pCommandBuffer, &commandBufferBeginInfo );
 
-	// Transition the swapchain image to COLOR_ATTACHMENT_OPTIMAL for rendering
 	VkImageMemoryBarrier imageMemoryBarrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
-	imageMemoryBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
-	imageMemoryBarrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-	imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-	imageMemoryBarrier.image = m_swapchainImages[ m_nCurrentSwapchainImage ];
 	imageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 	imageMemoryBarrier.subresourceRange.baseMipLevel = 0;
 	imageMemoryBarrier.subresourceRange.levelCount = 1;
@@ -3087,69 +3650,91 @@ void CMainApplication::RenderCompanionWindow()
 	imageMemoryBarrier.subresourceRange.layerCount = 1;
 	imageMemoryBarrier.srcQueueFamilyIndex = m_nQueueFamilyIndex;
 	imageMemoryBarrier.dstQueueFamilyIndex = m_nQueueFamilyIndex;
-	vkCmdPipelineBarrier( m_currentCommandBuffer.m_pCommandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, 0, NULL, 0, NULL, 1, &imageMemoryBarrier );
 
-	// Start the renderpass
-	VkRenderPassBeginInfo renderPassBeginInfo = { VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO };
-	renderPassBeginInfo.renderPass = m_pSwapchainRenderPass;
-	renderPassBeginInfo.framebuffer = m_pSwapchainFramebuffers[ m_nCurrentSwapchainImage ];
-	renderPassBeginInfo.renderArea.offset.x = 0;
-	renderPassBeginInfo.renderArea.offset.y = 0;
-	renderPassBeginInfo.renderArea.extent.width = m_nCompanionWindowWidth;
-	renderPassBeginInfo.renderArea.extent.height = m_nCompanionWindowHeight;
-	VkClearValue clearValues[ 1 ];
-	clearValues[ 0 ].color.float32[ 0 ] = 0.0f;
-	clearValues[ 0 ].color.float32[ 1 ] = 0.0f;
-	clearValues[ 0 ].color.float32[ 2 ] = 0.0f;
-	clearValues[ 0 ].color.float32[ 3 ] = 1.0f;
-	renderPassBeginInfo.clearValueCount = _countof( clearValues );
-	renderPassBeginInfo.pClearValues = &clearValues[ 0 ];
-	vkCmdBeginRenderPass( m_currentCommandBuffer.m_pCommandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE );
-
-	// Set viewport/scissor
-	VkViewport viewport = { 0.0f, 0.0f, (float ) m_nCompanionWindowWidth, ( float ) m_nCompanionWindowHeight, 0.0f, 1.0f };
-	vkCmdSetViewport( m_currentCommandBuffer.m_pCommandBuffer, 0, 1, &viewport );
-	VkRect2D scissor = { 0, 0, m_nCompanionWindowWidth, m_nCompanionWindowHeight };
-	vkCmdSetScissor( m_currentCommandBuffer.m_pCommandBuffer, 0, 1, &scissor );
-
-	// Bind the pipeline and descriptor set
-	vkCmdBindPipeline( m_currentCommandBuffer.m_pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pPipelines[ PSO_COMPANION ] );
-	vkCmdBindDescriptorSets( m_currentCommandBuffer.m_pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pPipelineLayout, 0, 1, &m_pDescriptorSets[ DESCRIPTOR_SET_COMPANION_LEFT_TEXTURE ], 0, nullptr );
-
-	// Draw left eye texture to companion window
-	VkDeviceSize nOffsets[ 1 ] = { 0 };
-	vkCmdBindVertexBuffers( m_currentCommandBuffer.m_pCommandBuffer, 0, 1, &m_pCompanionWindowVertexBuffer, &nOffsets[ 0 ] );
-	vkCmdBindIndexBuffer( m_currentCommandBuffer.m_pCommandBuffer, m_pCompanionWindowIndexBuffer, 0, VK_INDEX_TYPE_UINT16 );
-	vkCmdDrawIndexed( m_currentCommandBuffer.m_pCommandBuffer, m_uiCompanionWindowIndexSize / 2, 1, 0, 0, 0 );
+	// Get the next swapchain image
+	VkResult nResult = vkAcquireNextImageKHR( m_pDevice, m_pSwapchain, UINT64_MAX, pFrame->m_pSwapchainSemaphore, VK_NULL_HANDLE, &pFrame->m_nSwapchainImage );
+	pFrame->m_bSwapchainImageAcquired = ( nResult == VK_SUCCESS );
+	if ( !pFrame->m_bSwapchainImageAcquired )
+	{
+		dprintf( "Skipping companion window rendering, vkAcquireNextImageKHR returned %d\n", nResult );
+	}
+	else
+	{
+		// Transition the swapchain image to COLOR_ATTACHMENT_OPTIMAL for rendering
+		imageMemoryBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
+		imageMemoryBarrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		imageMemoryBarrier.image = m_swapchainImages[ pFrame->m_nSwapchainImage ];
+		vkCmdPipelineBarrier( pCommandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, 0, NULL, 0, NULL, 1, &imageMemoryBarrier );
+
+		// Start the renderpass
+		VkRenderPassBeginInfo renderPassBeginInfo = { VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO };
+		renderPassBeginInfo.renderPass = m_pSwapchainRenderPass;
+		renderPassBeginInfo.framebuffer = m_pSwapchainFramebuffers[ pFrame->m_nSwapchainImage ];
+		renderPassBeginInfo.renderArea.offset.x = 0;
+		renderPassBeginInfo.renderArea.offset.y = 0;
+		renderPassBeginInfo.renderArea.extent.width = m_nCompanionWindowWidth;
+		renderPassBeginInfo.renderArea.extent.height = m_nCompanionWindowHeight;
+		VkClearValue clearValues[ 1 ];
+		clearValues[ 0 ].color.float32[ 0 ] = 0.0f;
+		clearValues[ 0 ].color.float32[ 1 ] = 0.0f;
+		clearValues[ 0 ].color.float32[ 2 ] = 0.0f;
+		clearValues[ 0 ].color.float32[ 3 ] = 1.0f;
+		renderPassBeginInfo.clearValueCount = _countof( clearValues );
+		renderPassBeginInfo.pClearValues = &clearValues[ 0 ];
+		vkCmdBeginRenderPass( pCommandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE );
+
+		// Set viewport/scissor
+		VkViewport viewport = { 0.0f, 0.0f, (float ) m_nCompanionWindowWidth, ( float ) m_nCompanionWindowHeight, 0.0f, 1.0f };
+		vkCmdSetViewport( pCommandBuffer, 0, 1, &viewport );
+		VkRect2D scissor = { 0, 0, m_nCompanionWindowWidth, m_nCompanionWindowHeight };
+		vkCmdSetScissor( pCommandBuffer, 0, 1, &scissor );
+
+		// Bind the pipeline and descriptor set
+		vkCmdBindPipeline( pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pPipelines[ PSO_COMPANION ] );
+		vkCmdBindDescriptorSets( pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pPipelineLayout, 0, 1, &m_pDescriptorSets[ DESCRIPTOR_SET_COMPANION_LEFT_TEXTURE ], 0, nullptr );
+
+		// Draw left eye texture to companion window
+		VkDeviceSize nOffsets[ 1 ] = { 0 };
+		vkCmdBindVertexBuffers( pCommandBuffer, 0, 1, &m_pCompanionWindowVertexBuffer, &nOffsets[ 0 ] );
+		vkCmdBindIndexBuffer( pCommandBuffer, m_pCompanionWindowIndexBuffer, 0, VK_INDEX_TYPE_UINT16 );
+		vkCmdDrawIndexed( pCommandBuffer, m_uiCompanionWindowIndexSize / 2, 1, 0, 0, 0 );
 
-	// Draw right eye texture to companion window
-	vkCmdBindDescriptorSets( m_currentCommandBuffer.m_pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pPipelineLayout, 0, 1, &m_pDescriptorSets[ DESCRIPTOR_SET_COMPANION_RIGHT_TEXTURE ], 0, nullptr );
-	vkCmdDrawIndexed( m_currentCommandBuffer.m_pCommandBuffer, m_uiCompanionWindowIndexSize / 2, 1, ( m_uiCompanionWindowIndexSize / 2 ), 0, 0 );
+		// Draw right eye texture to companion window
+		vkCmdBindDescriptorSets( pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pPipelineLayout, 0, 1, &m_pDescriptorSets[ DESCRIPTOR_SET_COMPANION_RIGHT_TEXTURE ], 0, nullptr );
+		vkCmdDrawIndexed( pCommandBuffer, m_uiCompanionWindowIndexSize / 2, 1, ( m_uiCompanionWindowIndexSize / 2 ), 0, 0 );
 
-	// End the renderpass
-	vkCmdEndRenderPass( m_currentCommandBuffer.m_pCommandBuffer );
+		// End the renderpass
+		vkCmdEndRenderPass( pCommandBuffer );
 
-	// Transition the swapchain image to PRESENT_SRC for presentation
-	imageMemoryBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	imageMemoryBarrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-	imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-	vkCmdPipelineBarrier( m_currentCommandBuffer.m_pCommandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, 0, NULL, 0, NULL, 1, &imageMemoryBarrier );
+		// Transition the swapchain image to PRESENT_SRC for presentation
+		imageMemoryBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		imageMemoryBarrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		vkCmdPipelineBarrier( pCommandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, 0, NULL, 0, NULL, 1, &imageMemoryBarrier );
+	}
 
-	// Transition both of the eye textures to VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL for SteamVR which requires this layout for submit
+	// Transition both of the eye textures to VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL for SteamVR which requires this layout for submit.
+	// The eye command buffers ahead of this one always leave them in SHADER_READ_ONLY_OPTIMAL.
 	imageMemoryBarrier.image = m_leftEyeDesc.m_pImage;
+	imageMemoryBarrier.subresourceRange.layerCount = m_leftEyeDesc.m_nViewCount;
 	imageMemoryBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
 	imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-	imageMemoryBarrier.oldLayout = m_leftEyeDesc.m_nImageLayout;
+	imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 	imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-	vkCmdPipelineBarrier( m_currentCommandBuffer.m_pCommandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &imageMemoryBarrier );
-	m_leftEyeDesc.m_nImageLayout = imageMemoryBarrier.newLayout;
+	vkCmdPipelineBarrier( pCommandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &imageMemoryBarrier );
 
-	imageMemoryBarrier.image = m_rightEyeDesc.m_pImage;
-	vkCmdPipelineBarrier( m_currentCommandBuffer.m_pCommandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &imageMemoryBarrier );
-	m_rightEyeDesc.m_nImageLayout = imageMemoryBarrier.newLayout;
-}
+	if ( !m_bMultiview )
+	{
+		imageMemoryBarrier.image = m_rightEyeDesc.m_pImage;
+		vkCmdPipelineBarrier( pCommandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &imageMemoryBarrier );
+	}
 
+	// End the command buffer
+	vkEndCommandBuffer( pCommandBuffer );
+}
 //-----------------------------------------------------------------------------
 // Purpose: Gets a Matrix Projection Eye with respect to nEye.
 //-----------------------------------------------------------------------------
@@ -3304,11 +3889,11 @@ VulkanRenderModel *CMainApplication::FindOrLoadRenderModel( vr::TrackedDeviceInd
 		}
 
 		pRenderModel = new VulkanRenderModel( pchRenderModelName );
-		VkDescriptorSet pDescriptorSets[ 2 ] =
+		VkDescriptorSet pDescriptorSets[ k_unFramesInFlight * 2 ];
+		for ( uint32_t nSet = 0; nSet < k_unFramesInFlight * 2; nSet++ )
 		{
-			m_pDescriptorSets[ DESCRIPTOR_SET_LEFT_EYE_RENDER_MODEL0 + unTrackedDeviceIndex ],
-			m_pDescriptorSets[ DESCRIPTOR_SET_RIGHT_EYE_RENDER_MODEL0 + unTrackedDeviceIndex ],
-		};
+			pDescriptorSets[ nSet ] = m_pDescriptorSets[ DESCRIPTOR_SET_RENDER_MODEL0 + nSet * vr::k_unMaxTrackedDeviceCount + unTrackedDeviceIndex ];
+		}
 
 		// If this gets called during HandleInput() there will be no command buffer current, so create one
 		// and submit it immediately.
@@ -3338,11 +3923,14 @@ VulkanRenderModel *CMainApplication::FindOrLoadRenderModel( vr::TrackedDeviceInd
 			{
 				vkEndCommandBuffer( m_currentCommandBuffer.m_pCommandBuffer );
 
-				// Submit now
+				// Submit now, while the submit thread may be using the queue
 				VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
 				submitInfo.commandBufferCount = 1;
 				submitInfo.pCommandBuffers = &m_currentCommandBuffer.m_pCommandBuffer;
-				vkQueueSubmit( m_pQueue, 1, &submitInfo, m_currentCommandBuffer.m_pFence );
+				{
+					std::lock_guard< std::mutex > queueLock( m_queueMutex );
+					vkQueueSubmit( m_pQueue, 1, &submitInfo, m_currentCommandBuffer.m_pFence );
+				}
 				m_commandBuffers.push_front( m_currentCommandBuffer );
 
 				// Reset current command buffer
@@ -3357,6 +3945,99 @@ VulkanRenderModel *CMainApplication::FindOrLoadRenderModel( vr::TrackedDeviceInd
 	return pRenderModel;
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Late latch ring
+//-----------------------------------------------------------------------------
+CVulkanLateLatchRing::CVulkanLateLatchRing()
+	: m_pDevice( VK_NULL_HANDLE )
+	, m_pBuffer( VK_NULL_HANDLE )
+	, m_pBufferMemory( VK_NULL_HANDLE )
+	, m_nEntryStride( 0 )
+	, m_pMapped( NULL )
+{
+}
+
+
+CVulkanLateLatchRing::~CVulkanLateLatchRing()
+{
+	Cleanup();
+}
+
+
+bool CVulkanLateLatchRing::BInit( VkDevice pDevice, const VkPhysicalDeviceMemoryProperties &memoryProperties, const VkPhysicalDeviceProperties &deviceProperties )
+{
+	m_pDevice = pDevice;
+
+	VkDeviceSize nAlignment = deviceProperties.limits.minUniformBufferOffsetAlignment;
+	if ( nAlignment < 1 )
+		nAlignment = 256;
+	m_nEntryStride = ( ( sizeof( Matrix4 ) + nAlignment - 1 ) / nAlignment ) * nAlignment;
+
+	VkBufferCreateInfo bufferCreateInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+	bufferCreateInfo.size = m_nEntryStride * k_unSlots * 2;
+	bufferCreateInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+	if ( vkCreateBuffer( m_pDevice, &bufferCreateInfo, nullptr, &m_pBuffer ) != VK_SUCCESS )
+		return false;
+
+	VkMemoryRequirements memoryRequirements = { };
+	vkGetBufferMemoryRequirements( m_pDevice, m_pBuffer, &memoryRequirements );
+
+	// coherent, so writes need no flush before vkQueueSubmit
+	VkMemoryAllocateInfo allocInfo = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
+	if ( !MemoryTypeFromProperties( memoryProperties, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &allocInfo.memoryTypeIndex ) )
+		return false;
+	allocInfo.allocationSize = memoryRequirements.size;
+
+	if ( vkAllocateMemory( m_pDevice, &allocInfo, nullptr, &m_pBufferMemory ) != VK_SUCCESS )
+		return false;
+	vkBindBufferMemory( m_pDevice, m_pBuffer, m_pBufferMemory, 0 );
+
+	// Map and keep mapped persistently
+	void *pMapped = NULL;
+	if ( vkMapMemory( m_pDevice, m_pBufferMemory, 0, VK_WHOLE_SIZE, 0, &pMapped ) != VK_SUCCESS )
+		return false;
+	m_pMapped = ( uint8_t * )pMapped;
+	memset( m_pMapped, 0, ( size_t )bufferCreateInfo.size );
+	return true;
+}
+
+
+void CVulkanLateLatchRing::Cleanup()
+{
+	if ( m_pDevice == VK_NULL_HANDLE )
+		return;
+
+	if ( m_pMapped )
+	{
+		vkUnmapMemory( m_pDevice, m_pBufferMemory );
+		m_pMapped = NULL;
+	}
+	vkDestroyBuffer( m_pDevice, m_pBuffer, nullptr );
+	vkFreeMemory( m_pDevice, m_pBufferMemory, nullptr );
+	m_pBuffer = VK_NULL_HANDLE;
+	m_pBufferMemory = VK_NULL_HANDLE;
+	m_pDevice = VK_NULL_HANDLE;
+}
+
+
+VkDescriptorBufferInfo CVulkanLateLatchRing::GetBufferInfo( uint32_t unSlot, vr::EVREye eEye ) const
+{
+	VkDescriptorBufferInfo bufferInfo = {};
+	bufferInfo.buffer = m_pBuffer;
+	bufferInfo.offset = ( unSlot * 2 + eEye ) * m_nEntryStride;
+	bufferInfo.range = sizeof( Matrix4 );
+	return bufferInfo;
+}
+
+
+float *CVulkanLateLatchRing::GetSlotMatrix( uint32_t unSlot, vr::EVREye eEye )
+{
+	static float s_rflDiscard[ 16 ];
+	if ( !m_pMapped )
+		return s_rflDiscard;
+	return ( float * )( m_pMapped + ( unSlot * 2 + eEye ) * m_nEntryStride );
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: Create/destroy Vulkan a Render Model for a single tracked device
 //-----------------------------------------------------------------------------
@@ -3445,13 +4126,12 @@ VulkanRenderModel::~VulkanRenderModel()
 //-----------------------------------------------------------------------------
 // Purpose: Allocates and populates the Vulkan resources for a render model
 //-----------------------------------------------------------------------------
-bool VulkanRenderModel::BInit( VkDevice pDevice, const VkPhysicalDeviceMemoryProperties &memoryProperties, VkCommandBuffer pCommandBuffer, vr::TrackedDeviceIndex_t unTrackedDeviceIndex, VkDescriptorSet pDescriptorSets[ 2 ], const vr::RenderModel_t & vrModel, const vr::RenderModel_TextureMap_t & vrDiffuseTexture )
+bool VulkanRenderModel::BInit( VkDevice pDevice, const VkPhysicalDeviceMemoryProperties &memoryProperties, VkCommandBuffer pCommandBuffer, vr::TrackedDeviceIndex_t unTrackedDeviceIndex, VkDescriptorSet pDescriptorSets[ k_unFramesInFlight * 2 ], const vr::RenderModel_t & vrModel, const vr::RenderModel_TextureMap_t & vrDiffuseTexture )
 {
 	m_pDevice = pDevice;
 	m_physicalDeviceMemoryProperties = memoryProperties;
 	m_unTrackedDeviceIndex = unTrackedDeviceIndex;
-	m_pDescriptorSets[ 0 ] = pDescriptorSets[ 0 ];
-	m_pDescriptorSets[ 1 ] = pDescriptorSets[ 1 ];
+	memcpy( m_pDescriptorSets, pDescriptorSets, sizeof( m_pDescriptorSets ) );
 
 	// Create and populate the vertex buffer
 	{
@@ -3622,29 +4302,29 @@ bool VulkanRenderModel::BInit( VkDevice pDevice, const VkPhysicalDeviceMemoryPro
 		vkCreateSampler( m_pDevice, &samplerCreateInfo, nullptr, &m_pSampler );
 	}
 
-	// Create a constant buffer to hold the transform (one for each eye)
-	for ( uint32_t nEye = 0; nEye < 2; nEye++ )
+	// Create a constant buffer to hold the transform (one for each eye of each frame in flight)
+	for ( uint32_t nBuffer = 0; nBuffer < k_unFramesInFlight * 2; nBuffer++ )
 	{
 		VkBufferCreateInfo bufferCreateInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
 		bufferCreateInfo.size = sizeof( Matrix4 );
 		bufferCreateInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-		vkCreateBuffer( m_pDevice, &bufferCreateInfo, nullptr, &m_pConstantBuffer[ nEye ] );
+		vkCreateBuffer( m_pDevice, &bufferCreateInfo, nullptr, &m_pConstantBuffer[ nBuffer ] );
 		
 		VkMemoryRequirements memoryRequirements = {};
-		vkGetBufferMemoryRequirements( m_pDevice, m_pConstantBuffer[ nEye ], &memoryRequirements );
+		vkGetBufferMemoryRequirements( m_pDevice, m_pConstantBuffer[ nBuffer ], &memoryRequirements );
 		VkMemoryAllocateInfo allocInfo = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
 		MemoryTypeFromProperties( m_physicalDeviceMemoryProperties, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT, &allocInfo.memoryTypeIndex );
 		allocInfo.allocationSize = memoryRequirements.size;
 
-		vkAllocateMemory( m_pDevice, &allocInfo, nullptr, &m_pConstantBufferMemory[ nEye ] );
-		vkBindBufferMemory( m_pDevice, m_pConstantBuffer[ nEye ], m_pConstantBufferMemory[ nEye ], 0 );
+		vkAllocateMemory( m_pDevice, &allocInfo, nullptr, &m_pConstantBufferMemory[ nBuffer ] );
+		vkBindBufferMemory( m_pDevice, m_pConstantBuffer[ nBuffer ], m_pConstantBufferMemory[ nBuffer ], 0 );
 
 		// Map and keep mapped persistently
-		vkMapMemory( m_pDevice, m_pConstantBufferMemory[ nEye ], 0, VK_WHOLE_SIZE, 0, &m_pConstantBufferData[ nEye ] );
+		vkMapMemory( m_pDevice, m_pConstantBufferMemory[ nBuffer ], 0, VK_WHOLE_SIZE, 0, &m_pConstantBufferData[ nBuffer ] );
 
 		// Bake the descriptor set
 		VkDescriptorBufferInfo bufferInfo = {};
-		bufferInfo.buffer = m_pConstantBuffer[ nEye ];
+		bufferInfo.buffer = m_pConstantBuffer[ nBuffer ];
 		bufferInfo.offset = 0;
 		bufferInfo.range = VK_WHOLE_SIZE;
 
@@ -3657,19 +4337,19 @@ bool VulkanRenderModel::BInit( VkDevice pDevice, const VkPhysicalDeviceMemoryPro
 
 		VkWriteDescriptorSet writeDescriptorSets[ 3 ] = { };
 		writeDescriptorSets[ 0 ].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		writeDescriptorSets[ 0 ].dstSet = m_pDescriptorSets[ nEye ];
+		writeDescriptorSets[ 0 ].dstSet = m_pDescriptorSets[ nBuffer ];
 		writeDescriptorSets[ 0 ].dstBinding = 0;
 		writeDescriptorSets[ 0 ].descriptorCount = 1;
 		writeDescriptorSets[ 0 ].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
 		writeDescriptorSets[ 0 ].pBufferInfo = &bufferInfo;
 		writeDescriptorSets[ 1 ].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		writeDescriptorSets[ 1 ].dstSet = m_pDescriptorSets[ nEye ];
+		writeDescriptorSets[ 1 ].dstSet = m_pDescriptorSets[ nBuffer ];
 		writeDescriptorSets[ 1 ].dstBinding = 1;
 		writeDescriptorSets[ 1 ].descriptorCount = 1;
 		writeDescriptorSets[ 1 ].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
 		writeDescriptorSets[ 1 ].pImageInfo = &imageInfo;
 		writeDescriptorSets[ 2 ].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		writeDescriptorSets[ 2 ].dstSet = m_pDescriptorSets[ nEye ];
+		writeDescriptorSets[ 2 ].dstSet = m_pDescriptorSets[ nBuffer ];
 		writeDescriptorSets[ 2 ].dstBinding = 2;
 		writeDescriptorSets[ 2 ].descriptorCount = 1;
 		writeDescriptorSets[ 2 ].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
@@ -3678,6 +4358,23 @@ bool VulkanRenderModel::BInit( VkDevice pDevice, const VkPhysicalDeviceMemoryPro
 		vkUpdateDescriptorSets( m_pDevice, _countof( writeDescriptorSets ), writeDescriptorSets, 0, nullptr );
 	}
 
+	// The left eye's set also points at the right eye's transform, for DrawMultiview
+	for ( uint32_t nFrame = 0; nFrame < k_unFramesInFlight; nFrame++ )
+	{
+		VkDescriptorBufferInfo bufferInfo = {};
+		bufferInfo.buffer = m_pConstantBuffer[ nFrame * 2 + vr::Eye_Right ];
+		bufferInfo.offset = 0;
+		bufferInfo.range = VK_WHOLE_SIZE;
+
+		VkWriteDescriptorSet writeDescriptorSet = { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+		writeDescriptorSet.dstSet = m_pDescriptorSets[ nFrame * 2 + vr::Eye_Left ];
+		writeDescriptorSet.dstBinding = 3;
+		writeDescriptorSet.descriptorCount = 1;
+		writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		writeDescriptorSet.pBufferInfo = &bufferInfo;
+		vkUpdateDescriptorSets( m_pDevice, 1, &writeDescriptorSet, 0, nullptr );
+	}
+
 	m_unVertexCount = vrModel.unTriangleCount * 3;
 
 	return true;
@@ -3742,18 +4439,18 @@ void VulkanRenderModel::Cleanup()
 		m_pImageStagingBufferMemory = VK_NULL_HANDLE;
 	}
 
-	for ( uint32_t nEye = 0; nEye < 2; nEye++ )
+	for ( uint32_t nBuffer = 0; nBuffer < k_unFramesInFlight * 2; nBuffer++ )
 	{
-		if ( m_pConstantBuffer[ nEye ] != VK_NULL_HANDLE )
+		if ( m_pConstantBuffer[ nBuffer ] != VK_NULL_HANDLE )
 		{
-			vkDestroyBuffer( m_pDevice, m_pConstantBuffer[ nEye ], nullptr );
-			m_pConstantBuffer[ nEye ] = VK_NULL_HANDLE;
+			vkDestroyBuffer( m_pDevice, m_pConstantBuffer[ nBuffer ], nullptr );
+			m_pConstantBuffer[ nBuffer ] = VK_NULL_HANDLE;
 		}
 
-		if ( m_pConstantBufferMemory != VK_NULL_HANDLE )
+		if ( m_pConstantBufferMemory[ nBuffer ] != VK_NULL_HANDLE )
 		{
-			vkFreeMemory( m_pDevice, m_pConstantBufferMemory[ nEye ], nullptr );
-			m_pConstantBufferMemory[ nEye ] = VK_NULL_HANDLE;
+			vkFreeMemory( m_pDevice, m_pConstantBufferMemory[ nBuffer ], nullptr );
+			m_pConstantBufferMemory[ nBuffer ] = VK_NULL_HANDLE;
 		}
 	}
 
@@ -3767,13 +4464,13 @@ void VulkanRenderModel::Cleanup()
 //-----------------------------------------------------------------------------
 // Purpose: Draws the render model
 //-----------------------------------------------------------------------------
-void VulkanRenderModel::Draw( vr::EVREye nEye, VkCommandBuffer pCommandBuffer, VkPipelineLayout pPipelineLayout, const Matrix4 &matMVP )
+void VulkanRenderModel::Draw( uint32_t unFrame, vr::EVREye nEye, VkCommandBuffer pCommandBuffer, VkPipelineLayout pPipelineLayout, const Matrix4 &matMVP )
 {
 	// Update the CB with the transform
-	memcpy( m_pConstantBufferData[ nEye ], &matMVP, sizeof( matMVP ) );
+	UpdateTransform( unFrame, nEye, matMVP );
 
 	// Bind the descriptor set
-	vkCmdBindDescriptorSets( pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pPipelineLayout, 0, 1, &m_pDescriptorSets[ nEye ], 0, nullptr );
+	vkCmdBindDescriptorSets( pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pPipelineLayout, 0, 1, &m_pDescriptorSets[ unFrame * 2 + nEye ], 0, nullptr );
 	
 	// Bind the VB/IB and draw
 	VkDeviceSize nOffsets[ 1 ] = { 0 };
@@ -3782,6 +4479,24 @@ void VulkanRenderModel::Draw( vr::EVREye nEye, VkCommandBuffer pCommandBuffer, V
 	vkCmdDrawIndexed( pCommandBuffer, m_unVertexCount, 1, 0, 0, 0 );
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Draws the render model into both views of a multiview render pass
+//-----------------------------------------------------------------------------
+void VulkanRenderModel::DrawMultiview( uint32_t unFrame, VkCommandBuffer pCommandBuffer, VkPipelineLayout pPipelineLayout, const Matrix4 &matLeftMVP, const Matrix4 &matRightMVP )
+{
+	UpdateTransform( unFrame, vr::Eye_Right, matRightMVP );
+	Draw( unFrame, vr::Eye_Left, pCommandBuffer, pPipelineLayout, matLeftMVP );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Rewrites the transform of the last Draw for unFrame and nEye, which
+//          the GPU only sees if it happens before the frame is submitted.
+//-----------------------------------------------------------------------------
+void VulkanRenderModel::UpdateTransform( uint32_t unFrame, vr::EVREye nEye, const Matrix4 &matMVP )
+{
+	memcpy( m_pConstantBufferData[ unFrame * 2 + nEye ], &matMVP, sizeof( matMVP ) );
+}
+
 //-----------------------------------------------------------------------------
 // Purpose:
 //-----------------------------------------------------------------------------
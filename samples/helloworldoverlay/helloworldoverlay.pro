@@ -16,10 +16,12 @@ TEMPLATE = app
 
 SOURCES += main.cpp\
         overlaywidget.cpp \
-    openvroverlaycontroller.cpp
+    openvroverlaycontroller.cpp \
+    overlaypublisher.cpp
 
 HEADERS  += overlaywidget.h \
-    openvroverlaycontroller.h
+    openvroverlaycontroller.h \
+    overlaypublisher.h
 
 FORMS    += overlaywidget.ui
 
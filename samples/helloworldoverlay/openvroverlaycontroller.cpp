@@ -38,13 +38,14 @@ COpenVROverlayController::COpenVROverlayController()
 	: BaseClass()
 	, m_strVRDriver( "No Driver" )
 	, m_strVRDisplay( "No Display" )
+	, m_bPerf( false )
     , m_eLastHmdError( vr::VRInitError_None )
     , m_eCompositorError( vr::VRInitError_None )
     , m_eOverlayError( vr::VRInitError_None )
 	, m_ulOverlayHandle( vr::k_ulOverlayHandleInvalid )
 	, m_pOpenGLContext( NULL )
 	, m_pScene( NULL )
-	, m_pFbo( NULL )
+	, m_pPublisher( NULL )
 	, m_pOffscreenSurface ( NULL )
 	, m_pPumpEventsTimer( NULL )
 	, m_pWidget( NULL )
@@ -98,6 +99,8 @@ bool COpenVROverlayController::Init()
 		m_strName = arguments.at( nNameArg + 1 );
 	}
 
+	m_bPerf = arguments.contains( "-perf" );
+
 	QSurfaceFormat format;
 	format.setMajorVersion( 4 );
 	format.setMinorVersion( 1 );
@@ -151,8 +154,11 @@ void COpenVROverlayController::Shutdown()
 {
 	DisconnectFromVRRuntime();
 
+	// the publisher's textures belong to the context, so they go first
+	delete m_pPublisher;
+	m_pPublisher = NULL;
+
 	delete m_pScene;
-	delete m_pFbo;
 	delete m_pOffscreenSurface;
 
 	if( m_pOpenGLContext )
@@ -167,28 +173,23 @@ void COpenVROverlayController::Shutdown()
 //-----------------------------------------------------------------------------
 // Purpose:
 //-----------------------------------------------------------------------------
-void COpenVROverlayController::OnSceneChanged( const QList<QRectF>& )
+void COpenVROverlayController::OnSceneChanged( const QList<QRectF>& listRegion )
 {
-	// skip rendering if the overlay isn't visible
-    if( ( m_ulOverlayHandle == k_ulOverlayHandleInvalid ) || !vr::VROverlay() ||
-        ( !vr::VROverlay()->IsOverlayVisible( m_ulOverlayHandle ) && !vr::VROverlay()->IsOverlayVisible( m_ulOverlayThumbnailHandle ) ) )
-        return;
-
-	m_pOpenGLContext->makeCurrent( m_pOffscreenSurface );
-	m_pFbo->bind();
-	
-	QOpenGLPaintDevice device( m_pFbo->size() );
-	QPainter painter( &device );
-
-	m_pScene->render( &painter );
+	// the publisher only redraws what changed, once per compositor frame
+	if( m_pPublisher )
+		m_pPublisher->OnSceneChanged( listRegion );
+}
 
-	m_pFbo->release();
 
-	GLuint unTexture = m_pFbo->texture();
-	if( unTexture != 0 )
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+void COpenVROverlayController::OnPublisherStatsUpdated( float flBytesUploadedPerSecond, float flPublishesPerSecond )
+{
+	if( m_bPerf )
 	{
-        vr::Texture_t texture = {(void*)(uintptr_t)unTexture, vr::TextureType_OpenGL, vr::ColorSpace_Auto };
-        vr::VROverlay()->SetOverlayTexture( m_ulOverlayHandle, &texture );
+		qDebug( "Overlay %s: %.1f KB/s uploaded, %.1f publishes/s", qPrintable( m_strName ),
+			flBytesUploadedPerSecond / 1024.f, flPublishesPerSecond );
 	}
 }
 
@@ -225,8 +226,6 @@ void COpenVROverlayController::OnTimeoutPumpEvents()
 
 				m_ptLastMouse = ptNewMouse;
 				QApplication::sendEvent( m_pScene, &mouseEvent );
-
-				OnSceneChanged( QList<QRectF>() );
 			}
 			break;
 
@@ -282,6 +281,9 @@ void COpenVROverlayController::OnTimeoutPumpEvents()
 
 		case vr::VREvent_OverlayShown:
 			{
+				// nothing was published while the overlay was hidden
+				if( m_pPublisher )
+					m_pPublisher->MarkAllDirty();
 				m_pWidget->repaint();
 			}
 			break;
@@ -300,6 +302,8 @@ void COpenVROverlayController::OnTimeoutPumpEvents()
             {
             case vr::VREvent_OverlayShown:
                 {
+                    if( m_pPublisher )
+                        m_pPublisher->MarkAllDirty();
                     m_pWidget->repaint();
                 }
                 break;
@@ -323,7 +327,16 @@ void COpenVROverlayController::SetWidget( QWidget *pWidget )
 	}
 	m_pWidget = pWidget;
 
-	m_pFbo = new QOpenGLFramebufferObject( pWidget->width(), pWidget->height(), GL_TEXTURE_2D );
+	if( m_pOpenGLContext )
+	{
+		m_pPublisher = new COverlayPublisher( this );
+		connect( m_pPublisher, SIGNAL( statsUpdated( float, float ) ), this, SLOT( OnPublisherStatsUpdated( float, float ) ) );
+		if( !m_pPublisher->Init( m_pOpenGLContext, m_pOffscreenSurface, m_pScene, pWidget->size(), m_ulOverlayHandle, m_ulOverlayThumbnailHandle ) )
+		{
+			delete m_pPublisher;
+			m_pPublisher = NULL;
+		}
+	}
 
     if( vr::VROverlay() )
     {
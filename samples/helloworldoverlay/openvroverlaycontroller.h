@@ -21,6 +21,8 @@
 #include <QtWidgets/QGraphicsScene>
 #include <QtGui/QOffscreenSurface>
 
+#include "overlaypublisher.h"
+
 class COpenVROverlayController : public QObject
 {
 	Q_OBJECT
@@ -50,6 +52,7 @@ public:
 public slots:
 	void OnSceneChanged( const QList<QRectF>& );
 	void OnTimeoutPumpEvents();
+	void OnPublisherStatsUpdated( float flBytesUploadedPerSecond, float flPublishesPerSecond );
 
 protected:
 
@@ -61,6 +64,7 @@ private:
 	QString m_strVRDriver;
 	QString m_strVRDisplay;
 	QString m_strName;
+	bool m_bPerf;
 
 	vr::HmdError m_eLastHmdError;
 
@@ -72,7 +76,7 @@ private:
 
 	QOpenGLContext *m_pOpenGLContext;
 	QGraphicsScene *m_pScene;
-	QOpenGLFramebufferObject *m_pFbo;
+	COverlayPublisher *m_pPublisher;
 	QOffscreenSurface *m_pOffscreenSurface;
 
 	QTimer *m_pPumpEventsTimer;
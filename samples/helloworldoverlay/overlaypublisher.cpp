@@ -0,0 +1,296 @@
+//====== Copyright Valve Corporation, All rights reserved. =======
+
+
+#include "overlaypublisher.h"
+
+
+#include <QOpenGLPaintDevice>
+#include <QPainter>
+
+// used until the HMD reports its refresh rate
+static const float k_flDefaultDisplayFrequency = 90.f;
+
+// bytes per texel of the overlay textures
+static const int k_nBytesPerTexel = 4;
+
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+COverlayPublisher::COverlayPublisher( QObject *pParent )
+	: BaseClass( pParent )
+	, m_pOpenGLContext( NULL )
+	, m_pOffscreenSurface( NULL )
+	, m_pScene( NULL )
+	, m_ulOverlayHandle( vr::k_ulOverlayHandleInvalid )
+	, m_ulOverlayThumbnailHandle( vr::k_ulOverlayHandleInvalid )
+	, m_nBackBuffer( 0 )
+	, m_pPublishTimer( NULL )
+	, m_nLastPublishMs( 0 )
+	, m_nPublishIntervalMs( 11 )
+	, m_nStatsWindowStartMs( 0 )
+	, m_ulStatsWindowBytes( 0 )
+	, m_unStatsWindowPublishes( 0 )
+	, m_flBytesUploadedPerSecond( 0.f )
+	, m_flPublishesPerSecond( 0.f )
+	, m_ulTotalBytesUploaded( 0 )
+{
+	m_rpFbo[ 0 ] = NULL;
+	m_rpFbo[ 1 ] = NULL;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+COverlayPublisher::~COverlayPublisher()
+{
+	Shutdown();
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+bool COverlayPublisher::Init( QOpenGLContext *pOpenGLContext, QOffscreenSurface *pOffscreenSurface, QGraphicsScene *pScene,
+	const QSize &size, vr::VROverlayHandle_t ulOverlayHandle, vr::VROverlayHandle_t ulOverlayThumbnailHandle )
+{
+	m_pOpenGLContext = pOpenGLContext;
+	m_pOffscreenSurface = pOffscreenSurface;
+	m_pScene = pScene;
+	m_ulOverlayHandle = ulOverlayHandle;
+	m_ulOverlayThumbnailHandle = ulOverlayThumbnailHandle;
+
+	m_pOpenGLContext->makeCurrent( m_pOffscreenSurface );
+	for ( int nBuffer = 0; nBuffer < 2; nBuffer++ )
+	{
+		m_rpFbo[ nBuffer ] = new QOpenGLFramebufferObject( size, GL_TEXTURE_2D );
+		if ( !m_rpFbo[ nBuffer ]->isValid() )
+			return false;
+	}
+
+	// publishing more often than the compositor composites would only be thrown away
+	float flDisplayFrequency = 0.f;
+	if ( vr::VRSystem() )
+		flDisplayFrequency = vr::VRSystem()->GetFloatTrackedDeviceProperty( vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_DisplayFrequency_Float );
+	if ( flDisplayFrequency <= 0.f )
+		flDisplayFrequency = k_flDefaultDisplayFrequency;
+	m_nPublishIntervalMs = qMax( 1, qRound( 1000.f / flDisplayFrequency ) );
+
+	m_pPublishTimer = new QTimer( this );
+	m_pPublishTimer->setSingleShot( true );
+	connect( m_pPublishTimer, SIGNAL( timeout() ), this, SLOT( OnTimeoutPublish() ) );
+
+	m_clock.start();
+	m_nLastPublishMs = -m_nPublishIntervalMs;
+	m_nStatsWindowStartMs = 0;
+
+	MarkAllDirty();
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+void COverlayPublisher::Shutdown()
+{
+	if ( m_pPublishTimer )
+	{
+		m_pPublishTimer->stop();
+		delete m_pPublishTimer;
+		m_pPublishTimer = NULL;
+	}
+
+	if ( m_pOpenGLContext && ( m_rpFbo[ 0 ] || m_rpFbo[ 1 ] ) )
+		m_pOpenGLContext->makeCurrent( m_pOffscreenSurface );
+
+	for ( int nBuffer = 0; nBuffer < 2; nBuffer++ )
+	{
+		delete m_rpFbo[ nBuffer ];
+		m_rpFbo[ nBuffer ] = NULL;
+		m_rStaleRegion[ nBuffer ] = QRegion();
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Both textures need the change, the back one for the next
+//			publication and the front one for the publication after that
+//-----------------------------------------------------------------------------
+void COverlayPublisher::MarkDirty( const QRect &rect )
+{
+	if ( !m_rpFbo[ 0 ] )
+		return;
+
+	QRect rectClipped = rect & QRect( QPoint( 0, 0 ), m_rpFbo[ 0 ]->size() );
+	if ( rectClipped.isEmpty() )
+		return;
+
+	m_rStaleRegion[ 0 ] += rectClipped;
+	m_rStaleRegion[ 1 ] += rectClipped;
+	SchedulePublish();
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+void COverlayPublisher::MarkAllDirty()
+{
+	if ( m_rpFbo[ 0 ] )
+		MarkDirty( QRect( QPoint( 0, 0 ), m_rpFbo[ 0 ]->size() ) );
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+void COverlayPublisher::OnSceneChanged( const QList<QRectF> &listRegion )
+{
+	for ( int i = 0; i < listRegion.size(); i++ )
+	{
+		MarkDirty( listRegion.at( i ).toAlignedRect() );
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+bool COverlayPublisher::BOverlayVisible() const
+{
+	if ( ( m_ulOverlayHandle == vr::k_ulOverlayHandleInvalid ) || !vr::VROverlay() )
+		return false;
+
+	return vr::VROverlay()->IsOverlayVisible( m_ulOverlayHandle ) ||
+		( m_ulOverlayThumbnailHandle != vr::k_ulOverlayHandleInvalid && vr::VROverlay()->IsOverlayVisible( m_ulOverlayThumbnailHandle ) );
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Publishes no sooner than one compositor frame after the last
+//			publication. Changes that arrive meanwhile join the pending one.
+//-----------------------------------------------------------------------------
+void COverlayPublisher::SchedulePublish()
+{
+	if ( !m_pPublishTimer || m_pPublishTimer->isActive() )
+		return;
+
+	qint64 nSinceLastMs = m_clock.elapsed() - m_nLastPublishMs;
+	m_pPublishTimer->start( (int)qMax< qint64 >( 0, m_nPublishIntervalMs - nSinceLastMs ) );
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Renders the parts of the scene a texture is missing, returning the
+//			number of texel bytes written
+//-----------------------------------------------------------------------------
+quint64 COverlayPublisher::RenderStaleRegion( int nBuffer )
+{
+	QOpenGLFramebufferObject *pFbo = m_rpFbo[ nBuffer ];
+	QVector<QRect> vecRects = m_rStaleRegion[ nBuffer ].rects();
+	m_rStaleRegion[ nBuffer ] = QRegion();
+
+	quint64 ulBytes = 0;
+
+	pFbo->bind();
+	{
+		QOpenGLPaintDevice device( pFbo->size() );
+		QPainter painter( &device );
+
+		for ( int i = 0; i < vecRects.size(); i++ )
+		{
+			const QRect &rect = vecRects.at( i );
+
+			// the old contents of the rect may be partially transparent, so replace rather than blend over them
+			painter.setClipRect( rect );
+			painter.setCompositionMode( QPainter::CompositionMode_Source );
+			painter.fillRect( rect, Qt::transparent );
+			painter.setCompositionMode( QPainter::CompositionMode_SourceOver );
+
+			m_pScene->render( &painter, QRectF( rect ), QRectF( rect ), Qt::IgnoreAspectRatio );
+
+			ulBytes += (quint64)rect.width() * rect.height() * k_nBytesPerTexel;
+		}
+	}
+	pFbo->release();
+
+	return ulBytes;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+void COverlayPublisher::OnTimeoutPublish()
+{
+	// skip rendering if the overlay isn't visible. The dirty regions are kept
+	// until it is, when the owner marks everything dirty again anyway.
+	if ( !BOverlayVisible() || m_rStaleRegion[ m_nBackBuffer ].isEmpty() )
+		return;
+
+	m_pOpenGLContext->makeCurrent( m_pOffscreenSurface );
+
+	quint64 ulBytes = RenderStaleRegion( m_nBackBuffer );
+
+	GLuint unTexture = m_rpFbo[ m_nBackBuffer ]->texture();
+	if ( unTexture != 0 )
+	{
+		vr::Texture_t texture = {(void*)(uintptr_t)unTexture, vr::TextureType_OpenGL, vr::ColorSpace_Auto };
+		vr::VROverlay()->SetOverlayTexture( m_ulOverlayHandle, &texture );
+	}
+	m_nBackBuffer = 1 - m_nBackBuffer;
+
+	qint64 nNowMs = m_clock.elapsed();
+	m_nLastPublishMs = nNowMs;
+	m_ulStatsWindowBytes += ulBytes;
+	m_unStatsWindowPublishes++;
+	m_ulTotalBytesUploaded += ulBytes;
+	UpdateStatsWindow( nNowMs );
+
+	// the texture that was just handed over still misses what changed since its last publication
+	if ( !m_rStaleRegion[ m_nBackBuffer ].isEmpty() )
+		SchedulePublish();
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Closes the stats window once a second has passed
+//-----------------------------------------------------------------------------
+void COverlayPublisher::UpdateStatsWindow( qint64 nNowMs )
+{
+	qint64 nWindowMs = nNowMs - m_nStatsWindowStartMs;
+	if ( nWindowMs < 1000 )
+		return;
+
+	m_flBytesUploadedPerSecond = m_ulStatsWindowBytes * 1000.f / nWindowMs;
+	m_flPublishesPerSecond = m_unStatsWindowPublishes * 1000.f / nWindowMs;
+	m_nStatsWindowStartMs = nNowMs;
+	m_ulStatsWindowBytes = 0;
+	m_unStatsWindowPublishes = 0;
+
+	emit statsUpdated( m_flBytesUploadedPerSecond, m_flPublishesPerSecond );
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+float COverlayPublisher::GetBytesUploadedPerSecond()
+{
+	if ( m_clock.isValid() )
+		UpdateStatsWindow( m_clock.elapsed() );
+	return m_flBytesUploadedPerSecond;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+float COverlayPublisher::GetPublishesPerSecond()
+{
+	if ( m_clock.isValid() )
+		UpdateStatsWindow( m_clock.elapsed() );
+	return m_flPublishesPerSecond;
+}
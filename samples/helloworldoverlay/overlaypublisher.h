@@ -0,0 +1,88 @@
+//====== Copyright Valve Corporation, All rights reserved. =======
+
+#ifndef OVERLAYPUBLISHER_H
+#define OVERLAYPUBLISHER_H
+
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "openvr.h"
+
+#include <QtCore/QtCore>
+// because of incompatibilities with QtOpenGL and GLEW we need to cherry pick includes
+#include <QtGui/QRegion>
+#include <QtGui/QOpenGLContext>
+#include <QtGui/QOpenGLFramebufferObject>
+#include <QtGui/QOffscreenSurface>
+#include <QtWidgets/QGraphicsScene>
+
+//-----------------------------------------------------------------------------
+// Purpose: Publishes a QGraphicsScene to an overlay. Scene changes only mark
+//			regions dirty; at most once per compositor frame the dirty regions
+//			are re-rendered into whichever of two textures the compositor was
+//			not handed last, and that texture is published.
+//-----------------------------------------------------------------------------
+class COverlayPublisher : public QObject
+{
+	Q_OBJECT
+	typedef QObject BaseClass;
+
+public:
+	explicit COverlayPublisher( QObject *pParent = NULL );
+	virtual ~COverlayPublisher();
+
+	bool Init( QOpenGLContext *pOpenGLContext, QOffscreenSurface *pOffscreenSurface, QGraphicsScene *pScene,
+		const QSize &size, vr::VROverlayHandle_t ulOverlayHandle, vr::VROverlayHandle_t ulOverlayThumbnailHandle );
+	void Shutdown();
+
+	void MarkDirty( const QRect &rect );
+	void MarkAllDirty();
+
+	// texel bytes rendered into the overlay textures and publications, averaged over the last whole second
+	float GetBytesUploadedPerSecond();
+	float GetPublishesPerSecond();
+	quint64 GetTotalBytesUploaded() const { return m_ulTotalBytesUploaded; }
+
+public slots:
+	void OnSceneChanged( const QList<QRectF>& );
+
+signals:
+	void statsUpdated( float flBytesUploadedPerSecond, float flPublishesPerSecond );
+
+private slots:
+	void OnTimeoutPublish();
+
+private:
+	bool BOverlayVisible() const;
+	void SchedulePublish();
+	quint64 RenderStaleRegion( int nBuffer );
+	void UpdateStatsWindow( qint64 nNowMs );
+
+	QOpenGLContext *m_pOpenGLContext;
+	QOffscreenSurface *m_pOffscreenSurface;
+	QGraphicsScene *m_pScene;
+	vr::VROverlayHandle_t m_ulOverlayHandle;
+	vr::VROverlayHandle_t m_ulOverlayThumbnailHandle;
+
+	// the compositor may still be reading the texture it was handed last, so the
+	// other one is rendered into. Each remembers what changed since it was last drawn.
+	QOpenGLFramebufferObject *m_rpFbo[ 2 ];
+	QRegion m_rStaleRegion[ 2 ];
+	int m_nBackBuffer;
+
+	QTimer *m_pPublishTimer;
+	QElapsedTimer m_clock;
+	qint64 m_nLastPublishMs;
+	int m_nPublishIntervalMs;
+
+	qint64 m_nStatsWindowStartMs;
+	quint64 m_ulStatsWindowBytes;
+	quint32 m_unStatsWindowPublishes;
+	float m_flBytesUploadedPerSecond;
+	float m_flPublishesPerSecond;
+	quint64 m_ulTotalBytesUploaded;
+};
+
+
+#endif // OVERLAYPUBLISHER_H
@@ -0,0 +1,852 @@
+//========= Copyright Valve Corporation ============//
+#include "frametiminganalytics.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined( _WIN32 )
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// histogram resolution; anything past the last bin is lumped into it
+static const float k_flHistogramBinWidthMs = 0.05f;
+static const uint32_t k_unHistogramBins = 1000;
+
+// how many frames the replay pretends the compositor remembers
+static const uint32_t k_unReplayHistory = 128;
+
+// render scale changes that haven't reached the consumed frames yet; more than this means nobody is polling
+static const size_t k_unMaxPendingRenderScales = 256;
+
+// a metric regresses when the short window P95 exceeds the long window P95 by this
+// factor plus margin, and recovers once it is back under the lower pair
+static const float k_flRegressionTriggerScale = 1.25f;
+static const float k_flRegressionTriggerMarginMs = 0.5f;
+static const float k_flRegressionClearScale = 1.1f;
+static const float k_flRegressionClearMarginMs = 0.25f;
+
+// extra fraction of reprojected frames over the long run rate that counts as a regression
+static const float k_flReprojectionTrigger = 0.10f;
+static const float k_flReprojectionClear = 0.03f;
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Columns of the recording CSV, which are every scalar field of
+//			Compositor_FrameTiming
+//-----------------------------------------------------------------------------
+enum EFieldType
+{
+	FieldType_Uint32,
+	FieldType_Double,
+	FieldType_Float,
+};
+
+struct FrameTimingField_t
+{
+	const char *pchName;
+	EFieldType eType;
+	size_t unOffset;
+};
+
+#define FRAME_TIMING_FIELD( name, type ) { #name, type, offsetof( vr::Compositor_FrameTiming, name ) }
+
+static const FrameTimingField_t k_rgFrameTimingFields[] =
+{
+	FRAME_TIMING_FIELD( m_nFrameIndex, FieldType_Uint32 ),
+	FRAME_TIMING_FIELD( m_nNumFramePresents, FieldType_Uint32 ),
+	FRAME_TIMING_FIELD( m_nNumMisPresented, FieldType_Uint32 ),
+	FRAME_TIMING_FIELD( m_nNumDroppedFrames, FieldType_Uint32 ),
+	FRAME_TIMING_FIELD( m_nReprojectionFlags, FieldType_Uint32 ),
+	FRAME_TIMING_FIELD( m_flSystemTimeInSeconds, FieldType_Double ),
+	FRAME_TIMING_FIELD( m_flPreSubmitGpuMs, FieldType_Float ),
+	FRAME_TIMING_FIELD( m_flPostSubmitGpuMs, FieldType_Float ),
+	FRAME_TIMING_FIELD( m_flTotalRenderGpuMs, FieldType_Float ),
+	FRAME_TIMING_FIELD( m_flCompositorRenderGpuMs, FieldType_Float ),
+	FRAME_TIMING_FIELD( m_flCompositorRenderCpuMs, FieldType_Float ),
+	FRAME_TIMING_FIELD( m_flCompositorIdleCpuMs, FieldType_Float ),
+	FRAME_TIMING_FIELD( m_flClientFrameIntervalMs, FieldType_Float ),
+	FRAME_TIMING_FIELD( m_flPresentCallCpuMs, FieldType_Float ),
+	FRAME_TIMING_FIELD( m_flWaitForPresentCpuMs, FieldType_Float ),
+	FRAME_TIMING_FIELD( m_flSubmitFrameMs, FieldType_Float ),
+	FRAME_TIMING_FIELD( m_flWaitGetPosesCalledMs, FieldType_Float ),
+	FRAME_TIMING_FIELD( m_flNewPosesReadyMs, FieldType_Float ),
+	FRAME_TIMING_FIELD( m_flNewFrameReadyMs, FieldType_Float ),
+	FRAME_TIMING_FIELD( m_flCompositorUpdateStartMs, FieldType_Float ),
+	FRAME_TIMING_FIELD( m_flCompositorUpdateEndMs, FieldType_Float ),
+	FRAME_TIMING_FIELD( m_flCompositorRenderStartMs, FieldType_Float ),
+	FRAME_TIMING_FIELD( m_nNumVSyncsReadyForUse, FieldType_Uint32 ),
+	FRAME_TIMING_FIELD( m_nNumVSyncsToFirstView, FieldType_Uint32 ),
+};
+
+#undef FRAME_TIMING_FIELD
+
+static const size_t k_unFrameTimingFieldCount = sizeof( k_rgFrameTimingFields ) / sizeof( k_rgFrameTimingFields[ 0 ] );
+
+
+static inline void FullMemoryBarrier()
+{
+#if defined( _WIN32 )
+	MemoryBarrier();
+#else
+	__sync_synchronize();
+#endif
+}
+
+
+static bool IsReprojected( const vr::Compositor_FrameTiming &timing )
+{
+	return ( timing.m_nReprojectionFlags & ( vr::VRCompositor_ReprojectionReason_Cpu | vr::VRCompositor_ReprojectionReason_Gpu ) ) != 0
+		|| timing.m_nNumFramePresents > 1;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Sources
+//-----------------------------------------------------------------------------
+uint32_t CCompositorFrameTimingSource::GetFrameTimings( vr::Compositor_FrameTiming *pTiming, uint32_t nFrames )
+{
+	if ( !m_pCompositor || nFrames == 0 )
+		return 0;
+
+	pTiming[ 0 ].m_nSize = sizeof( vr::Compositor_FrameTiming );
+	return m_pCompositor->GetFrameTimings( pTiming, nFrames );
+}
+
+
+bool CCompositorFrameTimingSource::GetCumulativeStats( vr::Compositor_CumulativeStats *pStats )
+{
+	if ( !m_pCompositor )
+		return false;
+
+	m_pCompositor->GetCumulativeStats( pStats, sizeof( *pStats ) );
+	return true;
+}
+
+
+CFrameTimingReplaySource::CFrameTimingReplaySource()
+	: m_unCursor( 0 )
+	, m_unHistory( k_unReplayHistory )
+{
+}
+
+
+bool CFrameTimingReplaySource::Load( const std::string &sPath )
+{
+	FILE *pFile = fopen( sPath.c_str(), "r" );
+	if ( !pFile )
+		return false;
+
+	m_vecFrames.clear();
+	m_vecRenderScales.clear();
+	m_unCursor = 0;
+
+	char rchLine[ 4096 ];
+	bool bHeader = true;
+	while ( fgets( rchLine, sizeof( rchLine ), pFile ) )
+	{
+		// the first line names the columns
+		if ( bHeader )
+		{
+			bHeader = false;
+			continue;
+		}
+
+		vr::Compositor_FrameTiming timing;
+		memset( &timing, 0, sizeof( timing ) );
+		timing.m_nSize = sizeof( timing );
+
+		char *pchCursor = rchLine;
+		size_t unField = 0;
+		for ( ; unField < k_unFrameTimingFieldCount; unField++ )
+		{
+			char *pchEnd = nullptr;
+			const FrameTimingField_t &field = k_rgFrameTimingFields[ unField ];
+			uint8_t *pDest = (uint8_t *)&timing + field.unOffset;
+			switch ( field.eType )
+			{
+			case FieldType_Uint32:
+			{
+				uint32_t unValue = (uint32_t)strtoul( pchCursor, &pchEnd, 10 );
+				memcpy( pDest, &unValue, sizeof( unValue ) );
+				break;
+			}
+			case FieldType_Double:
+			{
+				double flValue = strtod( pchCursor, &pchEnd );
+				memcpy( pDest, &flValue, sizeof( flValue ) );
+				break;
+			}
+			case FieldType_Float:
+			{
+				float flValue = (float)strtod( pchCursor, &pchEnd );
+				memcpy( pDest, &flValue, sizeof( flValue ) );
+				break;
+			}
+			}
+
+			if ( pchEnd == pchCursor )
+				break;
+			pchCursor = pchEnd;
+			if ( *pchCursor == ',' )
+				pchCursor++;
+		}
+
+		// skip rows that are short or garbled
+		if ( unField != k_unFrameTimingFieldCount )
+			continue;
+
+		// the render scale column is missing from recordings made before it existed
+		char *pchEnd = nullptr;
+		float flScale = (float)strtod( pchCursor, &pchEnd );
+		m_vecFrames.push_back( timing );
+		m_vecRenderScales.push_back( pchEnd != pchCursor && flScale > 0.f ? flScale : 1.f );
+	}
+
+	fclose( pFile );
+	return !m_vecFrames.empty();
+}
+
+
+bool CFrameTimingReplaySource::Advance( uint32_t unFrames )
+{
+	if ( m_unCursor >= m_vecFrames.size() )
+		return false;
+
+	m_unCursor += unFrames;
+	if ( m_unCursor > m_vecFrames.size() )
+		m_unCursor = (uint32_t)m_vecFrames.size();
+	return true;
+}
+
+
+float CFrameTimingReplaySource::GetRenderScale() const
+{
+	if ( m_unCursor == 0 || m_unCursor > m_vecRenderScales.size() )
+		return 1.f;
+	return m_vecRenderScales[ m_unCursor - 1 ];
+}
+
+
+uint32_t CFrameTimingReplaySource::GetFrameTimings( vr::Compositor_FrameTiming *pTiming, uint32_t nFrames )
+{
+	uint32_t unAvailable = m_unCursor < m_unHistory ? m_unCursor : m_unHistory;
+	uint32_t unCount = nFrames < unAvailable ? nFrames : unAvailable;
+	if ( unCount == 0 )
+		return 0;
+
+	memcpy( pTiming, &m_vecFrames[ m_unCursor - unCount ], unCount * sizeof( vr::Compositor_FrameTiming ) );
+	return unCount;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Rolling histogram
+//-----------------------------------------------------------------------------
+CRollingHistogram::CRollingHistogram( uint32_t unWindow, float flBinWidth, uint32_t unBins )
+	: m_vecSamples( unWindow )
+	, m_vecBins( unBins )
+	, m_unNext( 0 )
+	, m_unCount( 0 )
+	, m_flBinWidth( flBinWidth )
+	, m_ulSequence( 0 )
+{
+}
+
+
+uint32_t CRollingHistogram::BinFor( float flValue ) const
+{
+	if ( !( flValue > 0.f ) )
+		return 0;
+
+	float flBin = flValue / m_flBinWidth;
+	if ( flBin >= (float)( m_vecBins.size() - 1 ) )
+		return (uint32_t)m_vecBins.size() - 1;
+	return (uint32_t)flBin;
+}
+
+
+void CRollingHistogram::Add( float flValue )
+{
+	if ( m_unCount == m_vecSamples.size() )
+		m_vecBins[ BinFor( m_vecSamples[ m_unNext ] ) ]--;
+	else
+		m_unCount++;
+
+	m_vecSamples[ m_unNext ] = flValue;
+	m_vecBins[ BinFor( flValue ) ]++;
+	m_unNext = ( m_unNext + 1 ) % m_vecSamples.size();
+
+	// anything not larger than the new sample can never be the maximum again
+	while ( !m_dequeMax.empty() && m_dequeMax.back().flValue <= flValue )
+		m_dequeMax.pop_back();
+	MaxCandidate_t candidate = { m_ulSequence, flValue };
+	m_dequeMax.push_back( candidate );
+	m_ulSequence++;
+	if ( m_ulSequence - m_dequeMax.front().ulSequence > m_vecSamples.size() )
+		m_dequeMax.pop_front();
+}
+
+
+void CRollingHistogram::Clear()
+{
+	memset( &m_vecBins[ 0 ], 0, m_vecBins.size() * sizeof( m_vecBins[ 0 ] ) );
+	m_unNext = 0;
+	m_unCount = 0;
+	m_dequeMax.clear();
+	m_ulSequence = 0;
+}
+
+
+float CRollingHistogram::Percentile( float flFraction ) const
+{
+	if ( m_unCount == 0 )
+		return 0.f;
+
+	// nearest rank: the smallest bin that covers ceil( fraction * count ) samples
+	uint32_t unRank = (uint32_t)( flFraction * m_unCount + 0.999999f );
+	if ( unRank < 1 )
+		unRank = 1;
+
+	uint32_t unSeen = 0;
+	for ( uint32_t i = 0; i < m_vecBins.size(); i++ )
+	{
+		unSeen += m_vecBins[ i ];
+		if ( unSeen >= unRank )
+		{
+			// report the bin midpoint, but never more than the largest sample;
+			// the overflow bin has no upper edge at all
+			float flMax = Max();
+			float flMid = ( i + 0.5f ) * m_flBinWidth;
+			return i == m_vecBins.size() - 1 || flMax < flMid ? flMax : flMid;
+		}
+	}
+	return Max();
+}
+
+
+float CRollingHistogram::Max() const
+{
+	if ( m_dequeMax.empty() || !( m_dequeMax.front().flValue > 0.f ) )
+		return 0.f;
+	return m_dequeMax.front().flValue;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Analytics
+//-----------------------------------------------------------------------------
+CFrameTimingAnalytics::CFrameTimingAnalytics()
+	: m_vecScratch( k_unMaxFramesPerPoll )
+	, m_vecShortReprojected( k_unShortWindow )
+	, m_pRecordFile( nullptr )
+	, m_pShared( nullptr )
+	, m_unSharedSize( 0 )
+	, m_hSharedMapping( nullptr )
+{
+	for ( int i = 0; i < FrameTimingMetric_Count; i++ )
+	{
+		m_vecShort.push_back( CRollingHistogram( k_unShortWindow, k_flHistogramBinWidthMs, k_unHistogramBins ) );
+		m_vecLong.push_back( CRollingHistogram( k_unLongWindow, k_flHistogramBinWidthMs, k_unHistogramBins ) );
+	}
+	Reset();
+}
+
+
+CFrameTimingAnalytics::~CFrameTimingAnalytics()
+{
+	StopRecording();
+	CloseSharedRing();
+}
+
+
+void CFrameTimingAnalytics::Reset()
+{
+	m_bHaveLastFrame = false;
+	m_unLastFrameIndex = 0;
+	for ( size_t i = 0; i < m_vecShort.size(); i++ )
+	{
+		m_vecShort[ i ].Clear();
+		m_vecLong[ i ].Clear();
+	}
+	memset( &m_vecShortReprojected[ 0 ], 0, m_vecShortReprojected.size() );
+	m_unShortReprojectedCount = 0;
+	m_unShortReprojectedNext = 0;
+	memset( &m_summary, 0, sizeof( m_summary ) );
+	m_bHaveCumulativeStats = false;
+	memset( &m_cumulativeStats, 0, sizeof( m_cumulativeStats ) );
+	memset( m_rgbRegressionActive, 0, sizeof( m_rgbRegressionActive ) );
+	m_vecRegressionEvents.clear();
+	m_dequeRenderScales.clear();
+}
+
+
+float CFrameTimingAnalytics::MetricValue( const vr::Compositor_FrameTiming &timing, EFrameTimingMetric eMetric )
+{
+	switch ( eMetric )
+	{
+	case FrameTimingMetric_TotalRenderGpuMs:		return timing.m_flTotalRenderGpuMs;
+	case FrameTimingMetric_CompositorIdleCpuMs:		return timing.m_flCompositorIdleCpuMs;
+	case FrameTimingMetric_CompositorRenderCpuMs:	return timing.m_flCompositorRenderCpuMs;
+	case FrameTimingMetric_ClientFrameIntervalMs:	return timing.m_flClientFrameIntervalMs;
+	default:										return 0.f;
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Fetches the recent history in one call and consumes the frames
+//			after the last one we saw. Anything older in the batch was already
+//			consumed by an earlier poll.
+//-----------------------------------------------------------------------------
+uint32_t CFrameTimingAnalytics::Poll( IFrameTimingSource *pSource )
+{
+	if ( pSource->GetCumulativeStats( &m_cumulativeStats ) )
+		m_bHaveCumulativeStats = true;
+
+	uint32_t unReturned = pSource->GetFrameTimings( &m_vecScratch[ 0 ], k_unMaxFramesPerPoll );
+	if ( unReturned > k_unMaxFramesPerPoll )
+		unReturned = k_unMaxFramesPerPoll;
+
+	uint32_t unConsumed = 0;
+	for ( uint32_t i = 0; i < unReturned; i++ )
+	{
+		const vr::Compositor_FrameTiming &timing = m_vecScratch[ i ];
+		if ( m_bHaveLastFrame )
+		{
+			uint32_t unDelta = timing.m_nFrameIndex - m_unLastFrameIndex;
+			if ( unDelta == 0 || unDelta > 0x80000000u )
+				continue;
+			m_summary.ulMissedSamples += unDelta - 1;
+		}
+
+		ConsumeFrame( timing );
+		m_bHaveLastFrame = true;
+		m_unLastFrameIndex = timing.m_nFrameIndex;
+		unConsumed++;
+	}
+
+	if ( unConsumed > 0 )
+	{
+		m_summary.unLastFrameIndex = m_unLastFrameIndex;
+		CheckRegressions( m_unLastFrameIndex );
+		PublishSharedSummary();
+	}
+	return unConsumed;
+}
+
+
+void CFrameTimingAnalytics::ConsumeFrame( const vr::Compositor_FrameTiming &timing )
+{
+	for ( int i = 0; i < FrameTimingMetric_Count; i++ )
+	{
+		float flValue = MetricValue( timing, (EFrameTimingMetric)i );
+		m_vecShort[ i ].Add( flValue );
+		m_vecLong[ i ].Add( flValue );
+	}
+
+	bool bReprojected = IsReprojected( timing );
+	// slots start out zeroed, so before the ring wraps this subtracts nothing
+	m_unShortReprojectedCount -= m_vecShortReprojected[ m_unShortReprojectedNext ];
+	m_vecShortReprojected[ m_unShortReprojectedNext ] = bReprojected ? 1 : 0;
+	m_unShortReprojectedCount += bReprojected ? 1 : 0;
+	m_unShortReprojectedNext = ( m_unShortReprojectedNext + 1 ) % k_unShortWindow;
+
+	m_summary.ulFrames++;
+	m_summary.ulReprojectedFrames += bReprojected ? 1 : 0;
+	m_summary.ulDroppedFrames += timing.m_nNumDroppedFrames;
+	m_summary.ulMisPresentedFrames += timing.m_nNumMisPresented;
+
+	// drop scale changes that a newer change superseded by this frame
+	while ( m_dequeRenderScales.size() > 1 && (int32_t)( timing.m_nFrameIndex - m_dequeRenderScales[ 1 ].unFrameIndex ) >= 0 )
+		m_dequeRenderScales.pop_front();
+
+	if ( m_pRecordFile )
+	{
+		float flRenderScale = 1.f;
+		if ( !m_dequeRenderScales.empty() && (int32_t)( timing.m_nFrameIndex - m_dequeRenderScales.front().unFrameIndex ) >= 0 )
+			flRenderScale = m_dequeRenderScales.front().flScale;
+
+		for ( size_t i = 0; i < k_unFrameTimingFieldCount; i++ )
+		{
+			const FrameTimingField_t &field = k_rgFrameTimingFields[ i ];
+			const uint8_t *pSrc = (const uint8_t *)&timing + field.unOffset;
+			const char *pchSeparator = ",";
+			switch ( field.eType )
+			{
+			case FieldType_Uint32:
+			{
+				uint32_t unValue;
+				memcpy( &unValue, pSrc, sizeof( unValue ) );
+				fprintf( m_pRecordFile, "%u%s", unValue, pchSeparator );
+				break;
+			}
+			case FieldType_Double:
+			{
+				double flValue;
+				memcpy( &flValue, pSrc, sizeof( flValue ) );
+				fprintf( m_pRecordFile, "%.6f%s", flValue, pchSeparator );
+				break;
+			}
+			case FieldType_Float:
+			{
+				float flValue;
+				memcpy( &flValue, pSrc, sizeof( flValue ) );
+				fprintf( m_pRecordFile, "%.4f%s", flValue, pchSeparator );
+				break;
+			}
+			}
+		}
+		fprintf( m_pRecordFile, "%.4f\n", flRenderScale );
+	}
+
+	PublishShared( timing );
+}
+
+
+void CFrameTimingAnalytics::CheckRegressions( uint32_t unFrameIndex )
+{
+	// wait until the baseline means something
+	if ( m_vecLong[ 0 ].GetCount() < k_unShortWindow * 4 )
+		return;
+
+	const float flP95 = 0.95f;
+	CheckRegression( FrameTimingRegression_GpuTime, &m_rgbRegressionActive[ FrameTimingRegression_GpuTime ],
+		m_vecShort[ FrameTimingMetric_TotalRenderGpuMs ].Percentile( flP95 ), m_vecLong[ FrameTimingMetric_TotalRenderGpuMs ].Percentile( flP95 ),
+		k_flRegressionTriggerScale, k_flRegressionClearScale, unFrameIndex );
+	CheckRegression( FrameTimingRegression_FrameInterval, &m_rgbRegressionActive[ FrameTimingRegression_FrameInterval ],
+		m_vecShort[ FrameTimingMetric_ClientFrameIntervalMs ].Percentile( flP95 ), m_vecLong[ FrameTimingMetric_ClientFrameIntervalMs ].Percentile( flP95 ),
+		k_flRegressionTriggerScale, k_flRegressionClearScale, unFrameIndex );
+
+	float flShortRate = (float)m_unShortReprojectedCount / k_unShortWindow;
+	float flLongRate = (float)m_summary.ulReprojectedFrames / m_summary.ulFrames;
+	CheckRegression( FrameTimingRegression_Reprojection, &m_rgbRegressionActive[ FrameTimingRegression_Reprojection ],
+		flShortRate, flLongRate, 0.f, 0.f, unFrameIndex );
+}
+
+
+void CFrameTimingAnalytics::CheckRegression( EFrameTimingRegression eKind, bool *pbActive, float flShort, float flLong, float flTrigger, float flClear, uint32_t unFrameIndex )
+{
+	float flTriggerAt, flClearAt;
+	if ( eKind == FrameTimingRegression_Reprojection )
+	{
+		flTriggerAt = flLong + k_flReprojectionTrigger;
+		flClearAt = flLong + k_flReprojectionClear;
+	}
+	else
+	{
+		flTriggerAt = flLong * flTrigger + k_flRegressionTriggerMarginMs;
+		flClearAt = flLong * flClear + k_flRegressionClearMarginMs;
+	}
+
+	bool bChanged = false;
+	if ( !*pbActive && flShort > flTriggerAt )
+	{
+		*pbActive = true;
+		bChanged = true;
+	}
+	else if ( *pbActive && flShort < flClearAt )
+	{
+		*pbActive = false;
+		bChanged = true;
+	}
+	if ( !bChanged )
+		return;
+
+	FrameTimingRegressionEvent_t event;
+	event.eKind = eKind;
+	event.bResolved = !*pbActive;
+	event.unFrameIndex = unFrameIndex;
+	event.flValue = flShort;
+	event.flBaseline = flLong;
+	m_vecRegressionEvents.push_back( event );
+	if ( m_fnRegression )
+		m_fnRegression( event );
+}
+
+
+FrameTimingSummary_t CFrameTimingAnalytics::GetSummary() const
+{
+	FrameTimingSummary_t summary = m_summary;
+	for ( int i = 0; i < FrameTimingMetric_Count; i++ )
+	{
+		FrameTimingPercentiles_t &metric = summary.rgMetrics[ i ];
+		metric.flP50 = m_vecLong[ i ].Percentile( 0.50f );
+		metric.flP95 = m_vecLong[ i ].Percentile( 0.95f );
+		metric.flP99 = m_vecLong[ i ].Percentile( 0.99f );
+		metric.flMax = m_vecLong[ i ].Max();
+	}
+	return summary;
+}
+
+
+FrameTimingPercentiles_t CFrameTimingAnalytics::GetShortWindowPercentiles( EFrameTimingMetric eMetric ) const
+{
+	FrameTimingPercentiles_t metric;
+	memset( &metric, 0, sizeof( metric ) );
+	if ( eMetric < 0 || eMetric >= FrameTimingMetric_Count )
+		return metric;
+
+	metric.flP50 = m_vecShort[ eMetric ].Percentile( 0.50f );
+	metric.flP95 = m_vecShort[ eMetric ].Percentile( 0.95f );
+	metric.flP99 = m_vecShort[ eMetric ].Percentile( 0.99f );
+	metric.flMax = m_vecShort[ eMetric ].Max();
+	return metric;
+}
+
+
+bool CFrameTimingAnalytics::GetCumulativeStats( vr::Compositor_CumulativeStats *pStats ) const
+{
+	if ( !m_bHaveCumulativeStats )
+		return false;
+	*pStats = m_cumulativeStats;
+	return true;
+}
+
+
+bool CFrameTimingAnalytics::StartRecording( const std::string &sPath )
+{
+	StopRecording();
+	m_pRecordFile = fopen( sPath.c_str(), "w" );
+	if ( !m_pRecordFile )
+		return false;
+
+	for ( size_t i = 0; i < k_unFrameTimingFieldCount; i++ )
+	{
+		fprintf( m_pRecordFile, "%s,", k_rgFrameTimingFields[ i ].pchName );
+	}
+	fprintf( m_pRecordFile, "renderScale\n" );
+	return true;
+}
+
+
+void CFrameTimingAnalytics::SetRenderScale( uint32_t unFrameIndex, float flScale )
+{
+	if ( !m_dequeRenderScales.empty() && m_dequeRenderScales.back().flScale == flScale )
+		return;
+
+	RenderScaleChange_t change = { unFrameIndex, flScale };
+	m_dequeRenderScales.push_back( change );
+	if ( m_dequeRenderScales.size() > k_unMaxPendingRenderScales )
+		m_dequeRenderScales.pop_front();
+}
+
+
+void CFrameTimingAnalytics::StopRecording()
+{
+	if ( m_pRecordFile )
+	{
+		fclose( m_pRecordFile );
+		m_pRecordFile = nullptr;
+	}
+}
+
+
+bool CFrameTimingAnalytics::ExportJson( const std::string &sPath ) const
+{
+	static const char * const k_rgpchMetricNames[ FrameTimingMetric_Count ] =
+	{
+		"totalRenderGpuMs", "compositorIdleCpuMs", "compositorRenderCpuMs", "clientFrameIntervalMs"
+	};
+	static const char * const k_rgpchRegressionNames[] = { "gpuTime", "frameInterval", "reprojection" };
+
+	FILE *pFile = fopen( sPath.c_str(), "w" );
+	if ( !pFile )
+		return false;
+
+	FrameTimingSummary_t summary = GetSummary();
+	fprintf( pFile, "{\n" );
+	fprintf( pFile, "  \"frames\": %llu,\n", (unsigned long long)summary.ulFrames );
+	fprintf( pFile, "  \"reprojectedFrames\": %llu,\n", (unsigned long long)summary.ulReprojectedFrames );
+	fprintf( pFile, "  \"droppedFrames\": %llu,\n", (unsigned long long)summary.ulDroppedFrames );
+	fprintf( pFile, "  \"misPresentedFrames\": %llu,\n", (unsigned long long)summary.ulMisPresentedFrames );
+	fprintf( pFile, "  \"missedSamples\": %llu,\n", (unsigned long long)summary.ulMissedSamples );
+	fprintf( pFile, "  \"lastFrameIndex\": %u,\n", summary.unLastFrameIndex );
+
+	fprintf( pFile, "  \"metrics\": {\n" );
+	for ( int i = 0; i < FrameTimingMetric_Count; i++ )
+	{
+		const FrameTimingPercentiles_t &metric = summary.rgMetrics[ i ];
+		fprintf( pFile, "    \"%s\": { \"p50\": %.3f, \"p95\": %.3f, \"p99\": %.3f, \"max\": %.3f }%s\n", k_rgpchMetricNames[ i ],
+			metric.flP50, metric.flP95, metric.flP99, metric.flMax, i + 1 < FrameTimingMetric_Count ? "," : "" );
+	}
+	fprintf( pFile, "  },\n" );
+
+	if ( m_bHaveCumulativeStats )
+	{
+		fprintf( pFile, "  \"cumulative\": { \"pid\": %u, \"framePresents\": %u, \"droppedFrames\": %u, \"reprojectedFrames\": %u, \"timedOut\": %u },\n",
+			m_cumulativeStats.m_nPid, m_cumulativeStats.m_nNumFramePresents, m_cumulativeStats.m_nNumDroppedFrames,
+			m_cumulativeStats.m_nNumReprojectedFrames, m_cumulativeStats.m_nNumTimedOut );
+	}
+
+	fprintf( pFile, "  \"regressions\": [" );
+	for ( size_t i = 0; i < m_vecRegressionEvents.size(); i++ )
+	{
+		const FrameTimingRegressionEvent_t &event = m_vecRegressionEvents[ i ];
+		fprintf( pFile, "%s\n    { \"kind\": \"%s\", \"resolved\": %s, \"frameIndex\": %u, \"value\": %.4f, \"baseline\": %.4f }",
+			i == 0 ? "" : ",", k_rgpchRegressionNames[ event.eKind ], event.bResolved ? "true" : "false",
+			event.unFrameIndex, event.flValue, event.flBaseline );
+	}
+	fprintf( pFile, "%s]\n}\n", m_vecRegressionEvents.empty() ? "" : "\n  " );
+
+	bool bOk = !ferror( pFile );
+	fclose( pFile );
+	return bOk;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Shared memory ring
+//-----------------------------------------------------------------------------
+#if !defined( _WIN32 )
+//-----------------------------------------------------------------------------
+// Purpose: Creates the backing file, or reuses one left behind by an earlier
+//			run of ours. /dev/shm is world writable, so never follow a link
+//			someone planted there and never write into another user's file.
+//			On Linux the path is opened directly under /dev/shm, which is what
+//			shm_open does, so the samples don't need to link librt.
+//-----------------------------------------------------------------------------
+static int OpenSharedFile( const std::string &sPath )
+{
+#if defined( __linux__ )
+	int nFd = open( sPath.c_str(), O_CREAT | O_EXCL | O_RDWR | O_NOFOLLOW | O_CLOEXEC, 0644 );
+	if ( nFd < 0 && errno == EEXIST )
+		nFd = open( sPath.c_str(), O_RDWR | O_NOFOLLOW | O_CLOEXEC );
+#else
+	int nFd = shm_open( sPath.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644 );
+	if ( nFd < 0 && errno == EEXIST )
+		nFd = shm_open( sPath.c_str(), O_RDWR, 0 );
+#endif
+	if ( nFd < 0 )
+		return -1;
+
+	struct stat fileStat;
+	if ( fstat( nFd, &fileStat ) != 0 || !S_ISREG( fileStat.st_mode ) || fileStat.st_uid != geteuid() )
+	{
+		close( nFd );
+		return -1;
+	}
+	return nFd;
+}
+#endif
+
+
+bool CFrameTimingAnalytics::OpenSharedRing( const char *pchName, uint32_t unCapacity )
+{
+	CloseSharedRing();
+	if ( !pchName || !*pchName || unCapacity == 0 )
+		return false;
+
+	size_t unSize = sizeof( FrameTimingSharedHeader_t ) + (size_t)unCapacity * sizeof( FrameTimingSharedRecord_t );
+	void *pView = nullptr;
+
+#if defined( _WIN32 )
+	HANDLE hMapping = CreateFileMappingA( INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, (DWORD)unSize, pchName );
+	if ( !hMapping )
+		return false;
+	pView = MapViewOfFile( hMapping, FILE_MAP_ALL_ACCESS, 0, 0, unSize );
+	if ( !pView )
+	{
+		CloseHandle( hMapping );
+		return false;
+	}
+	m_hSharedMapping = hMapping;
+	m_sSharedName = pchName;
+#else
+	std::string sPath = pchName[ 0 ] == '/' ? pchName : std::string( "/" ) + pchName;
+#if defined( __linux__ )
+	sPath = "/dev/shm" + sPath;
+#endif
+	int nFd = OpenSharedFile( sPath );
+	if ( nFd < 0 )
+		return false;
+	if ( ftruncate( nFd, (off_t)unSize ) != 0 )
+	{
+		close( nFd );
+		return false;
+	}
+	pView = mmap( nullptr, unSize, PROT_READ | PROT_WRITE, MAP_SHARED, nFd, 0 );
+	close( nFd );
+	if ( pView == MAP_FAILED )
+		return false;
+	m_sSharedName = sPath;
+#endif
+
+	memset( pView, 0, unSize );
+	m_pShared = (FrameTimingSharedHeader_t *)pView;
+	m_unSharedSize = unSize;
+	m_pShared->unVersion = k_unFrameTimingSharedVersion;
+	m_pShared->unCapacity = unCapacity;
+	m_pShared->unRecordSize = sizeof( FrameTimingSharedRecord_t );
+
+	// readers check the magic last
+	FullMemoryBarrier();
+	m_pShared->unMagic = k_unFrameTimingSharedMagic;
+	return true;
+}
+
+
+void CFrameTimingAnalytics::CloseSharedRing()
+{
+	if ( !m_pShared )
+		return;
+
+#if defined( _WIN32 )
+	UnmapViewOfFile( m_pShared );
+	CloseHandle( (HANDLE)m_hSharedMapping );
+	m_hSharedMapping = nullptr;
+#else
+	munmap( m_pShared, m_unSharedSize );
+#if defined( __linux__ )
+	unlink( m_sSharedName.c_str() );
+#else
+	shm_unlink( m_sSharedName.c_str() );
+#endif
+#endif
+	m_pShared = nullptr;
+	m_unSharedSize = 0;
+	m_sSharedName.clear();
+}
+
+
+void CFrameTimingAnalytics::PublishShared( const vr::Compositor_FrameTiming &timing )
+{
+	if ( !m_pShared )
+		return;
+
+	uint64_t ulCount = m_pShared->ulWriteCount;
+	FrameTimingSharedRecord_t *pRecords = (FrameTimingSharedRecord_t *)( m_pShared + 1 );
+	FrameTimingSharedRecord_t &record = pRecords[ ulCount % m_pShared->unCapacity ];
+	record.unFrameIndex = timing.m_nFrameIndex;
+	record.unReprojectionFlags = timing.m_nReprojectionFlags;
+	record.unNumFramePresents = timing.m_nNumFramePresents;
+	record.unNumDroppedFrames = timing.m_nNumDroppedFrames;
+	record.flSystemTimeInSeconds = timing.m_flSystemTimeInSeconds;
+	record.flTotalRenderGpuMs = timing.m_flTotalRenderGpuMs;
+	record.flCompositorIdleCpuMs = timing.m_flCompositorIdleCpuMs;
+	record.flCompositorRenderCpuMs = timing.m_flCompositorRenderCpuMs;
+	record.flClientFrameIntervalMs = timing.m_flClientFrameIntervalMs;
+
+	FullMemoryBarrier();
+	m_pShared->ulWriteCount = ulCount + 1;
+}
+
+
+void CFrameTimingAnalytics::PublishSharedSummary()
+{
+	if ( !m_pShared )
+		return;
+
+	FrameTimingSummary_t summary = GetSummary();
+	m_pShared->unSummarySequence++;
+	FullMemoryBarrier();
+	m_pShared->summary = summary;
+	FullMemoryBarrier();
+	m_pShared->unSummarySequence++;
+}
@@ -0,0 +1,280 @@
+//========= Copyright Valve Corporation ============//
+#pragma once
+
+#include <openvr.h>
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+/** Where frame timings come from: the live compositor or a recording */
+class IFrameTimingSource
+{
+public:
+	virtual ~IFrameTimingSource() {}
+
+	/** same contract as IVRCompositor::GetFrameTimings: the newest nFrames entries, oldest first */
+	virtual uint32_t GetFrameTimings( vr::Compositor_FrameTiming *pTiming, uint32_t nFrames ) = 0;
+
+	/** returns false if the source has no cumulative stats */
+	virtual bool GetCumulativeStats( vr::Compositor_CumulativeStats *pStats ) = 0;
+};
+
+/** Reads from IVRCompositor */
+class CCompositorFrameTimingSource : public IFrameTimingSource
+{
+public:
+	explicit CCompositorFrameTimingSource( vr::IVRCompositor *pCompositor ) : m_pCompositor( pCompositor ) {}
+
+	virtual uint32_t GetFrameTimings( vr::Compositor_FrameTiming *pTiming, uint32_t nFrames );
+	virtual bool GetCumulativeStats( vr::Compositor_CumulativeStats *pStats );
+
+private:
+	vr::IVRCompositor *m_pCompositor;
+};
+
+/** Plays back a CSV written by CFrameTimingAnalytics::StartRecording, so the analytics can run without a headset */
+class CFrameTimingReplaySource : public IFrameTimingSource
+{
+public:
+	CFrameTimingReplaySource();
+
+	bool Load( const std::string &sPath );
+
+	/** moves the replay clock forward. Returns false once the recording is exhausted. */
+	bool Advance( uint32_t unFrames );
+
+	/** behaves like the compositor's history: at most unHistory frames ending at the replay clock */
+	virtual uint32_t GetFrameTimings( vr::Compositor_FrameTiming *pTiming, uint32_t nFrames );
+	virtual bool GetCumulativeStats( vr::Compositor_CumulativeStats * ) { return false; }
+
+	uint32_t GetFrameCount() const { return (uint32_t)m_vecFrames.size(); }
+
+	/** render scale the newest frame at the replay clock was drawn at; 1.0 for recordings without the column */
+	float GetRenderScale() const;
+
+private:
+	std::vector<vr::Compositor_FrameTiming> m_vecFrames;
+	std::vector<float> m_vecRenderScales;
+	uint32_t m_unCursor;		// frames [0, m_unCursor) have "happened"
+	uint32_t m_unHistory;
+};
+
+
+enum EFrameTimingMetric
+{
+	FrameTimingMetric_TotalRenderGpuMs,
+	FrameTimingMetric_CompositorIdleCpuMs,
+	FrameTimingMetric_CompositorRenderCpuMs,
+	FrameTimingMetric_ClientFrameIntervalMs,
+	FrameTimingMetric_Count
+};
+
+struct FrameTimingPercentiles_t
+{
+	float flP50;
+	float flP95;
+	float flP99;
+	float flMax;
+};
+
+struct FrameTimingSummary_t
+{
+	uint64_t ulFrames;
+	uint64_t ulReprojectedFrames;	// a CPU/GPU reprojection reason was set or the frame was presented more than once
+	uint64_t ulDroppedFrames;		// sum of m_nNumDroppedFrames
+	uint64_t ulMisPresentedFrames;
+	uint64_t ulMissedSamples;		// frame indices that aged out of the compositor history between polls
+	uint32_t unLastFrameIndex;
+	FrameTimingPercentiles_t rgMetrics[ FrameTimingMetric_Count ];	// over the long window
+};
+
+enum EFrameTimingRegression
+{
+	FrameTimingRegression_GpuTime,
+	FrameTimingRegression_FrameInterval,
+	FrameTimingRegression_Reprojection,
+};
+
+/** One regression episode. flValue/flBaseline are P95 milliseconds, or reprojected fractions for FrameTimingRegression_Reprojection. */
+struct FrameTimingRegressionEvent_t
+{
+	EFrameTimingRegression eKind;
+	bool bResolved;				// false when the regression starts, true when it clears
+	uint32_t unFrameIndex;
+	float flValue;
+	float flBaseline;
+};
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Sliding window over a fixed number of samples with a histogram
+//			alongside, so adding a sample is O(1) and a percentile query walks
+//			the bins instead of sorting the window. The maximum is kept in a
+//			monotonic queue, so Max() doesn't scan the window either.
+//-----------------------------------------------------------------------------
+class CRollingHistogram
+{
+public:
+	CRollingHistogram( uint32_t unWindow, float flBinWidth, uint32_t unBins );
+
+	void Add( float flValue );
+	void Clear();
+	uint32_t GetCount() const { return m_unCount; }
+
+	/** flFraction in [0,1]. Accurate to one bin width. */
+	float Percentile( float flFraction ) const;
+	float Max() const;
+
+private:
+	uint32_t BinFor( float flValue ) const;
+
+	struct MaxCandidate_t
+	{
+		uint64_t ulSequence;
+		float flValue;
+	};
+
+	std::vector<float> m_vecSamples;
+	std::vector<uint32_t> m_vecBins;
+	uint32_t m_unNext;
+	uint32_t m_unCount;
+	float m_flBinWidth;
+
+	// samples that could still become the window maximum, in decreasing order
+	std::deque<MaxCandidate_t> m_dequeMax;
+	uint64_t m_ulSequence;
+};
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Fixed layout written into shared memory for out of process
+//			dashboards. Readers take ulWriteCount, copy the records they want,
+//			and discard anything older than ulWriteCount - unCapacity read
+//			again after the copy. The summary is guarded by a sequence counter
+//			that is odd while it is being written.
+//-----------------------------------------------------------------------------
+struct FrameTimingSharedRecord_t
+{
+	uint32_t unFrameIndex;
+	uint32_t unReprojectionFlags;
+	uint32_t unNumFramePresents;
+	uint32_t unNumDroppedFrames;
+	double flSystemTimeInSeconds;
+	float flTotalRenderGpuMs;
+	float flCompositorIdleCpuMs;
+	float flCompositorRenderCpuMs;
+	float flClientFrameIntervalMs;
+};
+
+struct FrameTimingSharedHeader_t
+{
+	uint32_t unMagic;
+	uint32_t unVersion;
+	uint32_t unCapacity;
+	uint32_t unRecordSize;
+	volatile uint64_t ulWriteCount;
+	volatile uint32_t unSummarySequence;
+	uint32_t unPad;
+	FrameTimingSummary_t summary;
+	// FrameTimingSharedRecord_t records[ unCapacity ] follow
+};
+
+static const uint32_t k_unFrameTimingSharedMagic = 0x31415446; // "FTA1"
+static const uint32_t k_unFrameTimingSharedVersion = 1;
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Polls frame timings incrementally and keeps rolling statistics.
+//
+//			Each Poll() fetches the newest k_unMaxFramesPerPoll entries in a
+//			single call and consumes those whose m_nFrameIndex is past the last
+//			one seen, so the compositor can't advance between deciding how much
+//			to read and reading it. New frames feed a short and a long window per
+//			metric; when the short window's P95 drifts well past the long
+//			window's, a regression event is raised, and another when it
+//			settles again.
+//-----------------------------------------------------------------------------
+class CFrameTimingAnalytics
+{
+public:
+	typedef std::function< void( const FrameTimingRegressionEvent_t &event ) > RegressionCallback_t;
+
+	CFrameTimingAnalytics();
+	~CFrameTimingAnalytics();
+
+	/** returns the number of new frames consumed */
+	uint32_t Poll( IFrameTimingSource *pSource );
+
+	void Reset();
+
+	FrameTimingSummary_t GetSummary() const;
+	FrameTimingPercentiles_t GetShortWindowPercentiles( EFrameTimingMetric eMetric ) const;
+	bool GetCumulativeStats( vr::Compositor_CumulativeStats *pStats ) const;
+
+	void SetRegressionCallback( RegressionCallback_t fnCallback ) { m_fnRegression = fnCallback; }
+	const std::vector<FrameTimingRegressionEvent_t> &GetRegressionEvents() const { return m_vecRegressionEvents; }
+
+	/** appends every new frame to a CSV that CFrameTimingReplaySource can play back */
+	bool StartRecording( const std::string &sPath );
+	void StopRecording();
+
+	/** the app renders at flScale from compositor frame unFrameIndex on. Recorded with each frame so replays can undo it. */
+	void SetRenderScale( uint32_t unFrameIndex, float flScale );
+
+	/** writes the summary, cumulative stats and regression events as JSON */
+	bool ExportJson( const std::string &sPath ) const;
+
+	/** publishes new frames and the summary to a named shared memory ring */
+	bool OpenSharedRing( const char *pchName, uint32_t unCapacity );
+	void CloseSharedRing();
+
+	static const uint32_t k_unShortWindow = 90;
+	static const uint32_t k_unLongWindow = 1800;
+	static const uint32_t k_unMaxFramesPerPoll = 128;
+
+private:
+	void ConsumeFrame( const vr::Compositor_FrameTiming &timing );
+	void CheckRegressions( uint32_t unFrameIndex );
+	void CheckRegression( EFrameTimingRegression eKind, bool *pbActive, float flShort, float flLong, float flTrigger, float flClear, uint32_t unFrameIndex );
+	void PublishShared( const vr::Compositor_FrameTiming &timing );
+	void PublishSharedSummary();
+
+	static float MetricValue( const vr::Compositor_FrameTiming &timing, EFrameTimingMetric eMetric );
+
+	bool m_bHaveLastFrame;
+	uint32_t m_unLastFrameIndex;
+	std::vector<vr::Compositor_FrameTiming> m_vecScratch;
+
+	std::vector<CRollingHistogram> m_vecShort;
+	std::vector<CRollingHistogram> m_vecLong;
+	std::vector<uint8_t> m_vecShortReprojected;
+	uint32_t m_unShortReprojectedCount;
+	uint32_t m_unShortReprojectedNext;
+
+	FrameTimingSummary_t m_summary;
+	bool m_bHaveCumulativeStats;
+	vr::Compositor_CumulativeStats m_cumulativeStats;
+
+	bool m_rgbRegressionActive[ 3 ];
+	std::vector<FrameTimingRegressionEvent_t> m_vecRegressionEvents;
+	RegressionCallback_t m_fnRegression;
+
+	FILE *m_pRecordFile;
+
+	struct RenderScaleChange_t
+	{
+		uint32_t unFrameIndex;
+		float flScale;
+	};
+	std::deque<RenderScaleChange_t> m_dequeRenderScales;	// oldest first; the front applies to the frames being consumed
+
+	std::string m_sSharedName;
+	FrameTimingSharedHeader_t *m_pShared;
+	size_t m_unSharedSize;
+	void *m_hSharedMapping;
+};
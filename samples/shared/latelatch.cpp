@@ -0,0 +1,149 @@
+//========= Copyright Valve Corporation ============//
+#include "latelatch.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <chrono>
+
+static Matrix4 ConvertPoseToMatrix4( const vr::HmdMatrix34_t &matPose )
+{
+	return Matrix4(
+		matPose.m[0][0], matPose.m[1][0], matPose.m[2][0], 0.0,
+		matPose.m[0][1], matPose.m[1][1], matPose.m[2][1], 0.0,
+		matPose.m[0][2], matPose.m[1][2], matPose.m[2][2], 0.0,
+		matPose.m[0][3], matPose.m[1][3], matPose.m[2][3], 1.0f
+		);
+}
+
+
+static vr::HmdMatrix34_t ConvertMatrix4ToPose( const Matrix4 &mat )
+{
+	const float *pflMat = mat.get();
+	vr::HmdMatrix34_t matPose;
+	for ( int nRow = 0; nRow < 3; nRow++ )
+	{
+		for ( int nColumn = 0; nColumn < 4; nColumn++ )
+		{
+			matPose.m[ nRow ][ nColumn ] = pflMat[ nColumn * 4 + nRow ];
+		}
+	}
+	return matPose;
+}
+
+
+static uint64_t GetTicksNs()
+{
+	return (uint64_t)std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+
+CLateLatchPoseRing::CLateLatchPoseRing()
+	: m_pHMD( nullptr )
+	, m_unSlot( k_unSlots - 1 )
+	, m_unPosePredictionID( 0 )
+	, m_bHavePredictionID( false )
+	, m_ulBeginTicks( 0 )
+{
+	memset( &m_matRecordedPose, 0, sizeof( m_matRecordedPose ) );
+	m_matRecordedPose.m[0][0] = m_matRecordedPose.m[1][1] = m_matRecordedPose.m[2][2] = 1.f;
+	m_matSlotPose = m_matRecordedPose;
+	m_matDelta = m_matRecordedPose;
+	memset( &m_stats, 0, sizeof( m_stats ) );
+}
+
+
+void CLateLatchPoseRing::SetEyeTransforms( const Matrix4 &matLeft, const Matrix4 &matRight )
+{
+	m_rmat4Eye[ vr::Eye_Left ] = matLeft;
+	m_rmat4Eye[ vr::Eye_Right ] = matRight;
+}
+
+
+void CLateLatchPoseRing::WriteSlot( const vr::HmdMatrix34_t &matHmdPose )
+{
+	Matrix4 matView = ConvertPoseToMatrix4( matHmdPose );
+	matView.invert();
+
+	for ( int nEye = vr::Eye_Left; nEye <= vr::Eye_Right; nEye++ )
+	{
+		m_rmat4ViewProjection[ nEye ] = m_rmat4Eye[ nEye ] * matView;
+		memcpy( GetSlotMatrix( m_unSlot, (vr::EVREye)nEye ), m_rmat4ViewProjection[ nEye ].get(), 16 * sizeof( float ) );
+	}
+	FlushSlot( m_unSlot );
+	m_matSlotPose = matHmdPose;
+}
+
+
+uint32_t CLateLatchPoseRing::BeginFrame( vr::IVRSystem *pHMD, const vr::TrackedDevicePose_t &hmdPose )
+{
+	m_pHMD = pHMD;
+	m_unSlot = ( m_unSlot + 1 ) % k_unSlots;
+	AcquireSlot( m_unSlot );
+	m_ulBeginTicks = GetTicksNs();
+	m_stats.ulFrames++;
+
+	// the prediction ID names the frame WaitGetPoses predicted for, so Latch can ask about the same one
+	uint32_t unGamePosePredictionID;
+	m_bHavePredictionID = vr::VRCompositor() &&
+		vr::VRCompositor()->GetLastPosePredictionIDs( &m_unPosePredictionID, &unGamePosePredictionID ) == vr::VRCompositorError_None;
+
+	if ( hmdPose.bPoseIsValid )
+		m_matRecordedPose = hmdPose.mDeviceToAbsoluteTracking;
+
+	WriteSlot( m_matRecordedPose );
+	return m_unSlot;
+}
+
+
+bool CLateLatchPoseRing::Latch()
+{
+	if ( !m_pHMD || !vr::VRCompositor() )
+		return false;
+
+	vr::TrackedDevicePose_t hmdPose;
+	hmdPose.bPoseIsValid = false;
+	if ( m_bHavePredictionID )
+		vr::VRCompositor()->GetPosesForFrame( m_unPosePredictionID, &hmdPose, 1 );
+
+	if ( !hmdPose.bPoseIsValid )
+	{
+		// predict to the same photons ourselves
+		float flSecondsSinceLastVsync;
+		uint64_t ulFrameCounter;
+		float flDisplayFrequency = m_pHMD->GetFloatTrackedDeviceProperty( vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_DisplayFrequency_Float );
+		float flVsyncToPhotons = m_pHMD->GetFloatTrackedDeviceProperty( vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_SecondsFromVsyncToPhotons_Float );
+		if ( !m_pHMD->GetTimeSinceLastVsync( &flSecondsSinceLastVsync, &ulFrameCounter ) || !( flDisplayFrequency > 0.f ) )
+			return false;
+
+		float flPredictedSeconds = 1.f / flDisplayFrequency - flSecondsSinceLastVsync + flVsyncToPhotons;
+		m_pHMD->GetDeviceToAbsoluteTrackingPose( vr::VRCompositor()->GetTrackingSpace(), flPredictedSeconds, &hmdPose, 1 );
+		m_stats.ulFallbackQueries++;
+		if ( !hmdPose.bPoseIsValid )
+			return false;
+	}
+
+	WriteSlot( hmdPose.mDeviceToAbsoluteTracking );
+
+	Matrix4 matDelta = ConvertPoseToMatrix4( m_matRecordedPose );
+	matDelta.invert();
+	matDelta = matDelta * ConvertPoseToMatrix4( hmdPose.mDeviceToAbsoluteTracking );
+	m_matDelta = ConvertMatrix4ToPose( matDelta );
+
+	float flCos = ( m_matDelta.m[0][0] + m_matDelta.m[1][1] + m_matDelta.m[2][2] - 1.f ) * 0.5f;
+	flCos = flCos > 1.f ? 1.f : ( flCos < -1.f ? -1.f : flCos );
+	m_stats.flLastDeltaDegrees = acosf( flCos ) * ( 180.f / 3.14159265f );
+	m_stats.flLastDeltaMeters = sqrtf( m_matDelta.m[0][3] * m_matDelta.m[0][3] + m_matDelta.m[1][3] * m_matDelta.m[1][3] + m_matDelta.m[2][3] * m_matDelta.m[2][3] );
+	m_stats.flLastLatchDelayMs = ( GetTicksNs() - m_ulBeginTicks ) / 1000000.f;
+	m_stats.ulLatched++;
+	return true;
+}
+
+
+void CLateLatchPoseRing::FillTextureWithPose( const vr::Texture_t &texture, vr::VRTextureWithPose_t *pTextureWithPose ) const
+{
+	pTextureWithPose->handle = texture.handle;
+	pTextureWithPose->eType = texture.eType;
+	pTextureWithPose->eColorSpace = texture.eColorSpace;
+	pTextureWithPose->mDeviceToAbsoluteTracking = m_matSlotPose;
+}
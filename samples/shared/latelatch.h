@@ -0,0 +1,96 @@
+//========= Copyright Valve Corporation ============//
+#pragma once
+
+#include <openvr.h>
+
+#include <stdint.h>
+
+#include "Matrices.h"
+
+struct LateLatchStats_t
+{
+	uint64_t ulFrames;
+	uint64_t ulLatched;				// frames that got a fresher pose than the one they were recorded with
+	uint64_t ulFallbackQueries;		// latches that had to predict with GetDeviceToAbsoluteTrackingPose
+	float flLastDeltaDegrees;		// rotation between the recorded and latched head pose
+	float flLastDeltaMeters;
+	float flLastLatchDelayMs;		// time from BeginFrame to Latch, which is roughly the latency saved
+};
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Late latching of the head pose.
+//
+//			Draw calls are recorded against a slot in a ring of persistently
+//			mapped uniform buffers that holds each eye's view-projection
+//			matrix. BeginFrame fills the slot from the pose WaitGetPoses
+//			returned. Latch asks the compositor for the newest prediction of
+//			that same frame and overwrites the slot, so the GPU renders with a
+//			pose several milliseconds fresher. Call it as late as the API
+//			allows before the GPU can read the slot: after recording but
+//			before submitting a Vulkan command buffer, or just before issuing
+//			the GL draws, since GL may start executing them right away. The
+//			pose that ended up in the slot is what FillTextureWithPose hands
+//			to the compositor for reprojection.
+//
+//			Graphics APIs derive from this and provide the mapped storage.
+//			Either the ring has enough slots to cover the frames the GPU may
+//			still be reading, or AcquireSlot waits for the GPU to finish
+//			with a slot before it is rewritten.
+//-----------------------------------------------------------------------------
+class CLateLatchPoseRing
+{
+public:
+	CLateLatchPoseRing();
+	virtual ~CLateLatchPoseRing() {}
+
+	static const uint32_t k_unSlots = 3;
+
+	/** per eye projection * eye-from-head, so that view-projection = matEye * inverse( hmd pose ) */
+	void SetEyeTransforms( const Matrix4 &matLeft, const Matrix4 &matRight );
+
+	/** starts a frame with the pose it will be recorded with. Returns the slot to bind. */
+	uint32_t BeginFrame( vr::IVRSystem *pHMD, const vr::TrackedDevicePose_t &hmdPose );
+	uint32_t GetCurrentSlot() const { return m_unSlot; }
+
+	/** re-queries the head pose for the current frame and rewrites its slot. Returns false if the recorded pose stands. */
+	bool Latch();
+
+	/** pose of the current slot, for VRTextureWithPose_t */
+	void FillTextureWithPose( const vr::Texture_t &texture, vr::VRTextureWithPose_t *pTextureWithPose ) const;
+
+	/** latched pose relative to the recorded one, in the recorded head space */
+	const vr::HmdMatrix34_t &GetLastDelta() const { return m_matDelta; }
+
+	const LateLatchStats_t &GetStats() const { return m_stats; }
+
+	/** the view-projection in the current slot, as last written */
+	const Matrix4 &GetViewProjection( vr::EVREye eEye ) const { return m_rmat4ViewProjection[ eEye ]; }
+
+protected:
+	/** storage for one eye's column-major 4x4 in a slot */
+	virtual float *GetSlotMatrix( uint32_t unSlot, vr::EVREye eEye ) = 0;
+
+	/** called before BeginFrame rewrites a slot, for storage the GPU may still be reading */
+	virtual void AcquireSlot( uint32_t ) {}
+
+	/** called after a slot is written, for storage that isn't coherent */
+	virtual void FlushSlot( uint32_t ) {}
+
+private:
+	void WriteSlot( const vr::HmdMatrix34_t &matHmdPose );
+
+	vr::IVRSystem *m_pHMD;
+	Matrix4 m_rmat4Eye[ 2 ];
+	Matrix4 m_rmat4ViewProjection[ 2 ];
+
+	uint32_t m_unSlot;
+	uint32_t m_unPosePredictionID;
+	bool m_bHavePredictionID;
+	vr::HmdMatrix34_t m_matRecordedPose;
+	vr::HmdMatrix34_t m_matSlotPose;
+	vr::HmdMatrix34_t m_matDelta;
+	uint64_t m_ulBeginTicks;
+
+	LateLatchStats_t m_stats;
+};
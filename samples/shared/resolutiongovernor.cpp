@@ -0,0 +1,252 @@
+//========= Copyright Valve Corporation ============//
+#include "resolutiongovernor.h"
+#include "frametiminganalytics.h"
+
+#include <math.h>
+#include <string.h>
+
+// utilization below this is treated as this when normalizing the controller step
+static const float k_flMinUtilization = 0.05f;
+
+ResolutionGovernorSettings_t DefaultResolutionGovernorSettings()
+{
+	ResolutionGovernorSettings_t settings;
+	settings.flMinScale = 0.5f;
+	settings.flMaxScale = 1.0f;
+	settings.flTargetUtilization = 0.85f;
+	settings.flKp = 0.3f;
+	settings.flKi = 0.1f;
+	settings.flKd = 0.05f;
+	settings.flHysteresis = 0.04f;
+	settings.unHoldFramesDown = 3;
+	settings.unHoldFramesUp = 45;
+	settings.flPanicFactor = 0.8f;
+	return settings;
+}
+
+
+static float Clamp( float flValue, float flMin, float flMax )
+{
+	return flValue < flMin ? flMin : ( flValue > flMax ? flMax : flValue );
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Governor
+//-----------------------------------------------------------------------------
+CResolutionGovernor::CResolutionGovernor()
+	: m_settings( DefaultResolutionGovernorSettings() )
+	, m_flFrameBudgetMs( 1000.f / 90.f )
+{
+	Reset();
+}
+
+
+CResolutionGovernor::CResolutionGovernor( const ResolutionGovernorSettings_t &settings )
+	: m_settings( settings )
+	, m_flFrameBudgetMs( 1000.f / 90.f )
+{
+	Reset();
+}
+
+
+void CResolutionGovernor::Reset()
+{
+	m_bHaveLastFrame = false;
+	m_unLastFrameIndex = 0;
+	m_flPixelFraction = m_settings.flMaxScale * m_settings.flMaxScale;
+	m_flLastError = 0.f;
+	m_flPrevError = 0.f;
+	m_unErrorSamples = 0;
+	m_flScale = m_settings.flMaxScale;
+	m_unFramesSinceChange = 0;
+	m_unScaleChanges = 0;
+}
+
+
+float CResolutionGovernor::GetRequestedScale() const
+{
+	return sqrtf( m_flPixelFraction );
+}
+
+
+bool CResolutionGovernor::Update( const vr::Compositor_FrameTiming &timing )
+{
+	if ( m_bHaveLastFrame && timing.m_nFrameIndex == m_unLastFrameIndex )
+		return false;
+
+	// the compositor reports 0 until the GPU queries for the frame come back, so
+	// only remember the index once it has carried a GPU time and can't be used again
+	if ( !( timing.m_flTotalRenderGpuMs > 0.f ) || !( m_flFrameBudgetMs > 0.f ) )
+		return false;
+	m_bHaveLastFrame = true;
+	m_unLastFrameIndex = timing.m_nFrameIndex;
+
+	m_unFramesSinceChange++;
+
+	float flUtilization = timing.m_flTotalRenderGpuMs / m_flFrameBudgetMs;
+	bool bMissed = timing.m_nNumMisPresented > 0 || timing.m_nNumDroppedFrames > 0
+		|| ( timing.m_nReprojectionFlags & vr::VRCompositor_ReprojectionReason_Gpu ) != 0;
+
+	float flMinFraction = m_settings.flMinScale * m_settings.flMinScale;
+	float flMaxFraction = m_settings.flMaxScale * m_settings.flMaxScale;
+	if ( bMissed )
+	{
+		// don't wait for the controller to notice, and start its history over
+		m_flPixelFraction = Clamp( m_flScale * m_flScale * m_settings.flPanicFactor, flMinFraction, flMaxFraction );
+		m_unErrorSamples = 0;
+	}
+	else
+	{
+		float flError = m_settings.flTargetUtilization - flUtilization;
+		float flLastError = m_unErrorSamples > 0 ? m_flLastError : flError;
+		float flPrevError = m_unErrorSamples > 1 ? m_flPrevError : flLastError;
+
+		float flStep = m_settings.flKp * ( flError - flLastError )
+			+ m_settings.flKi * flError
+			+ m_settings.flKd * ( flError - 2.f * flLastError + flPrevError );
+
+		// GPU time is roughly proportional to the pixels drawn at the applied scale,
+		// so convert the utilization step into a pixel fraction step
+		float flAppliedFraction = m_flScale * m_flScale;
+		float flUtilizationPerFraction = ( flUtilization > k_flMinUtilization ? flUtilization : k_flMinUtilization ) / flAppliedFraction;
+		m_flPixelFraction = Clamp( m_flPixelFraction + flStep / flUtilizationPerFraction, flMinFraction, flMaxFraction );
+
+		m_flPrevError = flLastError;
+		m_flLastError = flError;
+		m_unErrorSamples++;
+	}
+
+	float flRequested = GetRequestedScale();
+	float flDelta = flRequested - m_flScale;
+	bool bApply = false;
+	if ( bMissed && flDelta < 0.f )
+		bApply = true;
+	else if ( flDelta <= -m_settings.flHysteresis && m_unFramesSinceChange >= m_settings.unHoldFramesDown )
+		bApply = true;
+	else if ( flDelta >= m_settings.flHysteresis && m_unFramesSinceChange >= m_settings.unHoldFramesUp )
+		bApply = true;
+	else if ( flDelta != 0.f && ( flRequested == m_settings.flMinScale || flRequested == m_settings.flMaxScale )
+		&& m_unFramesSinceChange >= ( flDelta < 0.f ? m_settings.unHoldFramesDown : m_settings.unHoldFramesUp ) )
+		bApply = true;		// settle exactly on the limits even when they are closer than the hysteresis
+
+	if ( !bApply )
+	{
+		// while the hold time runs, don't let the controller wind up past one
+		// hysteresis step from what is actually being rendered
+		if ( flDelta > m_settings.flHysteresis || flDelta < -m_settings.flHysteresis )
+		{
+			float flLimit = m_flScale + ( flDelta > 0.f ? m_settings.flHysteresis : -m_settings.flHysteresis );
+			m_flPixelFraction = Clamp( flLimit * flLimit, flMinFraction, flMaxFraction );
+		}
+		return false;
+	}
+
+	m_flScale = flRequested;
+	m_unFramesSinceChange = 0;
+	m_unScaleChanges++;
+	return true;
+}
+
+
+void CResolutionGovernor::GetViewportSize( uint32_t unWidth, uint32_t unHeight, uint32_t *punViewportWidth, uint32_t *punViewportHeight ) const
+{
+	uint32_t unViewportWidth = (uint32_t)( unWidth * m_flScale + 0.5f );
+	uint32_t unViewportHeight = (uint32_t)( unHeight * m_flScale + 0.5f );
+	*punViewportWidth = unViewportWidth < 1 ? 1 : ( unViewportWidth > unWidth ? unWidth : unViewportWidth );
+	*punViewportHeight = unViewportHeight < 1 ? 1 : ( unViewportHeight > unHeight ? unHeight : unViewportHeight );
+}
+
+
+vr::VRTextureBounds_t CResolutionGovernor::GetTextureBounds( uint32_t unWidth, uint32_t unHeight ) const
+{
+	uint32_t unViewportWidth, unViewportHeight;
+	GetViewportSize( unWidth, unHeight, &unViewportWidth, &unViewportHeight );
+
+	// derived from the rounded viewport so the compositor samples exactly the texels drawn
+	vr::VRTextureBounds_t bounds;
+	bounds.uMin = 0.f;
+	bounds.vMin = 0.f;
+	bounds.uMax = unWidth ? (float)unViewportWidth / unWidth : 1.f;
+	bounds.vMax = unHeight ? (float)unViewportHeight / unHeight : 1.f;
+	return bounds;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Simulation harness
+//-----------------------------------------------------------------------------
+bool SimulateResolutionGovernor( CFrameTimingReplaySource *pReplay, CResolutionGovernor *pGovernor, float flFixedCostFraction,
+	ResolutionGovernorSimResult_t *pResult, FILE *pPerFrameCsv )
+{
+	memset( pResult, 0, sizeof( *pResult ) );
+	pResult->flMinScale = pGovernor->GetScale();
+
+	const float flBudgetMs = pGovernor->GetFrameBudgetMs();
+	float flFixed = Clamp( flFixedCostFraction, 0.f, 1.f );
+
+	// simulated timings the governor has not been given yet
+	vr::Compositor_FrameTiming rgPending[ k_unResolutionSimLatency + 1 ];
+	uint32_t unPending = 0;
+	double flScaleSum = 0.0;
+	double flUtilizationSum = 0.0;
+
+	if ( pPerFrameCsv )
+		fprintf( pPerFrameCsv, "frame,recordedGpuMs,simulatedGpuMs,scale,requestedScale\n" );
+
+	while ( pReplay->Advance( 1 ) )
+	{
+		vr::Compositor_FrameTiming timing;
+		if ( pReplay->GetFrameTimings( &timing, 1 ) != 1 )
+			break;
+
+		// undo the scale the frame was recorded at, then apply the simulated one
+		float flRecordedMs = timing.m_flTotalRenderGpuMs;
+		float flRecordedScale = pReplay->GetRenderScale();
+		float flNativeMs = flRecordedMs / ( flFixed + ( 1.f - flFixed ) * flRecordedScale * flRecordedScale );
+		float flScale = pGovernor->GetScale();
+		float flSimulatedMs = flNativeMs * ( flFixed + ( 1.f - flFixed ) * flScale * flScale );
+
+		// what the compositor would have reported had the frame been rendered at flScale
+		timing.m_flTotalRenderGpuMs = flSimulatedMs;
+		timing.m_nReprojectionFlags &= ~( vr::VRCompositor_ReprojectionReason_Cpu | vr::VRCompositor_ReprojectionReason_Gpu );
+		timing.m_nNumMisPresented = 0;
+		timing.m_nNumDroppedFrames = 0;
+		if ( flSimulatedMs > flBudgetMs )
+		{
+			timing.m_nReprojectionFlags |= vr::VRCompositor_ReprojectionReason_Gpu;
+			pResult->unOverBudgetFrames++;
+		}
+		if ( flRecordedMs > flBudgetMs )
+			pResult->unOverBudgetFramesNative++;
+
+		pResult->unFrames++;
+		flScaleSum += flScale;
+		flUtilizationSum += flSimulatedMs / flBudgetMs;
+		if ( flScale < pResult->flMinScale )
+			pResult->flMinScale = flScale;
+
+		if ( pPerFrameCsv )
+		{
+			fprintf( pPerFrameCsv, "%u,%.4f,%.4f,%.4f,%.4f\n", timing.m_nFrameIndex, flRecordedMs, flSimulatedMs,
+				flScale, pGovernor->GetRequestedScale() );
+		}
+
+		// deliver the timing from k_unResolutionSimLatency frames ago
+		rgPending[ unPending++ ] = timing;
+		if ( unPending > k_unResolutionSimLatency )
+		{
+			pGovernor->Update( rgPending[ 0 ] );
+			memmove( &rgPending[ 0 ], &rgPending[ 1 ], k_unResolutionSimLatency * sizeof( rgPending[ 0 ] ) );
+			unPending--;
+		}
+	}
+
+	if ( pResult->unFrames == 0 )
+		return false;
+
+	pResult->unScaleChanges = pGovernor->GetScaleChangeCount();
+	pResult->flMeanScale = (float)( flScaleSum / pResult->unFrames );
+	pResult->flMeanUtilization = (float)( flUtilizationSum / pResult->unFrames );
+	return true;
+}
@@ -0,0 +1,122 @@
+//========= Copyright Valve Corporation ============//
+#pragma once
+
+#include <openvr.h>
+
+#include <stdint.h>
+#include <stdio.h>
+
+class CFrameTimingReplaySource;
+
+struct ResolutionGovernorSettings_t
+{
+	float flMinScale;				// per axis
+	float flMaxScale;
+	float flTargetUtilization;		// fraction of the frame budget the GPU should use
+
+	// gains of the velocity form PID, acting on the pixel fraction (scale squared)
+	float flKp;
+	float flKi;
+	float flKd;
+
+	float flHysteresis;				// smallest per axis scale change worth applying
+	uint32_t unHoldFramesDown;		// frames to wait after a change before scaling down again
+	uint32_t unHoldFramesUp;		// ... and before scaling up, which should be more cautious
+	float flPanicFactor;			// pixel fraction multiplier when a frame misses vsync
+};
+
+/** reasonable defaults for a pixel bound renderer */
+ResolutionGovernorSettings_t DefaultResolutionGovernorSettings();
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Picks a per eye render scale from compositor frame timings.
+//
+//			Each new Compositor_FrameTiming gives GPU utilization against the
+//			frame budget. A PID controller in velocity form steers the
+//			fraction of pixels rendered toward the target utilization, with
+//			the step normalized by the current pixel cost so the response is
+//			the same at any scale. Mis-presented or GPU reprojected frames
+//			cut the resolution immediately. The applied scale only moves when
+//			the controller disagrees with it by more than the hysteresis and
+//			the hold time since the last change has passed, so the image
+//			doesn't shimmer between nearby sizes.
+//
+//			Render targets stay at the recommended size; render into the
+//			viewport from GetViewportSize and pass GetTextureBounds to Submit.
+//-----------------------------------------------------------------------------
+class CResolutionGovernor
+{
+public:
+	CResolutionGovernor();
+	explicit CResolutionGovernor( const ResolutionGovernorSettings_t &settings );
+
+	void Reset();
+
+	/** usually 1000 / Prop_DisplayFrequency_Float */
+	void SetFrameBudgetMs( float flFrameBudgetMs ) { m_flFrameBudgetMs = flFrameBudgetMs; }
+	float GetFrameBudgetMs() const { return m_flFrameBudgetMs; }
+
+	/** feed the newest completed timing every frame (unFramesAgo 1; the current frame has no GPU time yet).
+		Repeated frame indices and timings without GPU time are ignored. Returns true if the applied scale changed. */
+	bool Update( const vr::Compositor_FrameTiming &timing );
+
+	/** the applied per axis scale */
+	float GetScale() const { return m_flScale; }
+
+	/** what the controller would like, before hysteresis */
+	float GetRequestedScale() const;
+
+	/** viewport inside a render target of unWidth x unHeight, anchored at the texture origin */
+	void GetViewportSize( uint32_t unWidth, uint32_t unHeight, uint32_t *punViewportWidth, uint32_t *punViewportHeight ) const;
+
+	/** bounds to submit for that viewport. The origin is texel (0,0) for both GL and Vulkan textures. */
+	vr::VRTextureBounds_t GetTextureBounds( uint32_t unWidth, uint32_t unHeight ) const;
+
+	uint32_t GetScaleChangeCount() const { return m_unScaleChanges; }
+
+private:
+	ResolutionGovernorSettings_t m_settings;
+	float m_flFrameBudgetMs;
+
+	bool m_bHaveLastFrame;
+	uint32_t m_unLastFrameIndex;
+
+	float m_flPixelFraction;		// controller state
+	float m_flLastError;
+	float m_flPrevError;
+	uint32_t m_unErrorSamples;
+
+	float m_flScale;
+	uint32_t m_unFramesSinceChange;
+	uint32_t m_unScaleChanges;
+};
+
+
+struct ResolutionGovernorSimResult_t
+{
+	uint32_t unFrames;
+	uint32_t unOverBudgetFrames;		// simulated frames that would have missed vsync
+	uint32_t unOverBudgetFramesNative;	// frames over budget in the recording itself
+	uint32_t unScaleChanges;
+	float flMeanScale;
+	float flMinScale;
+	float flMeanUtilization;
+};
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Runs a governor over a recorded trace to tune its settings
+//			offline. Each frame's GPU time is first brought back to scale 1.0
+//			using the render scale recorded with it, then rescaled by the pixel
+//			fraction the simulated governor had in effect, with
+//			flFixedCostFraction of it not depending on resolution. Timings
+//			reach the governor k_unResolutionSimLatency frames late, as they
+//			do from the compositor.
+//
+//			If pPerFrameCsv is set, one row per frame is written to it.
+//-----------------------------------------------------------------------------
+static const uint32_t k_unResolutionSimLatency = 2;
+
+bool SimulateResolutionGovernor( CFrameTimingReplaySource *pReplay, CResolutionGovernor *pGovernor, float flFixedCostFraction,
+	ResolutionGovernorSimResult_t *pResult, FILE *pPerFrameCsv );
@@ -0,0 +1,60 @@
+//========= Copyright Valve Corporation ============//
+#include "stereopassstats.h"
+
+#include <string.h>
+
+CStereoPassStats::CStereoPassStats( uint32_t unReportFrames )
+	: m_unReportFrames( unReportFrames ? unReportFrames : 1 )
+	, m_unFrames( 0 )
+	, m_ulDrawCalls( 0 )
+	, m_unTimedFrames( 0 )
+	, m_flGpuMs( 0.0 )
+	, m_unCpuTimedFrames( 0 )
+	, m_flCpuMs( 0.0 )
+{
+}
+
+
+void CStereoPassStats::AddDrawCalls( uint32_t unDrawCalls )
+{
+	m_unFrames++;
+	m_ulDrawCalls += unDrawCalls;
+}
+
+
+void CStereoPassStats::AddGpuTime( float flGpuMs )
+{
+	m_unTimedFrames++;
+	m_flGpuMs += flGpuMs;
+}
+
+
+void CStereoPassStats::AddCpuTime( float flCpuMs )
+{
+	m_unCpuTimedFrames++;
+	m_flCpuMs += flCpuMs;
+}
+
+
+bool CStereoPassStats::BGetReport( StereoPassReport_t *pReport )
+{
+	if ( m_unFrames < m_unReportFrames )
+		return false;
+
+	memset( pReport, 0, sizeof( *pReport ) );
+	pReport->unFrames = m_unFrames;
+	pReport->flDrawCallsPerFrame = ( float )m_ulDrawCalls / m_unFrames;
+	pReport->unTimedFrames = m_unTimedFrames;
+	if ( m_unTimedFrames )
+		pReport->flGpuMsPerFrame = ( float )( m_flGpuMs / m_unTimedFrames );
+	if ( m_unCpuTimedFrames )
+		pReport->flCpuMsPerFrame = ( float )( m_flCpuMs / m_unCpuTimedFrames );
+
+	m_unFrames = 0;
+	m_ulDrawCalls = 0;
+	m_unTimedFrames = 0;
+	m_flGpuMs = 0.0;
+	m_unCpuTimedFrames = 0;
+	m_flCpuMs = 0.0;
+	return true;
+}
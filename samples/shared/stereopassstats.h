@@ -0,0 +1,43 @@
+//========= Copyright Valve Corporation ============//
+#pragma once
+
+#include <stdint.h>
+
+struct StereoPassReport_t
+{
+	uint32_t unFrames;
+	float flDrawCallsPerFrame;		// CPU side draw calls recorded for both eyes
+	float flGpuMsPerFrame;			// GPU time of the stereo pass, over the frames that had a timer result
+	uint32_t unTimedFrames;
+	float flCpuMsPerFrame;			// CPU time spent submitting the stereo pass, when the sample measures it
+};
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Averages the cost of rendering both eyes, so a run with the
+//			multiview path can be compared against one that renders each eye
+//			separately. Samples add one frame at a time; the GPU time of a
+//			frame usually arrives a few frames after its draw calls were
+//			counted, so the two are added separately.
+//-----------------------------------------------------------------------------
+class CStereoPassStats
+{
+public:
+	explicit CStereoPassStats( uint32_t unReportFrames = 90 );
+
+	void AddDrawCalls( uint32_t unDrawCalls );
+	void AddGpuTime( float flGpuMs );
+	void AddCpuTime( float flCpuMs );
+
+	/** true every unReportFrames frames of draw calls, with the averages since the last report */
+	bool BGetReport( StereoPassReport_t *pReport );
+
+private:
+	uint32_t m_unReportFrames;
+	uint32_t m_unFrames;
+	uint64_t m_ulDrawCalls;
+	uint32_t m_unTimedFrames;
+	double m_flGpuMs;
+	uint32_t m_unCpuTimedFrames;
+	double m_flCpuMs;
+};
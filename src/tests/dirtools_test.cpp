@@ -0,0 +1,207 @@
+//========= Copyright Valve Corporation ============//
+// Checks CDirectoryWriter's batch rules, including batches with more files
+// than the process may hold open, then times it against creating each
+// directory and writing each file through the full path, on tmpfs and on
+// whatever filesystem the build directory is on.
+
+#include "dirtools_public.h"
+#include "pathtools_public.h"
+#include "testharness.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <dirent.h>
+#include <ftw.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <chrono>
+#include <string>
+
+static int RemoveEntry( const char *pchPath, const struct stat *, int, struct FTW * )
+{
+	return remove( pchPath );
+}
+
+static void RemoveTree( const std::string &sPath )
+{
+	nftw( sPath.c_str(), RemoveEntry, 16, FTW_DEPTH | FTW_PHYS );
+}
+
+static int CountOpenFds()
+{
+	int nFds = 0;
+	DIR *pDir = opendir( "/proc/self/fd" );
+	if ( !pDir )
+		return -1;
+	while ( readdir( pDir ) )
+		nFds++;
+	closedir( pDir );
+	return nFds;
+}
+
+static int CountTempFiles( const std::string &sDirectory )
+{
+	int nTempFiles = 0;
+	DIR *pDir = opendir( sDirectory.c_str() );
+	if ( !pDir )
+		return -1;
+	while ( struct dirent *pEntry = readdir( pDir ) )
+	{
+		size_t unLength = strlen( pEntry->d_name );
+		if ( unLength > 4 && !strcmp( pEntry->d_name + unLength - 4, ".tmp" ) )
+			nTempFiles++;
+	}
+	closedir( pDir );
+	return nTempFiles;
+}
+
+static void TestBatches( const std::string &sRoot )
+{
+	int nFdsBefore = CountOpenFds();
+	{
+		CDirectoryWriter writer( FileWriteDurability_Full );
+		std::string sDirectory = sRoot + "/a/b";
+		CHECK( writer.BCreateDirectoryRecursive( sRoot + "/a/x/../b/" ) );
+		CHECK( Path_IsDirectory( sDirectory ) );
+
+		CHECK( writer.BWriteStringToFileAtomic( sDirectory + "/unbatched.json", "hello" ) );
+		CHECK( Path_ReadTextFile( sDirectory + "/unbatched.json" ) == "hello" );
+
+		// nothing shows until the commit
+		writer.BeginBatch();
+		CHECK( writer.BWriteStringToFileAtomic( sDirectory + "/first.json", "1" ) );
+		CHECK( writer.BWriteStringToFileAtomic( sRoot + "/a/second.json", "2" ) );
+		CHECK( !Path_Exists( sDirectory + "/first.json" ) );
+		CHECK( writer.CommitBatch() );
+		CHECK( Path_ReadTextFile( sDirectory + "/first.json" ) == "1" );
+		CHECK( Path_ReadTextFile( sRoot + "/a/second.json" ) == "2" );
+
+		// the last write to a path in a batch is the one that lands
+		writer.BeginBatch();
+		CHECK( writer.BWriteStringToFileAtomic( sDirectory + "/first.json", "replaced once" ) );
+		CHECK( writer.BWriteStringToFileAtomic( sRoot + "/a/x/../b/first.json", "replaced twice" ) );
+		CHECK( writer.CommitBatch() );
+		CHECK( Path_ReadTextFile( sDirectory + "/first.json" ) == "replaced twice" );
+		CHECK( CountTempFiles( sDirectory ) == 0 );
+
+		writer.BeginBatch();
+		CHECK( writer.BWriteStringToFileAtomic( sDirectory + "/first.json", "aborted" ) );
+		CHECK( writer.BWriteStringToFileAtomic( sDirectory + "/first.json", "aborted again" ) );
+		writer.AbortBatch();
+		CHECK( Path_ReadTextFile( sDirectory + "/first.json" ) == "replaced twice" );
+		CHECK( CountTempFiles( sDirectory ) == 0 );
+
+		// two writers batching the same file each keep their own temp file; the last commit lands
+		CDirectoryWriter otherWriter( FileWriteDurability_None );
+		writer.BeginBatch();
+		otherWriter.BeginBatch();
+		CHECK( writer.BWriteStringToFileAtomic( sDirectory + "/shared.json", "mine" ) );
+		CHECK( otherWriter.BWriteStringToFileAtomic( sDirectory + "/shared.json", "theirs" ) );
+		CHECK( CountTempFiles( sDirectory ) == 2 );
+		CHECK( writer.CommitBatch() );
+		CHECK( Path_ReadTextFile( sDirectory + "/shared.json" ) == "mine" );
+		CHECK( otherWriter.CommitBatch() );
+		CHECK( Path_ReadTextFile( sDirectory + "/shared.json" ) == "theirs" );
+		CHECK( CountTempFiles( sDirectory ) == 0 );
+
+		CHECK( !writer.BWriteStringToFileAtomic( sRoot + "/missing/file.json", "x" ) );
+
+		// more directories than the writer keeps handles for
+		for ( int i = 0; i < 200; i++ )
+			CHECK( writer.BCreateDirectoryRecursive( sRoot + "/many/" + std::to_string( i ) + "/sub" ) );
+		CHECK( writer.BWriteStringToFileAtomic( sRoot + "/many/7/sub/file.json", "ok" ) );
+	}
+	CHECK( CountOpenFds() == nFdsBefore );
+
+	// a batch of more files than the fd limit allows open at once
+	struct rlimit oldLimit;
+	CHECK( getrlimit( RLIMIT_NOFILE, &oldLimit ) == 0 );
+	struct rlimit lowLimit = oldLimit;
+	lowLimit.rlim_cur = 32;
+	CHECK( setrlimit( RLIMIT_NOFILE, &lowLimit ) == 0 );
+	{
+		CDirectoryWriter writer( FileWriteDurability_Data );
+		for ( int i = 0; i < 4; i++ )
+			CHECK( writer.BCreateDirectoryRecursive( sRoot + "/wide/d" + std::to_string( i ) ) );
+
+		writer.BeginBatch();
+		bool bAllWritten = true;
+		for ( int i = 0; i < 500; i++ )
+			bAllWritten = writer.BWriteStringToFileAtomic( sRoot + "/wide/d" + std::to_string( i % 4 ) + "/f" + std::to_string( i ) + ".json", std::to_string( i ).c_str() ) && bAllWritten;
+		CHECK( bAllWritten );
+		CHECK( writer.CommitBatch() );
+	}
+	CHECK( setrlimit( RLIMIT_NOFILE, &oldLimit ) == 0 );
+	CHECK( Path_ReadTextFile( sRoot + "/wide/d3/f499.json" ) == "499" );
+	CHECK( CountTempFiles( sRoot + "/wide/d0" ) == 0 );
+}
+
+static void BenchmarkWriter( const char *pchLabel, const std::string &sRoot )
+{
+	// settings-sized files spread over a few directories, the way the runtime writes them
+	const int k_nFiles = 200;
+	const std::string sData( 512, 'x' );
+	const char *rgchDurabilityNames[] = { "none", "data", "full" };
+
+	for ( int nDurability = FileWriteDurability_None; nDurability <= FileWriteDurability_Full; nDurability++ )
+	{
+		RemoveTree( sRoot );
+
+		double flOld = MeasureNsPerCall( [&]
+		{
+			for ( int i = 0; i < k_nFiles; i++ )
+			{
+				std::string sDirectory = sRoot + "/old/d" + std::to_string( i % 8 );
+				BCreateDirectoryRecursive( sDirectory.c_str() );
+				Path_WriteStringToTextFileAtomic( sDirectory + "/f" + std::to_string( i ) + ".json", sData.c_str() );
+			}
+			return k_nFiles;
+		} ) / 1e6;
+
+		CDirectoryWriter writer( ( EFileWriteDurability )nDurability );
+		double flWriter = MeasureNsPerCall( [&]
+		{
+			for ( int i = 0; i < k_nFiles; i++ )
+			{
+				std::string sDirectory = sRoot + "/writer/d" + std::to_string( i % 8 );
+				writer.BCreateDirectoryRecursive( sDirectory );
+				writer.BWriteStringToFileAtomic( sDirectory + "/f" + std::to_string( i ) + ".json", sData );
+			}
+			return k_nFiles;
+		} ) / 1e6;
+		double flBatched = MeasureNsPerCall( [&]
+		{
+			writer.BeginBatch();
+			for ( int i = 0; i < k_nFiles; i++ )
+			{
+				std::string sDirectory = sRoot + "/batched/d" + std::to_string( i % 8 );
+				writer.BCreateDirectoryRecursive( sDirectory );
+				writer.BWriteStringToFileAtomic( sDirectory + "/f" + std::to_string( i ) + ".json", sData );
+			}
+			return writer.CommitBatch();
+		} ) / 1e6;
+
+		printf( "%-5s durability %s, %d files: full paths without syncing %7.2f ms, writer %7.2f ms, batched %7.2f ms\n",
+			pchLabel, rgchDurabilityNames[ nDurability ], k_nFiles, flOld, flWriter, flBatched );
+	}
+	RemoveTree( sRoot );
+}
+
+int main( int argc, char *argv[] )
+{
+	ParseTestArgs( argc, argv );
+
+	std::string sSuffix = "/dirtools_test_" + std::to_string( getpid() );
+	std::string sDiskRoot = Path_GetWorkingDirectory() + sSuffix;
+	std::string sTmpfsRoot = Path_IsDirectory( "/dev/shm" ) ? "/dev/shm" + sSuffix : std::string();
+
+	RemoveTree( sDiskRoot );
+	TestBatches( sDiskRoot );
+	RemoveTree( sDiskRoot );
+
+	if ( !sTmpfsRoot.empty() )
+		BenchmarkWriter( "tmpfs", sTmpfsRoot );
+	BenchmarkWriter( "disk", sDiskRoot );
+
+	return FinishTest( "dirtools_test" );
+}
@@ -0,0 +1,311 @@
+//========= Copyright Valve Corporation ============//
+// Builds driver roots for every EDriverManifestStatus under a scratch
+// directory and scans them with CDriverManifestScanner, including library
+// images for the wrong architecture and the report cache, then times a cold
+// scan against a cached one.
+
+#include "driverdiscovery_public.h"
+#include "dirtools_public.h"
+#include "pathtools_public.h"
+#include "testharness.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#if defined( LINUX32 )
+static const uint8_t k_unElfClass = 1;
+static const uint16_t k_unElfMachine = 3;			// EM_386
+static const uint16_t k_unOtherElfMachine = 62;		// EM_X86_64
+#elif defined( ANDROIDARM64 ) || defined( LINUXARM64 )
+static const uint8_t k_unElfClass = 2;
+static const uint16_t k_unElfMachine = 183;			// EM_AARCH64
+static const uint16_t k_unOtherElfMachine = 62;		// EM_X86_64
+#else
+static const uint8_t k_unElfClass = 2;
+static const uint16_t k_unElfMachine = 62;			// EM_X86_64
+static const uint16_t k_unOtherElfMachine = 183;	// EM_AARCH64
+#endif
+
+static const char *k_pchFixturePath = SHAREDLIB_FIXTURE_PATH;
+
+static int RemoveEntry( const char *pchPath, const struct stat *, int, struct FTW * )
+{
+	return remove( pchPath );
+}
+
+static void RemoveTree( const std::string &sPath )
+{
+	nftw( sPath.c_str(), RemoveEntry, 16, FTW_DEPTH | FTW_PHYS );
+}
+
+static bool WriteFile( const std::string &sPath, const std::string &sContents )
+{
+	return BCreateDirectoryRecursive( Path_StripFilename( sPath ).c_str() )
+		&& Path_WriteBinaryFile( sPath, ( unsigned char * )sContents.data(), ( unsigned )sContents.size() );
+}
+
+static std::string LibraryPath( const std::string &sDriverDirectory, const std::string &sName )
+{
+	return Path_Join( sDriverDirectory, "bin", PLATSUBDIR, "driver_" + sName + DYNAMIC_LIB_EXT );
+}
+
+// the start of an ELF header: just enough for the checks the scanner makes
+static std::string MakeElfHeader( uint8_t unClass, uint8_t unByteOrder, uint16_t unMachine )
+{
+	std::string sHeader( 64, '\0' );
+	memcpy( &sHeader[ 0 ], "\x7f" "ELF", 4 );
+	sHeader[ 4 ] = ( char )unClass;
+	sHeader[ 5 ] = ( char )unByteOrder;
+	sHeader[ 6 ] = 1;		// EV_CURRENT
+	sHeader[ 16 ] = unByteOrder == 2 ? 0 : 3;		// ET_DYN
+	sHeader[ 17 ] = unByteOrder == 2 ? 3 : 0;
+	sHeader[ 18 ] = ( char )( unByteOrder == 2 ? unMachine >> 8 : unMachine & 0xff );
+	sHeader[ 19 ] = ( char )( unByteOrder == 2 ? unMachine & 0xff : unMachine >> 8 );
+	return sHeader;
+}
+
+// moves the file's modification time without touching its contents or size
+static void BumpModifiedTime( const std::string &sPath, int nSeconds )
+{
+	struct stat st;
+	CHECK( stat( sPath.c_str(), &st ) == 0 );
+	struct timespec rgTimes[ 2 ] = { st.st_atim, st.st_mtim };
+	rgTimes[ 1 ].tv_sec += nSeconds;
+	CHECK( utimensat( AT_FDCWD, sPath.c_str(), rgTimes, 0 ) == 0 );
+}
+
+struct TestRoot_t
+{
+	std::string sRoot;
+	EDriverManifestStatus eExpected;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: One driver root per outcome the scanner can report
+//-----------------------------------------------------------------------------
+static std::vector< TestRoot_t > MakeRoots( const std::string &sBase )
+{
+	std::vector< TestRoot_t > vecRoots;
+	auto fnAdd = [&]( const char *pchName, EDriverManifestStatus eExpected )
+	{
+		TestRoot_t root = { Path_Join( sBase, pchName ), eExpected };
+		vecRoots.push_back( root );
+		return root.sRoot;
+	};
+
+	std::vector< uint8_t > vecFixture = Path_ReadBinaryFile( k_pchFixturePath );
+	std::string sFixture( vecFixture.begin(), vecFixture.end() );
+	CHECK( !sFixture.empty() );
+
+	std::string sRoot = fnAdd( "ok", DriverManifestStatus_OK );
+	CHECK( WriteFile( Path_Join( sRoot, "driver.vrdrivermanifest" ), "{ \"name\" : \"ok\", \"alwaysActivate\" : true, \"hmd_presence\" : [ \"28de.*\" ] }" ) );
+	CHECK( WriteFile( LibraryPath( sRoot, "ok" ), sFixture ) );
+
+	// the library lives wherever "directory" points; this one also starts with a BOM
+	sRoot = fnAdd( "elsewhere", DriverManifestStatus_OK );
+	CHECK( WriteFile( Path_Join( sRoot, "driver.vrdrivermanifest" ), "\xEF\xBB\xBF{ \"name\" : \"elsewhere\", \"directory\" : \"../elsewhere_files\" }" ) );
+	CHECK( WriteFile( LibraryPath( Path_Join( sBase, "elsewhere_files" ), "elsewhere" ), sFixture ) );
+
+	sRoot = fnAdd( "resource", DriverManifestStatus_OK );
+	CHECK( WriteFile( Path_Join( sRoot, "driver.vrdrivermanifest" ), "{ \"name\" : \"resource\", \"resourceOnly\" : true }" ) );
+
+	// a header for this platform and nothing more is still taken as a library
+	sRoot = fnAdd( "header", DriverManifestStatus_OK );
+	CHECK( WriteFile( Path_Join( sRoot, "driver.vrdrivermanifest" ), "{ \"name\" : \"header\" }" ) );
+	CHECK( WriteFile( LibraryPath( sRoot, "header" ), MakeElfHeader( k_unElfClass, 1, k_unElfMachine ) ) );
+
+	fnAdd( "missing", DriverManifestStatus_RootNotFound );
+
+	sRoot = fnAdd( "empty", DriverManifestStatus_ManifestNotFound );
+	CHECK( BCreateDirectoryRecursive( sRoot.c_str() ) );
+
+	// a regular file that can't be opened for reading, even by root
+	sRoot = fnAdd( "unreadable", DriverManifestStatus_ManifestUnreadable );
+	CHECK( BCreateDirectoryRecursive( sRoot.c_str() ) );
+	CHECK( symlink( "/proc/sys/vm/drop_caches", Path_Join( sRoot, "driver.vrdrivermanifest" ).c_str() ) == 0 );
+
+	sRoot = fnAdd( "badjson", DriverManifestStatus_ManifestParseFailed );
+	CHECK( WriteFile( Path_Join( sRoot, "driver.vrdrivermanifest" ), "{ \"name\" : \"badjson\", " ) );
+
+	sRoot = fnAdd( "array", DriverManifestStatus_ManifestParseFailed );
+	CHECK( WriteFile( Path_Join( sRoot, "driver.vrdrivermanifest" ), "[ \"name\", \"array\" ]" ) );
+
+	sRoot = fnAdd( "noname", DriverManifestStatus_ManifestMissingName );
+	CHECK( WriteFile( Path_Join( sRoot, "driver.vrdrivermanifest" ), "{ \"name\" : 7, \"alwaysActivate\" : true }" ) );
+
+	sRoot = fnAdd( "nolibrary", DriverManifestStatus_DriverLibraryNotFound );
+	CHECK( WriteFile( Path_Join( sRoot, "driver.vrdrivermanifest" ), "{ \"name\" : \"nolibrary\" }" ) );
+
+	sRoot = fnAdd( "text", DriverManifestStatus_DriverLibraryInvalid );
+	CHECK( WriteFile( Path_Join( sRoot, "driver.vrdrivermanifest" ), "{ \"name\" : \"text\" }" ) );
+	CHECK( WriteFile( LibraryPath( sRoot, "text" ), "not a shared library" ) );
+
+	// images for another architecture, word size or byte order, and one cut short
+	struct WrongImage_t { const char *pchName; std::string sImage; };
+	const WrongImage_t rgWrongImages[] =
+	{
+		{ "othermachine", MakeElfHeader( k_unElfClass, 1, k_unOtherElfMachine ) },
+		{ "otherclass", MakeElfHeader( 3 - k_unElfClass, 1, k_unElfMachine ) },
+		{ "bigendian", MakeElfHeader( k_unElfClass, 2, ( uint16_t )( k_unElfMachine << 8 ) ) },
+		{ "badbyteorder", MakeElfHeader( k_unElfClass, 0, k_unElfMachine ) },
+		{ "truncated", MakeElfHeader( k_unElfClass, 1, k_unElfMachine ).substr( 0, 19 ) },
+	};
+	for ( const WrongImage_t &image : rgWrongImages )
+	{
+		sRoot = fnAdd( image.pchName, DriverManifestStatus_DriverLibraryInvalid );
+		CHECK( WriteFile( Path_Join( sRoot, "driver.vrdrivermanifest" ), std::string( "{ \"name\" : \"" ) + image.pchName + "\" }" ) );
+		CHECK( WriteFile( LibraryPath( sRoot, image.pchName ), image.sImage ) );
+	}
+
+	return vecRoots;
+}
+
+static void TestStatuses( const std::string &sBase )
+{
+	std::vector< TestRoot_t > vecTestRoots = MakeRoots( sBase );
+	std::vector< std::string > vecRoots;
+	for ( const TestRoot_t &root : vecTestRoots )
+		vecRoots.push_back( root.sRoot );
+
+	// one thread and several give the same reports, in the order of the roots
+	for ( uint32_t unThreads : { 1u, 4u } )
+	{
+		CDriverManifestScanner scanner( unThreads );
+		std::vector< DriverManifestReport_t > vecReports;
+		scanner.Scan( vecRoots, &vecReports );
+		CHECK( vecReports.size() == vecTestRoots.size() );
+		for ( size_t i = 0; i < vecReports.size() && i < vecTestRoots.size(); i++ )
+		{
+			const DriverManifestReport_t &report = vecReports[ i ];
+			if ( report.eStatus != vecTestRoots[ i ].eExpected )
+			{
+				fprintf( stderr, "%s: got %s, expected %s\n", vecTestRoots[ i ].sRoot.c_str(),
+					GetDriverManifestStatusName( report.eStatus ), GetDriverManifestStatusName( vecTestRoots[ i ].eExpected ) );
+				s_nFailures++;
+			}
+			CHECK( report.sRootPath == vecRoots[ i ] );
+			if ( report.eStatus == DriverManifestStatus_ManifestParseFailed )
+				CHECK( !report.sError.empty() );
+		}
+		CHECK( scanner.GetLastScanCacheHits() == 0 );
+
+		if ( vecReports.size() < 4 )
+			continue;
+		const DriverManifestReport_t &ok = vecReports[ 0 ];
+		CHECK( ok.sName == "ok" && ok.bAlwaysActivate && !ok.bResourceOnly );
+		CHECK( ok.vecHmdPresence.size() == 1 && ok.vecHmdPresence[ 0 ] == "28de.*" );
+		CHECK( ok.sDriverLibraryPath == LibraryPath( vecRoots[ 0 ], "ok" ) );
+		CHECK( vecReports[ 1 ].sDriverLibraryPath == LibraryPath( Path_Join( sBase, "elsewhere_files" ), "elsewhere" ) );
+		CHECK( vecReports[ 2 ].bResourceOnly && vecReports[ 2 ].sDriverLibraryPath.empty() );
+	}
+
+	CHECK( !strcmp( GetDriverManifestStatusName( DriverManifestStatus_OK ), "OK" ) );
+	CHECK( !strcmp( GetDriverManifestStatusName( DriverManifestStatus_DriverLibraryInvalid ), "DriverLibraryInvalid" ) );
+}
+
+static void TestCache( const std::string &sBase )
+{
+	std::string sRoot = Path_Join( sBase, "cached" );
+	std::string sManifest = Path_Join( sRoot, "driver.vrdrivermanifest" );
+	std::string sLibrary = LibraryPath( sRoot, "cached" );
+	CHECK( WriteFile( sManifest, "{ \"name\" : \"cached\" }" ) );
+	CHECK( WriteFile( sLibrary, MakeElfHeader( k_unElfClass, 1, k_unElfMachine ) ) );
+
+	std::string sResourceRoot = Path_Join( sBase, "cached_resource" );
+	CHECK( WriteFile( Path_Join( sResourceRoot, "driver.vrdrivermanifest" ), "{ \"name\" : \"cached_resource\", \"resourceOnly\" : true }" ) );
+
+	std::vector< std::string > vecRoots = { sRoot, sResourceRoot, Path_Join( sBase, "cached_missing" ) };
+	CDriverManifestScanner scanner( 2 );
+	std::vector< DriverManifestReport_t > vecReports;
+
+	scanner.Scan( vecRoots, &vecReports );
+	CHECK( scanner.GetLastScanCacheHits() == 0 );
+	CHECK( vecReports.size() == 3 && vecReports[ 0 ].eStatus == DriverManifestStatus_OK );
+
+	// nothing changed, so both drivers come from the cache. A missing root is always looked at again.
+	scanner.Scan( vecRoots, &vecReports );
+	CHECK( scanner.GetLastScanCacheHits() == 2 );
+	CHECK( vecReports.size() == 3 && vecReports[ 0 ].eStatus == DriverManifestStatus_OK && vecReports[ 0 ].sName == "cached" );
+
+	// a new manifest time means the manifest is read again
+	BumpModifiedTime( sManifest, 10 );
+	scanner.Scan( vecRoots, &vecReports );
+	CHECK( scanner.GetLastScanCacheHits() == 1 );
+	scanner.Scan( vecRoots, &vecReports );
+	CHECK( scanner.GetLastScanCacheHits() == 2 );
+
+	// so does a new library time. Same size, other machine: only a rescan notices.
+	std::string sOtherImage = MakeElfHeader( k_unElfClass, 1, k_unOtherElfMachine );
+	CHECK( WriteFile( sLibrary, sOtherImage ) );
+	BumpModifiedTime( sLibrary, 10 );
+	scanner.Scan( vecRoots, &vecReports );
+	CHECK( scanner.GetLastScanCacheHits() == 1 );
+	CHECK( vecReports.size() == 3 && vecReports[ 0 ].eStatus == DriverManifestStatus_DriverLibraryInvalid );
+
+	// and the library going away
+	CHECK( remove( sLibrary.c_str() ) == 0 );
+	scanner.Scan( vecRoots, &vecReports );
+	CHECK( scanner.GetLastScanCacheHits() == 1 );
+	CHECK( vecReports.size() == 3 && vecReports[ 0 ].eStatus == DriverManifestStatus_DriverLibraryNotFound );
+
+	scanner.ClearCache();
+	scanner.Scan( vecRoots, &vecReports );
+	CHECK( scanner.GetLastScanCacheHits() == 0 );
+}
+
+static void BenchmarkScan( const std::string &sBase )
+{
+	// about the number of drivers a Steam install with several headsets' worth of add-ons has
+	const uint32_t k_unDrivers = 32;
+	std::vector< uint8_t > vecFixture = Path_ReadBinaryFile( k_pchFixturePath );
+	std::string sFixture( vecFixture.begin(), vecFixture.end() );
+	std::vector< std::string > vecRoots;
+	for ( uint32_t i = 0; i < k_unDrivers; i++ )
+	{
+		std::string sName = "bench" + std::to_string( i );
+		std::string sRoot = Path_Join( sBase, sName );
+		WriteFile( Path_Join( sRoot, "driver.vrdrivermanifest" ), "{ \"name\" : \"" + sName + "\", \"alwaysActivate\" : false, \"hmd_presence\" : [ \"*.*\" ] }" );
+		WriteFile( LibraryPath( sRoot, sName ), sFixture );
+		vecRoots.push_back( sRoot );
+	}
+
+	std::vector< DriverManifestReport_t > vecReports;
+	double flCold = MeasureNsPerCall( [&]
+	{
+		CDriverManifestScanner scanner;
+		scanner.Scan( vecRoots, &vecReports );
+		return vecReports.size();
+	} );
+
+	CDriverManifestScanner scanner;
+	scanner.Scan( vecRoots, &vecReports );
+	double flCached = MeasureNsPerCall( [&]
+	{
+		scanner.Scan( vecRoots, &vecReports );
+		return scanner.GetLastScanCacheHits();
+	} );
+	CHECK( scanner.GetLastScanCacheHits() == k_unDrivers );
+
+	printf( "Scanning %u drivers: cold %7.1f us, cached %7.1f us\n", k_unDrivers, flCold / 1000, flCached / 1000 );
+}
+
+int main( int argc, char *argv[] )
+{
+	ParseTestArgs( argc, argv );
+
+	std::string sBase = Path_GetWorkingDirectory() + "/driverdiscovery_test_" + std::to_string( getpid() );
+	RemoveTree( sBase );
+
+	TestStatuses( sBase );
+	TestCache( sBase );
+	BenchmarkScan( sBase );
+
+	RemoveTree( sBase );
+	return FinishTest( "driverdiscovery_test" );
+}
@@ -0,0 +1,113 @@
+//========= Copyright Valve Corporation ============//
+// Walks every value around the EVRInitError range through the error name
+// lookups and back, then times them.
+
+#include "openvr.h"
+#include "hmderrors_public.h"
+#include "testharness.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace vr;
+
+#define CHECK_ID( eError ) CHECK( !strcmp( GetIDForVRInitError( eError ), #eError ) )
+
+static bool IsKnownError( int nValue )
+{
+	return !strncmp( GetIDForVRInitError( ( EVRInitError )nValue ), "VRInitError_", 12 );
+}
+
+static void TestLookups()
+{
+	std::vector< int > vecKnown;
+	for ( int nValue = -100; nValue < VRInitError_LastError + 100; nValue++ )
+	{
+		EVRInitError eError = ( EVRInitError )nValue;
+		std::string sID = GetIDForVRInitError( eError );
+		std::string sEnglish = GetEnglishStringForHmdError( eError );
+		if ( !IsKnownError( nValue ) )
+		{
+			CHECK( sID == "Unknown error (" + std::to_string( nValue ) + ")" );
+			CHECK( sEnglish == sID );
+			continue;
+		}
+
+		vecKnown.push_back( nValue );
+		EVRInitError eFromID = VRInitError_Unknown;
+		CHECK( GetVRInitErrorFromID( sID.c_str(), &eFromID ) && eFromID == eError );
+		CHECK( !sEnglish.empty() );
+	}
+
+	// the ends of the enum, the edges of the hundreds and the retired value
+	CHECK( !vecKnown.empty() && vecKnown.front() == VRInitError_None && vecKnown.back() + 1 == VRInitError_LastError );
+	CHECK( !IsKnownError( VRInitError_LastError ) );
+	CHECK( !IsKnownError( 210 ) );
+	CHECK( IsKnownError( 209 ) && IsKnownError( 211 ) );
+	CHECK_ID( VRInitError_None );
+	CHECK_ID( VRInitError_Init_InstallationNotFound );
+	CHECK_ID( VRInitError_Driver_TrackedDeviceInterfaceUnknown );
+	CHECK_ID( VRInitError_Driver_HmdDriverIdOutOfBounds );
+	CHECK_ID( VRInitError_VendorSpecific_UnableToConnectToOculusRuntime );
+	CHECK_ID( VRInitError_VendorSpecific_OculusRuntimeBadInstall );
+	CHECK_ID( VRInitError_Steam_SteamInstallationNotFound );
+
+	// English where there is some, the ID where there isn't
+	CHECK( !strcmp( GetEnglishStringForHmdError( VRInitError_None ), "No Error (0)" ) );
+	CHECK( !strcmp( GetEnglishStringForHmdError( VRInitError_Unknown ), "VRInitError_Unknown" ) );
+
+	EVRInitError eError = VRInitError_None;
+	CHECK( !GetVRInitErrorFromID( nullptr, &eError ) );
+	CHECK( !GetVRInitErrorFromID( "", &eError ) );
+	CHECK( !GetVRInitErrorFromID( "VRInitError_", &eError ) );
+	CHECK( !GetVRInitErrorFromID( "VRInitError_Init_HmdNotFoun", &eError ) );
+	CHECK( !GetVRInitErrorFromID( "VRInitError_Init_HmdNotFoundX", &eError ) );
+	CHECK( !GetVRInitErrorFromID( "vrinitError_Init_HmdNotFound", &eError ) );
+	CHECK( !GetVRInitErrorFromID( "VRInitError_Driver_HmdDisplayNotFoundAfterFix", &eError ) );
+	CHECK( eError == VRInitError_None );
+	CHECK( GetVRInitErrorFromID( "VRInitError_Init_HmdNotFound", nullptr ) );
+}
+
+static void BenchmarkLookups()
+{
+	std::vector< EVRInitError > vecErrors;
+	std::vector< std::string > vecIDs;
+	for ( int nValue = 0; nValue < VRInitError_LastError; nValue++ )
+	{
+		if ( !IsKnownError( nValue ) )
+			continue;
+		vecErrors.push_back( ( EVRInitError )nValue );
+		vecIDs.push_back( GetIDForVRInitError( ( EVRInitError )nValue ) );
+	}
+
+	size_t unErrors = vecErrors.size();
+	double flEnglish = MeasureNsPerCall( [&vecErrors]
+	{
+		size_t unLength = 0;
+		for ( EVRInitError eError : vecErrors )
+			unLength += strlen( GetEnglishStringForHmdError( eError ) );
+		return unLength;
+	} ) / unErrors;
+	double flFromID = MeasureNsPerCall( [&vecIDs]
+	{
+		size_t unFound = 0;
+		EVRInitError eError;
+		for ( const std::string &sID : vecIDs )
+			unFound += GetVRInitErrorFromID( sID.c_str(), &eError );
+		return unFound;
+	} ) / unErrors;
+	printf( "Over all %u errors: GetEnglishStringForHmdError %5.1f ns, GetVRInitErrorFromID %5.1f ns\n", ( uint32_t )unErrors, flEnglish, flFromID );
+}
+
+int main( int argc, char *argv[] )
+{
+	ParseTestArgs( argc, argv );
+
+	TestLookups();
+	BenchmarkLookups();
+
+	return FinishTest( "hmderrors_test" );
+}
@@ -0,0 +1,415 @@
+//========= Copyright Valve Corporation ============//
+// Checks the path helpers against the std::string versions they replaced, on
+// random paths and on the kind of driver and resource paths the runtime
+// handles, then times both on the latter. Also reads files of various sizes
+// back through each Path_Read* helper and times those.
+
+#include "pathtools_public.h"
+#include "strtools_public.h"
+#include "testharness.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+// paths shaped like the ones drivers, manifests and resource lookups pass around
+static const char *k_rgRealisticPaths[] =
+{
+	"C:\\Program Files (x86)\\Steam\\steamapps\\common\\SteamVR\\drivers\\lighthouse\\..\\..\\resources\\settings\\default.vrsettings",
+	"C:\\Program Files (x86)\\Steam\\steamapps\\common\\SteamVR\\drivers\\htc\\resources\\input\\vive_controller_profile.json",
+	"/home/user/.local/share/Steam/steamapps/common/SteamVR/bin/linux64/../../drivers/./htc/resources/icons/../input/controller_profile.json",
+	"/home/user/.local/share/Steam/steamapps/common/SteamVR/drivers/lighthouse/bin/linux64/driver_lighthouse.so",
+	"/home/user/.steam/steam/steamapps/common/SteamVR/resources/rendermodels/vr_controller_vive_1_5/body.obj",
+	"/Users/user/Library/Application Support/Steam/steamapps/common/SteamVR/drivers/sample/resources/driver.vrdrivermanifest",
+	"D:/SteamLibrary/steamapps/common/SteamVR/drivers/indexcontroller/resources/input/knuckles_profile.json",
+	"./drivers/sample/bin/win64/driver_sample.dll",
+	"../../resources/webhelper/../icons/./headset_status_ready.png",
+	"C:\\Users\\user\\AppData\\Local\\openvr\\openvrpaths.vrpath",
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: The std::string implementations as they were, used as the
+//			reference for the output and the benchmark baseline
+//-----------------------------------------------------------------------------
+static std::string Reference_Path_StripFilename( const std::string & sPath, char slash )
+{
+	std::string::size_type n = sPath.find_last_of( slash );
+	if( n == std::string::npos )
+		return sPath;
+	else
+		return std::string( sPath.begin(), sPath.begin() + n );
+}
+
+static std::string Reference_Path_StripDirectory( const std::string & sPath, char slash )
+{
+	std::string::size_type n = sPath.find_last_of( slash );
+	if( n == std::string::npos )
+		return sPath;
+	else
+		return std::string( sPath.begin() + n + 1, sPath.end() );
+}
+
+static std::string Reference_Path_StripExtension( const std::string & sPath )
+{
+	for( std::string::const_reverse_iterator i = sPath.rbegin(); i != sPath.rend(); i++ )
+	{
+		if( *i == '.' )
+		{
+			return std::string( sPath.begin(), i.base() - 1 );
+		}
+
+		// if we find a slash there is no extension
+		if( *i == '\\' || *i == '/' )
+			break;
+	}
+
+	// we didn't find an extension
+	return sPath;
+}
+
+static std::string Reference_Path_GetExtension( const std::string & sPath )
+{
+	for ( std::string::const_reverse_iterator i = sPath.rbegin(); i != sPath.rend(); i++ )
+	{
+		if ( *i == '.' )
+		{
+			return std::string( i.base(), sPath.end() );
+		}
+
+		// if we find a slash there is no extension
+		if ( *i == '\\' || *i == '/' )
+			break;
+	}
+
+	// we didn't find an extension
+	return "";
+}
+
+static std::string Reference_Path_FixSlashes( const std::string & sPath, char slash )
+{
+	std::string sFixed = sPath;
+	for( std::string::iterator i = sFixed.begin(); i != sFixed.end(); i++ )
+	{
+		if( *i == '/' || *i == '\\' )
+			*i = slash;
+	}
+
+	return sFixed;
+}
+
+static std::string Reference_Path_Join( const std::string & first, const std::string & second, char slash )
+{
+	// only insert a slash if we don't already have one
+	std::string::size_type nLen = first.length();
+	if( !nLen )
+		return second;
+	char last_char = first[first.length()-1];
+	if (last_char == '\\' || last_char == '/')
+	    nLen--;
+
+	return first.substr( 0, nLen ) + std::string( 1, slash ) + second;
+}
+
+static std::string Reference_Path_Compact( const std::string & sRawPath, char slash )
+{
+	std::string sPath = Reference_Path_FixSlashes( sRawPath, slash );
+	std::string sSlashString( 1, slash );
+
+	// strip out all /./
+	for( std::string::size_type i = 0; (i + 3) < sPath.length();  )
+	{
+		if( sPath[ i ] == slash && sPath[ i+1 ] == '.' && sPath[ i+2 ] == slash )
+		{
+			sPath.replace( i, 3, sSlashString );
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	// get rid of trailing /. but leave the path separator
+	if( sPath.length() > 2 )
+	{
+		std::string::size_type len = sPath.length();
+		if( sPath[ len-1 ] == '.'  && sPath[ len-2 ] == slash )
+		{
+			sPath.pop_back();
+		}
+	}
+
+	// get rid of leading ./
+	if( sPath.length() > 2 )
+	{
+		if( sPath[ 0 ] == '.'  && sPath[ 1 ] == slash )
+		{
+			sPath.replace( 0, 2, "" );
+		}
+	}
+
+	// each time we encounter .. back up until we've found the previous directory name
+	// then get rid of both
+	std::string::size_type i = 0;
+	while( i < sPath.length() )
+	{
+		if( i > 0 && sPath.length() - i >= 2
+			&& sPath[i] == '.'
+			&& sPath[i+1] == '.'
+			&& ( i + 2 == sPath.length() || sPath[ i+2 ] == slash )
+			&& sPath[ i-1 ] == slash )
+		{
+			// check if we've hit the start of the string and have a bogus path
+			if( i == 1 )
+				return "";
+
+			// find the separator before i-1
+			std::string::size_type iDirStart = i-2;
+			while( iDirStart > 0 && sPath[ iDirStart - 1 ] != slash )
+				--iDirStart;
+
+			// remove everything from iDirStart to i+2
+			sPath.replace( iDirStart, (i - iDirStart) + 3, "" );
+
+			// start over
+			i = 0;
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	return sPath;
+}
+
+static void CheckPath( const std::string &sPath, const std::string &sOther )
+{
+	for ( char slash : { '/', '\\' } )
+	{
+		std::string sCompact = Path_Compact( sPath, slash );
+		if ( sCompact != Reference_Path_Compact( sPath, slash ) )
+		{
+			if ( s_nFailures < 10 )
+				fprintf( stderr, "Path_Compact( \"%s\", '%c' ) gave \"%s\"\n", sPath.c_str(), slash, sCompact.c_str() );
+			s_nFailures++;
+		}
+
+		CPathBuffer compactBuffer;
+		bool bCompacted = Path_CompactTo( sPath, &compactBuffer, slash );
+		CHECK( compactBuffer.str() == sCompact && ( bCompacted || sCompact.empty() ) );
+
+		CHECK( Path_StripFilename( sPath, slash ) == Reference_Path_StripFilename( sPath, slash ) );
+		CHECK( Path_StripDirectory( sPath, slash ) == Reference_Path_StripDirectory( sPath, slash ) );
+		CHECK( Path_FixSlashes( sPath, slash ) == Reference_Path_FixSlashes( sPath, slash ) );
+		CHECK( Path_Join( sPath, sOther, slash ) == Reference_Path_Join( sPath, sOther, slash ) );
+		CHECK( Path_StripFilenameView( sPath, slash ).str() == Reference_Path_StripFilename( sPath, slash ) );
+	}
+
+	CHECK( Path_StripExtension( sPath ) == Reference_Path_StripExtension( sPath ) );
+	CHECK( Path_GetExtension( sPath ) == Reference_Path_GetExtension( sPath ) );
+	CHECK( Path_GetExtensionView( sPath ).str() == Reference_Path_GetExtension( sPath ) );
+}
+
+static void TestPaths()
+{
+	for ( const char *pchPath : k_rgRealisticPaths )
+		CheckPath( pchPath, "resources/settings/default.vrsettings" );
+
+	// random paths built from the components and separators the rules care about
+	const char *rgchComponents[] = { "a", "bc", ".", "..", "", "...", ".a", "a.", "drivers", "driver_sample.so" };
+	const char *rgchSeparators[] = { "/", "\\", "//", "/./" };
+	std::mt19937 rng( 1 );
+	for ( uint32_t unIteration = 0; unIteration < 200000; unIteration++ )
+	{
+		std::string sPath;
+		if ( rng() % 3 == 0 )
+			sPath += rgchSeparators[ rng() % 4 ];
+		uint32_t unComponents = rng() % 8;
+		for ( uint32_t i = 0; i < unComponents; i++ )
+		{
+			sPath += rgchComponents[ rng() % 10 ];
+			if ( i + 1 < unComponents || rng() % 2 )
+				sPath += rgchSeparators[ rng() % 4 ];
+		}
+		if ( rng() % 4 == 0 )
+			sPath = std::string( rng() % 4 + 1, '.' ) + sPath;
+
+		std::string sOther = std::string( rgchComponents[ rng() % 10 ] ) + rgchSeparators[ rng() % 4 ];
+		CheckPath( sPath, sOther );
+	}
+
+	// long enough to spill out of CPathBuffer's inline storage
+	std::string sLong;
+	for ( int i = 0; i < 200; i++ )
+		sLong += "dir/../x/./";
+	CHECK( Path_Compact( sLong, '/' ) == Reference_Path_Compact( sLong, '/' ) );
+
+	CPathBuffer buffer;
+	buffer.Assign( "abc" );
+	for ( int i = 0; i < 10; i++ )
+		buffer.Append( buffer.View() );
+	CHECK( buffer.size() == 3 * 1024 && strlen( buffer.c_str() ) == buffer.size() );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns the average ns per call of fn over the realistic paths
+//-----------------------------------------------------------------------------
+template< class Fn >
+static double MeasureNsPerPath( Fn fn )
+{
+	const size_t unPaths = sizeof( k_rgRealisticPaths ) / sizeof( k_rgRealisticPaths[ 0 ] );
+	std::vector< std::string > vecPaths( k_rgRealisticPaths, k_rgRealisticPaths + unPaths );
+
+	return MeasureNsPerCall( [&]
+	{
+		size_t unTotal = 0;
+		for ( const std::string &sPath : vecPaths )
+			unTotal += fn( sPath );
+		return unTotal;
+	} ) / unPaths;
+}
+
+static void BenchmarkPaths()
+{
+	CPathBuffer buffer;
+	printf( "Path_Compact:       reference %6.0f ns, now %6.0f ns, Path_CompactTo %6.0f ns\n",
+		MeasureNsPerPath( []( const std::string &sPath ) { return Reference_Path_Compact( sPath, '/' ).size(); } ),
+		MeasureNsPerPath( []( const std::string &sPath ) { return Path_Compact( sPath, '/' ).size(); } ),
+		MeasureNsPerPath( [&buffer]( const std::string &sPath ) { Path_CompactTo( sPath, &buffer, '/' ); return buffer.size(); } ) );
+	printf( "Path_StripFilename: reference %6.0f ns, now %6.0f ns, view %6.0f ns\n",
+		MeasureNsPerPath( []( const std::string &sPath ) { return Reference_Path_StripFilename( sPath, '/' ).size(); } ),
+		MeasureNsPerPath( []( const std::string &sPath ) { return Path_StripFilename( sPath, '/' ).size(); } ),
+		MeasureNsPerPath( []( const std::string &sPath ) { return Path_StripFilenameView( sPath, '/' ).size(); } ) );
+	printf( "Path_GetExtension:  reference %6.0f ns, now %6.0f ns, view %6.0f ns\n",
+		MeasureNsPerPath( []( const std::string &sPath ) { return Reference_Path_GetExtension( sPath ).size(); } ),
+		MeasureNsPerPath( []( const std::string &sPath ) { return Path_GetExtension( sPath ).size(); } ),
+		MeasureNsPerPath( []( const std::string &sPath ) { return Path_GetExtensionView( sPath ).size(); } ) );
+	printf( "Path_Join:          reference %6.0f ns, now %6.0f ns, Path_JoinTo %6.0f ns\n",
+		MeasureNsPerPath( []( const std::string &sPath ) { return Reference_Path_Join( sPath, "resources", '/' ).size(); } ),
+		MeasureNsPerPath( []( const std::string &sPath ) { return Path_Join( sPath, "resources", '/' ).size(); } ),
+		MeasureNsPerPath( [&buffer]( const std::string &sPath ) { Path_JoinTo( sPath, "resources", &buffer, '/' ); return buffer.size(); } ) );
+
+	std::string sDeep;
+	for ( int i = 0; i < 40; i++ )
+		sDeep += "d" + std::to_string( i ) + "/";
+	for ( int i = 0; i < 40; i++ )
+		sDeep += "../";
+	sDeep += "f";
+	double flReference = MeasureNsPerPath( [&sDeep]( const std::string & ) { return Reference_Path_Compact( sDeep, '/' ).size(); } );
+	double flNow = MeasureNsPerPath( [&sDeep]( const std::string & ) { return Path_Compact( sDeep, '/' ).size(); } );
+	printf( "Path_Compact with 40 levels of \"..\": reference %6.0f ns, now %6.0f ns\n", flReference, flNow );
+}
+
+static std::vector<uint8_t> MakeFileContents( size_t unSize )
+{
+	std::vector<uint8_t> vecContents( unSize );
+	for ( size_t i = 0; i < unSize; i++ )
+		vecContents[ i ] = ( uint8_t )( i * 131 + ( i >> 8 ) );
+
+	// and line endings now and then for the text reader
+	for ( size_t i = 62; i + 1 < unSize; i += 64 )
+	{
+		vecContents[ i ] = '\r';
+		vecContents[ i + 1 ] = '\n';
+	}
+	return vecContents;
+}
+
+static void TestFileReads()
+{
+	std::string sFile = Path_Join( Path_GetWorkingDirectory(), "pathtools_test_read.bin" );
+
+	// sizes around the end-of-file probe and a few larger ones
+	const size_t rgunSizes[] = { 0, 1, 511, 512, 513, 4096, 4097, 100000 };
+	for ( size_t unSize : rgunSizes )
+	{
+		std::vector<uint8_t> vecExpected = MakeFileContents( unSize );
+		CHECK( Path_WriteBinaryFile( sFile, vecExpected.data(), ( unsigned )unSize ) );
+
+		CHECK( Path_ReadBinaryFile( sFile ) == vecExpected );
+
+		int nSize = -1;
+		unsigned char *pBuffer = Path_ReadBinaryFile( sFile, &nSize );
+		if ( unSize == 0 )
+		{
+			CHECK( pBuffer == nullptr && nSize == -1 );
+		}
+		else
+		{
+			CHECK( pBuffer != nullptr && nSize == ( int )unSize );
+			CHECK( pBuffer && !memcmp( pBuffer, vecExpected.data(), unSize ) );
+		}
+		delete[] pBuffer;
+
+		std::vector<uint8_t> vecBuffer( unSize + 1 );
+		CHECK( Path_ReadBinaryFile( sFile, vecBuffer.data(), ( uint32_t )vecBuffer.size() ) == unSize );
+		CHECK( std::equal( vecExpected.begin(), vecExpected.end(), vecBuffer.begin() ) );
+
+		// the text reader turns CRLF into LF, and the contents have a few
+		std::string sExpectedText;
+		for ( size_t i = 0; i < unSize; i++ )
+		{
+			if ( vecExpected[ i ] != '\r' || i + 1 == unSize || vecExpected[ i + 1 ] != '\n' )
+				sExpectedText.push_back( ( char )vecExpected[ i ] );
+		}
+		CHECK( Path_ReadTextFile( sFile ) == sExpectedText );
+	}
+	Path_UnlinkFile( sFile );
+
+	int nSize = -1;
+	CHECK( Path_ReadBinaryFile( sFile ).empty() );
+	CHECK( Path_ReadBinaryFile( sFile, &nSize ) == nullptr && nSize == -1 );
+	CHECK( Path_ReadBinaryFile( Path_GetWorkingDirectory(), &nSize ) == nullptr );
+
+#if defined( __linux__ )
+	// procfs reports no size, so these are read to EOF
+	std::vector<uint8_t> vecStatus = Path_ReadBinaryFile( "/proc/self/status" );
+	CHECK( vecStatus.size() > 16 && !memcmp( vecStatus.data(), "Name:", 5 ) );
+	unsigned char *pStatus = Path_ReadBinaryFile( "/proc/self/status", &nSize );
+	CHECK( pStatus != nullptr && nSize > 16 && !memcmp( pStatus, "Name:", 5 ) );
+	delete[] pStatus;
+#endif
+}
+
+static void BenchmarkFileReads()
+{
+	// about the size of a large settings or input profile file
+	const size_t k_unSize = 64 * 1024;
+	std::string sFile = Path_Join( Path_GetWorkingDirectory(), "pathtools_bench_read.bin" );
+	std::vector<uint8_t> vecContents = MakeFileContents( k_unSize );
+	Path_WriteBinaryFile( sFile, vecContents.data(), ( unsigned )k_unSize );
+
+	double flVector = MeasureNsPerCall( [&sFile]
+	{
+		return Path_ReadBinaryFile( sFile ).size();
+	} );
+	double flBuffer = MeasureNsPerCall( [&sFile]
+	{
+		int nSize = 0;
+		delete[] Path_ReadBinaryFile( sFile, &nSize );
+		return nSize;
+	} );
+	double flText = MeasureNsPerCall( [&sFile]
+	{
+		return Path_ReadTextFile( sFile ).size();
+	} );
+	Path_UnlinkFile( sFile );
+
+	printf( "Reading a %u KB file: vector %6.1f us, new[] buffer %6.1f us, text %6.1f us\n", ( uint32_t )( k_unSize / 1024 ), flVector / 1000, flBuffer / 1000, flText / 1000 );
+}
+
+int main( int argc, char *argv[] )
+{
+	ParseTestArgs( argc, argv );
+
+	TestPaths();
+	TestFileReads();
+	BenchmarkPaths();
+	BenchmarkFileReads();
+
+	return FinishTest( "pathtools_test" );
+}
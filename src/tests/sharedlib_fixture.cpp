@@ -0,0 +1,21 @@
+//========= Copyright Valve Corporation ============//
+// A small module for sharedlibtools_test to load. The call counter starts
+// over only when the module really is loaded again.
+
+#if defined( _WIN32 )
+#define FIXTURE_EXPORT extern "C" __declspec( dllexport )
+#else
+#define FIXTURE_EXPORT extern "C" __attribute__( ( visibility( "default" ) ) )
+#endif
+
+static int s_nCalls = 0;
+
+FIXTURE_EXPORT int SharedLibFixture_GetValue()
+{
+	return 42;
+}
+
+FIXTURE_EXPORT int SharedLibFixture_CountCall()
+{
+	return ++s_nCalls;
+}
@@ -0,0 +1,153 @@
+//========= Copyright Valve Corporation ============//
+// Loads the sharedlib_fixture module through CSharedLibManager to check its
+// reference counting, symbol cache, preloads and failures, then times
+// repeated loads and lookups against going to the loader every time.
+
+#include "sharedlibtools_public.h"
+#include "pathtools_public.h"
+#include "testharness.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef int ( *FixtureFn_t )();
+
+static const char *k_pchFixturePath = SHAREDLIB_FIXTURE_PATH;
+
+static int CallFixture( CSharedLibManager &manager, SharedLibHandle hModule, const char *pchFunctionName )
+{
+	FixtureFn_t pfn = ( FixtureFn_t )manager.GetFunction( hModule, pchFunctionName );
+	return pfn ? pfn() : -1;
+}
+
+static void TestManager()
+{
+	CSharedLibManager manager;
+	std::vector< SharedLibModuleInfo_t > vecModules;
+
+	std::string sError;
+	SharedLibHandle hModule = manager.Load( k_pchFixturePath, &sError );
+	CHECK( hModule != nullptr && sError.empty() );
+	CHECK( CallFixture( manager, hModule, "SharedLibFixture_GetValue" ) == 42 );
+	CHECK( CallFixture( manager, hModule, "SharedLibFixture_CountCall" ) == 1 );
+	CHECK( manager.GetFunction( hModule, "SharedLibFixture_Missing" ) == nullptr );
+	CHECK( manager.GetFunction( hModule, "SharedLibFixture_Missing" ) == nullptr );
+
+	// another route to the same file shares the module and its state
+	std::string sOtherRoute = Path_StripFilename( k_pchFixturePath ) + "/./" + Path_StripDirectory( k_pchFixturePath );
+	SharedLibHandle hOther = manager.Load( sOtherRoute.c_str() );
+	CHECK( hOther == hModule );
+	CHECK( CallFixture( manager, hOther, "SharedLibFixture_CountCall" ) == 2 );
+
+	manager.GetModules( &vecModules );
+	CHECK( vecModules.size() == 1 );
+	if ( vecModules.size() == 1 )
+	{
+		CHECK( vecModules[ 0 ].unRefCount == 2 );
+		CHECK( vecModules[ 0 ].unCachedSymbols == 3 );
+		CHECK( !vecModules[ 0 ].bPreloaded && !vecModules[ 0 ].bLoading );
+	}
+
+	// the module stays until its last reference goes, and loads fresh after that
+	manager.Unload( hOther );
+	CHECK( CallFixture( manager, hModule, "SharedLibFixture_CountCall" ) == 3 );
+	manager.Unload( hModule );
+	manager.GetModules( &vecModules );
+	CHECK( vecModules.empty() );
+	CHECK( manager.GetFunction( hModule, "SharedLibFixture_GetValue" ) == nullptr );
+
+	hModule = manager.Load( k_pchFixturePath );
+	CHECK( CallFixture( manager, hModule, "SharedLibFixture_CountCall" ) == 1 );
+	manager.Unload( hModule );
+
+	// a preload hands its reference to the first Load. A Load that gets there
+	// first just loads it itself, so wait for the preload thread to finish.
+	manager.Preload( k_pchFixturePath );
+	std::chrono::steady_clock::time_point preloadStart = std::chrono::steady_clock::now();
+	do
+	{
+		std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+		manager.GetModules( &vecModules );
+	} while ( ( vecModules.empty() || vecModules[ 0 ].bLoading ) && std::chrono::steady_clock::now() - preloadStart < std::chrono::seconds( 5 ) );
+	hModule = manager.Load( k_pchFixturePath );
+	CHECK( hModule != nullptr );
+	manager.GetModules( &vecModules );
+	CHECK( vecModules.size() == 1 && vecModules[ 0 ].bPreloaded && vecModules[ 0 ].unRefCount == 1 );
+	manager.Unload( hModule );
+	manager.GetModules( &vecModules );
+	CHECK( vecModules.empty() );
+
+	// failures report the loader's reason and are kept for diagnostics
+	std::string sMissing = Path_StripFilename( k_pchFixturePath ) + "/missing_fixture" DYNAMIC_LIB_EXT;
+	CHECK( manager.Load( sMissing.c_str(), &sError ) == nullptr );
+	CHECK( !sError.empty() );
+	manager.GetModules( &vecModules );
+	CHECK( vecModules.size() == 1 && !vecModules[ 0 ].hModule && vecModules[ 0 ].sError == sError );
+
+	CSharedLibManager lazyManager( SharedLibBinding_Lazy );
+	hModule = lazyManager.Load( k_pchFixturePath );
+	CHECK( CallFixture( lazyManager, hModule, "SharedLibFixture_GetValue" ) == 42 );
+	lazyManager.Unload( hModule );
+}
+
+static void BenchmarkLoads()
+{
+	// a driver being activated over and over: load, look up its factory, call it, let go
+	double flLoader = MeasureNsPerCall( []
+	{
+		SharedLibHandle hModule = SharedLib_Load( k_pchFixturePath );
+		FixtureFn_t pfn = ( FixtureFn_t )SharedLib_GetFunction( hModule, "SharedLibFixture_GetValue" );
+		int nValue = pfn ? pfn() : 0;
+		SharedLib_Unload( hModule );
+		return nValue;
+	} );
+
+	CSharedLibManager manager;
+	double flManagerCold = MeasureNsPerCall( [&manager]
+	{
+		SharedLibHandle hModule = manager.Load( k_pchFixturePath );
+		int nValue = CallFixture( manager, hModule, "SharedLibFixture_GetValue" );
+		manager.Unload( hModule );
+		return nValue;
+	} );
+
+	// with a reference held elsewhere, the way a driver stays loaded between activations
+	SharedLibHandle hHeld = manager.Load( k_pchFixturePath );
+	double flManagerHeld = MeasureNsPerCall( [&manager]
+	{
+		SharedLibHandle hModule = manager.Load( k_pchFixturePath );
+		int nValue = CallFixture( manager, hModule, "SharedLibFixture_GetValue" );
+		manager.Unload( hModule );
+		return nValue;
+	} );
+	printf( "Load, look up and unload: loader every time %8.0f ns, manager %8.0f ns, manager with the module held %8.0f ns\n",
+		flLoader, flManagerCold, flManagerHeld );
+
+	SharedLibHandle hRaw = SharedLib_Load( k_pchFixturePath );
+	double flRawLookup = MeasureNsPerCall( [hRaw]
+	{
+		return SharedLib_GetFunction( hRaw, "SharedLibFixture_GetValue" ) != nullptr;
+	} );
+	double flCachedLookup = MeasureNsPerCall( [&manager, hHeld]
+	{
+		return manager.GetFunction( hHeld, "SharedLibFixture_GetValue" ) != nullptr;
+	} );
+	printf( "Symbol lookup: loader %6.0f ns, manager cache %6.0f ns\n", flRawLookup, flCachedLookup );
+
+	SharedLib_Unload( hRaw );
+	manager.Unload( hHeld );
+}
+
+int main( int argc, char *argv[] )
+{
+	ParseTestArgs( argc, argv );
+
+	TestManager();
+	BenchmarkLoads();
+
+	return FinishTest( "sharedlibtools_test" );
+}
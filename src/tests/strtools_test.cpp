@@ -0,0 +1,633 @@
+//========= Copyright Valve Corporation ============//
+// Checks RepairUTF8 and the UTF-8 / wide transcoder against the std::codecvt
+// based code they replaced, then times both, on one thread and on several.
+// The prefix/suffix, case and tokenizing helpers get the same treatment
+// against their std::string versions, timed on driver and resource paths.
+
+#include "strtools_public.h"
+#include "testharness.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <codecvt>
+#include <locale>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+static void PrintBytes( const char *pchLabel, const std::string &sBytes )
+{
+	fprintf( stderr, "%s:", pchLabel );
+	for ( size_t i = 0; i < sBytes.size(); i++ )
+		fprintf( stderr, " %02X", (unsigned char)sBytes[ i ] );
+	fprintf( stderr, "\n" );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: RepairUTF8 as it was when it decoded through codecvt_utf8, used as
+//			the reference for the output and the benchmark baseline
+//-----------------------------------------------------------------------------
+static bool RepairUTF8_Codecvt( const char *pbegin, const char *pend, std::string & sOutputUtf8 )
+{
+	typedef std::codecvt_utf8<char32_t> facet_type;
+	facet_type myfacet;
+
+	std::mbstate_t mystate = std::mbstate_t();
+
+	sOutputUtf8.clear();
+	sOutputUtf8.reserve( pend - pbegin );
+	bool bSqueakyClean = true;
+
+	const char *pmid = pbegin;
+	while ( pmid != pend )
+	{
+		bool bHasError = false;
+		bool bHasValidData = false;
+
+		char32_t out = 0xdeadbeef, *pout;
+		pbegin = pmid;
+		switch ( myfacet.in( mystate, pbegin, pend, pmid, &out, &out + 1, pout ) )
+		{
+		case facet_type::ok:
+			bHasValidData = true;
+			break;
+
+		case facet_type::noconv:
+			bSqueakyClean = false;
+			break;
+
+		case facet_type::partial:
+			bHasError = pbegin == pmid;
+			if ( bHasError )
+			{
+				bSqueakyClean = false;
+			}
+			else
+			{
+				bHasValidData = true;
+			}
+			break;
+
+		case facet_type::error:
+			bHasError = true;
+			bSqueakyClean = false;
+			break;
+		}
+
+		if ( bHasValidData )
+		{
+			for ( const char *p = pbegin; p != pmid; ++p )
+			{
+				sOutputUtf8 += *p;
+			}
+		}
+
+		if ( bHasError )
+		{
+			sOutputUtf8 += '?';
+		}
+
+		if ( pmid == pbegin )
+		{
+			pmid++;
+		}
+	}
+
+	return bSqueakyClean;
+}
+
+static void CheckRepairUTF8( const std::string &sInput )
+{
+	std::string sExpected, sActual;
+	bool bExpected = RepairUTF8_Codecvt( sInput.data(), sInput.data() + sInput.size(), sExpected );
+	bool bActual = RepairUTF8( sInput, sActual );
+	if ( bExpected != bActual || sExpected != sActual )
+	{
+		if ( s_nFailures < 10 )
+			PrintBytes( "RepairUTF8 differs from codecvt_utf8 on", sInput );
+		s_nFailures++;
+	}
+}
+
+// lead and continuation bytes on either side of every range the validator checks
+static const unsigned char k_rgBoundaryBytes[] =
+{
+	0x00, 0x41, 0x7F, 0x80, 0x8F, 0x90, 0x9F, 0xA0, 0xBF, 0xC0, 0xC1, 0xC2, 0xDF, 0xE0,
+	0xE1, 0xEC, 0xED, 0xEE, 0xEF, 0xF0, 0xF1, 0xF3, 0xF4, 0xF5, 0xF7, 0xF8, 0xFF,
+};
+
+// pieces of valid, truncated and invalid UTF-8 that random inputs are built from
+static const char *k_rgUTF8Pieces[] =
+{
+	"a", "hello world, ", "\xE4\xB8\xAD", "\xF0\x9F\x98\x80", "\xC3\xA9", "\xED\xA0\x80", "\x80", "\xE4\xB8",
+	"\xF4\x90\x80\x80", "\xC0\xAF", "\xFF", "\xEF\xBB\xBF", "0123456789abcdef0123456789abcdef",
+};
+
+static std::string RandomUTF8( std::mt19937 &rng )
+{
+	std::string sResult;
+	uint32_t unPieces = rng() % 24;
+	for ( uint32_t i = 0; i < unPieces; i++ )
+		sResult += k_rgUTF8Pieces[ rng() % ( sizeof( k_rgUTF8Pieces ) / sizeof( k_rgUTF8Pieces[ 0 ] ) ) ];
+	if ( rng() % 4 == 0 && !sResult.empty() )
+	{
+		char c = (char)rng();
+		if ( c )
+			sResult[ rng() % sResult.size() ] = c;
+	}
+	return sResult;
+}
+
+static void TestRepairUTF8()
+{
+	std::string sInput;
+	for ( uint32_t unValue = 0; unValue < 0x10000; unValue++ )
+	{
+		if ( unValue < 0x100 )
+			CheckRepairUTF8( std::string( 1, (char)unValue ) );
+		sInput.assign( 1, (char)( unValue & 0xFF ) );
+		sInput += (char)( unValue >> 8 );
+		CheckRepairUTF8( sInput );
+	}
+
+	// every 4 byte combination of the boundary bytes, alone and straddling the 16 and 32 byte blocks
+	const size_t unBoundaryBytes = sizeof( k_rgBoundaryBytes );
+	const std::string sPad15( 15, 'a' ), sPad29( 29, 'a' );
+	for ( uint32_t unCombo = 0; unCombo < unBoundaryBytes * unBoundaryBytes * unBoundaryBytes * unBoundaryBytes; unCombo++ )
+	{
+		sInput.clear();
+		for ( uint32_t unIndex = unCombo, i = 0; i < 4; i++, unIndex /= unBoundaryBytes )
+			sInput += (char)k_rgBoundaryBytes[ unIndex % unBoundaryBytes ];
+		CheckRepairUTF8( sInput );
+		CheckRepairUTF8( sPad15 + sInput + sPad15 );
+		CheckRepairUTF8( sPad29 + sInput );
+	}
+
+	std::mt19937 rng( 1234 );
+	for ( uint32_t i = 0; i < 200000; i++ )
+		CheckRepairUTF8( RandomUTF8( rng ) );
+
+	std::string sOutput;
+	CHECK( RepairUTF8( std::string( "plain ascii" ), sOutput ) && sOutput == "plain ascii" );
+	CHECK( !RepairUTF8( std::string( "bad \xFF byte" ), sOutput ) && sOutput == "bad ? byte" );
+}
+
+static void BenchmarkRepairUTF8()
+{
+	std::string sAscii, sCJK, sAdversarial;
+	while ( sAscii.size() < ( 1 << 20 ) )
+		sAscii += "The quick brown fox jumps over the lazy dog. ";
+	while ( sCJK.size() < ( 1 << 20 ) )
+		sCJK += "\xE4\xB8\xAD\xE6\x96\x87\xE6\xB5\x8B\xE8\xAF\x95 ";
+	while ( sAdversarial.size() < ( 1 << 20 ) )
+		sAdversarial += "\xE4\xB8" "a\xFF\xC0\xAF\xED\xA0\x80\xF4\x90\x80\x80";
+
+	const char *rgchNames[] = { "ascii", "cjk", "adversarial" };
+	const std::string *rgpInputs[] = { &sAscii, &sCJK, &sAdversarial };
+	uint32_t unThreads = GetBenchThreadCount();
+	for ( uint32_t unThreadCount : { 1u, unThreads } )
+	{
+		for ( int i = 0; i < 3; i++ )
+		{
+			const std::string &sInput = *rgpInputs[ i ];
+			std::string sOutput;
+			double flOld = MeasureMBps( unThreadCount, sInput.size(), [&sInput, sOutput]() mutable
+			{
+				RepairUTF8_Codecvt( sInput.data(), sInput.data() + sInput.size(), sOutput );
+			} );
+			double flNew = MeasureMBps( unThreadCount, sInput.size(), [&sInput, sOutput]() mutable
+			{
+				RepairUTF8( sInput, sOutput );
+			} );
+			printf( "RepairUTF8 %-12s %2u threads: codecvt %8.1f MB/s, now %8.1f MB/s\n", rgchNames[ i ], unThreadCount, flOld, flNew );
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: The UTF-8 / wide conversions as they were, through a converter
+//			shared by every caller. It isn't safe to use concurrently, so the
+//			threaded benchmark serializes it the way a caller had to.
+//-----------------------------------------------------------------------------
+typedef std::codecvt_utf8< wchar_t > convert_type;
+static std::mutex s_codecvtMutex;
+
+static bool UTF16to8_Codecvt( const std::wstring &sInput, std::string &sOutput )
+{
+	static std::wstring_convert< convert_type, wchar_t > s_converter;
+	std::lock_guard< std::mutex > lock( s_codecvtMutex );
+	try
+	{
+		sOutput = s_converter.to_bytes( sInput.c_str() );
+		return true;
+	}
+	catch ( ... )
+	{
+		sOutput.clear();
+		return false;
+	}
+}
+
+static bool UTF8to16_Codecvt( const std::string &sInput, std::wstring &sOutput )
+{
+	static std::wstring_convert< convert_type, wchar_t > s_converter;
+	std::lock_guard< std::mutex > lock( s_codecvtMutex );
+	try
+	{
+		sOutput = s_converter.from_bytes( sInput.c_str() );
+		return true;
+	}
+	catch ( ... )
+	{
+		sOutput.clear();
+		return false;
+	}
+}
+
+// codecvt quietly stopped at a lead byte too close to the end for its sequence, the transcoder reports it
+static bool CodecvtDroppedTail( const std::string &sInput, const std::wstring &sExpected )
+{
+	for ( size_t k = 1; k <= 3 && k <= sInput.size(); k++ )
+	{
+		unsigned char c = sInput[ sInput.size() - k ];
+		if ( c < 0xC0 || k >= (size_t)( c < 0xE0 ? 2 : c < 0xF0 ? 3 : 4 ) )
+			continue;
+
+		std::wstring sPrefix;
+		UTF8to16( sInput.data(), sInput.size() - k, sPrefix );
+		if ( sPrefix == sExpected )
+			return true;
+	}
+	return false;
+}
+
+static std::wstring RandomWide( std::mt19937 &rng )
+{
+	std::wstring sResult;
+	uint32_t unUnits = rng() % 40;
+	for ( uint32_t i = 0; i < unUnits; i++ )
+	{
+		switch ( rng() % 6 )
+		{
+		case 0:
+		case 1:
+			sResult += (wchar_t)( 1 + rng() % 0x7F );
+			break;
+		case 2:
+			sResult += (wchar_t)( 0x80 + rng() % 0xFF80 );
+			break;
+		case 3:
+			if ( sizeof( wchar_t ) > 2 )
+				sResult += (wchar_t)( 0x10000 + rng() % 0x100000 );
+			break;
+		case 4:
+			// unpaired surrogates pass through in their 3 byte form. With a 16 bit wchar_t two of them
+			// could make a pair, which the UCS-2 codecvt didn't know about.
+			if ( sizeof( wchar_t ) > 2 )
+				sResult += (wchar_t)( 0xD800 + rng() % 0x800 );
+			break;
+		case 5:
+			sResult += std::wstring( 20, L'x' );
+			break;
+		}
+	}
+	return sResult;
+}
+
+static void CheckUTF8to16( const std::string &sInput )
+{
+	std::wstring sExpected;
+	bool bExpected = UTF8to16_Codecvt( sInput, sExpected );
+	std::wstring sActual;
+	bool bActual = UTF8to16( sInput.data(), sInput.size(), sActual );
+
+	CHECK( UTF8to16( sInput ) == sActual );
+	CHECK( bActual == !sActual.empty() || sInput.empty() );
+
+	bool bMatches = bExpected == bActual && sExpected == sActual;
+	if ( bExpected && !bActual && CodecvtDroppedTail( sInput, sExpected ) )
+		bMatches = true;
+	// a 16 bit wchar_t codecvt was UCS-2 and failed on anything past U+FFFF
+	if ( sizeof( wchar_t ) == 2 && !bExpected && bActual )
+		bMatches = true;
+	if ( !bMatches )
+	{
+		if ( s_nFailures < 10 )
+			PrintBytes( "UTF8to16 differs from codecvt_utf8 on", sInput );
+		s_nFailures++;
+		return;
+	}
+
+	if ( bActual )
+	{
+		// the caller buffer overloads, at the exact size and one short
+		std::vector< wchar_t > vecBuffer( sActual.size() + 1 );
+		EUTFError eError;
+		size_t unLength = UTF8to16( sInput.data(), sInput.size(), vecBuffer.data(), vecBuffer.size(), &eError );
+		CHECK( eError == UTFError_None && unLength == sActual.size() && std::wstring( vecBuffer.data() ) == sActual );
+		unLength = UTF8to16( sInput.data(), sInput.size(), vecBuffer.data(), vecBuffer.size() - 1, &eError );
+		CHECK( eError == UTFError_BufferTooSmall && unLength == sActual.size() );
+	}
+}
+
+static void CheckUTF16to8( const std::wstring &sInput )
+{
+	std::string sExpected;
+	bool bExpected = UTF16to8_Codecvt( sInput, sExpected );
+	std::string sActual;
+	bool bActual = UTF16to8( sInput.data(), sInput.size(), sActual );
+
+	CHECK( UTF16to8( sInput ) == sActual );
+	if ( bExpected != bActual || sExpected != sActual )
+	{
+		if ( s_nFailures < 10 )
+			fprintf( stderr, "UTF16to8 differs from codecvt_utf8 on a %u unit input\n", (uint32_t)sInput.size() );
+		s_nFailures++;
+		return;
+	}
+
+	if ( bActual )
+	{
+		std::vector< char > vecBuffer( sActual.size() + 1 );
+		EUTFError eError;
+		size_t unLength = UTF16to8( sInput.data(), sInput.size(), vecBuffer.data(), vecBuffer.size(), &eError );
+		CHECK( eError == UTFError_None && unLength == sActual.size() && std::string( vecBuffer.data() ) == sActual );
+		unLength = UTF16to8( sInput.data(), sInput.size(), vecBuffer.data(), vecBuffer.size() - 1, &eError );
+		CHECK( eError == UTFError_BufferTooSmall && unLength == sActual.size() );
+	}
+}
+
+static void TestTranscoder()
+{
+	std::mt19937 rng( 99 );
+	for ( uint32_t i = 0; i < 200000; i++ )
+	{
+		CheckUTF8to16( RandomUTF8( rng ) );
+		CheckUTF16to8( RandomWide( rng ) );
+	}
+
+	// characters past U+FFFF become surrogate pairs with a 16 bit wchar_t, and a truncated tail is an error
+	CHECK( UTF16to8( std::wstring( 1, (wchar_t)0x110000 ) ).empty() || sizeof( wchar_t ) == 2 );
+	CHECK( UTF8to16( std::string( "\xF0\x9F\x98\x80" ) ).size() == ( sizeof( wchar_t ) == 2 ? 2u : 1u ) );
+	CHECK( UTF16to8( UTF8to16( std::string( "\xF0\x9F\x98\x80 \xE4\xB8\xAD" ) ) ) == "\xF0\x9F\x98\x80 \xE4\xB8\xAD" );
+	CHECK( UTF8to16( std::string( "\xE4\xB8" ) ).empty() );
+}
+
+static void BenchmarkTranscoder()
+{
+	std::string sAscii, sCJK;
+	while ( sAscii.size() < 16384 )
+		sAscii += "C:/Program Files/Steam/steamapps/common/SteamVR/ ";
+	while ( sCJK.size() < 16384 )
+		sCJK += "\xE4\xB8\xAD\xE6\x96\x87\xE6\xB5\x8B\xE8\xAF\x95/";
+
+	const char *rgchNames[] = { "ascii", "cjk" };
+	const std::string *rgpInputs[] = { &sAscii, &sCJK };
+	uint32_t unThreads = GetBenchThreadCount();
+	for ( uint32_t unThreadCount : { 1u, unThreads } )
+	{
+		for ( int i = 0; i < 2; i++ )
+		{
+			const std::string &sInput = *rgpInputs[ i ];
+			std::wstring sOutput;
+			double flOld = MeasureMBps( unThreadCount, sInput.size(), [&sInput, sOutput]() mutable
+			{
+				UTF8to16_Codecvt( sInput, sOutput );
+			} );
+			double flNew = MeasureMBps( unThreadCount, sInput.size(), [&sInput]()
+			{
+				UTF8to16( sInput );
+			} );
+			double flReuse = MeasureMBps( unThreadCount, sInput.size(), [&sInput, sOutput]() mutable
+			{
+				UTF8to16( sInput.data(), sInput.size(), sOutput );
+			} );
+			printf( "UTF8to16 %-6s %2u threads: shared codecvt %8.1f MB/s, now %8.1f MB/s, reusing the output %8.1f MB/s\n",
+				rgchNames[ i ], unThreadCount, flOld, flNew, flReuse );
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: The prefix/suffix, case and tokenizing helpers as they were before
+//			they worked on views, used as the reference and benchmark baseline
+//-----------------------------------------------------------------------------
+static bool Reference_StringHasPrefix( const std::string & sString, const std::string & sPrefix )
+{
+	return 0 == strnicmp( sString.c_str(), sPrefix.c_str(), sPrefix.length() );
+}
+
+static bool Reference_StringHasPrefixCaseSensitive( const std::string & sString, const std::string & sPrefix )
+{
+	return 0 == strncmp( sString.c_str(), sPrefix.c_str(), sPrefix.length() );
+}
+
+static bool Reference_StringHasSuffix( const std::string &sString, const std::string &sSuffix )
+{
+	size_t cStrLen = sString.length();
+	size_t cSuffixLen = sSuffix.length();
+
+	if ( cSuffixLen > cStrLen )
+		return false;
+
+	std::string sStringSuffix = sString.substr( cStrLen - cSuffixLen, cSuffixLen );
+
+	return 0 == stricmp( sStringSuffix.c_str(), sSuffix.c_str() );
+}
+
+static bool Reference_StringHasSuffixCaseSensitive( const std::string &sString, const std::string &sSuffix )
+{
+	size_t cStrLen = sString.length();
+	size_t cSuffixLen = sSuffix.length();
+
+	if ( cSuffixLen > cStrLen )
+		return false;
+
+	std::string sStringSuffix = sString.substr( cStrLen - cSuffixLen, cSuffixLen );
+
+	return 0 == strncmp( sStringSuffix.c_str(), sSuffix.c_str(),cSuffixLen );
+}
+
+static std::string Reference_StringToUpper( const std::string & sString )
+{
+	std::string sOut;
+	sOut.reserve( sString.size() + 1 );
+	for( std::string::const_iterator i = sString.begin(); i != sString.end(); i++ )
+	{
+		sOut.push_back( (char)toupper( *i ) );
+	}
+
+	return sOut;
+}
+
+static std::string Reference_StringToLower( const std::string & sString )
+{
+	std::string sOut;
+	sOut.reserve( sString.size() + 1 );
+	for( std::string::const_iterator i = sString.begin(); i != sString.end(); i++ )
+	{
+		sOut.push_back( (char)tolower( *i ) );
+	}
+
+	return sOut;
+}
+
+static void Reference_V_StripExtension( std::string &in )
+{
+	// Find the last dot. If it's followed by a dot or a slash, then it's part of a 
+	// directory specifier like ../../somedir/./blah.
+	std::string::size_type test = in.rfind( '.' );
+	if ( test != std::string::npos )
+	{
+		// This handles things like ".\blah" or "c:\my@email.com\abc\def\geh"
+		// Which would otherwise wind up with "" and "c:\my@email", respectively.
+		if ( in.rfind( '\\' ) < test && in.rfind( '/' ) < test )
+		{
+			in.resize( test );
+		}
+	}
+}
+
+static std::vector<std::string> Reference_TokenizeString( const std::string & sString, char cToken )
+{
+	std::vector<std::string> vecStrings;
+	std::istringstream stream( sString );
+	std::string s;
+	while ( std::getline( stream, s, cToken ) )
+	{
+		vecStrings.push_back( s );
+	}
+
+	if ( !sString.empty() && sString.back() == cToken )
+	{
+		vecStrings.push_back( "" );
+	}
+
+	return vecStrings;
+}
+
+// mixes the bytes case folding and path handling care about, including ones on
+// either side of the letter ranges and bytes above 0x7f
+static std::string RandomText( std::mt19937 &rng, uint32_t unMaxLength )
+{
+	static const char k_rgchAlphabet[] = "aAzZ@[`{/\\.;x\x80\xff";
+	std::string sText;
+	uint32_t unLength = rng() % unMaxLength;
+	for ( uint32_t i = 0; i < unLength; i++ )
+		sText.push_back( k_rgchAlphabet[ rng() % ( sizeof( k_rgchAlphabet ) - 1 ) ] );
+	return sText;
+}
+
+static void TestStringHelpers()
+{
+	std::mt19937 rng( 3 );
+	for ( uint32_t unIteration = 0; unIteration < 200000; unIteration++ )
+	{
+		std::string sString = RandomText( rng, 40 );
+		std::string sAffix = RandomText( rng, 6 );
+		if ( rng() % 3 == 0 )
+			sAffix = sString.substr( sString.size() - std::min( sString.size(), sAffix.size() ) );
+		else if ( rng() % 2 == 0 )
+			sAffix = sString.substr( 0, std::min< size_t >( sString.size(), rng() % 20 ) );
+		if ( rng() % 2 )
+			StringToUpperInPlace( sAffix );
+
+		CHECK( StringHasPrefix( sString, sAffix ) == Reference_StringHasPrefix( sString, sAffix ) );
+		CHECK( StringHasPrefixView( sString, sAffix ) == Reference_StringHasPrefix( sString, sAffix ) );
+		CHECK( StringHasPrefixCaseSensitiveView( sString, sAffix ) == Reference_StringHasPrefixCaseSensitive( sString, sAffix ) );
+		CHECK( StringHasSuffix( sString, sAffix ) == Reference_StringHasSuffix( sString, sAffix ) );
+		CHECK( StringHasSuffixView( sString, sAffix ) == Reference_StringHasSuffix( sString, sAffix ) );
+		CHECK( StringHasSuffixCaseSensitive( sString, sAffix ) == Reference_StringHasSuffixCaseSensitive( sString, sAffix ) );
+		CHECK( StringHasSuffixCaseSensitiveView( sString, sAffix ) == Reference_StringHasSuffixCaseSensitive( sString, sAffix ) );
+		CHECK( StringEqualsCaseInsensitive( sString, sAffix ) == ( stricmp( sString.c_str(), sAffix.c_str() ) == 0 ) );
+
+		CHECK( StringToUpper( sString ) == Reference_StringToUpper( sString ) );
+		CHECK( StringToLower( sString ) == Reference_StringToLower( sString ) );
+
+		std::string sStripped = sString;
+		std::string sReferenceStripped = sString;
+		V_StripExtension( sStripped );
+		Reference_V_StripExtension( sReferenceStripped );
+		CHECK( sStripped == sReferenceStripped );
+
+		char cSeparator = ";/."[ rng() % 3 ];
+		std::vector< std::string > vecReference = Reference_TokenizeString( sString, cSeparator );
+		CHECK( TokenizeString( sString, cSeparator ) == vecReference );
+
+		std::vector< std::string > vecSplit;
+		for ( CStringView sToken : CStringSplitter( sString, cSeparator ) )
+			vecSplit.push_back( sToken.str() );
+		CHECK( vecSplit == vecReference );
+	}
+}
+
+static void BenchmarkStringHelpers()
+{
+	// a driver search path, the manifest and settings files found under it and
+	// an environment override name, the way the runtime sees them
+	std::string sSearchPath;
+	for ( int i = 0; i < 24; i++ )
+		sSearchPath += "/home/user/.local/share/Steam/steamapps/common/SteamVR/drivers/driver" + std::to_string( i ) + ";";
+	std::vector< std::string > vecFiles;
+	for ( int i = 0; i < 64; i++ )
+	{
+		vecFiles.push_back( "/home/user/.local/share/Steam/steamapps/common/SteamVR/drivers/d" + std::to_string( i )
+			+ ( i % 3 ? "/driver.vrdrivermanifest" : "/resources/settings/default.vrsettings" ) );
+	}
+	std::string sEnvName = "VR_OVERRIDE_Lighthouse_Driver_Path_With_Mixed_CASE_And_Some_Length";
+
+	printf( "Splitting 24 driver dirs:       TokenizeString reference %7.0f ns, now %7.0f ns, CStringSplitter %7.0f ns\n",
+		MeasureNsPerCall( [&] { return Reference_TokenizeString( sSearchPath, ';' ).size(); } ),
+		MeasureNsPerCall( [&] { return TokenizeString( sSearchPath, ';' ).size(); } ),
+		MeasureNsPerCall( [&]
+		{
+			size_t unLength = 0;
+			for ( CStringView sToken : CStringSplitter( sSearchPath, ';' ) )
+				unLength += sToken.size();
+			return unLength;
+		} ) );
+
+	auto countManifests = []( const std::vector< std::string > &vecPaths, bool ( *pfnHasSuffix )( const std::string &, const std::string & ) )
+	{
+		size_t unCount = 0;
+		for ( const std::string &sPath : vecPaths )
+			unCount += pfnHasSuffix( sPath, ".VRDriverManifest" );
+		return unCount;
+	};
+	const std::string sManifestSuffix = ".VRDriverManifest";
+	printf( "Matching 64 manifest names:     StringHasSuffix reference %7.0f ns, now %7.0f ns, view %7.0f ns\n",
+		MeasureNsPerCall( [&] { return countManifests( vecFiles, Reference_StringHasSuffix ); } ),
+		MeasureNsPerCall( [&] { return countManifests( vecFiles, StringHasSuffix ); } ),
+		MeasureNsPerCall( [&]
+		{
+			size_t unCount = 0;
+			for ( const std::string &sPath : vecFiles )
+				unCount += StringHasSuffixView( sPath, sManifestSuffix );
+			return unCount;
+		} ) );
+
+	std::string sLowered = sEnvName;
+	printf( "Lowercasing an override name:   StringToLower reference %7.0f ns, now %7.0f ns, in place %7.0f ns\n",
+		MeasureNsPerCall( [&] { return Reference_StringToLower( sEnvName ).size(); } ),
+		MeasureNsPerCall( [&] { return StringToLower( sEnvName ).size(); } ),
+		MeasureNsPerCall( [&] { StringToLowerInPlace( sLowered ); return sLowered.size(); } ) );
+}
+
+int main( int argc, char *argv[] )
+{
+	ParseTestArgs( argc, argv );
+
+	TestRepairUTF8();
+	TestTranscoder();
+	TestStringHelpers();
+	BenchmarkRepairUTF8();
+	BenchmarkTranscoder();
+	BenchmarkStringHelpers();
+
+	return FinishTest( "strtools_test" );
+}
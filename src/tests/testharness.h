@@ -0,0 +1,121 @@
+//========= Copyright Valve Corporation ============//
+// What the tests here and under samples/driver_sample/tests share: CHECK, the
+// -bench switch and the timing loops. Every test is its own executable, so
+// the failure count and benchmark duration live in this header.
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+static int s_nFailures = 0;
+static double s_flBenchSeconds = 0.05;		// per measurement, raised by -bench
+
+#define CHECK( expr ) \
+	do \
+	{ \
+		if ( !( expr ) ) \
+		{ \
+			fprintf( stderr, "%s:%d: CHECK( %s ) failed\n", __FILE__, __LINE__, #expr ); \
+			s_nFailures++; \
+		} \
+	} while ( 0 )
+
+
+//-----------------------------------------------------------------------------
+// Purpose: -bench runs each measurement for a second instead of a moment
+//-----------------------------------------------------------------------------
+static inline void ParseTestArgs( int argc, char *argv[] )
+{
+	for ( int i = 1; i < argc; i++ )
+	{
+		if ( !strcmp( argv[ i ], "-bench" ) )
+			s_flBenchSeconds = 1.0;
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Reports the result and returns the exit code for main
+//-----------------------------------------------------------------------------
+static inline int FinishTest( const char *pchName )
+{
+	if ( s_nFailures )
+	{
+		fprintf( stderr, "%d checks failed\n", s_nFailures );
+		return 1;
+	}
+	printf( "%s passed\n", pchName );
+	return 0;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Calls fn over and over for the benchmark duration, at least once,
+//			and returns the average ns per call. Whatever fn returns is kept
+//			so the work can't be optimized away.
+//-----------------------------------------------------------------------------
+template< class Fn >
+static double MeasureNsPerCall( Fn fn )
+{
+	volatile size_t unSink = 0;
+	uint64_t ulCalls = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::chrono::duration< double > duration( s_flBenchSeconds );
+	do
+	{
+		unSink += ( size_t )fn();
+		ulCalls++;
+	} while ( std::chrono::steady_clock::now() - start < duration );
+
+	return std::chrono::duration< double, std::nano >( std::chrono::steady_clock::now() - start ).count() / ulCalls;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Runs fn on unThreads threads for the benchmark duration and
+//			returns the combined throughput, given the bytes each call covers
+//-----------------------------------------------------------------------------
+template< class Fn >
+static double MeasureMBps( uint32_t unThreads, size_t unBytesPerCall, Fn fn )
+{
+	std::vector< uint64_t > vecCalls( unThreads, 0 );
+	std::vector< std::thread > vecThreads;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::chrono::duration< double > duration( s_flBenchSeconds );
+	for ( uint32_t unThread = 0; unThread < unThreads; unThread++ )
+	{
+		vecThreads.push_back( std::thread( [&, unThread]
+		{
+			Fn fnThread = fn;
+			do
+			{
+				fnThread();
+				vecCalls[ unThread ]++;
+			} while ( std::chrono::steady_clock::now() - start < duration );
+		} ) );
+	}
+
+	uint64_t ulCalls = 0;
+	for ( uint32_t unThread = 0; unThread < unThreads; unThread++ )
+	{
+		vecThreads[ unThread ].join();
+		ulCalls += vecCalls[ unThread ];
+	}
+	double flSeconds = std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+	return (double)unBytesPerCall * ulCalls / flSeconds / 1e6;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: How many threads the threaded benchmarks use; always at least two
+//			so contention shows even on a single core
+//-----------------------------------------------------------------------------
+static inline uint32_t GetBenchThreadCount()
+{
+	uint32_t unThreads = std::thread::hardware_concurrency();
+	return unThreads < 2 ? 2 : unThreads;
+}
@@ -6,6 +6,9 @@
 #include <errno.h>
 #include <string.h>
 
+#include <algorithm>
+#include <atomic>
+
 #ifdef _WIN32
 #include "windows.h"
 #else
@@ -13,6 +16,8 @@
 #include <stdio.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
 #endif
 
 #if defined( OSX )
@@ -99,3 +104,451 @@ bool BCreateDirectory( const char *pchPath )
 #endif
 }
 
+
+// directories whose fds are kept open for openat/mkdirat; past this they're all closed again
+static const size_t k_unMaxDirectoryHandles = 64;
+
+// the SYNC_FILE_RANGE_WRITE kick-off in batches is Linux only; elsewhere the sync at commit does it all
+#if defined( LINUX ) && defined( SYNC_FILE_RANGE_WRITE )
+#define DIRTOOLS_START_WRITEBACK 1
+#endif
+
+
+//-----------------------------------------------------------------------------
+// Purpose: The absolute, compacted form of a directory path used as the cache key
+//-----------------------------------------------------------------------------
+static std::string NormalizeDirectory( const std::string & sPath )
+{
+	std::string sDirectory = Path_IsAbsolute( sPath ) ? Path_Compact( sPath ) : Path_MakeAbsolute( sPath, Path_GetWorkingDirectory() );
+	if ( sDirectory.size() > 1 )
+		sDirectory = Path_RemoveTrailingSlash( sDirectory );
+	return sDirectory;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+CDirectoryWriter::CDirectoryWriter( EFileWriteDurability eDurability )
+	: m_eDurability( eDurability )
+	, m_bInBatch( false )
+{
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+CDirectoryWriter::~CDirectoryWriter()
+{
+	AbortBatch();
+	ClearDirectoryCache();
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+void CDirectoryWriter::ClearDirectoryCache()
+{
+	CloseDirectoryHandles();
+	m_setKnownDirectories.clear();
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Lets go of the held directory fds but keeps knowing the directories
+//-----------------------------------------------------------------------------
+void CDirectoryWriter::CloseDirectoryHandles()
+{
+#if !defined( _WIN32 )
+	for ( std::map< std::string, intptr_t >::iterator i = m_mapDirectoryHandles.begin(); i != m_mapDirectoryHandles.end(); i++ )
+	{
+		close( ( int )i->second );
+	}
+#endif
+	m_mapDirectoryHandles.clear();
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns an fd for the directory, opening it if it isn't held yet,
+//			or -1 with errno set if it can't be opened. Always -1 on Windows,
+//			which works with full paths.
+//-----------------------------------------------------------------------------
+intptr_t CDirectoryWriter::GetDirectoryHandle( const std::string & sDirectory )
+{
+#if defined( _WIN32 )
+	return -1;
+#else
+	std::map< std::string, intptr_t >::iterator i = m_mapDirectoryHandles.find( sDirectory );
+	if ( i != m_mapDirectoryHandles.end() )
+		return i->second;
+
+	int fd = open( sDirectory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+	if ( fd < 0 )
+		return -1;
+
+	m_mapDirectoryHandles[ sDirectory ] = fd;
+	m_setKnownDirectories.insert( sDirectory );
+	return fd;
+#endif
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Creates the directory and any missing parents, starting from the
+//			deepest one that is known or can be opened
+//-----------------------------------------------------------------------------
+bool CDirectoryWriter::BCreateDirectoryRecursive( const std::string & sPath )
+{
+	std::string sDirectory = NormalizeDirectory( sPath );
+	if ( sDirectory.empty() )
+		return false;
+
+	if ( m_setKnownDirectories.count( sDirectory ) )
+		return true;
+
+#if defined( _WIN32 )
+	if ( !::BCreateDirectoryRecursive( sDirectory.c_str() ) )
+		return false;
+
+	m_setKnownDirectories.insert( sDirectory );
+	return true;
+#else
+	// handles are only let go of here and in BWriteFileAtomic, never while one is in use
+	if ( m_mapDirectoryHandles.size() >= k_unMaxDirectoryHandles )
+		CloseDirectoryHandles();
+
+	// walk back to the deepest directory that exists
+	const char slash = Path_GetSlash();
+	size_t unBaseEnd = sDirectory.size();
+	intptr_t nParent = GetDirectoryHandle( sDirectory );
+	while ( nParent < 0 )
+	{
+		if ( errno != ENOENT || unBaseEnd == 0 )
+			return false;
+
+		unBaseEnd = sDirectory.rfind( slash, unBaseEnd - 1 );
+		if ( unBaseEnd == std::string::npos )
+			return false;
+
+		std::string sBase = unBaseEnd == 0 ? std::string( 1, slash ) : sDirectory.substr( 0, unBaseEnd );
+		nParent = GetDirectoryHandle( sBase );
+	}
+
+	// and create the rest relative to it, one component at a time
+	size_t unComponent = unBaseEnd;
+	while ( unComponent < sDirectory.size() )
+	{
+		unComponent++;
+		size_t unComponentEnd = sDirectory.find( slash, unComponent );
+		if ( unComponentEnd == std::string::npos )
+			unComponentEnd = sDirectory.size();
+
+		std::string sComponent = sDirectory.substr( unComponent, unComponentEnd - unComponent );
+		if ( mkdirat( ( int )nParent, sComponent.c_str(), S_IRWXU | S_IRWXG | S_IRWXO ) == 0 )
+		{
+			// the new entry only sticks once its parent has been synced
+			if ( m_eDurability == FileWriteDurability_Full )
+				fsync( ( int )nParent );
+		}
+		else if ( errno != EEXIST )
+		{
+			return false;
+		}
+
+		int fd = openat( ( int )nParent, sComponent.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+		if ( fd < 0 )
+			return false;
+
+		std::string sCreated = sDirectory.substr( 0, unComponentEnd );
+		m_mapDirectoryHandles[ sCreated ] = fd;
+		m_setKnownDirectories.insert( sCreated );
+		nParent = fd;
+		unComponent = unComponentEnd;
+	}
+
+	return true;
+#endif
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: A temp name no other writer will pick, in this process or another.
+//			It still ends in .tmp so leftovers are easy to spot.
+//-----------------------------------------------------------------------------
+static std::string MakeTempName( const std::string & sName )
+{
+	static std::atomic< uint32_t > s_unTempFiles( 0 );
+#if defined( _WIN32 )
+	unsigned long ulProcess = ::GetCurrentProcessId();
+#else
+	unsigned long ulProcess = ( unsigned long )getpid();
+#endif
+	return sName + "." + std::to_string( ulProcess ) + "." + std::to_string( s_unTempFiles++ ) + ".tmp";
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+bool CDirectoryWriter::BWriteFileAtomic( const std::string & sPath, const void *pData, size_t unSize )
+{
+	const char slash = Path_GetSlash();
+	std::string sFixedPath = Path_FixSlashes( sPath );
+	size_t unSlash = sFixedPath.rfind( slash );
+	std::string sName = unSlash == std::string::npos ? sFixedPath : sFixedPath.substr( unSlash + 1 );
+	if ( sName.empty() )
+		return false;
+
+	PendingFile_t file;
+	file.sDirectory = NormalizeDirectory( unSlash == std::string::npos ? "." : unSlash == 0 ? std::string( 1, slash ) : sFixedPath.substr( 0, unSlash ) );
+	file.sName = sName;
+
+	// a second write to a file in the same batch reuses the first one's temp name, so it
+	// takes over from the first rather than leaving two temp files for one rename
+	std::string sPendingKey = Path_Join( file.sDirectory, sName );
+	std::map< std::string, PendingFile_t >::iterator iPending = m_mapPendingFiles.find( sPendingKey );
+	bool bReplacesPending = iPending != m_mapPendingFiles.end();
+	if ( bReplacesPending )
+	{
+		file.sTempName = iPending->second.sTempName;
+		m_mapPendingFiles.erase( iPending );
+	}
+	else
+	{
+		file.sTempName = MakeTempName( sName );
+	}
+
+#if defined( _WIN32 )
+	std::wstring wsTempPath = UTF8to16( Path_Join( file.sDirectory, file.sTempName ).c_str() );
+	HANDLE hFile = ::CreateFileW( wsTempPath.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL );
+	if ( hFile == INVALID_HANDLE_VALUE )
+	{
+		if ( bReplacesPending )
+			RemoveTempFile( file );
+		return false;
+	}
+
+	const uint8_t *pCursor = ( const uint8_t * )pData;
+	size_t unRemaining = unSize;
+	while ( unRemaining > 0 )
+	{
+		DWORD unWritten = 0;
+		DWORD unChunk = ( DWORD )std::min< size_t >( unRemaining, 1u << 30 );
+		if ( !::WriteFile( hFile, pCursor, unChunk, &unWritten, NULL ) || unWritten == 0 )
+		{
+			::CloseHandle( hFile );
+			::DeleteFileW( wsTempPath.c_str() );
+			return false;
+		}
+		pCursor += unWritten;
+		unRemaining -= unWritten;
+	}
+	intptr_t nFile = ( intptr_t )hFile;
+#else
+	if ( m_mapDirectoryHandles.size() >= k_unMaxDirectoryHandles )
+		CloseDirectoryHandles();
+
+	intptr_t nDirectory = GetDirectoryHandle( file.sDirectory );
+	if ( nDirectory < 0 )
+		return false;
+
+	int fd = openat( ( int )nDirectory, file.sTempName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666 );
+	if ( fd < 0 )
+	{
+		if ( bReplacesPending )
+			RemoveTempFile( file );
+		return false;
+	}
+
+	const uint8_t *pCursor = ( const uint8_t * )pData;
+	size_t unRemaining = unSize;
+	while ( unRemaining > 0 )
+	{
+		ssize_t nWritten = write( fd, pCursor, unRemaining );
+		if ( nWritten < 0 && errno == EINTR )
+			continue;
+		if ( nWritten <= 0 )
+		{
+			close( fd );
+			unlinkat( ( int )nDirectory, file.sTempName.c_str(), 0 );
+			return false;
+		}
+		pCursor += nWritten;
+		unRemaining -= ( size_t )nWritten;
+	}
+	intptr_t nFile = fd;
+#endif
+
+	if ( m_bInBatch )
+	{
+		// the file is closed until the commit, which opens it again to sync it
+#if defined( _WIN32 )
+		::CloseHandle( hFile );
+#else
+#if defined( DIRTOOLS_START_WRITEBACK )
+		// get the data heading to disk now so the syncs at commit have less to wait for
+		if ( m_eDurability != FileWriteDurability_None )
+			sync_file_range( fd, 0, 0, SYNC_FILE_RANGE_WRITE );
+#endif
+		if ( close( fd ) != 0 )
+		{
+			unlinkat( ( int )nDirectory, file.sTempName.c_str(), 0 );
+			return false;
+		}
+#endif
+		m_mapPendingFiles[ sPendingKey ] = file;
+		return true;
+	}
+
+	if ( !BPutFileInPlace( file, nFile ) )
+		return false;
+
+	return m_eDurability != FileWriteDurability_Full || BSyncDirectory( file.sDirectory );
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Syncs the temp file if asked to, closes it and renames it over the
+//			real name. nFile is the temp file if it's still open; a batched
+//			one was closed after writing and is opened again if it needs a sync.
+//-----------------------------------------------------------------------------
+bool CDirectoryWriter::BPutFileInPlace( const PendingFile_t & file, intptr_t nFile )
+{
+#if defined( _WIN32 )
+	std::wstring wsTempPath = UTF8to16( Path_Join( file.sDirectory, file.sTempName ).c_str() );
+	HANDLE hFile = ( HANDLE )nFile;
+	if ( hFile == INVALID_HANDLE_VALUE && m_eDurability != FileWriteDurability_None )
+		hFile = ::CreateFileW( wsTempPath.c_str(), GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+
+	bool bSynced = m_eDurability == FileWriteDurability_None || ( hFile != INVALID_HANDLE_VALUE && ::FlushFileBuffers( hFile ) );
+	if ( hFile != INVALID_HANDLE_VALUE )
+		::CloseHandle( hFile );
+
+	if ( !bSynced )
+	{
+		::DeleteFileW( wsTempPath.c_str() );
+		return false;
+	}
+
+	std::wstring wsPath = UTF8to16( Path_Join( file.sDirectory, file.sName ).c_str() );
+	DWORD unFlags = MOVEFILE_REPLACE_EXISTING;
+	if ( m_eDurability == FileWriteDurability_Full )
+		unFlags |= MOVEFILE_WRITE_THROUGH;
+	if ( !::MoveFileExW( wsTempPath.c_str(), wsPath.c_str(), unFlags ) )
+	{
+		::DeleteFileW( wsTempPath.c_str() );
+		return false;
+	}
+	return true;
+#else
+	intptr_t nDirectory = GetDirectoryHandle( file.sDirectory );
+	int fd = ( int )nFile;
+	if ( fd < 0 && nDirectory >= 0 && m_eDurability != FileWriteDurability_None )
+		fd = openat( ( int )nDirectory, file.sTempName.c_str(), O_WRONLY | O_CLOEXEC );
+
+#if defined( LINUX )
+	bool bSynced = m_eDurability == FileWriteDurability_None || ( fd >= 0 && fdatasync( fd ) == 0 );
+#else
+	bool bSynced = m_eDurability == FileWriteDurability_None || ( fd >= 0 && fsync( fd ) == 0 );
+#endif
+	bool bClosed = fd < 0 || close( fd ) == 0;
+
+	if ( nDirectory < 0 )
+		return false;
+
+	if ( !bSynced || !bClosed || renameat( ( int )nDirectory, file.sTempName.c_str(), ( int )nDirectory, file.sName.c_str() ) != 0 )
+	{
+		unlinkat( ( int )nDirectory, file.sTempName.c_str(), 0 );
+		return false;
+	}
+	return true;
+#endif
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Makes the renames in a directory stick. Windows does that as part
+//			of MoveFileEx with MOVEFILE_WRITE_THROUGH.
+//-----------------------------------------------------------------------------
+bool CDirectoryWriter::BSyncDirectory( const std::string & sDirectory )
+{
+#if defined( _WIN32 )
+	return true;
+#else
+	intptr_t nDirectory = GetDirectoryHandle( sDirectory );
+	return nDirectory >= 0 && fsync( ( int )nDirectory ) == 0;
+#endif
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+void CDirectoryWriter::BeginBatch()
+{
+	m_bInBatch = true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: All the file syncs come before any rename, and each directory is
+//			synced once after all of its renames
+//-----------------------------------------------------------------------------
+bool CDirectoryWriter::CommitBatch()
+{
+	bool bSuccess = true;
+	std::set< std::string > setDirectories;
+	for ( std::map< std::string, PendingFile_t >::const_iterator i = m_mapPendingFiles.begin(); i != m_mapPendingFiles.end(); i++ )
+	{
+		if ( BPutFileInPlace( i->second, -1 ) )
+			setDirectories.insert( i->second.sDirectory );
+		else
+			bSuccess = false;
+	}
+	m_mapPendingFiles.clear();
+	m_bInBatch = false;
+
+	if ( m_eDurability == FileWriteDurability_Full )
+	{
+		for ( std::set< std::string >::const_iterator i = setDirectories.begin(); i != setDirectories.end(); i++ )
+		{
+			if ( !BSyncDirectory( *i ) )
+				bSuccess = false;
+		}
+	}
+
+	return bSuccess;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+void CDirectoryWriter::AbortBatch()
+{
+	for ( std::map< std::string, PendingFile_t >::const_iterator i = m_mapPendingFiles.begin(); i != m_mapPendingFiles.end(); i++ )
+	{
+		RemoveTempFile( i->second );
+	}
+	m_mapPendingFiles.clear();
+	m_bInBatch = false;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Deletes the temp file of a write that won't be put in place
+//-----------------------------------------------------------------------------
+void CDirectoryWriter::RemoveTempFile( const PendingFile_t & file )
+{
+#if defined( _WIN32 )
+	std::wstring wsTempPath = UTF8to16( Path_Join( file.sDirectory, file.sTempName ).c_str() );
+	::DeleteFileW( wsTempPath.c_str() );
+#else
+	intptr_t nDirectory = GetDirectoryHandle( file.sDirectory );
+	if ( nDirectory >= 0 )
+		unlinkat( ( int )nDirectory, file.sTempName.c_str(), 0 );
+#endif
+}
@@ -2,7 +2,10 @@
 #pragma once
 
 #include <stdint.h>
+#include <map>
+#include <set>
 #include <string>
+#include <vector>
 
 
 #if !defined(_WIN32)
@@ -15,3 +18,80 @@ extern bool BCreateDirectoryRecursive( const char *pchPath );
 extern bool BCreateDirectory( const char *pchPath );
 
 
+/** How much a CDirectoryWriter does to make a write survive a crash or power loss */
+enum EFileWriteDurability
+{
+	FileWriteDurability_None = 0,		// rename into place and leave the flushing to the OS
+	FileWriteDurability_Data = 1,		// the contents are on disk before the new name points at them
+	FileWriteDurability_Full = 2,		// and the directory is synced, so the rename itself sticks
+};
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Creates directories and writes files atomically for code that
+//			writes many small files into the same few directories.
+//			Directories it has created or found are remembered, and on POSIX
+//			their fds are held, so later work there is done with
+//			mkdirat/openat/renameat instead of walking the full path again.
+//			Between BeginBatch and CommitBatch the renames are held back and
+//			each directory is synced once for the whole batch. Batched files
+//			are closed once written and only opened again to sync them, so a
+//			batch can hold more files than the process has fds.
+//			Not thread safe; use one per thread.
+//-----------------------------------------------------------------------------
+class CDirectoryWriter
+{
+public:
+	explicit CDirectoryWriter( EFileWriteDurability eDurability = FileWriteDurability_Data );
+	~CDirectoryWriter();
+
+	void SetDurability( EFileWriteDurability eDurability ) { m_eDurability = eDurability; }
+	EFileWriteDurability GetDurability() const { return m_eDurability; }
+
+	/** Creates the directory and any missing parents */
+	bool BCreateDirectoryRecursive( const std::string & sPath );
+
+	/** Writes the file under a temporary name and renames it over sPath. The directory has to
+	* exist. Inside a batch the rename happens in CommitBatch, and writing the same path again
+	* before then replaces what was pending for it. */
+	bool BWriteFileAtomic( const std::string & sPath, const void *pData, size_t unSize );
+	bool BWriteStringToFileAtomic( const std::string & sPath, const std::string & sData ) { return BWriteFileAtomic( sPath, sData.data(), sData.size() ); }
+
+	void BeginBatch();
+
+	/** Puts every file written since BeginBatch into place. Returns false if any of them
+	* couldn't be; the rest are still committed. */
+	bool CommitBatch();
+
+	/** Drops the pending files of a batch without touching what's on disk under their names.
+	* Destroying the writer does this too. */
+	void AbortBatch();
+
+	/** Forgets the known directories, for when something else may have removed them */
+	void ClearDirectoryCache();
+
+private:
+	CDirectoryWriter( const CDirectoryWriter & ) = delete;
+	CDirectoryWriter &operator=( const CDirectoryWriter & ) = delete;
+
+	struct PendingFile_t
+	{
+		std::string sDirectory;
+		std::string sTempName;
+		std::string sName;
+	};
+
+	intptr_t GetDirectoryHandle( const std::string & sDirectory );
+	void CloseDirectoryHandles();
+	bool BPutFileInPlace( const PendingFile_t & file, intptr_t nFile );
+	void RemoveTempFile( const PendingFile_t & file );
+	bool BSyncDirectory( const std::string & sDirectory );
+
+	EFileWriteDurability m_eDurability;
+	std::set< std::string > m_setKnownDirectories;
+	std::map< std::string, intptr_t > m_mapDirectoryHandles;
+	bool m_bInBatch;
+	std::map< std::string, PendingFile_t > m_mapPendingFiles;	// by the full path they're going to
+};
+
+
@@ -0,0 +1,458 @@
+//========= Copyright Valve Corporation ============//
+#include "driverdiscovery_public.h"
+#include "json/json.h"
+#include "pathtools_public.h"
+#include "strtools_public.h"
+#include "vrpathregistry_public.h"
+
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+
+static const char *k_pchDriverManifestFilename = "driver.vrdrivermanifest";
+
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+const char *GetDriverManifestStatusName( EDriverManifestStatus eStatus )
+{
+	switch ( eStatus )
+	{
+	case DriverManifestStatus_OK:						return "OK";
+	case DriverManifestStatus_RootNotFound:				return "RootNotFound";
+	case DriverManifestStatus_ManifestNotFound:			return "ManifestNotFound";
+	case DriverManifestStatus_ManifestUnreadable:		return "ManifestUnreadable";
+	case DriverManifestStatus_ManifestParseFailed:		return "ManifestParseFailed";
+	case DriverManifestStatus_ManifestMissingName:		return "ManifestMissingName";
+	case DriverManifestStatus_DriverLibraryNotFound:	return "DriverLibraryNotFound";
+	case DriverManifestStatus_DriverLibraryInvalid:		return "DriverLibraryInvalid";
+	}
+
+	return "Unknown";
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+DriverManifestReport_t::DriverManifestReport_t()
+	: eStatus( DriverManifestStatus_RootNotFound )
+	, bAlwaysActivate( false )
+	, bResourceOnly( false )
+	, nManifestModifiedTime( 0 )
+	, ulManifestSize( 0 )
+	, nDriverLibraryModifiedTime( 0 )
+	, ulDriverLibrarySize( 0 )
+{
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns false unless the path is a regular file. The time is in
+//			whatever resolution the platform keeps it in; it's only compared.
+//-----------------------------------------------------------------------------
+static bool GetFileStamp( const std::string & sPath, int64_t *pnModifiedTime, uint64_t *pulSize )
+{
+#if defined( _WIN32 )
+	struct _stat64 buf;
+	std::wstring wsPath = UTF8to16( sPath.c_str() );
+	if ( _wstat64( wsPath.c_str(), &buf ) != 0 || ( buf.st_mode & _S_IFREG ) == 0 )
+		return false;
+
+	*pnModifiedTime = ( int64_t )buf.st_mtime;
+#else
+	struct stat buf;
+	if ( stat( sPath.c_str(), &buf ) != 0 || !S_ISREG( buf.st_mode ) )
+		return false;
+
+#if defined( OSX )
+	*pnModifiedTime = ( int64_t )buf.st_mtimespec.tv_sec * 1000000000 + buf.st_mtimespec.tv_nsec;
+#else
+	*pnModifiedTime = ( int64_t )buf.st_mtim.tv_sec * 1000000000 + buf.st_mtim.tv_nsec;
+#endif
+#endif
+
+	*pulSize = ( uint64_t )buf.st_size;
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: True if the file starts like an executable image of the kind this
+//			platform loads from PLATSUBDIR, so a Windows DLL dropped into
+//			bin/linux64 is reported as invalid rather than failing to load later
+//-----------------------------------------------------------------------------
+static bool BLooksLikeSharedLibrary( const uint8_t *pData, uint64_t ulSize )
+{
+#if defined( WIN32 )
+	// the DOS stub points at the PE header, whose machine type has to match
+	if ( ulSize < 0x40 || pData[ 0 ] != 'M' || pData[ 1 ] != 'Z' )
+		return false;
+
+	uint32_t unPEOffset = ( uint32_t )pData[ 0x3c ] | ( uint32_t )pData[ 0x3d ] << 8 | ( uint32_t )pData[ 0x3e ] << 16 | ( uint32_t )pData[ 0x3f ] << 24;
+	if ( ( uint64_t )unPEOffset + 6 > ulSize || memcmp( pData + unPEOffset, "PE\0\0", 4 ) != 0 )
+		return false;
+
+	uint16_t unMachine = ( uint16_t )( pData[ unPEOffset + 4 ] | pData[ unPEOffset + 5 ] << 8 );
+#ifdef _WIN64
+	return unMachine == 0x8664;		// IMAGE_FILE_MACHINE_AMD64
+#else
+	return unMachine == 0x14c;		// IMAGE_FILE_MACHINE_I386
+#endif
+#elif defined( OSX )
+	// osx32 holds universal binaries as well as thin ones
+	if ( ulSize < 4 )
+		return false;
+
+	uint32_t unMagic = ( uint32_t )pData[ 0 ] << 24 | ( uint32_t )pData[ 1 ] << 16 | ( uint32_t )pData[ 2 ] << 8 | pData[ 3 ];
+	switch ( unMagic )
+	{
+	case 0xfeedface: case 0xcefaedfe:		// Mach-O
+	case 0xfeedfacf: case 0xcffaedfe:		// Mach-O 64 bit
+	case 0xcafebabe: case 0xbebafeca:		// universal
+		return true;
+	}
+	return false;
+#elif defined( LINUX )
+	if ( ulSize < 20 || pData[ 0 ] != 0x7f || pData[ 1 ] != 'E' || pData[ 2 ] != 'L' || pData[ 3 ] != 'F' )
+		return false;
+
+	// EI_CLASS has to match the word size of the PLATSUBDIR we looked in, and e_machine its architecture
+#if defined( LINUX32 )
+	const uint8_t unClass = 1;				// ELFCLASS32
+	const uint16_t unMachine = 3;			// EM_386
+#elif defined( ANDROIDARM64 ) || defined( LINUXARM64 )
+	const uint8_t unClass = 2;				// ELFCLASS64
+	const uint16_t unMachine = 183;			// EM_AARCH64
+#else
+	const uint8_t unClass = 2;				// ELFCLASS64
+	const uint16_t unMachine = 62;			// EM_X86_64
+#endif
+	if ( pData[ 4 ] != unClass )
+		return false;
+
+	// e_machine follows the file's byte order, which EI_DATA gives
+	switch ( pData[ 5 ] )
+	{
+	case 1:		// ELFDATA2LSB
+		return ( uint16_t )( pData[ 18 ] | pData[ 19 ] << 8 ) == unMachine;
+	case 2:		// ELFDATA2MSB
+		return ( uint16_t )( pData[ 18 ] << 8 | pData[ 19 ] ) == unMachine;
+	}
+	return false;
+#else
+	return ulSize > 0;
+#endif
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: What one scanning thread keeps from manifest to manifest, so the
+//			reader, the JSON tree and the file buffers are set up once per
+//			thread rather than once per driver
+//-----------------------------------------------------------------------------
+class CDriverManifestParser
+{
+public:
+	CDriverManifestParser()
+	{
+		Json::CharReaderBuilder builder;
+		m_pReader.reset( builder.newCharReader() );
+	}
+
+	void ScanRoot( const std::string & sRoot, DriverManifestReport_t *pReport );
+
+private:
+	bool BParseManifest( DriverManifestReport_t *pReport );
+
+	std::unique_ptr< Json::CharReader > m_pReader;
+	Json::Value m_root;
+	std::string m_sErrors;
+	CPathMappedFile m_file;
+};
+
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+bool CDriverManifestParser::BParseManifest( DriverManifestReport_t *pReport )
+{
+	if ( !Path_MapFile( pReport->sManifestPath, &m_file ) )
+	{
+		pReport->eStatus = DriverManifestStatus_ManifestUnreadable;
+		return false;
+	}
+
+	const char *pchBegin = ( const char * )m_file.GetData();
+	const char *pchEnd = pchBegin + m_file.GetSize();
+	if ( pchEnd - pchBegin >= 3 && !memcmp( pchBegin, "\xEF\xBB\xBF", 3 ) )
+		pchBegin += 3;
+
+	m_root = Json::Value();
+	m_sErrors.clear();
+	try
+	{
+		if ( !m_pReader->parse( pchBegin, pchEnd, &m_root, &m_sErrors ) || !m_root.isObject() )
+		{
+			pReport->eStatus = DriverManifestStatus_ManifestParseFailed;
+			pReport->sError = m_sErrors.empty() ? "manifest is not a JSON object" : m_sErrors;
+			m_file.Close();
+			return false;
+		}
+
+		const Json::Value & name = m_root[ "name" ];
+		if ( name.isString() )
+			pReport->sName = name.asString();
+
+		const Json::Value & directory = m_root[ "directory" ];
+		if ( directory.isString() )
+			pReport->sDirectory = directory.asString();
+
+		pReport->bAlwaysActivate = m_root[ "alwaysActivate" ].isBool() && m_root[ "alwaysActivate" ].asBool();
+		pReport->bResourceOnly = m_root[ "resourceOnly" ].isBool() && m_root[ "resourceOnly" ].asBool();
+
+		const Json::Value & hmdPresence = m_root[ "hmd_presence" ];
+		if ( hmdPresence.isArray() )
+		{
+			for ( Json::ArrayIndex unIndex = 0; unIndex < hmdPresence.size(); unIndex++ )
+			{
+				if ( hmdPresence[ unIndex ].isString() )
+					pReport->vecHmdPresence.push_back( hmdPresence[ unIndex ].asString() );
+			}
+		}
+	}
+	catch ( ... )
+	{
+		pReport->eStatus = DriverManifestStatus_ManifestParseFailed;
+		pReport->sError = "exception thrown in JSON library";
+		m_file.Close();
+		return false;
+	}
+
+	m_file.Close();
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+void CDriverManifestParser::ScanRoot( const std::string & sRoot, DriverManifestReport_t *pReport )
+{
+	*pReport = DriverManifestReport_t();
+	pReport->sRootPath = sRoot;
+
+	if ( !Path_IsDirectory( sRoot ) )
+	{
+		pReport->eStatus = DriverManifestStatus_RootNotFound;
+		return;
+	}
+
+	pReport->sManifestPath = Path_Join( sRoot, k_pchDriverManifestFilename );
+	if ( !GetFileStamp( pReport->sManifestPath, &pReport->nManifestModifiedTime, &pReport->ulManifestSize ) )
+	{
+		pReport->eStatus = DriverManifestStatus_ManifestNotFound;
+		return;
+	}
+
+	if ( !BParseManifest( pReport ) )
+		return;
+
+	if ( pReport->sName.empty() )
+	{
+		pReport->eStatus = DriverManifestStatus_ManifestMissingName;
+		return;
+	}
+
+	if ( pReport->bResourceOnly )
+	{
+		pReport->eStatus = DriverManifestStatus_OK;
+		return;
+	}
+
+	// the manifest can put the rest of the driver somewhere other than next to itself
+	std::string sDriverDirectory = sRoot;
+	if ( !pReport->sDirectory.empty() )
+		sDriverDirectory = Path_MakeAbsolute( pReport->sDirectory, sRoot );
+
+	pReport->sDriverLibraryPath = Path_Join( sDriverDirectory, "bin", PLATSUBDIR, "driver_" + pReport->sName + DYNAMIC_LIB_EXT );
+	if ( !GetFileStamp( pReport->sDriverLibraryPath, &pReport->nDriverLibraryModifiedTime, &pReport->ulDriverLibrarySize ) )
+	{
+		pReport->eStatus = DriverManifestStatus_DriverLibraryNotFound;
+		return;
+	}
+
+	// only the header is looked at, and mapping it doesn't read the rest
+	bool bValid = Path_MapFile( pReport->sDriverLibraryPath, &m_file, PathMapFileAccess_Random )
+		&& BLooksLikeSharedLibrary( m_file.GetData(), m_file.GetSize() );
+	m_file.Close();
+
+	pReport->eStatus = bValid ? DriverManifestStatus_OK : DriverManifestStatus_DriverLibraryInvalid;
+}
+
+
+// std::min takes it by reference
+const uint32_t CDriverManifestScanner::k_unMaxThreads;
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+CDriverManifestScanner::CDriverManifestScanner( uint32_t unThreadCount )
+	: m_unThreadCount( unThreadCount )
+	, m_unLastScanCacheHits( 0 )
+{
+	if ( m_unThreadCount == 0 )
+		m_unThreadCount = std::max( 1u, std::thread::hardware_concurrency() );
+	m_unThreadCount = std::min( m_unThreadCount, k_unMaxThreads );
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns true if the cached report for the root still describes the
+//			files on disk. Only the cache lookup is done under the lock; the
+//			stats are not.
+//-----------------------------------------------------------------------------
+bool CDriverManifestScanner::BFindCachedReport( const std::string & sRoot, DriverManifestReport_t *pReport )
+{
+	{
+		std::lock_guard< std::mutex > lock( m_mutexCache );
+		std::map< std::string, DriverManifestReport_t >::const_iterator i = m_mapCache.find( sRoot );
+		if ( i == m_mapCache.end() )
+			return false;
+		*pReport = i->second;
+	}
+
+	// reports without a manifest are cheap to rebuild and may have been fixed since
+	if ( pReport->nManifestModifiedTime == 0 && pReport->ulManifestSize == 0 )
+		return false;
+
+	int64_t nModifiedTime;
+	uint64_t ulSize;
+	if ( !GetFileStamp( pReport->sManifestPath, &nModifiedTime, &ulSize )
+		|| nModifiedTime != pReport->nManifestModifiedTime || ulSize != pReport->ulManifestSize )
+		return false;
+
+	if ( !pReport->sDriverLibraryPath.empty() )
+	{
+		bool bLibraryExists = GetFileStamp( pReport->sDriverLibraryPath, &nModifiedTime, &ulSize );
+		if ( bLibraryExists != ( pReport->eStatus != DriverManifestStatus_DriverLibraryNotFound ) )
+			return false;
+		if ( bLibraryExists && ( nModifiedTime != pReport->nDriverLibraryModifiedTime || ulSize != pReport->ulDriverLibrarySize ) )
+			return false;
+	}
+
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+void CDriverManifestScanner::Scan( const std::vector< std::string > & vecRoots, std::vector< DriverManifestReport_t > *pvecReports )
+{
+	pvecReports->clear();
+	pvecReports->resize( vecRoots.size() );
+	if ( vecRoots.empty() )
+	{
+		m_unLastScanCacheHits = 0;
+		return;
+	}
+
+	std::atomic< size_t > unNextRoot( 0 );
+	std::atomic< uint32_t > unCacheHits( 0 );
+
+	// each thread takes the next root that nobody has started on, so one slow
+	// network share only holds up the thread that got it
+	auto fnWorker = [&]()
+	{
+		CDriverManifestParser parser;
+		for ( size_t unRoot = unNextRoot++; unRoot < vecRoots.size(); unRoot = unNextRoot++ )
+		{
+			const std::string & sRoot = vecRoots[ unRoot ];
+			DriverManifestReport_t & report = ( *pvecReports )[ unRoot ];
+			if ( BFindCachedReport( sRoot, &report ) )
+			{
+				unCacheHits++;
+				continue;
+			}
+
+			parser.ScanRoot( sRoot, &report );
+
+			std::lock_guard< std::mutex > lock( m_mutexCache );
+			m_mapCache[ sRoot ] = report;
+		}
+	};
+
+	uint32_t unThreads = ( uint32_t )std::min< size_t >( m_unThreadCount, vecRoots.size() );
+	std::vector< std::thread > vecThreads;
+	vecThreads.reserve( unThreads - 1 );
+	for ( uint32_t i = 1; i < unThreads; i++ )
+	{
+		// running short of threads isn't fatal, the ones that did start and this
+		// one still get through every root
+		try
+		{
+			vecThreads.push_back( std::thread( fnWorker ) );
+		}
+		catch ( ... )
+		{
+			break;
+		}
+	}
+
+	// the calling thread does its share rather than just waiting. Destroying a
+	// joinable std::thread terminates, so the others are joined even if it throws.
+	try
+	{
+		fnWorker();
+	}
+	catch ( ... )
+	{
+		unNextRoot = vecRoots.size();
+		for ( size_t i = 0; i < vecThreads.size(); i++ )
+		{
+			vecThreads[ i ].join();
+		}
+		throw;
+	}
+
+	for ( size_t i = 0; i < vecThreads.size(); i++ )
+	{
+		vecThreads[ i ].join();
+	}
+
+	m_unLastScanCacheHits = unCacheHits;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+bool CDriverManifestScanner::ScanExternalDrivers( std::vector< DriverManifestReport_t > *pvecReports )
+{
+	CVRPathRegistry_Public pathReg;
+	if ( !pathReg.BLoadFromFile() )
+	{
+		pvecReports->clear();
+		return false;
+	}
+
+	Scan( pathReg.GetExternalDrivers(), pvecReports );
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+void CDriverManifestScanner::ClearCache()
+{
+	std::lock_guard< std::mutex > lock( m_mutexCache );
+	m_mapCache.clear();
+}
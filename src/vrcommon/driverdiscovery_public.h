@@ -0,0 +1,86 @@
+//========= Copyright Valve Corporation ============//
+#pragma once
+
+#include <stdint.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum EDriverManifestStatus
+{
+	DriverManifestStatus_OK = 0,
+	DriverManifestStatus_RootNotFound,				// the driver root isn't a directory
+	DriverManifestStatus_ManifestNotFound,			// no driver.vrdrivermanifest in the root
+	DriverManifestStatus_ManifestUnreadable,
+	DriverManifestStatus_ManifestParseFailed,		// sError has the parser's message
+	DriverManifestStatus_ManifestMissingName,
+	DriverManifestStatus_DriverLibraryNotFound,		// nothing at sDriverLibraryPath
+	DriverManifestStatus_DriverLibraryInvalid,		// sDriverLibraryPath isn't a shared library for this platform
+};
+
+const char *GetDriverManifestStatusName( EDriverManifestStatus eStatus );
+
+/** What was found in one driver root */
+struct DriverManifestReport_t
+{
+	DriverManifestReport_t();
+
+	EDriverManifestStatus eStatus;
+	std::string sError;
+
+	std::string sRootPath;
+	std::string sManifestPath;
+
+	// from the manifest
+	std::string sName;
+	std::string sDirectory;
+	bool bAlwaysActivate;
+	bool bResourceOnly;
+	std::vector< std::string > vecHmdPresence;
+
+	// bin/PLATSUBDIR/driver_<name> under the driver directory, empty for resource only drivers
+	std::string sDriverLibraryPath;
+
+	// what the report was built from, so it can be reused while neither file changes
+	int64_t nManifestModifiedTime;
+	uint64_t ulManifestSize;
+	int64_t nDriverLibraryModifiedTime;
+	uint64_t ulDriverLibrarySize;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Checks driver roots and their manifests for tools that validate
+//			many installs. Roots are handed out to a pool of threads that each
+//			keep their own JSON reader and file buffers for every manifest they
+//			parse. Reports are kept between scans and reused for as long as the
+//			manifest and the driver library keep their size and modification time.
+//-----------------------------------------------------------------------------
+class CDriverManifestScanner
+{
+public:
+	/** 0 threads picks one per core, up to k_unMaxThreads */
+	explicit CDriverManifestScanner( uint32_t unThreadCount = 0 );
+
+	static const uint32_t k_unMaxThreads = 16;
+
+	/** Fills pvecReports with one report per root, in the order of vecRoots */
+	void Scan( const std::vector< std::string > & vecRoots, std::vector< DriverManifestReport_t > *pvecReports );
+
+	/** Scans the external_drivers list from the VR path registry. Returns false if the registry couldn't be read. */
+	bool ScanExternalDrivers( std::vector< DriverManifestReport_t > *pvecReports );
+
+	void ClearCache();
+
+	/** how many reports of the last scan came from the cache */
+	uint32_t GetLastScanCacheHits() const { return m_unLastScanCacheHits; }
+
+private:
+	bool BFindCachedReport( const std::string & sRoot, DriverManifestReport_t *pReport );
+
+	uint32_t m_unThreadCount;
+	uint32_t m_unLastScanCacheHits;
+
+	std::mutex m_mutexCache;
+	std::map< std::string, DriverManifestReport_t > m_mapCache;
+};
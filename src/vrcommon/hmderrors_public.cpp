@@ -2,325 +2,469 @@
 #include "openvr.h"
 #include "hmderrors_public.h"
 #include <stdio.h>
+#include <stdint.h>
+#include <string.h>
 #include <algorithm>
+#include <vector>
 
 using namespace vr;
 
-#define RETURN_ENUM_AS_STRING(enumValue) case enumValue: return #enumValue;
+// Every EVRInitError in order of value, with its English description. Errors without one (NULL)
+// are described by their ID. Both lookup tables below are generated from this list.
+#define VR_INIT_ERROR_LIST( X ) \
+	X( VRInitError_None, "No Error (0)" ) \
+	X( VRInitError_Unknown, NULL ) \
+	\
+	/* Init */ \
+	X( VRInitError_Init_InstallationNotFound, "Installation Not Found (100)" ) \
+	X( VRInitError_Init_InstallationCorrupt, "Installation Corrupt (101)" ) \
+	X( VRInitError_Init_VRClientDLLNotFound, "vrclient Shared Lib Not Found (102)" ) \
+	X( VRInitError_Init_FileNotFound, "File Not Found (103)" ) \
+	X( VRInitError_Init_FactoryNotFound, "Factory Function Not Found (104)" ) \
+	X( VRInitError_Init_InterfaceNotFound, "Interface Not Found (105)" ) \
+	X( VRInitError_Init_InvalidInterface, "Invalid Interface (106)" ) \
+	X( VRInitError_Init_UserConfigDirectoryInvalid, "User Config Directory Invalid (107)" ) \
+	X( VRInitError_Init_HmdNotFound, "Hmd Not Found (108)" ) \
+	X( VRInitError_Init_NotInitialized, "Not Initialized (109)" ) \
+	X( VRInitError_Init_PathRegistryNotFound, "Installation path could not be located (110)" ) \
+	X( VRInitError_Init_NoConfigPath, "Config path could not be located (111)" ) \
+	X( VRInitError_Init_NoLogPath, "Log path could not be located (112)" ) \
+	X( VRInitError_Init_PathRegistryNotWritable, "Unable to write path registry (113)" ) \
+	X( VRInitError_Init_AppInfoInitFailed, "App info manager init failed (114)" ) \
+	X( VRInitError_Init_Retry, "Internal Retry (115)" ) \
+	X( VRInitError_Init_InitCanceledByUser, "User Canceled Init (116)" ) \
+	X( VRInitError_Init_AnotherAppLaunching, "Another app was already launching (117)" ) \
+	X( VRInitError_Init_SettingsInitFailed, "Settings manager init failed (118)" ) \
+	X( VRInitError_Init_ShuttingDown, "VR system shutting down (119)" ) \
+	X( VRInitError_Init_TooManyObjects, "Too many tracked objects (120)" ) \
+	X( VRInitError_Init_NoServerForBackgroundApp, "Not starting vrserver for background app (121)" ) \
+	X( VRInitError_Init_NotSupportedWithCompositor, "The requested interface is incompatible with the compositor and the compositor is running (122)" ) \
+	X( VRInitError_Init_NotAvailableToUtilityApps, "This interface is not available to utility applications (123)" ) \
+	X( VRInitError_Init_Internal, "vrserver internal error (124)" ) \
+	X( VRInitError_Init_HmdDriverIdIsNone, "Hmd DriverId is invalid (125)" ) \
+	X( VRInitError_Init_HmdNotFoundPresenceFailed, "Hmd Not Found Presence Failed (126)" ) \
+	X( VRInitError_Init_VRMonitorNotFound, "VR Monitor Not Found (127)" ) \
+	X( VRInitError_Init_VRMonitorStartupFailed, "VR Monitor startup failed (128)" ) \
+	X( VRInitError_Init_LowPowerWatchdogNotSupported, "Low Power Watchdog Not Supported (129)" ) \
+	X( VRInitError_Init_InvalidApplicationType, "Invalid Application Type (130)" ) \
+	X( VRInitError_Init_NotAvailableToWatchdogApps, "Not available to watchdog apps (131)" ) \
+	X( VRInitError_Init_WatchdogDisabledInSettings, "Watchdog disabled in settings (132)" ) \
+	X( VRInitError_Init_VRDashboardNotFound, "VR Dashboard Not Found (133)" ) \
+	X( VRInitError_Init_VRDashboardStartupFailed, "VR Dashboard startup failed (134)" ) \
+	X( VRInitError_Init_VRHomeNotFound, "VR Home Not Found (135)" ) \
+	X( VRInitError_Init_VRHomeStartupFailed, "VR home startup failed (136)" ) \
+	X( VRInitError_Init_RebootingBusy, "Rebooting In Progress (137)" ) \
+	X( VRInitError_Init_FirmwareUpdateBusy, "Firmware Update In Progress (138)" ) \
+	X( VRInitError_Init_FirmwareRecoveryBusy, "Firmware Recovery In Progress (139)" ) \
+	X( VRInitError_Init_USBServiceBusy, "USB Service Busy (140)" ) \
+	X( VRInitError_Init_VRWebHelperStartupFailed, NULL ) \
+	X( VRInitError_Init_TrackerManagerInitFailed, NULL ) \
+	X( VRInitError_Init_AlreadyRunning, NULL ) \
+	X( VRInitError_Init_FailedForVrMonitor, NULL ) \
+	X( VRInitError_Init_PropertyManagerInitFailed, NULL ) \
+	X( VRInitError_Init_WebServerFailed, NULL ) \
+	\
+	/* Driver */ \
+	X( VRInitError_Driver_Failed, "Driver Failed (200)" ) \
+	X( VRInitError_Driver_Unknown, "Driver Not Known (201)" ) \
+	X( VRInitError_Driver_HmdUnknown, "HMD Not Known (202)" ) \
+	X( VRInitError_Driver_NotLoaded, "Driver Not Loaded (203)" ) \
+	X( VRInitError_Driver_RuntimeOutOfDate, "Driver runtime is out of date (204)" ) \
+	X( VRInitError_Driver_HmdInUse, "HMD already in use by another application (205)" ) \
+	X( VRInitError_Driver_NotCalibrated, "Device is not calibrated (206)" ) \
+	X( VRInitError_Driver_CalibrationInvalid, "Device Calibration is invalid (207)" ) \
+	X( VRInitError_Driver_HmdDisplayNotFound, "HMD detected over USB, but Monitor not found (208)" ) \
+	X( VRInitError_Driver_TrackedDeviceInterfaceUnknown, "Driver Tracked Device Interface unknown (209)" ) \
+	/* VRInitError_Driver_HmdDisplayNotFoundAfterFix is left out: it is reported as VRInitError_Driver_HmdDisplayNotFound */ \
+	X( VRInitError_Driver_HmdDriverIdOutOfBounds, "Hmd DriverId is our of bounds (211)" ) \
+	X( VRInitError_Driver_HmdDisplayMirrored, "HMD detected over USB, but Monitor may be mirrored instead of extended (212)" ) \
+	X( VRInitError_Driver_HmdDisplayNotFoundLaptop, "On laptop, HMD detected over USB, but Monitor not found (213)" ) \
+	\
+	/* IPC */ \
+	X( VRInitError_IPC_ServerInitFailed, "VR Server Init Failed (300)" ) \
+	X( VRInitError_IPC_ConnectFailed, "Connect to VR Server Failed (301)" ) \
+	X( VRInitError_IPC_SharedStateInitFailed, "Shared IPC State Init Failed (302)" ) \
+	X( VRInitError_IPC_CompositorInitFailed, "Shared IPC Compositor Init Failed (303)" ) \
+	X( VRInitError_IPC_MutexInitFailed, "Shared IPC Mutex Init Failed (304)" ) \
+	X( VRInitError_IPC_Failed, "Shared IPC Failed (305)" ) \
+	X( VRInitError_IPC_CompositorConnectFailed, "Shared IPC Compositor Connect Failed (306)" ) \
+	X( VRInitError_IPC_CompositorInvalidConnectResponse, "Shared IPC Compositor Invalid Connect Response (307)" ) \
+	X( VRInitError_IPC_ConnectFailedAfterMultipleAttempts, "Shared IPC Connect Failed After Multiple Attempts (308)" ) \
+	X( VRInitError_IPC_ConnectFailedAfterTargetExited, "Shared IPC Connect Failed After Target Exited (309)" ) \
+	X( VRInitError_IPC_NamespaceUnavailable, "Shared IPC Namespace Unavailable (310)" ) \
+	\
+	/* Compositor */ \
+	X( VRInitError_Compositor_Failed, "Compositor failed to initialize (400)" ) \
+	X( VRInitError_Compositor_D3D11HardwareRequired, "Compositor failed to find DX11 hardware (401)" ) \
+	X( VRInitError_Compositor_FirmwareRequiresUpdate, "Compositor requires mandatory firmware update (402)" ) \
+	X( VRInitError_Compositor_OverlayInitFailed, "Compositor initialization succeeded, but overlay init failed (403)" ) \
+	X( VRInitError_Compositor_ScreenshotsInitFailed, "Compositor initialization succeeded, but screenshot init failed (404)" ) \
+	X( VRInitError_Compositor_UnableToCreateDevice, "Compositor unable to create graphics device (405)" ) \
+	X( VRInitError_Compositor_SharedStateIsNull, NULL ) \
+	X( VRInitError_Compositor_NotificationManagerIsNull, NULL ) \
+	X( VRInitError_Compositor_ResourceManagerClientIsNull, NULL ) \
+	X( VRInitError_Compositor_MessageOverlaySharedStateInitFailure, NULL ) \
+	X( VRInitError_Compositor_PropertiesInterfaceIsNull, NULL ) \
+	X( VRInitError_Compositor_CreateFullscreenWindowFailed, NULL ) \
+	X( VRInitError_Compositor_SettingsInterfaceIsNull, NULL ) \
+	X( VRInitError_Compositor_FailedToShowWindow, NULL ) \
+	X( VRInitError_Compositor_DistortInterfaceIsNull, NULL ) \
+	X( VRInitError_Compositor_DisplayFrequencyFailure, NULL ) \
+	X( VRInitError_Compositor_RendererInitializationFailed, NULL ) \
+	X( VRInitError_Compositor_DXGIFactoryInterfaceIsNull, NULL ) \
+	X( VRInitError_Compositor_DXGIFactoryCreateFailed, NULL ) \
+	X( VRInitError_Compositor_DXGIFactoryQueryFailed, NULL ) \
+	X( VRInitError_Compositor_InvalidAdapterDesktop, NULL ) \
+	X( VRInitError_Compositor_InvalidHmdAttachment, NULL ) \
+	X( VRInitError_Compositor_InvalidOutputDesktop, NULL ) \
+	X( VRInitError_Compositor_InvalidDeviceProvided, NULL ) \
+	X( VRInitError_Compositor_D3D11RendererInitializationFailed, NULL ) \
+	X( VRInitError_Compositor_FailedToFindDisplayMode, NULL ) \
+	X( VRInitError_Compositor_FailedToCreateSwapChain, NULL ) \
+	X( VRInitError_Compositor_FailedToGetBackBuffer, NULL ) \
+	X( VRInitError_Compositor_FailedToCreateRenderTarget, NULL ) \
+	X( VRInitError_Compositor_FailedToCreateDXGI2SwapChain, NULL ) \
+	X( VRInitError_Compositor_FailedtoGetDXGI2BackBuffer, NULL ) \
+	X( VRInitError_Compositor_FailedToCreateDXGI2RenderTarget, NULL ) \
+	X( VRInitError_Compositor_FailedToGetDXGIDeviceInterface, NULL ) \
+	X( VRInitError_Compositor_SelectDisplayMode, NULL ) \
+	X( VRInitError_Compositor_FailedToCreateNvAPIRenderTargets, NULL ) \
+	X( VRInitError_Compositor_NvAPISetDisplayMode, NULL ) \
+	X( VRInitError_Compositor_FailedToCreateDirectModeDisplay, NULL ) \
+	X( VRInitError_Compositor_InvalidHmdPropertyContainer, NULL ) \
+	X( VRInitError_Compositor_UpdateDisplayFrequency, NULL ) \
+	X( VRInitError_Compositor_CreateRasterizerState, NULL ) \
+	X( VRInitError_Compositor_CreateWireframeRasterizerState, NULL ) \
+	X( VRInitError_Compositor_CreateSamplerState, NULL ) \
+	X( VRInitError_Compositor_CreateClampToBorderSamplerState, NULL ) \
+	X( VRInitError_Compositor_CreateAnisoSamplerState, NULL ) \
+	X( VRInitError_Compositor_CreateOverlaySamplerState, NULL ) \
+	X( VRInitError_Compositor_CreatePanoramaSamplerState, NULL ) \
+	X( VRInitError_Compositor_CreateFontSamplerState, NULL ) \
+	X( VRInitError_Compositor_CreateNoBlendState, NULL ) \
+	X( VRInitError_Compositor_CreateBlendState, NULL ) \
+	X( VRInitError_Compositor_CreateAlphaBlendState, NULL ) \
+	X( VRInitError_Compositor_CreateBlendStateMaskR, NULL ) \
+	X( VRInitError_Compositor_CreateBlendStateMaskG, NULL ) \
+	X( VRInitError_Compositor_CreateBlendStateMaskB, NULL ) \
+	X( VRInitError_Compositor_CreateDepthStencilState, NULL ) \
+	X( VRInitError_Compositor_CreateDepthStencilStateNoWrite, NULL ) \
+	X( VRInitError_Compositor_CreateDepthStencilStateNoDepth, NULL ) \
+	X( VRInitError_Compositor_CreateFlushTexture, NULL ) \
+	X( VRInitError_Compositor_CreateDistortionSurfaces, NULL ) \
+	X( VRInitError_Compositor_CreateConstantBuffer, NULL ) \
+	X( VRInitError_Compositor_CreateHmdPoseConstantBuffer, NULL ) \
+	X( VRInitError_Compositor_CreateHmdPoseStagingConstantBuffer, NULL ) \
+	X( VRInitError_Compositor_CreateSharedFrameInfoConstantBuffer, NULL ) \
+	X( VRInitError_Compositor_CreateOverlayConstantBuffer, NULL ) \
+	X( VRInitError_Compositor_CreateSceneTextureIndexConstantBuffer, NULL ) \
+	X( VRInitError_Compositor_CreateReadableSceneTextureIndexConstantBuffer, NULL ) \
+	X( VRInitError_Compositor_CreateLayerGraphicsTextureIndexConstantBuffer, NULL ) \
+	X( VRInitError_Compositor_CreateLayerComputeTextureIndexConstantBuffer, NULL ) \
+	X( VRInitError_Compositor_CreateLayerComputeSceneTextureIndexConstantBuffer, NULL ) \
+	X( VRInitError_Compositor_CreateComputeHmdPoseConstantBuffer, NULL ) \
+	X( VRInitError_Compositor_CreateGeomConstantBuffer, NULL ) \
+	X( VRInitError_Compositor_CreatePanelMaskConstantBuffer, NULL ) \
+	X( VRInitError_Compositor_CreatePixelSimUBO, NULL ) \
+	X( VRInitError_Compositor_CreateMSAARenderTextures, NULL ) \
+	X( VRInitError_Compositor_CreateResolveRenderTextures, NULL ) \
+	X( VRInitError_Compositor_CreateComputeResolveRenderTextures, NULL ) \
+	X( VRInitError_Compositor_CreateDriverDirectModeResolveTextures, NULL ) \
+	X( VRInitError_Compositor_OpenDriverDirectModeResolveTextures, NULL ) \
+	X( VRInitError_Compositor_CreateFallbackSyncTexture, NULL ) \
+	X( VRInitError_Compositor_ShareFallbackSyncTexture, NULL ) \
+	X( VRInitError_Compositor_CreateOverlayIndexBuffer, NULL ) \
+	X( VRInitError_Compositor_CreateOverlayVertexBuffer, NULL ) \
+	X( VRInitError_Compositor_CreateTextVertexBuffer, NULL ) \
+	X( VRInitError_Compositor_CreateTextIndexBuffer, NULL ) \
+	X( VRInitError_Compositor_CreateMirrorTextures, NULL ) \
+	X( VRInitError_Compositor_CreateLastFrameRenderTexture, NULL ) \
+	X( VRInitError_Compositor_CreateMirrorOverlay, NULL ) \
+	X( VRInitError_Compositor_FailedToCreateVirtualDisplayBackbuffer, NULL ) \
+	X( VRInitError_Compositor_DisplayModeNotSupported, NULL ) \
+	X( VRInitError_Compositor_CreateOverlayInvalidCall, NULL ) \
+	X( VRInitError_Compositor_CreateOverlayAlreadyInitialized, NULL ) \
+	X( VRInitError_Compositor_FailedToCreateMailbox, NULL ) \
+	\
+	/* Vendor specific */ \
+	X( VRInitError_VendorSpecific_UnableToConnectToOculusRuntime, "Unable to connect to Oculus Runtime (1000)" ) \
+	X( VRInitError_VendorSpecific_WindowsNotInDevMode, NULL ) \
+	X( VRInitError_VendorSpecific_HmdFound_CantOpenDevice, "HMD found, but can not open device (1101)" ) \
+	X( VRInitError_VendorSpecific_HmdFound_UnableToRequestConfigStart, "HMD found, but unable to request config (1102)" ) \
+	X( VRInitError_VendorSpecific_HmdFound_NoStoredConfig, "HMD found, but no stored config (1103)" ) \
+	X( VRInitError_VendorSpecific_HmdFound_ConfigTooBig, "HMD found, but config too big (1104)" ) \
+	X( VRInitError_VendorSpecific_HmdFound_ConfigTooSmall, "HMD found, but config too small (1105)" ) \
+	X( VRInitError_VendorSpecific_HmdFound_UnableToInitZLib, "HMD found, but unable to init ZLib (1106)" ) \
+	X( VRInitError_VendorSpecific_HmdFound_CantReadFirmwareVersion, "HMD found, but problems with the data (1107)" ) \
+	X( VRInitError_VendorSpecific_HmdFound_UnableToSendUserDataStart, "HMD found, but problems with the data (1108)" ) \
+	X( VRInitError_VendorSpecific_HmdFound_UnableToGetUserDataStart, "HMD found, but problems with the data (1109)" ) \
+	X( VRInitError_VendorSpecific_HmdFound_UnableToGetUserDataNext, "HMD found, but problems with the data (1110)" ) \
+	X( VRInitError_VendorSpecific_HmdFound_UserDataAddressRange, "HMD found, but problems with the data (1111)" ) \
+	X( VRInitError_VendorSpecific_HmdFound_UserDataError, "HMD found, but problems with the data (1112)" ) \
+	X( VRInitError_VendorSpecific_HmdFound_ConfigFailedSanityCheck, "HMD found, but failed configuration check (1113)" ) \
+	X( VRInitError_VendorSpecific_OculusRuntimeBadInstall, "Unable to connect to Oculus Runtime, possible bad install (1114)" ) \
+	\
+	/* Steam */ \
+	X( VRInitError_Steam_SteamInstallationNotFound, "Unable to find Steam installation (2000)" )
 
 
-const char *GetEnglishStringForHmdError( vr::EVRInitError eError )
+struct VRInitErrorEntry_t
+{
+	EVRInitError eError;
+	const char *pchID;
+	const char *pchEnglish;
+};
+
+#define VR_INIT_ERROR_ENTRY( enumValue, pchEnglish ) { enumValue, #enumValue, pchEnglish },
+
+static constexpr VRInitErrorEntry_t k_rgInitErrors[] =
+{
+	VR_INIT_ERROR_LIST( VR_INIT_ERROR_ENTRY )
+};
+
+static constexpr uint32_t k_unInitErrorCount = sizeof( k_rgInitErrors ) / sizeof( k_rgInitErrors[0] );
+
+static constexpr bool IsSortedByValue( uint32_t unIndex )
+{
+	return unIndex + 1 >= k_unInitErrorCount
+		|| ( k_rgInitErrors[ unIndex ].eError < k_rgInitErrors[ unIndex + 1 ].eError && IsSortedByValue( unIndex + 1 ) );
+}
+
+static_assert( IsSortedByValue( 0 ), "VR_INIT_ERROR_LIST must be in order of value with no value listed twice" );
+static_assert( k_rgInitErrors[ k_unInitErrorCount - 1 ].eError + 1 == VRInitError_LastError,
+	"VR_INIT_ERROR_LIST must end with the last EVRInitError" );
+
+// Errors are bucketed by hundreds, which is how EVRInitError groups them
+static constexpr int k_nInitErrorBucketSize = 100;
+static constexpr uint32_t k_unInitErrorBucketCount = 21;
+
+static_assert( k_rgInitErrors[0].eError >= 0
+	&& k_rgInitErrors[ k_unInitErrorCount - 1 ].eError < k_nInitErrorBucketSize * (int)k_unInitErrorBucketCount,
+	"EVRInitError values outside the bucket range; raise k_unInitErrorBucketCount" );
+
+static constexpr uint32_t InitErrorLowerBound( int nValue, uint32_t unFirst, uint32_t unEnd )
+{
+	return unFirst >= unEnd ? unFirst
+		: k_rgInitErrors[ ( unFirst + unEnd ) / 2 ].eError < nValue
+			? InitErrorLowerBound( nValue, ( unFirst + unEnd ) / 2 + 1, unEnd )
+			: InitErrorLowerBound( nValue, unFirst, ( unFirst + unEnd ) / 2 );
+}
+
+#define VR_INIT_ERROR_BUCKET_START( nBucket ) (uint16_t)InitErrorLowerBound( ( nBucket ) * k_nInitErrorBucketSize, 0, k_unInitErrorCount )
+
+// index of the first error in each bucket, plus the end of the last one
+static constexpr uint16_t k_rgunInitErrorBucketStart[ k_unInitErrorBucketCount + 1 ] =
+{
+	VR_INIT_ERROR_BUCKET_START( 0 ), VR_INIT_ERROR_BUCKET_START( 1 ), VR_INIT_ERROR_BUCKET_START( 2 ),
+	VR_INIT_ERROR_BUCKET_START( 3 ), VR_INIT_ERROR_BUCKET_START( 4 ), VR_INIT_ERROR_BUCKET_START( 5 ),
+	VR_INIT_ERROR_BUCKET_START( 6 ), VR_INIT_ERROR_BUCKET_START( 7 ), VR_INIT_ERROR_BUCKET_START( 8 ),
+	VR_INIT_ERROR_BUCKET_START( 9 ), VR_INIT_ERROR_BUCKET_START( 10 ), VR_INIT_ERROR_BUCKET_START( 11 ),
+	VR_INIT_ERROR_BUCKET_START( 12 ), VR_INIT_ERROR_BUCKET_START( 13 ), VR_INIT_ERROR_BUCKET_START( 14 ),
+	VR_INIT_ERROR_BUCKET_START( 15 ), VR_INIT_ERROR_BUCKET_START( 16 ), VR_INIT_ERROR_BUCKET_START( 17 ),
+	VR_INIT_ERROR_BUCKET_START( 18 ), VR_INIT_ERROR_BUCKET_START( 19 ), VR_INIT_ERROR_BUCKET_START( 20 ),
+	VR_INIT_ERROR_BUCKET_START( 21 ),
+};
+
+// VRInitError_Driver_HmdDisplayNotFoundAfterFix was retired without its value being reused
+static constexpr int k_nRetiredInitError = 210;
+
+static constexpr uint32_t InitErrorBucketGaps( uint32_t unFirst, uint32_t unEnd )
+{
+	return unFirst == unEnd ? 0
+		: (uint32_t)( k_rgInitErrors[ unEnd - 1 ].eError - k_rgInitErrors[ unFirst ].eError + 1 ) - ( unEnd - unFirst );
+}
+
+// A bucket whose values have gaps is searched rather than indexed, and a gap other than the
+// retired value most likely means an error is missing from VR_INIT_ERROR_LIST
+static constexpr bool AreBucketsContiguous( uint32_t unBucket )
+{
+	return unBucket >= k_unInitErrorBucketCount
+		|| ( InitErrorBucketGaps( k_rgunInitErrorBucketStart[ unBucket ], k_rgunInitErrorBucketStart[ unBucket + 1 ] )
+				== ( unBucket == k_nRetiredInitError / k_nInitErrorBucketSize ? 1u : 0u )
+			&& AreBucketsContiguous( unBucket + 1 ) );
+}
+
+static_assert( AreBucketsContiguous( 0 ), "EVRInitError values missing from VR_INIT_ERROR_LIST" );
+static_assert( k_rgInitErrors[ InitErrorLowerBound( k_nRetiredInitError, 0, k_unInitErrorCount ) ].eError != k_nRetiredInitError,
+	"The retired EVRInitError value is in use again; drop k_nRetiredInitError" );
+
+
+static const VRInitErrorEntry_t *FindInitError( EVRInitError eError )
+{
+	int nValue = (int)eError;
+	if ( nValue < 0 || nValue >= k_nInitErrorBucketSize * (int)k_unInitErrorBucketCount )
+		return nullptr;
+
+	uint32_t unBucket = (uint32_t)( nValue / k_nInitErrorBucketSize );
+	uint32_t unFirst = k_rgunInitErrorBucketStart[ unBucket ];
+	uint32_t unEnd = k_rgunInitErrorBucketStart[ unBucket + 1 ];
+	if ( unFirst == unEnd || nValue < k_rgInitErrors[ unFirst ].eError )
+		return nullptr;
+
+	// Most buckets have no gaps, so the distance from the first error in the bucket is the index
+	uint32_t unIndex = unFirst + (uint32_t)( nValue - k_rgInitErrors[ unFirst ].eError );
+	if ( unIndex < unEnd && k_rgInitErrors[ unIndex ].eError == eError )
+		return &k_rgInitErrors[ unIndex ];
+
+	// and the ones that do are searched
+	const VRInitErrorEntry_t *pEnd = k_rgInitErrors + unEnd;
+	const VRInitErrorEntry_t *pEntry = std::lower_bound( k_rgInitErrors + unFirst, pEnd, eError,
+		[]( const VRInitErrorEntry_t & entry, EVRInitError eValue ) { return entry.eError < eValue; } );
+	if ( pEntry != pEnd && pEntry->eError == eError )
+		return pEntry;
+	return nullptr;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: A perfect hash from error IDs to the table above, built the first
+//			time an ID is looked up. IDs are bucketed by one hash and each bucket
+//			gets the seed for a second hash that puts all of its IDs in free
+//			slots, so a lookup hashes twice and compares one string.
+//-----------------------------------------------------------------------------
+class CVRInitErrorIDHash
+{
+public:
+	CVRInitErrorIDHash();
+
+	const VRInitErrorEntry_t *Find( const char *pchID ) const;
+
+private:
+	static uint32_t Hash( const char *pchID, uint32_t unSeed );
+
+	static const uint32_t k_unSlotCount = 256;		// power of two above the number of errors
+	static const uint32_t k_unBucketCount = 64;
+	static const uint16_t k_unEmptySlot = 0xFFFF;
+
+	uint16_t m_rgunSeed[ k_unBucketCount ];
+	uint16_t m_rgunSlot[ k_unSlotCount ];
+	bool m_bPerfect;								// false if no seed worked for some bucket; Find then scans
+};
+
+static_assert( k_unInitErrorCount < 256, "CVRInitErrorIDHash needs more slots" );
+
+
+uint32_t CVRInitErrorIDHash::Hash( const char *pchID, uint32_t unSeed )
 {
-	switch( eError )
+	// FNV-1a
+	uint32_t unHash = 2166136261u ^ ( unSeed * 0x9E3779B9u );
+	for ( const char *pch = pchID; *pch; pch++ )
 	{
-	case VRInitError_None:								return "No Error (0)";
-
-	case VRInitError_Init_InstallationNotFound:			return "Installation Not Found (100)";
-	case VRInitError_Init_InstallationCorrupt:			return "Installation Corrupt (101)";
-	case VRInitError_Init_VRClientDLLNotFound:			return "vrclient Shared Lib Not Found (102)";
-	case VRInitError_Init_FileNotFound:					return "File Not Found (103)";
-	case VRInitError_Init_FactoryNotFound:				return "Factory Function Not Found (104)";
-	case VRInitError_Init_InterfaceNotFound:			return "Interface Not Found (105)";
-	case VRInitError_Init_InvalidInterface:				return "Invalid Interface (106)";
-	case VRInitError_Init_UserConfigDirectoryInvalid:	return "User Config Directory Invalid (107)";
-	case VRInitError_Init_HmdNotFound:					return "Hmd Not Found (108)";
-	case VRInitError_Init_NotInitialized:				return "Not Initialized (109)";
-	case VRInitError_Init_PathRegistryNotFound:			return "Installation path could not be located (110)";
-	case VRInitError_Init_NoConfigPath:					return "Config path could not be located (111)";
-	case VRInitError_Init_NoLogPath:					return "Log path could not be located (112)";
-	case VRInitError_Init_PathRegistryNotWritable:		return "Unable to write path registry (113)";
-	case VRInitError_Init_AppInfoInitFailed:			return "App info manager init failed (114)";
-	case VRInitError_Init_Retry:						return "Internal Retry (115)";
-	case VRInitError_Init_InitCanceledByUser:			return "User Canceled Init (116)";
-	case VRInitError_Init_AnotherAppLaunching:			return "Another app was already launching (117)";
-	case VRInitError_Init_SettingsInitFailed:			return "Settings manager init failed (118)";
-	case VRInitError_Init_ShuttingDown:					return "VR system shutting down (119)";
-	case VRInitError_Init_TooManyObjects:				return "Too many tracked objects (120)";
-	case VRInitError_Init_NoServerForBackgroundApp:		return "Not starting vrserver for background app (121)";
-	case VRInitError_Init_NotSupportedWithCompositor:	return "The requested interface is incompatible with the compositor and the compositor is running (122)";
-	case VRInitError_Init_NotAvailableToUtilityApps:	return "This interface is not available to utility applications (123)";
-	case VRInitError_Init_Internal:						return "vrserver internal error (124)";
-	case VRInitError_Init_HmdDriverIdIsNone:			return "Hmd DriverId is invalid (125)";
-	case VRInitError_Init_HmdNotFoundPresenceFailed:	return "Hmd Not Found Presence Failed (126)";
-	case VRInitError_Init_VRMonitorNotFound:			return "VR Monitor Not Found (127)";
-	case VRInitError_Init_VRMonitorStartupFailed:		return "VR Monitor startup failed (128)";
-	case VRInitError_Init_LowPowerWatchdogNotSupported: return "Low Power Watchdog Not Supported (129)";
-	case VRInitError_Init_InvalidApplicationType:		return "Invalid Application Type (130)";
-	case VRInitError_Init_NotAvailableToWatchdogApps:	return "Not available to watchdog apps (131)";
-	case VRInitError_Init_WatchdogDisabledInSettings:	return "Watchdog disabled in settings (132)";
-	case VRInitError_Init_VRDashboardNotFound:			return "VR Dashboard Not Found (133)";
-	case VRInitError_Init_VRDashboardStartupFailed:		return "VR Dashboard startup failed (134)";
-	case VRInitError_Init_VRHomeNotFound:				return "VR Home Not Found (135)";
-	case VRInitError_Init_VRHomeStartupFailed:			return "VR home startup failed (136)";
-	case VRInitError_Init_RebootingBusy:				return "Rebooting In Progress (137)";
-	case VRInitError_Init_FirmwareUpdateBusy:			return "Firmware Update In Progress (138)";
-	case VRInitError_Init_FirmwareRecoveryBusy:			return "Firmware Recovery In Progress (139)";
-	case VRInitError_Init_USBServiceBusy:				return "USB Service Busy (140)";
-
-	case VRInitError_Driver_Failed:							return "Driver Failed (200)";
-	case VRInitError_Driver_Unknown:						return "Driver Not Known (201)";
-	case VRInitError_Driver_HmdUnknown:						return "HMD Not Known (202)";
-	case VRInitError_Driver_NotLoaded:						return "Driver Not Loaded (203)";
-	case VRInitError_Driver_RuntimeOutOfDate:				return "Driver runtime is out of date (204)";
-	case VRInitError_Driver_HmdInUse:						return "HMD already in use by another application (205)";
-	case VRInitError_Driver_NotCalibrated:					return "Device is not calibrated (206)";
-	case VRInitError_Driver_CalibrationInvalid:				return "Device Calibration is invalid (207)";
-	case VRInitError_Driver_HmdDisplayNotFound:				return "HMD detected over USB, but Monitor not found (208)";
-	case VRInitError_Driver_TrackedDeviceInterfaceUnknown:	return "Driver Tracked Device Interface unknown (209)";
-	// case VRInitError_Driver_HmdDisplayNotFoundAfterFix:	return "HMD detected over USB, but Monitor not found after attempt to fix (210)"; // taken out upon Ben's request: He thinks that there is no need to separate that error from 208
-	case VRInitError_Driver_HmdDriverIdOutOfBounds:			return "Hmd DriverId is our of bounds (211)";
-	case VRInitError_Driver_HmdDisplayMirrored:				return "HMD detected over USB, but Monitor may be mirrored instead of extended (212)";
-	case VRInitError_Driver_HmdDisplayNotFoundLaptop:		return "On laptop, HMD detected over USB, but Monitor not found (213)";
-
-	case VRInitError_IPC_ServerInitFailed:						return "VR Server Init Failed (300)";
-	case VRInitError_IPC_ConnectFailed:							return "Connect to VR Server Failed (301)";
-	case VRInitError_IPC_SharedStateInitFailed:					return "Shared IPC State Init Failed (302)";
-	case VRInitError_IPC_CompositorInitFailed:					return "Shared IPC Compositor Init Failed (303)";
-	case VRInitError_IPC_MutexInitFailed:						return "Shared IPC Mutex Init Failed (304)";
-	case VRInitError_IPC_Failed:								return "Shared IPC Failed (305)";
-	case VRInitError_IPC_CompositorConnectFailed:				return "Shared IPC Compositor Connect Failed (306)";
-	case VRInitError_IPC_CompositorInvalidConnectResponse:		return "Shared IPC Compositor Invalid Connect Response (307)";
-	case VRInitError_IPC_ConnectFailedAfterMultipleAttempts:	return "Shared IPC Connect Failed After Multiple Attempts (308)";
-	case VRInitError_IPC_ConnectFailedAfterTargetExited:		return "Shared IPC Connect Failed After Target Exited (309)";
-	case VRInitError_IPC_NamespaceUnavailable:					return "Shared IPC Namespace Unavailable (310)";
-
-	case VRInitError_Compositor_Failed:					return "Compositor failed to initialize (400)";
-	case VRInitError_Compositor_D3D11HardwareRequired:	return "Compositor failed to find DX11 hardware (401)";
-	case VRInitError_Compositor_FirmwareRequiresUpdate:	return "Compositor requires mandatory firmware update (402)";
-	case VRInitError_Compositor_OverlayInitFailed:		return "Compositor initialization succeeded, but overlay init failed (403)";
-	case VRInitError_Compositor_ScreenshotsInitFailed:	return "Compositor initialization succeeded, but screenshot init failed (404)";
-	case VRInitError_Compositor_UnableToCreateDevice:	return "Compositor unable to create graphics device (405)";
-
-	// Oculus
-	case VRInitError_VendorSpecific_UnableToConnectToOculusRuntime:	return "Unable to connect to Oculus Runtime (1000)";
-	case VRInitError_VendorSpecific_OculusRuntimeBadInstall:		return "Unable to connect to Oculus Runtime, possible bad install (1114)";
-
-	// Lighthouse
-	case VRInitError_VendorSpecific_HmdFound_CantOpenDevice:				return "HMD found, but can not open device (1101)";
-	case VRInitError_VendorSpecific_HmdFound_UnableToRequestConfigStart:	return "HMD found, but unable to request config (1102)";
-	case VRInitError_VendorSpecific_HmdFound_NoStoredConfig:				return "HMD found, but no stored config (1103)";
-	case VRInitError_VendorSpecific_HmdFound_ConfigFailedSanityCheck:       return "HMD found, but failed configuration check (1113)";
-	case VRInitError_VendorSpecific_HmdFound_ConfigTooBig:					return "HMD found, but config too big (1104)";
-	case VRInitError_VendorSpecific_HmdFound_ConfigTooSmall:				return "HMD found, but config too small (1105)";
-	case VRInitError_VendorSpecific_HmdFound_UnableToInitZLib:				return "HMD found, but unable to init ZLib (1106)";
-	case VRInitError_VendorSpecific_HmdFound_CantReadFirmwareVersion:		return "HMD found, but problems with the data (1107)";
-	case VRInitError_VendorSpecific_HmdFound_UnableToSendUserDataStart:		return "HMD found, but problems with the data (1108)";
-	case VRInitError_VendorSpecific_HmdFound_UnableToGetUserDataStart:		return "HMD found, but problems with the data (1109)";
-	case VRInitError_VendorSpecific_HmdFound_UnableToGetUserDataNext:		return "HMD found, but problems with the data (1110)";
-	case VRInitError_VendorSpecific_HmdFound_UserDataAddressRange:			return "HMD found, but problems with the data (1111)";
-	case VRInitError_VendorSpecific_HmdFound_UserDataError:					return "HMD found, but problems with the data (1112)";
-
-	case VRInitError_Steam_SteamInstallationNotFound: return "Unable to find Steam installation (2000)";
-
-	default:
-		return GetIDForVRInitError( eError );
+		unHash ^= (uint8_t)*pch;
+		unHash *= 16777619u;
 	}
+	return unHash ^ ( unHash >> 15 );
+}
+
+
+CVRInitErrorIDHash::CVRInitErrorIDHash()
+	: m_bPerfect( true )
+{
+	std::vector< uint32_t > vecBuckets[ k_unBucketCount ];
+	for ( uint32_t i = 0; i < k_unInitErrorCount; i++ )
+		vecBuckets[ Hash( k_rgInitErrors[ i ].pchID, 0 ) & ( k_unBucketCount - 1 ) ].push_back( i );
+
+	// place the biggest buckets first, while there are the most free slots
+	uint32_t rgunOrder[ k_unBucketCount ];
+	for ( uint32_t i = 0; i < k_unBucketCount; i++ )
+		rgunOrder[ i ] = i;
+	std::stable_sort( rgunOrder, rgunOrder + k_unBucketCount,
+		[&vecBuckets]( uint32_t a, uint32_t b ) { return vecBuckets[ a ].size() > vecBuckets[ b ].size(); } );
+
+	std::fill( m_rgunSeed, m_rgunSeed + k_unBucketCount, (uint16_t)0 );
+	std::fill( m_rgunSlot, m_rgunSlot + k_unSlotCount, (uint16_t)k_unEmptySlot );
 
+	for ( uint32_t unBucket : rgunOrder )
+	{
+		const std::vector< uint32_t > & vecBucket = vecBuckets[ unBucket ];
+		if ( vecBucket.empty() )
+			break;
+
+		bool bPlaced = false;
+		for ( uint32_t unSeed = 1; unSeed < 0xFFFF && !bPlaced; unSeed++ )
+		{
+			uint32_t rgunSlots[ k_unInitErrorCount ];
+			bPlaced = true;
+			for ( size_t i = 0; i < vecBucket.size() && bPlaced; i++ )
+			{
+				rgunSlots[ i ] = Hash( k_rgInitErrors[ vecBucket[ i ] ].pchID, unSeed ) & ( k_unSlotCount - 1 );
+				bPlaced = m_rgunSlot[ rgunSlots[ i ] ] == k_unEmptySlot
+					&& std::find( rgunSlots, rgunSlots + i, rgunSlots[ i ] ) == rgunSlots + i;
+			}
+
+			if ( bPlaced )
+			{
+				m_rgunSeed[ unBucket ] = (uint16_t)unSeed;
+				for ( size_t i = 0; i < vecBucket.size(); i++ )
+					m_rgunSlot[ rgunSlots[ i ] ] = (uint16_t)vecBucket[ i ];
+			}
+		}
+
+		if ( !bPlaced )
+		{
+			m_bPerfect = false;
+			return;
+		}
+	}
 }
 
 
-const char *GetIDForVRInitError( vr::EVRInitError eError )
+const VRInitErrorEntry_t *CVRInitErrorIDHash::Find( const char *pchID ) const
 {
-	switch( eError )
+	if ( !m_bPerfect )
 	{
-		RETURN_ENUM_AS_STRING( VRInitError_None );
-		RETURN_ENUM_AS_STRING( VRInitError_Unknown );
-
-		RETURN_ENUM_AS_STRING( VRInitError_Init_InstallationNotFound );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_InstallationCorrupt );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_VRClientDLLNotFound );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_FileNotFound );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_FactoryNotFound );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_InterfaceNotFound );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_InvalidInterface );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_UserConfigDirectoryInvalid );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_HmdNotFound );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_NotInitialized );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_PathRegistryNotFound );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_NoConfigPath );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_NoLogPath );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_PathRegistryNotWritable );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_AppInfoInitFailed );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_Retry );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_InitCanceledByUser );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_AnotherAppLaunching );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_SettingsInitFailed );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_ShuttingDown );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_TooManyObjects );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_NoServerForBackgroundApp );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_NotSupportedWithCompositor );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_NotAvailableToUtilityApps );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_Internal );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_HmdDriverIdIsNone );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_HmdNotFoundPresenceFailed );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_VRMonitorNotFound );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_VRMonitorStartupFailed );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_LowPowerWatchdogNotSupported );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_InvalidApplicationType );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_NotAvailableToWatchdogApps );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_WatchdogDisabledInSettings );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_VRDashboardNotFound );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_VRDashboardStartupFailed );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_VRHomeNotFound );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_VRHomeStartupFailed );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_RebootingBusy );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_FirmwareUpdateBusy );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_FirmwareRecoveryBusy );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_USBServiceBusy );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_VRWebHelperStartupFailed );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_TrackerManagerInitFailed );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_AlreadyRunning );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_FailedForVrMonitor);
-		RETURN_ENUM_AS_STRING( VRInitError_Init_PropertyManagerInitFailed );
-		RETURN_ENUM_AS_STRING( VRInitError_Init_WebServerFailed );
-		
-		RETURN_ENUM_AS_STRING( VRInitError_Driver_Failed );
-		RETURN_ENUM_AS_STRING( VRInitError_Driver_Unknown );
-		RETURN_ENUM_AS_STRING( VRInitError_Driver_HmdUnknown);
-		RETURN_ENUM_AS_STRING( VRInitError_Driver_NotLoaded);
-		RETURN_ENUM_AS_STRING( VRInitError_Driver_RuntimeOutOfDate);
-		RETURN_ENUM_AS_STRING( VRInitError_Driver_HmdInUse);
-		RETURN_ENUM_AS_STRING( VRInitError_Driver_NotCalibrated);
-		RETURN_ENUM_AS_STRING( VRInitError_Driver_CalibrationInvalid);
-		RETURN_ENUM_AS_STRING( VRInitError_Driver_HmdDisplayNotFound);
-		RETURN_ENUM_AS_STRING( VRInitError_Driver_TrackedDeviceInterfaceUnknown );
-		// RETURN_ENUM_AS_STRING( VRInitError_Driver_HmdDisplayNotFoundAfterFix );
-		RETURN_ENUM_AS_STRING( VRInitError_Driver_HmdDriverIdOutOfBounds );
-		RETURN_ENUM_AS_STRING( VRInitError_Driver_HmdDisplayMirrored );
-		RETURN_ENUM_AS_STRING( VRInitError_Driver_HmdDisplayNotFoundLaptop );
-
-		RETURN_ENUM_AS_STRING( VRInitError_IPC_ServerInitFailed);
-		RETURN_ENUM_AS_STRING( VRInitError_IPC_ConnectFailed);
-		RETURN_ENUM_AS_STRING( VRInitError_IPC_SharedStateInitFailed);
-		RETURN_ENUM_AS_STRING( VRInitError_IPC_CompositorInitFailed);
-		RETURN_ENUM_AS_STRING( VRInitError_IPC_MutexInitFailed);
-		RETURN_ENUM_AS_STRING( VRInitError_IPC_Failed);
-		RETURN_ENUM_AS_STRING( VRInitError_IPC_CompositorConnectFailed);
-		RETURN_ENUM_AS_STRING( VRInitError_IPC_CompositorInvalidConnectResponse);
-		RETURN_ENUM_AS_STRING( VRInitError_IPC_ConnectFailedAfterMultipleAttempts );
-		RETURN_ENUM_AS_STRING( VRInitError_IPC_ConnectFailedAfterTargetExited );
-		RETURN_ENUM_AS_STRING( VRInitError_IPC_NamespaceUnavailable );
-
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_Failed );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_D3D11HardwareRequired );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_FirmwareRequiresUpdate );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_OverlayInitFailed );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_ScreenshotsInitFailed );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_UnableToCreateDevice );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_SharedStateIsNull );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_NotificationManagerIsNull );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_ResourceManagerClientIsNull );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_MessageOverlaySharedStateInitFailure );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_PropertiesInterfaceIsNull );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateFullscreenWindowFailed );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_SettingsInterfaceIsNull );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_FailedToShowWindow );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_DistortInterfaceIsNull );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_DisplayFrequencyFailure );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_RendererInitializationFailed );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_DXGIFactoryInterfaceIsNull );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_DXGIFactoryCreateFailed );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_DXGIFactoryQueryFailed );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_InvalidAdapterDesktop );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_InvalidHmdAttachment );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_InvalidOutputDesktop );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_InvalidDeviceProvided );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_D3D11RendererInitializationFailed );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_FailedToFindDisplayMode );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_FailedToCreateSwapChain );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_FailedToGetBackBuffer );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_FailedToCreateRenderTarget );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_FailedToCreateDXGI2SwapChain );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_FailedtoGetDXGI2BackBuffer );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_FailedToCreateDXGI2RenderTarget );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_FailedToGetDXGIDeviceInterface );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_SelectDisplayMode );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_FailedToCreateNvAPIRenderTargets );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_NvAPISetDisplayMode );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_FailedToCreateDirectModeDisplay );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_InvalidHmdPropertyContainer );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_UpdateDisplayFrequency );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateRasterizerState );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateWireframeRasterizerState );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateSamplerState );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateClampToBorderSamplerState );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateAnisoSamplerState );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateOverlaySamplerState );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreatePanoramaSamplerState );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateFontSamplerState );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateNoBlendState );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateBlendState );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateAlphaBlendState );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateBlendStateMaskR );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateBlendStateMaskG );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateBlendStateMaskB );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateDepthStencilState );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateDepthStencilStateNoWrite );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateDepthStencilStateNoDepth );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateFlushTexture );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateDistortionSurfaces );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateConstantBuffer );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateHmdPoseConstantBuffer );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateHmdPoseStagingConstantBuffer );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateSharedFrameInfoConstantBuffer );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateOverlayConstantBuffer );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateSceneTextureIndexConstantBuffer );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateReadableSceneTextureIndexConstantBuffer );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateLayerGraphicsTextureIndexConstantBuffer );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateLayerComputeTextureIndexConstantBuffer );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateLayerComputeSceneTextureIndexConstantBuffer );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateComputeHmdPoseConstantBuffer );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateGeomConstantBuffer );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreatePanelMaskConstantBuffer );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreatePixelSimUBO );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateMSAARenderTextures );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateResolveRenderTextures );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateComputeResolveRenderTextures );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateDriverDirectModeResolveTextures );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_OpenDriverDirectModeResolveTextures );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateFallbackSyncTexture );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_ShareFallbackSyncTexture );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateOverlayIndexBuffer );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateOverlayVertexBuffer );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateTextVertexBuffer );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateTextIndexBuffer );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateMirrorTextures );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateLastFrameRenderTexture );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateMirrorOverlay );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_FailedToCreateVirtualDisplayBackbuffer );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_DisplayModeNotSupported );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateOverlayInvalidCall );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_CreateOverlayAlreadyInitialized );
-		RETURN_ENUM_AS_STRING( VRInitError_Compositor_FailedToCreateMailbox );
-
-		// Vendor-specific errors
-		RETURN_ENUM_AS_STRING( VRInitError_VendorSpecific_UnableToConnectToOculusRuntime);
-		RETURN_ENUM_AS_STRING( VRInitError_VendorSpecific_WindowsNotInDevMode );
-		RETURN_ENUM_AS_STRING( VRInitError_VendorSpecific_OculusRuntimeBadInstall );
-
-		// Lighthouse
-		RETURN_ENUM_AS_STRING( VRInitError_VendorSpecific_HmdFound_CantOpenDevice);
-		RETURN_ENUM_AS_STRING( VRInitError_VendorSpecific_HmdFound_UnableToRequestConfigStart);
-		RETURN_ENUM_AS_STRING( VRInitError_VendorSpecific_HmdFound_NoStoredConfig);
-		RETURN_ENUM_AS_STRING( VRInitError_VendorSpecific_HmdFound_ConfigFailedSanityCheck );
-		RETURN_ENUM_AS_STRING( VRInitError_VendorSpecific_HmdFound_ConfigTooBig );
-		RETURN_ENUM_AS_STRING( VRInitError_VendorSpecific_HmdFound_ConfigTooSmall );
-		RETURN_ENUM_AS_STRING( VRInitError_VendorSpecific_HmdFound_UnableToInitZLib );
-		RETURN_ENUM_AS_STRING( VRInitError_VendorSpecific_HmdFound_CantReadFirmwareVersion );
-		RETURN_ENUM_AS_STRING( VRInitError_VendorSpecific_HmdFound_UnableToSendUserDataStart );
-		RETURN_ENUM_AS_STRING( VRInitError_VendorSpecific_HmdFound_UnableToGetUserDataStart );
-		RETURN_ENUM_AS_STRING( VRInitError_VendorSpecific_HmdFound_UnableToGetUserDataNext );
-		RETURN_ENUM_AS_STRING( VRInitError_VendorSpecific_HmdFound_UserDataAddressRange );
-		RETURN_ENUM_AS_STRING( VRInitError_VendorSpecific_HmdFound_UserDataError );
-
-		RETURN_ENUM_AS_STRING( VRInitError_Steam_SteamInstallationNotFound );
-
-	default:
+		for ( const VRInitErrorEntry_t & entry : k_rgInitErrors )
 		{
-			static char buf[128];
-			sprintf( buf, "Unknown error (%d)", eError );
-			return buf;
+			if ( strcmp( entry.pchID, pchID ) == 0 )
+				return &entry;
 		}
+		return nullptr;
 	}
+
+	uint16_t unSeed = m_rgunSeed[ Hash( pchID, 0 ) & ( k_unBucketCount - 1 ) ];
+	if ( unSeed == 0 )
+		return nullptr;
+
+	uint16_t unIndex = m_rgunSlot[ Hash( pchID, unSeed ) & ( k_unSlotCount - 1 ) ];
+	if ( unIndex == k_unEmptySlot || strcmp( k_rgInitErrors[ unIndex ].pchID, pchID ) != 0 )
+		return nullptr;
+	return &k_rgInitErrors[ unIndex ];
+}
+
+
+const char *GetEnglishStringForHmdError( vr::EVRInitError eError )
+{
+	const VRInitErrorEntry_t *pEntry = FindInitError( eError );
+	if ( pEntry && pEntry->pchEnglish )
+		return pEntry->pchEnglish;
+
+	return GetIDForVRInitError( eError );
 }
 
+
+const char *GetIDForVRInitError( vr::EVRInitError eError )
+{
+	const VRInitErrorEntry_t *pEntry = FindInitError( eError );
+	if ( pEntry )
+		return pEntry->pchID;
+
+	static char buf[128];
+	sprintf( buf, "Unknown error (%d)", eError );
+	return buf;
+}
+
+
+bool GetVRInitErrorFromID( const char *pchID, vr::EVRInitError *peError )
+{
+	if ( !pchID )
+		return false;
+
+	static const CVRInitErrorIDHash s_idHash;
+	const VRInitErrorEntry_t *pEntry = s_idHash.Find( pchID );
+	if ( !pEntry )
+		return false;
+
+	if ( peError )
+		*peError = pEntry->eError;
+	return true;
+}
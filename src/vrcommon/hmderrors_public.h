@@ -4,3 +4,6 @@
 const char *GetEnglishStringForHmdError( vr::EVRInitError eError );
 const char *GetIDForVRInitError( vr::EVRInitError eError );
 
+/** The reverse of GetIDForVRInitError: turns "VRInitError_Init_HmdNotFound" back into the enum.
+* Returns false if the string isn't the ID of any error. */
+bool GetVRInitErrorFromID( const char *pchID, vr::EVRInitError *peError );
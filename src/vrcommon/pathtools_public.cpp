@@ -17,6 +17,9 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include <alloca.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #endif
 
 #if defined OSX
@@ -27,9 +30,96 @@
 #endif
 
 #include <sys/stat.h>
+#include <string.h>
+#include <limits.h>
 
 #include <algorithm>
 
+//-----------------------------------------------------------------------------
+// Purpose: Small-buffer storage for the non-allocating path helpers
+//-----------------------------------------------------------------------------
+const size_t CPathBuffer::k_unInlineLength;
+
+CPathBuffer::CPathBuffer()
+	: m_pchData( m_rgchInline )
+	, m_unLength( 0 )
+	, m_unCapacity( k_unInlineLength )
+{
+	m_rgchInline[ 0 ] = '\0';
+}
+
+CPathBuffer::CPathBuffer( const CPathBuffer & src )
+	: CPathBuffer()
+{
+	Assign( src );
+}
+
+CPathBuffer &CPathBuffer::operator=( const CPathBuffer & src )
+{
+	if ( this != &src )
+	{
+		Assign( src );
+	}
+	return *this;
+}
+
+void CPathBuffer::Truncate( size_t unLength )
+{
+	if ( unLength < m_unLength )
+	{
+		m_unLength = unLength;
+		m_pchData[ m_unLength ] = '\0';
+	}
+}
+
+void CPathBuffer::Reserve( size_t unLength )
+{
+	if ( unLength <= m_unCapacity )
+		return;
+
+	size_t unCapacity = std::max( unLength, m_unCapacity * 2 );
+	std::vector<char> vecHeap( unCapacity + 1 );
+	memcpy( &vecHeap[ 0 ], m_pchData, m_unLength + 1 );
+	m_vecHeap.swap( vecHeap );
+	m_pchData = &m_vecHeap[ 0 ];
+	m_unCapacity = unCapacity;
+}
+
+void CPathBuffer::Append( char c )
+{
+	Reserve( m_unLength + 1 );
+	m_pchData[ m_unLength++ ] = c;
+	m_pchData[ m_unLength ] = '\0';
+}
+
+void CPathBuffer::Append( CStringView sText )
+{
+	// the text may be a piece of this buffer, which moves if it has to grow
+	size_t unSelfOffset = sText.data() >= m_pchData && sText.data() <= m_pchData + m_unLength ? sText.data() - m_pchData : CStringView::npos;
+	Reserve( m_unLength + sText.size() );
+	const char *pchText = unSelfOffset != CStringView::npos ? m_pchData + unSelfOffset : sText.data();
+
+	memmove( m_pchData + m_unLength, pchText, sText.size() );
+	m_unLength += sText.size();
+	m_pchData[ m_unLength ] = '\0';
+}
+
+void CPathBuffer::Assign( CStringView sText )
+{
+	if ( sText.data() >= m_pchData && sText.data() <= m_pchData + m_unLength )
+	{
+		// a piece of this buffer; moving it to the front never needs more room
+		memmove( m_pchData, sText.data(), sText.size() );
+		m_unLength = sText.size();
+		m_pchData[ m_unLength ] = '\0';
+		return;
+	}
+
+	Clear();
+	Append( sText );
+}
+
+
 /** Returns the path (including filename) to the current executable */
 std::string Path_GetExecutablePath()
 {
@@ -118,44 +208,54 @@ std::string Path_GetTemporaryDirectory()
 }
 
 /** Returns the specified path without its filename */
-std::string Path_StripFilename( const std::string & sPath, char slash )
+CStringView Path_StripFilenameView( CStringView sPath, char slash )
 {
 	if( slash == 0 )
 		slash = Path_GetSlash();
 
-	std::string::size_type n = sPath.find_last_of( slash );
-	if( n == std::string::npos )
+	size_t n = sPath.rfind( slash );
+	if( n == CStringView::npos )
 		return sPath;
 	else
-		return std::string( sPath.begin(), sPath.begin() + n );
+		return sPath.substr( 0, n );
+}
+
+std::string Path_StripFilename( const std::string & sPath, char slash )
+{
+	return Path_StripFilenameView( sPath, slash ).str();
 }
 
 /** returns just the filename from the provided full or relative path. */
-std::string Path_StripDirectory( const std::string & sPath, char slash )
+CStringView Path_StripDirectoryView( CStringView sPath, char slash )
 {
 	if( slash == 0 )
 		slash = Path_GetSlash();
 
-	std::string::size_type n = sPath.find_last_of( slash );
-	if( n == std::string::npos )
+	size_t n = sPath.rfind( slash );
+	if( n == CStringView::npos )
 		return sPath;
 	else
-		return std::string( sPath.begin() + n + 1, sPath.end() );
+		return sPath.substr( n + 1 );
+}
+
+std::string Path_StripDirectory( const std::string & sPath, char slash )
+{
+	return Path_StripDirectoryView( sPath, slash ).str();
 }
 
 /** returns just the filename with no extension of the provided filename. 
 * If there is a path the path is left intact. */
-std::string Path_StripExtension( const std::string & sPath )
+CStringView Path_StripExtensionView( CStringView sPath )
 {
-	for( std::string::const_reverse_iterator i = sPath.rbegin(); i != sPath.rend(); i++ )
+	for( size_t i = sPath.size(); i > 0; i-- )
 	{
-		if( *i == '.' )
+		if( sPath[ i - 1 ] == '.' )
 		{
-			return std::string( sPath.begin(), i.base() - 1 );
+			return sPath.substr( 0, i - 1 );
 		}
 
 		// if we find a slash there is no extension
-		if( *i == '\\' || *i == '/' )
+		if( sPath[ i - 1 ] == '\\' || sPath[ i - 1 ] == '/' )
 			break;
 	}
 
@@ -163,23 +263,33 @@ std::string Path_StripExtension( const std::string & sPath )
 	return sPath;
 }
 
+std::string Path_StripExtension( const std::string & sPath )
+{
+	return Path_StripExtensionView( sPath ).str();
+}
+
 /** returns just extension of the provided filename (if any). */
-std::string Path_GetExtension( const std::string & sPath )
+CStringView Path_GetExtensionView( CStringView sPath )
 {
-	for ( std::string::const_reverse_iterator i = sPath.rbegin(); i != sPath.rend(); i++ )
+	for ( size_t i = sPath.size(); i > 0; i-- )
 	{
-		if ( *i == '.' )
+		if ( sPath[ i - 1 ] == '.' )
 		{
-			return std::string( i.base(), sPath.end() );
+			return sPath.substr( i );
 		}
 
 		// if we find a slash there is no extension
-		if ( *i == '\\' || *i == '/' )
+		if ( sPath[ i - 1 ] == '\\' || sPath[ i - 1 ] == '/' )
 			break;
 	}
 
 	// we didn't find an extension
-	return "";
+	return CStringView();
+}
+
+std::string Path_GetExtension( const std::string & sPath )
+{
+	return Path_GetExtensionView( sPath ).str();
 }
 
 bool Path_IsAbsolute( const std::string & sPath )
@@ -217,9 +327,13 @@ std::string Path_MakeAbsolute( const std::string & sRelativePath, const std::str
 		if( !Path_IsAbsolute( sBasePath ) )
 			return "";
 
-		std::string sCompacted = Path_Compact( Path_Join( sBasePath, sRelativePath ) );
-		if( Path_IsAbsolute( sCompacted ) )
-			return sCompacted;
+		CPathBuffer joined;
+		Path_JoinTo( sBasePath, sRelativePath, &joined );
+
+		CPathBuffer compacted;
+		Path_CompactTo( joined, &compacted );
+		if( Path_IsAbsolute( compacted.str() ) )
+			return compacted.str();
 		else
 			return "";
 	}
@@ -227,21 +341,32 @@ std::string Path_MakeAbsolute( const std::string & sRelativePath, const std::str
 
 
 /** Fixes the directory separators for the current platform */
-std::string Path_FixSlashes( const std::string & sPath, char slash )
+static void FixSlashesInPlace( char *pchPath, size_t unLength, char slash )
 {
 	if( slash == 0 )
 		slash = Path_GetSlash();
 
-	std::string sFixed = sPath;
-	for( std::string::iterator i = sFixed.begin(); i != sFixed.end(); i++ )
+	for( size_t i = 0; i < unLength; i++ )
 	{
-		if( *i == '/' || *i == '\\' )
-			*i = slash;
+		if( pchPath[ i ] == '/' || pchPath[ i ] == '\\' )
+			pchPath[ i ] = slash;
 	}
+}
 
+std::string Path_FixSlashes( const std::string & sPath, char slash )
+{
+	std::string sFixed = sPath;
+	if( !sFixed.empty() )
+		FixSlashesInPlace( &sFixed[ 0 ], sFixed.size(), slash );
 	return sFixed;
 }
 
+void Path_FixSlashesTo( CStringView sPath, CPathBuffer *pOut, char slash )
+{
+	pOut->Assign( sPath );
+	FixSlashesInPlace( pOut->data(), pOut->size(), slash );
+}
+
 
 char Path_GetSlash()
 {
@@ -253,25 +378,33 @@ char Path_GetSlash()
 }
 
 /** Jams two paths together with the right kind of slash */
-std::string Path_Join( const std::string & first, const std::string & second, char slash )
+void Path_JoinTo( CStringView first, CStringView second, CPathBuffer *pOut, char slash )
 {
 	if( slash == 0 )
 		slash = Path_GetSlash();
 
+	if( first.empty() )
+	{
+		pOut->Assign( second );
+		return;
+	}
+
 	// only insert a slash if we don't already have one
-	std::string::size_type nLen = first.length();
-	if( !nLen )
-		return second;
-#if defined(_WIN32)
+	size_t nLen = first.size();
 	if( first.back() == '\\' || first.back() == '/' )
-	    nLen--;
-#else
-	char last_char = first[first.length()-1];
-	if (last_char == '\\' || last_char == '/')
-	    nLen--;
-#endif
+		nLen--;
 
-	return first.substr( 0, nLen ) + std::string( 1, slash ) + second;
+	pOut->Reserve( nLen + 1 + second.size() );
+	pOut->Assign( first.substr( 0, nLen ) );
+	pOut->Append( slash );
+	pOut->Append( second );
+}
+
+std::string Path_Join( const std::string & first, const std::string & second, char slash )
+{
+	CPathBuffer joined;
+	Path_JoinTo( first, second, &joined, slash );
+	return joined.str();
 }
 
 
@@ -332,99 +465,116 @@ std::string Path_RemoveTrailingSlash( const std::string & sRawPath, char slash )
 
 
 /** Removes redundant <dir>/.. elements in the path. Returns an empty path if the 
-* specified path has a broken number of directories for its number of ..s */
-std::string Path_Compact( const std::string & sRawPath, char slash )
+* specified path has a broken number of directories for its number of ..s
+*
+* This does what the old multi-pass version did, /./ and the leading ./ and
+* trailing /. rules included, but in two linear passes instead of restarting
+* the scan after every .. it collapsed. */
+bool Path_CompactTo( CStringView sRawPath, CPathBuffer *pOut, char slash )
 {
 	if( slash == 0 )
 		slash = Path_GetSlash();
 
-	std::string sPath = Path_FixSlashes( sRawPath, slash );
-	std::string sSlashString( 1, slash );
+	pOut->Assign( sRawPath );
+	char *pchPath = pOut->data();
+	const size_t unRawLength = pOut->size();
 
-	// strip out all /./
-	for( std::string::size_type i = 0; (i + 3) < sPath.length();  )
+	// fix the slashes and strip out all /./ that aren't at the very end
+	size_t unLength = 0;
+	for( size_t j = 0; j < unRawLength; j++ )
 	{
-		if( sPath[ i ] == slash && sPath[ i+1 ] == '.' && sPath[ i+2 ] == slash )
+		char c = pchPath[ j ];
+		if( c == '/' || c == '\\' )
 		{
-			sPath.replace( i, 3, sSlashString );
-		}
-		else
-		{
-			++i;
+			// "/./" becomes the second slash of the pair, which may start another
+			while( j + 3 < unRawLength && pchPath[ j + 1 ] == '.' && ( pchPath[ j + 2 ] == '/' || pchPath[ j + 2 ] == '\\' ) )
+			{
+				j += 2;
+			}
+			c = slash;
 		}
+		pchPath[ unLength++ ] = c;
 	}
 
-
 	// get rid of trailing /. but leave the path separator
-	if( sPath.length() > 2 )
+	if( unLength > 2 && pchPath[ unLength - 1 ] == '.' && pchPath[ unLength - 2 ] == slash )
 	{
-		std::string::size_type len = sPath.length();
-		if( sPath[ len-1 ] == '.'  && sPath[ len-2 ] == slash )
-		{
-			sPath.pop_back();
-			//Not sure why the following line of code was used for a while.  It causes problems with strlen.
-			//sPath[len-1] = 0;  // for now, at least 
-		}
+		unLength--;
 	}
 
 	// get rid of leading ./ 
-	if( sPath.length() > 2 )
+	size_t unRead = 0;
+	if( unLength > 2 && pchPath[ 0 ] == '.' && pchPath[ 1 ] == slash )
 	{
-		if( sPath[ 0 ] == '.'  && sPath[ 1 ] == slash )
-		{
-			sPath.replace( 0, 2, "" );
-		}
+		unRead = 2;
 	}
 
 	// each time we encounter .. back up until we've found the previous directory name
-	// then get rid of both
-	std::string::size_type i = 0;
-	while( i < sPath.length() )
-	{
-		if( i > 0 && sPath.length() - i >= 2 
-			&& sPath[i] == '.'
-			&& sPath[i+1] == '.'
-			&& ( i + 2 == sPath.length() || sPath[ i+2 ] == slash )
-			&& sPath[ i-1 ] == slash )
+	// then get rid of both. What was written so far never changes again, so the
+	// scan carries on from where it was rather than starting over.
+	size_t unWrite = 0;
+	while( unRead < unLength )
+	{
+		if( unWrite > 0 && unLength - unRead >= 2
+			&& pchPath[ unRead ] == '.'
+			&& pchPath[ unRead + 1 ] == '.'
+			&& ( unRead + 2 == unLength || pchPath[ unRead + 2 ] == slash )
+			&& pchPath[ unWrite - 1 ] == slash )
 		{
 			// check if we've hit the start of the string and have a bogus path
-			if( i == 1 )
-				return "";
-			
-			// find the separator before i-1
-			std::string::size_type iDirStart = i-2;
-			while( iDirStart > 0 && sPath[ iDirStart - 1 ] != slash )
-				--iDirStart;
-
-			// remove everything from iDirStart to i+2
-			sPath.replace( iDirStart, (i - iDirStart) + 3, "" );
-
-			// start over
-			i = 0;
+			if( unWrite == 1 )
+			{
+				pOut->Clear();
+				return false;
+			}
+
+			// find the separator before unWrite-1
+			size_t unDirStart = unWrite - 2;
+			while( unDirStart > 0 && pchPath[ unDirStart - 1 ] != slash )
+				--unDirStart;
+
+			// drop the directory, the .. and the slash after it
+			unWrite = unDirStart;
+			unRead += unRead + 2 < unLength ? 3 : 2;
 		}
 		else
 		{
-			++i;
+			pchPath[ unWrite++ ] = pchPath[ unRead++ ];
 		}
 	}
 
-	return sPath;
+	pOut->Truncate( unWrite );
+	return true;
+}
+
+std::string Path_Compact( const std::string & sRawPath, char slash )
+{
+	CPathBuffer compacted;
+	Path_CompactTo( sRawPath, &compacted, slash );
+	return compacted.str();
 }
 
 
 /** Returns true if these two paths are the same without respect for internal . or ..
 * sequences, slash type, or case (on case-insensitive platforms). */
-bool Path_IsSamePath( const std::string & sPath1, const std::string & sPath2 )
+bool Path_IsSamePathView( CStringView sPath1, CStringView sPath2 )
 {
-	std::string sCompact1 = Path_Compact( sPath1 );
-	std::string sCompact2 = Path_Compact( sPath2 );
+	CPathBuffer compact1;
+	CPathBuffer compact2;
+	Path_CompactTo( sPath1, &compact1 );
+	Path_CompactTo( sPath2, &compact2 );
 #if defined(WIN32)
-	return !stricmp( sCompact1.c_str(), sCompact2.c_str() );
+	return !stricmp( compact1.c_str(), compact2.c_str() );
 #else
-	return !strcmp( sCompact1.c_str(), sCompact2.c_str() );
+	return !strcmp( compact1.c_str(), compact2.c_str() );
 #endif
 }
 
+bool Path_IsSamePath( const std::string & sPath1, const std::string & sPath2 )
+{
+	return Path_IsSamePathView( sPath1, sPath2 );
+}
+
 
 /** Returns the path to the current DLL or exe */
 std::string Path_GetThisModulePath()
@@ -455,21 +605,40 @@ std::string Path_GetThisModulePath()
 }
 
 
+#if defined( _WIN32 )
+//-----------------------------------------------------------------------------
+// Purpose: _wstat for a UTF-8 path, converting on the stack when the path fits
+//-----------------------------------------------------------------------------
+static int StatUTF8Path( const CPathBuffer & path, struct _stat *pBuf )
+{
+	wchar_t rgwchPath[ CPathBuffer::k_unInlineLength + 1 ];
+	EUTFError eError;
+	UTF8to16( path.c_str(), path.size(), rgwchPath, sizeof( rgwchPath ) / sizeof( rgwchPath[ 0 ] ), &eError );
+	if ( eError == UTFError_None )
+		return _wstat( rgwchPath, pBuf );
+
+	std::wstring wsPath = UTF8to16( path.c_str() );
+	return _wstat( wsPath.c_str(), pBuf );
+}
+#endif
+
+
 /** returns true if the specified path exists and is a directory */
 bool Path_IsDirectory( const std::string & sPath )
 {
-	std::string sFixedPath = Path_FixSlashes( sPath );
-	if( sFixedPath.empty() )
+	CPathBuffer fixedPath;
+	Path_FixSlashesTo( sPath, &fixedPath );
+	if( fixedPath.empty() )
 		return false;
-	char cLast = sFixedPath[ sFixedPath.length() - 1 ];
+	char cLast = fixedPath[ fixedPath.size() - 1 ];
 	if( cLast == '/' || cLast == '\\' )
-		sFixedPath.erase( sFixedPath.end() - 1, sFixedPath.end() );
+		fixedPath.Truncate( fixedPath.size() - 1 );
 
 	// see if the specified path actually exists.
 
 #if defined(POSIX)
 	struct	stat	buf;
-	if ( stat( sFixedPath.c_str(), &buf ) == -1 )
+	if ( stat( fixedPath.c_str(), &buf ) == -1 )
 	{
 		return false;
 	}
@@ -482,8 +651,7 @@ bool Path_IsDirectory( const std::string & sPath )
 
 #else
 	struct	_stat	buf;
-	std::wstring wsFixedPath = UTF8to16( sFixedPath.c_str() );
-	if ( _wstat( wsFixedPath.c_str(), &buf ) == -1 )
+	if ( StatUTF8Path( fixedPath, &buf ) == -1 )
 	{
 		return false;
 	}
@@ -511,20 +679,20 @@ bool Path_IsAppBundle( const std::string & sPath )
 //-----------------------------------------------------------------------------
 bool Path_Exists( const std::string & sPath )
 {
-	std::string sFixedPath = Path_FixSlashes( sPath );
-	if( sFixedPath.empty() )
+	CPathBuffer fixedPath;
+	Path_FixSlashesTo( sPath, &fixedPath );
+	if( fixedPath.empty() )
 		return false;
 
 #if defined( WIN32 )
 	struct	_stat	buf;
-	std::wstring wsFixedPath = UTF8to16( sFixedPath.c_str() );
-	if ( _wstat( wsFixedPath.c_str(), &buf ) == -1 )
+	if ( StatUTF8Path( fixedPath, &buf ) == -1 )
 	{
 		return false;
 	}
 #else
 	struct stat buf;
-	if ( stat ( sFixedPath.c_str(), &buf ) == -1)
+	if ( stat ( fixedPath.c_str(), &buf ) == -1)
 	{
 		return false;
 	}
@@ -589,116 +757,460 @@ std::string Path_FindParentSubDirectoryRecursively( const std::string &strStartD
 
 
 //-----------------------------------------------------------------------------
-// Purpose: reading and writing files in the vortex directory
+// Purpose: Appends text to sOut with every CRLF turned into LF. memchr finds
+//			the CRs a vector at a time, and what's between them is copied in bulk.
 //-----------------------------------------------------------------------------
-std::vector<uint8_t> Path_ReadBinaryFile( const std::string & strFilename )
+static void AppendNormalizedText( const char *pchText, size_t unLength, std::string &sOut )
 {
-	FILE *f;
-#if defined( POSIX )
-	f = fopen( strFilename.c_str(), "rb" );
+	const char *pchEnd = pchText + unLength;
+	while ( pchText != pchEnd )
+	{
+		const char *pchCR = ( const char * )memchr( pchText, '\r', pchEnd - pchText );
+		if ( !pchCR )
+		{
+			sOut.append( pchText, pchEnd - pchText );
+			break;
+		}
+
+		// drop the CR of a CRLF; the LF goes out with the next run
+		bool bCRLF = pchCR + 1 != pchEnd && pchCR[ 1 ] == '\n';
+		const char *pchRunEnd = bCRLF ? pchCR : pchCR + 1;
+		sOut.append( pchText, pchRunEnd - pchText );
+		pchText = pchCR + 1;
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Read only views of whole files
+//-----------------------------------------------------------------------------
+CPathMappedFile::CPathMappedFile()
+	: m_bOpen( false )
+	, m_pData( nullptr )
+	, m_ulSize( 0 )
+	, m_pMapping( nullptr )
+	, m_bTextChecked( false )
+	, m_bTextNormalized( false )
+{
+}
+
+CPathMappedFile::CPathMappedFile( CPathMappedFile &&src )
+	: CPathMappedFile()
+{
+	*this = std::move( src );
+}
+
+CPathMappedFile &CPathMappedFile::operator=( CPathMappedFile &&src )
+{
+	if ( this != &src )
+	{
+		Close();
+
+		m_bOpen = src.m_bOpen;
+		m_ulSize = src.m_ulSize;
+		m_pMapping = src.m_pMapping;
+		m_vecContents = std::move( src.m_vecContents );
+		m_pData = m_pMapping ? ( const uint8_t * )m_pMapping : ( m_vecContents.empty() ? nullptr : &m_vecContents[ 0 ] );
+		m_bTextChecked = src.m_bTextChecked;
+		m_bTextNormalized = src.m_bTextNormalized;
+		m_sNormalizedText = std::move( src.m_sNormalizedText );
+
+		// the view belongs to this object now
+		src.m_pMapping = nullptr;
+		src.Close();
+	}
+	return *this;
+}
+
+CPathMappedFile::~CPathMappedFile()
+{
+	Close();
+}
+
+void CPathMappedFile::Close()
+{
+	if ( m_pMapping )
+	{
+#if defined( _WIN32 )
+		UnmapViewOfFile( m_pMapping );
 #else
-	std::wstring wstrFilename = UTF8to16( strFilename.c_str() );
-	// the open operation needs to be sharable, therefore use of _wfsopen instead of _wfopen_s
-	f = _wfsopen( wstrFilename.c_str(), L"rb", _SH_DENYNO );
+		munmap( m_pMapping, ( size_t )m_ulSize );
 #endif
+		m_pMapping = nullptr;
+	}
 
-	std::vector<uint8_t> vecFileContents;
+	m_bOpen = false;
+	m_pData = nullptr;
+	m_ulSize = 0;
+	m_vecContents.clear();
+	m_bTextChecked = false;
+	m_bTextNormalized = false;
+	m_sNormalizedText.clear();
+}
 
-	if ( f != NULL )
+const char *CPathMappedFile::GetText( uint64_t *pulLength )
+{
+	if ( !m_bTextChecked )
+	{
+		m_bTextChecked = true;
+		m_bTextNormalized = m_ulSize && memchr( m_pData, '\r', ( size_t )m_ulSize ) != nullptr;
+		if ( m_bTextNormalized )
+		{
+			m_sNormalizedText.reserve( ( size_t )m_ulSize );
+			AppendNormalizedText( ( const char * )m_pData, ( size_t )m_ulSize, m_sNormalizedText );
+		}
+	}
+
+	if ( m_bTextNormalized )
 	{
-		fseek( f, 0, SEEK_END );
-		int size = ftell( f );
-		fseek( f, 0, SEEK_SET );
+		if ( pulLength )
+			*pulLength = m_sNormalizedText.size();
+		return m_sNormalizedText.data();
+	}
 
-		vecFileContents.resize( size );
-		if ( fread( &vecFileContents[ 0 ], size, 1, f ) == 1 )
+	if ( pulLength )
+		*pulLength = m_ulSize;
+	return ( const char * )m_pData;
+}
+
+
+#if defined( POSIX )
+//-----------------------------------------------------------------------------
+// Purpose: Reads a whole file into a vector or string. Uses pread while the
+//			file reports a size, then keeps reading to EOF for files whose size
+//			lies (procfs, sysfs) or that can't seek at all (pipes).
+//-----------------------------------------------------------------------------
+template< class Container >
+static bool ReadFileDescriptor( int fd, uint64_t ulSizeHint, Container &vecContents )
+{
+	vecContents.resize( ulSizeHint ? ( size_t )ulSizeHint : 4096 );
+	size_t unRead = 0;
+	bool bCanSeek = true;
+	for ( ;; )
+	{
+		// Once the reported size is in, look for more through a small buffer of our own.
+		// Usually there is none, and growing the container just to find that out would
+		// copy the whole file a second time.
+		char rgchProbe[ 512 ];
+		bool bProbe = ulSizeHint != 0 && unRead == vecContents.size();
+		if ( !bProbe && unRead == vecContents.size() )
+			vecContents.resize( vecContents.size() * 2 );
+
+		void *pDest = bProbe ? ( void * )rgchProbe : ( void * )&vecContents[ unRead ];
+		size_t unWanted = bProbe ? sizeof( rgchProbe ) : vecContents.size() - unRead;
+		ssize_t nRead = bCanSeek
+			? pread( fd, pDest, unWanted, ( off_t )unRead )
+			: read( fd, pDest, unWanted );
+		if ( nRead < 0 )
 		{
+			if ( errno == EINTR )
+				continue;
+			if ( errno == ESPIPE && bCanSeek && unRead == 0 )
+			{
+				bCanSeek = false;
+				continue;
+			}
+			vecContents.clear();
+			return false;
 		}
-		else
+		if ( nRead == 0 )
+			break;
+		if ( bProbe )
 		{
-			vecFileContents.clear();
+			// the file is longer than it said, so read the rest as if it had no size
+			vecContents.insert( vecContents.end(), rgchProbe, rgchProbe + nRead );
+			ulSizeHint = 0;
 		}
-
-		fclose( f );
+		unRead += ( size_t )nRead;
 	}
 
-	return vecFileContents ;
+	vecContents.resize( unRead );
+	return true;
 }
+#endif
 
 
-unsigned char * Path_ReadBinaryFile( const std::string &strFilename, int *pSize )
+//-----------------------------------------------------------------------------
+// Purpose: Reads a whole file with plain reads, for the Path_Read* helpers.
+//			A page cache copy is cheaper than setting up and tearing down a
+//			mapping for the small files they are used on; callers that want
+//			the mapping use Path_MapFile.
+//-----------------------------------------------------------------------------
+template< class Container >
+static bool ReadFileContents( const std::string &strFilename, Container &contents )
 {
-	FILE *f;
+	contents.clear();
+
 #if defined( POSIX )
-	f = fopen( strFilename.c_str(), "rb" );
+	int fd = open( strFilename.c_str(), O_RDONLY | O_CLOEXEC );
+	if ( fd < 0 )
+		return false;
+
+	struct stat st;
+	bool bRead = fstat( fd, &st ) == 0 && !S_ISDIR( st.st_mode ) && ( uint64_t )st.st_size <= ( uint64_t )SIZE_MAX
+		&& ReadFileDescriptor( fd, S_ISREG( st.st_mode ) ? ( uint64_t )st.st_size : 0, contents );
+	close( fd );
+	return bRead;
 #else
 	std::wstring wstrFilename = UTF8to16( strFilename.c_str() );
-	// the open operation needs to be sharable, therefore use of _wfsopen instead of _wfopen_s
-	f = _wfsopen( wstrFilename.c_str(), L"rb", _SH_DENYNO );
+	// the open operation needs to be sharable, the same way _wfsopen with _SH_DENYNO is
+	HANDLE hFile = CreateFileW( wstrFilename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
+		FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+	if ( hFile == INVALID_HANDLE_VALUE )
+		return false;
+
+	LARGE_INTEGER liSize;
+	bool bRead = GetFileSizeEx( hFile, &liSize ) && ( uint64_t )liSize.QuadPart <= ( uint64_t )SIZE_MAX;
+	if ( bRead )
+	{
+		contents.resize( ( size_t )liSize.QuadPart );
+		size_t unRead = 0;
+		while ( unRead < contents.size() )
+		{
+			DWORD dwChunk = ( DWORD )std::min< size_t >( contents.size() - unRead, 1 << 30 );
+			DWORD dwRead = 0;
+			if ( !ReadFile( hFile, &contents[ unRead ], dwChunk, &dwRead, NULL ) )
+			{
+				bRead = false;
+				break;
+			}
+			if ( dwRead == 0 )
+				break;
+			unRead += dwRead;
+		}
+		contents.resize( bRead ? unRead : 0 );
+	}
+
+	CloseHandle( hFile );
+	return bRead;
 #endif
-	
-	unsigned char* buf = NULL;
+}
 
-	if ( f != NULL )
+
+//-----------------------------------------------------------------------------
+// Purpose: Maps or reads a whole file
+//-----------------------------------------------------------------------------
+bool Path_MapFile( const std::string &strFilename, CPathMappedFile *pMappedFile, EPathMapFileAccess eAccess )
+{
+	pMappedFile->Close();
+
+#if defined( POSIX )
+	int fd = open( strFilename.c_str(), O_RDONLY | O_CLOEXEC );
+	if ( fd < 0 )
+		return false;
+
+	struct stat st;
+	if ( fstat( fd, &st ) != 0 || S_ISDIR( st.st_mode ) )
 	{
-		fseek(f, 0, SEEK_END);
-		int size = ftell(f);
-		fseek(f, 0, SEEK_SET);
+		close( fd );
+		return false;
+	}
 
-		buf = new unsigned char[size];
-		if (buf && fread(buf, size, 1, f) == 1)
+	uint64_t ulSize = ( uint64_t )st.st_size;
+	if ( S_ISREG( st.st_mode ) && ulSize > 0 && ulSize <= ( uint64_t )SIZE_MAX )
+	{
+		void *pMapping = mmap( nullptr, ( size_t )ulSize, PROT_READ, MAP_PRIVATE, fd, 0 );
+		if ( pMapping != MAP_FAILED )
 		{
-			if (pSize)
-				*pSize = size;
+			if ( eAccess == PathMapFileAccess_Random )
+			{
+				madvise( pMapping, ( size_t )ulSize, MADV_RANDOM );
+			}
+			else
+			{
+				madvise( pMapping, ( size_t )ulSize, MADV_SEQUENTIAL );
+				madvise( pMapping, ( size_t )ulSize, MADV_WILLNEED );
+			}
+
+			pMappedFile->m_pMapping = pMapping;
+			pMappedFile->m_pData = ( const uint8_t * )pMapping;
+			pMappedFile->m_ulSize = ulSize;
 		}
-		else
+	}
+
+	if ( !pMappedFile->m_pMapping )
+	{
+		// regular files that report no size are usually generated on read, so those are read too
+		if ( ulSize > ( uint64_t )SIZE_MAX || !ReadFileDescriptor( fd, S_ISREG( st.st_mode ) ? ulSize : 0, pMappedFile->m_vecContents ) )
 		{
-			delete[] buf;
-			buf = 0;
+			close( fd );
+			return false;
 		}
+		pMappedFile->m_ulSize = pMappedFile->m_vecContents.size();
+		pMappedFile->m_pData = pMappedFile->m_vecContents.empty() ? nullptr : &pMappedFile->m_vecContents[ 0 ];
+	}
 
-		fclose(f);
+	// the mapping keeps its own reference to the file
+	close( fd );
+#else
+	std::wstring wstrFilename = UTF8to16( strFilename.c_str() );
+	// the open operation needs to be sharable, the same way _wfsopen with _SH_DENYNO is
+	HANDLE hFile = CreateFileW( wstrFilename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
+		eAccess == PathMapFileAccess_Random ? FILE_FLAG_RANDOM_ACCESS : FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+	if ( hFile == INVALID_HANDLE_VALUE )
+		return false;
+
+	LARGE_INTEGER liSize;
+	if ( !GetFileSizeEx( hFile, &liSize ) || ( uint64_t )liSize.QuadPart > ( uint64_t )SIZE_MAX )
+	{
+		CloseHandle( hFile );
+		return false;
 	}
 
-	return buf;
+	uint64_t ulSize = ( uint64_t )liSize.QuadPart;
+	if ( ulSize > 0 )
+	{
+		HANDLE hMapping = CreateFileMappingW( hFile, NULL, PAGE_READONLY, 0, 0, NULL );
+		void *pMapping = hMapping ? MapViewOfFile( hMapping, FILE_MAP_READ, 0, 0, 0 ) : NULL;
+		if ( hMapping )
+			CloseHandle( hMapping );
+		if ( !pMapping )
+		{
+			CloseHandle( hFile );
+			return false;
+		}
+
+		pMappedFile->m_pMapping = pMapping;
+		pMappedFile->m_pData = ( const uint8_t * )pMapping;
+		pMappedFile->m_ulSize = ulSize;
+	}
+
+	// the view keeps its own reference to the file
+	CloseHandle( hFile );
+#endif
+
+	pMappedFile->m_bOpen = true;
+	return true;
 }
 
-uint32_t  Path_ReadBinaryFile( const std::string &strFilename, unsigned char *pBuffer, uint32_t unSize )
+
+//-----------------------------------------------------------------------------
+// Purpose: reading and writing files in the vortex directory
+//-----------------------------------------------------------------------------
+std::vector<uint8_t> Path_ReadBinaryFile( const std::string & strFilename )
 {
-	FILE *f;
+	std::vector<uint8_t> vecFileContents;
+	ReadFileContents( strFilename, vecFileContents );
+	return vecFileContents ;
+}
+
+
+unsigned char * Path_ReadBinaryFile( const std::string &strFilename, int *pSize )
+{
+	unsigned char* buf = NULL;
+
 #if defined( POSIX )
-	f = fopen( strFilename.c_str(), "rb" );
-#else
-	std::wstring wstrFilename = UTF8to16( strFilename.c_str() );
-	errno_t err = _wfopen_s( &f, wstrFilename.c_str(), L"rb" );
-	if ( err != 0 )
+	// regular files say how big they are, so read straight into the buffer handed back
+	int fd = open( strFilename.c_str(), O_RDONLY | O_CLOEXEC );
+	if ( fd < 0 )
+		return NULL;
+
+	struct stat st;
+	if ( fstat( fd, &st ) == 0 && S_ISREG( st.st_mode ) && st.st_size > 0 )
 	{
-		f = NULL;
+		if ( ( uint64_t )st.st_size <= INT_MAX )
+		{
+			size_t size = ( size_t )st.st_size;
+			buf = new unsigned char[ size ];
+			size_t unRead = 0;
+			while ( unRead < size )
+			{
+				ssize_t nRead = pread( fd, buf + unRead, size - unRead, ( off_t )unRead );
+				if ( nRead < 0 && errno == EINTR )
+					continue;
+				if ( nRead <= 0 )
+					break;
+				unRead += ( size_t )nRead;
+			}
+
+			// a file that shrank while it was read comes back short; a failed read not at all
+			if ( unRead == 0 )
+			{
+				delete[] buf;
+				buf = NULL;
+			}
+			else if ( pSize )
+			{
+				*pSize = ( int )unRead;
+			}
+		}
+		close( fd );
+		return buf;
 	}
+	close( fd );
 #endif
 
+	// files without a size (procfs, pipes) and everything on Windows go through a vector.
+	// The size goes back as an int, so bigger files are treated as unreadable rather than truncated
+	std::vector<uint8_t> vecFileContents;
+	if ( ReadFileContents( strFilename, vecFileContents ) && !vecFileContents.empty() && vecFileContents.size() <= INT_MAX )
+	{
+		buf = new unsigned char[ vecFileContents.size() ];
+		memcpy( buf, &vecFileContents[ 0 ], vecFileContents.size() );
+		if ( pSize )
+			*pSize = ( int )vecFileContents.size();
+	}
+
+	return buf;
+}
+
+uint32_t  Path_ReadBinaryFile( const std::string &strFilename, unsigned char *pBuffer, uint32_t unSize )
+{
 	uint32_t unSizeToReturn = 0;
 
-	if ( f != NULL )
+#if defined( POSIX )
+	int fd = open( strFilename.c_str(), O_RDONLY | O_CLOEXEC );
+	struct stat st;
+	if ( fd >= 0 && fstat( fd, &st ) == 0 && S_ISREG( st.st_mode ) && ( uint64_t )st.st_size <= UINT32_MAX )
 	{
-		fseek( f, 0, SEEK_END );
-		uint32_t size = (uint32_t)ftell( f );
-		fseek( f, 0, SEEK_SET );
+		uint32_t size = ( uint32_t )st.st_size;
 
 		if ( size > unSize || !pBuffer )
 		{
-			unSizeToReturn = (uint32_t)size;
+			unSizeToReturn = size;
 		}
 		else
 		{
-			if ( fread( pBuffer, size, 1, f ) == 1 )
+			// straight into the caller's buffer
+			uint32_t unRead = 0;
+			while ( unRead < size )
 			{
-				unSizeToReturn = (uint32_t)size;
+				ssize_t nRead = pread( fd, pBuffer + unRead, size - unRead, ( off_t )unRead );
+				if ( nRead < 0 && errno == EINTR )
+					continue;
+				if ( nRead <= 0 )
+					break;
+				unRead += ( uint32_t )nRead;
 			}
+			if ( unRead == size )
+				unSizeToReturn = size;
 		}
+	}
+	if ( fd >= 0 )
+		close( fd );
+#else
+	std::wstring wstrFilename = UTF8to16( strFilename.c_str() );
+	HANDLE hFile = CreateFileW( wstrFilename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
+		FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+	LARGE_INTEGER liSize;
+	if ( hFile != INVALID_HANDLE_VALUE && GetFileSizeEx( hFile, &liSize ) && ( uint64_t )liSize.QuadPart <= UINT32_MAX )
+	{
+		uint32_t size = ( uint32_t )liSize.QuadPart;
 
-		fclose( f );
+		if ( size > unSize || !pBuffer )
+		{
+			unSizeToReturn = size;
+		}
+		else
+		{
+			DWORD dwRead = 0;
+			if ( size == 0 || ( ReadFile( hFile, pBuffer, size, &dwRead, NULL ) && dwRead == size ) )
+				unSizeToReturn = size;
+		}
 	}
+	if ( hFile != INVALID_HANDLE_VALUE )
+		CloseHandle( hFile );
+#endif
 
 	return unSizeToReturn;
 }
@@ -728,26 +1240,26 @@ bool Path_WriteBinaryFile(const std::string &strFilename, unsigned char *pData,
 
 std::string Path_ReadTextFile( const std::string &strFilename )
 {
-	// doing it this way seems backwards, but I don't
-	// see an easy way to do this with C/C++ style IO
-	// that isn't worse...
-	int size;
-	unsigned char* buf = Path_ReadBinaryFile( strFilename, &size );
-	if (!buf)
-		return "";
+	std::string ret;
 
-	// convert CRLF -> LF
-	size_t outsize = 1;
-	for (int i=1; i < size; i++)
+	// read straight into the string, then convert CRLF -> LF in place
+	if ( ReadFileContents( strFilename, ret ) )
 	{
-		if (buf[i] == '\n' && buf[i-1] == '\r') // CRLF
-			buf[outsize-1] = '\n'; // ->LF
-		else
-			buf[outsize++] = buf[i]; // just copy
+		char *pchOut = ( char * )memchr( &ret[ 0 ], '\r', ret.size() );
+		if ( pchOut )
+		{
+			const char *pchIn = pchOut;
+			const char *pchEnd = ret.data() + ret.size();
+			while ( pchIn != pchEnd )
+			{
+				if ( *pchIn == '\r' && pchIn + 1 != pchEnd && pchIn[ 1 ] == '\n' )
+					++pchIn;
+				*pchOut++ = *pchIn++;
+			}
+			ret.resize( pchOut - ret.data() );
+		}
 	}
 
-	std::string ret((char *)buf, outsize);
-	delete[] buf;
 	return ret;
 }
 
@@ -5,6 +5,8 @@
 #include <vector>
 #include <stdint.h>
 
+#include "strtools_public.h"
+
 /** Returns the path (including filename) to the current executable */
 std::string Path_GetExecutablePath();
 
@@ -72,6 +74,58 @@ std::string Path_Compact( const std::string & sRawPath, char slash = 0 );
 * sequences, slash type, or case (on case-insensitive platforms). */
 bool Path_IsSamePath( const std::string & sPath1, const std::string & sPath2 );
 
+/** Output of the non-allocating path helpers below. Paths up to k_unInlineLength chars stay inside
+* the object and longer ones move to the heap. The contents are always NUL terminated. */
+class CPathBuffer
+{
+public:
+	static const size_t k_unInlineLength = 260;
+
+	CPathBuffer();
+	CPathBuffer( const CPathBuffer & src );
+	CPathBuffer &operator=( const CPathBuffer & src );
+
+	const char *c_str() const { return m_pchData; }
+	const char *data() const { return m_pchData; }
+	char *data() { return m_pchData; }
+	size_t size() const { return m_unLength; }
+	bool empty() const { return m_unLength == 0; }
+	char operator[]( size_t unIndex ) const { return m_pchData[ unIndex ]; }
+	char &operator[]( size_t unIndex ) { return m_pchData[ unIndex ]; }
+	CStringView View() const { return CStringView( m_pchData, m_unLength ); }
+	operator CStringView() const { return View(); }
+	std::string str() const { return std::string( m_pchData, m_unLength ); }
+
+	void Clear() { Truncate( 0 ); }
+	void Truncate( size_t unLength );
+	void Reserve( size_t unLength );
+	void Append( char c );
+	void Append( CStringView sText );
+	void Assign( CStringView sText );
+
+private:
+	char *m_pchData;
+	size_t m_unLength;
+	size_t m_unCapacity;				// not counting the terminator
+	char m_rgchInline[ k_unInlineLength + 1 ];
+	std::vector<char> m_vecHeap;
+};
+
+/** Non-allocating forms of the helpers above. They take views so std::strings, literals and
+* pieces of other paths can be passed without copies, and the Strip/Get forms return views into
+* their input. Output that has to be built goes into a CPathBuffer. */
+CStringView Path_StripFilenameView( CStringView sPath, char slash = 0 );
+CStringView Path_StripDirectoryView( CStringView sPath, char slash = 0 );
+CStringView Path_StripExtensionView( CStringView sPath );
+CStringView Path_GetExtensionView( CStringView sPath );
+void Path_FixSlashesTo( CStringView sPath, CPathBuffer *pOut, char slash = 0 );
+void Path_JoinTo( CStringView first, CStringView second, CPathBuffer *pOut, char slash = 0 );
+
+/** Path_Compact in a single pass. Returns false and leaves pOut empty where Path_Compact returns
+* an empty path for a broken number of ..s. */
+bool Path_CompactTo( CStringView sRawPath, CPathBuffer *pOut, char slash = 0 );
+bool Path_IsSamePathView( CStringView sPath1, CStringView sPath2 );
+
 //** Removed trailing slashes */
 std::string Path_RemoveTrailingSlash( const std::string & sRawPath, char slash = 0 );
 
@@ -91,7 +145,8 @@ std::string Path_FindParentSubDirectoryRecursively( const std::string &strStartD
 /** Make a text file writable. */
 bool Path_MakeWritable( const std::string &strFilename );
 
-/** Path operations to read or write text/binary files */
+/** Path operations to read or write text/binary files. The readers use plain reads; Path_MapFile
+* below is there for callers that want a mapping instead. */
 unsigned char * Path_ReadBinaryFile( const std::string &strFilename, int *pSize );
 uint32_t  Path_ReadBinaryFile( const std::string &strFilename, unsigned char *pBuffer, uint32_t unSize );
 std::vector<uint8_t> Path_ReadBinaryFile( const std::string & strFilename );
@@ -100,6 +155,57 @@ std::string Path_ReadTextFile( const std::string &strFilename );
 bool Path_WriteStringToTextFile( const std::string &strFilename, const char *pchData );
 bool Path_WriteStringToTextFileAtomic( const std::string &strFilename, const char *pchData );
 
+/** How a mapped file is going to be read, passed on to the OS as a paging hint */
+enum EPathMapFileAccess
+{
+	PathMapFileAccess_Sequential = 0,	// front to back, once; the default for whole-file reads
+	PathMapFileAccess_Random = 1,
+};
+
+/** A read only view of a whole file. Regular files are memory mapped; anything that can't be
+* mapped (pipes, procfs files and the like) is read into memory instead. The view stays valid
+* until the object is closed or destroyed, as long as nobody truncates a mapped file in place
+* meanwhile; files replaced with Path_WriteStringToTextFileAtomic are safe. */
+class CPathMappedFile
+{
+public:
+	CPathMappedFile();
+	CPathMappedFile( CPathMappedFile &&src );
+	CPathMappedFile &operator=( CPathMappedFile &&src );
+	~CPathMappedFile();
+
+	void Close();
+
+	bool IsOpen() const { return m_bOpen; }
+	bool IsMapped() const { return m_pMapping != nullptr; }
+	const uint8_t *GetData() const { return m_pData; }
+	uint64_t GetSize() const { return m_ulSize; }
+
+	/** The contents with every CRLF turned into LF, not NUL terminated. Points into the view
+	* itself unless the file has a CRLF in it, in which case a normalized copy is made the
+	* first time it's asked for. */
+	const char *GetText( uint64_t *pulLength );
+
+private:
+	CPathMappedFile( const CPathMappedFile & ) = delete;
+	CPathMappedFile &operator=( const CPathMappedFile & ) = delete;
+
+	friend bool Path_MapFile( const std::string &strFilename, CPathMappedFile *pMappedFile, EPathMapFileAccess eAccess );
+
+	bool m_bOpen;
+	const uint8_t *m_pData;
+	uint64_t m_ulSize;
+	void *m_pMapping;					// the mapped view, or NULL when the contents were read into m_vecContents
+	std::vector<uint8_t> m_vecContents;
+	bool m_bTextChecked;
+	bool m_bTextNormalized;				// whether GetText returns m_sNormalizedText rather than the view
+	std::string m_sNormalizedText;
+};
+
+/** Opens a file as a CPathMappedFile, closing whatever pMappedFile held before. Returns false
+* if the file couldn't be opened or read. Sizes are 64 bit throughout. */
+bool Path_MapFile( const std::string &strFilename, CPathMappedFile *pMappedFile, EPathMapFileAccess eAccess = PathMapFileAccess_Sequential );
+
 /** Returns a file:// url for paths, or an http or https url if that's what was provided */
 std::string Path_FilePathToUrl( const std::string & sRelativePath, const std::string & sBasePath );
 
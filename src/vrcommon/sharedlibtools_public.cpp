@@ -1,6 +1,11 @@
 //========= Copyright Valve Corporation ============//
 #include "sharedlibtools_public.h"
+#include "pathtools_public.h"
+#include "strtools_public.h"
 #include <string.h>
+#include <stdio.h>
+
+#include <chrono>
 
 #if defined(_WIN32)
 #include <windows.h>
@@ -8,10 +13,36 @@
 
 #if defined(POSIX)
 #include <dlfcn.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <unistd.h>
+#endif
+
+
+//-----------------------------------------------------------------------------
+// Purpose: The reason the loader gave for the failure that just happened
+//-----------------------------------------------------------------------------
+static std::string GetLoadErrorText()
+{
+#if defined( _WIN32 )
+	DWORD unError = ::GetLastError();
+	char rchMessage[ 512 ];
+	DWORD unLength = ::FormatMessageA( FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS, NULL, unError, 0, rchMessage, sizeof( rchMessage ), NULL );
+	while ( unLength > 0 && ( rchMessage[ unLength - 1 ] == '\r' || rchMessage[ unLength - 1 ] == '\n' ) )
+		unLength--;
+
+	char rchCode[ 32 ];
+	snprintf( rchCode, sizeof( rchCode ), "error %u", ( uint32_t )unError );
+	return unLength ? std::string( rchMessage, unLength ) + " (" + rchCode + ")" : std::string( rchCode );
+#elif defined( POSIX )
+	const char *pchError = dlerror();
+	return pchError ? pchError : "unknown error";
 #endif
+}
 
 
-SharedLibHandle SharedLib_Load( const char *pchPath, uint32_t *pErrorCode )
+SharedLibHandle SharedLib_Load( const char *pchPath, uint32_t *pErrorCode, std::string *psError )
 {
 	SharedLibHandle pHandle = nullptr;
 #if defined( _WIN32)
@@ -20,12 +51,31 @@ SharedLibHandle SharedLib_Load( const char *pchPath, uint32_t *pErrorCode )
 	pHandle = (SharedLibHandle) dlopen(pchPath, RTLD_LOCAL|RTLD_NOW);
 #endif
 
+#if defined( _WIN32 )
+	// read before anything else can overwrite it
+	uint32_t unLastError = pHandle ? 0 : ( uint32_t )GetLastError();
+#endif
+	if ( psError )
+	{
+		if ( pHandle == nullptr )
+		{
+#if defined( _WIN32 )
+			::SetLastError( unLastError );
+#endif
+			*psError = GetLoadErrorText();
+		}
+		else
+		{
+			psError->clear();
+		}
+	}
+
 	if ( pErrorCode )
 	{
 		if ( pHandle == nullptr )
 		{
 #if defined( _WIN32)
-			*pErrorCode = ( uint32_t ) GetLastError();
+			*pErrorCode = unLastError;
 #elif defined(POSIX)
 			*pErrorCode = 1;
 #endif
@@ -61,3 +111,313 @@ void SharedLib_Unload( SharedLibHandle lib )
 }
 
 
+
+
+//-----------------------------------------------------------------------------
+// Purpose: The key a module is known by. Bare names are left for the loader
+//			to search for; paths are made absolute and, where the platform can,
+//			resolved through symlinks so two routes to one file share a module.
+//-----------------------------------------------------------------------------
+static std::string GetModuleKey( const char *pchPath )
+{
+	std::string sPath = pchPath ? pchPath : "";
+	if ( sPath.find_first_of( "/\\" ) == std::string::npos )
+		return sPath;
+
+#if defined( POSIX )
+	char *pchResolved = realpath( sPath.c_str(), nullptr );
+	if ( pchResolved )
+	{
+		sPath = pchResolved;
+		free( pchResolved );
+		return sPath;
+	}
+#endif
+
+	std::string sAbsolute = Path_MakeAbsolute( sPath, Path_GetWorkingDirectory() );
+	if ( !sAbsolute.empty() )
+		sPath = sAbsolute;
+
+#if defined( _WIN32 )
+	StringToLowerInPlace( sPath );
+#endif
+	return sPath;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Asks the OS to start reading the file in, so the loader finds it
+//			in the page cache
+//-----------------------------------------------------------------------------
+static void PrefetchModuleFile( const std::string & sPath )
+{
+#if defined( LINUX )
+	int fd = open( sPath.c_str(), O_RDONLY | O_CLOEXEC );
+	if ( fd >= 0 )
+	{
+		posix_fadvise( fd, 0, 0, POSIX_FADV_WILLNEED );
+		close( fd );
+	}
+#else
+	( void )sPath;
+#endif
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Loads with the requested binding, timing the loader
+//-----------------------------------------------------------------------------
+static SharedLibHandle LoadSharedLib( const std::string & sPath, ESharedLibBinding eBinding, std::string *psError, double *pflLoadMs )
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+#if defined( _WIN32 )
+	( void )eBinding;
+	std::wstring wsPath = UTF8to16( sPath.c_str() );
+	SharedLibHandle hModule = ( SharedLibHandle )::LoadLibraryExW( wsPath.c_str(), NULL, LOAD_WITH_ALTERED_SEARCH_PATH );
+#elif defined( POSIX )
+	SharedLibHandle hModule = ( SharedLibHandle )dlopen( sPath.c_str(), RTLD_LOCAL | ( eBinding == SharedLibBinding_Lazy ? RTLD_LAZY : RTLD_NOW ) );
+#endif
+	*pflLoadMs = std::chrono::duration< double, std::milli >( std::chrono::steady_clock::now() - start ).count();
+
+	if ( !hModule )
+		*psError = GetLoadErrorText();
+	return hModule;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+CSharedLibManager::CSharedLibManager( ESharedLibBinding eBinding )
+	: m_eBinding( eBinding )
+	, m_bShutdown( false )
+{
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+CSharedLibManager::~CSharedLibManager()
+{
+	{
+		std::lock_guard< std::mutex > lock( m_mutex );
+		m_bShutdown = true;
+	}
+	m_cvPreload.notify_all();
+	if ( m_preloadThread.joinable() )
+		m_preloadThread.join();
+
+	for ( std::map< SharedLibHandle, Module_t * >::iterator i = m_mapHandles.begin(); i != m_mapHandles.end(); i++ )
+	{
+		SharedLib_Unload( i->first );
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Finds or loads the module with the lock held, dropping it around
+//			the loader call. A preload gives up rather than waits when the
+//			module is already there or on its way.
+//-----------------------------------------------------------------------------
+CSharedLibManager::Module_t *CSharedLibManager::LoadModule( const std::string & sPath, bool bPreload, std::unique_lock< std::mutex > & lock )
+{
+	for ( ;; )
+	{
+		std::map< std::string, std::unique_ptr< Module_t > >::iterator i = m_mapModules.find( sPath );
+		if ( i == m_mapModules.end() )
+			break;
+
+		Module_t *pModule = i->second.get();
+		if ( pModule->bLoading || pModule->hModule )
+		{
+			if ( bPreload )
+				return nullptr;
+
+			if ( pModule->bLoading )
+			{
+				m_cvModuleLoaded.wait( lock );
+				continue;
+			}
+
+			// the preload's reference, if it's still there, becomes this caller's
+			pModule->bPreloadReference = false;
+			pModule->unRefCount++;
+			return pModule;
+		}
+
+		// the last attempt failed, so try again from scratch
+		m_mapModules.erase( i );
+		break;
+	}
+
+	Module_t *pModule = new Module_t;
+	pModule->sPath = sPath;
+	pModule->hModule = nullptr;
+	pModule->unRefCount = 0;
+	pModule->bLoading = true;
+	pModule->bPreloaded = bPreload;
+	pModule->bPreloadReference = false;
+	pModule->flLoadMs = 0.0;
+	m_mapModules[ sPath ].reset( pModule );
+
+	lock.unlock();
+	if ( bPreload )
+		PrefetchModuleFile( sPath );
+	std::string sError;
+	double flLoadMs;
+	SharedLibHandle hModule = LoadSharedLib( sPath, m_eBinding, &sError, &flLoadMs );
+	lock.lock();
+
+	pModule->bLoading = false;
+	pModule->flLoadMs = flLoadMs;
+	pModule->sError = sError;
+	m_cvModuleLoaded.notify_all();
+
+	if ( !hModule )
+		return bPreload ? nullptr : pModule;
+
+	// another path for a library that is already loaded; the loader counted this
+	// load on the same handle, so give that back and share the module we have
+	std::map< SharedLibHandle, Module_t * >::iterator iHandle = m_mapHandles.find( hModule );
+	if ( iHandle != m_mapHandles.end() )
+	{
+		SharedLib_Unload( hModule );
+		m_mapModules.erase( sPath );
+		if ( bPreload )
+			return nullptr;
+		iHandle->second->unRefCount++;
+		return iHandle->second;
+	}
+
+	pModule->hModule = hModule;
+	if ( bPreload )
+		pModule->bPreloadReference = true;
+	else
+		pModule->unRefCount = 1;
+	m_mapHandles[ hModule ] = pModule;
+	return pModule;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+SharedLibHandle CSharedLibManager::Load( const char *pchPath, std::string *psError )
+{
+	std::string sPath = GetModuleKey( pchPath );
+
+	std::unique_lock< std::mutex > lock( m_mutex );
+	Module_t *pModule = LoadModule( sPath, false, lock );
+	if ( !pModule->hModule && psError )
+		*psError = pModule->sError;
+	return pModule->hModule;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+void CSharedLibManager::Unload( SharedLibHandle lib )
+{
+	std::unique_lock< std::mutex > lock( m_mutex );
+	std::map< SharedLibHandle, Module_t * >::iterator i = m_mapHandles.find( lib );
+	if ( i == m_mapHandles.end() || i->second->unRefCount == 0 )
+		return;
+
+	Module_t *pModule = i->second;
+	if ( --pModule->unRefCount > 0 || pModule->bPreloadReference )
+		return;
+
+	m_mapHandles.erase( i );
+	m_mapModules.erase( pModule->sPath );
+	lock.unlock();
+
+	SharedLib_Unload( lib );
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+void *CSharedLibManager::GetFunction( SharedLibHandle lib, const char *pchFunctionName )
+{
+	std::lock_guard< std::mutex > lock( m_mutex );
+	std::map< SharedLibHandle, Module_t * >::iterator i = m_mapHandles.find( lib );
+	if ( i == m_mapHandles.end() )
+		return nullptr;
+
+	std::map< std::string, void * > & mapSymbols = i->second->mapSymbols;
+	std::map< std::string, void * >::iterator iSymbol = mapSymbols.find( pchFunctionName );
+	if ( iSymbol != mapSymbols.end() )
+		return iSymbol->second;
+
+	void *pFunction = SharedLib_GetFunction( lib, pchFunctionName );
+	mapSymbols[ pchFunctionName ] = pFunction;
+	return pFunction;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+void CSharedLibManager::Preload( const char *pchPath )
+{
+	std::string sPath = GetModuleKey( pchPath );
+
+	{
+		std::lock_guard< std::mutex > lock( m_mutex );
+		if ( m_bShutdown || m_mapModules.count( sPath ) )
+			return;
+
+		m_dequePreloads.push_back( sPath );
+		if ( !m_preloadThread.joinable() )
+			m_preloadThread = std::thread( &CSharedLibManager::PreloadThreadMain, this );
+	}
+	m_cvPreload.notify_one();
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+void CSharedLibManager::PreloadThreadMain()
+{
+	std::unique_lock< std::mutex > lock( m_mutex );
+	for ( ;; )
+	{
+		while ( !m_bShutdown && m_dequePreloads.empty() )
+			m_cvPreload.wait( lock );
+		if ( m_bShutdown )
+			return;
+
+		std::string sPath = m_dequePreloads.front();
+		m_dequePreloads.pop_front();
+		LoadModule( sPath, true, lock );
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+void CSharedLibManager::GetModules( std::vector< SharedLibModuleInfo_t > *pvecModules ) const
+{
+	std::lock_guard< std::mutex > lock( m_mutex );
+	pvecModules->clear();
+	pvecModules->reserve( m_mapModules.size() );
+	for ( std::map< std::string, std::unique_ptr< Module_t > >::const_iterator i = m_mapModules.begin(); i != m_mapModules.end(); i++ )
+	{
+		const Module_t & module = *i->second;
+		SharedLibModuleInfo_t info;
+		info.sPath = module.sPath;
+		info.hModule = module.hModule;
+		info.unRefCount = module.unRefCount;
+		info.unCachedSymbols = ( uint32_t )module.mapSymbols.size();
+		info.bLoading = module.bLoading;
+		info.bPreloaded = module.bPreloaded;
+		info.flLoadMs = module.flLoadMs;
+		info.sError = module.sError;
+		pvecModules->push_back( info );
+	}
+}
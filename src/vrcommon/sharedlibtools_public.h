@@ -2,11 +2,103 @@
 #pragma once
 
 #include <stdint.h>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 typedef void *SharedLibHandle;
 
-SharedLibHandle SharedLib_Load( const char *pchPath, uint32_t *pErrorCode = nullptr );
+/** psError gets the loader's reason for a failure: dlerror() text, or the Windows system message */
+SharedLibHandle SharedLib_Load( const char *pchPath, uint32_t *pErrorCode = nullptr, std::string *psError = nullptr );
 void *SharedLib_GetFunction( SharedLibHandle lib, const char *pchFunctionName);
 void SharedLib_Unload( SharedLibHandle lib );
 
 
+/** When a module's imports are bound. Windows always binds at load. */
+enum ESharedLibBinding
+{
+	SharedLibBinding_Now = 0,		// RTLD_NOW: a missing symbol fails the load
+	SharedLibBinding_Lazy = 1,		// RTLD_LAZY: functions are bound on first call, so the load is quicker
+};
+
+/** One module as seen by CSharedLibManager::GetModules */
+struct SharedLibModuleInfo_t
+{
+	std::string sPath;				// the path the module is known by, resolved through symlinks where possible
+	SharedLibHandle hModule;		// NULL while loading or if the load failed
+	uint32_t unRefCount;
+	uint32_t unCachedSymbols;
+	bool bLoading;
+	bool bPreloaded;				// loaded by Preload rather than Load
+	double flLoadMs;				// how long the loader took
+	std::string sError;				// why the load failed
+};
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Loads shared libraries once per path and hands out references.
+//			Each module resolves a symbol name once; later lookups come from
+//			its cache. Preload opens a module on a background thread ahead of
+//			the Load that will need it. Load time and loader errors are kept
+//			per module for diagnostics. Thread safe. Modules still loaded
+//			when the manager is destroyed are unloaded with it.
+//-----------------------------------------------------------------------------
+class CSharedLibManager
+{
+public:
+	explicit CSharedLibManager( ESharedLibBinding eBinding = SharedLibBinding_Now );
+	~CSharedLibManager();
+
+	/** Returns the module with one more reference, loading it if this is the first. Waits for a
+	* preload of the same module that is already under way. */
+	SharedLibHandle Load( const char *pchPath, std::string *psError = nullptr );
+
+	/** Drops a reference from Load. The module is unloaded when the last one goes. */
+	void Unload( SharedLibHandle lib );
+
+	void *GetFunction( SharedLibHandle lib, const char *pchFunctionName );
+
+	/** Reads the file in and loads it on the preload thread. The next Load of the path takes
+	* over the reference the preload holds. */
+	void Preload( const char *pchPath );
+
+	/** Every module that is loaded, loading, or failed to load the last time it was tried */
+	void GetModules( std::vector< SharedLibModuleInfo_t > *pvecModules ) const;
+
+private:
+	CSharedLibManager( const CSharedLibManager & ) = delete;
+	CSharedLibManager &operator=( const CSharedLibManager & ) = delete;
+
+	struct Module_t
+	{
+		std::string sPath;
+		SharedLibHandle hModule;
+		uint32_t unRefCount;
+		bool bLoading;
+		bool bPreloaded;
+		bool bPreloadReference;			// the preload's reference, until a Load takes it over
+		double flLoadMs;
+		std::string sError;
+		std::map< std::string, void * > mapSymbols;		// misses are cached as NULL
+	};
+
+	Module_t *LoadModule( const std::string & sPath, bool bPreload, std::unique_lock< std::mutex > & lock );
+	void PreloadThreadMain();
+
+	ESharedLibBinding m_eBinding;
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_cvModuleLoaded;
+	std::map< std::string, std::unique_ptr< Module_t > > m_mapModules;
+	std::map< SharedLibHandle, Module_t * > m_mapHandles;
+
+	std::thread m_preloadThread;
+	std::condition_variable m_cvPreload;
+	std::deque< std::string > m_dequePreloads;
+	bool m_bShutdown;
+};
@@ -3,17 +3,30 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <sstream>
-#include <codecvt>
-#include <iostream>
+#include <wchar.h>
 #include <functional>
-#include <locale>
-#include <codecvt>
 
 #if defined( _WIN32 )
 #include <windows.h>
 #endif
 
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#include <emmintrin.h>
+#define STRTOOLS_SSE2 1
+#endif
+
+#if defined( __AVX2__ )
+#include <immintrin.h>
+#define STRTOOLS_AVX2 1
+#endif
+
+#if defined( __ARM_NEON ) || defined( __ARM_NEON__ )
+#include <arm_neon.h>
+#define STRTOOLS_NEON 1
+#endif
+
+const size_t CStringView::npos;
+
 //-----------------------------------------------------------------------------
 // Purpose:
 //-----------------------------------------------------------------------------
@@ -36,9 +49,7 @@ bool StringHasSuffix( const std::string &sString, const std::string &sSuffix )
 	if ( cSuffixLen > cStrLen )
 		return false;
 
-	std::string sStringSuffix = sString.substr( cStrLen - cSuffixLen, cSuffixLen );
-
-	return 0 == stricmp( sStringSuffix.c_str(), sSuffix.c_str() );
+	return 0 == stricmp( sString.c_str() + cStrLen - cSuffixLen, sSuffix.c_str() );
 }
 
 bool StringHasSuffixCaseSensitive( const std::string &sString, const std::string &sSuffix )
@@ -49,45 +60,605 @@ bool StringHasSuffixCaseSensitive( const std::string &sString, const std::string
 	if ( cSuffixLen > cStrLen )
 		return false;
 
-	std::string sStringSuffix = sString.substr( cStrLen - cSuffixLen, cSuffixLen );
+	return 0 == strncmp( sString.c_str() + cStrLen - cSuffixLen, sSuffix.c_str(), cSuffixLen );
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Flips the case bit of every byte in [chFirst, chFirst + 25], so
+//			'A' lowers ASCII letters and 'a' raises them
+//-----------------------------------------------------------------------------
+static void FlipASCIICase( char *pch, size_t unLength, char chFirst )
+{
+	size_t i = 0;
+#if defined( STRTOOLS_SSE2 )
+	// biasing the range to start at -128 lets one signed compare test both ends
+	const __m128i vBias = _mm_set1_epi8( ( char )( 0x80 - chFirst ) );
+	const __m128i vLimit = _mm_set1_epi8( ( char )( -128 + 26 ) );
+	const __m128i vCaseBit = _mm_set1_epi8( 0x20 );
+	for ( ; unLength - i >= 16; i += 16 )
+	{
+		__m128i v = _mm_loadu_si128( ( const __m128i * )( pch + i ) );
+		__m128i vInRange = _mm_cmplt_epi8( _mm_add_epi8( v, vBias ), vLimit );
+		_mm_storeu_si128( ( __m128i * )( pch + i ), _mm_xor_si128( v, _mm_and_si128( vInRange, vCaseBit ) ) );
+	}
+#elif defined( STRTOOLS_NEON )
+	const uint8x16_t vFirst = vdupq_n_u8( ( uint8_t )chFirst );
+	const uint8x16_t vLast = vdupq_n_u8( 25 );
+	const uint8x16_t vCaseBit = vdupq_n_u8( 0x20 );
+	for ( ; unLength - i >= 16; i += 16 )
+	{
+		uint8x16_t v = vld1q_u8( ( const uint8_t * )( pch + i ) );
+		uint8x16_t vInRange = vcleq_u8( vsubq_u8( v, vFirst ), vLast );
+		vst1q_u8( ( uint8_t * )( pch + i ), veorq_u8( v, vandq_u8( vInRange, vCaseBit ) ) );
+	}
+#endif
+
+	for ( ; i < unLength; i++ )
+	{
+		if ( ( unsigned char )( pch[ i ] - chFirst ) < 26 )
+			pch[ i ] ^= 0x20;
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Compares two runs of unLength bytes with ASCII letters lowered
+//-----------------------------------------------------------------------------
+static inline unsigned char LowerASCII( unsigned char c )
+{
+	return ( unsigned char )( c - 'A' ) < 26 ? c | 0x20 : c;
+}
+
+static bool EqualsCaseInsensitiveASCII( const char *pch1, const char *pch2, size_t unLength )
+{
+	size_t i = 0;
+#if defined( STRTOOLS_SSE2 )
+	const __m128i vBias = _mm_set1_epi8( ( char )( 0x80 - 'A' ) );
+	const __m128i vLimit = _mm_set1_epi8( ( char )( -128 + 26 ) );
+	const __m128i vCaseBit = _mm_set1_epi8( 0x20 );
+	for ( ; unLength - i >= 16; i += 16 )
+	{
+		__m128i v1 = _mm_loadu_si128( ( const __m128i * )( pch1 + i ) );
+		__m128i v2 = _mm_loadu_si128( ( const __m128i * )( pch2 + i ) );
+		v1 = _mm_or_si128( v1, _mm_and_si128( _mm_cmplt_epi8( _mm_add_epi8( v1, vBias ), vLimit ), vCaseBit ) );
+		v2 = _mm_or_si128( v2, _mm_and_si128( _mm_cmplt_epi8( _mm_add_epi8( v2, vBias ), vLimit ), vCaseBit ) );
+		if ( _mm_movemask_epi8( _mm_cmpeq_epi8( v1, v2 ) ) != 0xFFFF )
+			return false;
+	}
+#elif defined( STRTOOLS_NEON )
+	const uint8x16_t vFirst = vdupq_n_u8( 'A' );
+	const uint8x16_t vLast = vdupq_n_u8( 25 );
+	const uint8x16_t vCaseBit = vdupq_n_u8( 0x20 );
+	for ( ; unLength - i >= 16; i += 16 )
+	{
+		uint8x16_t v1 = vld1q_u8( ( const uint8_t * )( pch1 + i ) );
+		uint8x16_t v2 = vld1q_u8( ( const uint8_t * )( pch2 + i ) );
+		v1 = vorrq_u8( v1, vandq_u8( vcleq_u8( vsubq_u8( v1, vFirst ), vLast ), vCaseBit ) );
+		v2 = vorrq_u8( v2, vandq_u8( vcleq_u8( vsubq_u8( v2, vFirst ), vLast ), vCaseBit ) );
+		uint8x16_t vEqual = vceqq_u8( v1, v2 );
+		uint8x8_t vBoth = vand_u8( vget_low_u8( vEqual ), vget_high_u8( vEqual ) );
+		if ( vget_lane_u64( vreinterpret_u64_u8( vBoth ), 0 ) != ~0ull )
+			return false;
+	}
+#endif
 
-	return 0 == strncmp( sStringSuffix.c_str(), sSuffix.c_str(),cSuffixLen );
+	for ( ; i < unLength; i++ )
+	{
+		if ( LowerASCII( ( unsigned char )pch1[ i ] ) != LowerASCII( ( unsigned char )pch2[ i ] ) )
+			return false;
+	}
+	return true;
 }
 
+
 //-----------------------------------------------------------------------------
 // Purpose:
 //-----------------------------------------------------------------------------
-typedef std::codecvt_utf8< wchar_t > convert_type;
+bool StringHasPrefixView( CStringView sString, CStringView sPrefix )
+{
+	return sPrefix.size() <= sString.size() && EqualsCaseInsensitiveASCII( sString.data(), sPrefix.data(), sPrefix.size() );
+}
 
-std::string UTF16to8(const wchar_t * in)
+bool StringHasPrefixCaseSensitiveView( CStringView sString, CStringView sPrefix )
+{
+	return sPrefix.size() <= sString.size() && 0 == memcmp( sString.data(), sPrefix.data(), sPrefix.size() );
+}
+
+bool StringHasSuffixView( CStringView sString, CStringView sSuffix )
 {
-	static std::wstring_convert< convert_type, wchar_t > s_converter;  // construction of this can be expensive (or even serialized) depending on locale
+	return sSuffix.size() <= sString.size()
+		&& EqualsCaseInsensitiveASCII( sString.end() - sSuffix.size(), sSuffix.data(), sSuffix.size() );
+}
+
+bool StringHasSuffixCaseSensitiveView( CStringView sString, CStringView sSuffix )
+{
+	return sSuffix.size() <= sString.size() && 0 == memcmp( sString.end() - sSuffix.size(), sSuffix.data(), sSuffix.size() );
+}
 
-	try
+bool StringEqualsCaseInsensitive( CStringView sString1, CStringView sString2 )
+{
+	return sString1.size() == sString2.size() && EqualsCaseInsensitiveASCII( sString1.data(), sString2.data(), sString1.size() );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns the first byte at or after p that isn't ASCII, or pend
+//-----------------------------------------------------------------------------
+static const unsigned char *SkipASCII( const unsigned char *p, const unsigned char *pend )
+{
+	// the vector loops only find the block with the non-ASCII byte in it, the scalar loop finds the byte
+#if defined( STRTOOLS_AVX2 )
+	while ( pend - p >= 32 )
 	{
-		return s_converter.to_bytes( in );
+		__m256i v = _mm256_loadu_si256( ( const __m256i * )p );
+		if ( _mm256_movemask_epi8( v ) != 0 )
+			break;
+		p += 32;
 	}
-	catch ( ... )
+#endif
+
+#if defined( STRTOOLS_SSE2 )
+	while ( pend - p >= 16 )
 	{
-		return std::string();
+		__m128i v = _mm_loadu_si128( ( const __m128i * )p );
+		if ( _mm_movemask_epi8( v ) != 0 )
+			break;
+		p += 16;
+	}
+#elif defined( STRTOOLS_NEON )
+	while ( pend - p >= 16 )
+	{
+		uint8x16_t v = vld1q_u8( p );
+		uint8x8_t vHighBits = vorr_u8( vget_low_u8( v ), vget_high_u8( v ) );
+		if ( vget_lane_u64( vreinterpret_u64_u8( vHighBits ), 0 ) & 0x8080808080808080ull )
+			break;
+		p += 16;
 	}
+#endif
+
+	while ( p != pend && *p < 0x80 )
+	{
+		++p;
+	}
+	return p;
 }
 
-std::string UTF16to8( const std::wstring & in ) { return UTF16to8( in.c_str() ); }
+//-----------------------------------------------------------------------------
+// Purpose: Returns the length of the well formed multi-byte UTF-8 sequence at
+//			p, or 0. Accepts exactly what std::codecvt_utf8<char32_t> did, so no
+//			overlong forms and nothing past U+10FFFF, but encoded surrogates pass.
+//-----------------------------------------------------------------------------
+static inline bool IsUTF8Continuation( unsigned char c )
+{
+	return ( c & 0xC0 ) == 0x80;
+}
 
+static size_t UTF8SequenceLength( const unsigned char *p, const unsigned char *pend )
+{
+	size_t unAvailable = pend - p;
+	unsigned char c = p[ 0 ];
 
-std::wstring UTF8to16(const char * in)
+	if ( c < 0xC2 )
+	{
+		// stray continuation byte, or a lead byte that could only start an overlong pair
+		return 0;
+	}
+	else if ( c < 0xE0 )
+	{
+		return ( unAvailable >= 2 && IsUTF8Continuation( p[ 1 ] ) ) ? 2 : 0;
+	}
+	else if ( c < 0xF0 )
+	{
+		if ( unAvailable < 3 || !IsUTF8Continuation( p[ 1 ] ) || !IsUTF8Continuation( p[ 2 ] ) )
+			return 0;
+		if ( c == 0xE0 && p[ 1 ] < 0xA0 )
+			return 0;
+		return 3;
+	}
+	else if ( c < 0xF5 )
+	{
+		if ( unAvailable < 4 || !IsUTF8Continuation( p[ 1 ] ) || !IsUTF8Continuation( p[ 2 ] ) || !IsUTF8Continuation( p[ 3 ] ) )
+			return 0;
+		if ( c == 0xF0 && p[ 1 ] < 0x90 )
+			return 0;
+		if ( c == 0xF4 && p[ 1 ] >= 0x90 )
+			return 0;
+		return 4;
+	}
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: wchar_t is UTF-16 on Windows and UTF-32 everywhere else. Unpaired
+//			surrogates are carried through as their three byte encoding, which
+//			codecvt_utf8 also allowed, so any wide path survives a round trip.
+//-----------------------------------------------------------------------------
+static const bool k_bWideIsUTF16 = sizeof( wchar_t ) == 2;
+
+static inline bool IsLeadSurrogate( uint32_t unCodePoint )
+{
+	return unCodePoint >= 0xD800 && unCodePoint <= 0xDBFF;
+}
+
+static inline bool IsTrailSurrogate( uint32_t unCodePoint )
+{
+	return unCodePoint >= 0xDC00 && unCodePoint <= 0xDFFF;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Widens whole blocks of 16 ASCII chars, returning how many chars were
+//			converted. Stops at the first block with anything else in it.
+//-----------------------------------------------------------------------------
+static size_t WidenASCIIBlocks( const unsigned char *pIn, size_t unInLength, wchar_t *pOut, size_t unOutLength )
+{
+	size_t n = 0;
+#if defined( STRTOOLS_SSE2 )
+	const __m128i vZero = _mm_setzero_si128();
+	while ( unInLength - n >= 16 && unOutLength - n >= 16 )
+	{
+		__m128i v = _mm_loadu_si128( ( const __m128i * )( pIn + n ) );
+		if ( _mm_movemask_epi8( v ) != 0 )
+			break;
+
+		__m128i vLow = _mm_unpacklo_epi8( v, vZero );
+		__m128i vHigh = _mm_unpackhi_epi8( v, vZero );
+		if ( k_bWideIsUTF16 )
+		{
+			_mm_storeu_si128( ( __m128i * )( pOut + n ), vLow );
+			_mm_storeu_si128( ( __m128i * )( pOut + n + 8 ), vHigh );
+		}
+		else
+		{
+			_mm_storeu_si128( ( __m128i * )( pOut + n ), _mm_unpacklo_epi16( vLow, vZero ) );
+			_mm_storeu_si128( ( __m128i * )( pOut + n + 4 ), _mm_unpackhi_epi16( vLow, vZero ) );
+			_mm_storeu_si128( ( __m128i * )( pOut + n + 8 ), _mm_unpacklo_epi16( vHigh, vZero ) );
+			_mm_storeu_si128( ( __m128i * )( pOut + n + 12 ), _mm_unpackhi_epi16( vHigh, vZero ) );
+		}
+		n += 16;
+	}
+#elif defined( STRTOOLS_NEON )
+	while ( unInLength - n >= 16 && unOutLength - n >= 16 )
+	{
+		uint8x16_t v = vld1q_u8( pIn + n );
+		uint8x8_t vHighBits = vorr_u8( vget_low_u8( v ), vget_high_u8( v ) );
+		if ( vget_lane_u64( vreinterpret_u64_u8( vHighBits ), 0 ) & 0x8080808080808080ull )
+			break;
+
+		uint16x8_t vLow = vmovl_u8( vget_low_u8( v ) );
+		uint16x8_t vHigh = vmovl_u8( vget_high_u8( v ) );
+		if ( k_bWideIsUTF16 )
+		{
+			vst1q_u16( ( uint16_t * )( pOut + n ), vLow );
+			vst1q_u16( ( uint16_t * )( pOut + n + 8 ), vHigh );
+		}
+		else
+		{
+			vst1q_u32( ( uint32_t * )( pOut + n ), vmovl_u16( vget_low_u16( vLow ) ) );
+			vst1q_u32( ( uint32_t * )( pOut + n + 4 ), vmovl_u16( vget_high_u16( vLow ) ) );
+			vst1q_u32( ( uint32_t * )( pOut + n + 8 ), vmovl_u16( vget_low_u16( vHigh ) ) );
+			vst1q_u32( ( uint32_t * )( pOut + n + 12 ), vmovl_u16( vget_high_u16( vHigh ) ) );
+		}
+		n += 16;
+	}
+#endif
+	return n;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Narrows whole blocks of 16 wide ASCII chars, returning how many
+//			chars were converted. Stops at the first block with anything else in it.
+//-----------------------------------------------------------------------------
+static size_t NarrowASCIIBlocks( const wchar_t *pIn, size_t unInLength, unsigned char *pOut, size_t unOutLength )
+{
+	size_t n = 0;
+#if defined( STRTOOLS_SSE2 )
+	const __m128i vZero = _mm_setzero_si128();
+	while ( unInLength - n >= 16 && unOutLength - n >= 16 )
+	{
+		__m128i vPacked;
+		if ( k_bWideIsUTF16 )
+		{
+			__m128i v0 = _mm_loadu_si128( ( const __m128i * )( pIn + n ) );
+			__m128i v1 = _mm_loadu_si128( ( const __m128i * )( pIn + n + 8 ) );
+			__m128i vNonASCII = _mm_and_si128( _mm_or_si128( v0, v1 ), _mm_set1_epi16( ( short )0xFF80 ) );
+			if ( _mm_movemask_epi8( _mm_cmpeq_epi16( vNonASCII, vZero ) ) != 0xFFFF )
+				break;
+			vPacked = _mm_packus_epi16( v0, v1 );
+		}
+		else
+		{
+			__m128i v0 = _mm_loadu_si128( ( const __m128i * )( pIn + n ) );
+			__m128i v1 = _mm_loadu_si128( ( const __m128i * )( pIn + n + 4 ) );
+			__m128i v2 = _mm_loadu_si128( ( const __m128i * )( pIn + n + 8 ) );
+			__m128i v3 = _mm_loadu_si128( ( const __m128i * )( pIn + n + 12 ) );
+			__m128i vNonASCII = _mm_and_si128( _mm_or_si128( _mm_or_si128( v0, v1 ), _mm_or_si128( v2, v3 ) ), _mm_set1_epi32( ( int )0xFFFFFF80 ) );
+			if ( _mm_movemask_epi8( _mm_cmpeq_epi32( vNonASCII, vZero ) ) != 0xFFFF )
+				break;
+			vPacked = _mm_packus_epi16( _mm_packs_epi32( v0, v1 ), _mm_packs_epi32( v2, v3 ) );
+		}
+		_mm_storeu_si128( ( __m128i * )( pOut + n ), vPacked );
+		n += 16;
+	}
+#elif defined( STRTOOLS_NEON )
+	while ( unInLength - n >= 16 && unOutLength - n >= 16 )
+	{
+		uint8x16_t vPacked;
+		if ( k_bWideIsUTF16 )
+		{
+			uint16x8_t v0 = vld1q_u16( ( const uint16_t * )( pIn + n ) );
+			uint16x8_t v1 = vld1q_u16( ( const uint16_t * )( pIn + n + 8 ) );
+			uint16x8_t vOr = vorrq_u16( v0, v1 );
+			uint16x4_t vHighBits = vorr_u16( vget_low_u16( vOr ), vget_high_u16( vOr ) );
+			if ( vget_lane_u64( vreinterpret_u64_u16( vHighBits ), 0 ) & 0xFF80FF80FF80FF80ull )
+				break;
+			vPacked = vcombine_u8( vmovn_u16( v0 ), vmovn_u16( v1 ) );
+		}
+		else
+		{
+			uint32x4_t v0 = vld1q_u32( ( const uint32_t * )( pIn + n ) );
+			uint32x4_t v1 = vld1q_u32( ( const uint32_t * )( pIn + n + 4 ) );
+			uint32x4_t v2 = vld1q_u32( ( const uint32_t * )( pIn + n + 8 ) );
+			uint32x4_t v3 = vld1q_u32( ( const uint32_t * )( pIn + n + 12 ) );
+			uint32x4_t vOr = vorrq_u32( vorrq_u32( v0, v1 ), vorrq_u32( v2, v3 ) );
+			uint32x2_t vHighBits = vorr_u32( vget_low_u32( vOr ), vget_high_u32( vOr ) );
+			if ( vget_lane_u64( vreinterpret_u64_u32( vHighBits ), 0 ) & 0xFFFFFF80FFFFFF80ull )
+				break;
+			uint16x8_t v01 = vcombine_u16( vmovn_u32( v0 ), vmovn_u32( v1 ) );
+			uint16x8_t v23 = vcombine_u16( vmovn_u32( v2 ), vmovn_u32( v3 ) );
+			vPacked = vcombine_u8( vmovn_u16( v01 ), vmovn_u16( v23 ) );
+		}
+		vst1q_u8( pOut + n, vPacked );
+		n += 16;
+	}
+#endif
+	return n;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Converts UTF-8 to wide chars, writing as much as fits in pOut and
+//			returning the length the whole output needs
+//-----------------------------------------------------------------------------
+static size_t TranscodeUTF8ToWide( const unsigned char *pIn, size_t unInLength, wchar_t *pOut, size_t unOutLength, EUTFError *peError )
 {
-	static std::wstring_convert< convert_type, wchar_t > s_converter;  // construction of this can be expensive (or even serialized) depending on locale
+	size_t i = 0;
+	size_t o = 0;
+	while ( i < unInLength )
+	{
+		if ( pIn[ i ] < 0x80 )
+		{
+			size_t unBlocks = WidenASCIIBlocks( pIn + i, unInLength - i, pOut + o, o < unOutLength ? unOutLength - o : 0 );
+			i += unBlocks;
+			o += unBlocks;
+
+			// the rest of the run ends inside the block that stopped the vector loop
+			while ( i < unInLength && pIn[ i ] < 0x80 )
+			{
+				if ( o < unOutLength )
+					pOut[ o ] = ( wchar_t )pIn[ i ];
+				o++;
+				i++;
+			}
+			continue;
+		}
+
+		size_t unSequenceLength = UTF8SequenceLength( pIn + i, pIn + unInLength );
+		const unsigned char *p = pIn + i;
+		uint32_t unCodePoint;
+		switch ( unSequenceLength )
+		{
+		case 2:
+			unCodePoint = ( ( p[ 0 ] & 0x1F ) << 6 ) | ( p[ 1 ] & 0x3F );
+			break;
+		case 3:
+			unCodePoint = ( ( p[ 0 ] & 0x0F ) << 12 ) | ( ( p[ 1 ] & 0x3F ) << 6 ) | ( p[ 2 ] & 0x3F );
+			break;
+		case 4:
+			unCodePoint = ( ( p[ 0 ] & 0x07 ) << 18 ) | ( ( p[ 1 ] & 0x3F ) << 12 ) | ( ( p[ 2 ] & 0x3F ) << 6 ) | ( p[ 3 ] & 0x3F );
+			break;
+		default:
+			*peError = UTFError_InvalidInput;
+			return 0;
+		}
+		i += unSequenceLength;
+
+		if ( k_bWideIsUTF16 && unCodePoint >= 0x10000 )
+		{
+			unCodePoint -= 0x10000;
+			if ( o + 1 < unOutLength )
+			{
+				pOut[ o ] = ( wchar_t )( 0xD800 + ( unCodePoint >> 10 ) );
+				pOut[ o + 1 ] = ( wchar_t )( 0xDC00 + ( unCodePoint & 0x3FF ) );
+			}
+			o += 2;
+		}
+		else
+		{
+			if ( o < unOutLength )
+				pOut[ o ] = ( wchar_t )unCodePoint;
+			o++;
+		}
+	}
+
+	*peError = o <= unOutLength ? UTFError_None : UTFError_BufferTooSmall;
+	return o;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Converts wide chars to UTF-8, writing as much as fits in pOut and
+//			returning the length the whole output needs
+//-----------------------------------------------------------------------------
+static size_t TranscodeWideToUTF8( const wchar_t *pIn, size_t unInLength, unsigned char *pOut, size_t unOutLength, EUTFError *peError )
+{
+	size_t i = 0;
+	size_t o = 0;
+	while ( i < unInLength )
+	{
+		uint32_t unCodePoint = k_bWideIsUTF16 ? ( uint16_t )pIn[ i ] : ( uint32_t )pIn[ i ];
+		if ( unCodePoint < 0x80 )
+		{
+			size_t unBlocks = NarrowASCIIBlocks( pIn + i, unInLength - i, pOut + o, o < unOutLength ? unOutLength - o : 0 );
+			i += unBlocks;
+			o += unBlocks;
+
+			// the rest of the run ends inside the block that stopped the vector loop
+			while ( i < unInLength && ( uint32_t )pIn[ i ] < 0x80 )
+			{
+				if ( o < unOutLength )
+					pOut[ o ] = ( unsigned char )pIn[ i ];
+				o++;
+				i++;
+			}
+			continue;
+		}
+		i++;
+
+		if ( k_bWideIsUTF16 && IsLeadSurrogate( unCodePoint ) && i < unInLength && IsTrailSurrogate( ( uint16_t )pIn[ i ] ) )
+		{
+			unCodePoint = 0x10000 + ( ( unCodePoint - 0xD800 ) << 10 ) + ( ( uint16_t )pIn[ i ] - 0xDC00 );
+			i++;
+		}
+		else if ( unCodePoint > 0x10FFFF )
+		{
+			*peError = UTFError_InvalidInput;
+			return 0;
+		}
+
+		unsigned char rgchEncoded[ 4 ];
+		size_t unEncodedLength;
+		if ( unCodePoint < 0x800 )
+		{
+			rgchEncoded[ 0 ] = ( unsigned char )( 0xC0 | ( unCodePoint >> 6 ) );
+			rgchEncoded[ 1 ] = ( unsigned char )( 0x80 | ( unCodePoint & 0x3F ) );
+			unEncodedLength = 2;
+		}
+		else if ( unCodePoint < 0x10000 )
+		{
+			rgchEncoded[ 0 ] = ( unsigned char )( 0xE0 | ( unCodePoint >> 12 ) );
+			rgchEncoded[ 1 ] = ( unsigned char )( 0x80 | ( ( unCodePoint >> 6 ) & 0x3F ) );
+			rgchEncoded[ 2 ] = ( unsigned char )( 0x80 | ( unCodePoint & 0x3F ) );
+			unEncodedLength = 3;
+		}
+		else
+		{
+			rgchEncoded[ 0 ] = ( unsigned char )( 0xF0 | ( unCodePoint >> 18 ) );
+			rgchEncoded[ 1 ] = ( unsigned char )( 0x80 | ( ( unCodePoint >> 12 ) & 0x3F ) );
+			rgchEncoded[ 2 ] = ( unsigned char )( 0x80 | ( ( unCodePoint >> 6 ) & 0x3F ) );
+			rgchEncoded[ 3 ] = ( unsigned char )( 0x80 | ( unCodePoint & 0x3F ) );
+			unEncodedLength = 4;
+		}
 
-	try
+		if ( o + unEncodedLength <= unOutLength )
+			memcpy( pOut + o, rgchEncoded, unEncodedLength );
+		o += unEncodedLength;
+	}
+
+	*peError = o <= unOutLength ? UTFError_None : UTFError_BufferTooSmall;
+	return o;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Caller buffer conversions. The output is NUL terminated whenever it
+//			fits along with the terminator.
+//-----------------------------------------------------------------------------
+size_t UTF16to8( const wchar_t *pwchIn, size_t unInLength, char *pchOut, size_t unOutBufferSize, EUTFError *peError )
+{
+	EUTFError eError;
+	size_t unLength = TranscodeWideToUTF8( pwchIn, unInLength, ( unsigned char * )pchOut, unOutBufferSize, &eError );
+	if ( eError == UTFError_None && unLength == unOutBufferSize )
+		eError = UTFError_BufferTooSmall;
+
+	if ( eError == UTFError_None )
+		pchOut[ unLength ] = '\0';
+	else if ( unOutBufferSize )
+		pchOut[ 0 ] = '\0';
+
+	if ( peError )
+		*peError = eError;
+	return unLength;
+}
+
+size_t UTF8to16( const char *pchIn, size_t unInLength, wchar_t *pwchOut, size_t unOutBufferSize, EUTFError *peError )
+{
+	EUTFError eError;
+	size_t unLength = TranscodeUTF8ToWide( ( const unsigned char * )pchIn, unInLength, pwchOut, unOutBufferSize, &eError );
+	if ( eError == UTFError_None && unLength == unOutBufferSize )
+		eError = UTFError_BufferTooSmall;
+
+	if ( eError == UTFError_None )
+		pwchOut[ unLength ] = L'\0';
+	else if ( unOutBufferSize )
+		pwchOut[ 0 ] = L'\0';
+
+	if ( peError )
+		*peError = eError;
+	return unLength;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Conversions into a string whose storage is reused. UTF-8 never
+//			needs more wide chars than it has bytes, but the other way round a
+//			second pass is needed when the output grows past the input length.
+//-----------------------------------------------------------------------------
+bool UTF16to8( const wchar_t *pwchIn, size_t unInLength, std::string & sOutput )
+{
+	EUTFError eError;
+	sOutput.resize( unInLength );
+	size_t unLength = TranscodeWideToUTF8( pwchIn, unInLength, ( unsigned char * )&sOutput[ 0 ], sOutput.size(), &eError );
+	if ( eError == UTFError_BufferTooSmall )
 	{
-		return s_converter.from_bytes( in );
+		sOutput.resize( unLength );
+		unLength = TranscodeWideToUTF8( pwchIn, unInLength, ( unsigned char * )&sOutput[ 0 ], sOutput.size(), &eError );
 	}
-	catch ( ... )
+
+	if ( eError != UTFError_None )
 	{
-		return std::wstring();
+		sOutput.clear();
+		return false;
 	}
+
+	sOutput.resize( unLength );
+	return true;
+}
+
+bool UTF8to16( const char *pchIn, size_t unInLength, std::wstring & sOutput )
+{
+	EUTFError eError;
+	sOutput.resize( unInLength );
+	size_t unLength = TranscodeUTF8ToWide( ( const unsigned char * )pchIn, unInLength, &sOutput[ 0 ], sOutput.size(), &eError );
+	if ( eError != UTFError_None )
+	{
+		sOutput.clear();
+		return false;
+	}
+
+	sOutput.resize( unLength );
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+std::string UTF16to8(const wchar_t * in)
+{
+	std::string sOutput;
+	if ( in )
+	{
+		UTF16to8( in, wcslen( in ), sOutput );
+	}
+	return sOutput;
+}
+
+std::string UTF16to8( const std::wstring & in ) { return UTF16to8( in.c_str() ); }
+
+
+std::wstring UTF8to16(const char * in)
+{
+	std::wstring sOutput;
+	if ( in )
+	{
+		UTF8to16( in, strlen( in ), sOutput );
+	}
+	return sOutput;
 }
 
 std::wstring UTF8to16( const std::string & in ) { return UTF8to16( in.c_str() ); }
@@ -126,32 +697,44 @@ void strcpy_safe( char *pchBuffer, size_t unBufferSizeBytes, const char *pchSour
 // --------------------------------------------------------------------
 std::string StringToUpper( const std::string & sString )
 {
-	std::string sOut;
-	sOut.reserve( sString.size() + 1 );
-	for( std::string::const_iterator i = sString.begin(); i != sString.end(); i++ )
-	{
-		sOut.push_back( (char)toupper( *i ) );
-	}
-
+	std::string sOut = sString;
+	StringToUpperInPlace( sOut );
 	return sOut;
 }
 
+void StringToUpperInPlace( char *pchString, size_t unLength )
+{
+	FlipASCIICase( pchString, unLength, 'a' );
+}
+
+void StringToUpperInPlace( std::string & sString )
+{
+	if ( !sString.empty() )
+		FlipASCIICase( &sString[ 0 ], sString.size(), 'a' );
+}
+
 
 // --------------------------------------------------------------------
 // Purpose: converts a string to lower case
 // --------------------------------------------------------------------
 std::string StringToLower( const std::string & sString )
 {
-	std::string sOut;
-	sOut.reserve( sString.size() + 1 );
-	for( std::string::const_iterator i = sString.begin(); i != sString.end(); i++ )
-	{
-		sOut.push_back( (char)tolower( *i ) );
-	}
-
+	std::string sOut = sString;
+	StringToLowerInPlace( sOut );
 	return sOut;
 }
 
+void StringToLowerInPlace( char *pchString, size_t unLength )
+{
+	FlipASCIICase( pchString, unLength, 'A' );
+}
+
+void StringToLowerInPlace( std::string & sString )
+{
+	if ( !sString.empty() )
+		FlipASCIICase( &sString[ 0 ], sString.size(), 'A' );
+}
+
 
 uint32_t ReturnStdString( const std::string & sValue, char *pchBuffer, uint32_t unBufferLen )
 {
@@ -423,16 +1006,32 @@ void V_StripExtension( std::string &in )
 {
 	// Find the last dot. If it's followed by a dot or a slash, then it's part of a 
 	// directory specifier like ../../somedir/./blah.
-	std::string::size_type test = in.rfind( '.' );
-	if ( test != std::string::npos )
+	// This handles things like ".\blah" or "c:\my@email.com\abc\def\geh"
+	// Which would otherwise wind up with "" and "c:\my@email", respectively.
+	// The rfind()s this used to do only stripped when both kinds of slash came before
+	// the dot, and one walk back from the end keeps that.
+	std::string::size_type test = std::string::npos;
+	bool bBackslash = false;
+	bool bSlash = false;
+	for ( std::string::size_type i = in.size(); i > 0 && !( bBackslash && bSlash ); i-- )
 	{
-		// This handles things like ".\blah" or "c:\my@email.com\abc\def\geh"
-		// Which would otherwise wind up with "" and "c:\my@email", respectively.
-		if ( in.rfind( '\\' ) < test && in.rfind( '/' ) < test )
+		char c = in[ i - 1 ];
+		if ( c == '.' && test == std::string::npos )
 		{
-			in.resize( test );
+			test = i - 1;
+		}
+		else if ( c == '\\' || c == '/' )
+		{
+			if ( test == std::string::npos )
+				return;
+			( c == '/' ? bSlash : bBackslash ) = true;
 		}
 	}
+
+	if ( test != std::string::npos && bBackslash && bSlash )
+	{
+		in.resize( test );
+	}
 }
 
 
@@ -442,16 +1041,10 @@ void V_StripExtension( std::string &in )
 std::vector<std::string> TokenizeString( const std::string & sString, char cToken )
 {
 	std::vector<std::string> vecStrings;
-	std::istringstream stream( sString );
-	std::string s;
-	while ( std::getline( stream, s, cToken ) )
+	CStringSplitter splitter( sString, cToken );
+	for ( CStringSplitter::Iterator i = splitter.begin(); i != splitter.end(); ++i )
 	{
-		vecStrings.push_back( s );
-	}
-
-	if ( !sString.empty() && sString.back() == cToken )
-	{
-		vecStrings.push_back( "" );
+		vecStrings.push_back( ( *i ).str() );
 	}
 
 	return vecStrings;
@@ -459,73 +1052,44 @@ std::vector<std::string> TokenizeString( const std::string & sString, char cToke
 
 //-----------------------------------------------------------------------------
 // Purpose: Repairs a should-be-UTF-8 string to a for-sure-is-UTF-8 string, plus return boolean if we subbed in '?' somewhere
+//			Every byte that doesn't start a well formed sequence becomes one '?'.
+//			Runs of good bytes are found 16 or 32 at a time while they are ASCII
+//			and copied to the output in one go.
 //-----------------------------------------------------------------------------
 bool RepairUTF8( const char *pbegin, const char *pend, std::string & sOutputUtf8 )
 {
-	typedef std::codecvt_utf8<char32_t> facet_type;
-	facet_type myfacet;
-
-	std::mbstate_t mystate = std::mbstate_t();
-
 	sOutputUtf8.clear();
 	sOutputUtf8.reserve( pend - pbegin );
 	bool bSqueakyClean = true;
 
-	const char *pmid = pbegin;
-	while ( pmid != pend )
-	{
-		bool bHasError = false;
-		bool bHasValidData = false;
+	const unsigned char *p = ( const unsigned char * )pbegin;
+	const unsigned char *pEnd = ( const unsigned char * )pend;
+	const unsigned char *pRun = p;		// start of the good bytes that haven't been copied yet
 
-		char32_t out = 0xdeadbeef, *pout;
-		pbegin = pmid;
-		switch ( myfacet.in( mystate, pbegin, pend, pmid, &out, &out + 1, pout ) )
+	while ( p != pEnd )
+	{
+		if ( *p < 0x80 )
 		{
-		case facet_type::ok:
-			bHasValidData = true;
-			break;
-
-		case facet_type::noconv:
-			// unexpected! always converting type
-			bSqueakyClean = false;
-			break;
-
-		case facet_type::partial:
-			bHasError = pbegin == pmid;
-			if ( bHasError )
-			{
-				bSqueakyClean = false;
-			}
-			else
-			{
-				bHasValidData = true;
-			}
-			break;
-
-		case facet_type::error:
-			bHasError = true;
-			bSqueakyClean = false;
-			break;
+			p = SkipASCII( p, pEnd );
+			continue;
 		}
 
-		if ( bHasValidData )
+		size_t unLength = UTF8SequenceLength( p, pEnd );
+		if ( unLength )
 		{
-			// could convert back, but no need
-			for ( const char *p = pbegin; p != pmid; ++p )
-			{
-				sOutputUtf8 += *p;
-			}
+			p += unLength;
+			continue;
 		}
 
-		if ( bHasError )
-		{
-			sOutputUtf8 += '?';
-		}
+		sOutputUtf8.append( ( const char * )pRun, p - pRun );
+		sOutputUtf8 += '?';
+		bSqueakyClean = false;
+		pRun = ++p;
+	}
 
-		if ( pmid == pbegin )
-		{
-			pmid++;
-		}
+	if ( p != pRun )
+	{
+		sOutputUtf8.append( ( const char * )pRun, p - pRun );
 	}
 
 	return bSqueakyClean;
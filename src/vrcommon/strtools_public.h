@@ -2,10 +2,70 @@
 #pragma once
 
 #include <string>
+#include <string.h>
 #include <stdint.h>
 #include <sys/types.h>
 #include <vector>
 
+/** A pointer and length into text owned by someone else, for helpers that only need to look at a
+* string. The library builds as C++11, which has no std::string_view, so this carries the part of
+* its interface the tools here use. The text is not NUL terminated in general. */
+class CStringView
+{
+public:
+	static const size_t npos = ( size_t )-1;
+
+	CStringView() : m_pchData( "" ), m_unLength( 0 ) {}
+	CStringView( const char *pchData ) : m_pchData( pchData ? pchData : "" ), m_unLength( pchData ? strlen( pchData ) : 0 ) {}
+	CStringView( const char *pchData, size_t unLength ) : m_pchData( pchData ), m_unLength( unLength ) {}
+	CStringView( const std::string & s ) : m_pchData( s.data() ), m_unLength( s.size() ) {}
+
+	const char *data() const { return m_pchData; }
+	size_t size() const { return m_unLength; }
+	bool empty() const { return m_unLength == 0; }
+	const char *begin() const { return m_pchData; }
+	const char *end() const { return m_pchData + m_unLength; }
+	char operator[]( size_t unIndex ) const { return m_pchData[ unIndex ]; }
+	char front() const { return m_pchData[ 0 ]; }
+	char back() const { return m_pchData[ m_unLength - 1 ]; }
+
+	CStringView substr( size_t unPos, size_t unLength = npos ) const
+	{
+		if ( unPos > m_unLength )
+			unPos = m_unLength;
+		if ( unLength > m_unLength - unPos )
+			unLength = m_unLength - unPos;
+		return CStringView( m_pchData + unPos, unLength );
+	}
+
+	size_t find( char c, size_t unPos = 0 ) const
+	{
+		if ( unPos >= m_unLength )
+			return npos;
+		const char *pch = ( const char * )memchr( m_pchData + unPos, c, m_unLength - unPos );
+		return pch ? ( size_t )( pch - m_pchData ) : npos;
+	}
+
+	size_t rfind( char c ) const
+	{
+		for ( size_t i = m_unLength; i > 0; i-- )
+		{
+			if ( m_pchData[ i - 1 ] == c )
+				return i - 1;
+		}
+		return npos;
+	}
+
+	std::string str() const { return std::string( m_pchData, m_unLength ); }
+
+	bool operator==( const CStringView & other ) const { return m_unLength == other.m_unLength && ( !m_unLength || !memcmp( m_pchData, other.m_pchData, m_unLength ) ); }
+	bool operator!=( const CStringView & other ) const { return !( *this == other ); }
+
+private:
+	const char *m_pchData;
+	size_t m_unLength;
+};
+
 /** returns true if the string has the prefix */
 bool StringHasPrefix( const std::string & sString, const std::string & sPrefix );
 bool StringHasPrefixCaseSensitive( const std::string & sString, const std::string & sPrefix );
@@ -14,15 +74,41 @@ bool StringHasPrefixCaseSensitive( const std::string & sString, const std::strin
 bool StringHasSuffix( const std::string &sString, const std::string &sSuffix );
 bool StringHasSuffixCaseSensitive( const std::string &sString, const std::string &sSuffix );
 
-/** converts a UTF-16 string to a UTF-8 string */
+/** Forms of the prefix and suffix tests that compare in place instead of copying. The case
+* insensitive ones fold ASCII letters only, which is what the C locale functions above do. */
+bool StringHasPrefixView( CStringView sString, CStringView sPrefix );
+bool StringHasPrefixCaseSensitiveView( CStringView sString, CStringView sPrefix );
+bool StringHasSuffixView( CStringView sString, CStringView sSuffix );
+bool StringHasSuffixCaseSensitiveView( CStringView sString, CStringView sSuffix );
+
+/** returns true if the strings are the same apart from the case of ASCII letters */
+bool StringEqualsCaseInsensitive( CStringView sString1, CStringView sString2 );
+
+/** converts a UTF-16 string to a UTF-8 string, empty if the input isn't valid */
 std::string UTF16to8( const wchar_t * in );
 std::string UTF16to8( const std::wstring & in );
 
-/** converts a UTF-8 string to a UTF-16 string */
+/** converts a UTF-8 string to a UTF-16 string, empty if the input isn't valid */
 std::wstring UTF8to16(const char * in);
 std::wstring UTF8to16( const std::string & in );
 #define Utf16FromUtf8 UTF8to16
 
+enum EUTFError
+{
+	UTFError_None = 0,
+	UTFError_InvalidInput = 1,		// malformed or truncated UTF-8, or a wide char past U+10FFFF
+	UTFError_BufferTooSmall = 2,	// the output and its terminator didn't fit
+};
+
+/** converts into a caller buffer and NUL terminates it. Returns the length the output needs, not counting
+* the terminator, so a caller that got UTFError_BufferTooSmall knows how much to allocate. Safe from any thread. */
+size_t UTF16to8( const wchar_t *pwchIn, size_t unInLength, char *pchOut, size_t unOutBufferSize, EUTFError *peError );
+size_t UTF8to16( const char *pchIn, size_t unInLength, wchar_t *pwchOut, size_t unOutBufferSize, EUTFError *peError );
+
+/** converts into sOutput, reusing its storage. Returns false and leaves sOutput empty if the input isn't valid */
+bool UTF16to8( const wchar_t *pwchIn, size_t unInLength, std::string & sOutput );
+bool UTF8to16( const char *pchIn, size_t unInLength, std::wstring & sOutput );
+
 #if defined( _WIN32 )
 std::string DefaultACPtoUTF8( const char *pszStr );
 #endif
@@ -46,6 +132,12 @@ std::string StringToUpper( const std::string & sString );
 /** converts a string to lower case */
 std::string StringToLower( const std::string & sString );
 
+/** Change the case of ASCII letters where they are, leaving all other bytes alone */
+void StringToUpperInPlace( char *pchString, size_t unLength );
+void StringToUpperInPlace( std::string & sString );
+void StringToLowerInPlace( char *pchString, size_t unLength );
+void StringToLowerInPlace( std::string & sString );
+
 // we stricmp (from WIN) but it isn't POSIX - OSX/LINUX have strcasecmp so just inline bridge to it
 #if defined( OSX ) || defined( LINUX )
 #include <strings.h>
@@ -150,3 +242,65 @@ void V_StripExtension( std::string &in );
 
 /** Tokenizes a string into a vector of strings */
 std::vector<std::string> TokenizeString( const std::string & sString, char cToken );
+
+/** Walks the pieces of a string between separators without copying them:
+*
+*	for ( CStringView sToken : CStringSplitter( sSearchPath, ';' ) )
+*
+* The pieces are the ones TokenizeString returns, so n separators give n+1 pieces and
+* an empty string gives none. The string has to outlive the splitter. */
+class CStringSplitter
+{
+public:
+	class Iterator
+	{
+	public:
+		Iterator() : m_pchToken( NULL ), m_pchTokenEnd( NULL ), m_pchEnd( NULL ), m_cSeparator( 0 ) {}
+		Iterator( CStringView sString, char cSeparator )
+			: m_pchToken( sString.empty() ? NULL : sString.data() ), m_pchTokenEnd( NULL ), m_pchEnd( sString.end() ), m_cSeparator( cSeparator )
+		{
+			FindTokenEnd();
+		}
+
+		CStringView operator*() const { return CStringView( m_pchToken, m_pchTokenEnd - m_pchToken ); }
+		Iterator &operator++()
+		{
+			if ( m_pchTokenEnd == m_pchEnd )
+			{
+				m_pchToken = NULL;
+			}
+			else
+			{
+				m_pchToken = m_pchTokenEnd + 1;
+				FindTokenEnd();
+			}
+			return *this;
+		}
+
+		bool operator==( const Iterator & other ) const { return m_pchToken == other.m_pchToken; }
+		bool operator!=( const Iterator & other ) const { return m_pchToken != other.m_pchToken; }
+
+	private:
+		void FindTokenEnd()
+		{
+			if ( !m_pchToken )
+				return;
+			const char *pchSeparator = ( const char * )memchr( m_pchToken, m_cSeparator, m_pchEnd - m_pchToken );
+			m_pchTokenEnd = pchSeparator ? pchSeparator : m_pchEnd;
+		}
+
+		const char *m_pchToken;				// NULL once the last piece has been passed
+		const char *m_pchTokenEnd;
+		const char *m_pchEnd;
+		char m_cSeparator;
+	};
+
+	CStringSplitter( CStringView sString, char cSeparator ) : m_sString( sString ), m_cSeparator( cSeparator ) {}
+
+	Iterator begin() const { return Iterator( m_sString, m_cSeparator ); }
+	Iterator end() const { return Iterator(); }
+
+private:
+	CStringView m_sString;
+	char m_cSeparator;
+};
@@ -31,6 +31,7 @@ public:
 	std::string GetRuntimePath() const;
 	std::string GetConfigPath() const;
 	std::string GetLogPath() const;
+	const std::vector< std::string > & GetExternalDrivers() const { return m_vecExternalDrivers; }
 
 protected:
 	typedef std::vector< std::string > StringVector_t;